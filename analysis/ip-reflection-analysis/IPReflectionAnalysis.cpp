@@ -125,9 +125,24 @@ struct Summary final : public AbstractDomain<Summary> {
   reflection::ReflectionSites m_reflection_sites;
 };
 
+// The result of analyzing a method, and what it depended on besides the code.
+struct MemoizedAnalysis {
+  reflection::CallingContext context;
+  // The summary query results of all invokes, in instruction order.
+  std::vector<reflection::AbstractObjectDomain> callee_returns;
+  reflection::AbstractObjectDomain return_value;
+  reflection::ReflectionSites reflection_sites;
+  reflection::CallingContextMap partition;
+};
+
 struct AnalysisParameters {
   // For speeding up reflection analysis
   reflection::MetadataCache refl_meta_cache;
+  // The last analysis of each method. Methods are reanalyzed in every
+  // iteration of the interprocedural fixpoint, though most of their contexts
+  // and callee summaries don't change from one iteration to the next.
+  ConcurrentMap<const DexMethod*, std::shared_ptr<const MemoizedAnalysis>>
+      memoized;
 };
 
 using CallerContext = typename Caller::Domain;
@@ -163,16 +178,36 @@ class ReflectionAnalyzer : public Base {
     };
 
     auto context = this->get_caller_context()->get(m_method);
-    reflection::ReflectionAnalysis analysis(
-        const_cast<DexMethod*>(m_method),
-        &context,
-        &query_fn,
-        &this->get_analysis_parameters()->refl_meta_cache);
+    auto memo = std::make_shared<MemoizedAnalysis>();
+    memo->context = context;
+    if (const auto* code = m_method->get_code()) {
+      for (const auto& mie : InstructionIterable(code->cfg())) {
+        if (opcode::is_an_invoke(mie.insn->opcode())) {
+          memo->callee_returns.push_back(query_fn(mie.insn));
+        }
+      }
+    }
+    auto& memoized = this->get_analysis_parameters()->memoized;
+    auto result = memoized.get(m_method, nullptr);
+    if (result == nullptr || !(result->context == memo->context) ||
+        result->callee_returns != memo->callee_returns) {
+      reflection::ReflectionAnalysis analysis(
+          const_cast<DexMethod*>(m_method),
+          &memo->context,
+          &query_fn,
+          &this->get_analysis_parameters()->refl_meta_cache);
+      memo->return_value = analysis.get_return_value();
+      memo->reflection_sites = analysis.get_reflection_sites();
+      memo->partition = analysis.get_calling_context_partition();
+      memoized.insert_or_assign(std::make_pair(m_method, memo));
+      result = memo;
+    }
+    // Otherwise, nothing the analysis depends on changed.
 
-    m_summary.set_value(analysis.get_return_value());
-    m_summary.set_reflection_sites(analysis.get_reflection_sites());
+    m_summary.set_value(result->return_value);
+    m_summary.set_reflection_sites(result->reflection_sites);
 
-    auto partition = analysis.get_calling_context_partition();
+    const auto& partition = result->partition;
     if (!partition.is_top() && !partition.is_bottom()) {
       for (const auto& entry : partition.bindings()) {
         auto insn = entry.first;
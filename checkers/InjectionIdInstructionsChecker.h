@@ -11,12 +11,14 @@
 
 namespace redex_properties {
 
-class InjectionIdInstructionsChecker : public PropertyChecker {
+class InjectionIdInstructionsChecker : public MethodPropertyChecker {
  public:
   InjectionIdInstructionsChecker()
-      : PropertyChecker(names::NeedsInjectionIdLowering) {}
+      : MethodPropertyChecker(names::NeedsInjectionIdLowering) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override { return !established; }
+
+  void check_method(DexMethod* method) const override;
 };
 
 } // namespace redex_properties
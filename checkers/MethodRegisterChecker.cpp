@@ -15,7 +15,6 @@
 #include "Interference.h"
 #include "ScopedCFG.h"
 #include "Show.h"
-#include "Walkers.h"
 
 namespace redex_properties {
 
@@ -51,103 +50,97 @@ reg_t get_param_end(const char* property_name,
   return prev_reg + spacing - 1;
 }
 
-void MethodRegisterChecker::run_checker(DexStoresVector& stores,
-                                        ConfigFiles& /* conf */,
-                                        PassManager& /* mgr */,
-                                        bool established) {
-  if (!established) {
+void MethodRegisterChecker::check_method(DexMethod* method) const {
+  auto* code = method->get_code();
+  if (code == nullptr) {
     return;
   }
-  const auto& scope = build_class_scope(stores);
-  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
-    cfg::ScopedCFG cfg(&code);
-    // 1. Load param's registers are at the end of register frames.
-    reg_t max_param_reg =
-        get_param_end(get_name(get_property()), code.cfg(), method);
-    auto ii = cfg::InstructionIterable(*cfg);
-    for (auto it = ii.begin(); it != ii.end(); ++it) {
-      // Checking several things for each method:
-      auto insn = it->insn;
+  cfg::ScopedCFG cfg(code);
+  // 1. Load param's registers are at the end of register frames.
+  reg_t max_param_reg = get_param_end(get_name(get_property()), *cfg, method);
+  auto ii = cfg::InstructionIterable(*cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    // Checking several things for each method:
+    auto insn = it->insn;
 
-      // 2. dest register is below max param reg and register limit.
-      if (insn->has_dest()) {
-        always_assert_log(
-            insn->dest() <= max_param_reg,
-            "[%s] Instruction %s refers to a register (v%u) > param"
-            " registers (%u) in method %s\n",
-            get_name(get_property()),
-            SHOW(insn),
-            insn->dest(),
-            max_param_reg,
-            SHOW(method));
-        size_t max_dest_reg = regalloc::max_unsigned_value(
-            regalloc::interference::dest_bit_width(it));
+    // 2. dest register is below max param reg and register limit.
+    if (insn->has_dest()) {
+      always_assert_log(
+          insn->dest() <= max_param_reg,
+          "[%s] Instruction %s refers to a register (v%u) > param"
+          " registers (%u) in method %s\n",
+          get_name(get_property()),
+          SHOW(insn),
+          insn->dest(),
+          max_param_reg,
+          SHOW(method));
+      size_t max_dest_reg = regalloc::max_unsigned_value(
+          regalloc::interference::dest_bit_width(it));
+      always_assert_log(
+          insn->dest() <= max_dest_reg,
+          "[%s] Instruction %s refers to a register (v%u) > max dest"
+          " register (%zu) in method %s\n",
+          get_name(get_property()),
+          SHOW(insn),
+          insn->dest(),
+          max_dest_reg,
+          SHOW(method));
+    }
+    bool is_range = false;
+    if (opcode::has_range_form(insn->opcode())) {
+      insn->denormalize_registers();
+      is_range = needs_range_conversion(insn);
+      if (is_range) {
+        // 3. invoke-range's registers are continuous
+        always_assert_log(insn->has_contiguous_range_srcs_denormalized(),
+                          "[%s] Instruction %s has non-contiguous srcs in "
+                          "method %s.\n",
+                          get_name(get_property()),
+                          SHOW(insn),
+                          SHOW(method));
+
+        // 4. No overly large range instructions.
+        auto size = insn->srcs_size();
+        // From DexInstruction::set_range_size;
         always_assert_log(
-            insn->dest() <= max_dest_reg,
-            "[%s] Instruction %s refers to a register (v%u) > max dest"
-            " register (%zu) in method %s\n",
+            dex_opcode::format(opcode::range_version(insn->opcode())) ==
+                    FMT_f5rc ||
+                size == (size & 0xff),
+            "[%s] Range instruction %s takes too much src size in method "
+            "%s.\n",
             get_name(get_property()),
             SHOW(insn),
-            insn->dest(),
-            max_dest_reg,
             SHOW(method));
       }
-      bool is_range = false;
-      if (opcode::has_range_form(insn->opcode())) {
-        insn->denormalize_registers();
-        is_range = needs_range_conversion(insn);
-        if (is_range) {
-          // 3. invoke-range's registers are continuous
-          always_assert_log(insn->has_contiguous_range_srcs_denormalized(),
-                            "[%s] Instruction %s has non-contiguous srcs in "
-                            "method %s.\n",
-                            get_name(get_property()),
-                            SHOW(insn),
-                            SHOW(method));
-
-          // 4. No overly large range instructions.
-          auto size = insn->srcs_size();
-          // From DexInstruction::set_range_size;
-          always_assert_log(
-              dex_opcode::format(opcode::range_version(insn->opcode())) ==
-                      FMT_f5rc ||
-                  size == (size & 0xff),
-              "[%s] Range instruction %s takes too much src size in method "
-              "%s.\n",
-              get_name(get_property()),
-              SHOW(insn),
-              SHOW(method));
-        }
-        auto norm_res = insn->normalize_registers();
-        redex_assert(norm_res);
-      }
-      // 5. All src registers are below max param reg and register limits.
-      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      auto norm_res = insn->normalize_registers();
+      redex_assert(norm_res);
+    }
+    // 5. All src registers are below max param reg and register limits.
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      always_assert_log(
+          insn->src(i) <= max_param_reg,
+          "[%s] Instruction %s refers to a register (v%u) > param"
+          " registers (%u) in method %s\n",
+          get_name(get_property()),
+          SHOW(insn),
+          insn->src(i),
+          max_param_reg,
+          SHOW(method));
+      if (!is_range) {
+        auto max_src_reg = regalloc::interference::max_value_for_src(
+            insn, i, insn->src_is_wide(i));
         always_assert_log(
-            insn->src(i) <= max_param_reg,
-            "[%s] Instruction %s refers to a register (v%u) > param"
+            insn->src(i) <= max_src_reg,
+            "[%s] Instruction %s refers to a register (v%u) > max src"
             " registers (%u) in method %s\n",
             get_name(get_property()),
             SHOW(insn),
             insn->src(i),
-            max_param_reg,
+            max_src_reg,
             SHOW(method));
-        if (!is_range) {
-          auto max_src_reg = regalloc::interference::max_value_for_src(
-              insn, i, insn->src_is_wide(i));
-          always_assert_log(
-              insn->src(i) <= max_src_reg,
-              "[%s] Instruction %s refers to a register (v%u) > max src"
-              " registers (%u) in method %s\n",
-              get_name(get_property()),
-              SHOW(insn),
-              insn->src(i),
-              max_src_reg,
-              SHOW(method));
-        }
       }
     }
-  });
+  }
 }
 
 } // namespace redex_properties
@@ -11,11 +11,13 @@
 
 namespace redex_properties {
 
-class MethodRegisterChecker : public PropertyChecker {
+class MethodRegisterChecker : public MethodPropertyChecker {
  public:
-  MethodRegisterChecker() : PropertyChecker(names::MethodRegister) {}
+  MethodRegisterChecker() : MethodPropertyChecker(names::MethodRegister) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override { return established; }
+
+  void check_method(DexMethod* method) const override;
 };
 
 } // namespace redex_properties
@@ -11,12 +11,14 @@
 
 namespace redex_properties {
 
-class NoInitClassInstructionsChecker : public PropertyChecker {
+class NoInitClassInstructionsChecker : public MethodPropertyChecker {
  public:
   NoInitClassInstructionsChecker()
-      : PropertyChecker(names::NoInitClassInstructions) {}
+      : MethodPropertyChecker(names::NoInitClassInstructions) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override { return established; }
+
+  void check_method(DexMethod* method) const override;
 };
 
 } // namespace redex_properties
@@ -11,12 +11,10 @@
 #include "DexClass.h"
 #include "ScopedCFG.h"
 #include "Show.h"
-#include "Walkers.h"
 
 namespace redex_properties {
 
-void NoSpuriousGetClassCallsChecker::check_spurious_getClass(
-    DexMethod* method) {
+void NoSpuriousGetClassCallsChecker::check_method(DexMethod* method) const {
   IRCode* code = method->get_code();
   if (code == nullptr) {
     return;
@@ -42,23 +40,15 @@ void NoSpuriousGetClassCallsChecker::check_spurious_getClass(
   }
 }
 
-void NoSpuriousGetClassCallsChecker::run_checker(DexStoresVector& stores,
-                                                 ConfigFiles& /* conf */,
-                                                 PassManager&,
-                                                 bool established) {
+bool NoSpuriousGetClassCallsChecker::begin_checks(bool established) {
   if (!established) {
-    return;
+    return false;
   }
-  const auto& scope = build_class_scope(stores);
   m_getClass_ref =
       DexMethod::get_method("Ljava/lang/Object;.getClass:()Ljava/lang/Class;");
-  if (m_getClass_ref == nullptr) {
-    // Could not find Ljava/lang/Object;.getClass:()Ljava/lang/Class;, check
-    // pass. just return;
-    return;
-  }
-  walk::parallel::methods(
-      scope, [&](DexMethod* method) { check_spurious_getClass(method); });
+  // Could not find Ljava/lang/Object;.getClass:()Ljava/lang/Class;, so there
+  // is nothing to check.
+  return m_getClass_ref != nullptr;
 }
 
 } // namespace redex_properties
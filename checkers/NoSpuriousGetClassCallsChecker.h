@@ -11,16 +11,17 @@
 
 namespace redex_properties {
 
-class NoSpuriousGetClassCallsChecker : public PropertyChecker {
+class NoSpuriousGetClassCallsChecker : public MethodPropertyChecker {
  public:
   NoSpuriousGetClassCallsChecker()
-      : PropertyChecker(names::NoSpuriousGetClassCalls) {}
+      : MethodPropertyChecker(names::NoSpuriousGetClassCalls) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override;
+
+  void check_method(DexMethod* method) const override;
 
  private:
-  DexMethodRef* m_getClass_ref;
-  void check_spurious_getClass(DexMethod* method);
+  DexMethodRef* m_getClass_ref{nullptr};
 };
 
 } // namespace redex_properties
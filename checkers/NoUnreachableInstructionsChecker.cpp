@@ -9,23 +9,22 @@
 
 #include "Debug.h"
 #include "DexClass.h"
+#include "EditableCfgAdapter.h"
 #include "Show.h"
-#include "Walkers.h"
 
 namespace redex_properties {
 
-void NoUnreachableInstructionsChecker::run_checker(DexStoresVector& stores,
-                                                   ConfigFiles& /* conf */,
-                                                   PassManager& /*mgr*/,
-                                                   bool established) {
-  if (!established) {
+void NoUnreachableInstructionsChecker::check_method(DexMethod* method) const {
+  auto* code = method->get_code();
+  if (code == nullptr) {
     return;
   }
-  const auto& scope = build_class_scope(stores);
-  walk::parallel::opcodes(scope, [&](DexMethod* method, IRInstruction* insn) {
+  editable_cfg_adapter::iterate(code, [&](const MethodItemEntry& mie) {
+    auto* insn = mie.insn;
     always_assert_log(!opcode::is_unreachable(insn->opcode()),
                       "[%s] %s contains unreachable instruction!\n  {%s}",
                       get_name(get_property()), SHOW(method), SHOW(insn));
+    return editable_cfg_adapter::LOOP_CONTINUE;
   });
 }
 
@@ -11,12 +11,14 @@
 
 namespace redex_properties {
 
-class NoUnreachableInstructionsChecker : public PropertyChecker {
+class NoUnreachableInstructionsChecker : public MethodPropertyChecker {
  public:
   NoUnreachableInstructionsChecker()
-      : PropertyChecker(names::NoUnreachableInstructions) {}
+      : MethodPropertyChecker(names::NoUnreachableInstructions) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override { return established; }
+
+  void check_method(DexMethod* method) const override;
 };
 
 } // namespace redex_properties
@@ -11,12 +11,14 @@
 
 namespace redex_properties {
 
-class NoWriteBarrierInstructionsChecker : public PropertyChecker {
+class NoWriteBarrierInstructionsChecker : public MethodPropertyChecker {
  public:
   NoWriteBarrierInstructionsChecker()
-      : PropertyChecker(names::NoWriteBarrierInstructions) {}
+      : MethodPropertyChecker(names::NoWriteBarrierInstructions) {}
 
-  void run_checker(DexStoresVector&, ConfigFiles&, PassManager&, bool) override;
+  bool begin_checks(bool established) override { return established; }
+
+  void check_method(DexMethod* method) const override;
 };
 
 } // namespace redex_properties
@@ -5,9 +5,12 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <assert.h>
 #include <exception>
 #include <stdexcept>
+#include <string.h>
+#include <unordered_set>
 
 // clang-format off (import order matters)
 #include "locator.h"
@@ -86,4 +89,97 @@ void Locator::encodeGlobalClassIndex(
   assert(static_cast<uint32_t>(pos - buf) <= encoded_global_class_index_max);
 }
 
+// Average number of descriptors per bucket of a class index table. Larger
+// buckets make the table smaller, but take longer to find seeds for.
+constexpr static uint32_t class_index_table_bucket_size = 4;
+
+std::vector<uint8_t> Locator::makeClassIndexTable(
+    const std::vector<std::pair<std::string, uint32_t>>& classes) {
+  if (classes.size() >= invalid_global_class_index) {
+    throw std::runtime_error("too many classes for a class index table");
+  }
+  uint32_t n = classes.size();
+  uint32_t m = (n + class_index_table_bucket_size - 1) /
+               class_index_table_bucket_size;
+
+  std::unordered_set<std::string> seen;
+  std::vector<std::vector<uint32_t>> buckets(m);
+  for (uint32_t i = 0; i < n; ++i) {
+    const auto& name = classes[i].first;
+    if (!seen.insert(name).second) {
+      throw std::runtime_error("duplicate class descriptor " + name);
+    }
+    buckets[hashClassDescriptor(name.c_str(), 0) % m].push_back(i);
+  }
+
+  // Place the largest buckets first, while most entries are still free.
+  std::vector<uint32_t> bucket_order(m);
+  for (uint32_t b = 0; b < m; ++b) {
+    bucket_order[b] = b;
+  }
+  std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return buckets[a].size() > buckets[b].size();
+                   });
+
+  std::vector<uint32_t> seeds(m, 0);
+  std::vector<uint32_t> entry_of(n);
+  std::vector<bool> taken(n, false);
+  std::vector<uint32_t> slots;
+  for (uint32_t b : bucket_order) {
+    const auto& bucket = buckets[b];
+    if (bucket.empty()) {
+      break;
+    }
+    for (uint32_t seed = 1;; ++seed) {
+      if (seed == 0) {
+        throw std::runtime_error("could not build class index table");
+      }
+      slots.clear();
+      bool fits = true;
+      for (uint32_t i : bucket) {
+        uint32_t slot = hashClassDescriptor(classes[i].first.c_str(), seed) % n;
+        if (taken[slot] ||
+            std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          fits = false;
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (!fits) {
+        continue;
+      }
+      for (size_t j = 0; j < bucket.size(); ++j) {
+        taken[slots[j]] = true;
+        entry_of[bucket[j]] = slots[j];
+      }
+      seeds[b] = seed;
+      break;
+    }
+  }
+
+  std::vector<uint32_t> words;
+  words.reserve(4 + m + 2 * n);
+  words.push_back(class_index_table_magic);
+  words.push_back(class_index_table_version);
+  words.push_back(n);
+  words.push_back(m);
+  words.insert(words.end(), seeds.begin(), seeds.end());
+  words.resize(4 + m + 2 * n);
+  std::string pool;
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t* entry = &words[4 + m + 2 * entry_of[i]];
+    entry[0] = pool.size();
+    entry[1] = classes[i].second;
+    pool.append(classes[i].first);
+    pool.push_back('\0');
+  }
+
+  std::vector<uint8_t> table(words.size() * sizeof(uint32_t) + pool.size());
+  memcpy(table.data(), words.data(), words.size() * sizeof(uint32_t));
+  memcpy(table.data() + words.size() * sizeof(uint32_t), pool.data(),
+         pool.size());
+  return table;
+}
+
 } // namespace facebook
@@ -6,8 +6,13 @@
  */
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace facebook {
 
 //
@@ -81,6 +86,34 @@ class Locator {
   static inline uint32_t decodeGlobalClassIndex(
       const char* descriptor) noexcept;
 
+  // A class index table maps class descriptors to global class indices with a
+  // minimal perfect hash, so that classes that do not have a renamed
+  // descriptor can be found with a single probe. The table is a sequence of
+  // native-endian 32-bit words:
+  //
+  //   magic, version, number of classes n, number of buckets m,
+  //   m bucket seeds, n entries of (name offset, global class index),
+  //
+  // followed by the NUL-terminated descriptors that the name offsets point
+  // into. A descriptor hashes with seed 0 to its bucket, and with the seed of
+  // its bucket to its entry. A seed of 0 marks an empty bucket.
+  constexpr static const uint32_t class_index_table_magic = 0x49435852; // RXCI
+  constexpr static const uint32_t class_index_table_version = 1;
+
+  // Builds a table for the given descriptors and their global class indices.
+  // Throws if a descriptor appears more than once.
+  static std::vector<uint8_t> makeClassIndexTable(
+      const std::vector<std::pair<std::string, uint32_t>>& classes);
+
+  // Returns the global class index of the descriptor, or
+  // invalid_global_class_index if the table does not contain it. The table
+  // must be 4-byte aligned.
+  static inline uint32_t lookupGlobalClassIndex(
+      const void* table, size_t table_size, const char* descriptor) noexcept;
+
+  static inline uint32_t hashClassDescriptor(const char* descriptor,
+                                             uint32_t seed) noexcept;
+
   Locator(uint32_t str, uint32_t dex, uint32_t cls)
       : strnr(str), dexnr(dex), clsnr(cls) {}
 };
@@ -133,4 +166,61 @@ uint32_t Locator::decodeGlobalClassIndex(const char* descriptor) noexcept {
   }
 }
 
+uint32_t Locator::hashClassDescriptor(const char* descriptor,
+                                      uint32_t seed) noexcept {
+  // FNV-1a, followed by the murmur3 finalizer so that the seeds give
+  // independent results modulo the table size.
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (const uint8_t* pos = (const uint8_t*)descriptor; *pos != 0; ++pos) {
+    h ^= *pos;
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+uint32_t Locator::lookupGlobalClassIndex(const void* table,
+                                         size_t table_size,
+                                         const char* descriptor) noexcept {
+  const uint32_t* words = (const uint32_t*)table;
+  if (table_size < 4 * sizeof(uint32_t) ||
+      words[0] != class_index_table_magic ||
+      words[1] != class_index_table_version) {
+    return invalid_global_class_index;
+  }
+  uint32_t n = words[2];
+  uint32_t m = words[3];
+  uint64_t header_size = (4 + (uint64_t)m + 2 * (uint64_t)n) * sizeof(uint32_t);
+  if (n == 0 || m == 0 || table_size < header_size) {
+    return invalid_global_class_index;
+  }
+
+  uint32_t seed = words[4 + hashClassDescriptor(descriptor, 0) % m];
+  if (seed == 0) {
+    return invalid_global_class_index;
+  }
+  const uint32_t* entry =
+      words + 4 + m + 2 * (hashClassDescriptor(descriptor, seed) % n);
+
+  size_t pool_size = table_size - header_size;
+  if (entry[0] >= pool_size) {
+    return invalid_global_class_index;
+  }
+  const char* name = (const char*)table + header_size + entry[0];
+  size_t remaining = pool_size - entry[0];
+  for (size_t i = 0; i < remaining; ++i) {
+    if (name[i] != descriptor[i]) {
+      return invalid_global_class_index;
+    }
+    if (name[i] == '\0') {
+      return entry[1];
+    }
+  }
+  return invalid_global_class_index;
+}
+
 } // namespace facebook
@@ -41,6 +41,18 @@ void AnalysisUsage::do_pass_invalidation(
   }
 }
 
+void AnalysisCache::invalidate(const AnalysisUsage& analysis_usage) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_analyses.begin(); it != m_analyses.end();) {
+    if (analysis_usage.preserves(it->first) ||
+        m_self_validating.count(it->first)) {
+      ++it;
+    } else {
+      it = m_analyses.erase(it);
+    }
+  }
+}
+
 void AnalysisUsage::check_dependencies(const std::vector<Pass*>& passes) {
   std::unordered_map<AnalysisID, Pass*> preserved_passes;
   std::ostringstream error;
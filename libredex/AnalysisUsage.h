@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
@@ -46,12 +48,17 @@ class AnalysisUsage {
     m_required_passes.emplace(get_analysis_id_by_pass<AnalysisPassType>());
   }
 
-  // Declares that this current pass preserves a specific analysis pass.
+  // Declares that this current pass preserves a specific analysis pass, or a
+  // specific analysis kept in the AnalysisCache.
   template <typename AnalysisPassType>
   void add_preserve_specific() {
     m_preserve_specific.emplace(get_analysis_id_by_pass<AnalysisPassType>());
   }
 
+  bool preserves(const AnalysisID& id) const {
+    return m_preserve_all || m_preserve_specific.count(id);
+  }
+
   // Returns a set of passes used by (thus should precede) this current pass.
   const std::unordered_set<AnalysisID>& get_required_passes() {
     return m_required_passes;
@@ -72,3 +79,66 @@ class AnalysisUsage {
   std::unordered_set<AnalysisID> m_required_passes;
   std::unordered_set<AnalysisID> m_preserve_specific;
 };
+
+/**
+ * Analyses shared across passes, e.g. the method override graph, which are
+ * built on demand by the first pass that asks for them. Like analysis passes,
+ * a cached analysis survives a pass only if that pass declares to preserve it
+ * by way of AnalysisUsage::add_preserve_specific<Analysis>(). Analyses that
+ * detect changes to what they depend on by themselves can be requested with
+ * get_self_validating() instead, and then survive all passes.
+ */
+class AnalysisCache {
+ public:
+  // Returns the cached instance of the analysis, or caches the one returned
+  // by `build`, which may be a unique_ptr or shared_ptr to the analysis.
+  template <typename Analysis, typename Build>
+  std::shared_ptr<const Analysis> get(const Build& build) {
+    auto id = get_analysis_id_by_pass<Analysis>();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_analyses.find(id);
+      if (it != m_analyses.end()) {
+        return std::static_pointer_cast<const Analysis>(it->second);
+      }
+    }
+    // Build without holding the lock, as building may itself need other
+    // cached analyses.
+    std::shared_ptr<const Analysis> analysis = build();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto [it, _] = m_analyses.emplace(id, std::move(analysis));
+    return std::static_pointer_cast<const Analysis>(it->second);
+  }
+
+  template <typename Analysis, typename Build>
+  std::shared_ptr<const Analysis> get_self_validating(const Build& build) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_self_validating.insert(get_analysis_id_by_pass<Analysis>());
+    }
+    return get<Analysis>(build);
+  }
+
+  bool contains(const AnalysisID& id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_analyses.count(id);
+  }
+
+  // Called from PassManager after each pass.
+  void invalidate(const AnalysisUsage& analysis_usage);
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_analyses.clear();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_analyses.size();
+  }
+
+ private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<AnalysisID, std::shared_ptr<const void>> m_analyses;
+  std::unordered_set<AnalysisID> m_self_validating;
+};
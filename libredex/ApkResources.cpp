@@ -1514,16 +1514,16 @@ bool create_type_reordering(uint32_t package_id,
     type_reordering->emplace_back(i);
   }
   bool has_change = false;
-  for (const auto& pair : old_to_new) {
-    uint32_t p = (pair.first & PACKAGE_MASK_BIT) >> PACKAGE_INDEX_BIT_SHIFT;
-    uint8_t t = (pair.first & TYPE_MASK_BIT) >> TYPE_INDEX_BIT_SHIFT;
-    if (p == package_id && t == type_id) {
-      uint32_t old_entry = pair.first & ENTRY_MASK_BIT;
-      uint32_t new_entry = pair.second & ENTRY_MASK_BIT;
-      if ((*type_reordering)[new_entry] != old_entry) {
-        has_change = true;
-        (*type_reordering)[new_entry] = old_entry;
-      }
+  // The map is ordered by id, so the ids of this type are a contiguous range.
+  auto it = old_to_new.lower_bound(MAKE_RES_ID(package_id, type_id, 0));
+  auto end = old_to_new.upper_bound(
+      MAKE_RES_ID(package_id, type_id, ENTRY_MASK_BIT));
+  for (; it != end; ++it) {
+    uint32_t old_entry = it->first & ENTRY_MASK_BIT;
+    uint32_t new_entry = it->second & ENTRY_MASK_BIT;
+    if ((*type_reordering)[new_entry] != old_entry) {
+      has_change = true;
+      (*type_reordering)[new_entry] = old_entry;
     }
   }
   return has_change;
@@ -1594,6 +1594,8 @@ void ResourcesArscFile::remap_reorder_and_serialize(
     table_builder.add_package(package_builder);
   }
   android::Vector<char> out;
+  // The output is at most as large as the input, avoid regrowing it.
+  out.reserve(m_arsc_len);
   table_builder.serialize(&out);
   m_arsc_len = write_serialized_data(out, std::move(m_f));
   mark_file_closed();
@@ -2487,6 +2489,8 @@ size_t ResourcesArscFile::serialize() {
     table_builder.add_package(package_builder);
   }
   android::Vector<char> serialized;
+  // Deletions shrink the table, so size the output for the common case.
+  serialized.reserve(m_arsc_len);
   table_builder.serialize(&serialized);
 
   m_arsc_len = write_serialized_data_with_expansion(serialized, std::move(m_f));
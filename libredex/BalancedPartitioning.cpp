@@ -14,6 +14,34 @@
 #include "Debug.h"
 #include "WorkQueue.h"
 
+namespace {
+
+/// Splits with at least this many documents (or signatures) process them in
+/// parallel chunks of this size. The top levels of the bisection tree have
+/// only a few, but large, splits, so parallelizing across splits alone leaves
+/// most threads idle there.
+constexpr size_t CHUNK_SIZE = 4096;
+
+size_t num_chunks(size_t size) { return (size + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+/// Calls fn(chunk, begin, end) for each chunk of [0, size).
+template <typename Fn>
+void run_chunks(size_t size, const Fn& fn) {
+  auto n = num_chunks(size);
+  auto run_chunk = [&](size_t chunk) {
+    fn(chunk, chunk * CHUNK_SIZE, std::min(size, (chunk + 1) * CHUNK_SIZE));
+  };
+  if (n <= 1) {
+    for (size_t chunk = 0; chunk < n; chunk++) {
+      run_chunk(chunk);
+    }
+    return;
+  }
+  workqueue_run_for<size_t>(0, n, run_chunk);
+}
+
+} // namespace
+
 BalancedPartitioning::BalancedPartitioning(std::vector<Document*>& documents)
     : documents(documents) {
 
@@ -119,13 +147,21 @@ uint32_t BalancedPartitioning::update_documents(
   uint32_t num_documents = std::distance(document_begin, document_end);
 
   // Get the maximum kmer adjacent to the given set of documents
-  uint32_t max_kmer = 0;
-  for (auto it = document_begin; it != document_end; it++) {
-    Document* doc = *it;
-    const auto& vec = doc->adjacent_kmers();
-    if (!vec.empty()) {
-      max_kmer = std::max(max_kmer, *std::max_element(vec.begin(), vec.end()));
+  std::vector<uint32_t> chunk_max_kmer(num_chunks(num_documents));
+  run_chunks(num_documents, [&](size_t chunk, size_t begin, size_t end) {
+    uint32_t max_kmer = 0;
+    for (auto it = document_begin + begin; it != document_begin + end; it++) {
+      const auto& vec = (*it)->adjacent_kmers();
+      if (!vec.empty()) {
+        max_kmer =
+            std::max(max_kmer, *std::max_element(vec.begin(), vec.end()));
+      }
     }
+    chunk_max_kmer[chunk] = max_kmer;
+  });
+  uint32_t max_kmer = 0;
+  for (auto chunk_max : chunk_max_kmer) {
+    max_kmer = std::max(max_kmer, chunk_max);
   }
 
   // Count the (local) degree of each kmer and compute their new indices
@@ -144,23 +180,31 @@ uint32_t BalancedPartitioning::update_documents(
   }
 
   // Update document adjacency lists
-  max_kmer = 0;
-  for (auto it = document_begin; it != document_end; it++) {
-    Document* doc = *it;
-    std::vector<uint32_t> new_kmers;
-    new_kmers.reserve(doc->size());
-    for (uint32_t kmer : doc->adjacent_kmers()) {
-      uint32_t kmer_idx = *kmer_index[kmer];
-      always_assert_log(1 <= kmer_degree[kmer_idx] &&
-                            kmer_degree[kmer_idx] <= num_documents,
-                        "Incorrect degree of a k-mer");
-      // Ignore useless kmers that do not affect the optimization
-      if (1 < kmer_degree[kmer_idx] && kmer_degree[kmer_idx] < num_documents) {
-        new_kmers.push_back(kmer_idx);
-        max_kmer = std::max(kmer_idx, max_kmer);
+  run_chunks(num_documents, [&](size_t chunk, size_t begin, size_t end) {
+    uint32_t new_max_kmer = 0;
+    for (auto it = document_begin + begin; it != document_begin + end; it++) {
+      Document* doc = *it;
+      std::vector<uint32_t> new_kmers;
+      new_kmers.reserve(doc->size());
+      for (uint32_t kmer : doc->adjacent_kmers()) {
+        uint32_t kmer_idx = *kmer_index[kmer];
+        always_assert_log(1 <= kmer_degree[kmer_idx] &&
+                              kmer_degree[kmer_idx] <= num_documents,
+                          "Incorrect degree of a k-mer");
+        // Ignore useless kmers that do not affect the optimization
+        if (1 < kmer_degree[kmer_idx] &&
+            kmer_degree[kmer_idx] < num_documents) {
+          new_kmers.push_back(kmer_idx);
+          new_max_kmer = std::max(kmer_idx, new_max_kmer);
+        }
       }
+      doc->assign(new_kmers);
     }
-    doc->assign(new_kmers);
+    chunk_max_kmer[chunk] = new_max_kmer;
+  });
+  max_kmer = 0;
+  for (auto chunk_max : chunk_max_kmer) {
+    max_kmer = std::max(max_kmer, chunk_max);
   }
   return max_kmer;
 }
@@ -193,26 +237,30 @@ uint32_t BalancedPartitioning::run_iteration(
     SignaturesType& signatures,
     std::mt19937& rng) const {
   // Initialize signature caches, if needed
-  for (KmerSignature& signature : signatures) {
-    if (signature.cache_is_invalid &&
-        (signature.left_count > 0 || signature.right_count > 0)) {
-      prepare_signature(signature);
-      signature.cache_is_invalid = false;
+  run_chunks(signatures.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      KmerSignature& signature = signatures[i];
+      if (signature.cache_is_invalid &&
+          (signature.left_count > 0 || signature.right_count > 0)) {
+        prepare_signature(signature);
+        signature.cache_is_invalid = false;
+      }
     }
-  }
+  });
 
   // Compute move gains
   uint32_t num_documents =
       uint32_t(std::distance(document_begin, document_end));
   using GainPair = std::pair<double, uint32_t>;
   std::vector<GainPair> gains(num_documents);
-  for (auto it = document_begin; it != document_end; it++) {
-    Document* doc = *it;
-    uint32_t index = it - document_begin;
-    bool from_left_to_right = (doc->bucket == left_bucket);
-    double gain = move_gain(doc, from_left_to_right, signatures);
-    gains[index] = std::make_pair(gain, index);
-  }
+  run_chunks(num_documents, [&](size_t, size_t begin, size_t end) {
+    for (size_t index = begin; index < end; index++) {
+      Document* doc = document_begin[index];
+      bool from_left_to_right = (doc->bucket == left_bucket);
+      double gain = move_gain(doc, from_left_to_right, signatures);
+      gains[index] = std::make_pair(gain, uint32_t(index));
+    }
+  });
 
   // Collect left and right gains
   auto left_gains = gains.begin();
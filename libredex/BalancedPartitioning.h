@@ -34,7 +34,9 @@ class KmerSignature;
  * N is the number of documents and M is the number of document-kmer edges;
  * (assuming that any collection of D documents contains O(D) k-mers). Notice
  * that the two different recursive sub-problems are independent and thus can
- * be efficiently processed in parallel.
+ * be efficiently processed in parallel. Within large splits, the per-document
+ * work (renumbering k-mers, computing move gains) is parallelized as well,
+ * while the moves themselves remain sequential and thus deterministic.
  */
 class BalancedPartitioning {
   using SignaturesType = std::vector<KmerSignature>;
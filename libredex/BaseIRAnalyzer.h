@@ -14,6 +14,55 @@
 
 namespace ir_analyzer {
 
+/*
+ * Analyses of CFGs with at least this many blocks may opt into only retaining
+ * the entry states of blocks (see sparta::RetainedStates), to bound their
+ * memory usage on huge methods.
+ */
+constexpr size_t kRetainEntryStatesOnlyMinBlocks = 4096;
+
+template <typename FixpointIterator>
+void retain_entry_states_only_if_large(const cfg::ControlFlowGraph& cfg,
+                                       FixpointIterator* fp_iter) {
+  if (cfg.num_blocks() >= kRetainEntryStatesOnlyMinBlocks) {
+    fp_iter->set_retained_states(sparta::RetainedStates::Entry);
+  }
+}
+
+/*
+ * Analyses of CFGs with at least this many blocks may opt into scheduling the
+ * blocks concurrently (see sparta::MonotonicFixpointIterator::set_num_threads),
+ * so that the few huge methods at the end of a pass don't hold it up on a
+ * single core. This requires the analysis to be safe to run concurrently on
+ * blocks of the same method, and to not depend on the order in which blocks
+ * are analyzed.
+ */
+constexpr size_t kParallelFixpointMinBlocks = 1024;
+
+template <typename FixpointIterator>
+void run_in_parallel_if_large(const cfg::ControlFlowGraph& cfg,
+                              FixpointIterator* fp_iter) {
+  if (cfg.num_blocks() >= kParallelFixpointMinBlocks) {
+    fp_iter->set_num_threads(sparta::parallel::default_num_threads());
+  }
+}
+
+template <typename GraphInterface>
+struct WeakPartialOrderingTag {};
+
+/*
+ * Returns the weak partial ordering of the blocks of the cfg, as seen through
+ * GraphInterface, reusing the one computed by an earlier analysis of the same
+ * cfg as long as its structure hasn't changed since.
+ */
+template <typename GraphInterface, typename FixpointIterator>
+std::shared_ptr<const typename FixpointIterator::WPO> get_weak_partial_ordering(
+    const cfg::ControlFlowGraph& cfg) {
+  using WPO = typename FixpointIterator::WPO;
+  return cfg.get_structural_data<WeakPartialOrderingTag<GraphInterface>, WPO>(
+      [&cfg]() { return FixpointIterator::make_wpo(cfg); });
+}
+
 template <typename Domain>
 class BaseIRAnalyzer
     : public sparta::MonotonicFixpointIterator<cfg::GraphInterface, Domain> {
@@ -22,7 +71,12 @@ class BaseIRAnalyzer
 
   explicit BaseIRAnalyzer(const cfg::ControlFlowGraph& cfg)
       : sparta::MonotonicFixpointIterator<cfg::GraphInterface, Domain>(
-            cfg, cfg.num_blocks()) {}
+            cfg,
+            get_weak_partial_ordering<
+                cfg::GraphInterface,
+                sparta::MonotonicFixpointIterator<cfg::GraphInterface,
+                                                  Domain>>(cfg),
+            cfg.num_blocks()) {}
 
   void analyze_node(const NodeId& node, Domain* current_state) const override {
     for (auto& mie : ir_list::InstructionIterable(node)) {
@@ -47,7 +101,12 @@ class BaseEdgeAwareIRAnalyzer
 
   explicit BaseEdgeAwareIRAnalyzer(const cfg::ControlFlowGraph& cfg)
       : sparta::MonotonicFixpointIterator<cfg::GraphInterface, Domain>(
-            cfg, cfg.num_blocks()) {}
+            cfg,
+            get_weak_partial_ordering<
+                cfg::GraphInterface,
+                sparta::MonotonicFixpointIterator<cfg::GraphInterface,
+                                                  Domain>>(cfg),
+            cfg.num_blocks()) {}
 
   void analyze_node(const NodeId& node, Domain* state_at_entry) const override {
     auto last_insn = node->get_last_insn();
@@ -132,7 +191,15 @@ class BaseBackwardsIRAnalyzer
   explicit BaseBackwardsIRAnalyzer(const cfg::ControlFlowGraph& cfg)
       : sparta::MonotonicFixpointIterator<
             sparta::BackwardsFixpointIterationAdaptor<cfg::GraphInterface>,
-            Domain>(cfg, cfg.num_blocks()) {}
+            Domain>(
+            cfg,
+            get_weak_partial_ordering<
+                sparta::BackwardsFixpointIterationAdaptor<cfg::GraphInterface>,
+                sparta::MonotonicFixpointIterator<
+                    sparta::BackwardsFixpointIterationAdaptor<
+                        cfg::GraphInterface>,
+                    Domain>>(cfg),
+            cfg.num_blocks()) {}
 
   void analyze_node(const NodeId& node, Domain* current_state) const override {
     for (auto it = node->rbegin(); it != node->rend(); ++it) {
@@ -6,85 +6,89 @@
  */
 
 #include "BaselineProfile.h"
-#include "StlUtil.h"
+
+#include <vector>
+
+#include "WorkQueue.h"
 
 namespace baseline_profiles {
 
-BaselineProfile get_baseline_profile(
-    const BaselineProfileConfig& config,
-    const method_profiles::MethodProfiles& method_profiles,
-    std::unordered_set<const DexMethodRef*>* method_refs_without_def) {
-  std::unordered_set<const DexType*> classes;
-  std::unordered_set<const DexMethod*> startup_methods;
-  std::unordered_set<const DexMethod*> post_startup_methods;
-  for (auto&& [interaction_id, interaction_config] :
-       config.interaction_configs) {
-    const auto& method_stats = method_profiles.method_stats(interaction_id);
-    for (auto&& [method_ref, stat] : method_stats) {
-      auto method = method_ref->as_def();
-      if (method == nullptr) {
-        if (method_refs_without_def != nullptr) {
-          method_refs_without_def->insert(method_ref);
-        }
-        continue;
-      }
+namespace {
 
-      if (stat.appear_percent < interaction_config.threshold ||
-          stat.call_count < interaction_config.call_threshold) {
-        continue;
-      }
+// The decisions of a single interaction config.
+struct InteractionResult {
+  std::unordered_map<const DexMethod*, MethodFlags> methods;
+  std::unordered_set<const DexType*> classes;
+  std::unordered_set<const DexMethodRef*> method_refs_without_def;
+};
 
-      if (interaction_config.startup) {
-        startup_methods.insert(method);
-      }
-      if (interaction_config.post_startup) {
-        post_startup_methods.insert(method);
-      }
-      if (interaction_config.classes) {
-        classes.insert(method->get_class());
-      }
+InteractionResult evaluate_interaction(
+    const BaselineProfileInteractionConfig& interaction_config,
+    const method_profiles::StatsMap& method_stats) {
+  InteractionResult res;
+  for (auto&& [method_ref, stat] : method_stats) {
+    auto method = method_ref->as_def();
+    if (method == nullptr) {
+      res.method_refs_without_def.insert(method_ref);
+      continue;
     }
-  }
 
-  // methods = startup_methods | post_startup_methods
-  std::unordered_set<const DexMethod*> methods(startup_methods.begin(),
-                                               startup_methods.end());
-  methods.insert(post_startup_methods.begin(), post_startup_methods.end());
+    if (stat.appear_percent < interaction_config.threshold ||
+        stat.call_count < interaction_config.call_threshold) {
+      continue;
+    }
 
-  // startup_post_startup_methods = startup_methods & post_startup_methods
-  std::unordered_set<const DexMethod*> startup_post_startup_methods(
-      startup_methods.begin(), startup_methods.end());
-  std20::erase_if(startup_post_startup_methods, [&](const DexMethod* m) {
-    return !post_startup_methods.count(m);
-  });
+    if (interaction_config.startup || interaction_config.post_startup) {
+      auto& flags = res.methods[method];
+      flags.startup |= interaction_config.startup;
+      flags.post_startup |= interaction_config.post_startup;
+    }
+    if (interaction_config.classes) {
+      res.classes.insert(method->get_class());
+    }
+  }
+  return res;
+}
 
-  // startup_methods -= startup_post_startup_methods
-  std20::erase_if(startup_methods, [&](const DexMethod* m) {
-    return startup_post_startup_methods.count(m);
-  });
+} // namespace
 
-  // post_startup_methods -= startup_post_startup_methods
-  std20::erase_if(post_startup_methods, [&](const DexMethod* m) {
-    return startup_post_startup_methods.count(m);
+BaselineProfile get_baseline_profile(
+    const BaselineProfileConfig& config,
+    const method_profiles::MethodProfiles& method_profiles,
+    std::unordered_set<const DexMethodRef*>* method_refs_without_def) {
+  // The interactions are independent, so evaluate them in parallel, and merge
+  // the results in a deterministic order afterwards.
+  std::vector<const std::pair<const std::string,
+                              BaselineProfileInteractionConfig>*>
+      interaction_configs;
+  interaction_configs.reserve(config.interaction_configs.size());
+  for (auto& p : config.interaction_configs) {
+    interaction_configs.push_back(&p);
+  }
+  std::vector<InteractionResult> results(interaction_configs.size());
+  workqueue_run_for<size_t>(0, interaction_configs.size(), [&](size_t i) {
+    auto&& [interaction_id, interaction_config] = *interaction_configs[i];
+    results[i] = evaluate_interaction(
+        interaction_config, method_profiles.method_stats(interaction_id));
   });
 
+  // A method is hot if it is a startup or post-startup method of any
+  // interaction.
   baseline_profiles::BaselineProfile res;
-  for (auto* method : methods) {
-    auto& flags = res.methods[method];
-    if (startup_post_startup_methods.count(method)) {
-      flags.hot = true;
-      flags.startup = true;
-      flags.post_startup = true;
-    } else if (startup_methods.count(method)) {
-      flags.hot = true;
-      flags.startup = true;
-    } else if (post_startup_methods.count(method)) {
-      flags.hot = true;
-      flags.post_startup = true;
+  for (auto& result : results) {
+    for (auto&& [method, flags] : result.methods) {
+      auto& res_flags = res.methods[method];
+      res_flags.hot = true;
+      res_flags.startup |= flags.startup;
+      res_flags.post_startup |= flags.post_startup;
+    }
+    for (auto* type : result.classes) {
+      res.classes.insert(type_class(type));
+    }
+    if (method_refs_without_def != nullptr) {
+      method_refs_without_def->insert(result.method_refs_without_def.begin(),
+                                      result.method_refs_without_def.end());
     }
-  }
-  for (auto* type : classes) {
-    res.classes.insert(type_class(type));
   }
   return res;
 }
@@ -374,28 +374,10 @@ Graph::Graph(const BuildStrategy& strat)
 
   // Obtain the callsites of each method recursively, building the graph in the
   // process.
+  // Edges are first collected per node, and are only laid out in their final
+  // form once the graph is complete.
+  InsertOnlyConcurrentMap<NodeId, std::vector<Edge>> concurrent_succs;
   ConcurrentMap<NodeId, std::list<std::vector<const Edge*>>> concurrent_preds;
-  std::mutex predecessors_wq_mutex;
-  auto predecessors_wq = workqueue_foreach<Node*>([&](Node* callee_node) {
-    auto& preds = concurrent_preds.at_unsafe(callee_node);
-    std::vector<std::vector<const Edge*>> callee_edges;
-    callee_edges.reserve(preds.size());
-    size_t size = 0;
-    for (auto& edges : preds) {
-      size += edges.size();
-      callee_edges.emplace_back(std::move(edges));
-    }
-    std::sort(callee_edges.begin(), callee_edges.end(), [](auto& p, auto& q) {
-      return compare_dexmethods(p.front()->caller()->method(),
-                                q.front()->caller()->method());
-    });
-    auto& callee_predecessors = callee_node->m_predecessors;
-    callee_predecessors.reserve(size);
-    for (auto& edges : callee_edges) {
-      callee_predecessors.insert(callee_predecessors.end(), edges.begin(),
-                                 edges.end());
-    }
-  });
 
   struct WorkItem {
     const DexMethod* caller;
@@ -466,14 +448,13 @@ Graph::Graph(const BuildStrategy& strat)
 
         // Record all edges
         auto* caller_node = work_item.caller_node;
-        auto& caller_successors = caller_node->m_successors;
+        std::vector<Edge> caller_successors;
         caller_successors.reserve(caller_successors_size);
         std::sort(callee_partitions.begin(), callee_partitions.end(),
                   [](auto& p, auto& q) {
                     return compare_dexmethods(p.callee_node->method(),
                                               q.callee_node->method());
                   });
-        std::vector<Node*> added_preds;
         for (auto&& [callee_node, callee_invoke_insns] : callee_partitions) {
           std::vector<const Edge*> callee_edges;
           callee_edges.reserve(callee_invoke_insns.size());
@@ -482,24 +463,13 @@ Graph::Graph(const BuildStrategy& strat)
                                            invoke_insn);
             callee_edges.push_back(&caller_successors.back());
           }
-          bool preds_added;
-          concurrent_preds.update(callee_node,
-                                  [&](auto, auto& preds, bool exists) {
-                                    preds_added = !exists;
-                                    preds.emplace_back(std::move(callee_edges));
-                                  });
-          if (preds_added) {
-            added_preds.push_back(callee_node);
-          }
-        }
-
-        // Schedule postprocessing of predecessors of newly-added preds.
-        if (!added_preds.empty()) {
-          std::lock_guard<std::mutex> lock_guard(predecessors_wq_mutex);
-          for (auto* node : added_preds) {
-            predecessors_wq.add_item(node);
-          }
+          concurrent_preds.update(callee_node, [&](auto, auto& preds, bool) {
+            preds.emplace_back(std::move(callee_edges));
+          });
         }
+        // Moving the vector keeps its buffer, and the edge pointers recorded
+        // above, intact.
+        concurrent_succs.emplace(caller_node, std::move(caller_successors));
 
         // Populate insn-to-callee map
         for (auto&& [invoke_insn, callees] : insn_to_callee) {
@@ -518,7 +488,77 @@ Graph::Graph(const BuildStrategy& strat)
     root_nodes.emplace_back(root_node);
   }
   successors_wq.run_all();
-  predecessors_wq.run_all();
+
+  // Lay out the edges in compressed sparse row form.
+  std::vector<Node*> nodes;
+  nodes.reserve(m_nodes.size() + 2);
+  nodes.push_back(m_entry.get());
+  for (auto& [_, node] : m_nodes) {
+    nodes.push_back(const_cast<Node*>(&node));
+  }
+  nodes.push_back(m_exit.get());
+
+  size_t num_edges = 0;
+  for (auto* node : nodes) {
+    auto* succs = concurrent_succs.get(node);
+    num_edges += succs == nullptr ? 0 : succs->size();
+  }
+  m_edges.reserve(num_edges);
+  for (auto* node : nodes) {
+    node->m_successors_begin = m_edges.data() + m_edges.size();
+    auto* succs = concurrent_succs.get(node);
+    if (succs != nullptr) {
+      m_edges.insert(m_edges.end(), succs->begin(), succs->end());
+    }
+    node->m_successors_end = m_edges.data() + m_edges.size();
+  }
+
+  std::vector<size_t> preds_offsets;
+  preds_offsets.reserve(nodes.size() + 1);
+  preds_offsets.push_back(0);
+  for (auto* node : nodes) {
+    size_t size = 0;
+    auto it = concurrent_preds.find(node);
+    if (it != concurrent_preds.end()) {
+      for (auto& edges : it->second) {
+        size += edges.size();
+      }
+    }
+    preds_offsets.push_back(preds_offsets.back() + size);
+  }
+  m_predecessor_edges.resize(preds_offsets.back());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    nodes[i]->m_predecessors_begin =
+        m_predecessor_edges.data() + preds_offsets[i];
+    nodes[i]->m_predecessors_end =
+        m_predecessor_edges.data() + preds_offsets[i + 1];
+  }
+
+  // Translate the recorded predecessor edges into their final location, in
+  // the deterministic order of their callers.
+  workqueue_run_for<size_t>(0, nodes.size(), [&](size_t i) {
+    auto it = concurrent_preds.find(nodes[i]);
+    if (it == concurrent_preds.end()) {
+      return;
+    }
+    std::vector<std::vector<const Edge*>*> callee_edges;
+    callee_edges.reserve(it->second.size());
+    for (auto& edges : it->second) {
+      callee_edges.push_back(&edges);
+    }
+    std::sort(callee_edges.begin(), callee_edges.end(), [](auto* p, auto* q) {
+      return compare_dexmethods(p->front()->caller()->method(),
+                                q->front()->caller()->method());
+    });
+    auto* out = m_predecessor_edges.data() + preds_offsets[i];
+    for (auto* edges : callee_edges) {
+      for (auto* edge : *edges) {
+        auto caller = edge->caller();
+        *out++ = caller->m_successors_begin +
+                 (edge - concurrent_succs.at(caller).data());
+      }
+    }
+  });
 }
 
 const MethodSet& resolve_callees_in_graph(const Graph& graph,
@@ -86,10 +86,11 @@ class BuildStrategy {
 class Edge;
 using EdgeId = const Edge*;
 
-// This exposes a `EdgesVector` as a iterable of `const Edge*`.
+// This exposes a contiguous range of `Edge`s as a iterable of `const Edge*`.
 class EdgesAdapter {
  public:
-  explicit EdgesAdapter(const std::vector<Edge>* edges) : m_edges(edges) {}
+  EdgesAdapter(const Edge* begin, const Edge* end)
+      : m_begin(begin), m_end(end) {}
 
   class iterator {
    public:
@@ -123,14 +124,38 @@ class EdgesAdapter {
     value_type m_current;
   };
 
-  iterator begin() const { return iterator(&*m_edges->begin()); }
+  iterator begin() const { return iterator(m_begin); }
 
-  iterator end() const { return iterator(&*m_edges->end()); }
+  iterator end() const { return iterator(m_end); }
 
-  size_t size() const { return m_edges->size(); }
+  size_t size() const;
+
+  bool empty() const { return m_begin == m_end; }
+
+ private:
+  const Edge* m_begin;
+  const Edge* m_end;
+};
+
+// This exposes a contiguous range of `EdgeId`s.
+class EdgeIdsAdapter {
+ public:
+  using iterator = const EdgeId*;
+
+  EdgeIdsAdapter(const EdgeId* begin, const EdgeId* end)
+      : m_begin(begin), m_end(end) {}
+
+  iterator begin() const { return m_begin; }
+
+  iterator end() const { return m_end; }
+
+  size_t size() const { return m_end - m_begin; }
+
+  bool empty() const { return m_begin == m_end; }
 
  private:
-  const std::vector<Edge>* m_edges;
+  const EdgeId* m_begin;
+  const EdgeId* m_end;
 };
 
 class Node final {
@@ -145,8 +170,12 @@ class Node final {
   explicit Node(NodeType type) : m_method(nullptr), m_type(type) {}
 
   const DexMethod* method() const { return m_method; }
-  const std::vector<const Edge*>& callers() const { return m_predecessors; }
-  EdgesAdapter callees() const { return EdgesAdapter(&m_successors); }
+  EdgeIdsAdapter callers() const {
+    return EdgeIdsAdapter(m_predecessors_begin, m_predecessors_end);
+  }
+  EdgesAdapter callees() const {
+    return EdgesAdapter(m_successors_begin, m_successors_end);
+  }
 
   bool is_entry() const { return m_type == GHOST_ENTRY; }
   bool is_exit() const { return m_type == GHOST_EXIT; }
@@ -157,8 +186,11 @@ class Node final {
 
  private:
   const DexMethod* m_method;
-  std::vector<const Edge*> m_predecessors;
-  std::vector<Edge> m_successors;
+  // The edges of a node are ranges within the edge arrays owned by the Graph.
+  const Edge* m_successors_begin{nullptr};
+  const Edge* m_successors_end{nullptr};
+  const EdgeId* m_predecessors_begin{nullptr};
+  const EdgeId* m_predecessors_end{nullptr};
   NodeType m_type;
 
   friend class Graph;
@@ -184,6 +216,8 @@ inline EdgesAdapter::iterator& EdgesAdapter::iterator::operator++() {
   return *this;
 }
 
+inline size_t EdgesAdapter::size() const { return m_end - m_begin; }
+
 class Graph final {
  public:
   explicit Graph(const BuildStrategy&);
@@ -225,6 +259,11 @@ class Graph final {
   std::unique_ptr<Node> m_entry;
   std::unique_ptr<Node> m_exit;
   InsertOnlyConcurrentMap<const DexMethod*, Node> m_nodes;
+  // Once built, the graph is stored in compressed sparse row form: the
+  // successor edges of all nodes are laid out contiguously, grouped by caller,
+  // and so are the predecessor edge ids, grouped by callee.
+  std::vector<Edge> m_edges;
+  std::vector<EdgeId> m_predecessor_edges;
   InsertOnlyConcurrentMap<const IRInstruction*,
                           std::unordered_set<const DexMethod*>>
       m_insn_to_callee;
@@ -311,8 +350,7 @@ class GraphInterface {
 
   static NodeId entry(const Graph& graph) { return graph.entry(); }
   static NodeId exit(const Graph& graph) { return graph.exit(); }
-  static const std::vector<const Edge*>& predecessors(const Graph&,
-                                                      const NodeId& m) {
+  static EdgeIdsAdapter predecessors(const Graph&, const NodeId& m) {
     return m->callers();
   }
   static EdgesAdapter successors(const Graph&, const NodeId& m) {
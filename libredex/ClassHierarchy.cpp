@@ -7,6 +7,8 @@
 
 #include "ClassHierarchy.h"
 
+#include <algorithm>
+
 #include "DexUtil.h"
 #include "RedexContext.h"
 #include "Resolver.h"
@@ -138,6 +140,87 @@ InterfaceMap build_interface_map(const ClassHierarchy& hierarchy) {
   return interfaces;
 }
 
+ClassHierarchyIndex::ClassHierarchyIndex(const ClassHierarchy& hierarchy,
+                                         const InterfaceMap* interfaces) {
+  // The roots are the types that are not a child of any other type.
+  std::unordered_set<const DexType*> children;
+  for (const auto& [_, direct] : hierarchy) {
+    children.insert(direct.begin(), direct.end());
+  }
+  std::vector<const DexType*> roots;
+  for (const auto& [type, _] : hierarchy) {
+    if (!children.count(type)) {
+      roots.push_back(type);
+    }
+  }
+  std::sort(roots.begin(), roots.end(), compare_dextypes);
+
+  // An iterative depth-first walk, as hierarchies can be deep. Every stack
+  // entry is a type whose subtree is being numbered, and the next child to
+  // visit.
+  std::vector<std::pair<const DexType*, TypeSet::const_iterator>> stack;
+  auto visit = [&](const DexType* type) {
+    auto [it, emplaced] = m_intervals.emplace(
+        type, Interval{(uint32_t)m_preorder.size(), 0});
+    always_assert_log(emplaced, "%s appears twice in the hierarchy",
+                      SHOW(type));
+    m_preorder.push_back(type);
+    stack.emplace_back(type, ::get_children(hierarchy, type).begin());
+  };
+  for (auto* root : roots) {
+    visit(root);
+    while (!stack.empty()) {
+      auto& [type, next_child] = stack.back();
+      if (next_child != ::get_children(hierarchy, type).end()) {
+        visit(*next_child++);
+        continue;
+      }
+      m_intervals.at(type).end = m_preorder.size();
+      stack.pop_back();
+    }
+  }
+
+  if (interfaces == nullptr) {
+    return;
+  }
+  for (const auto& [intf, implementors] : *interfaces) {
+    std::vector<uint32_t> positions;
+    positions.reserve(implementors.size());
+    for (auto* impl : implementors) {
+      auto it = m_intervals.find(impl);
+      if (it != m_intervals.end()) {
+        positions.push_back(it->second.begin);
+      }
+    }
+    std::sort(positions.begin(), positions.end());
+    auto& intervals = m_implementors[intf];
+    for (auto pos : positions) {
+      if (!intervals.empty() && intervals.back().end == pos) {
+        intervals.back().end++;
+      } else {
+        intervals.push_back(Interval{pos, pos + 1});
+      }
+    }
+    intervals.shrink_to_fit();
+  }
+}
+
+bool ClassHierarchyIndex::implements(const DexType* cls,
+                                     const DexType* intf) const {
+  auto cls_it = m_intervals.find(cls);
+  auto intf_it = m_implementors.find(intf);
+  if (cls_it == m_intervals.end() || intf_it == m_implementors.end()) {
+    return false;
+  }
+  auto pos = cls_it->second.begin;
+  const auto& intervals = intf_it->second;
+  // Find the last interval that begins at or before pos.
+  auto it = std::upper_bound(
+      intervals.begin(), intervals.end(), pos,
+      [](uint32_t p, const Interval& interval) { return p < interval.begin; });
+  return it != intervals.begin() && std::prev(it)->contains(pos);
+}
+
 const TypeSet& get_children(const ClassHierarchy& hierarchy,
                             const DexType* type) {
   const auto& it = hierarchy.find(type);
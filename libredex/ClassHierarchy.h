@@ -8,8 +8,10 @@
 #pragma once
 
 #include "DexClass.h"
+#include <boost/range/iterator_range.hpp>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 using TypeSet = std::set<const DexType*, dextypes_comparator>;
 
@@ -92,6 +94,77 @@ inline TypeSet get_all_implementors(const InterfaceMap& interfaces,
   return implementors->second;
 }
 
+/**
+ * A pre-order numbering of a ClassHierarchy, in which all the (transitive)
+ * children of a type follow it contiguously. This turns subclass checks into
+ * an interval containment, and makes all children of a type a range of the
+ * pre-order, without walking the hierarchy.
+ *
+ * Optionally, the implementors of every interface are kept as the sorted,
+ * disjoint intervals of the pre-order they cover. Since a class implementing
+ * an interface is followed by its children, which implement it too, there are
+ * typically far fewer intervals than implementors.
+ *
+ * The index is a snapshot of the hierarchy; it must be rebuilt when the
+ * hierarchy changes.
+ */
+class ClassHierarchyIndex {
+ public:
+  using TypeRange =
+      boost::iterator_range<std::vector<const DexType*>::const_iterator>;
+
+  explicit ClassHierarchyIndex(const ClassHierarchy& hierarchy,
+                               const InterfaceMap* interfaces = nullptr);
+
+  bool contains(const DexType* type) const {
+    return m_intervals.count(type) > 0;
+  }
+
+  /**
+   * Return true if child is a (transitive) child of, or equal to, parent.
+   */
+  bool is_subclass(const DexType* parent, const DexType* child) const {
+    auto parent_it = m_intervals.find(parent);
+    if (parent_it == m_intervals.end()) {
+      return false;
+    }
+    auto child_it = m_intervals.find(child);
+    return child_it != m_intervals.end() &&
+           parent_it->second.contains(child_it->second.begin);
+  }
+
+  /**
+   * All the (transitive) children of a type, excluding the type itself, in
+   * pre-order.
+   */
+  TypeRange get_all_children(const DexType* type) const {
+    auto it = m_intervals.find(type);
+    if (it == m_intervals.end()) {
+      return TypeRange(m_preorder.end(), m_preorder.end());
+    }
+    return TypeRange(m_preorder.begin() + it->second.begin + 1,
+                     m_preorder.begin() + it->second.end);
+  }
+
+  /**
+   * Return true if a given class implements a given interface, according to
+   * the InterfaceMap the index was built with.
+   */
+  bool implements(const DexType* cls, const DexType* intf) const;
+
+ private:
+  // The positions [begin, end) of a subtree in the pre-order.
+  struct Interval {
+    uint32_t begin;
+    uint32_t end;
+    bool contains(uint32_t pos) const { return begin <= pos && pos < end; }
+  };
+
+  std::vector<const DexType*> m_preorder;
+  std::unordered_map<const DexType*, Interval> m_intervals;
+  std::unordered_map<const DexType*, std::vector<Interval>> m_implementors;
+};
+
 /**
  * Helper to retrieve either the children of a concrete type or
  * all implementors of an interface.
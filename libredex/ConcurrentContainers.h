@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <boost/intrusive/pointer_plus_bits.hpp>
 #include <cstring>
 #include <functional>
@@ -14,12 +16,15 @@
 #include <iterator>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <stack>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
 #include "Debug.h"
+#include "HugePages.h"
 #include "Timer.h"
 
 namespace cc_impl {
@@ -49,6 +54,158 @@ class ConcurrentHashtableInsertionResult;
 
 size_t get_prime_number_greater_or_equal_to(size_t);
 
+/*
+ * Memory for the nodes of a ConcurrentHashtable, handed out from chunks of
+ * geometrically increasing size. Nodes are never freed individually; instead,
+ * the slots of destroyed nodes go on a free list for reuse, and all chunks are
+ * freed at once when the hashtable is cleared or destroyed. Allocating and
+ * releasing are thread-safe; an uncontended allocation is a single atomic
+ * increment.
+ */
+template <typename Node>
+class NodeArena final {
+ public:
+  NodeArena() = default;
+
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+
+  /*
+   * This operation is NOT thread-safe.
+   */
+  NodeArena(NodeArena&& other) noexcept { swap(other); }
+
+  ~NodeArena() { free_all(); }
+
+  /*
+   * This operation is always thread-safe. Returns uninitialized memory for a
+   * node.
+   */
+  void* allocate() {
+    // Checked here rather than at class scope, as the arena may be declared
+    // while the node's value type is still incomplete.
+    static_assert(sizeof(Node) >= sizeof(FreeSlot));
+    if (m_free.load(std::memory_order_relaxed) != nullptr) {
+      if (auto* slot = pop_free()) {
+        return slot;
+      }
+    }
+    auto* chunk = m_chunks.load(std::memory_order_acquire);
+    while (true) {
+      if (chunk != nullptr) {
+        auto index = chunk->used.fetch_add(1, std::memory_order_relaxed);
+        if (index < chunk->capacity) {
+          return chunk->slot(index);
+        }
+      }
+      auto* new_chunk = Chunk::create(
+          chunk == nullptr ? MIN_CHUNK_NODES
+                           : std::min(chunk->capacity * 2, MAX_CHUNK_NODES),
+          chunk);
+      if (m_chunks.compare_exchange_strong(chunk, new_chunk,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+        return new_chunk->slot(0);
+      }
+      // Another thread added a chunk first; use that one.
+      Chunk::destroy(new_chunk);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe. The node in the given slot must have
+   * been destroyed already.
+   */
+  void release(void* slot) {
+    auto* free_slot = static_cast<FreeSlot*>(slot);
+    lock();
+    free_slot->next = m_free.load(std::memory_order_relaxed);
+    m_free.store(free_slot, std::memory_order_relaxed);
+    unlock();
+  }
+
+  /*
+   * This operation is NOT thread-safe. All nodes must have been destroyed.
+   */
+  void free_all() {
+    for (auto* chunk = m_chunks.exchange(nullptr); chunk != nullptr;) {
+      auto* prev = chunk->prev;
+      Chunk::destroy(chunk);
+      chunk = prev;
+    }
+    m_free.store(nullptr);
+  }
+
+  /*
+   * This operation is NOT thread-safe.
+   */
+  void swap(NodeArena& other) {
+    m_chunks.store(other.m_chunks.exchange(m_chunks.load()));
+    m_free.store(other.m_free.exchange(m_free.load()));
+  }
+
+ private:
+  static constexpr size_t MIN_CHUNK_NODES = 4;
+  static constexpr size_t MAX_CHUNK_NODES = 4096;
+
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  struct Chunk {
+    Chunk* prev;
+    size_t capacity;
+    // May exceed the capacity, when threads race for the last slots.
+    std::atomic<size_t> used;
+
+    // The nodes follow the header, suitably aligned.
+    static constexpr size_t header_size() {
+      return (sizeof(Chunk) + alignof(Node) - 1) / alignof(Node) *
+             alignof(Node);
+    }
+
+    void* slot(size_t index) {
+      return reinterpret_cast<char*>(this) + header_size() +
+             index * sizeof(Node);
+    }
+
+    static Chunk* create(size_t capacity, Chunk* prev) {
+      auto* memory = ::operator new(
+          header_size() + capacity * sizeof(Node),
+          std::align_val_t(std::max(alignof(Node), alignof(Chunk))));
+      auto* chunk = new (memory) Chunk{prev, capacity, {1}};
+      return chunk;
+    }
+
+    static void destroy(Chunk* chunk) {
+      chunk->~Chunk();
+      ::operator delete(
+          chunk, std::align_val_t(std::max(alignof(Node), alignof(Chunk))));
+    }
+  };
+
+  void* pop_free() {
+    lock();
+    auto* slot = m_free.load(std::memory_order_relaxed);
+    if (slot != nullptr) {
+      m_free.store(slot->next, std::memory_order_relaxed);
+    }
+    unlock();
+    return slot;
+  }
+
+  void lock() {
+    while (m_free_lock.exchange(true, std::memory_order_acquire)) {
+    }
+  }
+
+  void unlock() { m_free_lock.store(false, std::memory_order_release); }
+
+  std::atomic<Chunk*> m_chunks{nullptr};
+  std::atomic<FreeSlot*> m_free{nullptr};
+  std::atomic<bool> m_free_lock{false};
+};
+
 /*
  * This ConcurrentHashtable supports inserting (and "emplacing"), getting (the
  * address of inserted key-value pairs), and erasing key-value pairs. There is
@@ -84,8 +241,18 @@ size_t get_prime_number_greater_or_equal_to(size_t);
  * or `compact` is called. This ensures that get always returns a valid
  * reference, even in the face of concurrent erasing.
  *
- * TODO: Right now, we use the (default) std::memory_order_seq_cst everywhere.
- * Acquire/release semantics should be sufficient.
+ * Nodes are allocated from a per-hashtable NodeArena, so that destroying (or
+ * clearing) a hashtable frees its memory in bulk. When the key-value pairs are
+ * trivially destructible, the nodes are not even visited.
+ *
+ * Memory ordering: Nodes and Storage versions are published with release
+ * stores (or compare-exchanges) of the pointers leading to them, and all loads
+ * of such pointers are acquire loads, so that a thread following a pointer
+ * sees the fully constructed node or storage. Resizing re-publishes nodes in
+ * the new storage version with release semantics as well, which carries over
+ * the visibility of their values to readers of the new version. The element
+ * count is only a (relaxed) heuristic for concurrent readers, and operations
+ * that are not thread-safe keep the default sequentially consistent ordering.
  */
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
 class ConcurrentHashtable final {
@@ -126,8 +293,8 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   iterator begin() {
-    auto* storage = m_storage.load();
-    auto* ptr = storage->ptrs[0].load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
+    auto* ptr = storage->ptrs[0].load(std::memory_order_acquire);
     return iterator(storage, 0, get_node(ptr));
   }
 
@@ -136,7 +303,7 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   iterator end() {
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     return iterator(storage, storage->size, nullptr);
   }
 
@@ -145,8 +312,8 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   const_iterator begin() const {
-    auto* storage = m_storage.load();
-    auto* ptr = storage->ptrs[0].load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
+    auto* ptr = storage->ptrs[0].load(std::memory_order_acquire);
     return const_iterator(storage, 0, get_node(ptr));
   }
 
@@ -155,7 +322,7 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   const_iterator end() const {
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     return const_iterator(storage, storage->size, nullptr);
   }
 
@@ -165,17 +332,17 @@ class ConcurrentHashtable final {
    */
   iterator find(const key_type& key) {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* ptrs = storage->ptrs;
     size_t i = hash % storage->size;
     auto* root_loc = &ptrs[i];
-    auto* root = root_loc->load();
+    auto* root = root_loc->load(std::memory_order_acquire);
     for (auto* ptr = root; ptr;) {
       auto* node = get_node(ptr);
       if (key_equal()(const_key_projection()(node->value), key)) {
         return iterator(storage, i, node);
       }
-      ptr = node->prev.load();
+      ptr = node->prev.load(std::memory_order_acquire);
     }
     return end();
   }
@@ -186,17 +353,17 @@ class ConcurrentHashtable final {
    */
   const_iterator find(const key_type& key) const {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* ptrs = storage->ptrs;
     size_t i = hash % storage->size;
     auto* root_loc = &ptrs[i];
-    auto* root = root_loc->load();
+    auto* root = root_loc->load(std::memory_order_acquire);
     for (auto* ptr = root; ptr;) {
       auto* node = get_node(ptr);
       if (key_equal()(const_key_projection()(node->value), key)) {
         return const_iterator(storage, i, node);
       }
-      ptr = node->prev.load();
+      ptr = node->prev.load(std::memory_order_acquire);
     }
     return end();
   }
@@ -204,7 +371,7 @@ class ConcurrentHashtable final {
   /*
    * This operation is always thread-safe.
    */
-  size_t size() const { return m_count.load(); }
+  size_t size() const { return m_count.load(std::memory_order_relaxed); }
 
   /*
    * This operation is always thread-safe.
@@ -220,6 +387,7 @@ class ConcurrentHashtable final {
       m_count.store(0);
     }
     compact();
+    m_arena.free_all();
   }
 
   ConcurrentHashtable() noexcept
@@ -243,7 +411,8 @@ class ConcurrentHashtable final {
   ConcurrentHashtable(ConcurrentHashtable&& container) noexcept
       : m_storage(container.m_storage.exchange(Storage::create())),
         m_count(container.m_count.exchange(0)),
-        m_erased(container.m_erased.exchange(nullptr)) {
+        m_erased(container.m_erased.exchange(nullptr)),
+        m_arena(std::move(container.m_arena)) {
     compact();
   }
 
@@ -255,6 +424,7 @@ class ConcurrentHashtable final {
     container.compact();
     m_storage.store(container.m_storage.exchange(m_storage.load()));
     m_count.store(container.m_count.exchange(0));
+    m_arena.swap(container.m_arena);
     return *this;
   }
 
@@ -280,6 +450,7 @@ class ConcurrentHashtable final {
     Storage::destroy(m_storage.exchange(nullptr));
     m_count.store(0);
     process_erased();
+    m_arena.free_all();
   }
 
   ~ConcurrentHashtable() { destroy(); }
@@ -289,18 +460,18 @@ class ConcurrentHashtable final {
    */
   value_type* get(const key_type& key) {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     do {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
           return &node->value;
         }
       }
-      storage = storage->next.load();
+      storage = storage->next.load(std::memory_order_acquire);
     } while (storage);
     return nullptr;
   }
@@ -310,18 +481,18 @@ class ConcurrentHashtable final {
    */
   const value_type* get(const key_type& key) const {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     do {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
           return &node->value;
         }
       }
-      storage = storage->next.load();
+      storage = storage->next.load(std::memory_order_acquire);
     } while (storage);
     return nullptr;
   }
@@ -333,19 +504,20 @@ class ConcurrentHashtable final {
   insertion_result try_emplace(const key_type& key, Args&&... args) {
     Node* new_node = nullptr;
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
-          return insertion_result(&node->value, new_node);
+          return insertion_result(&node->value, new_node, &m_arena);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -353,16 +525,18 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
         new_node =
-            new Node(ConstRefKeyArgsTag(), key, std::forward<Args>(args)...);
+            create_node(ConstRefKeyArgsTag(), key, std::forward<Args>(args)...);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -376,20 +550,21 @@ class ConcurrentHashtable final {
   insertion_result try_emplace(key_type&& key, Args&&... args) {
     Node* new_node = nullptr;
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     const key_type* key_ptr = &key;
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), *key_ptr)) {
-          return insertion_result(&node->value, new_node);
+          return insertion_result(&node->value, new_node, &m_arena);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -397,17 +572,20 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
-        new_node = new Node(RvalueRefKeyArgsTag(), std::forward<key_type>(key),
-                            std::forward<Args>(args)...);
+        new_node = create_node(RvalueRefKeyArgsTag(),
+                               std::forward<key_type>(key),
+                               std::forward<Args>(args)...);
         key_ptr = &const_key_projection()(new_node->value);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -420,20 +598,21 @@ class ConcurrentHashtable final {
   insertion_result try_insert(const value_type& value) {
     Node* new_node = nullptr;
     auto hash = hasher()(const_key_projection()(value));
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value),
                         const_key_projection()(value))) {
-          return insertion_result(&node->value, new_node);
+          return insertion_result(&node->value, new_node, &m_arena);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -441,15 +620,17 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
-        new_node = new Node(ConstRefValueTag(), value);
+        new_node = create_node(ConstRefValueTag(), value);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -462,22 +643,23 @@ class ConcurrentHashtable final {
   insertion_result try_insert(value_type&& value) {
     Node* new_node = nullptr;
     auto hash = hasher()(const_key_projection()(value));
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* value_ptr = &value;
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value),
                         const_key_projection()(*value_ptr))) {
           // We lost a race with an equivalent insertion
-          return insertion_result(&node->value, new_node);
+          return insertion_result(&node->value, new_node, &m_arena);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -485,17 +667,19 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
-        new_node =
-            new Node(RvalueRefValueTag(), std::forward<value_type>(value));
+        new_node = create_node(RvalueRefValueTag(),
+                               std::forward<value_type>(value));
         value_ptr = &new_node->value;
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -507,19 +691,21 @@ class ConcurrentHashtable final {
    */
   bool reserve(size_t capacity) {
     bool resizing = false;
-    if (!m_resizing.compare_exchange_strong(resizing, true)) {
+    if (!m_resizing.compare_exchange_strong(resizing, true,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
       return false;
     }
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     if (storage->size >= capacity) {
-      m_resizing.store(false);
+      m_resizing.store(false, std::memory_order_release);
       return true;
     }
     auto timer_scope = s_reserving.scope();
     auto new_capacity = get_prime_number_greater_or_equal_to(capacity);
     auto* ptrs = storage->ptrs;
     auto* new_storage = Storage::create(new_capacity, storage);
-    storage->next.store(new_storage);
+    storage->next.store(new_storage, std::memory_order_release);
     std::stack<std::atomic<Ptr>*> locs;
     for (size_t i = 0; i < storage->size; ++i) {
       std::atomic<Ptr>* loc = &ptrs[i];
@@ -527,7 +713,9 @@ class ConcurrentHashtable final {
       // fail due to a race with an insertion or erasure
       Ptr ptr = nullptr;
       Node* node = nullptr;
-      while (!loc->compare_exchange_strong(ptr, moved_or_lock(node))) {
+      while (!loc->compare_exchange_strong(ptr, moved_or_lock(node),
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
         node = get_node(ptr);
         ptr = node;
       }
@@ -537,26 +725,26 @@ class ConcurrentHashtable final {
       // Lets rewire the nodes from the back to the new storage version.
       locs.push(loc);
       auto* prev_loc = &node->prev;
-      auto* prev_ptr = prev_loc->load();
+      auto* prev_ptr = prev_loc->load(std::memory_order_acquire);
       while (prev_ptr) {
         loc = prev_loc;
         locs.push(loc);
         ptr = prev_ptr;
         node = get_node(ptr);
         prev_loc = &node->prev;
-        prev_ptr = prev_loc->load();
+        prev_ptr = prev_loc->load(std::memory_order_acquire);
       }
       while (!locs.empty()) {
         loc = locs.top();
         locs.pop();
-        ptr = loc->load();
+        ptr = loc->load(std::memory_order_acquire);
         node = get_node(ptr);
         prev_loc = &node->prev;
-        prev_ptr = prev_loc->load();
+        prev_ptr = prev_loc->load(std::memory_order_acquire);
         always_assert(prev_ptr == nullptr || is_moved_or_locked(prev_ptr));
         auto new_hash = hasher()(const_key_projection()(node->value));
         auto* new_loc = &new_storage->ptrs[new_hash % new_storage->size];
-        auto* new_ptr = new_loc->load();
+        auto* new_ptr = new_loc->load(std::memory_order_acquire);
         // Rewiring the node happens in three steps:
         do {
           // Assume there is no race with an erasure.
@@ -565,19 +753,23 @@ class ConcurrentHashtable final {
           // the new storage version. This is ultimately what we want it to be;
           // it might allow a racing read operation to scan irrelevant nodes,
           // but that is not a problem for correctness.
-          prev_loc->store(new_ptr);
+          prev_loc->store(new_ptr, std::memory_order_release);
           // 2. Wire up the current node pointer to be the first chain element
           // in the new storage version. This may fail due to a race with
           // another thread inserting into or erasing from the same chain. But
           // then we'll just retry.
-        } while (!new_loc->compare_exchange_strong(new_ptr, node));
+        } while (!new_loc->compare_exchange_strong(new_ptr,
+                                                   node,
+                                                   std::memory_order_release,
+                                                   std::memory_order_acquire));
         // 3. Detach the current node pointer from the end of the old chain.
-        loc->store(moved());
+        loc->store(moved(), std::memory_order_release);
       }
     }
-    auto* old_storage = m_storage.exchange(new_storage);
+    auto* old_storage =
+        m_storage.exchange(new_storage, std::memory_order_acq_rel);
     always_assert(old_storage == storage);
-    m_resizing.store(false);
+    m_resizing.store(false, std::memory_order_release);
     return true;
   }
 
@@ -586,16 +778,16 @@ class ConcurrentHashtable final {
    */
   value_type* erase(const key_type& key) {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       if (root == nullptr) {
         return nullptr;
       }
       if (root == moved()) {
-        storage = storage->next.load();
+        storage = storage->next.load(std::memory_order_acquire);
         continue;
       }
       // The chain is not empty. Try to lock the bucket. This might fail due
@@ -603,25 +795,40 @@ class ConcurrentHashtable final {
       auto* node = get_node(root);
       always_assert(node);
       root = node;
-      if (!root_loc->compare_exchange_strong(root, lock(node))) {
+      if (!root_loc->compare_exchange_strong(root, lock(node),
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
         continue;
       }
       auto* loc = root_loc;
       for (; node && !key_equal()(const_key_projection()(node->value), key);
-           loc = &node->prev, node = get_node(loc->load())) {
+           loc = &node->prev,
+           node = get_node(loc->load(std::memory_order_acquire))) {
       }
       if (node) {
         // Erase node.
-        loc->store(node->prev.load());
-        m_count.fetch_sub(1);
+        loc->store(node->prev.load(std::memory_order_acquire),
+                   std::memory_order_release);
+        m_count.fetch_sub(1, std::memory_order_relaxed);
         // Store erased node for later actual deletion.
         auto* erased = new Erased{node, nullptr};
-        while (!m_erased.compare_exchange_strong(erased->prev, erased)) {
+        while (!m_erased.compare_exchange_strong(erased->prev, erased,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
         }
       }
       if (loc != root_loc) {
         // Unlock root node (as we didn't erase it).
-        root_loc->store(root);
+        root_loc->store(root, std::memory_order_release);
+      }
+      if (!node) {
+        // An insertion that raced with another erasure while we were resizing
+        // might have gone to the next storage version.
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
+          storage = next_storage;
+          continue;
+        }
       }
       return node ? &node->value : nullptr;
     }
@@ -710,6 +917,11 @@ class ConcurrentHashtable final {
       always_assert(bytes % sizeof(size_t) == 0);
       auto* storage = (Storage*)calloc(bytes / sizeof(size_t), sizeof(size_t));
       always_assert(storage);
+      if (bytes >= huge_pages::HUGE_PAGE_SIZE) {
+        // Large tables are mapped fresh, so this happens before the pages
+        // are touched.
+        huge_pages::advise(storage, bytes);
+      }
       always_assert(storage->prev == nullptr);
       storage->size = size;
       storage->prev = prev;
@@ -718,15 +930,17 @@ class ConcurrentHashtable final {
 
     static Storage* create() { return create(INITIAL_SIZE, nullptr); }
 
+    // Destroys the nodes, but leaves freeing their memory to the NodeArena.
     static void destroy(Storage* t) {
       for (auto* s = t; s; s = t) {
-        if (s->next.load() == nullptr) {
+        if (!std::is_trivially_destructible_v<Node> &&
+            s->next.load() == nullptr) {
           for (size_t i = 0; i < s->size; i++) {
             auto* loc = &s->ptrs[i];
             auto* ptr = loc->load();
             for (auto* node = get_node(ptr); node; node = get_node(ptr)) {
               ptr = node->prev.load();
-              delete node;
+              node->~Node();
             }
           }
         }
@@ -744,9 +958,22 @@ class ConcurrentHashtable final {
     Erased* prev;
   };
   std::atomic<Erased*> m_erased;
+  NodeArena<Node> m_arena;
+
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
+    auto* slot = m_arena.allocate();
+    try {
+      return new (slot) Node(std::forward<Args>(args)...);
+    } catch (...) {
+      m_arena.release(slot);
+      throw;
+    }
+  }
 
   bool load_factor_exceeded(const Storage* storage) const {
-    return m_count.load() > storage->size * LOAD_FACTOR;
+    return m_count.load(std::memory_order_relaxed) >
+           storage->size * LOAD_FACTOR;
   }
 
   // Whether more elements can be found in the next Storage version, or if an
@@ -787,7 +1014,8 @@ class ConcurrentHashtable final {
 
   void process_erased() {
     for (auto* erased = m_erased.load(); erased != nullptr;) {
-      delete erased->node;
+      erased->node->~Node();
+      m_arena.release(erased->node);
       auto* prev = erased->prev;
       delete erased;
       erased = prev;
@@ -815,11 +1043,25 @@ template <typename ConcurrentHashtable>
 class ConcurrentHashtableInsertionResult final {
   using value_type = typename ConcurrentHashtable::value_type;
   using Node = typename ConcurrentHashtable::Node;
-  std::unique_ptr<Node> m_node;
+  // Destroys an incidentally constructed node, and returns its slot.
+  struct NodeDeleter {
+    NodeArena<Node>* arena;
+    void operator()(Node* node) const {
+      node->~Node();
+      arena->release(node);
+    }
+  };
+  std::unique_ptr<Node, NodeDeleter> m_node;
   explicit ConcurrentHashtableInsertionResult(value_type* stored_value_ptr)
-      : stored_value_ptr(stored_value_ptr), success(true) {}
-  ConcurrentHashtableInsertionResult(value_type* stored_value_ptr, Node* node)
-      : m_node(node), stored_value_ptr(stored_value_ptr), success(false) {}
+      : m_node(nullptr, NodeDeleter{nullptr}),
+        stored_value_ptr(stored_value_ptr),
+        success(true) {}
+  ConcurrentHashtableInsertionResult(value_type* stored_value_ptr,
+                                     Node* node,
+                                     NodeArena<Node>* arena)
+      : m_node(node, NodeDeleter{arena}),
+        stored_value_ptr(stored_value_ptr),
+        success(false) {}
 
  public:
   value_type* stored_value_ptr;
@@ -7,11 +7,16 @@
 
 #include "ConfigFiles.h"
 
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <json/json.h>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "BaselineProfileConfig.h"
@@ -21,6 +26,8 @@
 #include "InlinerConfig.h"
 #include "MethodProfiles.h"
 #include "ProguardMap.h"
+#include "Timer.h"
+#include "Trace.h"
 
 using namespace std::string_literals;
 
@@ -112,8 +119,94 @@ ConfigFiles::ConfigFiles(const Json::Value& config, const std::string& outdir)
 
 ConfigFiles::ConfigFiles(const Json::Value& config) : ConfigFiles(config, "") {}
 
+struct ConfigFiles::Prefetch {
+  std::mutex mutex;
+  std::atomic<bool> pending{false};
+  std::vector<std::thread> threads;
+  // One slot per thread, so that threads do not need to synchronize.
+  std::vector<std::exception_ptr> errors;
+};
+
 ConfigFiles::~ConfigFiles() {
   // Here so that we can use `unique_ptr` to hide full class defs in the header.
+  if (m_prefetch != nullptr) {
+    for (auto& thread : m_prefetch->threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+}
+
+void ConfigFiles::prefetch() {
+  always_assert(m_prefetch == nullptr);
+  m_prefetch = std::make_unique<Prefetch>();
+
+  // Each task only touches its own members. The tasks must not call the
+  // public getters, which would wait for themselves.
+  std::vector<std::function<void()>> tasks;
+  if (!m_class_frequency_filename.empty()) {
+    tasks.emplace_back(
+        [this]() { m_class_freq_map = load_class_frequencies(); });
+  }
+  // The class lists include the coldstart classes, so load them together.
+  tasks.emplace_back([this]() {
+    ensure_coldstart_classes_loaded();
+    m_coldstart_methods = load_coldstart_methods();
+    m_load_class_lists_attempted = true;
+    m_class_lists = load_class_lists();
+  });
+  if (m_json.contains("dead_class_list")) {
+    tasks.emplace_back(
+        [this]() { build_dead_class_and_live_class_split_lists(); });
+  }
+  if (m_json.contains("agg_method_stats_files")) {
+    // Profiled methods that are not loaded yet end up as unresolved lines,
+    // see process_unresolved_method_profile_lines.
+    tasks.emplace_back([this]() { ensure_agg_method_stats_loaded(); });
+  }
+
+  TRACE(MAIN, 1, "Prefetching config files on %zu threads", tasks.size());
+  m_prefetch->errors.resize(tasks.size());
+  m_prefetch->pending = true;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    m_prefetch->threads.emplace_back([this, i, task = std::move(tasks[i])]() {
+      try {
+        task();
+      } catch (...) {
+        m_prefetch->errors[i] = std::current_exception();
+      }
+    });
+  }
+}
+
+void ConfigFiles::wait_for_prefetch() const {
+  if (m_prefetch == nullptr ||
+      !m_prefetch->pending.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(m_prefetch->mutex);
+    if (!m_prefetch->pending.load(std::memory_order_relaxed)) {
+      return;
+    }
+    Timer t("Waiting for config file prefetch");
+    for (auto& thread : m_prefetch->threads) {
+      thread.join();
+    }
+    m_prefetch->threads.clear();
+    for (auto& e : m_prefetch->errors) {
+      if (e != nullptr && error == nullptr) {
+        error = e;
+      }
+    }
+    m_prefetch->errors.clear();
+    m_prefetch->pending.store(false, std::memory_order_release);
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
 }
 
 /**
@@ -380,19 +473,21 @@ ConfigFiles::load_class_lists() {
     }
   }
 
-  lists["secondary_dex_head.list"] = get_coldstart_classes();
+  lists["secondary_dex_head.list"] = ensure_coldstart_classes_loaded();
 
   return lists;
 }
 
 const std::unordered_map<std::string, ConfigFiles::DeadClassLoadCounts>&
 ConfigFiles::get_dead_class_list() {
+  wait_for_prefetch();
   build_dead_class_and_live_class_split_lists();
   return m_dead_classes;
 }
 
 const std::unordered_set<std::string>&
 ConfigFiles::get_live_class_split_list() {
+  wait_for_prefetch();
   build_dead_class_and_live_class_split_lists();
   return m_live_relocated_classes;
 }
@@ -504,6 +599,8 @@ void ConfigFiles::load_inliner_config(inliner::InlinerConfig* inliner_config) {
   jw.get("max_cost_for_constant_propagation",
          MAX_COST_FOR_CONSTANT_PROPAGATION,
          inliner_config->max_cost_for_constant_propagation);
+  jw.get("max_call_site_summaries_per_callee", (size_t)0,
+         inliner_config->max_call_site_summaries_per_callee);
   jw.get("enforce_method_size_limit",
          true,
          inliner_config->enforce_method_size_limit);
@@ -677,6 +774,7 @@ void ConfigFiles::load(const Scope& scope) {
 }
 
 void ConfigFiles::process_unresolved_method_profile_lines() {
+  wait_for_prefetch();
   ensure_agg_method_stats_loaded();
   m_method_profiles->process_unresolved_lines();
 }
@@ -50,8 +50,26 @@ struct ConfigFiles {
   ConfigFiles(const Json::Value& config, const std::string& outdir);
   ~ConfigFiles();
 
+  /**
+   * Starts loading the class frequencies, coldstart classes and methods, class
+   * lists, dead class lists and method profiles that are configured on
+   * background threads, so that reading them overlaps with other startup work
+   * like ProGuard parsing and dex loading. The getters below wait for the
+   * prefetch to finish, so callers do not need to care whether it was started.
+   *
+   * Must be called at most once, before the getters may be used concurrently.
+   */
+  void prefetch();
+
+  /**
+   * Waits for a prefetch started with prefetch() to finish, and rethrows the
+   * first error it ran into. Does nothing if there is none pending.
+   */
+  void wait_for_prefetch() const;
+
   const std::unordered_map<const DexString*, std::vector<uint8_t>>&
   get_class_frequencies() {
+    wait_for_prefetch();
     if (m_class_freq_map.empty()) {
       m_class_freq_map = load_class_frequencies();
     }
@@ -59,6 +77,7 @@ struct ConfigFiles {
   }
 
   const std::vector<std::string>& get_interactions() {
+    wait_for_prefetch();
     if (m_interactions.empty()) {
       load_class_frequencies();
     }
@@ -66,13 +85,12 @@ struct ConfigFiles {
   }
 
   const std::vector<std::string>& get_coldstart_classes() {
-    if (m_coldstart_classes.empty()) {
-      m_coldstart_classes = load_coldstart_classes();
-    }
-    return m_coldstart_classes;
+    wait_for_prefetch();
+    return ensure_coldstart_classes_loaded();
   }
 
   const std::vector<std::string>& get_coldstart_methods() {
+    wait_for_prefetch();
     if (m_coldstart_methods.empty()) {
       m_coldstart_methods = load_coldstart_methods();
     }
@@ -84,10 +102,12 @@ struct ConfigFiles {
    */
   void update_coldstart_classes(
       std::vector<std::string> new_coldstart_classes) {
+    wait_for_prefetch();
     m_coldstart_classes = std::move(new_coldstart_classes);
   }
 
   void ensure_class_lists_loaded() {
+    wait_for_prefetch();
     if (!m_load_class_lists_attempted) {
       m_load_class_lists_attempted = true;
       m_class_lists = load_class_lists();
@@ -131,17 +151,20 @@ struct ConfigFiles {
   const std::unordered_set<std::string>& get_live_class_split_list();
 
   void clear_dead_class_and_live_relocated_sets() {
+    wait_for_prefetch();
     m_dead_class_list_attempted = false;
     m_dead_classes.clear();
     m_live_relocated_classes.clear();
   }
 
   method_profiles::MethodProfiles& get_method_profiles() {
+    wait_for_prefetch();
     ensure_agg_method_stats_loaded();
     return *m_method_profiles;
   }
 
   const method_profiles::MethodProfiles& get_method_profiles() const {
+    wait_for_prefetch();
     ensure_agg_method_stats_loaded();
     return *m_method_profiles;
   }
@@ -247,6 +270,13 @@ struct ConfigFiles {
 
   std::vector<std::string> load_coldstart_methods();
   std::vector<std::string> load_coldstart_classes();
+  // Does not wait for a pending prefetch, as the prefetch itself uses it.
+  const std::vector<std::string>& ensure_coldstart_classes_loaded() {
+    if (m_coldstart_classes.empty()) {
+      m_coldstart_classes = load_coldstart_classes();
+    }
+    return m_coldstart_classes;
+  }
   std::unordered_map<const DexString*, std::vector<uint8_t>>
   load_class_frequencies();
   std::unordered_map<std::string, std::string> load_qpl_interactions_map();
@@ -259,6 +289,10 @@ struct ConfigFiles {
   void remove_relocated_part(std::string_view* name);
   void build_cls_interdex_groups();
 
+  struct Prefetch;
+  // Set up by prefetch(), on the main thread, and kept alive afterwards.
+  std::unique_ptr<Prefetch> m_prefetch;
+
   // For testing.
   void set_class_lists(
       std::unordered_map<std::string, std::vector<std::string>> l);
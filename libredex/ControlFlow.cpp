@@ -8,10 +8,13 @@
 #include "ControlFlow.h"
 
 #include <boost/dynamic_bitset.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <iterator>
+#include <mutex>
 #include <queue>
 #include <stack>
+#include <unordered_map>
 #include <utility>
 
 #include "CppUtil.h"
@@ -1128,6 +1131,7 @@ std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
       b->free();
       delete b;
       it = m_blocks.erase(it);
+      ++m_structural_version;
     } else {
       ++it;
     }
@@ -1250,6 +1254,7 @@ void ControlFlowGraph::remove_empty_blocks() {
 
       if (b == entry_block()) {
         m_entry_block = succ;
+        ++m_structural_version;
       }
 
       // Move positions if succ doesn't have any
@@ -1297,6 +1302,7 @@ void ControlFlowGraph::remove_empty_blocks() {
     b->free();
     delete b;
     it = m_blocks.erase(it);
+    ++m_structural_version;
   }
   fix_dangling_parents(std::move(dangling));
 }
@@ -1768,12 +1774,17 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
 
   // copy the code itself
   MethodItemEntryCloner cloner;
+  std::unordered_map<const Block*, Block*> old_block_to_new;
+  old_block_to_new.reserve(this->m_blocks.size());
   for (const auto& entry : this->m_blocks) {
     const Block* block = entry.second;
     // this shallowly copies edge pointers inside, then we patch them later
     Block* new_block = new Block(*block, &cloner);
     new_block->m_parent = new_cfg;
-    new_cfg->m_blocks.emplace(new_block->id(), new_block);
+    // The blocks are visited in order of their ids.
+    new_cfg->m_blocks.emplace_hint(new_cfg->m_blocks.end(), new_block->id(),
+                                   new_block);
+    old_block_to_new.emplace(block, new_block);
   }
   // We need a second pass because parent position pointers may refer to
   // positions in a block that would be processed later.
@@ -1792,14 +1803,14 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
 
   // patch the block pointers in the edges to their new cfg counterparts
   for (Edge* e : new_cfg->m_edges) {
-    e->set_src(new_cfg->m_blocks.at(e->src()->id()));
-    e->set_target(new_cfg->m_blocks.at(e->target()->id()));
+    e->set_src(old_block_to_new.at(e->src()));
+    e->set_target(old_block_to_new.at(e->target()));
   }
 
   // update the entry and exit block pointers to their new cfg counterparts
-  new_cfg->m_entry_block = new_cfg->m_blocks.at(this->m_entry_block->id());
+  new_cfg->m_entry_block = old_block_to_new.at(this->m_entry_block);
   if (this->m_exit_block != nullptr) {
-    new_cfg->m_exit_block = new_cfg->m_blocks.at(this->m_exit_block->id());
+    new_cfg->m_exit_block = old_block_to_new.at(this->m_exit_block);
   }
 }
 
@@ -2289,12 +2300,154 @@ std::vector<Block*> ControlFlowGraph::blocks_reverse_post_deprecated() const {
 
 ControlFlowGraph::~ControlFlowGraph() {
   free_all_blocks_and_edges_and_removed_insns();
+  delete m_structural_cache.load();
+}
+
+struct ControlFlowGraph::StructuralCache {
+  struct Entry {
+    uint64_t version;
+    std::shared_ptr<const void> data;
+  };
+  struct CodeEntry {
+    uint64_t version;
+    uint64_t epoch;
+    std::size_t fingerprint;
+    std::weak_ptr<const void> data;
+  };
+  std::mutex lock;
+  std::unordered_map<std::type_index, Entry> entries;
+  std::unordered_map<std::type_index, CodeEntry> code_entries;
+};
+
+ControlFlowGraph::StructuralCache& ControlFlowGraph::structural_cache() const {
+  auto* cache = m_structural_cache.load(std::memory_order_acquire);
+  if (cache == nullptr) {
+    auto* fresh = new StructuralCache();
+    if (m_structural_cache.compare_exchange_strong(cache, fresh,
+                                                   std::memory_order_acq_rel)) {
+      cache = fresh;
+    } else {
+      delete fresh;
+    }
+  }
+  return *cache;
+}
+
+std::shared_ptr<const void> ControlFlowGraph::get_structural_data(
+    std::type_index tag,
+    const std::function<std::shared_ptr<const void>()>& compute) const {
+  auto& cache = structural_cache();
+  {
+    std::lock_guard<std::mutex> lock(cache.lock);
+    auto it = cache.entries.find(tag);
+    if (it != cache.entries.end() &&
+        it->second.version == m_structural_version) {
+      return it->second.data;
+    }
+  }
+  // Compute without holding the lock, as the computation may itself query
+  // other structural data of this CFG. Racing computations of the same data
+  // are benign; the last one wins.
+  auto data = compute();
+  std::lock_guard<std::mutex> lock(cache.lock);
+  cache.entries[tag] = {m_structural_version, data};
+  return data;
+}
+
+std::shared_ptr<const void> ControlFlowGraph::get_code_data(
+    std::type_index tag,
+    const std::function<std::shared_ptr<const void>()>& compute) const {
+  auto& cache = structural_cache();
+  auto epoch = hashing::cached_hashes_epoch();
+  auto fingerprint = code_fingerprint();
+  {
+    std::lock_guard<std::mutex> lock(cache.lock);
+    auto it = cache.code_entries.find(tag);
+    if (it != cache.code_entries.end() &&
+        it->second.version == m_structural_version &&
+        it->second.epoch == epoch && it->second.fingerprint == fingerprint) {
+      auto data = it->second.data.lock();
+      if (data) {
+        return data;
+      }
+    }
+  }
+  auto data = compute();
+  std::lock_guard<std::mutex> lock(cache.lock);
+  cache.code_entries[tag] = {m_structural_version, epoch, fingerprint, data};
+  return data;
+}
+
+std::size_t ControlFlowGraph::code_fingerprint() const {
+  std::size_t result = m_blocks.size();
+  for (const auto& [id, b] : m_blocks) {
+    const Block* block = b;
+    boost::hash_combine(result, id);
+    for (const auto& mie : ir_list::ConstInstructionIterable(block)) {
+      const auto* insn = mie.insn;
+      boost::hash_combine(result, insn);
+      boost::hash_combine(result, insn->opcode());
+      if (insn->has_dest()) {
+        boost::hash_combine(result, insn->dest());
+      }
+      for (auto src : insn->srcs()) {
+        boost::hash_combine(result, src);
+      }
+      switch (opcode::ref(insn->opcode())) {
+      case opcode::Ref::None:
+        break;
+      case opcode::Ref::Literal:
+        boost::hash_combine(result, insn->get_literal());
+        break;
+      case opcode::Ref::String:
+        boost::hash_combine(result, insn->get_string());
+        break;
+      case opcode::Ref::Type:
+        boost::hash_combine(result, insn->get_type());
+        break;
+      case opcode::Ref::Field:
+        boost::hash_combine(result, insn->get_field());
+        break;
+      case opcode::Ref::Method:
+        boost::hash_combine(result, insn->get_method());
+        break;
+      case opcode::Ref::CallSite:
+        boost::hash_combine(result, insn->get_callsite());
+        break;
+      case opcode::Ref::MethodHandle:
+        boost::hash_combine(result, insn->get_methodhandle());
+        break;
+      case opcode::Ref::Proto:
+        boost::hash_combine(result, insn->get_proto());
+        break;
+      case opcode::Ref::Data: {
+        const auto* data = insn->get_data();
+        boost::hash_range(result, data->data(),
+                          data->data() + data->data_size());
+        break;
+      }
+      }
+    }
+    for (const auto* edge : block->succs()) {
+      boost::hash_combine(result, edge->target()->id());
+      boost::hash_combine(result, edge->type());
+      if (edge->case_key()) {
+        boost::hash_combine(result, *edge->case_key());
+      }
+      if (edge->type() == EDGE_THROW) {
+        boost::hash_combine(result, edge->throw_info()->catch_type);
+        boost::hash_combine(result, edge->throw_info()->index);
+      }
+    }
+  }
+  return result;
 }
 
 Block* ControlFlowGraph::create_block() {
   size_t id = next_block_id();
   Block* b = new Block(this, id);
   m_blocks.emplace(id, b);
+  ++m_structural_version;
   return b;
 }
 
@@ -2465,6 +2618,7 @@ void ControlFlowGraph::calculate_exit_block() {
 
   std::vector<Block*> exit_blocks = collectExitBlocks(entry_block());
 
+  ++m_structural_version;
   if (exit_blocks.size() == 1) {
     m_exit_block = exit_blocks[0];
   } else {
@@ -2481,6 +2635,7 @@ void ControlFlowGraph::reset_exit_block() {
   }
   if (get_pred_edge_of_type(m_exit_block, EDGE_GHOST) == nullptr) {
     m_exit_block = nullptr;
+    ++m_structural_version;
     return;
   }
   // If we get here, we have a "ghost" exit block, that was created to represent
@@ -2558,6 +2713,7 @@ void ControlFlowGraph::clear() {
 
   m_entry_block = nullptr;
   m_exit_block = nullptr;
+  ++m_structural_version;
 
   m_editable = true;
 }
@@ -2747,6 +2903,7 @@ void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
   delete_pred_edges(succ);
   delete_succ_edges(succ);
   m_blocks.erase(succ->id());
+  ++m_structural_version;
   delete succ;
 }
 
@@ -3104,6 +3261,7 @@ uint32_t ControlFlowGraph::remove_blocks(const std::vector<Block*>& blocks) {
     auto num_removed = m_blocks.erase(id);
     always_assert_log(num_removed == 1,
                       "Block %zu wasn't in CFG. Attempted double delete?", id);
+    ++m_structural_version;
     block->m_entries.clear_and_dispose();
     delete block;
   }
@@ -3299,6 +3457,22 @@ bool ControlFlowGraph::structural_equals(
   return true;
 }
 
+std::size_t ControlFlowGraph::structural_hash() const {
+  std::size_t result = num_blocks();
+  for (const auto* block : blocks()) {
+    std::size_t block_hash = block->preds().size();
+    boost::hash_combine(block_hash, block->succs().size());
+    for (const auto& mie : ir_list::ConstInstructionIterable(block)) {
+      boost::hash_combine(block_hash, mie.insn->hash());
+    }
+    // Blocks are combined commutatively, as their order is not structural.
+    std::size_t mixed = 0;
+    boost::hash_combine(mixed, block_hash);
+    result += mixed;
+  }
+  return result;
+}
+
 DexPosition* ControlFlowGraph::get_dbg_pos(const cfg::InstructionIterator& it) {
   always_assert(&it.cfg() == this);
   auto search_block = [](Block* b,
@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <type_traits>
+#include <typeindex>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -137,9 +141,10 @@ class Edge final {
   Block* m_src;
   Block* m_target;
   union {
-    // If `m_type` is EDGE_THROW then this union points to a ThrowInfo
-    // Edge owns this ThrowInfo and is responsible for deleting it.
-    ThrowInfo* m_throw_info;
+    // If `m_type` is EDGE_THROW then this union holds the ThrowInfo. It is
+    // stored inline, as throw edges are common enough that a separate
+    // allocation for each of them shows up in CFG construction and copies.
+    ThrowInfo m_throw_info;
     // If `m_type` is not EDGE_THROW then this union is an optional case key.
     // If this edge is a non-default outgoing edge of a OPCODE_SWITCH, then
     // this is not `boost::none`.
@@ -161,7 +166,7 @@ class Edge final {
   Edge(Block* src, Block* target, DexType* catch_type, uint32_t index)
       : m_src(src),
         m_target(target),
-        m_throw_info(new ThrowInfo(catch_type, index)),
+        m_throw_info(catch_type, index),
         m_type(EDGE_THROW) {}
 
   /*
@@ -170,15 +175,9 @@ class Edge final {
    */
   Edge(const Edge& e) : m_src(e.m_src), m_target(e.m_target), m_type(e.m_type) {
     if (m_type == EDGE_THROW) {
-      m_throw_info = new ThrowInfo(*e.throw_info());
+      new (&m_throw_info) ThrowInfo(e.m_throw_info);
     } else {
-      m_case_key = e.case_key();
-    }
-  }
-
-  ~Edge() {
-    if (m_type == EDGE_THROW) {
-      delete m_throw_info;
+      new (&m_case_key) MaybeCaseKey(e.m_case_key);
     }
   }
 
@@ -201,8 +200,7 @@ class Edge final {
     if (m_type != that.m_type) {
       return false;
     } else if (m_type == EDGE_THROW) {
-      return (throw_info() == nullptr && that.throw_info() == nullptr) ||
-             *throw_info() == *that.throw_info();
+      return *throw_info() == *that.throw_info();
     } else {
       return case_key() == that.case_key();
     }
@@ -214,7 +212,7 @@ class Edge final {
   EdgeType type() const { return m_type; }
   ThrowInfo* throw_info() const {
     always_assert(m_type == EDGE_THROW);
-    return m_throw_info;
+    return const_cast<ThrowInfo*>(&m_throw_info);
   }
   const MaybeCaseKey& case_key() const {
     always_assert(m_type != EDGE_THROW);
@@ -333,6 +331,9 @@ class Block final {
   // returns true if there are no MethodItemEntries (not IRInstructions)
   bool empty() const { return m_entries.empty(); }
 
+  // The number of MethodItemEntries, in constant time.
+  size_t num_entries() const { return m_entries.size(); }
+
   uint32_t num_opcodes() const;
 
   uint32_t sum_opcode_sizes() const;
@@ -534,8 +535,14 @@ class ControlFlowGraph {
 
   Block* entry_block() const { return m_entry_block; }
   Block* exit_block() const { return m_exit_block; }
-  void set_entry_block(Block* b) { m_entry_block = b; }
-  void set_exit_block(Block* b) { m_exit_block = b; }
+  void set_entry_block(Block* b) {
+    m_entry_block = b;
+    ++m_structural_version;
+  }
+  void set_exit_block(Block* b) {
+    m_exit_block = b;
+    ++m_structural_version;
+  }
   void reset_exit_block();
 
   /*
@@ -567,6 +574,7 @@ class ControlFlowGraph {
   }
 
   void add_edge(Edge* e) {
+    ++m_structural_version;
     m_edges.insert(e);
     e->src()->m_succs.emplace_back(e);
     e->target()->m_preds.emplace_back(e);
@@ -1053,6 +1061,48 @@ class ControlFlowGraph {
   bool structural_equals(const ControlFlowGraph& other,
                          const InstructionEquality& instruction_equals) const;
 
+  // A hash that is consistent with structural_equals: it is independent of
+  // the block ids and order, but sensitive to the order of instructions
+  // within blocks, and to the number of edges of every block.
+  std::size_t structural_hash() const;
+
+  // Incremented whenever blocks or edges are added or removed, or the entry or
+  // exit block changes. Instruction edits within blocks don't count.
+  uint64_t structural_version() const { return m_structural_version; }
+
+  /*
+   * Returns data that is derived only from the block and edge structure of this
+   * CFG, e.g. a weak partial ordering of its blocks, or its dominator tree.
+   * The data is computed by `compute` (which returns a std::shared_ptr<const
+   * T>) at most once per structural version, and is shared by all the callers
+   * asking for the same `Tag` until the CFG changes structurally. This is
+   * thread-safe, as long as the CFG isn't being mutated at the same time.
+   */
+  template <typename Tag, typename T, typename Compute>
+  std::shared_ptr<const T> get_structural_data(const Compute& compute) const {
+    return std::static_pointer_cast<const T>(
+        get_structural_data(typeid(Tag), [&compute]() {
+          return std::shared_ptr<const void>(compute());
+        }));
+  }
+
+  /*
+   * Like get_structural_data, but for data that also depends on the
+   * instructions, e.g. the result of a type inference. Such data tends to be
+   * large, so only a weak reference is kept: the data is shared by all callers
+   * asking for the same `Tag` while any of them holds on to it. It is
+   * recomputed when the structure or any instruction or edge changed, as
+   * detected by a fingerprint, or when a scope-wide mutation like a rename
+   * happened (see hashing::cached_hashes_epoch()).
+   */
+  template <typename Tag, typename T, typename Compute>
+  std::shared_ptr<const T> get_code_data(const Compute& compute) const {
+    return std::static_pointer_cast<const T>(
+        get_code_data(typeid(Tag), [&compute]() {
+          return std::shared_ptr<const void>(compute());
+        }));
+  }
+
  private:
   friend class Block;
 
@@ -1171,6 +1221,7 @@ class ControlFlowGraph {
                          Block* target,
                          EdgePredicate predicate,
                          bool cleanup = true) {
+    ++m_structural_version;
     auto& forward_edges = source->m_succs;
     EdgeSet to_remove;
     forward_edges.erase(
@@ -1204,6 +1255,7 @@ class ControlFlowGraph {
                               const ForwardIt& end,
                               EdgePredicate predicate,
                               bool cleanup = true) {
+    ++m_structural_version;
     std::unordered_set<Block*> source_blocks;
     EdgeSet to_remove;
     for (auto it = begin; it != end; it++) {
@@ -1242,6 +1294,7 @@ class ControlFlowGraph {
                               const ForwardIt& end,
                               EdgePredicate predicate,
                               bool cleanup = true) {
+    ++m_structural_version;
     std::unordered_set<Block*> target_blocks;
     std::unordered_set<Edge*> to_remove;
     for (auto it = begin; it != end; it++) {
@@ -1304,6 +1357,22 @@ class ControlFlowGraph {
 
   std::vector<Block*> blocks_post_helper(bool reverse) const;
 
+  struct StructuralCache;
+
+  StructuralCache& structural_cache() const;
+
+  std::shared_ptr<const void> get_structural_data(
+      std::type_index tag,
+      const std::function<std::shared_ptr<const void>()>& compute) const;
+
+  std::shared_ptr<const void> get_code_data(
+      std::type_index tag,
+      const std::function<std::shared_ptr<const void>()>& compute) const;
+
+  // A hash of all instructions with their operands, and of all edges, in block
+  // order.
+  std::size_t code_fingerprint() const;
+
   // The memory of all blocks and edges in this graph are owned here
   Blocks m_blocks;
   EdgeSet m_edges;
@@ -1316,6 +1385,9 @@ class ControlFlowGraph {
   bool m_owns_insns{false};
   bool m_owns_removed_insns{true};
   std::vector<IRInstruction*> m_removed_insns;
+  uint64_t m_structural_version{0};
+  // Created on first use, see get_structural_data().
+  mutable std::atomic<StructuralCache*> m_structural_cache{nullptr};
 };
 
 // A static-method-only API for use with the monotonic fixpoint iterator.
@@ -96,6 +96,7 @@ void disable_stack_trace_for_exc_type(RedexError type) {
 void crash_backtrace_handler(int sig) {
   size_t crashing = g_crashing.fetch_add(1);
   if (crashing == 0) {
+    trace_flush();
     CRASH_BACKTRACE();
   } else {
     sleep(60); // Sleep a minute, then go on to die if we're still alive.
@@ -109,6 +110,7 @@ void crash_backtrace_handler(int sig) {
 void debug_backtrace_handler(int sig) {
   size_t crashing = g_crashing.fetch_add(1);
   if (crashing == 0) {
+    trace_flush();
     CRASH_BACKTRACE();
   } else {
     sleep(60); // Sleep a minute, then go on to die if we're still alive.
@@ -270,6 +272,7 @@ void assert_fail(const char* expr,
     if (!redex_debug::no_stacktrace_for_type[type]) {
       CRASH_BACKTRACE();
     }
+    trace_flush();
     _exit(-6);
   }
 
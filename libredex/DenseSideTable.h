@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+/*
+ * A map from dex objects with dense indices (types, field and method
+ * references, classes; see e.g. DexMethodRef::get_dense_index()) to values,
+ * stored in arrays indexed by the dense index instead of a hashtable keyed by
+ * pointers.
+ *
+ * The storage is a fixed number of segments of doubling sizes, which are
+ * allocated on first access and never moved, so that references to values
+ * remain valid, and objects created while the table is in use are handled
+ * without any resizing. Segment allocation is thread-safe; every value is
+ * default-constructed when its segment is allocated. Accessing the same value
+ * from different threads needs the usual synchronization, e.g. by using an
+ * atomic value type.
+ */
+template <class Object, class Value>
+class DenseSideTable {
+ public:
+  DenseSideTable() {
+    for (auto& segment : m_segments) {
+      segment.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  DenseSideTable(const DenseSideTable&) = delete;
+  DenseSideTable& operator=(const DenseSideTable&) = delete;
+
+  ~DenseSideTable() {
+    for (auto& segment : m_segments) {
+      delete[] segment.load(std::memory_order_relaxed);
+    }
+  }
+
+  /*
+   * Returns the value of the given object, allocating its segment if needed.
+   * This operation is always thread-safe.
+   */
+  Value& operator[](const Object* obj) {
+    auto [segment_index, offset] = locate(obj->get_dense_index());
+    auto& segment = m_segments[segment_index];
+    auto* values = segment.load(std::memory_order_acquire);
+    if (values == nullptr) {
+      auto* new_values = new Value[segment_size(segment_index)]();
+      if (segment.compare_exchange_strong(values, new_values,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+        values = new_values;
+      } else {
+        // We lost a race with another allocation of the same segment.
+        delete[] new_values;
+      }
+    }
+    return values[offset];
+  }
+
+  /*
+   * Returns the value of the given object, or nullptr if no value in its
+   * segment was ever accessed via operator[].
+   * This operation is always thread-safe.
+   */
+  Value* get(const Object* obj) {
+    auto [segment_index, offset] = locate(obj->get_dense_index());
+    auto* values = m_segments[segment_index].load(std::memory_order_acquire);
+    return values == nullptr ? nullptr : values + offset;
+  }
+
+  const Value* get(const Object* obj) const {
+    return const_cast<DenseSideTable*>(this)->get(obj);
+  }
+
+ private:
+  // Segment 0 holds the first 2^FIRST_SEGMENT_BITS indices, and every
+  // following segment k holds as many indices as all the previous ones, i.e.
+  // the indices from 2^(FIRST_SEGMENT_BITS + k - 1) up to (excluding)
+  // 2^(FIRST_SEGMENT_BITS + k).
+  static constexpr size_t FIRST_SEGMENT_BITS = 10;
+  static constexpr size_t NUM_SEGMENTS =
+      std::numeric_limits<uint32_t>::digits - FIRST_SEGMENT_BITS + 1;
+
+  static size_t segment_size(size_t segment_index) {
+    return size_t(1) << (FIRST_SEGMENT_BITS +
+                         (segment_index == 0 ? 0 : segment_index - 1));
+  }
+
+  static std::pair<size_t, size_t> locate(uint32_t idx) {
+    if ((idx >> FIRST_SEGMENT_BITS) == 0) {
+      return {0, idx};
+    }
+    size_t msb =
+        std::numeric_limits<uint32_t>::digits - 1 - __builtin_clz(idx);
+    return {msb - FIRST_SEGMENT_BITS + 1, idx - (size_t(1) << msb)};
+  }
+
+  std::array<std::atomic<Value*>, NUM_SEGMENTS> m_segments;
+};
@@ -10,6 +10,7 @@
 #include <ostream>
 
 #include "DexClass.h"
+#include "DexHasher.h"
 #include "DexInstruction.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
@@ -276,188 +277,292 @@ std::string to_string(const DexAssessment& assessment) {
   return oss.str();
 }
 
-DexAssessment DexScopeAssessor::run() {
-  // This struct combines all individual assessment implementations.
-  struct Assessment {
-    dex_position::Assessment dex_position_assessment;
-    Assessment& operator+=(const Assessment& other) {
-      dex_position_assessment += other.dex_position_assessment;
-      return *this;
-    }
-    bool has_problems() { return dex_position_assessment.has_problems(); }
-    DexAssessment to_dex_assessment() {
-      return dex_position_assessment.to_dex_assessment();
-    }
-  };
+// The assessment of a single class, including its fields and methods.
+struct ClassAssessment {
+  dex_position::Assessment dex_position_assessment;
+
+  uint64_t classes_without_deobfuscated_name{0};
+  uint64_t classes_with_annotations{0};
+  uint64_t classes_sum_annotations{0};
+
+  uint64_t fields_without_deobfuscated_name{0};
+  uint64_t num_fields{0};
+  uint64_t fields_with_annotations{0};
+  uint64_t fields_sum_annotations{0};
+
+  uint64_t methods_without_deobfuscated_name{0};
+  uint64_t num_methods{0};
+  uint64_t methods_with_code{0};
+  uint64_t huge_methods{0};
+  uint64_t num_instructions{0};
+  uint64_t sum_opcodes{0};
+  uint64_t code_units{0};
+  uint64_t methods_with_annotations{0};
+  uint64_t methods_sum_annotations{0};
+  uint64_t methods_with_param_annotations{0};
+  uint64_t methods_sum_param_annotations{0};
+
+  ClassAssessment& operator+=(const ClassAssessment& other) {
+    dex_position_assessment += other.dex_position_assessment;
+    classes_without_deobfuscated_name +=
+        other.classes_without_deobfuscated_name;
+    classes_with_annotations += other.classes_with_annotations;
+    classes_sum_annotations += other.classes_sum_annotations;
+    fields_without_deobfuscated_name += other.fields_without_deobfuscated_name;
+    num_fields += other.num_fields;
+    fields_with_annotations += other.fields_with_annotations;
+    fields_sum_annotations += other.fields_sum_annotations;
+    methods_without_deobfuscated_name +=
+        other.methods_without_deobfuscated_name;
+    num_methods += other.num_methods;
+    methods_with_code += other.methods_with_code;
+    huge_methods += other.huge_methods;
+    num_instructions += other.num_instructions;
+    sum_opcodes += other.sum_opcodes;
+    code_units += other.code_units;
+    methods_with_annotations += other.methods_with_annotations;
+    methods_sum_annotations += other.methods_sum_annotations;
+    methods_with_param_annotations += other.methods_with_param_annotations;
+    methods_sum_param_annotations += other.methods_sum_param_annotations;
+    return *this;
+  }
+};
 
-  struct ClassStats {
-    std::atomic<size_t> classes_without_deobfuscated_name{0};
-    std::atomic<size_t> with_annotations{0};
-    std::atomic<size_t> sum_annotations{0};
-  };
-  ClassStats class_stats{};
-  walk::parallel::classes(m_scope, [&class_stats](DexClass* c) {
-    if (c->get_deobfuscated_name_or_null() == nullptr) {
-      class_stats.classes_without_deobfuscated_name.fetch_add(1);
-    }
-    auto* aset = c->get_anno_set();
-    if (aset != nullptr && aset->size() > 0) {
-      class_stats.with_annotations.fetch_add(1, std::memory_order_relaxed);
-      class_stats.sum_annotations.fetch_add(aset->size(),
-                                            std::memory_order_relaxed);
-    }
-  });
+namespace {
 
-  struct FieldStats {
-    std::atomic<size_t> fields_without_deobfuscated_name{0};
-    std::atomic<size_t> num_fields{0};
-    std::atomic<size_t> with_annotations{0};
-    std::atomic<size_t> sum_annotations{0};
-  };
-  FieldStats field_stats{};
-  walk::parallel::fields(m_scope, [&field_stats](DexField* f) {
-    field_stats.num_fields.fetch_add(1, std::memory_order_relaxed);
-    auto* aset = f->get_anno_set();
+void assess_field(const DexField* f, ClassAssessment* assessment) {
+  assessment->num_fields++;
+  auto* aset = f->get_anno_set();
+  if (aset != nullptr && aset->size() > 0) {
+    assessment->fields_with_annotations++;
+    assessment->fields_sum_annotations += aset->size();
+  }
+  if (f->get_deobfuscated_name().empty()) {
+    assessment->fields_without_deobfuscated_name++;
+  }
+}
+
+void assess_method(DexMethod* m,
+                   dex_position::Assessor& dex_position_assessor,
+                   ClassAssessment* assessment) {
+  assessment->num_methods++;
+  {
+    auto* aset = m->get_anno_set();
     if (aset != nullptr && aset->size() > 0) {
-      field_stats.with_annotations.fetch_add(1, std::memory_order_relaxed);
-      field_stats.sum_annotations.fetch_add(aset->size(),
-                                            std::memory_order_relaxed);
+      assessment->methods_with_annotations++;
+      assessment->methods_sum_annotations += aset->size();
     }
-    if (f->get_deobfuscated_name().empty()) {
-      field_stats.fields_without_deobfuscated_name.fetch_add(1);
-    }
-  });
-
-  struct MethodStats {
-    std::atomic<size_t> methods_without_deobfuscated_name{0};
-    std::atomic<size_t> num_methods{0};
-    std::atomic<size_t> methods_with_code{0};
-    std::atomic<size_t> huge_methods{0};
-    std::atomic<size_t> num_instructions{0};
-    std::atomic<size_t> sum_opcodes{0};
-    std::atomic<size_t> code_units{0};
-    std::atomic<size_t> with_annotations{0};
-    std::atomic<size_t> sum_annotations{0};
-    std::atomic<size_t> with_param_annotations{0};
-    std::atomic<size_t> sum_param_annotations{0};
-  };
-  MethodStats method_stats{};
-  walk::parallel::methods(m_scope, [&method_stats](auto* m) {
-    method_stats.num_methods.fetch_add(1, std::memory_order_relaxed);
-    {
-      auto* aset = m->get_anno_set();
-      if (aset != nullptr && aset->size() > 0) {
-        method_stats.with_annotations.fetch_add(1, std::memory_order_relaxed);
-        method_stats.sum_annotations.fetch_add(aset->size(),
-                                               std::memory_order_relaxed);
-      }
-    }
-    {
-      auto* panno = m->get_param_anno();
-      if (panno != nullptr && !panno->empty()) {
-        method_stats.with_param_annotations.fetch_add(
-            1, std::memory_order_relaxed);
-        method_stats.sum_param_annotations.fetch_add(panno->size(),
-                                                     std::memory_order_relaxed);
-      }
+  }
+  {
+    auto* panno = m->get_param_anno();
+    if (panno != nullptr && !panno->empty()) {
+      assessment->methods_with_param_annotations++;
+      assessment->methods_sum_param_annotations += panno->size();
     }
+  }
 
-    if (m->get_deobfuscated_name_or_null() == nullptr) {
-      method_stats.methods_without_deobfuscated_name.fetch_add(1);
-    }
+  if (m->get_deobfuscated_name_or_null() == nullptr) {
+    assessment->methods_without_deobfuscated_name++;
+  }
 
-    auto code = m->get_code();
-    if (code == nullptr) {
-      return;
-    }
-    method_stats.methods_with_code.fetch_add(1, std::memory_order_relaxed);
-    method_stats.num_instructions.fetch_add(code->count_opcodes(),
-                                            std::memory_order_relaxed);
-    auto sum_opcode_sizes = code->sum_opcode_sizes();
-    if (code->editable_cfg_built()) {
-      sum_opcode_sizes += code->cfg().get_size_adjustment();
+  auto code = m->get_code();
+  if (code == nullptr) {
+    return;
+  }
+  assessment->methods_with_code++;
+  assessment->num_instructions += code->count_opcodes();
+  auto sum_opcode_sizes = code->sum_opcode_sizes();
+  if (code->editable_cfg_built()) {
+    sum_opcode_sizes += code->cfg().get_size_adjustment();
+  }
+  assessment->sum_opcodes += sum_opcode_sizes;
+  auto code_units = code->estimate_code_units();
+  if (code->editable_cfg_built()) {
+    code_units += code->cfg().get_size_adjustment();
+  }
+  assessment->code_units += code_units;
+  if (code_units > 9000) {
+    // Why 9000? Because that's the default cut-off for SplitHugeSwitchPass to
+    // start splitting.
+    assessment->huge_methods++;
+  }
+
+  code->build_cfg(/*editable*/ true, /*fresh_editable_build*/ false);
+
+  auto dex_position_assessment =
+      dex_position_assessor.analyze_method(m, code->cfg());
+
+  if (traceEnabled(ASSESSOR, 2) && dex_position_assessment.has_problems()) {
+    if (traceEnabled(ASSESSOR, 3)) {
+      TRACE(ASSESSOR,
+            3,
+            "[scope assessor] %s: %s\n%s",
+            SHOW(m),
+            to_string(dex_position_assessment.to_dex_assessment()).c_str(),
+            SHOW(code->cfg()));
+    } else {
+      TRACE(ASSESSOR,
+            2,
+            "[scope assessor] %s: %s",
+            SHOW(m),
+            to_string(dex_position_assessment.to_dex_assessment()).c_str());
     }
-    method_stats.sum_opcodes.fetch_add(sum_opcode_sizes,
-                                       std::memory_order_relaxed);
-    auto code_units = code->estimate_code_units();
-    if (code->editable_cfg_built()) {
-      code_units += code->cfg().get_size_adjustment();
+  }
+
+  assessment->dex_position_assessment += dex_position_assessment;
+}
+
+ClassAssessment assess_class(DexClass* c,
+                             dex_position::Assessor& dex_position_assessor) {
+  ClassAssessment assessment;
+  if (c->get_deobfuscated_name_or_null() == nullptr) {
+    assessment.classes_without_deobfuscated_name++;
+  }
+  auto* aset = c->get_anno_set();
+  if (aset != nullptr && aset->size() > 0) {
+    assessment.classes_with_annotations++;
+    assessment.classes_sum_annotations += aset->size();
+  }
+  for (auto* f : c->get_sfields()) {
+    assess_field(f, &assessment);
+  }
+  for (auto* f : c->get_ifields()) {
+    assess_field(f, &assessment);
+  }
+  for (auto* m : c->get_dmethods()) {
+    assess_method(m, dex_position_assessor, &assessment);
+  }
+  for (auto* m : c->get_vmethods()) {
+    assess_method(m, dex_position_assessor, &assessment);
+  }
+  return assessment;
+}
+
+std::vector<const void*> get_members(const DexClass* cls) {
+  std::vector<const void*> members;
+  members.reserve(cls->get_dmethods().size() + cls->get_vmethods().size() +
+                  cls->get_sfields().size() + cls->get_ifields().size() + 3);
+  auto append = [&](const auto& c) {
+    members.insert(members.end(), c.begin(), c.end());
+  };
+  append(cls->get_dmethods());
+  members.push_back(nullptr);
+  append(cls->get_vmethods());
+  members.push_back(nullptr);
+  append(cls->get_sfields());
+  members.push_back(nullptr);
+  append(cls->get_ifields());
+  return members;
+}
+
+bool is_any_assessment_dirty(const DexClass* cls) {
+  auto is_dirty = [](const DexMethod* m) { return m->is_assessment_dirty(); };
+  return cls->is_assessment_dirty() ||
+         std::any_of(cls->get_dmethods().begin(), cls->get_dmethods().end(),
+                     is_dirty) ||
+         std::any_of(cls->get_vmethods().begin(), cls->get_vmethods().end(),
+                     is_dirty);
+}
+
+void clear_assessment_dirty(DexClass* cls) {
+  cls->clear_assessment_dirty();
+  for (auto* m : cls->get_dmethods()) {
+    m->clear_assessment_dirty();
+  }
+  for (auto* m : cls->get_vmethods()) {
+    m->clear_assessment_dirty();
+  }
+}
+
+} // namespace
+
+DexScopeAssessmentCache::DexScopeAssessmentCache()
+    : m_epoch(hashing::cached_hashes_epoch()) {}
+DexScopeAssessmentCache::~DexScopeAssessmentCache() = default;
+
+DexAssessment DexScopeAssessor::run() {
+  if (m_cache != nullptr) {
+    auto epoch = hashing::cached_hashes_epoch();
+    if (epoch != m_cache->m_epoch) {
+      m_cache->m_entries.clear();
+      m_cache->m_epoch = epoch;
     }
-    method_stats.code_units.fetch_add(code_units, std::memory_order_relaxed);
-    if (code_units > 9000) {
-      // Why 9000? Because that's the default cut-off for SplitHugeSwitchPass to
-      // start splitting.
-      method_stats.huge_methods.fetch_add(1, std::memory_order_relaxed);
+  }
+  std::unordered_map<const DexClass*, size_t> class_indices;
+  if (m_cache != nullptr) {
+    for (auto* cls : m_scope) {
+      class_indices.emplace(cls, class_indices.size());
     }
-  });
+  }
+  // Newly computed entries; the cache itself is only read concurrently.
+  std::vector<std::unique_ptr<DexScopeAssessmentCache::Entry>> new_entries(
+      class_indices.size());
 
   dex_position::Assessor dex_position_assessor;
-
-  auto combined_assessment = walk::parallel::methods<Assessment>(
-      m_scope, [&dex_position_assessor](DexMethod* method) {
-        Assessment assessment;
-
-        auto code = method->get_code();
-        if (!code) {
-          return assessment;
+  auto combined = walk::parallel::classes<ClassAssessment>(
+      m_scope, [&](DexClass* cls) {
+        if (m_cache == nullptr) {
+          return assess_class(cls, dex_position_assessor);
         }
-
-        code->build_cfg(/*editable*/ true, /*fresh_editable_build*/ false);
-
-        assessment.dex_position_assessment =
-            dex_position_assessor.analyze_method(method, code->cfg());
-
-        if (traceEnabled(ASSESSOR, 2) && assessment.has_problems()) {
-          if (traceEnabled(ASSESSOR, 3)) {
-            TRACE(ASSESSOR,
-                  3,
-                  "[scope assessor] %s: %s\n%s",
-                  SHOW(method),
-                  to_string(assessment.to_dex_assessment()).c_str(),
-                  SHOW(code->cfg()));
-          } else {
-            TRACE(ASSESSOR,
-                  2,
-                  "[scope assessor] %s: %s",
-                  SHOW(method),
-                  to_string(assessment.to_dex_assessment()).c_str());
-          }
+        auto members = get_members(cls);
+        auto it = m_cache->m_entries.find(cls);
+        if (it != m_cache->m_entries.end() && !is_any_assessment_dirty(cls) &&
+            it->second.members == members) {
+          return *it->second.assessment;
         }
-
+        auto assessment = assess_class(cls, dex_position_assessor);
+        // Assessing builds CFGs, which marks the methods dirty again.
+        clear_assessment_dirty(cls);
+        new_entries[class_indices.at(cls)] =
+            std::make_unique<DexScopeAssessmentCache::Entry>(
+                DexScopeAssessmentCache::Entry{
+                    std::make_unique<const ClassAssessment>(assessment),
+                    std::move(members)});
         return assessment;
       });
 
-  auto res = combined_assessment.to_dex_assessment();
+  if (m_cache != nullptr) {
+    size_t misses = 0;
+    for (auto& [cls, index] : class_indices) {
+      if (new_entries[index]) {
+        m_cache->m_entries[cls] = std::move(*new_entries[index]);
+        misses++;
+      }
+    }
+    m_cache->m_misses += misses;
+    m_cache->m_hits += class_indices.size() - misses;
+  }
+
+  auto res = combined.dex_position_assessment.to_dex_assessment();
   res["without_deobfuscated_names.methods"] =
-      method_stats.methods_without_deobfuscated_name.load();
+      combined.methods_without_deobfuscated_name;
   res["without_deobfuscated_names.fields"] =
-      field_stats.fields_without_deobfuscated_name.load();
+      combined.fields_without_deobfuscated_name;
   res["without_deobfuscated_names.classes"] =
-      class_stats.classes_without_deobfuscated_name.load();
+      combined.classes_without_deobfuscated_name;
 
   res["num_classes"] = m_scope.size();
-  res["num_methods"] = method_stats.num_methods.load();
-  res["num_fields"] = field_stats.num_fields.load();
-  res["methods~with~code"] = method_stats.methods_with_code.load();
-  res["huge~methods"] = method_stats.huge_methods.load();
-  res["num_instructions"] = method_stats.num_instructions.load();
-  res["sum_opcodes"] = method_stats.sum_opcodes.load();
-  res["code_units"] = method_stats.code_units.load();
-
-  res["methods.with_annotations"] = method_stats.with_annotations.load();
-  res["methods.sum_annotations"] = method_stats.sum_annotations.load();
+  res["num_methods"] = combined.num_methods;
+  res["num_fields"] = combined.num_fields;
+  res["methods~with~code"] = combined.methods_with_code;
+  res["huge~methods"] = combined.huge_methods;
+  res["num_instructions"] = combined.num_instructions;
+  res["sum_opcodes"] = combined.sum_opcodes;
+  res["code_units"] = combined.code_units;
+
+  res["methods.with_annotations"] = combined.methods_with_annotations;
+  res["methods.sum_annotations"] = combined.methods_sum_annotations;
   res["methods.with_param_annotations"] =
-      method_stats.with_param_annotations.load();
-  res["methods.sum_param_annotations"] =
-      method_stats.sum_param_annotations.load();
+      combined.methods_with_param_annotations;
+  res["methods.sum_param_annotations"] = combined.methods_sum_param_annotations;
 
-  res["fields.with_annotations"] = field_stats.with_annotations.load();
-  res["fields.sum_annotations"] = field_stats.sum_annotations.load();
+  res["fields.with_annotations"] = combined.fields_with_annotations;
+  res["fields.sum_annotations"] = combined.fields_sum_annotations;
 
-  res["classes.with_annotations"] = class_stats.with_annotations.load();
-  res["classes.sum_annotations"] = class_stats.sum_annotations.load();
+  res["classes.with_annotations"] = combined.classes_with_annotations;
+  res["classes.sum_annotations"] = combined.classes_sum_annotations;
 
-  if (combined_assessment.has_problems()) {
+  if (combined.dex_position_assessment.has_problems()) {
     TRACE(ASSESSOR, 1, "[scope assessor] %s", to_string(res).c_str());
   }
   return res;
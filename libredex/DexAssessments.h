@@ -13,7 +13,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Debug.h"
 #include "DexClass.h"
@@ -26,13 +29,46 @@ using DexAssessmentItem = std::pair<std::string, uint64_t>;
 std::vector<DexAssessmentItem> order(const DexAssessment&);
 std::string to_string(const DexAssessment&);
 
+struct ClassAssessment;
+
+/*
+ * Keeps the assessments of individual classes across runs of a
+ * DexScopeAssessor, so that only classes that may have changed since (see
+ * DexClass::is_assessment_dirty() and DexMethod::is_assessment_dirty()) are
+ * assessed again. Like the DexScopeHashCache, the cache is dropped entirely
+ * on renames and field changes.
+ */
+class DexScopeAssessmentCache final {
+ public:
+  DexScopeAssessmentCache();
+  ~DexScopeAssessmentCache();
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    std::unique_ptr<const ClassAssessment> assessment;
+    std::vector<const void*> members;
+  };
+  std::unordered_map<const DexClass*, Entry> m_entries;
+  uint64_t m_epoch;
+  size_t m_hits{0};
+  size_t m_misses{0};
+
+  friend class DexScopeAssessor;
+};
+
 class DexScopeAssessor final {
  public:
-  explicit DexScopeAssessor(const Scope& scope) : m_scope(scope) {}
+  explicit DexScopeAssessor(const Scope& scope,
+                            DexScopeAssessmentCache* cache = nullptr)
+      : m_scope(scope), m_cache(cache) {}
   DexAssessment run();
 
  private:
   const Scope& m_scope;
+  DexScopeAssessmentCache* m_cache;
 };
 
 } // namespace assessments
@@ -27,8 +27,10 @@
 #include "Util.h"
 #include "Walkers.h"
 #include "Warning.h"
+#include "WorkQueue.h"
 
 #include <algorithm>
+#include <array>
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
 #include <memory>
@@ -140,8 +142,8 @@ int32_t DexString::java_hashcode() const {
 
 int DexTypeList::encode(DexOutputIdx* dodx, uint32_t* output) const {
   uint16_t* typep = (uint16_t*)(output + 1);
-  *output = (uint32_t)m_list.size();
-  for (auto const& type : m_list) {
+  *output = (uint32_t)m_repr.list.size();
+  for (auto const& type : m_repr.list) {
     *typep++ = dodx->typeidx(type);
   }
   return (int)(((uint8_t*)typep) - (uint8_t*)output);
@@ -150,41 +152,41 @@ int DexTypeList::encode(DexOutputIdx* dodx, uint32_t* output) const {
 DexTypeList* DexTypeList::push_front(DexType* t) const {
   ContainerType new_list;
   new_list.push_back(t);
-  new_list.insert(new_list.end(), m_list.begin(), m_list.end());
+  new_list.insert(new_list.end(), m_repr.list.begin(), m_repr.list.end());
   return make_type_list(std::move(new_list));
 }
 
 DexTypeList* DexTypeList::pop_front() const {
-  redex_assert(!m_list.empty());
-  ContainerType new_list{m_list.begin() + 1, m_list.end()};
+  redex_assert(!m_repr.list.empty());
+  ContainerType new_list{m_repr.list.begin() + 1, m_repr.list.end()};
   return make_type_list(std::move(new_list));
 }
 DexTypeList* DexTypeList::pop_front(size_t n) const {
-  redex_assert(m_list.size() >= n);
-  ContainerType new_list{m_list.begin() + n, m_list.end()};
+  redex_assert(m_repr.list.size() >= n);
+  ContainerType new_list{m_repr.list.begin() + n, m_repr.list.end()};
   return make_type_list(std::move(new_list));
 }
 
 DexTypeList* DexTypeList::pop_back(size_t n) const {
-  redex_assert(m_list.size() >= n);
-  ContainerType new_list{m_list.begin(), m_list.end() - n};
+  redex_assert(m_repr.list.size() >= n);
+  ContainerType new_list{m_repr.list.begin(), m_repr.list.end() - n};
   return make_type_list(std::move(new_list));
 }
 
 DexTypeList* DexTypeList::push_back(DexType* t) const {
-  ContainerType new_list{m_list};
+  ContainerType new_list{m_repr.list};
   new_list.push_back(t);
   return make_type_list(std::move(new_list));
 }
 DexTypeList* DexTypeList::push_back(const std::vector<DexType*>& t) const {
-  ContainerType new_list{m_list};
+  ContainerType new_list{m_repr.list};
   new_list.insert(new_list.end(), t.begin(), t.end());
   return make_type_list(std::move(new_list));
 }
 
 DexTypeList* DexTypeList::replace_head(DexType* new_head) const {
-  redex_assert(!m_list.empty());
-  ContainerType new_list{m_list};
+  redex_assert(!m_repr.list.empty());
+  ContainerType new_list{m_repr.list};
   new_list[0] = new_head;
   return make_type_list(std::move(new_list));
 }
@@ -197,6 +199,31 @@ DexTypeList* DexTypeList::get_type_list(const ContainerType& p) {
   return g_redex->get_type_list(p);
 }
 
+namespace {
+
+std::atomic<uint32_t> s_num_type_dense_indices{0};
+std::atomic<uint32_t> s_num_field_dense_indices{0};
+std::atomic<uint32_t> s_num_method_dense_indices{0};
+std::atomic<uint32_t> s_num_class_dense_indices{0};
+
+} // namespace
+
+uint32_t DexType::next_dense_index() {
+  return s_num_type_dense_indices.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t DexType::num_dense_indices() {
+  return s_num_type_dense_indices.load(std::memory_order_relaxed);
+}
+
+uint32_t DexFieldRef::next_dense_index() {
+  return s_num_field_dense_indices.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t DexFieldRef::num_dense_indices() {
+  return s_num_field_dense_indices.load(std::memory_order_relaxed);
+}
+
 DexField::DexField(DexType* container, const DexString* name, DexType* type)
     : DexFieldRef(container, name, type),
       m_access(static_cast<DexAccessFlags>(0)),
@@ -209,6 +236,7 @@ DexField* DexFieldRef::make_concrete(DexAccessFlags access_flags) {
 
 DexField* DexFieldRef::make_concrete(DexAccessFlags access_flags,
                                      std::unique_ptr<DexEncodedValue> v) {
+  hashing::invalidate_cached_hashes();
   // FIXME assert if already concrete
   auto that = static_cast<DexField*>(this);
   that->m_access = access_flags;
@@ -271,13 +299,15 @@ DexFieldRef* DexField::make_field(std::string_view full_descriptor) {
 }
 
 void DexField::set_external() {
+  hashing::invalidate_cached_hashes();
   always_assert_log(!m_concrete, "Unexpected concrete field %s\n",
                     self_show().c_str());
-  m_deobfuscated_name = self_show();
+  m_deobfuscated_name = DexString::make_string(self_show());
   m_external = true;
 }
 
 void DexField::set_value(std::unique_ptr<DexEncodedValue> v) {
+  hashing::invalidate_cached_hashes();
   always_assert_log(
       m_concrete,
       "Field needs to be concrete to be attached an encoded value.");
@@ -290,9 +320,21 @@ void DexField::set_value(std::unique_ptr<DexEncodedValue> v) {
       v != nullptr ? std::move(v) : DexEncodedValue::zero_for_type(get_type());
 }
 
-void DexField::clear_annotations() { m_anno.reset(); }
+void DexField::mark_class_hash_dirty() const {
+  if (auto* cls = type_class(get_class())) {
+    cls->mark_hash_dirty();
+  }
+}
+
+void DexField::clear_annotations() {
+  hashing::invalidate_cached_hashes();
+  lazy_annotations::materialize_if_pending(get_class());
+  m_anno.reset();
+}
 
 bool DexField::attach_annotation_set(std::unique_ptr<DexAnnotationSet> aset) {
+  hashing::invalidate_cached_hashes();
+  lazy_annotations::materialize_if_pending(get_class());
   if (m_concrete && !is_synthetic(get_access())) {
     return false;
   }
@@ -304,6 +346,8 @@ bool DexField::attach_annotation_set(std::unique_ptr<DexAnnotationSet> aset) {
 }
 
 std::unique_ptr<DexAnnotationSet> DexField::release_annotations() {
+  hashing::invalidate_cached_hashes();
+  lazy_annotations::materialize_if_pending(get_class());
   return std::move(m_anno);
 }
 
@@ -767,6 +811,14 @@ int DexCode::encode(DexOutputIdx* dodx, uint32_t* output) {
   return (int)(hemit - ((uint8_t*)output));
 }
 
+uint32_t DexMethodRef::next_dense_index() {
+  return s_num_method_dense_indices.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t DexMethodRef::num_dense_indices() {
+  return s_num_method_dense_indices.load(std::memory_order_relaxed);
+}
+
 DexMethod::DexMethod(DexType* type, const DexString* name, DexProto* proto)
     : DexMethodRef(type, name, proto) {
   m_virtual = false;
@@ -789,13 +841,70 @@ std::string DexMethod::get_fully_deobfuscated_name() const {
 }
 
 void DexMethod::set_code(std::unique_ptr<IRCode> code) {
+  mark_hash_dirty();
+  discard_lazy_code();
   m_code = std::move(code);
 }
 
+struct LazyDexCode {
+  DexIdx* idx;
+  uint32_t code_off;
+  const DexString* source_file;
+};
+
+namespace {
+
+// Guards the decoding of lazily loaded code. Striped, as methods are decoded
+// concurrently by parallel walks.
+std::array<std::mutex, 256> s_lazy_code_locks;
+
+} // namespace
+
+void DexMethod::set_lazy_code(DexIdx* idx,
+                              uint32_t code_off,
+                              const DexString* source_file) {
+  redex_assert(m_code == nullptr && m_dex_code == nullptr);
+  m_lazy_code.reset(new LazyDexCode{idx, code_off, source_file});
+  m_code_pending.store(true, std::memory_order_release);
+}
+
+void DexMethod::materialize_code() const {
+  auto* that = const_cast<DexMethod*>(this);
+  auto& lock = s_lazy_code_locks[std::hash<const DexMethod*>()(this) %
+                                 s_lazy_code_locks.size()];
+  std::lock_guard<std::mutex> lock_guard(lock);
+  if (!m_code_pending.load(std::memory_order_relaxed)) {
+    // Another thread got here first.
+    return;
+  }
+  auto dc = DexCode::get_dex_code(m_lazy_code->idx, m_lazy_code->code_off);
+  if (dc->get_debug_item()) {
+    dc->get_debug_item()->bind_positions(that, m_lazy_code->source_file);
+  }
+  that->m_dex_code = std::move(dc);
+  try {
+    that->balloon();
+  } catch (...) {
+    // Leave the method pending, so that later accesses fail the same way.
+    that->m_dex_code.reset();
+    throw;
+  }
+  that->m_lazy_code.reset();
+  m_code_pending.store(false, std::memory_order_release);
+}
+
+void DexMethod::discard_lazy_code() {
+  m_code_pending.store(false, std::memory_order_relaxed);
+  m_lazy_code.reset();
+}
+
 void DexMethod::balloon() {
   redex_assert(m_code == nullptr);
   m_code = IRCode::for_method(this);
   m_dex_code.reset();
+  if (g_redex->build_cfg_at_balloon) {
+    m_code->build_cfg();
+  }
 }
 
 void DexMethod::sync() {
@@ -827,6 +936,7 @@ DexMethod* DexMethod::make_method_from(DexMethod* that,
   auto m = static_cast<DexMethod*>(
       DexMethod::make_method(target_cls, name, that->get_proto()));
   redex_assert(m != that);
+  lazy_annotations::materialize_if_pending(that->get_class());
   if (that->m_anno) {
     m->m_anno = std::make_unique<DexAnnotationSet>(*that->m_anno);
   }
@@ -930,6 +1040,8 @@ DexMethodRef* DexMethod::make_method(
 }
 
 void DexMethod::combine_annotations_with(DexMethod* other) {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
   auto other_anno_set = other->get_anno_set();
   if (other_anno_set != nullptr) {
     if (m_anno == nullptr) {
@@ -953,13 +1065,21 @@ void DexMethod::combine_annotations_with(DexMethod* other) {
   }
 }
 
-void DexMethod::clear_annotations() { m_anno.reset(); }
+void DexMethod::clear_annotations() {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
+  m_anno.reset();
+}
 
 std::unique_ptr<ParamAnnotations> DexMethod::release_param_anno() {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
   return std::move(m_param_anno);
 }
 
 bool DexMethod::attach_annotation_set(std::unique_ptr<DexAnnotationSet> aset) {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
   if (m_concrete && !is_synthetic(get_access())) {
     return false;
   }
@@ -971,6 +1091,8 @@ bool DexMethod::attach_annotation_set(std::unique_ptr<DexAnnotationSet> aset) {
 }
 void DexMethod::attach_param_annotation_set(
     int paramno, std::unique_ptr<DexAnnotationSet> aset) {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
   always_assert_type_log(!m_concrete || is_synthetic(get_access()),
                          RedexError::BAD_ANNOTATION, "method %s is concrete\n",
                          self_show().c_str());
@@ -985,6 +1107,8 @@ void DexMethod::attach_param_annotation_set(
 }
 
 std::unique_ptr<DexAnnotationSet> DexMethod::release_annotations() {
+  mark_hash_dirty();
+  lazy_annotations::materialize_if_pending(get_class());
   return std::move(m_anno);
 }
 
@@ -1059,11 +1183,16 @@ void DexClass::set_deobfuscated_name(const DexString& name) {
 }
 
 void DexClass::set_external() {
+  mark_hash_dirty();
   m_deobfuscated_name = DexString::make_string(self_show());
   m_external = true;
 }
 
 void DexClass::remove_method(const DexMethod* m) {
+  mark_hash_dirty();
+  // Pending annotations are attached to the members of the class, which must
+  // still be found here when they get decoded.
+  materialize_annotations_if_pending();
   auto& meths = m->is_virtual() ? m_vmethods : m_dmethods;
   auto it = std::find(meths.begin(), meths.end(), m);
   DEBUG_ONLY bool erased = false;
@@ -1075,6 +1204,7 @@ void DexClass::remove_method(const DexMethod* m) {
 }
 
 void DexMethod::become_virtual() {
+  mark_hash_dirty();
   redex_assert(!m_virtual);
   auto cls = type_class(m_spec.cls);
   redex_assert(!cls->is_external());
@@ -1087,6 +1217,7 @@ void DexMethod::become_virtual() {
 DexMethod* DexMethodRef::make_concrete(DexAccessFlags access,
                                        std::unique_ptr<DexCode> dc,
                                        bool is_virtual) {
+  hashing::invalidate_cached_hashes();
   auto that = static_cast<DexMethod*>(this);
   that->m_access = access;
   that->m_dex_code = std::move(dc);
@@ -1098,6 +1229,7 @@ DexMethod* DexMethodRef::make_concrete(DexAccessFlags access,
 DexMethod* DexMethodRef::make_concrete(DexAccessFlags access,
                                        std::unique_ptr<IRCode> dc,
                                        bool is_virtual) {
+  hashing::invalidate_cached_hashes();
   auto that = static_cast<DexMethod*>(this);
   that->m_access = access;
   that->m_code = std::move(dc);
@@ -1115,15 +1247,19 @@ void DexMethodRef::change(const DexMethodSpec& ref, bool rename_on_collision) {
 }
 
 void DexMethod::make_non_concrete() {
+  hashing::invalidate_cached_hashes();
   m_access = static_cast<DexAccessFlags>(0);
   m_concrete = false;
+  discard_lazy_code();
   m_code.reset();
   m_virtual = false;
+  lazy_annotations::materialize_if_pending(get_class());
   m_param_anno.reset();
   m_anno.reset();
 }
 
 void DexMethod::set_deobfuscated_name(const std::string& name) {
+  mark_hash_dirty();
   // If the method has an old deobfuscated_name which is not equal to the name,
   // erase the mapping using the old (and now invalid) deobfuscated_name from
   // the global type map.
@@ -1229,11 +1365,16 @@ void DexClass::load_class_data_item(
     uint32_t code_off = read_uleb128(&encd);
     // Find method in method index, returns same pointer for same method.
     DexMethod* dm = static_cast<DexMethod*>(idx->get_methodidx(ndex));
-    std::unique_ptr<DexCode> dc = DexCode::get_dex_code(idx, code_off);
-    if (dc && dc->get_debug_item()) {
-      dc->get_debug_item()->bind_positions(dm, m_source_file);
+    if (idx->lazy_code() && code_off != 0) {
+      dm->make_concrete(access_flags, std::unique_ptr<DexCode>(), is_virtual);
+      dm->set_lazy_code(idx, code_off, m_source_file);
+    } else {
+      std::unique_ptr<DexCode> dc = DexCode::get_dex_code(idx, code_off);
+      if (dc && dc->get_debug_item()) {
+        dc->get_debug_item()->bind_positions(dm, m_source_file);
+      }
+      dm->make_concrete(access_flags, std::move(dc), is_virtual);
     }
-    dm->make_concrete(access_flags, std::move(dc), is_virtual);
 
     const auto& pair = method_pointer_cache.insert(dm);
     bool insertion_happened = pair.second;
@@ -1258,7 +1399,11 @@ void DexClass::load_class_data_item(
   }
 }
 
-std::unique_ptr<IRCode> DexMethod::release_code() { return std::move(m_code); }
+std::unique_ptr<IRCode> DexMethod::release_code() {
+  materialize_code_if_pending();
+  mark_hash_dirty();
+  return std::move(m_code);
+}
 
 std::vector<DexMethod*> DexClass::get_all_methods() const {
   std::vector<DexMethod*> all_methods(m_vmethods.begin(), m_vmethods.end());
@@ -1267,6 +1412,7 @@ std::vector<DexMethod*> DexClass::get_all_methods() const {
 }
 
 void DexClass::add_method(DexMethod* m) {
+  mark_hash_dirty();
   always_assert_log(m->is_concrete() || m->is_external(),
                     "Method %s must be concrete",
                     SHOW(m));
@@ -1285,6 +1431,7 @@ std::vector<DexField*> DexClass::get_all_fields() const {
 }
 
 void DexClass::add_field(DexField* f) {
+  mark_hash_dirty();
   always_assert_log(f->is_concrete() || f->is_external(),
                     "Field %s must be concrete",
                     SHOW(f));
@@ -1298,6 +1445,8 @@ void DexClass::add_field(DexField* f) {
 }
 
 void DexClass::remove_field(const DexField* f) {
+  mark_hash_dirty();
+  materialize_annotations_if_pending();
   bool is_static = f->get_access() & DexAccessFlags::ACC_STATIC;
   auto& fields = is_static ? m_sfields : m_ifields;
   DEBUG_ONLY bool erase = false;
@@ -1310,11 +1459,13 @@ void DexClass::remove_field(const DexField* f) {
 }
 
 void DexClass::remove_field_definition(DexField* f) {
+  mark_hash_dirty();
   remove_field(f);
   f->m_concrete = false;
 }
 
 void DexClass::sort_fields() {
+  mark_hash_dirty();
   auto& sfields = this->get_sfields();
   auto& ifields = this->get_ifields();
   std::sort(sfields.begin(), sfields.end(), compare_dexfields);
@@ -1322,6 +1473,7 @@ void DexClass::sort_fields() {
 }
 
 void DexClass::sort_methods() {
+  mark_hash_dirty();
   auto& vmeths = this->get_vmethods();
   auto& dmeths = this->get_dmethods();
   std::sort(vmeths.begin(), vmeths.end(), compare_dexmethods);
@@ -1433,6 +1585,9 @@ int DexClass::encode(DexOutputIdx* dodx,
 
 void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
   if (anno_off == 0) return;
+  // When decoding is deferred, the members are concrete by now, which the
+  // public attach methods reject, so their annotations are set directly.
+  bool deferred = m_annotations_pending.load(std::memory_order_relaxed);
   const dex_annotations_directory_item* annodir =
       idx->get_data<dex_annotations_directory_item>(anno_off);
   m_anno =
@@ -1448,6 +1603,12 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
     uint32_t off = *annodata++;
     DexField* field = static_cast<DexField*>(idx->get_fieldidx(fidx));
     auto aset = DexAnnotationSet::get_annotation_set(idx, off);
+    if (deferred) {
+      always_assert_type_log(field->m_anno == nullptr, INVALID_DEX,
+                             "Failed to attach annotation set");
+      field->m_anno = std::move(aset);
+      continue;
+    }
     auto res = field->attach_annotation_set(std::move(aset));
     always_assert_type_log(res, INVALID_DEX, "Failed to attach annotation set");
   }
@@ -1461,6 +1622,12 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
     uint32_t off = *annodata++;
     DexMethod* method = static_cast<DexMethod*>(idx->get_methodidx(midx));
     auto aset = DexAnnotationSet::get_annotation_set(idx, off);
+    if (deferred) {
+      always_assert_type_log(method->m_anno == nullptr, INVALID_DEX,
+                             "Failed to attach method set");
+      method->m_anno = std::move(aset);
+      continue;
+    }
     auto res = method->attach_annotation_set(std::move(aset));
     always_assert_type_log(res, INVALID_DEX, "Failed to attach method set");
   }
@@ -1483,7 +1650,12 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
       for (uint32_t j = 0; j < count; j++) {
         uint32_t off = annoxref[j];
         auto aset = DexAnnotationSet::get_annotation_set(idx, off);
-        if (aset != nullptr) {
+        if (aset != nullptr && deferred) {
+          if (method->m_param_anno == nullptr) {
+            method->m_param_anno = std::make_unique<ParamAnnotations>();
+          }
+          (*method->m_param_anno)[j] = std::move(aset);
+        } else if (aset != nullptr) {
           method->attach_param_annotation_set(j, std::move(aset));
           redex_assert(CONSTP(method)->get_param_anno());
         }
@@ -1492,7 +1664,54 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
   }
 }
 
+namespace {
+
+// Guards the decoding of lazily loaded annotations, like s_lazy_code_locks.
+std::array<std::mutex, 256> s_lazy_anno_locks;
+
+// Set while the current thread decodes annotations. Attaching them goes
+// through the member accessors, which must not try to decode again.
+thread_local bool t_materializing_annotations{false};
+
+} // namespace
+
+std::atomic<size_t> lazy_annotations::g_num_pending_classes{0};
+
+void lazy_annotations::materialize_class(const DexType* type) {
+  if (t_materializing_annotations) {
+    return;
+  }
+  if (auto* cls = type_class(type)) {
+    cls->materialize_annotations_if_pending();
+  }
+}
+
+void DexClass::materialize_annotations() const {
+  auto* that = const_cast<DexClass*>(this);
+  auto& lock = s_lazy_anno_locks[std::hash<const DexClass*>()(this) %
+                                 s_lazy_anno_locks.size()];
+  std::lock_guard<std::mutex> lock_guard(lock);
+  if (!m_annotations_pending.load(std::memory_order_relaxed)) {
+    // Another thread got here first.
+    return;
+  }
+  t_materializing_annotations = true;
+  try {
+    that->load_class_annotations(m_lazy_anno_idx, m_lazy_anno_off);
+  } catch (...) {
+    t_materializing_annotations = false;
+    throw;
+  }
+  t_materializing_annotations = false;
+  that->m_lazy_anno_idx = nullptr;
+  m_annotations_pending.store(false, std::memory_order_release);
+  lazy_annotations::g_num_pending_classes.fetch_sub(1,
+                                                    std::memory_order_release);
+}
+
 void DexClass::combine_annotations_with(DexAnnotationSet* other) {
+  mark_hash_dirty();
+  materialize_annotations_if_pending();
   if (other != nullptr) {
     if (m_anno == nullptr) {
       m_anno = std::make_unique<DexAnnotationSet>(*other);
@@ -1507,11 +1726,17 @@ void DexClass::combine_annotations_with(DexClass* other) {
 }
 
 bool DexClass::attach_annotation_set(std::unique_ptr<DexAnnotationSet> anno) {
+  mark_hash_dirty();
+  materialize_annotations_if_pending();
   m_anno = std::move(anno);
   return true;
 }
 
-void DexClass::clear_annotations() { m_anno.reset(); }
+void DexClass::clear_annotations() {
+  mark_hash_dirty();
+  materialize_annotations_if_pending();
+  m_anno.reset();
+}
 
 static std::unique_ptr<DexEncodedValueArray> load_static_values(
     DexIdx* idx, uint32_t sv_off) {
@@ -1542,6 +1767,7 @@ std::unique_ptr<DexEncodedValueArray> DexClass::get_static_values() {
 }
 
 DexAnnotationDirectory* DexClass::get_annotation_directory() {
+  materialize_annotations_if_pending();
   /* First scan to see what types of annotations to scan for if any.
    */
   std::unique_ptr<DexFieldAnnotations> fanno = nullptr;
@@ -1642,7 +1868,16 @@ DexClass* DexClass::create(DexIdx* idx,
     // parallel, for example).
     return nullptr;
   }
-  cls->load_class_annotations(idx, cdef->annotations_off);
+  if (idx->lazy_annotations() && cdef->annotations_off != 0) {
+    // Decoded on first access, see materialize_annotations().
+    cls->m_lazy_anno_idx = idx;
+    cls->m_lazy_anno_off = cdef->annotations_off;
+    cls->m_annotations_pending.store(true, std::memory_order_relaxed);
+    lazy_annotations::g_num_pending_classes.fetch_add(
+        1, std::memory_order_relaxed);
+  } else {
+    cls->load_class_annotations(idx, cdef->annotations_off);
+  }
   auto deva = std::unique_ptr<DexEncodedValueArray>(
       load_static_values(idx, cdef->static_values_off));
   cls->load_class_data_item(idx, cdef->class_data_offset, std::move(deva));
@@ -1650,6 +1885,14 @@ DexClass* DexClass::create(DexIdx* idx,
   return cls.release();
 }
 
+uint32_t DexClass::next_dense_index() {
+  return s_num_class_dense_indices.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t DexClass::num_dense_indices() {
+  return s_num_class_dense_indices.load(std::memory_order_relaxed);
+}
+
 DexClass::DexClass(DexType* type, const DexLocation* location)
     : m_super_class(nullptr),
       m_self(type),
@@ -1684,11 +1927,16 @@ DexClass::DexClass(DexType* super_type,
       m_perf_sensitive(PerfSensitiveGroup::NONE),
       m_dynamically_dead(false) {}
 
-DexClass::~DexClass() = default; // For forwarding.
+DexClass::~DexClass() {
+  if (m_annotations_pending.load(std::memory_order_relaxed)) {
+    lazy_annotations::g_num_pending_classes.fetch_sub(
+        1, std::memory_order_release);
+  }
+}
 
 template <typename C>
 void DexTypeList::gather_types(C& ltype) const {
-  c_append_all(ltype, m_list.begin(), m_list.end());
+  c_append_all(ltype, m_repr.list.begin(), m_repr.list.end());
 }
 INSTANTIATE(DexTypeList::gather_types, DexType*)
 
@@ -1723,24 +1971,24 @@ bool DexProto::is_void() const { return get_rtype() == type::_void(); }
 
 template <typename C>
 void DexProto::gather_types(C& ltype) const {
-  if (m_args) {
-    m_args->gather_types(ltype);
+  if (m_repr.args) {
+    m_repr.args->gather_types(ltype);
   }
-  if (m_rtype) {
-    c_append(ltype, m_rtype);
+  if (m_repr.rtype) {
+    c_append(ltype, m_repr.rtype);
   }
 }
 INSTANTIATE(DexProto::gather_types, DexType*)
 
 void DexProto::gather_strings(std::vector<const DexString*>& lstring) const {
-  if (m_shorty) {
-    c_append(lstring, m_shorty);
+  if (m_repr.shorty) {
+    c_append(lstring, m_repr.shorty);
   }
 }
 void DexProto::gather_strings(
     std::unordered_set<const DexString*>& lstring) const {
-  if (m_shorty) {
-    c_append(lstring, m_shorty);
+  if (m_repr.shorty) {
+    c_append(lstring, m_repr.shorty);
   }
 }
 
@@ -1773,6 +2021,7 @@ void DexClass::gather_types(C& ltype) const {
   ltype.insert(ltype.end(), m_super_class);
   ltype.insert(ltype.end(), m_self);
   if (m_interfaces) m_interfaces->gather_types(ltype);
+  materialize_annotations_if_pending();
   if (m_anno) {
     std::vector<DexType*> type_vec;
     m_anno->gather_types(type_vec);
@@ -1845,6 +2094,7 @@ void DexClass::gather_strings_internal(C& lstring, bool exclude_loads) const {
     f->gather_strings(lstring);
   }
   if (m_source_file) c_append(lstring, m_source_file);
+  materialize_annotations_if_pending();
   if (m_anno) {
     std::vector<const DexString*> strings;
     m_anno->gather_strings(strings);
@@ -1876,6 +2126,7 @@ void DexClass::gather_fields(C& lfield) const {
     lfield.insert(lfield.end(), f);
     f->gather_fields(lfield);
   }
+  materialize_annotations_if_pending();
   if (m_anno) {
     std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
     m_anno->gather_fields(fields_vec);
@@ -1900,6 +2151,7 @@ void DexClass::gather_methods(C& lmethod) const {
   for (auto const& f : m_ifields) {
     f->gather_methods(lmethod);
   }
+  materialize_annotations_if_pending();
   if (m_anno) {
     std::vector<DexMethodRef*> method_vec; // Simplify refactor.
     m_anno->gather_methods(method_vec);
@@ -1997,7 +2249,7 @@ template <typename C>
 void DexField::gather_types(C& ltype) const {
   std::vector<DexType*> type_vec;
   if (m_value) m_value->gather_types(type_vec);
-  if (m_anno) m_anno->gather_types(type_vec);
+  if (auto* anno = get_anno_set()) anno->gather_types(type_vec);
   c_append_all(ltype, type_vec.begin(), type_vec.end());
 }
 INSTANTIATE(DexField::gather_types, DexType*)
@@ -2006,7 +2258,7 @@ template <typename C>
 void DexField::gather_strings_internal(C& lstring) const {
   std::vector<const DexString*> string_vec;
   if (m_value) m_value->gather_strings(string_vec);
-  if (m_anno) m_anno->gather_strings(string_vec);
+  if (auto* anno = get_anno_set()) anno->gather_strings(string_vec);
   c_append_all(lstring, string_vec.begin(), string_vec.end());
 }
 void DexField::gather_strings(std::vector<const DexString*>& lstring) const {
@@ -2021,7 +2273,7 @@ template <typename C>
 void DexField::gather_fields(C& lfield) const {
   std::vector<DexFieldRef*> field_vec;
   if (m_value) m_value->gather_fields(field_vec);
-  if (m_anno) m_anno->gather_fields(field_vec);
+  if (auto* anno = get_anno_set()) anno->gather_fields(field_vec);
   c_append_all(lfield, field_vec.begin(), field_vec.end());
 }
 INSTANTIATE(DexField::gather_fields, DexFieldRef*)
@@ -2030,7 +2282,7 @@ template <typename C>
 void DexField::gather_methods(C& lmethod) const {
   std::vector<DexMethodRef*> method_vec;
   if (m_value) m_value->gather_methods(method_vec);
-  if (m_anno) m_anno->gather_methods(method_vec);
+  if (auto* anno = get_anno_set()) anno->gather_methods(method_vec);
   c_append_all(lmethod, method_vec.begin(), method_vec.end());
 }
 INSTANTIATE(DexField::gather_methods, DexMethodRef*)
@@ -2040,6 +2292,7 @@ std::string DexField::get_simple_deobfuscated_name() const {
 }
 
 void DexMethod::set_external() {
+  mark_hash_dirty();
   always_assert_log(!m_concrete, "Unexpected concrete method %s\n",
                     self_show().c_str());
   m_deobfuscated_name = DexString::make_string(self_show());
@@ -2050,8 +2303,8 @@ template <typename C>
 void DexMethod::gather_types(C& ltype) const {
   gather_types_shallow(ltype); // Handle DexMethodRef parts.
   std::vector<DexType*> type_vec; // Simplify refactor.
-  if (m_code) m_code->gather_types(type_vec);
-  if (m_anno) m_anno->gather_types(type_vec);
+  if (get_code()) get_code()->gather_types(type_vec);
+  if (auto* anno = get_anno_set()) anno->gather_types(type_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
     for (auto& pair : *param_anno) {
@@ -2064,15 +2317,15 @@ void DexMethod::gather_types(C& ltype) const {
 INSTANTIATE(DexMethod::gather_types, DexType*)
 
 void DexMethod::gather_init_classes(std::vector<DexType*>& ltype) const {
-  if (m_code) m_code->gather_init_classes(ltype);
+  if (get_code()) get_code()->gather_init_classes(ltype);
 }
 
 template <typename C>
 void DexMethod::gather_callsites(C& lcallsite) const {
   // We handle m_spec.cls and proto in the first-layer gather.
-  if (m_code) {
+  if (get_code()) {
     std::vector<DexCallSite*> callsite_vec; // Simplify refactor.
-    m_code->gather_callsites(callsite_vec);
+    get_code()->gather_callsites(callsite_vec);
     c_append_all(lcallsite, callsite_vec.begin(), callsite_vec.end());
   }
 }
@@ -2082,7 +2335,7 @@ template <typename C>
 void DexMethod::gather_methodhandles(C& lmethodhandle) const {
   // We handle m_spec.cls and proto in the first-layer gather.
   std::vector<DexMethodHandle*> mhandles_vec; // Simplify refactor.
-  if (m_code) m_code->gather_methodhandles(mhandles_vec);
+  if (get_code()) get_code()->gather_methodhandles(mhandles_vec);
   c_append_all(lmethodhandle, mhandles_vec.begin(), mhandles_vec.end());
 }
 INSTANTIATE(DexMethod::gather_methodhandles, DexMethodHandle*)
@@ -2090,8 +2343,8 @@ template <typename C>
 void DexMethod::gather_strings_internal(C& lstring, bool exclude_loads) const {
   // We handle m_name and proto in the first-layer gather.
   std::vector<const DexString*> strings_vec; // Simplify refactor.
-  if (m_code && !exclude_loads) m_code->gather_strings(strings_vec);
-  if (m_anno) m_anno->gather_strings(strings_vec);
+  if (get_code() && !exclude_loads) get_code()->gather_strings(strings_vec);
+  if (auto* anno = get_anno_set()) anno->gather_strings(strings_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
     for (auto& pair : *param_anno) {
@@ -2113,8 +2366,8 @@ void DexMethod::gather_strings(std::unordered_set<const DexString*>& lstring,
 template <typename C>
 void DexMethod::gather_fields(C& lfield) const {
   std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
-  if (m_code) m_code->gather_fields(fields_vec);
-  if (m_anno) m_anno->gather_fields(fields_vec);
+  if (get_code()) get_code()->gather_fields(fields_vec);
+  if (auto* anno = get_anno_set()) anno->gather_fields(fields_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
     for (auto& pair : *param_anno) {
@@ -2128,9 +2381,9 @@ INSTANTIATE(DexMethod::gather_fields, DexFieldRef*)
 
 template <typename C>
 void DexMethod::gather_methods(C& lmethod) const {
-  if (m_code) {
+  if (get_code()) {
     std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-    m_code->gather_methods(method_vec);
+    get_code()->gather_methods(method_vec);
     c_append_all(lmethod, method_vec.begin(), method_vec.end());
   }
   gather_methods_from_annos(lmethod);
@@ -2140,7 +2393,7 @@ INSTANTIATE(DexMethod::gather_methods, DexMethodRef*)
 template <typename C>
 void DexMethod::gather_methods_from_annos(C& lmethod) const {
   std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-  if (m_anno) m_anno->gather_methods(method_vec);
+  if (auto* anno = get_anno_set()) anno->gather_methods(method_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
     for (auto& pair : *param_anno) {
@@ -2236,6 +2489,7 @@ DexProto* DexType::get_non_overlapping_proto(const DexString* method_name,
 }
 
 void DexMethod::add_load_params(size_t num_add_loads) {
+  mark_hash_dirty();
   IRCode* code = this->get_code();
   always_assert_log(code, "Method don't have IRCode\n");
   always_assert_log(code->editable_cfg_built(),
@@ -2269,41 +2523,61 @@ void gather_components(std::vector<const DexString*>& lstring,
                        std::vector<DexMethodHandle*>& lmethodhandle,
                        const DexClasses& classes,
                        bool exclude_loads) {
-  // Gather references reachable from each class.
-  std::unordered_set<const DexString*> strings;
-  std::unordered_set<DexType*> types;
-  std::unordered_set<DexFieldRef*> fields;
-  std::unordered_set<DexMethodRef*> methods;
-  std::unordered_set<DexCallSite*> callsites;
-  std::unordered_set<DexMethodHandle*> methodhandles;
-  // Inside a lambda to ensure only visibility of the sets.
-  [&classes, &exclude_loads, &strings, &types, &fields, &methods, &callsites,
-   &methodhandles]() {
-    for (auto const& cls : classes) {
-      cls->gather_strings(strings, exclude_loads);
-      cls->gather_types(types);
-      cls->gather_fields(fields);
-      cls->gather_methods(methods);
-      cls->gather_callsites(callsites);
-      cls->gather_methodhandles(methodhandles);
-    }
-
-    // Gather types and strings needed for field and method refs.
-    for (auto meth : methods) {
-      meth->gather_types_shallow(types);
-      meth->gather_strings_shallow(strings);
-    }
-
-    for (auto field : fields) {
-      field->gather_types_shallow(types);
-      field->gather_strings_shallow(strings);
-    }
-
-    // Gather strings needed for each type.
-    for (auto type : types) {
-      if (type) strings.insert(type->get_name());
-    }
-  }();
+  // Gather references reachable from each class. Classes are gathered in
+  // parallel, with one set of references per worker that are merged at the
+  // end.
+  struct References {
+    std::unordered_set<const DexString*> strings;
+    std::unordered_set<DexType*> types;
+    std::unordered_set<DexFieldRef*> fields;
+    std::unordered_set<DexMethodRef*> methods;
+    std::unordered_set<DexCallSite*> callsites;
+    std::unordered_set<DexMethodHandle*> methodhandles;
+  };
+  std::vector<References> per_worker(std::max<size_t>(
+      1,
+      std::min<size_t>(classes.size(), redex_parallel::default_num_threads())));
+  workqueue_run_for<size_t>(0, per_worker.size(), [&](size_t worker) {
+    auto& refs = per_worker[worker];
+    for (size_t i = worker; i < classes.size(); i += per_worker.size()) {
+      auto* cls = classes[i];
+      cls->gather_strings(refs.strings, exclude_loads);
+      cls->gather_types(refs.types);
+      cls->gather_fields(refs.fields);
+      cls->gather_methods(refs.methods);
+      cls->gather_callsites(refs.callsites);
+      cls->gather_methodhandles(refs.methodhandles);
+    }
+  });
+  auto refs = std::move(per_worker[0]);
+  for (size_t worker = 1; worker < per_worker.size(); worker++) {
+    auto& other = per_worker[worker];
+    refs.strings.insert(other.strings.begin(), other.strings.end());
+    refs.types.insert(other.types.begin(), other.types.end());
+    refs.fields.insert(other.fields.begin(), other.fields.end());
+    refs.methods.insert(other.methods.begin(), other.methods.end());
+    refs.callsites.insert(other.callsites.begin(), other.callsites.end());
+    refs.methodhandles.insert(other.methodhandles.begin(),
+                              other.methodhandles.end());
+  }
+  per_worker.clear();
+  auto& [strings, types, fields, methods, callsites, methodhandles] = refs;
+
+  // Gather types and strings needed for field and method refs.
+  for (auto meth : methods) {
+    meth->gather_types_shallow(types);
+    meth->gather_strings_shallow(strings);
+  }
+
+  for (auto field : fields) {
+    field->gather_types_shallow(types);
+    field->gather_strings_shallow(strings);
+  }
+
+  // Gather strings needed for each type.
+  for (auto type : types) {
+    if (type) strings.insert(type->get_name());
+  }
 
   lstring.insert(lstring.end(), strings.begin(), strings.end());
   ltype.insert(ltype.end(), types.begin(), types.end());
@@ -2394,4 +2668,3 @@ dex_member_refs::MethodDescriptorTokens DexMethodRef::get_descriptor_tokens()
   return res;
 }
 
-DexClass* type_class(const DexType* t) { return g_redex->type_class(t); }
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -80,6 +81,33 @@ constexpr bool kInsertDeobfuscatedNameLinks = false;
 
 using Scope = std::vector<DexClass*>;
 
+namespace hashing {
+// Drops all class hashes cached for incremental scope hashing. Used by
+// mutations whose effect is not confined to a single class, e.g. renames of
+// referenced members and types. See DexHasher.h.
+void invalidate_cached_hashes();
+// Counts the calls to invalidate_cached_hashes(), so that other incremental
+// computations can tell whether such a mutation happened in between.
+uint64_t cached_hashes_epoch();
+} // namespace hashing
+
+namespace lazy_annotations {
+// The number of loaded classes whose annotations are not decoded yet, see
+// RedexContext::lazy_dex_annotations. Member annotation accessors check this
+// first, so that they cost a single load once nothing is pending.
+extern std::atomic<size_t> g_num_pending_classes;
+
+// Decodes the annotations of the class of the given type, and of its members,
+// if that has not happened yet.
+void materialize_class(const DexType* type);
+
+inline void materialize_if_pending(const DexType* type) {
+  if (g_num_pending_classes.load(std::memory_order_acquire) != 0) {
+    materialize_class(type);
+  }
+}
+} // namespace lazy_annotations
+
 #if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
 extern "C" bool strcmp_less(const char* str1, const char* str2);
 #endif
@@ -197,9 +225,13 @@ struct dexstrings_comparator {
 
 class DexType {
   friend struct RedexContext;
+  friend DexClass* type_class(const DexType* t);
 
   const DexString* m_name;
   std::atomic<DexClass*> m_self{nullptr};
+  uint32_t m_dense_index{next_dense_index()};
+
+  static uint32_t next_dense_index();
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   explicit DexType(const DexString* dstring) { m_name = dstring; }
@@ -243,6 +275,13 @@ class DexType {
   std::string_view str() const { return get_name()->str(); }
   std::string str_copy() const { return get_name()->str_copy(); }
   DexProto* get_non_overlapping_proto(const DexString*, DexProto*);
+
+  // Types are numbered densely in creation order, like field and method
+  // references (see DexMethodRef::get_dense_index()).
+  uint32_t get_dense_index() const { return m_dense_index; }
+
+  // All types created so far have a dense index below this.
+  static uint32_t num_dense_indices();
 };
 
 /* Non-optimizing DexSpec compliant ordering */
@@ -280,6 +319,13 @@ class DexFieldRef {
   DexFieldSpec m_spec;
   bool m_concrete;
   bool m_external;
+  // Fits into the padding after the flags.
+  uint32_t m_dense_index{next_dense_index()};
+
+ private:
+  static uint32_t next_dense_index();
+
+ protected:
 
   virtual ~DexFieldRef() {}
   DexFieldRef(DexType* container, const DexString* name, DexType* type) {
@@ -308,6 +354,13 @@ class DexFieldRef {
   std::string str_copy() const { return get_name()->str_copy(); }
   DexType* get_type() const { return m_spec.type; }
 
+  // Field references are numbered densely in creation order, so that sets of
+  // them can be represented as bitsets (see reachability::ReachableObjects).
+  uint32_t get_dense_index() const { return m_dense_index; }
+
+  // All field references created so far have a dense index below this.
+  static uint32_t num_dense_indices();
+
   template <typename C>
   void gather_types_shallow(C& ltype) const;
   void gather_strings_shallow(std::vector<const DexString*>& lstring) const;
@@ -338,18 +391,24 @@ class DexFieldRef {
 class DexField : public DexFieldRef {
   friend struct RedexContext;
   friend class DexFieldRef;
+  friend class DexClass;
 
   /* Concrete method members */
   DexAccessFlags m_access;
   std::unique_ptr<DexAnnotationSet> m_anno;
   std::unique_ptr<DexEncodedValue> m_value; /* Static Only */
-  std::string m_deobfuscated_name;
+  // Interned like the names of methods and classes, which keeps fields small.
+  const DexString* m_deobfuscated_name{nullptr};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexField(DexType* container, const DexString* name, DexType* type);
 
   std::string self_show() const; // To avoid "Show.h" in the header.
 
+  // Fields have no dirty bits of their own; they are hashed as part of their
+  // class (see DexClass::is_hash_dirty()).
+  void mark_class_hash_dirty() const;
+
  public:
   DexField() = delete;
   DexField(DexField&&) = delete;
@@ -395,8 +454,20 @@ class DexField : public DexFieldRef {
     return ret;
   }
 
-  DexAnnotationSet* get_anno_set() const { return m_anno.get(); }
-  DexEncodedValue* get_static_value() const { return m_value.get(); }
+  const DexAnnotationSet* get_anno_set() const {
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_anno.get();
+  }
+  DexAnnotationSet* get_anno_set() {
+    mark_class_hash_dirty();
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_anno.get();
+  }
+  const DexEncodedValue* get_static_value() const { return m_value.get(); }
+  DexEncodedValue* get_static_value() {
+    mark_class_hash_dirty();
+    return m_value.get();
+  }
   DexAccessFlags get_access() const {
     always_assert(is_def());
     return m_access;
@@ -405,20 +476,34 @@ class DexField : public DexFieldRef {
   void set_access(DexAccessFlags access) {
     always_assert_log(!m_external, "Unexpected external field %s\n",
                       self_show().c_str());
+    hashing::invalidate_cached_hashes();
     m_access = access;
   }
 
   void set_external();
 
-  void set_deobfuscated_name(std::string name) {
-    m_deobfuscated_name = std::move(name);
+  void set_deobfuscated_name(std::string_view name) {
+    set_deobfuscated_name(DexString::make_string(name));
   }
-  const std::string& get_deobfuscated_name() const {
-    return m_deobfuscated_name;
+  void set_deobfuscated_name(const DexString* name) {
+    hashing::invalidate_cached_hashes();
+    m_deobfuscated_name = name;
+  }
+  std::string_view get_deobfuscated_name() const {
+    return get_deobfuscated_name_or_empty();
   }
-  const std::string& get_deobfuscated_name_or_empty() const {
+  const DexString* get_deobfuscated_name_or_null() const {
     return m_deobfuscated_name;
   }
+  std::string_view get_deobfuscated_name_or_empty() const {
+    if (m_deobfuscated_name == nullptr) {
+      return DexString::EMPTY;
+    }
+    return m_deobfuscated_name->str();
+  }
+  std::string get_deobfuscated_name_or_empty_copy() const {
+    return ::str_copy(get_deobfuscated_name_or_empty());
+  }
 
   // Return just the name of the field.
   std::string get_simple_deobfuscated_name() const;
@@ -467,6 +552,12 @@ struct dexfields_comparator {
   }
 };
 
+struct DexTypeListRepr {
+  std::vector<DexType*> list;
+  // Of the list contents, computed once when interning.
+  size_t hash;
+};
+
 class DexTypeList {
  public:
   using ContainerType = std::vector<DexType*>;
@@ -475,13 +566,13 @@ class DexTypeList {
   using iterator = typename ContainerType::iterator;
   using const_iterator = typename ContainerType::const_iterator;
 
-  const_iterator begin() const { return m_list.begin(); }
-  const_iterator end() const { return m_list.end(); }
+  const_iterator begin() const { return m_repr.list.begin(); }
+  const_iterator end() const { return m_repr.list.end(); }
 
-  size_t size() const { return m_list.size(); }
-  bool empty() const { return m_list.empty(); }
+  size_t size() const { return m_repr.list.size(); }
+  bool empty() const { return m_repr.list.empty(); }
 
-  DexType* at(size_t i) const { return m_list.at(i); }
+  DexType* at(size_t i) const { return m_repr.list.at(i); }
 
   // DexTypeList retrieval/creation
 
@@ -499,11 +590,11 @@ class DexTypeList {
   int encode(DexOutputIdx* dodx, uint32_t* output) const;
 
   friend bool operator<(const DexTypeList& a, const DexTypeList& b) {
-    auto ita = a.m_list.begin();
-    auto itb = b.m_list.begin();
+    auto ita = a.m_repr.list.begin();
+    auto itb = b.m_repr.list.begin();
     while (1) {
-      if (itb == b.m_list.end()) return false;
-      if (ita == a.m_list.end()) return true;
+      if (itb == b.m_repr.list.end()) return false;
+      if (ita == a.m_repr.list.end()) return true;
       if (*ita != *itb) {
         const DexType* ta = *ita;
         const DexType* tb = *itb;
@@ -518,7 +609,8 @@ class DexTypeList {
   void gather_types(C& ltype) const;
 
   bool equals(const std::vector<DexType*>& vec) const {
-    return std::equal(m_list.begin(), m_list.end(), vec.begin(), vec.end());
+    return std::equal(m_repr.list.begin(), m_repr.list.end(), vec.begin(),
+                      vec.end());
   }
 
   DexTypeList* push_front(DexType* t) const;
@@ -532,10 +624,12 @@ class DexTypeList {
   DexTypeList* replace_head(DexType* new_head) const;
 
  private:
-  // See UNIQUENESS above for the rationale for the private constructor pattern.
-  explicit DexTypeList(ContainerType list) : m_list(std::move(list)) {}
+  // Only ever created in place by RedexContext, see UNIQUENESS above.
+  DexTypeList() = delete;
+  DexTypeList(DexTypeList&&) = delete;
+  DexTypeList(const DexTypeList&) = delete;
 
-  const ContainerType m_list;
+  const DexTypeListRepr m_repr;
 
   friend struct RedexContext;
 };
@@ -555,19 +649,20 @@ struct dextypelists_comparator {
   }
 };
 
+struct DexProtoRepr {
+  DexTypeList* args;
+  DexType* rtype;
+  const DexString* shorty;
+};
+
 class DexProto {
   friend struct RedexContext;
 
-  DexTypeList* m_args;
-  DexType* m_rtype;
-  const DexString* m_shorty;
+  DexProtoRepr m_repr;
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
-  DexProto(DexType* rtype, DexTypeList* args, const DexString* shorty) {
-    m_rtype = rtype;
-    m_args = args;
-    m_shorty = shorty;
-  }
+  DexProto(DexType* rtype, DexTypeList* args, const DexString* shorty)
+      : m_repr({args, rtype, shorty}) {}
 
  public:
   DexProto() = delete;
@@ -587,9 +682,9 @@ class DexProto {
   // Return an existing DexProto or nullptr if one does not exist.
   static DexProto* get_proto(const DexType* rtype, const DexTypeList* args);
 
-  DexType* get_rtype() const { return m_rtype; }
-  DexTypeList* get_args() const { return m_args; }
-  const DexString* get_shorty() const { return m_shorty; }
+  DexType* get_rtype() const { return m_repr.rtype; }
+  DexTypeList* get_args() const { return m_repr.args; }
+  const DexString* get_shorty() const { return m_repr.shorty; }
   bool is_void() const;
 
   template <typename C>
@@ -714,6 +809,7 @@ struct DexTryItem {
 };
 
 class IRCode;
+struct LazyDexCode;
 
 class DexCode {
   friend class DexMethod;
@@ -821,6 +917,13 @@ class DexMethodRef {
   DexMethodSpec m_spec;
   bool m_concrete;
   bool m_external;
+  // Fits into the padding after the flags.
+  uint32_t m_dense_index{next_dense_index()};
+
+ private:
+  static uint32_t next_dense_index();
+
+ protected:
 
   ~DexMethodRef() {}
   DexMethodRef(DexType* type, const DexString* name, DexProto* proto)
@@ -847,6 +950,13 @@ class DexMethodRef {
   std::string str_copy() const { return get_name()->str_copy(); }
   DexProto* get_proto() const { return m_spec.proto; }
 
+  // Method references are numbered densely in creation order, so that sets of
+  // them can be represented as bitsets (see reachability::ReachableObjects).
+  uint32_t get_dense_index() const { return m_dense_index; }
+
+  // All method references created so far have a dense index below this.
+  static uint32_t num_dense_indices();
+
   template <typename C>
   void gather_types_shallow(C& ltype) const;
   void gather_strings_shallow(std::vector<const DexString*>& lstring) const;
@@ -875,16 +985,30 @@ class DexMethodRef {
 class DexMethod : public DexMethodRef {
   friend struct RedexContext;
   friend class DexMethodRef;
+  friend class DexClass;
 
   /* Concrete method members */
 
   // Place these first to avoid/fill padding from DexMethodRef.
   bool m_virtual{false};
+  // See is_hash_dirty().
+  std::atomic<bool> m_hash_dirty{true};
   DexAccessFlags m_access;
+  // See is_references_dirty().
+  std::atomic<bool> m_references_dirty{true};
+  // See is_type_check_dirty().
+  std::atomic<bool> m_type_check_dirty{true};
+  // See is_assessment_dirty().
+  std::atomic<bool> m_assessment_dirty{true};
+  // See is_property_check_dirty().
+  std::atomic<bool> m_property_check_dirty{true};
+  // Whether m_lazy_code still has to be decoded; see materialize_code().
+  mutable std::atomic<bool> m_code_pending{false};
 
   std::unique_ptr<DexAnnotationSet> m_anno;
   std::unique_ptr<DexCode> m_dex_code;
   std::unique_ptr<IRCode> m_code;
+  std::unique_ptr<LazyDexCode> m_lazy_code;
   std::unique_ptr<ParamAnnotations> m_param_anno;
   const DexString* m_deobfuscated_name{nullptr};
 
@@ -899,6 +1023,16 @@ class DexMethod : public DexMethodRef {
 
   std::string self_show() const; // To avoid "Show.h" in the header.
 
+  // Decodes and balloons the code that was deferred by set_lazy_code(), if
+  // that has not happened yet. Safe to call concurrently.
+  void materialize_code() const;
+  void materialize_code_if_pending() const {
+    if (m_code_pending.load(std::memory_order_acquire)) {
+      materialize_code();
+    }
+  }
+  void discard_lazy_code();
+
  public:
   DexMethod() = delete;
   DexMethod(DexMethodRef&&) = delete;
@@ -991,20 +1125,45 @@ class DexMethod : public DexMethodRef {
     return ret;
   }
 
-  const DexAnnotationSet* get_anno_set() const { return m_anno.get(); }
-  DexAnnotationSet* get_anno_set() { return m_anno.get(); }
+  const DexAnnotationSet* get_anno_set() const {
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_anno.get();
+  }
+  DexAnnotationSet* get_anno_set() {
+    mark_hash_dirty();
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_anno.get();
+  }
   const DexCode* get_dex_code() const { return m_dex_code.get(); }
   DexCode* get_dex_code() { return m_dex_code.get(); }
-  IRCode* get_code() { return m_code.get(); }
-  const IRCode* get_code() const { return m_code.get(); }
+  // Whether the code was loaded lazily and has not been accessed yet.
+  bool is_code_pending() const {
+    return m_code_pending.load(std::memory_order_acquire);
+  }
+  IRCode* get_code() {
+    materialize_code_if_pending();
+    mark_hash_dirty();
+    return m_code.get();
+  }
+  const IRCode* get_code() const {
+    materialize_code_if_pending();
+    return m_code.get();
+  }
   std::unique_ptr<IRCode> release_code();
   bool is_virtual() const { return m_virtual; }
   DexAccessFlags get_access() const {
     always_assert(is_def());
     return m_access;
   }
-  const ParamAnnotations* get_param_anno() const { return m_param_anno.get(); }
-  ParamAnnotations* get_param_anno() { return m_param_anno.get(); }
+  const ParamAnnotations* get_param_anno() const {
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_param_anno.get();
+  }
+  ParamAnnotations* get_param_anno() {
+    mark_hash_dirty();
+    lazy_annotations::materialize_if_pending(get_class());
+    return m_param_anno.get();
+  }
   std::unique_ptr<ParamAnnotations> release_param_anno();
 
   void set_deobfuscated_name(const std::string& name);
@@ -1039,19 +1198,95 @@ class DexMethod : public DexMethodRef {
   void set_access(DexAccessFlags access) {
     always_assert_log(!m_external, "Unexpected external method %s\n",
                       self_show().c_str());
+    mark_hash_dirty();
     m_access = access;
   }
 
   void set_virtual(bool is_virtual) {
     always_assert_log(!m_external, "Unexpected external method %s\n",
                       self_show().c_str());
+    mark_hash_dirty();
     m_virtual = is_virtual;
   }
 
+  // Whether the method may have been mutated since the last
+  // clear_hash_dirty(). Set by all mutators, including non-const access to
+  // the code and annotations; used for incremental scope hashing.
+  bool is_hash_dirty() const {
+    return m_hash_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_hash_dirty() {
+    m_hash_dirty.store(false, std::memory_order_relaxed);
+  }
+  void mark_hash_dirty() {
+    // Avoid writing to the cache line in the common case.
+    if (!m_hash_dirty.load(std::memory_order_relaxed)) {
+      m_hash_dirty.store(true, std::memory_order_relaxed);
+    }
+    if (!m_references_dirty.load(std::memory_order_relaxed)) {
+      m_references_dirty.store(true, std::memory_order_relaxed);
+    }
+    if (!m_type_check_dirty.load(std::memory_order_relaxed)) {
+      m_type_check_dirty.store(true, std::memory_order_relaxed);
+    }
+    if (!m_assessment_dirty.load(std::memory_order_relaxed)) {
+      m_assessment_dirty.store(true, std::memory_order_relaxed);
+    }
+    if (!m_property_check_dirty.load(std::memory_order_relaxed)) {
+      m_property_check_dirty.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // Like is_hash_dirty(), but tracked separately for the cached code
+  // references of incremental reachability computations (see
+  // reachability::MethodReferencesCache).
+  bool is_references_dirty() const {
+    return m_references_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_references_dirty() {
+    m_references_dirty.store(false, std::memory_order_relaxed);
+  }
+
+  // Like is_hash_dirty(), but tracked separately for the type checking of
+  // methods that did not change since they last passed (see the
+  // `ir_type_checker.incremental` option of the PassManager).
+  bool is_type_check_dirty() const {
+    return m_type_check_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_type_check_dirty() {
+    m_type_check_dirty.store(false, std::memory_order_relaxed);
+  }
+
+  // Like is_hash_dirty(), but tracked separately for incremental assessments
+  // (see assessments::DexScopeAssessmentCache).
+  bool is_assessment_dirty() const {
+    return m_assessment_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_assessment_dirty() {
+    m_assessment_dirty.store(false, std::memory_order_relaxed);
+  }
+
+  // Like is_hash_dirty(), but tracked separately for incremental checks of
+  // method-local properties (see redex_properties::MethodPropertyChecker).
+  bool is_property_check_dirty() const {
+    return m_property_check_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_property_check_dirty() {
+    m_property_check_dirty.store(false, std::memory_order_relaxed);
+  }
+
   void set_external();
   void set_dex_code(std::unique_ptr<DexCode> code) {
     m_dex_code = std::move(code);
   }
+  /*
+   * Defers decoding the code item at `code_off` in the dex behind `idx` until
+   * the code of this method is first accessed via get_code(). The index must
+   * stay alive until then; see RedexContext::lazy_dex_code.
+   */
+  void set_lazy_code(DexIdx* idx,
+                     uint32_t code_off,
+                     const DexString* source_file);
   void set_code(std::unique_ptr<IRCode> code);
 
   void make_non_concrete();
@@ -1165,9 +1400,22 @@ class DexClass {
   bool m_external;
   PerfSensitiveGroup m_perf_sensitive;
   bool m_dynamically_dead;
+  // See is_hash_dirty().
+  std::atomic<bool> m_hash_dirty{true};
+  // See is_assessment_dirty().
+  std::atomic<bool> m_assessment_dirty{true};
+  uint32_t m_dense_index{next_dense_index()};
+  // Where the annotations directory of a lazily loaded class is, while
+  // m_annotations_pending is set.
+  uint32_t m_lazy_anno_off{0};
+  DexIdx* m_lazy_anno_idx{nullptr};
+  mutable std::atomic<bool> m_annotations_pending{false};
+
+  static uint32_t next_dense_index();
 
   DexClass(DexType* type, const DexLocation* location);
   void load_class_annotations(DexIdx* idx, uint32_t anno_off);
+  void materialize_annotations() const;
   void load_class_data_item(DexIdx* idx,
                             uint32_t cdi_off,
                             std::unique_ptr<DexEncodedValueArray> svalues);
@@ -1266,6 +1514,13 @@ class DexClass {
   DexAccessFlags get_access() const { return m_access_flags; }
   DexType* get_super_class() const { return m_super_class; }
   DexType* get_type() const { return m_self; }
+
+  // Classes are numbered densely in creation order, so that sets of them can be
+  // represented as bitsets (see reachability::ReachableObjects).
+  uint32_t get_dense_index() const { return m_dense_index; }
+
+  // All classes created so far have a dense index below this.
+  static uint32_t num_dense_indices();
   const DexString* get_name() const { return m_self->get_name(); }
   const char* c_str() const { return get_name()->c_str(); }
   std::string_view str() const { return get_name()->str(); }
@@ -1276,10 +1531,27 @@ class DexClass {
   bool is_def() const { return true; }
   bool is_external() const { return m_external; }
   std::unique_ptr<DexEncodedValueArray> get_static_values();
-  const DexAnnotationSet* get_anno_set() const { return m_anno.get(); }
-  DexAnnotationSet* get_anno_set() { return m_anno.get(); }
+  const DexAnnotationSet* get_anno_set() const {
+    materialize_annotations_if_pending();
+    return m_anno.get();
+  }
+  DexAnnotationSet* get_anno_set() {
+    mark_hash_dirty();
+    materialize_annotations_if_pending();
+    return m_anno.get();
+  }
   [[nodiscard]] bool attach_annotation_set(
       std::unique_ptr<DexAnnotationSet> anno);
+
+  /**
+   * Decodes the annotations of this class and its members, if they were
+   * deferred at load time. The annotation accessors do this on demand.
+   */
+  void materialize_annotations_if_pending() const {
+    if (m_annotations_pending.load(std::memory_order_acquire)) {
+      materialize_annotations();
+    }
+  }
   void set_source_file(const DexString* source_file) {
     m_source_file = source_file;
   }
@@ -1315,6 +1587,7 @@ class DexClass {
   void set_access(DexAccessFlags access) {
     always_assert_log(!m_external, "Unexpected external class %s\n",
                       self_show().c_str());
+    mark_hash_dirty();
     m_access_flags = access;
   }
 
@@ -1323,6 +1596,7 @@ class DexClass {
   void set_super_class(DexType* super_class) {
     always_assert_log(!m_external, "Unexpected external class %s\n",
                       self_show().c_str());
+    mark_hash_dirty();
     m_super_class = super_class;
   }
 
@@ -1332,9 +1606,37 @@ class DexClass {
   void set_interfaces(DexTypeList* intfs) {
     always_assert_log(!m_external, "Unexpected external class %s\n",
                       self_show().c_str());
+    mark_hash_dirty();
     m_interfaces = intfs;
   }
 
+  // Whether the class itself may have been mutated since the last
+  // clear_hash_dirty(), not counting its methods (see
+  // DexMethod::is_hash_dirty()); used for incremental scope hashing.
+  bool is_hash_dirty() const {
+    return m_hash_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_hash_dirty() {
+    m_hash_dirty.store(false, std::memory_order_relaxed);
+  }
+  void mark_hash_dirty() {
+    if (!m_hash_dirty.load(std::memory_order_relaxed)) {
+      m_hash_dirty.store(true, std::memory_order_relaxed);
+    }
+    if (!m_assessment_dirty.load(std::memory_order_relaxed)) {
+      m_assessment_dirty.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // Like is_hash_dirty(), but tracked separately for incremental assessments
+  // (see assessments::DexScopeAssessmentCache).
+  bool is_assessment_dirty() const {
+    return m_assessment_dirty.load(std::memory_order_relaxed);
+  }
+  void clear_assessment_dirty() {
+    m_assessment_dirty.store(false, std::memory_order_relaxed);
+  }
+
   void clear_annotations();
   /* Encodes class_data_item, returns size in bytes.  No
    * alignment requirements on *output
@@ -1431,8 +1733,13 @@ struct dexmethods_comparator {
 /**
  * Return the DexClass that represents the DexType in input or nullptr if
  * no such DexClass exists.
+ *
+ * This is among the most frequently called functions, so it is inline: the
+ * class is published directly into the type, and the lookup is a single load.
  */
-DexClass* type_class(const DexType* t);
+inline DexClass* type_class(const DexType* t) {
+  return t ? t->m_self.load(std::memory_order_relaxed) : nullptr;
+}
 
 /**
  * Return the DexClass that represents an internal DexType or nullptr if
@@ -7,6 +7,8 @@
 
 #include "DexHasher.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <ostream>
 
@@ -35,6 +37,7 @@ class Impl final {
  public:
   explicit Impl(DexClass* cls) : m_cls(cls) {}
   DexHash run();
+  DexHash run(const DexMethod* method);
   void print(std::ostream&);
 
  private:
@@ -527,6 +530,12 @@ DexHash Impl::run() {
   return get_hash();
 }
 
+DexHash Impl::run(const DexMethod* method) {
+  TRACE(HASHER, 2, "[hasher] ==== hashing method %s", SHOW(method));
+  hash(method);
+  return get_hash();
+}
+
 void Impl::print(std::ostream& ofs) {
   hash_metadata();
   ofs << "type " << show(m_cls) << " #" << hash_to_string(m_hash) << std::endl;
@@ -564,6 +573,60 @@ std::string hash_to_string(size_t hash) {
   return result.str();
 }
 
+namespace {
+
+std::atomic<uint64_t> s_cache_epoch{0};
+
+std::vector<const void*> get_members(const DexClass* cls) {
+  std::vector<const void*> members;
+  members.reserve(cls->get_dmethods().size() + cls->get_vmethods().size() +
+                  cls->get_sfields().size() + cls->get_ifields().size() + 3);
+  auto append = [&](const auto& c) {
+    members.insert(members.end(), c.begin(), c.end());
+  };
+  append(cls->get_dmethods());
+  members.push_back(nullptr);
+  append(cls->get_vmethods());
+  members.push_back(nullptr);
+  append(cls->get_sfields());
+  members.push_back(nullptr);
+  append(cls->get_ifields());
+  return members;
+}
+
+bool is_any_hash_dirty(const DexClass* cls) {
+  auto is_dirty = [](const DexMethod* m) { return m->is_hash_dirty(); };
+  return cls->is_hash_dirty() ||
+         std::any_of(cls->get_dmethods().begin(), cls->get_dmethods().end(),
+                     is_dirty) ||
+         std::any_of(cls->get_vmethods().begin(), cls->get_vmethods().end(),
+                     is_dirty);
+}
+
+void clear_hash_dirty(DexClass* cls) {
+  cls->clear_hash_dirty();
+  for (auto* m : cls->get_dmethods()) {
+    m->clear_hash_dirty();
+  }
+  for (auto* m : cls->get_vmethods()) {
+    m->clear_hash_dirty();
+  }
+}
+
+} // namespace
+
+void invalidate_cached_hashes() {
+  s_cache_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t cached_hashes_epoch() {
+  return s_cache_epoch.load(std::memory_order_relaxed);
+}
+
+DexScopeHashCache::DexScopeHashCache()
+    : m_epoch(s_cache_epoch.load(std::memory_order_relaxed)) {}
+DexScopeHashCache::~DexScopeHashCache() = default;
+
 DexHash DexScopeHasher::run() {
   std::unordered_map<DexClass*, size_t> class_indices;
   walk::classes(m_scope, [&](DexClass* cls) {
@@ -573,16 +636,54 @@ DexHash DexScopeHasher::run() {
   std::vector<size_t> class_registers_hashes(class_indices.size());
   std::vector<size_t> class_code_hashes(class_indices.size());
   std::vector<size_t> class_signature_hashes(class_indices.size());
+
+  if (m_cache != nullptr) {
+    auto epoch = s_cache_epoch.load(std::memory_order_relaxed);
+    if (epoch != m_cache->m_epoch) {
+      m_cache->m_entries.clear();
+      m_cache->m_epoch = epoch;
+    }
+  }
+  // Newly computed entries; the cache itself is only read concurrently.
+  std::vector<std::unique_ptr<DexScopeHashCache::Entry>> new_entries(
+      m_cache != nullptr ? class_indices.size() : 0);
+
   walk::parallel::classes(m_scope, [&](DexClass* cls) {
-    Impl class_hasher(cls);
-    DexHash class_hash = class_hasher.run();
     auto index = class_indices.at(cls);
+    DexHash class_hash;
+    if (m_cache == nullptr) {
+      class_hash = Impl(cls).run();
+    } else {
+      auto members = get_members(cls);
+      auto it = m_cache->m_entries.find(cls);
+      if (it != m_cache->m_entries.end() && !is_any_hash_dirty(cls) &&
+          it->second.members == members) {
+        class_hash = it->second.hash;
+      } else {
+        class_hash = Impl(cls).run();
+        clear_hash_dirty(cls);
+        new_entries[index] = std::make_unique<DexScopeHashCache::Entry>(
+            DexScopeHashCache::Entry{class_hash, std::move(members)});
+      }
+    }
     class_positions_hashes.at(index) = class_hash.positions_hash;
     class_registers_hashes.at(index) = class_hash.registers_hash;
     class_code_hashes.at(index) = class_hash.code_hash;
     class_signature_hashes.at(index) = class_hash.signature_hash;
   });
 
+  if (m_cache != nullptr) {
+    size_t misses = 0;
+    for (auto& [cls, index] : class_indices) {
+      if (new_entries[index]) {
+        m_cache->m_entries[cls] = std::move(*new_entries[index]);
+        misses++;
+      }
+    }
+    m_cache->m_misses += misses;
+    m_cache->m_hits += class_indices.size() - misses;
+  }
+
   return DexHash{boost::hash_value(class_positions_hashes),
                  boost::hash_value(class_registers_hashes),
                  boost::hash_value(class_code_hashes),
@@ -606,6 +707,8 @@ DexHash DexClassHasher::run() { return m_fwd->run(); }
 
 void DexClassHasher::print(std::ostream& os) { m_fwd->print(os); }
 
+DexHash DexMethodHasher::run() { return Impl(nullptr).run(m_method); }
+
 void print_classes(std::ostream& output, const Scope& classes) {
   std::unordered_map<DexClass*, std::stringstream> class_strs;
   walk::classes(classes, [&](DexClass* cls) {
@@ -19,9 +19,11 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class DexClass;
+class DexMethod;
 
 using Scope = std::vector<DexClass*>;
 
@@ -36,13 +38,53 @@ struct DexHash {
   size_t signature_hash;
 };
 
+/*
+ * Remembers class hashes across scope hashes, so that only classes that may
+ * have been mutated in between need to be rehashed. A cached class hash is
+ * reused only if
+ * - neither the class nor any of its methods is marked as dirty (see
+ *   DexClass::is_hash_dirty() and DexMethod::is_hash_dirty()),
+ * - the class still has the same (ordered) methods and fields, and
+ * - no mutation invalidated all cached hashes in the meantime (see
+ *   invalidate_cached_hashes()), as renames and field changes may affect the
+ *   hashes of other classes.
+ *
+ * Non-const access to the annotations and static values of fields marks their
+ * class as dirty. Mutations through pointers that were obtained before the
+ * class hash was cached are not tracked, which is why this is not on by
+ * default.
+ */
+class DexScopeHashCache final {
+ public:
+  DexScopeHashCache();
+  ~DexScopeHashCache();
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    DexHash hash;
+    std::vector<const void*> members;
+  };
+  std::unordered_map<const DexClass*, Entry> m_entries;
+  uint64_t m_epoch;
+  size_t m_hits{0};
+  size_t m_misses{0};
+
+  friend class DexScopeHasher;
+};
+
 class DexScopeHasher final {
  public:
-  explicit DexScopeHasher(const Scope& scope) : m_scope(scope) {}
+  explicit DexScopeHasher(const Scope& scope,
+                          DexScopeHashCache* cache = nullptr)
+      : m_scope(scope), m_cache(cache) {}
   DexHash run();
 
  private:
   const Scope& m_scope;
+  DexScopeHashCache* m_cache;
 };
 
 class DexClassHasher final {
@@ -58,6 +100,20 @@ class DexClassHasher final {
   std::unique_ptr<Fwd> m_fwd;
 };
 
+/*
+ * Hashes a single method, including its code, the same way as the method is
+ * hashed as part of its class. Useful as a content key for per-method data
+ * that should survive across builds.
+ */
+class DexMethodHasher final {
+ public:
+  explicit DexMethodHasher(const DexMethod* method) : m_method(method) {}
+  DexHash run();
+
+ private:
+  const DexMethod* m_method;
+};
+
 void print_classes(std::ostream& output, const Scope& classes);
 
 } // namespace hashing
@@ -14,6 +14,7 @@
 #include "DexCallSite.h"
 #include "DexClass.h"
 #include "DexMethodHandle.h"
+#include "RedexContext.h"
 
 #define INIT_DMAP_ID(TYPE)                                                \
   always_assert_type_log(dh->TYPE##_ids_off < dh->file_size, INVALID_DEX, \
@@ -22,7 +23,13 @@
   m_##TYPE##_ids_size = dh->TYPE##_ids_size;                              \
   m_##TYPE##_cache.resize(dh->TYPE##_ids_size)
 
-DexIdx::DexIdx(const dex_header* dh) {
+DexIdx::DexIdx(const dex_header* dh,
+               bool strings_in_place,
+               bool lazy_code,
+               bool lazy_annotations)
+    : m_strings_in_place(strings_in_place),
+      m_lazy_code(lazy_code),
+      m_lazy_annotations(lazy_annotations) {
   m_dexbase = (const uint8_t*)dh;
   INIT_DMAP_ID(string);
   INIT_DMAP_ID(type);
@@ -133,8 +140,9 @@ const DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
   always_assert_type_log(null_cur < m_dexbase + get_file_size(), INVALID_DEX,
                          "Missing null terminator");
 
-  auto ret = DexString::make_string(
-      std::string_view((const char*)dstr, null_cur - dstr));
+  std::string_view str((const char*)dstr, null_cur - dstr);
+  auto ret = m_strings_in_place ? g_redex->make_string_in_place(str)
+                                : DexString::make_string(str);
   always_assert_type_log(
       ret->length() == utfsize,
       INVALID_DEX,
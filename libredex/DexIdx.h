@@ -46,6 +46,15 @@ class DexIdx {
   dex_methodhandle_id* m_methodhandle_ids;
   uint32_t m_methodhandle_ids_size{0};
 
+  // Whether new DexStrings may refer directly to the string data of the dex,
+  // which the owner then has to keep alive.
+  bool m_strings_in_place;
+  // Whether the code of methods is only decoded on first access, which
+  // requires the owner to keep this index and the dex alive.
+  bool m_lazy_code;
+  // Likewise for the annotations of classes.
+  bool m_lazy_annotations;
+
   std::vector<const DexString*> m_string_cache;
   std::vector<DexType*> m_type_cache;
   std::vector<DexFieldRef*> m_field_cache;
@@ -63,7 +72,13 @@ class DexIdx {
   DexMethodHandle* get_methodhandleidx_fromdex(uint32_t mhidx);
 
  public:
-  explicit DexIdx(const dex_header* dh);
+  explicit DexIdx(const dex_header* dh,
+                  bool strings_in_place = false,
+                  bool lazy_code = false,
+                  bool lazy_annotations = false);
+
+  bool lazy_code() const { return m_lazy_code; }
+  bool lazy_annotations() const { return m_lazy_annotations; }
 
   const DexString* get_stringidx(uint32_t stridx) {
     always_assert_type_log(
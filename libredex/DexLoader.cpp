@@ -12,8 +12,11 @@
 #include "DexCallSite.h"
 #include "DexDefs.h"
 #include "DexMethodHandle.h"
+#include "HugePages.h"
 #include "IRCode.h"
 #include "Macros.h"
+#include "RedexContext.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -21,6 +24,7 @@
 
 #include <exception>
 #include <stdexcept>
+#include <unordered_set>
 #include <vector>
 
 DexLoader::DexLoader(const DexLocation* location)
@@ -28,6 +32,16 @@ DexLoader::DexLoader(const DexLocation* location)
       m_file(new boost::iostreams::mapped_file()),
       m_location(location) {}
 
+DexLoader::~DexLoader() {
+  if (m_strings_in_place || m_lazy_code || m_lazy_annotations) {
+    g_redex->retain_mapped_file(RedexMappedFile(
+        std::move(m_file), m_location->get_file_name(), /* read_only */ true));
+  }
+  if ((m_lazy_code || m_lazy_annotations) && m_idx) {
+    g_redex->retain_dex_idx(std::move(m_idx));
+  }
+}
+
 namespace {
 
 // Lazy eval system. Because of the map interface this is a bit
@@ -321,6 +335,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
         clz->get_vmethods().size() + clz->get_dmethods().size();
     auto process_methods = [&](const auto& methods) {
       for (auto* meth : methods) {
+        // Methods that are decoded lazily are not counted here.
         DexCode* code = meth->get_dex_code();
         if (code) {
           stats->num_instructions += code->get_instructions().size();
@@ -345,7 +360,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
   }
 
   const dex_map_list* map_list =
-      reinterpret_cast<const dex_map_list*>(m_file->const_data() + dh->map_off);
+      reinterpret_cast<const dex_map_list*>(m_data + dh->map_off);
   bool header_seen = false;
   uint32_t header_index = 0;
   for (uint32_t i = 0; i < map_list->size; i++) {
@@ -649,7 +664,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
 }
 
 void DexLoader::load_dex_class(int num) {
-  size_t dexsize = m_file->size();
+  size_t dexsize = m_size;
   const dex_class_def* cdef = m_class_defs + num;
   auto idx = m_idx.get();
 
@@ -691,30 +706,89 @@ const dex_header* DexLoader::get_dex_header(const char* file_name) {
     fprintf(stderr, "error: cannot create memory-mapped file: %s\n", file_name);
     exit(EXIT_FAILURE);
   }
-  return reinterpret_cast<const dex_header*>(m_file->const_data());
+  m_data = reinterpret_cast<const uint8_t*>(m_file->const_data());
+  m_size = m_file->size();
+  huge_pages::advise(m_data, m_size);
+  return reinterpret_cast<const dex_header*>(m_data);
+}
+
+const dex_header* DexLoader::open_dex(const char* file_name,
+                                      int support_dex_version) {
+  const dex_header* dh = get_dex_header(file_name);
+  validate_dex_header(dh, m_size, support_dex_version);
+  // Only the mapped file is known to be immutable and can be kept alive.
+  m_strings_in_place = g_redex->zero_copy_dex_strings;
+  m_lazy_code = g_redex->lazy_dex_code;
+  m_lazy_annotations = g_redex->lazy_dex_annotations;
+  return dh;
+}
+
+const dex_header* DexLoader::open_dex(const uint8_t* data,
+                                      size_t size,
+                                      int support_dex_version) {
+  always_assert_log((uintptr_t)data % alignof(dex_header) == 0,
+                    "Misaligned dex data for %s",
+                    m_location->get_file_name().c_str());
+  const auto* dh = reinterpret_cast<const dex_header*>(data);
+  validate_dex_header(dh, size, support_dex_version);
+  m_data = data;
+  m_size = size;
+  return dh;
 }
 
 DexClasses DexLoader::load_dex(const char* file_name,
                                dex_stats_t* stats,
                                int support_dex_version,
                                Parallel p) {
-  const dex_header* dh = get_dex_header(file_name);
-  validate_dex_header(dh, m_file->size(), support_dex_version);
-  return load_dex(dh, stats, p);
+  return load_dex(open_dex(file_name, support_dex_version), stats, p);
 }
 
-DexClasses DexLoader::load_dex(const dex_header* dh,
+DexClasses DexLoader::load_dex(const uint8_t* data,
+                               size_t size,
                                dex_stats_t* stats,
+                               int support_dex_version,
                                Parallel p) {
-  if (dh->class_defs_size == 0) {
-    return DexClasses(0);
+  return load_dex(open_dex(data, size, support_dex_version), stats, p);
+}
+
+void DexLoader::index_dex(const dex_header* dh, DexClasses* classes) {
+  if (m_data != reinterpret_cast<const uint8_t*>(dh)) {
+    // The header was opened by the caller, e.g. through get_dex_header.
+    m_data = reinterpret_cast<const uint8_t*>(dh);
+    m_size = dh->file_size;
   }
-  m_idx = std::make_unique<DexIdx>(dh);
+  m_idx = std::make_unique<DexIdx>(dh, m_strings_in_place, m_lazy_code,
+                                   m_lazy_annotations);
   auto off = (uint64_t)dh->class_defs_off;
   m_class_defs =
       reinterpret_cast<const dex_class_def*>((const uint8_t*)dh + off);
+  always_assert(classes->size() >= dh->class_defs_size);
+  m_classes = classes;
+}
+
+DexType* DexLoader::get_class_type(int num) const {
+  return m_idx->get_typeidx(m_class_defs[num].typeidx);
+}
+
+void DexLoader::finish_dex(const dex_header* dh,
+                           dex_stats_t* stats,
+                           DexClasses* classes) {
+  gather_input_stats(stats, dh);
+
+  // Remove nulls from the classes list. They may have been introduced by benign
+  // duplicate classes.
+  classes->erase(std::remove(classes->begin(), classes->end(), nullptr),
+                 classes->end());
+}
+
+DexClasses DexLoader::load_dex(const dex_header* dh,
+                               dex_stats_t* stats,
+                               Parallel p) {
+  if (dh->class_defs_size == 0) {
+    return DexClasses(0);
+  }
   DexClasses classes(dh->class_defs_size);
-  m_classes = &classes;
+  index_dex(dh, &classes);
 
   switch (p) {
   case Parallel::kNo: {
@@ -748,13 +822,7 @@ DexClasses DexLoader::load_dex(const dex_header* dh,
   }
   }
 
-  gather_input_stats(stats, dh);
-
-  // Remove nulls from the classes list. They may have been introduced by benign
-  // duplicate classes.
-  classes.erase(std::remove(classes.begin(), classes.end(), nullptr),
-                classes.end());
-
+  finish_dex(dh, stats, &classes);
   return classes;
 }
 
@@ -836,6 +904,24 @@ DexClasses load_classes_from_dex(const DexLocation* location,
   return classes;
 }
 
+DexClasses load_classes_from_dex(const DexLocation* location,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 dex_stats_t* stats,
+                                 bool balloon,
+                                 bool throw_on_balloon_error,
+                                 int support_dex_version,
+                                 DexLoader::Parallel p) {
+  TRACE(MAIN, 1, "Loading classes from dex in memory from %s",
+        location->get_file_name().c_str());
+  DexLoader dl(location);
+  auto classes = dl.load_dex(data, size, stats, support_dex_version, p);
+  if (balloon) {
+    balloon_all(classes, throw_on_balloon_error, p);
+  }
+  return classes;
+}
+
 DexClasses load_classes_from_dex(const dex_header* dh,
                                  const DexLocation* location,
                                  bool balloon,
@@ -849,6 +935,88 @@ DexClasses load_classes_from_dex(const dex_header* dh,
   return classes;
 }
 
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<DexSource>& sources,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    bool throw_on_balloon_error,
+    int support_dex_version) {
+  auto num_dexes = sources.size();
+  std::vector<std::unique_ptr<DexLoader>> loaders;
+  loaders.reserve(num_dexes);
+  for (const auto& source : sources) {
+    TRACE(MAIN, 1, "Loading classes from dex from %s",
+          source.location->get_file_name().c_str());
+    loaders.push_back(std::make_unique<DexLoader>(source.location));
+  }
+  std::vector<const dex_header*> headers(num_dexes);
+  std::vector<DexClasses> dexes(num_dexes);
+  workqueue_run_for<size_t>(0, num_dexes, [&](size_t i) {
+    const auto& source = sources[i];
+    auto& loader = *loaders[i];
+    headers[i] = source.data == nullptr
+                     ? loader.open_dex(
+                           source.location->get_file_name().c_str(),
+                           support_dex_version)
+                     : loader.open_dex(source.data, source.size,
+                                       support_dex_version);
+    if (headers[i]->class_defs_size != 0) {
+      dexes[i].resize(headers[i]->class_defs_size);
+      loader.index_dex(headers[i], &dexes[i]);
+    }
+  });
+
+  // Classes defined more than once cannot be loaded concurrently, and which
+  // definition is kept must not depend on timing. So only the first
+  // definitions are loaded in parallel. The others are loaded afterwards, in
+  // order, which reports them like loading one dex after another would.
+  std::vector<std::pair<size_t, uint32_t>> first_defs;
+  std::vector<std::pair<size_t, uint32_t>> other_defs;
+  std::unordered_set<const DexType*> defined_types;
+  for (size_t i = 0; i < num_dexes; ++i) {
+    for (uint32_t num = 0; num < dexes[i].size(); ++num) {
+      auto* type = loaders[i]->get_class_type(num);
+      if (type == nullptr || defined_types.insert(type).second) {
+        first_defs.emplace_back(i, num);
+      } else {
+        other_defs.emplace_back(i, num);
+      }
+    }
+  }
+  std::vector<std::exception_ptr> all_exceptions;
+  std::mutex all_exceptions_mutex;
+  workqueue_run_for<size_t>(0, first_defs.size(), [&](size_t def) {
+    auto [i, num] = first_defs[def];
+    try {
+      loaders[i]->load_dex_class(num);
+    } catch (const std::exception& exc) {
+      TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
+      std::lock_guard<std::mutex> lock_guard(all_exceptions_mutex);
+      all_exceptions.emplace_back(std::current_exception());
+    }
+  });
+  if (!all_exceptions.empty()) {
+    throw aggregate_exception(std::move(all_exceptions));
+  }
+  for (auto [i, num] : other_defs) {
+    loaders[i]->load_dex_class(num);
+  }
+
+  stats->assign(num_dexes, dex_stats_t{});
+  Scope all_classes;
+  for (size_t i = 0; i < num_dexes; ++i) {
+    if (headers[i]->class_defs_size == 0) {
+      continue;
+    }
+    loaders[i]->finish_dex(headers[i], &stats->at(i), &dexes[i]);
+    all_classes.insert(all_classes.end(), dexes[i].begin(), dexes[i].end());
+  }
+  if (balloon) {
+    balloon_all(all_classes, throw_on_balloon_error, DexLoader::Parallel::kYes);
+  }
+  return dexes;
+}
+
 std::string load_dex_magic_from_dex(const DexLocation* location) {
   DexLoader dl(location);
   auto dh = dl.get_dex_header(location->get_file_name().c_str());
@@ -20,12 +20,25 @@ class DexLoader {
   const dex_class_def* m_class_defs;
   DexClasses* m_classes;
   std::unique_ptr<boost::iostreams::mapped_file> m_file;
+  // The dex being loaded, either the mapped file or memory given by the
+  // caller.
+  const uint8_t* m_data{nullptr};
+  size_t m_size{0};
   const DexLocation* m_location;
+  // Whether DexStrings were created in place in the mapped file, which then
+  // has to outlive the loader.
+  bool m_strings_in_place{false};
+  // Whether the code of methods is decoded on first access, in which case the
+  // index and the mapped file have to outlive the loader.
+  bool m_lazy_code{false};
+  // Likewise, for decoding class annotations on first access.
+  bool m_lazy_annotations{false};
 
  public:
   enum class Parallel { kYes, kNo };
 
   explicit DexLoader(const DexLocation* location);
+  ~DexLoader();
 
   const dex_header* get_dex_header(const char* file_name);
   DexClasses load_dex(const char* file_name,
@@ -35,9 +48,31 @@ class DexLoader {
   DexClasses load_dex(const dex_header* dh,
                       dex_stats_t* stats,
                       Parallel p = Parallel::kYes);
+  // Loads a dex that is already in memory, e.g. an entry of an archive. The
+  // memory only needs to stay alive during the call.
+  DexClasses load_dex(const uint8_t* data,
+                      size_t size,
+                      dex_stats_t* stats,
+                      int support_dex_version,
+                      Parallel p = Parallel::kYes);
   void load_dex_class(int num);
   void gather_input_stats(dex_stats_t* stats, const dex_header* dh);
   DexIdx* get_idx() { return m_idx.get(); }
+
+  // The steps of load_dex, for loading several dex files at once. See
+  // load_classes_from_dexes.
+  const dex_header* open_dex(const char* file_name, int support_dex_version);
+  const dex_header* open_dex(const uint8_t* data,
+                             size_t size,
+                             int support_dex_version);
+  // Prepares loading the classes of the dex into the given vector, which must
+  // have room for all of them.
+  void index_dex(const dex_header* dh, DexClasses* classes);
+  // The type defined by the given class def, after index_dex.
+  DexType* get_class_type(int num) const;
+  void finish_dex(const dex_header* dh,
+                  dex_stats_t* stats,
+                  DexClasses* classes);
 };
 
 DexClasses load_classes_from_dex(
@@ -53,6 +88,15 @@ DexClasses load_classes_from_dex(
     bool throw_on_balloon_error = true,
     int support_dex_version = 35,
     DexLoader::Parallel p = DexLoader::Parallel::kYes);
+DexClasses load_classes_from_dex(
+    const DexLocation* location,
+    const uint8_t* data,
+    size_t size,
+    dex_stats_t* stats,
+    bool balloon = true,
+    bool throw_on_balloon_error = true,
+    int support_dex_version = 35,
+    DexLoader::Parallel p = DexLoader::Parallel::kYes);
 DexClasses load_classes_from_dex(
     const dex_header* dh,
     const DexLocation* location,
@@ -60,6 +104,30 @@ DexClasses load_classes_from_dex(
     bool throw_on_balloon_error = true,
     DexLoader::Parallel p = DexLoader::Parallel::kYes);
 
+/*
+ * A dex file to load with load_classes_from_dexes: either the file of the
+ * location, or a dex already in memory, e.g. an entry of an archive. The
+ * memory only needs to stay alive during the call.
+ */
+struct DexSource {
+  const DexLocation* location;
+  const uint8_t* data{nullptr};
+  size_t size{0};
+};
+
+/*
+ * Loads the classes of all the given dex files in one batch: all classes of
+ * all files are loaded in parallel, instead of one file after another. The
+ * result is the same as loading the files in the given order though, in
+ * particular the first definition of a duplicate class is kept.
+ */
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<DexSource>& sources,
+    std::vector<dex_stats_t>* stats,
+    bool balloon = true,
+    bool throw_on_balloon_error = true,
+    int support_dex_version = 35);
+
 std::string load_dex_magic_from_dex(const DexLocation* location);
 void balloon_for_test(const Scope& scope);
 
@@ -20,7 +20,10 @@
 #include <memory>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <tuple>
+#include <type_traits>
 #include <unordered_set>
+#include <utility>
 
 #ifdef _MSC_VER
 // TODO: Rewrite open/write/close with C/C++ standards. But it works for now.
@@ -133,6 +136,48 @@ GatheredTypes::keep_cls_strings_together_emitlist() {
       CustomSort<DexString, cmp_dstring>(m_cls_strings, compare_dexstrings));
 }
 
+std::vector<const DexString*>
+GatheredTypes::get_profiled_dexstring_emitlist() {
+  redex_assert(m_config != nullptr);
+  auto& method_profiles = m_config->get_method_profiles();
+  if (!method_profiles.is_initialized()) {
+    return get_dexstring_emitlist();
+  }
+
+  MethodProfileOrderingConfig* config =
+      m_config->get_global_config()
+          .get_config_by_name<MethodProfileOrderingConfig>(
+              "method_profile_order");
+  auto lmeth = get_dexmethod_emitlist();
+  method_profiles::dexmethods_profiled_comparator comparator(
+      lmeth, &method_profiles, config);
+  std::vector<std::pair<double, DexMethod*>> profiled_methods;
+  for (auto* meth : lmeth) {
+    auto sort_num = comparator.get_overall_method_sort_num(meth);
+    if (sort_num <
+        method_profiles::dexmethods_profiled_comparator::VERY_END) {
+      profiled_methods.emplace_back(sort_num, meth);
+    }
+  }
+  std::stable_sort(
+      profiled_methods.begin(), profiled_methods.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::unordered_map<const DexString*, unsigned int> profiled_strings;
+  std::vector<const DexString*> method_strings;
+  for (auto& [sort_num, meth] : profiled_methods) {
+    method_strings.clear();
+    meth->gather_strings(method_strings);
+    for (const auto* s : method_strings) {
+      profiled_strings.emplace(s, profiled_strings.size());
+    }
+  }
+  TRACE(CUSTOMSORT, 2, "%zu strings of %zu profiled methods go first",
+        profiled_strings.size(), profiled_methods.size());
+  return get_dexstring_emitlist(CustomSort<DexString, cmp_dstring>(
+      profiled_strings, compare_dexstrings));
+}
+
 std::vector<DexMethodHandle*> GatheredTypes::get_dexmethodhandle_emitlist() {
   return m_lmethodhandle;
 }
@@ -250,7 +295,14 @@ void GatheredTypes::sort_dexmethod_emitlist_method_similarity_order(
     MethodSimilarityCompressionConsciousOrderer method_orderer;
     method_orderer.order(remaining_methods, this);
   } else {
-    MethodSimilarityGreedyOrderer method_orderer;
+    MethodSimilarityGreedyOrderer::LshConfig lsh_config;
+    if (similarity_config != nullptr) {
+      lsh_config.num_bands = similarity_config->lsh_num_bands;
+      lsh_config.rows_per_band = similarity_config->lsh_rows_per_band;
+      lsh_config.max_candidates_per_band =
+          similarity_config->lsh_max_candidates_per_band;
+    }
+    MethodSimilarityGreedyOrderer method_orderer(lsh_config);
     method_orderer.order(remaining_methods);
   }
 
@@ -352,6 +404,98 @@ void GatheredTypes::sort_dexmethod_emitlist_clinit_order(
                    });
 }
 
+namespace {
+
+// Orders strings like compare_dexstrings, except that strings with a common
+// prefix of up to eight bytes compare equal and then need the full comparison.
+// Characters are MUTF-8 encoded, so the key takes the bytes up to the first
+// non-ASCII character as they are. That character (and all that follows) is
+// replaced by 0xff, which sorts after all ASCII characters, unless it is an
+// encoded NUL, which sorts before them and is replaced by zeros.
+uint64_t string_sort_key(const DexString* s) {
+  if (s == nullptr) {
+    return 0;
+  }
+  const auto* bytes = reinterpret_cast<const uint8_t*>(s->c_str());
+  uint64_t key = 0;
+  bool ascii = true;
+  uint8_t fill = 0;
+  for (size_t i = 0; i < sizeof(key); i++) {
+    uint8_t byte = 0;
+    if (!ascii) {
+      byte = fill;
+    } else if (i < s->size()) {
+      byte = bytes[i];
+      if (byte >= 0x80) {
+        ascii = false;
+        fill = byte == 0xc0 ? 0 : 0xff;
+        byte = fill;
+      }
+    }
+    key = (key << 8) | byte;
+  }
+  return key;
+}
+
+// Sorts `in` by precomputed keys, calling `cmp` only for elements with equal
+// keys, and returns the index of each element.
+template <typename Cout, typename Cin, typename KeyFn, typename Cmp>
+Cout create_keyed_index(Cin& in, const KeyFn& key_fn, const Cmp& cmp) {
+  using Element = typename Cin::value_type;
+  using Key = std::decay_t<decltype(key_fn(std::declval<Element>()))>;
+  std::vector<std::pair<Key, Element>> keyed;
+  keyed.reserve(in.size());
+  for (auto* element : in) {
+    keyed.emplace_back(key_fn(element), element);
+  }
+  std::sort(keyed.begin(), keyed.end(), [&](const auto& a, const auto& b) {
+    if (a.first != b.first) {
+      return a.first < b.first;
+    }
+    return cmp(a.second, b.second);
+  });
+  Cout sidx{};
+  sidx.reserve(in.size());
+  for (size_t i = 0; i < keyed.size(); i++) {
+    in[i] = keyed[i].second;
+    sidx.emplace(keyed[i].second, i);
+  }
+  return sidx;
+}
+
+// Like the above, for keys that are unique to each element.
+template <typename Cout, typename Cin, typename KeyFn>
+Cout create_keyed_index(Cin& in, const KeyFn& key_fn) {
+  return create_keyed_index<Cout>(
+      in, key_fn, [](const auto&, const auto&) { return false; });
+}
+
+std::vector<DexProto*> collect_protos(
+    const std::vector<DexMethodRef*>& methods,
+    const std::vector<DexCallSite*>& callsites) {
+  // TODO: Profile and see whether a set first would be more efficient.
+  std::vector<DexProto*> protos;
+  protos.reserve(methods.size() + callsites.size());
+  for (auto const& m : methods) {
+    protos.push_back(m->get_proto());
+  }
+  for (auto const& c : callsites) {
+    protos.push_back(c->method_type());
+    for (auto& arg : c->args()) {
+      // n.b. how deep could this recursion go? what if there was a method
+      // handle here?
+      if (arg->evtype() == DEVT_METHOD_TYPE) {
+        protos.push_back(((DexEncodedValueMethodType*)arg.get())->proto());
+      }
+    }
+  }
+  std::sort(protos.begin(), protos.end());
+  protos.erase(std::unique(protos.begin(), protos.end()), protos.end());
+  return protos;
+}
+
+} // namespace
+
 DexOutputIdx GatheredTypes::get_dodx(const uint8_t* base) {
   /*
    * These are symbol table indices.  Symbols which are used
@@ -363,13 +507,41 @@ DexOutputIdx GatheredTypes::get_dodx(const uint8_t* base) {
    * methods and fields, only dexes with annotations have a
    * dependency on ordering.
    */
-  auto proto = get_proto_index();
+  auto strings = create_keyed_index<dexstring_to_idx>(
+      m_lstring, string_sort_key, compare_dexstrings);
+  // The default orders of the other tables only compare the names, types and
+  // protos that members consist of, so these are sorted by their indices.
+  auto types = create_keyed_index<dextype_to_idx>(
+      m_ltype, [&](const DexType* t) { return strings.at(t->get_name()); });
+  auto protos_list = collect_protos(m_lmethod, m_lcallsite);
+  auto proto = create_keyed_index<dexproto_to_idx>(
+      protos_list, [&](const DexProto* p) {
+        std::vector<uint32_t> args;
+        args.reserve(p->get_args()->size());
+        for (auto* t : *p->get_args()) {
+          args.push_back(types.at(t));
+        }
+        return std::make_pair(uint32_t(types.at(p->get_rtype())),
+                              std::move(args));
+      });
+  auto field = create_keyed_index<dexfield_to_idx>(
+      m_lfield, [&](const DexFieldRef* f) {
+        return std::make_tuple(uint32_t(types.at(f->get_class())),
+                               strings.at(f->get_name()),
+                               uint32_t(types.at(f->get_type())));
+      });
+  auto method = create_keyed_index<dexmethod_to_idx>(
+      m_lmethod, [&](const DexMethodRef* m) {
+        return std::make_tuple(uint32_t(types.at(m->get_class())),
+                               strings.at(m->get_name()),
+                               proto.at(m->get_proto()));
+      });
   auto typelist = get_typelist_list(&proto);
-  return DexOutputIdx(get_string_index(),
-                      get_type_index(),
+  return DexOutputIdx(std::move(strings),
+                      std::move(types),
                       std::move(proto),
-                      get_field_index(),
-                      get_method_index(),
+                      std::move(field),
+                      std::move(method),
                       std::move(typelist),
                       get_callsite_index(),
                       get_methodhandle_index(),
@@ -409,24 +581,7 @@ dexmethod_to_idx GatheredTypes::get_method_index(cmp_dmethod cmp) {
 }
 
 dexproto_to_idx GatheredTypes::get_proto_index(cmp_dproto cmp) {
-  // TODO: Profile and see whether a set first would be more efficient.
-  std::vector<DexProto*> protos;
-  protos.reserve(m_lmethod.size() + m_lcallsite.size());
-  for (auto const& m : m_lmethod) {
-    protos.push_back(m->get_proto());
-  }
-  for (auto const& c : m_lcallsite) {
-    protos.push_back(c->method_type());
-    for (auto& arg : c->args()) {
-      // n.b. how deep could this recursion go? what if there was a method
-      // handle here?
-      if (arg->evtype() == DEVT_METHOD_TYPE) {
-        protos.push_back(((DexEncodedValueMethodType*)arg.get())->proto());
-      }
-    }
-  }
-  std::sort(protos.begin(), protos.end());
-  protos.erase(std::unique(protos.begin(), protos.end()), protos.end());
+  auto protos = collect_protos(m_lmethod, m_lcallsite);
   return create_index<dexproto_to_idx>(protos, cmp);
 }
 
@@ -559,8 +714,40 @@ uint32_t get_dex_output_size(const ConfigFiles& conf) {
 
 } // namespace
 
-CodeItemEmit::CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci)
-    : method(meth), code(c), code_item(ci) {}
+CodeItemEmit::CodeItemEmit(DexMethod* meth,
+                           DexCode* c,
+                           dex_code_item* ci,
+                           uint32_t sz)
+    : method(meth), code(c), code_item(ci), size(sz) {}
+
+void DexPageSet::add(uint32_t offset, uint32_t size) {
+  if (size == 0) {
+    return;
+  }
+  auto last = (offset + size - 1) / kPageSize;
+  for (auto page = offset / kPageSize; page <= last; page++) {
+    m_pages.insert(page);
+  }
+}
+
+ColdStartTrace ColdStartTrace::from_profiles(ConfigFiles& conf) {
+  ColdStartTrace trace;
+  for (const auto& name : conf.get_coldstart_classes()) {
+    if (auto* type = DexType::get_type(name)) {
+      trace.classes.insert(type);
+    }
+  }
+  const auto& method_profiles = conf.get_method_profiles();
+  if (method_profiles.has_stats()) {
+    for (const auto& [method, stat] :
+         method_profiles.method_stats(method_profiles::COLD_START)) {
+      if (stat.appear_percent > 0) {
+        trace.methods.insert(method);
+      }
+    }
+  }
+  return trace;
+}
 
 namespace {
 // DO NOT CHANGE THESE VALUES! Many services will break if you do.
@@ -747,6 +934,9 @@ void DexOutput::generate_string_data(SortMode mode) {
   } else if (mode == SortMode::CLASS_STRINGS) {
     TRACE(CUSTOMSORT, 2, "using class names pack for string pool sorting");
     string_order = m_gtypes->keep_cls_strings_together_emitlist();
+  } else if (mode == SortMode::METHOD_PROFILED_ORDER) {
+    TRACE(CUSTOMSORT, 2, "using method profiled order for string pool sorting");
+    string_order = m_gtypes->get_profiled_dexstring_emitlist();
   } else {
     TRACE(CUSTOMSORT, 2, "using default string pool sorting");
     string_order = m_gtypes->get_dexstring_emitlist();
@@ -891,6 +1081,7 @@ void DexOutput::generate_class_data_items() {
   }
   dex_class_def* cdefs = (dex_class_def*)(m_output.get() + hdr.class_defs_off);
   uint32_t count = 0;
+  m_class_data_sizes.assign(hdr.class_defs_size, 0);
   for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
     DexClass* clz = m_classes->at(i);
     if (!clz->has_class_data()) continue;
@@ -899,6 +1090,7 @@ void DexOutput::generate_class_data_items() {
     if (m_dex_output_config.write_class_sizes) {
       m_stats.class_size[clz] = size;
     }
+    m_class_data_sizes[i] = size;
     cdefs[i].class_data_offset = m_offset;
     inc_offset(size);
     count += 1;
@@ -985,8 +1177,8 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
     int size = code->encode(&m_dodx, (uint32_t*)(m_output.get() + m_offset));
     check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
     m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(), m_offset);
-    m_code_item_emits.emplace_back(meth, code,
-                                   (dex_code_item*)(m_output.get() + m_offset));
+    m_code_item_emits.emplace_back(
+        meth, code, (dex_code_item*)(m_output.get() + m_offset), size);
     auto insns_size =
         ((const dex_code_item*)(m_output.get() + m_offset))->insns_size;
     inc_offset(size);
@@ -2785,6 +2977,15 @@ void DexOutput::prepare(SortMode string_mode,
                         const std::vector<SortMode>& code_mode,
                         ConfigFiles& conf,
                         const std::string& dex_magic) {
+  prepare_dex_local_sections(string_mode, code_mode, conf, dex_magic);
+  prepare_shared_sections();
+}
+
+void DexOutput::prepare_dex_local_sections(
+    SortMode string_mode,
+    const std::vector<SortMode>& code_mode,
+    ConfigFiles& conf,
+    const std::string& dex_magic) {
   m_gtypes->set_config(&conf);
 
   fix_jumbos(m_classes, &m_dodx);
@@ -2802,6 +3003,62 @@ void DexOutput::prepare(SortMode string_mode,
   generate_callsite_data();
   generate_methodhandle_data();
   generate_annotations();
+}
+
+void DexOutput::simulate_cold_start_page_touches(
+    const ColdStartTrace& cold_start) {
+  // What a cold start reads: the class data of every class that gets loaded,
+  // the code of every method that runs, and the strings that this code loads,
+  // or that name the classes and methods. Other sections are small, or
+  // touched regardless of the layout.
+  DexPageSet code_pages;
+  DexPageSet string_data_pages;
+  DexPageSet class_data_pages;
+  const auto* stringids =
+      (const dex_string_id*)(m_output.get() + hdr.string_ids_off);
+  auto touch_string = [&](const DexString* str) {
+    string_data_pages.add(stringids[m_dodx.stringidx(str)].offset,
+                          str->get_entry_size());
+  };
+
+  const auto* cdefs =
+      (const dex_class_def*)(m_output.get() + hdr.class_defs_off);
+  for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
+    DexClass* clz = m_classes->at(i);
+    if (!cold_start.classes.count(clz->get_type())) {
+      continue;
+    }
+    touch_string(clz->get_type()->get_name());
+    if (m_class_data_sizes[i] != 0) {
+      class_data_pages.add(cdefs[i].class_data_offset, m_class_data_sizes[i]);
+    }
+  }
+
+  for (const auto& emit : m_code_item_emits) {
+    if (!cold_start.methods.count(emit.method)) {
+      continue;
+    }
+    code_pages.add(
+        (uint32_t)(((uint8_t*)emit.code_item) - m_output.get()), emit.size);
+    touch_string(emit.method->get_name());
+    for (const auto* insn : emit.code->get_instructions()) {
+      if (insn->has_string()) {
+        touch_string(static_cast<const DexOpcodeString*>(insn)->get_string());
+      }
+    }
+  }
+
+  m_stats.cold_start_code_pages = code_pages.size();
+  m_stats.cold_start_string_data_pages = string_data_pages.size();
+  m_stats.cold_start_class_data_pages = class_data_pages.size();
+  TRACE(CUSTOMSORT, 1,
+        "[%s] cold start touches %zu code, %zu string_data and %zu "
+        "class_data pages",
+        m_filename, code_pages.size(), string_data_pages.size(),
+        class_data_pages.size());
+}
+
+void DexOutput::prepare_shared_sections() {
   generate_debug_items();
   generate_map();
   finalize_header();
@@ -2953,6 +3210,8 @@ SortMode get_string_sort_mode(ConfigFiles& conf) {
     string_sort_mode = SortMode::CLASS_STRINGS;
   } else if (sort_strings == "class_order") {
     string_sort_mode = SortMode::CLASS_ORDER;
+  } else if (sort_strings == "method_profiled_order") {
+    string_sort_mode = SortMode::METHOD_PROFILED_ORDER;
   }
   return string_sort_mode;
 }
@@ -2993,11 +3252,133 @@ enhanced_dex_stats_t write_classes_to_dex(
                  code_debug_lines, dex_output_config, min_sdk);
 
   dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
+  if (dex_output_config.simulate_cold_start_page_touches) {
+    dout.simulate_cold_start_page_touches(ColdStartTrace::from_profiles(conf));
+  }
   dout.write();
   dout.metrics();
   return dout.m_stats;
 }
 
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<std::string>& filenames,
+    DexClassesVector* dexen,
+    size_t store_number,
+    const std::string* store_name,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config,
+    int min_sdk,
+    const std::vector<SortMode>& code_sort_mode,
+    SortMode string_sort_mode) {
+  always_assert(filenames.size() == dexen->size());
+  std::vector<DexOutputJob> jobs;
+  jobs.reserve(dexen->size());
+  for (size_t i = 0; i < dexen->size(); i++) {
+    jobs.push_back(DexOutputJob{filenames[i], &dexen->at(i), store_number,
+                                store_name, i, &code_sort_mode});
+  }
+  return write_classes_to_dexes(jobs, conf, pos_mapper, debug_info_kind,
+                                method_to_id, code_debug_lines, iodi_metadata,
+                                dex_magic, dex_output_config, min_sdk,
+                                string_sort_mode);
+}
+
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<DexOutputJob>& jobs,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config,
+    int min_sdk,
+    SortMode string_sort_mode) {
+  const JsonWrapper& json_cfg = conf.get_json_config();
+  bool force_single_dex = json_cfg.get("force_single_dex", false);
+  if (force_single_dex) {
+    size_t max_dex_number = 0;
+    for (const auto& job : jobs) {
+      max_dex_number = std::max(max_dex_number, job.dex_number);
+    }
+    always_assert_log(max_dex_number == 0, "force_single_dex requires one dex");
+  }
+
+  auto interdex_config = json_cfg.get("InterDexPass", Json::Value());
+  auto normal_primary_dex =
+      interdex_config.get("normal_primary_dex", false).asBool();
+
+  // The configuration loads some data lazily, which must not race.
+  if (string_sort_mode == SortMode::METHOD_PROFILED_ORDER) {
+    conf.get_method_profiles();
+  }
+  for (const auto& job : jobs) {
+    for (auto mode : *job.code_sort_mode) {
+      if (mode == SortMode::METHOD_COLDSTART_ORDER) {
+        conf.get_coldstart_methods();
+      } else if (mode == SortMode::METHOD_PROFILED_ORDER ||
+                 mode == SortMode::METHOD_SIMILARITY) {
+        conf.get_method_profiles();
+      }
+    }
+  }
+
+  boost::optional<ColdStartTrace> cold_start_trace;
+  if (dex_output_config.simulate_cold_start_page_touches) {
+    cold_start_trace = ColdStartTrace::from_profiles(conf);
+  }
+
+  // Each in-flight dex holds a full output buffer, so we only prepare as many
+  // dexes at once as we have threads.
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<enhanced_dex_stats_t> stats;
+  stats.reserve(jobs.size());
+  for (size_t begin = 0; begin < jobs.size(); begin += num_threads) {
+    size_t end = std::min(begin + num_threads, jobs.size());
+    std::vector<std::unique_ptr<DexOutput>> douts(end - begin);
+    workqueue_run_for<size_t>(
+        begin, end,
+        [&](size_t job_index) {
+          const auto& job = jobs[job_index];
+          TRACE(OPUT, 2, "[write_classes_to_dexes][filename] %s",
+                job.filename.c_str());
+          auto dout = std::make_unique<DexOutput>(
+              job.filename.c_str(), job.classes,
+              std::make_shared<GatheredTypes>(job.classes), normal_primary_dex,
+              job.store_number, job.store_name, job.dex_number,
+              debug_info_kind, iodi_metadata, conf, pos_mapper, method_to_id,
+              code_debug_lines, dex_output_config, min_sdk);
+          dout->prepare_dex_local_sections(string_sort_mode,
+                                           *job.code_sort_mode, conf,
+                                           dex_magic);
+          if (cold_start_trace) {
+            dout->simulate_cold_start_page_touches(*cold_start_trace);
+          }
+          douts[job_index - begin] = std::move(dout);
+        },
+        num_threads);
+
+    // Everything that depends on, or contributes to, state shared across
+    // dexes happens in job order, so that the output is the same as when
+    // writing the dexes one by one.
+    for (auto& dout : douts) {
+      dout->prepare_shared_sections();
+      dout->write();
+      dout->metrics();
+      stats.push_back(std::move(dout->m_stats));
+      dout.reset();
+    }
+  }
+  return stats;
+}
+
 void DexOutput::inc_offset(uint32_t v) {
   // If this asserts hits, we already wrote out of bounds.
   always_assert(m_offset + v < m_output_size);
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/optional/optional.hpp>
 
@@ -156,6 +157,61 @@ enhanced_dex_stats_t write_classes_to_dex(
     const std::vector<SortMode>& code_sort_mode = {SortMode::CLASS_ORDER},
     SortMode string_sort_mode = SortMode::DEFAULT);
 
+/**
+ * Writes all dexes of a store, with the same result as calling
+ * write_classes_to_dex for each of them in order. The dex-local sections are
+ * prepared concurrently, while debug info, IODI metadata, method ids, symbol
+ * files and metrics, which are shared across dexes, are produced in dex order.
+ */
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<std::string>& filenames,
+    DexClassesVector* dexen,
+    size_t store_number,
+    const std::string* store_name,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config = DexOutputConfig{},
+    int min_sdk = 0,
+    const std::vector<SortMode>& code_sort_mode = {SortMode::CLASS_ORDER},
+    SortMode string_sort_mode = SortMode::DEFAULT);
+
+/**
+ * A dex to be written by write_classes_to_dexes. Jobs may come from different
+ * stores, each with its own code sort modes.
+ */
+struct DexOutputJob {
+  std::string filename;
+  DexClasses* classes;
+  size_t store_number;
+  const std::string* store_name;
+  size_t dex_number;
+  const std::vector<SortMode>* code_sort_mode;
+};
+
+/**
+ * Writes the dexes of the given jobs, with the same result as calling
+ * write_classes_to_dex for each of them in order. Batching the dexes of many
+ * small stores keeps all threads busy, which writing them store by store
+ * does not.
+ */
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<DexOutputJob>& jobs,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config = DexOutputConfig{},
+    int min_sdk = 0,
+    SortMode string_sort_mode = SortMode::DEFAULT);
+
 using cmp_dstring = bool (*)(const DexString*, const DexString*);
 using cmp_dtype = bool (*)(const DexType*, const DexType*);
 using cmp_dproto = bool (*)(const DexProto*, const DexProto*);
@@ -261,6 +317,10 @@ class GatheredTypes {
       T cmp = compare_dexstrings);
   std::vector<const DexString*> get_cls_order_dexstring_emitlist();
   std::vector<const DexString*> keep_cls_strings_together_emitlist();
+  // The strings of profiled methods come first, in the order the methods get
+  // laid out by sort_dexmethod_emitlist_profiled_order, so that cold start
+  // strings end up together at the front. The string ids stay sorted.
+  std::vector<const DexString*> get_profiled_dexstring_emitlist();
   std::vector<DexMethod*> get_dexmethod_emitlist();
   std::vector<DexMethodHandle*> get_dexmethodhandle_emitlist();
   std::vector<DexCallSite*> get_dexcallsite_emitlist();
@@ -295,8 +355,40 @@ struct CodeItemEmit {
   DexMethod* method;
   DexCode* code;
   dex_code_item* code_item;
+  uint32_t size;
+
+  CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci, uint32_t sz);
+};
+
+/**
+ * The distinct pages of a dex file that a number of accesses touch.
+ */
+class DexPageSet {
+ public:
+  static constexpr uint32_t kPageSize = 4096;
+
+  // Notes an access of the given byte range.
+  void add(uint32_t offset, uint32_t size);
+
+  size_t size() const { return m_pages.size(); }
+
+ private:
+  std::unordered_set<uint32_t> m_pages;
+};
+
+/**
+ * The classes and methods used at cold start, according to the profiles, in
+ * no particular order. Replaying this against the layout of a written dex
+ * estimates how many pages a cold start faults in, so that layout choices
+ * can be compared without shipping them.
+ */
+struct ColdStartTrace {
+  std::unordered_set<const DexType*> classes;
+  std::unordered_set<const DexMethodRef*> methods;
 
-  CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci);
+  // Collects the coldstart class list and the methods that appear in the
+  // cold start interaction of the method profiles.
+  static ColdStartTrace from_profiles(ConfigFiles& conf);
 };
 
 struct DexOutputTestHelper;
@@ -336,6 +428,8 @@ class DexOutput {
   std::string m_bytecode_offset_filename;
   std::unordered_map<DexTypeList*, uint32_t> m_tl_emit_offsets;
   std::vector<CodeItemEmit> m_code_item_emits;
+  // Indexed like the class defs, zero for classes without class data.
+  std::vector<uint32_t> m_class_data_sizes;
   std::unordered_map<DexMethod*, uint64_t>* m_method_to_id;
   std::unordered_map<DexCode*, std::vector<DebugLineItem>>* m_code_debug_lines;
   std::vector<std::pair<std::string, uint32_t>> m_method_bytecode_offsets;
@@ -415,6 +509,17 @@ class DexOutput {
                const std::vector<SortMode>& code_mode,
                ConfigFiles& conf,
                const std::string& dex_magic);
+  // The two halves of prepare(). The first one only touches state of this
+  // dex, and may run concurrently for different dexes. The second one emits
+  // debug info and method ids, which depends on state shared across dexes.
+  void prepare_dex_local_sections(SortMode string_mode,
+                                  const std::vector<SortMode>& code_mode,
+                                  ConfigFiles& conf,
+                                  const std::string& dex_magic);
+  void prepare_shared_sections();
+  // Counts the pages of the code, string_data and class_data sections that
+  // a cold start touches, into the stats. Requires the dex-local sections.
+  void simulate_cold_start_page_touches(const ColdStartTrace& cold_start);
   void write();
   void metrics();
   static void check_method_instruction_size_limit(const ConfigFiles& conf,
@@ -76,6 +76,9 @@ dex_stats_t& dex_stats_t::operator+=(const dex_stats_t& rhs) {
   encoded_array_bytes += rhs.encoded_array_bytes;
   annotations_directory_count += rhs.annotations_directory_count;
   annotations_directory_bytes += rhs.annotations_directory_bytes;
+  cold_start_code_pages += rhs.cold_start_code_pages;
+  cold_start_string_data_pages += rhs.cold_start_string_data_pages;
+  cold_start_class_data_pages += rhs.cold_start_class_data_pages;
 
   return *this;
 }
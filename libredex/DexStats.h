@@ -107,5 +107,10 @@ struct dex_stats_t {
   int annotations_directory_count = 0;
   int annotations_directory_bytes = 0;
 
+  /* Distinct pages a cold start touches, if simulated. */
+  int cold_start_code_pages = 0;
+  int cold_start_string_data_pages = 0;
+  int cold_start_class_data_pages = 0;
+
   dex_stats_t& operator+=(const dex_stats_t& rhs);
 };
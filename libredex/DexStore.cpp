@@ -237,6 +237,7 @@ XStoreRefs::XStoreRefs(const DexStoresVector& stores,
     : m_transitive_resolved_dependencies(
           build_transitive_resolved_dependencies(stores)),
       m_reverse_dependencies(build_reverse_dependencies(stores)),
+      m_xstores(std::make_shared<DenseSideTable<DexType, uint32_t>>()),
       m_shared_module_prefix(shared_module_prefix) {
 
   std::vector<std::pair<const DexClasses*, size_t>> dexes;
@@ -259,12 +260,17 @@ XStoreRefs::XStoreRefs(const DexStoresVector& stores,
     }
   }
 
+  // Every class is defined in a single dex, so the parallel writes go to
+  // distinct entries.
   workqueue_run_for<size_t>(0, dexes.size(), [&](size_t i) {
     auto [dex, store_idx] = dexes[i];
     for (auto* cls : *dex) {
-      m_xstores.emplace(cls->get_type(), store_idx);
+      (*m_xstores)[cls->get_type()] = store_idx + 1;
     }
   });
+  for (auto& [dex, _] : dexes) {
+    m_num_types += dex->size();
+  }
 }
 
 bool XStoreRefs::illegal_ref_load_types(const DexType* location,
@@ -281,24 +287,27 @@ bool XStoreRefs::illegal_ref_load_types(const DexType* location,
 
 std::string XStoreRefs::show_type(const DexType* type) { return show(type); }
 
-XDexRefs::XDexRefs(const DexStoresVector& stores) {
-  size_t dex_nr = 0;
+XDexRefs::XDexRefs(const DexStoresVector& stores)
+    : m_dexes(std::make_shared<DenseSideTable<DexType, uint32_t>>()) {
+  std::vector<const DexClasses*> dexes;
   for (auto& store : stores) {
     for (auto& dexen : store.get_dexen()) {
-      for (const auto cls : dexen) {
-        m_dexes.emplace(cls->get_type(), dex_nr);
-      }
-      dex_nr++;
+      dexes.push_back(&dexen);
     }
   }
-  m_num_dexes = dex_nr;
+  m_num_dexes = dexes.size();
+  workqueue_run_for<size_t>(0, dexes.size(), [&](size_t i) {
+    for (const auto cls : *dexes[i]) {
+      (*m_dexes)[cls->get_type()] = i + 1;
+    }
+  });
 }
 
 size_t XDexRefs::get_dex_idx(const DexType* type) const {
-  auto it = m_dexes.find(type);
-  always_assert_log(it != m_dexes.end(), "type %s not in the current APK",
-                    SHOW(type));
-  return it->second;
+  auto* res = m_dexes->get(type);
+  always_assert_log(res != nullptr && *res != 0,
+                    "type %s not in the current APK", SHOW(type));
+  return *res - 1;
 }
 
 bool XDexRefs::cross_dex_ref_override(const DexMethod* overridden,
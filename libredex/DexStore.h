@@ -9,6 +9,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -16,6 +17,7 @@
 
 #include "ConcurrentContainers.h"
 #include "Debug.h"
+#include "DenseSideTable.h"
 #include "DexClass.h"
 
 class DexStore;
@@ -169,10 +171,16 @@ std::unordered_set<const DexType*> get_root_store_types(
 class XStoreRefs {
  private:
   /**
-   * Map of classes to their logical store index. A primary DEX goes in its own
-   * bucket (first element in the array).
+   * Map of classes to their logical store index plus one, or zero for types
+   * that are not defined in any store. A primary DEX goes in its own bucket
+   * (first element in the array). Shared, as it is immutable once built.
    */
-  InsertOnlyConcurrentMap<const DexType*, size_t> m_xstores;
+  std::shared_ptr<DenseSideTable<DexType, uint32_t>> m_xstores;
+
+  /**
+   * Number of classes in m_xstores.
+   */
+  size_t m_num_types{0};
 
   /**
    * Pointers to original stores in the same order as used to populate
@@ -209,6 +217,11 @@ class XStoreRefs {
   static std::string show_type(const DexType* type); // To avoid "Show.h" in the
                                                      // header.
 
+  const uint32_t* find_store_idx_plus_one(const DexType* type) const {
+    auto* res = m_xstores->get(type);
+    return res == nullptr || *res == 0 ? nullptr : res;
+  }
+
   bool is_store_shared_module(const DexStore* store) const {
     // If prefix is given, check if name has that prefix.
     return !m_shared_module_prefix.empty() &&
@@ -240,9 +253,9 @@ class XStoreRefs {
    * api.
    */
   size_t get_store_idx(const DexType* type) const {
-    auto* res = m_xstores.get(type);
+    auto* res = find_store_idx_plus_one(type);
     if (res) {
-      return *res;
+      return *res - 1;
     }
     not_reached_log("type %s not in the current APK", show_type(type).c_str());
   }
@@ -254,13 +267,13 @@ class XStoreRefs {
    * the current scope.
    */
   bool is_in_root_store(const DexType* type) const {
-    auto* res = m_xstores.get(type);
-    return res && *res < m_root_stores;
+    auto* res = find_store_idx_plus_one(type);
+    return res && *res - 1 < m_root_stores;
   }
 
   bool is_in_primary_dex(const DexType* type) const {
-    auto* res = m_xstores.get(type);
-    return res && *res == 0;
+    auto* res = find_store_idx_plus_one(type);
+    return res && *res - 1 == 0;
   }
 
   const DexStore* get_store(size_t idx) const { return m_stores[idx]; }
@@ -296,14 +309,14 @@ class XStoreRefs {
     if (type_class_internal(type) == nullptr) return false;
     // Temporary HACK: optimizations may leave references to dead classes and
     // if we just call get_store_idx() - as we should - the assert will fire...
-    if (store_idx >= m_xstores.size()) {
+    if (store_idx >= m_num_types) {
       return false;
     }
-    auto* res = m_xstores.get(type);
+    auto* res = find_store_idx_plus_one(type);
     if (!res) {
       return true;
     }
-    return illegal_ref_between_stores(store_idx, *res);
+    return illegal_ref_between_stores(store_idx, *res - 1);
   }
 
   bool illegal_ref_between_stores(size_t caller_store_idx,
@@ -355,7 +368,7 @@ class XStoreRefs {
     return illegal_ref(store_idx, callee->get_class());
   }
 
-  size_t size() const { return m_xstores.size(); }
+  size_t size() const { return m_num_types; }
 };
 
 /**
@@ -363,7 +376,9 @@ class XStoreRefs {
  * is used for quick validation for crossing-dex references.
  */
 class XDexRefs {
-  std::unordered_map<const DexType*, size_t> m_dexes;
+  // Map of classes to their dex index plus one, or zero for types that are not
+  // defined in any dex. Shared, as it is immutable once built.
+  std::shared_ptr<DenseSideTable<DexType, uint32_t>> m_dexes;
   size_t m_num_dexes;
 
  public:
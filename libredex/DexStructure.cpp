@@ -101,25 +101,6 @@ unsigned estimate_linear_alloc(const DexClass* clazz) {
   return lasize;
 }
 
-/**
- * Returns the count of elements present in a but not in b.
- */
-template <typename T>
-size_t set_difference_size(const std::unordered_set<T>& a,
-                           const std::unordered_map<T, size_t>& b) {
-  size_t result = a.size();
-  if (a.size() <= b.size()) {
-    for (const auto& v : a) {
-      result -= b.count(v);
-    }
-  } else {
-    for (const auto& [v, c] : b) {
-      result -= a.count(v);
-    }
-  }
-  return result;
-}
-
 size_t DexesStructure::get_frefs_limit() const {
   return MAX_FIELD_REFS - m_reserve_refs.frefs;
 }
@@ -145,8 +126,8 @@ bool DexesStructure::add_class_to_current_dex(const MethodRefs& clazz_mrefs,
                                               const TypeRefs& clazz_trefs,
                                               const TypeRefs& clazz_itrefs,
                                               DexClass* clazz) {
-  always_assert_log(m_classes.count(clazz) == 0,
-                    "Can't emit the same class twice! %s", SHOW(clazz));
+  always_assert_log(!has_class(clazz), "Can't emit the same class twice! %s",
+                    SHOW(clazz));
 
   TypeRefs pending_init_class_fields;
   TypeRefs pending_init_class_types;
@@ -157,7 +138,7 @@ bool DexesStructure::add_class_to_current_dex(const MethodRefs& clazz_mrefs,
           pending_init_class_types, m_linear_alloc_limit, get_frefs_limit(),
           get_mrefs_limit(), get_trefs_limit(), clazz)) {
     update_stats(clazz_mrefs, clazz_frefs, clazz);
-    m_classes.emplace(clazz);
+    m_added_classes.emplace(clazz);
     return true;
   }
 
@@ -169,7 +150,7 @@ void DexesStructure::add_class_no_checks(const MethodRefs& clazz_mrefs,
                                          const TypeRefs& clazz_trefs,
                                          const TypeRefs& clazz_itrefs,
                                          DexClass* clazz) {
-  always_assert_log(m_classes.count(clazz) == 0,
+  always_assert_log(!has_class(clazz),
                     "Can't emit the same class twice: %s!\n", SHOW(clazz));
 
   TypeRefs pending_init_class_fields;
@@ -180,10 +161,21 @@ void DexesStructure::add_class_no_checks(const MethodRefs& clazz_mrefs,
   m_current_dex.add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs,
                                     pending_init_class_fields,
                                     pending_init_class_types, laclazz, clazz);
-  m_classes.emplace(clazz);
+  m_added_classes.emplace(clazz);
   update_stats(clazz_mrefs, clazz_frefs, clazz);
 }
 
+void DexesStructure::compact() {
+  if (m_added_classes.empty()) {
+    return;
+  }
+  if (m_classes.use_count() > 1) {
+    m_classes = std::make_shared<std::unordered_set<DexClass*>>(*m_classes);
+  }
+  m_classes->insert(m_added_classes.begin(), m_added_classes.end());
+  m_added_classes.clear();
+}
+
 void DexesStructure::add_refs_no_checks(const MethodRefs& clazz_mrefs,
                                         const FieldRefs& clazz_frefs,
                                         const TypeRefs& clazz_trefs,
@@ -268,13 +260,13 @@ void DexStructure::resolve_init_classes(
     }
     const auto& fields = cls->get_sfields();
     if (std::any_of(fields.begin(), fields.end(), [&](DexField* field) {
-          return m_frefs.count(field) || frefs.count(field);
+          return m_fref_set.count(field) || frefs.count(field);
         })) {
       continue;
     }
     pending_init_class_fields->insert(type);
     always_assert(!m_pending_init_class_types.count(type));
-    if (!m_trefs.count(type) && !trefs.count(type)) {
+    if (!m_tref_set.count(type) && !trefs.count(type)) {
       pending_init_class_types->insert(type);
     }
   }
@@ -314,7 +306,7 @@ bool DexStructure::add_class_if_fits(
     return false;
   }
 
-  const auto extra_mrefs_size = set_difference_size(clazz_mrefs, m_mrefs);
+  const auto extra_mrefs_size = m_mref_set.count_missing(clazz_mrefs);
   auto new_method_refs = m_mrefs.size() + extra_mrefs_size;
   // New_method_refs above counts the number of method refs in the current dex
   // before class merging. If mergeability-aware, we compute the number of
@@ -342,7 +334,7 @@ bool DexStructure::add_class_if_fits(
     return false;
   }
 
-  const auto extra_frefs_size = set_difference_size(clazz_frefs, m_frefs);
+  const auto extra_frefs_size = m_fref_set.count_missing(clazz_frefs);
   const auto new_field_refs = m_frefs.size() + extra_frefs_size +
                               m_pending_init_class_fields.size() +
                               pending_init_class_fields.size();
@@ -356,7 +348,7 @@ bool DexStructure::add_class_if_fits(
     return false;
   }
 
-  const auto extra_trefs_size = set_difference_size(clazz_trefs, m_trefs);
+  const auto extra_trefs_size = m_tref_set.count_missing(clazz_trefs);
   const auto new_type_refs = m_trefs.size() + extra_trefs_size +
                              m_pending_init_class_types.size() +
                              pending_init_class_types.size();
@@ -400,12 +392,15 @@ void DexStructure::add_refs_no_checks(
     const TypeRefs& pending_init_class_fields,
     const TypeRefs& pending_init_class_types) {
   for (auto mref : clazz_mrefs) {
-    m_mrefs[mref]++;
+    if (m_mrefs[mref]++ == 0) {
+      m_mref_set.insert(mref);
+    }
   }
   for (auto fref : clazz_frefs) {
     if (++m_frefs[fref] > 1) {
       continue;
     }
+    m_fref_set.insert(fref);
     if (!fref->is_def()) {
       continue;
     }
@@ -422,6 +417,7 @@ void DexStructure::add_refs_no_checks(
     if (++m_trefs[type] > 1) {
       continue;
     }
+    m_tref_set.insert(type);
     m_pending_init_class_types.erase(type);
   }
   for (auto type : pending_init_class_fields) {
@@ -431,7 +427,7 @@ void DexStructure::add_refs_no_checks(
   for (auto type : pending_init_class_types) {
     auto inserted = m_pending_init_class_types.insert(type).second;
     always_assert(inserted);
-    always_assert(!m_trefs.count(type));
+    always_assert(!m_tref_set.count(type));
   }
 }
 
@@ -448,6 +444,7 @@ void DexStructure::remove_class(const init_classes::InitClassesWithSideEffects*
     auto it = m_mrefs.find(mref);
     if (--it->second == 0) {
       m_mrefs.erase(it);
+      m_mref_set.erase(mref);
     }
   }
   for (auto fref : clazz_frefs) {
@@ -456,6 +453,7 @@ void DexStructure::remove_class(const init_classes::InitClassesWithSideEffects*
       continue;
     }
     m_frefs.erase(it);
+    m_fref_set.erase(fref);
     if (!fref->is_def()) {
       continue;
     }
@@ -470,7 +468,7 @@ void DexStructure::remove_class(const init_classes::InitClassesWithSideEffects*
     }
     const auto& fields = cls->get_sfields();
     if (std::any_of(fields.begin(), fields.end(),
-                    [&](DexField* field) { return m_frefs.count(field); })) {
+                    [&](DexField* field) { return m_fref_set.count(field); })) {
       continue;
     }
     if (init_classes_with_side_effects->refine(type) != fref->get_class()) {
@@ -478,7 +476,7 @@ void DexStructure::remove_class(const init_classes::InitClassesWithSideEffects*
     }
     auto inserted = m_pending_init_class_fields.insert(type).second;
     always_assert(inserted);
-    if (!m_trefs.count(type) && !clazz_trefs.count(type)) {
+    if (!m_tref_set.count(type) && !clazz_trefs.count(type)) {
       m_pending_init_class_types.insert(fref->get_class());
     }
   }
@@ -488,6 +486,7 @@ void DexStructure::remove_class(const init_classes::InitClassesWithSideEffects*
       continue;
     }
     m_trefs.erase(it);
+    m_tref_set.erase(type);
     if (!m_pending_init_class_fields.count(type)) {
       continue;
     }
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -67,6 +69,51 @@ struct OverflowStats {
   }
 };
 
+/*
+ * A set of types, or field or method refs, as a bitset over their dense
+ * indices (see e.g. DexMethodRef::get_dense_index()). Membership checks are
+ * thus a bit test instead of a hash lookup, which matters for the many "would
+ * the class fit" queries against a dex. The bitset grows as needed.
+ */
+template <class Ref>
+class DenseRefSet {
+ public:
+  bool count(const Ref* ref) const {
+    auto idx = ref->get_dense_index();
+    return idx / 64 < m_words.size() && ((m_words[idx / 64] >> (idx % 64)) & 1);
+  }
+
+  void insert(const Ref* ref) {
+    auto idx = ref->get_dense_index();
+    if (idx / 64 >= m_words.size()) {
+      // Cover all refs that exist by now, to avoid repeated resizing.
+      m_words.resize(
+          std::max<size_t>(idx, Ref::num_dense_indices() - 1) / 64 + 1);
+    }
+    m_words[idx / 64] |= uint64_t(1) << (idx % 64);
+  }
+
+  void erase(const Ref* ref) {
+    auto idx = ref->get_dense_index();
+    if (idx / 64 < m_words.size()) {
+      m_words[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+  }
+
+  // Returns how many of the given refs are not in this set.
+  template <class Refs>
+  size_t count_missing(const Refs& refs) const {
+    size_t missing = 0;
+    for (const auto* ref : refs) {
+      missing += !count(ref);
+    }
+    return missing;
+  }
+
+ private:
+  std::vector<uint64_t> m_words;
+};
+
 class DexStructure {
  public:
   DexStructure() : m_linear_alloc_size(0) {}
@@ -158,23 +205,32 @@ also reject some legal cases.
                             TypeRefs* pending_init_class_fields,
                             TypeRefs* pending_init_class_types);
 
-  bool has_tref(DexType* type) const { return m_trefs.count(type); }
+  bool has_tref(DexType* type) const { return m_tref_set.count(type); }
 
   void check_refs_count();
 
   size_t size() const { return m_classes_iterators.size(); }
 
   size_t get_tref_occurrences(DexType* type) const {
+    if (!m_tref_set.count(type)) {
+      return 0;
+    }
     auto it = m_trefs.find(type);
     return it == m_trefs.end() ? 0 : it->second;
   }
 
   size_t get_mref_occurrences(DexMethodRef* method) const {
+    if (!m_mref_set.count(method)) {
+      return 0;
+    }
     auto it = m_mrefs.find(method);
     return it == m_mrefs.end() ? 0 : it->second;
   }
 
   size_t get_fref_occurrences(DexFieldRef* field) const {
+    if (!m_fref_set.count(field)) {
+      return 0;
+    }
     auto it = m_frefs.find(field);
     return it == m_frefs.end() ? 0 : it->second;
   }
@@ -279,6 +335,10 @@ also reject some legal cases.
   std::unordered_map<DexType*, size_t> m_trefs;
   std::unordered_map<DexMethodRef*, size_t> m_mrefs;
   std::unordered_map<DexFieldRef*, size_t> m_frefs;
+  // The keys of the above maps, for fast membership checks.
+  DenseRefSet<DexType> m_tref_set;
+  DenseRefSet<DexMethodRef> m_mref_set;
+  DenseRefSet<DexFieldRef> m_fref_set;
   TypeRefs m_pending_init_class_fields;
   TypeRefs m_pending_init_class_types;
   std::list<DexClass*> m_classes;
@@ -319,7 +379,9 @@ class DexesStructure {
 
   size_t get_num_secondary_dexes() const { return m_info.num_secondary_dexes; }
 
-  size_t get_num_classes() const { return m_classes.size(); }
+  size_t get_num_classes() const {
+    return m_classes->size() + m_added_classes.size();
+  }
 
   size_t get_num_mrefs() const { return m_stats.num_mrefs; }
 
@@ -396,7 +458,17 @@ class DexesStructure {
    */
   DexClasses end_dex(DexInfo dex_info);
 
-  bool has_class(DexClass* clazz) const { return m_classes.count(clazz); }
+  bool has_class(DexClass* clazz) const {
+    return m_classes->count(clazz) || m_added_classes.count(clazz);
+  }
+
+  /**
+   * Moves the classes added since the last compaction into the set of classes
+   * that is shared by all copies, which keeps copies cheap, e.g. when
+   * exploring alternative ways of filling the next dex. The shared set is
+   * only copied if it is still in use by another copy.
+   */
+  void compact();
 
   const std::vector<DexInfo>& get_dex_info() const { return m_dex_info; }
 
@@ -410,8 +482,11 @@ class DexesStructure {
   // NOTE: Keeps track only of the last dex.
   DexStructure m_current_dex;
 
-  // All the classes that end up added in the dexes.
-  std::unordered_set<DexClass*> m_classes;
+  // All the classes that end up added in the dexes, split into the classes up
+  // to the last compact(), shared between copies, and those added since.
+  std::shared_ptr<std::unordered_set<DexClass*>> m_classes{
+      std::make_shared<std::unordered_set<DexClass*>>()};
+  std::unordered_set<DexClass*> m_added_classes;
 
   int64_t m_linear_alloc_limit;
   ReserveRefsInfo m_reserve_refs;
@@ -8,30 +8,61 @@
 #pragma once
 
 #include <boost/optional/optional.hpp>
+#include <limits>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "GraphUtil.h"
 
 namespace dominators {
 
+enum class Algorithm {
+  // Picks SemiNCA for graphs of at least SEMI_NCA_MIN_NODES nodes.
+  Auto,
+  Iterative,
+  SemiNCA,
+};
+
+// The iterative algorithm is fastest on typical graphs, but may need many
+// passes over huge irreducible ones, like generated state machines.
+constexpr size_t SEMI_NCA_MIN_NODES = 1000;
+
+/*
+ * The immediate dominators of the nodes reachable from the entry of a graph.
+ * Post-dominators are computed on the graph reversed with
+ * sparta::BackwardsFixpointIterationAdaptor.
+ */
 template <class GraphInterface>
 class SimpleFastDominators {
  public:
   using NodeId = typename GraphInterface::NodeId;
 
   /*
-   * Find the immediate dominator for each node in the given graph. This
-   * algorithm is described in the following paper:
+   * Find the immediate dominator for each node in the given graph. The
+   * iterative algorithm is described in the following paper:
    *
    *    K. D. Cooper et.al. A Simple, Fast Dominance Algorithm.
+   *
+   * The SemiNCA algorithm, which is near-linear, is described in:
+   *
+   *    L. Georgiadis. Linear-Time Algorithms for Dominators and Related
+   *    Problems.
    */
-  explicit SimpleFastDominators(const typename GraphInterface::Graph& graph) {
+  explicit SimpleFastDominators(const typename GraphInterface::Graph& graph,
+                                Algorithm algorithm = Algorithm::Auto) {
     // Sort nodes in postorder and create a map of each node to its postorder
     // number.
     m_postordering = graph::postorder_sort<GraphInterface>(graph);
     for (size_t i = 0; i < m_postordering.size(); ++i) {
       m_postorder_map[m_postordering[i]] = i;
     }
+    if (algorithm == Algorithm::SemiNCA ||
+        (algorithm == Algorithm::Auto &&
+         m_postordering.size() >= SEMI_NCA_MIN_NODES)) {
+      compute_semi_nca(graph);
+      return;
+    }
     // Entry node's immediate dominator is itself.
     const auto& entry = GraphInterface::entry(graph);
     m_idoms[entry] = entry;
@@ -70,6 +101,40 @@ class SimpleFastDominators {
 
   NodeId get_idom(NodeId node) const { return m_idoms.at(node); }
 
+  /*
+   * The dominance frontier of each reachable node, i.e. the nodes that have a
+   * predecessor dominated by it, without being strictly dominated by it
+   * themselves. Nodes with an empty frontier are omitted.
+   */
+  std::unordered_map<NodeId, std::vector<NodeId>> get_dominance_frontiers(
+      const typename GraphInterface::Graph& graph) const {
+    std::unordered_map<NodeId, std::vector<NodeId>> frontiers;
+    for (auto rit = m_postordering.rbegin(); rit != m_postordering.rend();
+         ++rit) {
+      NodeId node = *rit;
+      const auto& preds = GraphInterface::predecessors(graph, node);
+      if (preds.size() < 2) {
+        continue;
+      }
+      auto idom = m_idoms.at(node);
+      for (const auto& pred : preds) {
+        NodeId runner = GraphInterface::source(graph, pred);
+        if (!m_idoms.count(runner)) {
+          continue;
+        }
+        while (runner != idom) {
+          auto& frontier = frontiers[runner];
+          if (!frontier.empty() && frontier.back() == node) {
+            break;
+          }
+          frontier.push_back(node);
+          runner = m_idoms.at(runner);
+        }
+      }
+    }
+    return frontiers;
+  }
+
   // Find the common dominator block that is closest to both blocks.
   NodeId intersect(NodeId finger1, NodeId finger2) {
     while (finger1 != finger2) {
@@ -84,9 +149,107 @@ class SimpleFastDominators {
   }
 
  private:
+  void compute_semi_nca(const typename GraphInterface::Graph& graph) {
+    constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    // Number the nodes in depth-first preorder, recording the parents in the
+    // depth-first spanning tree.
+    std::vector<NodeId> nodes;
+    std::vector<size_t> parent;
+    std::unordered_map<NodeId, size_t> preorder;
+    nodes.reserve(m_postordering.size());
+    parent.reserve(m_postordering.size());
+    preorder.reserve(m_postordering.size());
+    std::vector<std::pair<NodeId, size_t>> stack{
+        {GraphInterface::entry(graph), NONE}};
+    while (!stack.empty()) {
+      auto [node, node_parent] = stack.back();
+      stack.pop_back();
+      if (!preorder.emplace(node, nodes.size()).second) {
+        continue;
+      }
+      auto index = nodes.size();
+      nodes.push_back(node);
+      parent.push_back(node_parent);
+      const auto& succs = GraphInterface::successors(graph, node);
+      for (auto it = succs.rbegin(); it != succs.rend(); ++it) {
+        NodeId target = GraphInterface::target(graph, *it);
+        if (!preorder.count(target)) {
+          stack.emplace_back(target, index);
+        }
+      }
+    }
+
+    // Compute the semidominators in reverse preorder, with path compression
+    // over the processed part of the spanning tree.
+    auto size = nodes.size();
+    std::vector<size_t> semi(size);
+    std::vector<size_t> label(size);
+    std::vector<size_t> ancestor(size, NONE);
+    for (size_t i = 0; i < size; ++i) {
+      semi[i] = label[i] = i;
+    }
+    std::vector<size_t> path;
+    auto eval = [&](size_t v) {
+      if (ancestor[v] == NONE) {
+        return v;
+      }
+      size_t x = v;
+      while (ancestor[ancestor[x]] != NONE) {
+        path.push_back(x);
+        x = ancestor[x];
+      }
+      while (!path.empty()) {
+        auto y = path.back();
+        path.pop_back();
+        auto a = ancestor[y];
+        if (semi[label[a]] < semi[label[y]]) {
+          label[y] = label[a];
+        }
+        ancestor[y] = ancestor[a];
+      }
+      return label[v];
+    };
+    for (size_t i = size; i-- > 1;) {
+      for (const auto& pred : GraphInterface::predecessors(graph, nodes[i])) {
+        auto it = preorder.find(GraphInterface::source(graph, pred));
+        if (it == preorder.end()) {
+          // Not reachable from the entry.
+          continue;
+        }
+        semi[i] = std::min(semi[i], semi[eval(it->second)]);
+      }
+      ancestor[i] = parent[i];
+    }
+
+    // The immediate dominator is the nearest common ancestor of the parent
+    // and the semidominator in the spanning tree.
+    std::vector<size_t> idom(parent);
+    m_idoms.reserve(size);
+    m_idoms[nodes[0]] = nodes[0];
+    for (size_t i = 1; i < size; ++i) {
+      while (idom[i] > semi[i]) {
+        idom[i] = idom[idom[i]];
+      }
+      m_idoms[nodes[i]] = nodes[idom[i]];
+    }
+  }
+
   std::unordered_map<NodeId, NodeId> m_idoms;
   std::vector<NodeId> m_postordering;
   std::unordered_map<NodeId, size_t> m_postorder_map;
 };
 
+/*
+ * Returns the dominators of a graph that caches data derived from its
+ * structure (see cfg::ControlFlowGraph::get_structural_data), so that they are
+ * only recomputed after the graph changed structurally.
+ */
+template <class GraphInterface>
+std::shared_ptr<const SimpleFastDominators<GraphInterface>>
+get_cached_dominators(const typename GraphInterface::Graph& graph) {
+  using Dominators = SimpleFastDominators<GraphInterface>;
+  return graph.template get_structural_data<Dominators, Dominators>(
+      [&graph]() { return std::make_shared<const Dominators>(graph); });
+}
+
 } // namespace dominators
@@ -8,9 +8,10 @@
 #include "FrameworkApi.h"
 
 #include <boost/algorithm/string.hpp>
-#include <fstream>
-#include <istream>
-#include <sstream>
+#include <string_view>
+
+#include "ReadMaybeMapped.h"
+#include "WorkQueue.h"
 
 namespace api {
 
@@ -91,53 +92,117 @@ bool FrameworkAPI::has_field(const std::string& simple_deobfuscated_name,
 
 namespace {
 
-void parse_framework_description(
-    std::istream& input,
-    std::unordered_map<const DexType*, FrameworkAPI>* framework_classes) {
-  std::string framework_cls_str;
-  std::string super_cls_str;
-  std::string class_name;
-  uint32_t num_methods;
-  uint32_t num_fields;
-  uint32_t access_flags;
-
-  while (input >> framework_cls_str >> access_flags >> super_cls_str >>
-         num_methods >> num_fields) {
-    FrameworkAPI framework_api;
-    framework_api.cls = DexType::make_type(framework_cls_str);
-    always_assert_log(framework_classes->count(framework_api.cls) == 0,
-                      "Duplicated class name!");
-    framework_api.super_cls = DexType::make_type(super_cls_str);
-    framework_api.access_flags = DexAccessFlags(access_flags);
-
-    while (num_methods-- > 0) {
-      std::string method_str;
-      std::string tag;
-      uint32_t m_access_flags;
-
-      input >> tag >> method_str >> m_access_flags;
-
-      always_assert(tag == "M");
-      DexMethodRef* mref = DexMethod::make_method(method_str);
-      framework_api.mrefs_info.emplace_back(mref,
-                                            DexAccessFlags(m_access_flags));
+class Tokenizer {
+ public:
+  explicit Tokenizer(std::string_view input) : m_input(input) {}
+
+  size_t offset() const { return m_pos; }
+
+  bool at_end() {
+    skip_whitespace();
+    return m_pos == m_input.size();
+  }
+
+  std::string_view next() {
+    skip_whitespace();
+    auto begin = m_pos;
+    while (m_pos < m_input.size() && !is_space(m_input[m_pos])) {
+      ++m_pos;
     }
+    always_assert_log(m_pos > begin,
+                      "Unexpected end of the framework api file");
+    return m_input.substr(begin, m_pos - begin);
+  }
 
-    while (num_fields-- > 0) {
-      std::string field_str;
-      std::string tag;
-      uint32_t f_access_flags;
+  uint32_t next_uint() {
+    auto token = next();
+    uint32_t value = 0;
+    for (char c : token) {
+      always_assert_log(c >= '0' && c <= '9',
+                        "Expected a number in the framework api file: %.*s",
+                        (int)token.size(), token.data());
+      value = value * 10 + (c - '0');
+    }
+    return value;
+  }
 
-      input >> tag >> field_str >> f_access_flags;
+ private:
+  static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+  }
 
-      always_assert(tag == "F");
-      DexFieldRef* fref = DexField::make_field(field_str);
-      framework_api.frefs_info.emplace_back(fref,
-                                            DexAccessFlags(f_access_flags));
+  void skip_whitespace() {
+    while (m_pos < m_input.size() && is_space(m_input[m_pos])) {
+      ++m_pos;
     }
+  }
 
-    auto& map_entry = (*framework_classes)[framework_api.cls];
-    map_entry = std::move(framework_api);
+  std::string_view m_input;
+  size_t m_pos{0};
+};
+
+FrameworkAPI parse_framework_class(std::string_view record) {
+  Tokenizer tokens(record);
+  FrameworkAPI framework_api;
+  framework_api.cls = DexType::make_type(tokens.next());
+  framework_api.access_flags = DexAccessFlags(tokens.next_uint());
+  framework_api.super_cls = DexType::make_type(tokens.next());
+  auto num_methods = tokens.next_uint();
+  auto num_fields = tokens.next_uint();
+
+  framework_api.mrefs_info.reserve(num_methods);
+  while (num_methods-- > 0) {
+    always_assert(tokens.next() == "M");
+    DexMethodRef* mref = DexMethod::make_method(tokens.next());
+    framework_api.mrefs_info.emplace_back(mref,
+                                          DexAccessFlags(tokens.next_uint()));
+  }
+
+  framework_api.frefs_info.reserve(num_fields);
+  while (num_fields-- > 0) {
+    always_assert(tokens.next() == "F");
+    DexFieldRef* fref = DexField::make_field(tokens.next());
+    framework_api.frefs_info.emplace_back(fref,
+                                          DexAccessFlags(tokens.next_uint()));
+  }
+  return framework_api;
+}
+
+/**
+ * The headers of the classes tell how many members follow, so the records can
+ * be delimited with a cheap scan and then parsed in parallel. Interning the
+ * types, methods and fields is what dominates the cost of loading.
+ */
+void parse_framework_description(
+    std::string_view input,
+    std::unordered_map<const DexType*, FrameworkAPI>* framework_classes) {
+  std::vector<std::string_view> records;
+  Tokenizer tokens(input);
+  while (!tokens.at_end()) {
+    auto begin = tokens.offset();
+    tokens.next(); // framework_cls
+    tokens.next(); // access_flags
+    tokens.next(); // super_cls
+    uint64_t num_members = tokens.next_uint();
+    num_members += tokens.next_uint();
+    // Each member has a tag, a descriptor and access flags.
+    for (uint64_t i = 0; i < num_members * 3; ++i) {
+      tokens.next();
+    }
+    records.push_back(input.substr(begin, tokens.offset() - begin));
+  }
+
+  std::vector<FrameworkAPI> apis(records.size());
+  workqueue_run_for<size_t>(0, records.size(), [&](size_t i) {
+    apis[i] = parse_framework_class(records[i]);
+  });
+
+  framework_classes->reserve(apis.size());
+  for (auto& framework_api : apis) {
+    auto* cls = framework_api.cls;
+    bool inserted =
+        framework_classes->emplace(cls, std::move(framework_api)).second;
+    always_assert_log(inserted, "Duplicated class name!");
   }
   always_assert_log(!framework_classes->empty(),
                     "Failed to load any class from the framework api file");
@@ -148,18 +213,17 @@ void parse_framework_description(
 AndroidSDK AndroidSDK::from_string(const std::string& input) {
   AndroidSDK sdk{};
 
-  std::istringstream iss{input};
-  parse_framework_description(iss, &sdk.m_framework_classes);
+  parse_framework_description(input, &sdk.m_framework_classes);
 
   return sdk;
 }
 
 void AndroidSDK::load_framework_classes() {
-  std::ifstream infile(m_sdk_api_file.c_str());
-  assert_log(infile, "Failed to open framework api file: %s\n",
-             m_sdk_api_file.c_str());
-
-  parse_framework_description(infile, &m_framework_classes);
+  redex::read_file_with_contents(
+      m_sdk_api_file, [&](const char* data, size_t size) {
+        parse_framework_description(std::string_view(data, size),
+                                    &m_framework_classes);
+      });
 }
 
 } // namespace api
@@ -23,6 +23,8 @@ void InlinerConfig::bind_config() {
   bind("throw_after_no_return", throw_after_no_return, throw_after_no_return);
   bind("max_cost_for_constant_propagation", max_cost_for_constant_propagation,
        max_cost_for_constant_propagation);
+  bind("max_call_site_summaries_per_callee",
+       max_call_site_summaries_per_callee, max_call_site_summaries_per_callee);
   bind("multiple_callers", multiple_callers, multiple_callers);
   bind("run_const_prop", shrinker.run_const_prop, shrinker.run_const_prop);
   bind("run_cse", shrinker.run_cse, shrinker.run_cse);
@@ -72,6 +74,7 @@ void AssessorConfig::bind_config() {
   bind("run_initially", run_initially, run_initially);
   bind("run_finally", run_finally, run_finally);
   bind("run_sb_consistency", run_sb_consistency, run_sb_consistency);
+  bind("incremental", incremental, incremental);
 }
 
 void CheckUniqueDeobfuscatedNamesConfig::bind_config() {
@@ -98,6 +101,10 @@ void MethodSimilarityOrderingConfig::bind_config() {
        use_compression_conscious_order);
   bind("disable", disable, disable);
   bind("store_name_to_disable", store_name_to_disable, store_name_to_disable);
+  bind("lsh_num_bands", lsh_num_bands, lsh_num_bands);
+  bind("lsh_rows_per_band", lsh_rows_per_band, lsh_rows_per_band);
+  bind("lsh_max_candidates_per_band", lsh_max_candidates_per_band,
+       lsh_max_candidates_per_band);
 }
 
 void ProguardConfig::bind_config() {
@@ -111,10 +118,14 @@ void ProguardConfig::bind_config() {
 void PassManagerConfig::bind_config() {
   bind("pass_aliases", pass_aliases, pass_aliases);
   bind("jemalloc_full_stats", jemalloc_full_stats, jemalloc_full_stats);
+  bind("purge_memory_after_each_pass", purge_memory_after_each_pass,
+       purge_memory_after_each_pass);
   bind("violations_tracking", violations_tracking, violations_tracking);
   bind("check_pass_order_properties", check_pass_order_properties,
        check_pass_order_properties);
   bind("check_properties_deep", check_properties_deep, check_properties_deep);
+  bind("check_properties_incremental", check_properties_incremental,
+       check_properties_incremental);
   bind("dump_mrefs", dump_mrefs, dump_mrefs);
 }
 
@@ -126,6 +137,10 @@ void ResourceConfig::bind_config() {
 
 void DexOutputConfig::bind_config() {
   bind("write_class_sizes", write_class_sizes, write_class_sizes);
+  bind("parallel", parallel, parallel);
+  bind("simulate_cold_start_page_touches",
+       simulate_cold_start_page_touches,
+       simulate_cold_start_page_touches);
 }
 
 void JarLoaderConfig::bind_config() {
@@ -191,6 +206,8 @@ void GlobalConfig::bind_config() {
   bind("string_sort_mode", "", string_param);
   bind("write_cfg_each_pass", false, bool_param);
   bind("dump_cfg_classes", "", string_param);
+  bind("dump_cfg_method_filter", "", string_param);
+  bind("dump_cfg_shards", 1u, uint32_param);
   bind("slow_invariants_debug", false, bool_param);
   // Enabled for ease of testing, apps expected to opt-out
   bind("enable_bleeding_edge_app_bundle_support", true, bool_param);
@@ -67,6 +67,8 @@ struct AssessorConfig : public Configurable {
   bool run_initially{false};
   bool run_finally{false};
   bool run_sb_consistency{false};
+  // Reuse the assessments of classes that did not change between runs.
+  bool incremental{false};
 };
 
 struct CheckUniqueDeobfuscatedNamesConfig : public Configurable {
@@ -129,6 +131,11 @@ struct MethodSimilarityOrderingConfig : public Configurable {
   bool use_compression_conscious_order{false};
   bool use_class_level_perf_sensitivity{false};
   std::string store_name_to_disable;
+  // Locality sensitive hashing for the greedy orderer, see
+  // MethodSimilarityGreedyOrderer::LshConfig.
+  uint32_t lsh_num_bands{0};
+  uint32_t lsh_rows_per_band{2};
+  uint32_t lsh_max_candidates_per_band{64};
 };
 
 struct ProguardConfig : public Configurable {
@@ -155,9 +162,14 @@ struct PassManagerConfig : public Configurable {
 
   std::unordered_map<std::string, std::string> pass_aliases;
   bool jemalloc_full_stats{false};
+  // Return memory freed by a pass to the OS before the next pass runs.
+  bool purge_memory_after_each_pass{false};
   bool violations_tracking{false};
   bool check_pass_order_properties{false};
   bool check_properties_deep{false};
+  // Only check method-local properties on the methods that may have been
+  // mutated since they last passed.
+  bool check_properties_incremental{false};
   bool dump_mrefs{false};
 };
 
@@ -191,6 +203,11 @@ struct DexOutputConfig : public Configurable {
   }
 
   bool write_class_sizes{false};
+  // Prepare the dexes of a store concurrently. Does not change the output.
+  bool parallel{true};
+  // Replay the cold start profiles against the layout of every dex, and
+  // report the pages touched in the output stats.
+  bool simulate_cold_start_page_touches{false};
 };
 
 struct JarLoaderConfig : public Configurable {
@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Debug.h"
@@ -58,4 +62,80 @@ std::vector<typename GraphInterface::NodeId> postorder_sort(
   return postorder;
 }
 
+/*
+ * Iterative implementation of Tarjan's algorithm, for a graph of nodes
+ * numbered from 0 whose successors are given in compressed form: the
+ * successors of node v are succs[succ_offsets[v]] up to (excluding)
+ * succs[succ_offsets[v + 1]].
+ *
+ * Components are returned in reverse topological order, i.e. every component
+ * comes after all components reachable from it. If given, component_of is set
+ * to the position of the component of each node.
+ */
+inline std::vector<std::vector<uint32_t>> strongly_connected_components(
+    const std::vector<uint32_t>& succ_offsets,
+    const std::vector<uint32_t>& succs,
+    std::vector<uint32_t>* component_of = nullptr) {
+  constexpr uint32_t UNVISITED = std::numeric_limits<uint32_t>::max();
+  always_assert(!succ_offsets.empty());
+  auto n = succ_offsets.size() - 1;
+  std::vector<uint32_t> order(n, UNVISITED);
+  std::vector<uint32_t> lowlink(n);
+  std::vector<uint8_t> on_stack(n);
+  std::vector<uint32_t> stack;
+  // Pairs of node and position of its next successor to visit.
+  std::vector<std::pair<uint32_t, uint32_t>> call_stack;
+  std::vector<std::vector<uint32_t>> sccs;
+  if (component_of != nullptr) {
+    component_of->assign(n, UNVISITED);
+  }
+  uint32_t counter = 0;
+  auto visit = [&](uint32_t v) {
+    order[v] = lowlink[v] = counter++;
+    stack.push_back(v);
+    on_stack[v] = true;
+    call_stack.emplace_back(v, succ_offsets[v]);
+  };
+  for (uint32_t root = 0; root < n; ++root) {
+    if (order[root] != UNVISITED) {
+      continue;
+    }
+    visit(root);
+    while (!call_stack.empty()) {
+      auto v = call_stack.back().first;
+      auto i = call_stack.back().second;
+      if (i < succ_offsets[v + 1]) {
+        call_stack.back().second++;
+        auto w = succs[i];
+        if (order[w] == UNVISITED) {
+          visit(w);
+        } else if (on_stack[w]) {
+          lowlink[v] = std::min(lowlink[v], order[w]);
+        }
+        continue;
+      }
+      call_stack.pop_back();
+      if (!call_stack.empty()) {
+        auto u = call_stack.back().first;
+        lowlink[u] = std::min(lowlink[u], lowlink[v]);
+      }
+      if (lowlink[v] != order[v]) {
+        continue;
+      }
+      auto& scc = sccs.emplace_back();
+      uint32_t w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        if (component_of != nullptr) {
+          (*component_of)[w] = sccs.size() - 1;
+        }
+        scc.push_back(w);
+      } while (w != v);
+    }
+  }
+  return sccs;
+}
+
 } // namespace graph
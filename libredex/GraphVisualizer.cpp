@@ -18,6 +18,7 @@
 #include "DexPosition.h"
 #include "IRCode.h"
 #include "Show.h"
+#include "WorkQueue.h"
 
 // The "Hotspot Client Compiler Visualizer" (c1visualizer) is a tool consuming
 // Hotspot C1 compiler debug info to display control flow graphs of compilation
@@ -662,12 +663,20 @@ void MethodCFGStream::add_pass(const std::string& pass_name,
   }
 }
 
-ClassCFGStream::ClassCFGStream(DexClass* klass) : m_class(klass) {
+ClassCFGStream::ClassCFGStream(DexClass* klass, std::string method_filter)
+    : m_class(klass), m_method_filter(std::move(method_filter)) {
   for (auto* method : get_all_methods(klass)) {
-    m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    if (is_tracked(method)) {
+      m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    }
   }
 }
 
+bool ClassCFGStream::is_tracked(DexMethod* method) const {
+  return m_method_filter.empty() ||
+         show(method).find(m_method_filter) != std::string::npos;
+}
+
 void ClassCFGStream::add_pass(const std::string& pass_name, Options o) {
   auto all_methods = get_all_methods(m_class);
   for (auto& m : m_methods) {
@@ -679,7 +688,9 @@ void ClassCFGStream::add_pass(const std::string& pass_name, Options o) {
     }
   }
   for (auto* method : all_methods) {
-    m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    if (is_tracked(method)) {
+      m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    }
   }
 
   for (auto& m : m_methods) {
@@ -726,7 +737,7 @@ bool Classes::add(const std::string& class_name, bool add_initial_pass) {
 }
 
 void Classes::add(DexClass* klass, bool add_initial_pass) {
-  m_class_cfgs.emplace_back(klass);
+  m_class_cfgs.emplace_back(klass, m_method_filter);
   if (add_initial_pass) {
     m_class_cfgs.back().add_pass("Initial");
   }
@@ -750,9 +761,11 @@ void Classes::add_pass(const std::function<std::string()>& pass_name_lazy,
     return;
   }
   std::string pass_name = pass_name_lazy();
-  for (auto& class_cfg : m_class_cfgs) {
-    class_cfg.add_pass(pass_name, o);
-  }
+  // Each class renders into its own streams, and methods are only touched by
+  // the class that holds them.
+  workqueue_run_for<size_t>(0, m_class_cfgs.size(), [&](size_t i) {
+    m_class_cfgs[i].add_pass(pass_name, o);
+  });
   if (m_write_after_each_pass) {
     write();
   }
@@ -762,10 +775,19 @@ void Classes::write() const {
   if (m_class_cfgs.empty()) {
     return;
   }
-  std::ofstream os(m_file_name);
-  for (const auto& c : m_class_cfgs) {
-    c.write(os);
+  if (m_num_shards == 1) {
+    std::ofstream os(m_file_name);
+    for (const auto& c : m_class_cfgs) {
+      c.write(os);
+    }
+    return;
   }
+  workqueue_run_for<size_t>(0, m_num_shards, [&](size_t shard) {
+    std::ofstream os(m_file_name + "." + std::to_string(shard));
+    for (size_t i = shard; i < m_class_cfgs.size(); i += m_num_shards) {
+      m_class_cfgs[i].write(os);
+    }
+  });
 }
 
 } // namespace visualizer
@@ -7,9 +7,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <iosfwd>
 #include <sstream>
+#include <string>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -69,6 +71,9 @@ class MethodCFGStream {
 // A wrapper managing CFG streams of all methods in a class. Detects when
 // methods are added or removed (in which case a non-cfg pass will be
 // added).
+//
+// If a method filter is given, only the methods whose name contains it are
+// tracked.
 class ClassCFGStream {
  private:
   struct MethodState {
@@ -78,22 +83,33 @@ class ClassCFGStream {
   };
 
  public:
-  explicit ClassCFGStream(DexClass* klass);
+  explicit ClassCFGStream(DexClass* klass, std::string method_filter = "");
 
   void add_pass(const std::string& pass_name, Options o = SKIP_NO_CHANGE);
 
   void write(std::ostream& os) const;
 
  private:
+  bool is_tracked(DexMethod* method) const;
+
   DexClass* m_class;
+  std::string m_method_filter;
   std::vector<MethodState> m_methods;
 };
 
+// The classes are rendered in parallel. With more than one shard, they are
+// distributed over that many files, named after the given one with the shard
+// index appended, which are written in parallel as well.
 class Classes {
  public:
-  explicit Classes(const std::string& file_name, bool write_after_arch_pass)
+  explicit Classes(const std::string& file_name,
+                   bool write_after_arch_pass,
+                   std::string method_filter = "",
+                   size_t num_shards = 1)
       : m_file_name(file_name),
-        m_write_after_each_pass(write_after_arch_pass) {}
+        m_write_after_each_pass(write_after_arch_pass),
+        m_method_filter(std::move(method_filter)),
+        m_num_shards(std::max<size_t>(num_shards, 1)) {}
 
   bool add(const std::string& class_name, bool add_initial_pass = true);
   void add(DexClass* klass, bool add_initial_pass = true);
@@ -110,6 +126,8 @@ class Classes {
   std::vector<std::string> m_not_found;
   const std::string m_file_name;
   const bool m_write_after_each_pass;
+  const std::string m_method_filter;
+  const size_t m_num_shards;
 };
 
 } // namespace visualizer
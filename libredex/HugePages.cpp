@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HugePages.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h> // For madvise
+#endif
+
+namespace huge_pages {
+
+namespace {
+
+std::atomic<bool> s_enabled{false};
+std::atomic<uint64_t> s_advised{0};
+
+} // namespace
+
+void set_enabled(bool enabled) { s_enabled = enabled; }
+
+bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+void advise(const void* addr, size_t size) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (!is_enabled()) {
+    return;
+  }
+  auto start = reinterpret_cast<uintptr_t>(addr);
+  auto begin = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  auto end = (start + size) & ~(HUGE_PAGE_SIZE - 1);
+  if (end <= begin) {
+    return;
+  }
+  if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) ==
+      0) {
+    s_advised.fetch_add(end - begin, std::memory_order_relaxed);
+  }
+#else
+  (void)addr;
+  (void)size;
+#endif
+}
+
+Stats get_stats() {
+  Stats stats;
+  stats.advised = s_advised.load(std::memory_order_relaxed);
+  std::ifstream ifs("/proc/self/smaps_rollup");
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    uint64_t kb = 0;
+    if (!(fields >> name >> kb)) {
+      continue;
+    }
+    if (name == "AnonHugePages:") {
+      stats.anon_huge_pages = kb * 1024;
+    } else if (name == "FilePmdMapped:") {
+      stats.file_pmd_mapped = kb * 1024;
+    }
+  }
+  return stats;
+}
+
+} // namespace huge_pages
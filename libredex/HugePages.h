@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Opt-in transparent huge page backing for the large memory regions redex
+ * controls, to reduce page table and TLB pressure. When enabled, such regions
+ * are advised with MADV_HUGEPAGE. This is a hint: the kernel only backs
+ * anonymous memory with huge pages when THP is set to "always" or "madvise",
+ * and file mappings only when it supports read-only file THP. Only the part of
+ * a region that covers whole, aligned huge pages can be backed.
+ *
+ * On non-Linux platforms all of this is a no-op.
+ */
+namespace huge_pages {
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Off by default. Only affects regions advised afterwards.
+void set_enabled(bool enabled);
+
+bool is_enabled();
+
+// Advises the kernel to back the given region with huge pages, if enabled and
+// the region spans at least one aligned huge page. Best done before the memory
+// is first touched.
+void advise(const void* addr, size_t size);
+
+struct Stats {
+  // The bytes of the whole huge pages that got advised.
+  uint64_t advised{0};
+  // From /proc/self/smaps_rollup: the bytes currently backed by huge pages.
+  uint64_t anon_huge_pages{0};
+  uint64_t file_pmd_mapped{0};
+};
+
+Stats get_stats();
+
+} // namespace huge_pages
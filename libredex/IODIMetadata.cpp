@@ -7,6 +7,7 @@
 
 #include "IODIMetadata.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "DexOutput.h"
@@ -14,6 +15,7 @@
 #include "Show.h"
 #include "StlUtil.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 // Returns com.foo.Bar. for the DexClass Lcom/foo/Bar;. Note the trailing
@@ -75,48 +77,67 @@ void IODIMetadata::mark_methods(DexStoresVector& scope, bool iodi_layers) {
   // offsets in stack traces, then we cannot leverage proguard mappings anymore,
   // so we must disable IODI for any methods whose stack trace may be ambiguous.
   //
-  // We do this linearly for now because otherwise we need locks
+  // Overload clusters never span classes, so classes are grouped in
+  // parallel, and the results are merged in class order afterwards.
 
   // IODI only supports non-ambiguous methods, i.e., an overload cluster is
   // only a single method. Layered IODI supports as many overloads as can
   // be encoded.
   const size_t large_bound = iodi_layers ? DexOutput::kIODILayerBound : 1;
 
+  std::vector<const DexClass*> classes;
   for (auto& store : scope) {
-    for (auto& classes : store.get_dexen()) {
-      for (auto& cls : classes) {
-        std::unordered_map<std::string, std::pair<const DexMethod*, size_t>>
-            name_map;
-
-        auto emplace_entry = [this, &name_map, large_bound](
-                                 const std::string& str, DexMethod* m) {
-          auto it = name_map.find(str);
-          if (it == name_map.end()) {
-            name_map[str] = {m, 1};
-          } else {
-            const DexMethod* canonical = it->second.first;
-            auto& count = it->second.second;
-
-            count++;
-            m_canonical[m] = canonical;
-            m_canonical[canonical] = canonical;
-
-            if (count > large_bound) {
-              m_too_large_cluster_canonical_methods.insert(canonical);
-            }
-          }
-        };
-
-        auto pretty_prefix = pretty_prefix_for_cls(cls);
-        // First we need to mark all entries...
-        for (DexMethod* m : cls->get_dmethods()) {
-          emplace_entry(pretty_prefix + m->str(), m);
-        }
-        for (DexMethod* m : cls->get_vmethods()) {
-          emplace_entry(pretty_prefix + m->str(), m);
-        }
+    for (auto& dex : store.get_dexen()) {
+      classes.insert(classes.end(), dex.begin(), dex.end());
+    }
+  }
+
+  struct ClassClusters {
+    std::vector<std::pair<const DexMethod*, const DexMethod*>> canonical;
+    std::vector<const DexMethod*> too_large_cluster_canonical_methods;
+  };
+  std::vector<ClassClusters> class_clusters(classes.size());
+  workqueue_run_for<size_t>(0, classes.size(), [&](size_t i) {
+    const auto* cls = classes[i];
+    auto& clusters = class_clusters[i];
+    std::unordered_map<std::string, std::pair<const DexMethod*, size_t>>
+        name_map;
+
+    auto emplace_entry = [&](const std::string& str, const DexMethod* m) {
+      auto [it, emplaced] = name_map.emplace(str, std::make_pair(m, 1));
+      if (emplaced) {
+        return;
+      }
+      const DexMethod* canonical = it->second.first;
+      auto& count = it->second.second;
+
+      count++;
+      clusters.canonical.emplace_back(m, canonical);
+      clusters.canonical.emplace_back(canonical, canonical);
+
+      // Only report the cluster once, when it first gets too large.
+      if (count == large_bound + 1) {
+        clusters.too_large_cluster_canonical_methods.push_back(canonical);
       }
+    };
+
+    auto pretty_prefix = pretty_prefix_for_cls(cls);
+    // First we need to mark all entries...
+    for (const DexMethod* m : cls->get_dmethods()) {
+      emplace_entry(pretty_prefix + m->str(), m);
     }
+    for (const DexMethod* m : cls->get_vmethods()) {
+      emplace_entry(pretty_prefix + m->str(), m);
+    }
+  });
+
+  for (auto& clusters : class_clusters) {
+    for (auto [m, canonical] : clusters.canonical) {
+      m_canonical[m] = canonical;
+    }
+    m_too_large_cluster_canonical_methods.insert(
+        clusters.too_large_cluster_canonical_methods.begin(),
+        clusters.too_large_cluster_canonical_methods.end());
   }
 
   m_marked = true;
@@ -186,27 +207,46 @@ void IODIMetadata::write(
   struct __attribute__((__packed__)) EntryHeader {
     uint16_t klen;
     uint64_t method_id;
-  } entry_hdr;
+  };
 
   uint32_t count = 0;
   size_t max_layer{0};
   size_t layered_count{0};
 
-  for (const auto& [method, layer] : m_iodi_method_layers) {
-    count += 1;
-    always_assert_log(count != 0, "Too many entries found, overflowed");
+  always_assert_log(m_iodi_method_layers.size() <= UINT32_MAX,
+                    "Too many entries found, overflowed");
+  std::vector<std::pair<const DexMethod*, size_t>> entries(
+      m_iodi_method_layers.begin(), m_iodi_method_layers.end());
 
-    redex_assert(layer < DexOutput::kIODILayerBound);
+  // Entries are encoded in parallel, a batch at a time, and each batch is
+  // written out before the next one gets encoded, so that the encoded form
+  // of all entries never needs to be held at once.
+  constexpr size_t kBatchSize = 16384;
+  std::vector<std::string> encoded(std::min(entries.size(), kBatchSize));
+  for (size_t batch_start = 0; batch_start < entries.size();
+       batch_start += kBatchSize) {
+    size_t batch_end = std::min(entries.size(), batch_start + kBatchSize);
+    workqueue_run_for<size_t>(batch_start, batch_end, [&](size_t i) {
+      const auto& [method, layer] = entries[i];
+      redex_assert(layer < DexOutput::kIODILayerBound);
 
-    auto name = get_iodi_name(method);
-    std::string tmp;
-    const std::string& layered_name = get_layered_name(name, layer, tmp);
+      auto name = get_iodi_name(method);
+      std::string tmp;
+      const std::string& layered_name = get_layered_name(name, layer, tmp);
 
-    always_assert(layered_name.size() < UINT16_MAX);
-    entry_hdr.klen = layered_name.size();
-    entry_hdr.method_id = method_to_id.at(const_cast<DexMethod*>(method));
-    ofs.write((const char*)&entry_hdr, sizeof(EntryHeader));
-    ofs << layered_name;
+      always_assert(layered_name.size() < UINT16_MAX);
+      EntryHeader entry_hdr;
+      entry_hdr.klen = layered_name.size();
+      entry_hdr.method_id = method_to_id.at(const_cast<DexMethod*>(method));
+      auto& out = encoded[i - batch_start];
+      out.clear();
+      out.append((const char*)&entry_hdr, sizeof(EntryHeader));
+      out.append(layered_name);
+    });
+    for (size_t i = batch_start; i < batch_end; i++) {
+      ofs << encoded[i - batch_start];
+    }
+    count += batch_end - batch_start;
   }
   // Rewind and write the header now that we know single/dup counts
   ofs.seekp(0);
@@ -11,6 +11,7 @@
 #include <boost/optional/optional.hpp>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <sstream>
 #include <tuple>
 #include <unordered_map>
@@ -208,6 +209,66 @@ std::vector<s_expr> to_s_exprs(
   }
 }
 
+// Reads the operands of an instruction in order. Unlike matching
+// `(operand . tail)` patterns one operand at a time, this neither copies the
+// remaining operands for every operand that is read, nor builds an error
+// message unless reading fails.
+class OperandReader {
+ public:
+  OperandReader(const s_expr& e, const std::string& opcode_str)
+      : m_expr(e), m_opcode_str(opcode_str) {}
+
+  const std::string& next_string(const char* what) {
+    auto& e = next(what);
+    always_assert_log(e.is_string(), "Expected %s for %s, got %s", what,
+                      m_opcode_str.c_str(), e.str().c_str());
+    return e.get_string();
+  }
+
+  int32_t next_int32(const char* what) {
+    auto& e = next(what);
+    always_assert_log(e.is_int32(), "Expected %s for %s, got %s", what,
+                      m_opcode_str.c_str(), e.str().c_str());
+    return e.get_int32();
+  }
+
+  // The elements of a list operand, which must all be strings.
+  template <typename Fn>
+  void next_string_list(const char* what, const Fn& fn) {
+    auto& e = next(what);
+    always_assert_log(e.is_list(), "Expected %s for %s, got %s", what,
+                      m_opcode_str.c_str(), e.str().c_str());
+    for (size_t i = 0; i < e.size(); ++i) {
+      auto element = e[i];
+      if (!element.is_string()) {
+        // Like the pattern this replaces, stop at the first non-string.
+        break;
+      }
+      fn(element.get_string());
+    }
+  }
+
+  void check_done() const {
+    always_assert_log(m_idx == m_expr.size(),
+                      "Found unexpected trailing items when parsing %s: %s",
+                      m_opcode_str.c_str(),
+                      m_expr.tail(m_idx).str().c_str());
+  }
+
+ private:
+  const s_expr& next(const char* what) {
+    always_assert_log(m_idx < m_expr.size(), "Expected %s for %s", what,
+                      m_opcode_str.c_str());
+    m_current = m_expr[m_idx++];
+    return m_current;
+  }
+
+  const s_expr& m_expr;
+  const std::string& m_opcode_str;
+  size_t m_idx{0};
+  s_expr m_current;
+};
+
 std::unique_ptr<IRInstruction> instruction_from_s_expr(
     const std::string& opcode_str, const s_expr& e, LabelRefs* label_refs) {
   auto op_it = string_to_opcode_table.find(opcode_str);
@@ -216,25 +277,22 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
                     opcode_str.c_str());
   auto op = op_it->second;
   auto insn = std::make_unique<IRInstruction>(op);
-  std::string reg_str;
-  s_expr tail = e;
+  OperandReader operands(e, opcode_str);
   if (insn->has_dest()) {
-    s_patn({s_patn(&reg_str)}, tail)
-        .must_match(tail, "Expected dest reg for " + opcode_str);
-    insn->set_dest(reg_from_str(reg_str));
+    insn->set_dest(reg_from_str(operands.next_string("dest reg")));
   }
   if (opcode::has_variable_srcs_size(op)) {
-    auto srcs = tail[0];
-    tail = tail.tail(1);
+    std::vector<reg_t> srcs;
+    operands.next_string_list("list of src regs", [&](const std::string& s) {
+      srcs.push_back(reg_from_str(s));
+    });
     insn->set_srcs_size(srcs.size());
-    for (size_t i = 0; i < insn->srcs_size(); ++i) {
-      insn->set_src(i, reg_from_str(srcs[i].get_string()));
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      insn->set_src(i, srcs[i]);
     }
   } else {
     for (size_t i = 0; i < insn->srcs_size(); ++i) {
-      s_patn({s_patn(&reg_str)}, tail)
-          .must_match(tail, "Expected src reg for" + opcode_str);
-      insn->set_src(i, reg_from_str(reg_str));
+      insn->set_src(i, reg_from_str(operands.next_string("src reg")));
     }
   }
   switch (opcode::ref(op)) {
@@ -242,21 +300,15 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
     break;
   case opcode::Ref::Data: {
     if (insn->opcode() == OPCODE_FILL_ARRAY_DATA) {
-      int32_t ewidth;
-      s_patn({s_patn(&ewidth)}, tail)
-          .must_match(tail, "Expecting int for element width" + opcode_str);
+      int32_t ewidth = operands.next_int32("int for element width");
       always_assert_log(ewidth == 1 || ewidth == 2 || ewidth == 4 ||
                             ewidth == 8,
                         "Invalid width %d", ewidth);
 
       std::vector<std::string> hex_elements;
-      std::string element_str;
-      s_expr list;
-      s_patn({s_patn(list)}, tail)
-          .must_match(tail, "Expecting list of hex strings for " + opcode_str);
-      while (s_patn({s_patn(&element_str)}, list).match_with(list)) {
-        hex_elements.push_back(element_str);
-      }
+      operands.next_string_list(
+          "list of hex strings",
+          [&](const std::string& s) { hex_elements.push_back(s); });
       auto data = create_fill_array_data_payload_from_str((uint16_t)ewidth,
                                                           hex_elements);
       insn->set_data(std::move(data));
@@ -266,44 +318,30 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
     break;
   }
   case opcode::Ref::Field: {
-    std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
-    auto* dex_field = DexField::make_field(str);
+    auto* dex_field =
+        DexField::make_field(operands.next_string("string literal"));
     insn->set_field(dex_field);
     break;
   }
   case opcode::Ref::Method: {
-    std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
-    auto* dex_method = DexMethod::make_method(str);
+    auto* dex_method =
+        DexMethod::make_method(operands.next_string("string literal"));
     insn->set_method(dex_method);
     break;
   }
   case opcode::Ref::String: {
-    std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
-    auto* dex_str = DexString::make_string(str);
+    auto* dex_str =
+        DexString::make_string(operands.next_string("string literal"));
     insn->set_string(dex_str);
     break;
   }
   case opcode::Ref::Literal: {
-    std::string num_str;
-    s_patn({s_patn(&num_str)}, tail)
-        .must_match(tail, "Expecting numeric literal for " + opcode_str);
-    int64_t num;
-    std::istringstream in(num_str);
-    in >> num;
-    insn->set_literal(num);
+    const auto& num_str = operands.next_string("numeric literal");
+    insn->set_literal(std::strtoll(num_str.c_str(), nullptr, 10));
     break;
   }
   case opcode::Ref::Type: {
-    std::string type_str;
-    s_patn({s_patn(&type_str)}, tail)
-        .must_match(tail, "Expecting type specifier for " + opcode_str);
-    DexType* ty = DexType::make_type(type_str);
+    DexType* ty = DexType::make_type(operands.next_string("type specifier"));
     insn->set_type(ty);
     break;
   }
@@ -322,25 +360,17 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
   }
 
   if (opcode::is_branch(op)) {
-    std::string label_str;
+    auto& labels = (*label_refs)[insn.get()];
     if (opcode::is_switch(op)) {
-      s_expr list;
-      s_patn({s_patn(list)}, tail)
-          .must_match(tail, "Expecting list of labels for " + opcode_str);
-      while (s_patn({s_patn(&label_str)}, list).match_with(list)) {
-        (*label_refs)[insn.get()].push_back(label_str);
-      }
+      operands.next_string_list(
+          "list of labels",
+          [&](const std::string& label) { labels.push_back(label); });
     } else {
-      s_patn({s_patn(&label_str)}, tail)
-          .must_match(tail, "Expecting label for " + opcode_str);
-      (*label_refs)[insn.get()].push_back(label_str);
+      labels.push_back(operands.next_string("label"));
     }
   }
 
-  always_assert_log(tail.is_nil(),
-                    "Found unexpected trailing items when parsing %s: %s",
-                    opcode_str.c_str(),
-                    tail.str().c_str());
+  operands.check_done();
   return insn;
 }
 
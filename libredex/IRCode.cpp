@@ -8,8 +8,6 @@
 #include "IRCode.h"
 
 #include <algorithm>
-#include <boost/bimap/bimap.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <iostream>
 #include <limits>
@@ -70,27 +68,55 @@ DexOpcode goto_for_offset(int32_t offset) {
 
 namespace {
 
-using namespace boost::bimaps;
+// Maps between the MethodItemEntries of ballooned instructions and their
+// addresses, in code units. Entries are found by address in a flat vector; the
+// addresses of entries are only kept for the instructions that refer to other
+// addresses, i.e. branches, switches and fill-array-data.
+class EntryAddrMap {
+ public:
+  explicit EntryAddrMap(size_t code_units) {
+    m_by_addr.reserve(code_units + 1);
+  }
+
+  void insert(MethodItemEntry* mie, const DexInstruction* insn, uint32_t addr) {
+    always_assert(addr == m_by_addr.size());
+    m_by_addr.resize(addr + insn->size(), nullptr);
+    m_by_addr[addr] = mie;
+    auto op = insn->opcode();
+    if (dex_opcode::is_branch(op) || op == DOPCODE_FILL_ARRAY_DATA) {
+      m_addrs.emplace(mie, addr);
+    }
+  }
+
+  // Maps the address just past the last instruction.
+  void insert_end(MethodItemEntry* end) { m_by_addr.push_back(end); }
 
-struct Entry {};
-struct Addr {};
+  // Returns nullptr if no instruction starts at the address.
+  MethodItemEntry* find(uint32_t addr) const {
+    return addr < m_by_addr.size() ? m_by_addr[addr] : nullptr;
+  }
+
+  uint32_t addr_of(const MethodItemEntry* mie) const {
+    return m_addrs.at(mie);
+  }
 
-using EntryAddrBiMap = bimap<tagged<MethodItemEntry*, Entry>,
-                             unordered_set_of<tagged<uint32_t, Addr>>>;
+ private:
+  std::vector<MethodItemEntry*> m_by_addr;
+  std::unordered_map<const MethodItemEntry*, uint32_t> m_addrs;
+};
 
-MethodItemEntry* get_bm_target_checked(const EntryAddrBiMap& bm,
-                                       uint32_t addr) {
-  auto it = bm.by<Addr>().find(addr);
-  always_assert_type_log(it != bm.by<Addr>().end(), RedexError::INVALID_DEX,
+MethodItemEntry* get_bm_target_checked(const EntryAddrMap& bm, uint32_t addr) {
+  auto* mie = bm.find(addr);
+  always_assert_type_log(mie != nullptr, RedexError::INVALID_DEX,
                          "Target is not an instruction address");
-  return it->second;
+  return mie;
 }
 
 } // namespace
 
 static MethodItemEntry* get_target(const MethodItemEntry* mei,
-                                   const EntryAddrBiMap& bm) {
-  uint32_t base = bm.by<Entry>().at(const_cast<MethodItemEntry*>(mei));
+                                   const EntryAddrMap& bm) {
+  uint32_t base = bm.addr_of(mei);
   int offset = mei->dex_insn->offset();
   uint32_t target = base + offset;
   return get_bm_target_checked(bm, target);
@@ -194,11 +220,11 @@ static int32_t read_int32(const uint16_t*& data) {
 static void shard_multi_target(IRList* ir,
                                DexOpcodeData* fopcode,
                                MethodItemEntry* src,
-                               const EntryAddrBiMap& bm) {
+                               const EntryAddrMap& bm) {
   const uint16_t* data = fopcode->data();
   uint16_t entries = *data++;
   auto ftype = fopcode->opcode();
-  uint32_t base = bm.by<Entry>().at(src);
+  uint32_t base = bm.addr_of(src);
   if (ftype == FOPCODE_PACKED_SWITCH) {
     int32_t case_key = read_int32(data);
     for (int i = 0; i < entries; i++) {
@@ -221,7 +247,7 @@ static void shard_multi_target(IRList* ir,
 
 static void generate_branch_targets(
     IRList* ir,
-    const EntryAddrBiMap& bm,
+    const EntryAddrMap& bm,
     std::unordered_map<MethodItemEntry*, std::unique_ptr<DexOpcodeData>>&
         entry_to_data) {
   for (auto miter = ir->begin(); miter != ir->end(); ++miter) {
@@ -248,10 +274,10 @@ static void generate_branch_targets(
 
 static void associate_debug_entries(IRList* ir,
                                     DexDebugItem& dbg,
-                                    const EntryAddrBiMap& bm) {
+                                    const EntryAddrMap& bm) {
   for (auto& entry : dbg.get_entries()) {
-    auto insert_point_it = bm.by<Addr>().find(entry.addr);
-    if (insert_point_it == bm.by<Addr>().end()) {
+    auto* insert_point = bm.find(entry.addr);
+    if (insert_point == nullptr) {
       // This should not happen if our input is an "ordinary" dx/d8-generated
       // dex file, but things like IODI can generate debug entries that don't
       // correspond to code addresses.
@@ -266,7 +292,7 @@ static void associate_debug_entries(IRList* ir,
       mentry = new MethodItemEntry(std::move(entry.pos));
       break;
     }
-    ir->insert_before(ir->iterator_to(*insert_point_it->second), *mentry);
+    ir->insert_before(ir->iterator_to(*insert_point), *mentry);
   }
   dbg.get_entries().clear();
 }
@@ -274,7 +300,7 @@ static void associate_debug_entries(IRList* ir,
 // Insert MFLOW_TRYs and MFLOW_CATCHes
 static void associate_try_items(IRList* ir,
                                 DexCode& code,
-                                const EntryAddrBiMap& bm) {
+                                const EntryAddrMap& bm) {
   // We insert the catches after the try markers to handle the case where the
   // try block ends on the same instruction as the beginning of the catch block.
   // We need to end the try block before we start the catch block, not vice
@@ -355,7 +381,7 @@ void generate_load_params(const DexMethod* method,
 
 void translate_dex_to_ir(
     IRList* ir_list,
-    const EntryAddrBiMap& bm,
+    const EntryAddrMap& bm,
     std::unordered_map<MethodItemEntry*, std::unique_ptr<DexOpcodeData>>&
         entry_to_data) {
   for (auto it = ir_list->begin(); it != ir_list->end(); ++it) {
@@ -450,9 +476,12 @@ void translate_dex_to_ir(
 void balloon(DexMethod* method, IRList* ir_list) {
   auto dex_code = method->get_dex_code();
   auto instructions = dex_code->release_instructions();
-  // This is a 1-to-1 map between MethodItemEntries of type MFLOW_OPCODE and
-  // address offsets.
-  EntryAddrBiMap bm;
+  // Maps between MethodItemEntries of type MFLOW_OPCODE and address offsets.
+  size_t code_units = 0;
+  for (auto* insn : instructions) {
+    code_units += insn->size();
+  }
+  EntryAddrMap bm(code_units);
   std::unordered_map<MethodItemEntry*, std::unique_ptr<DexOpcodeData>>
       entry_to_data;
   std::unordered_set<DexOpcodeData*> data_set;
@@ -479,11 +508,11 @@ void balloon(DexMethod* method, IRList* ir_list) {
       mei = new MethodItemEntry(insn);
     }
     ir_list->push_back(*mei);
-    bm.insert(EntryAddrBiMap::relation(mei, addr));
+    bm.insert(mei, insn, addr);
     TRACE(MTRANS, 5, "%08x: %s[mei %p]", addr, SHOW(insn), mei);
     addr += insn->size();
   }
-  bm.insert(EntryAddrBiMap::relation(&*ir_list->end(), addr));
+  bm.insert_end(&*ir_list->end());
 
   generate_branch_targets(ir_list, bm, entry_to_data);
   associate_try_items(ir_list, *dex_code, bm);
@@ -660,6 +689,16 @@ IRCode::IRCode(std::unique_ptr<cfg::ControlFlowGraph> cfg) {
 
 void IRCode::cleanup_debug() { m_ir_list->cleanup_debug(); }
 
+namespace {
+std::atomic<size_t> s_cfg_builds{0};
+std::atomic<size_t> s_cfg_linearizations{0};
+} // namespace
+
+IRCode::CfgCycleCounts IRCode::get_cfg_cycle_counts() {
+  return {s_cfg_builds.load(std::memory_order_relaxed),
+          s_cfg_linearizations.load(std::memory_order_relaxed)};
+}
+
 void IRCode::build_cfg(bool editable,
                        bool rebuild_editable_even_if_already_built) {
   always_assert_log(
@@ -675,6 +714,7 @@ void IRCode::build_cfg(bool editable,
   clear_cfg();
   m_cfg = std::make_unique<cfg::ControlFlowGraph>(m_ir_list, m_registers_size,
                                                   editable);
+  s_cfg_builds.fetch_add(1, std::memory_order_relaxed);
 }
 
 void IRCode::clear_cfg(
@@ -698,6 +738,7 @@ void IRCode::clear_cfg(
       delete m_ir_list;
     }
     m_ir_list = m_cfg->linearize(custom_strategy);
+    s_cfg_linearizations.fetch_add(1, std::memory_order_relaxed);
   }
 
   if (deleted_insns != nullptr) {
@@ -1255,6 +1296,17 @@ size_t IRCode::count_opcodes() const {
   return m_ir_list->count_opcodes();
 }
 
+size_t IRCode::estimate_num_entries() const {
+  if (editable_cfg_built()) {
+    size_t num_entries{0};
+    for (const auto* block : m_cfg->blocks()) {
+      num_entries += block->num_entries();
+    }
+    return num_entries;
+  }
+  return m_ir_list->size();
+}
+
 bool IRCode::has_try_blocks() const {
   if (editable_cfg_built()) {
     auto b = this->cfg().blocks();
@@ -172,9 +172,9 @@ class IRCode {
   // Changes to an editable CFG are reflected in IRCode after `clear_cfg` is
   // called. For editable cfg, it is only rebuilt when the flag
   // rebuild_editable_even_if_already_built is true. Otherwise, the current
-  // editable cfg will be kept.
+  // editable cfg will be kept, which avoids a linearize/rebuild cycle.
   void build_cfg(bool editable = true,
-                 bool rebuild_editable_even_if_already_built = true);
+                 bool rebuild_editable_even_if_already_built = false);
 
   // if the cfg was editable, linearize it back into m_ir_list
   // custom_strategy controls the linearization of the CFG.
@@ -189,6 +189,15 @@ class IRCode {
   bool cfg_built() const;
   bool editable_cfg_built() const;
 
+  struct CfgCycleCounts {
+    size_t builds{0};
+    size_t linearizations{0};
+  };
+
+  // The number of CFGs built and of editable CFGs linearized into an IRList,
+  // over all IRCode instances since the start of the process.
+  static CfgCycleCounts get_cfg_cycle_counts();
+
   /* Generate DexCode from IRCode */
   std::unique_ptr<DexCode> sync(const DexMethod*);
 
@@ -302,6 +311,14 @@ class IRCode {
    */
   size_t count_opcodes() const;
 
+  /*
+   * Returns the number of MethodItemEntries, which besides the instructions
+   * includes positions, debug info and try markers. Unlike count_opcodes(),
+   * this does not visit every instruction, so it is a cheap estimate of the
+   * size of the code.
+   */
+  size_t estimate_num_entries() const;
+
   void sanity_check() const { m_ir_list->sanity_check(); }
 
   bool has_try_blocks() const;
@@ -12,12 +12,28 @@
 #include "DexInstruction.h"
 #include "DexMethodHandle.h"
 #include "DexUtil.h"
+#include "IRPoolAllocator.h"
 #include "Show.h"
 
 #include <boost/range/any_range.hpp>
 #include <cstring>
 #include <iterator>
 
+static_assert(sizeof(IRInstruction) == 32 || sizeof(void*) != 8,
+              "IRInstruction layout changed unexpectedly");
+
+namespace {
+using InstructionPool = ir_pool::FixedSizePool<sizeof(IRInstruction)>;
+} // namespace
+
+void* IRInstruction::operator new(size_t size) {
+  return ir_pool::allocate<InstructionPool>(size, sizeof(IRInstruction));
+}
+
+void IRInstruction::operator delete(void* ptr, size_t size) {
+  ir_pool::deallocate<InstructionPool>(ptr, size, sizeof(IRInstruction));
+}
+
 IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
   auto count = opcode_impl::min_srcs_size(op);
   if (count <= MAX_NUM_INLINE_SRCS) {
@@ -141,6 +141,10 @@ class IRInstruction final {
   IRInstruction(const IRInstruction&);
   ~IRInstruction();
 
+  // Instructions may come from a pool, see IRPoolAllocator.h.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /*
    * Ensures that wide registers only have their first register referenced
    * in the srcs list. This only affects invoke-* instructions.
@@ -413,11 +417,12 @@ class IRInstruction final {
  private:
   std::string show_opcode() const; // To avoid "Show.h" in the header.
 
-  // 2 is chosen because it's the maximum number of registers (32 bits each) we
-  // can fit in the size of a pointer (on a 64bit system).
-  // In practice, most IRInstructions have 2 or fewer source registers, so we
-  // can avoid a vector allocation most of the time.
-  static constexpr uint8_t MAX_NUM_INLINE_SRCS = 2;
+  // In practice, most IRInstructions have 3 or fewer source registers (e.g.
+  // aput, iput, and most invokes), so we can avoid a vector allocation most of
+  // the time, in particular when instructions are copied. 4 is chosen because
+  // it rounds the instruction up to 32 bytes, which is the size class the
+  // allocator would hand out for 24 bytes anyway.
+  static constexpr uint8_t MAX_NUM_INLINE_SRCS = 4;
 
   // The fields of IRInstruction are carefully selected and ordered to avoid
   // empty packing bytes and minimize total size. This is optimized for 8 byte
@@ -454,7 +459,7 @@ class IRInstruction final {
     // Be careful to new and delete it correctly!
     std::vector<reg_t>* m_srcs;
   };
-  // 24 bytes total
+  // 32 bytes total
 };
 
 /*
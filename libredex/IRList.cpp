@@ -7,7 +7,10 @@
 
 #include "IRList.h"
 
+#include <array>
+#include <boost/functional/hash.hpp>
 #include <iterator>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
@@ -17,6 +20,7 @@
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
+#include "IRPoolAllocator.h"
 #include "Show.h"
 
 bool TryEntry::operator==(const TryEntry& other) const {
@@ -113,6 +117,18 @@ MethodItemEntry::MethodItemEntry(const MethodItemEntry& that)
   }
 }
 
+namespace {
+using EntryPool = ir_pool::FixedSizePool<sizeof(MethodItemEntry)>;
+} // namespace
+
+void* MethodItemEntry::operator new(size_t size) {
+  return ir_pool::allocate<EntryPool>(size, sizeof(MethodItemEntry));
+}
+
+void MethodItemEntry::operator delete(void* ptr, size_t size) {
+  ir_pool::deallocate<EntryPool>(ptr, size, sizeof(MethodItemEntry));
+}
+
 MethodItemEntry::~MethodItemEntry() {
   switch (type) {
   case MFLOW_TRY:
@@ -955,6 +971,106 @@ void IRList::insn_clear_and_dispose() {
   });
 }
 
+namespace {
+
+size_t hash_vals(const SourceBlock::Val* vals, size_t size) {
+  size_t seed = size;
+  for (size_t i = 0; i != size; ++i) {
+    const auto& val = vals[i];
+    if (!val) {
+      // All the "none" values are equal.
+      boost::hash_combine(seed, 1);
+      continue;
+    }
+    // Equal floats have equal hashes, including 0 and -0.
+    boost::hash_combine(seed, val->val == 0 ? 0.0f : val->val);
+    boost::hash_combine(seed, val->appear100 == 0 ? 0.0f : val->appear100);
+  }
+  return seed;
+}
+
+// The pool of interned values is sharded by hash to reduce contention.
+struct ValsPoolShard {
+  std::mutex mutex;
+  std::unordered_multimap<size_t, void*> entries;
+};
+
+constexpr size_t NUM_VALS_POOL_SHARDS = 64;
+
+std::array<ValsPoolShard, NUM_VALS_POOL_SHARDS>& vals_pool() {
+  static auto* pool = new std::array<ValsPoolShard, NUM_VALS_POOL_SHARDS>();
+  return *pool;
+}
+
+} // namespace
+
+SourceBlock::InternedVals::InternedVals(const Val* vals, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  auto hash = hash_vals(vals, size);
+  auto& shard = vals_pool()[hash % NUM_VALS_POOL_SHARDS];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto range = shard.entries.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto* entry = static_cast<Entry*>(it->second);
+    if (entry->size == size &&
+        std::equal(vals, vals + size, entry->vals.get())) {
+      // Entries are only ever erased with a reference count of zero while
+      // holding the lock, so this cannot revive a dead entry.
+      entry->refs.fetch_add(1, std::memory_order_relaxed);
+      m_entry = entry;
+      return;
+    }
+  }
+  m_entry = new Entry();
+  m_entry->hash = hash;
+  m_entry->size = size;
+  m_entry->vals = std::make_unique<Val[]>(size);
+  std::copy(vals, vals + size, m_entry->vals.get());
+  shard.entries.emplace(hash, m_entry);
+}
+
+void SourceBlock::InternedVals::release(Entry* entry) {
+  // Only dropping what may be the last reference needs the lock, so that it
+  // cannot race with interning the same values again.
+  auto refs = entry->refs.load(std::memory_order_relaxed);
+  while (refs > 1) {
+    if (entry->refs.compare_exchange_weak(refs, refs - 1,
+                                          std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+  auto& shard = vals_pool()[entry->hash % NUM_VALS_POOL_SHARDS];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  auto range = shard.entries.equal_range(entry->hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == entry) {
+      shard.entries.erase(it);
+      break;
+    }
+  }
+  lock.unlock();
+  delete entry;
+}
+
+SourceBlock::InternedVals::PoolStats
+SourceBlock::InternedVals::get_pool_stats() {
+  PoolStats stats;
+  for (auto& shard : vals_pool()) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.arrays += shard.entries.size();
+    for (auto& [_, entry] : shard.entries) {
+      stats.vals += static_cast<Entry*>(entry)->size;
+    }
+  }
+  stats.bytes = stats.arrays * sizeof(Entry) + stats.vals * sizeof(Val);
+  return stats;
+}
+
 std::string SourceBlock::show(bool quoted_src) const {
   std::ostringstream o;
 
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <boost/intrusive/list.hpp>
 #include <boost/optional.hpp>
 #include <boost/range/sub_range.hpp>
@@ -166,25 +168,77 @@ struct SourceBlock {
       return &m_val;
     }
 
+    // Scales the value, if any: a "none" value stays NaN either way.
+    void scale(float factor) { m_val.val *= factor; }
+
    private:
     ValPair m_val;
   };
+  // An interned, immutable array of values. Blocks mostly share the same
+  // values (e.g. all hot or all cold), and copies of blocks made by inlining
+  // and splitting always do, so equal arrays are stored only once, and copying
+  // the handle only bumps a reference count.
+  class InternedVals {
+   public:
+    InternedVals() = default;
+    InternedVals(const Val* vals, size_t size);
+    InternedVals(const InternedVals& other) noexcept : m_entry(other.m_entry) {
+      if (m_entry != nullptr) {
+        m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    InternedVals(InternedVals&& other) noexcept : m_entry(other.m_entry) {
+      other.m_entry = nullptr;
+    }
+    InternedVals& operator=(InternedVals other) noexcept {
+      std::swap(m_entry, other.m_entry);
+      return *this;
+    }
+    ~InternedVals() {
+      if (m_entry != nullptr) {
+        release(m_entry);
+      }
+    }
+
+    const Val& operator[](size_t i) const { return m_entry->vals[i]; }
+
+    const Val* data() const {
+      return m_entry == nullptr ? nullptr : m_entry->vals.get();
+    }
+
+    struct PoolStats {
+      size_t arrays{0};
+      size_t vals{0};
+      size_t bytes{0};
+    };
+    static PoolStats get_pool_stats();
+
+   private:
+    struct Entry {
+      std::atomic<size_t> refs{1};
+      size_t hash;
+      size_t size;
+      std::unique_ptr<Val[]> vals;
+    };
+
+    static void release(Entry* entry);
+
+    Entry* m_entry{nullptr};
+  };
+
   const uint32_t vals_size{0};
-  const std::unique_ptr<Val[]> vals;
+  InternedVals vals;
 
   SourceBlock() = default;
   SourceBlock(const DexString* src, size_t id) : src(src), id(id) {}
   SourceBlock(const DexString* src, size_t id, const std::vector<Val>& v)
-      : src(src),
-        id(id),
-        vals_size(v.size()),
-        vals(clone_vals(v.data(), v.size())) {}
+      : src(src), id(id), vals_size(v.size()), vals(v.data(), v.size()) {}
   SourceBlock(const SourceBlock& other)
       : src(other.src),
         next(other.next == nullptr ? nullptr : new SourceBlock(*other.next)),
         id(other.id),
         vals_size(other.vals_size),
-        vals(clone_vals(other.vals.get(), other.vals_size)) {}
+        vals(other.vals) {}
 
   boost::optional<float> get_val(size_t i) const {
     return vals[i] ? boost::optional<float>(vals[i]->val) : boost::none;
@@ -193,12 +247,27 @@ struct SourceBlock {
     return vals[i] ? boost::optional<float>(vals[i]->appear100) : boost::none;
   }
 
-  static std::unique_ptr<Val[]> clone_vals(const Val* vals, size_t vals_size) {
-    auto res = std::make_unique<Val[]>(vals_size);
-    for (size_t i = 0; i < vals_size; i++) {
-      res[i] = vals[i];
+  // As the values are shared, they can only be changed by replacing all of
+  // them. `fn` gets a mutable copy of the `vals_size` values.
+  template <typename Fn>
+  void update_vals(const Fn& fn) {
+    if (vals_size == 0) {
+      return;
     }
-    return res;
+    auto copy = std::make_unique<Val[]>(vals_size);
+    std::copy(vals.data(), vals.data() + vals_size, copy.get());
+    fn(copy.get());
+    vals = InternedVals(copy.get(), vals_size);
+  }
+
+  void set_val(size_t i, const Val& val) {
+    update_vals([&](Val* new_vals) { new_vals[i] = val; });
+  }
+
+  void fill_vals(const Val& val) {
+    update_vals([&](Val* new_vals) {
+      std::fill(new_vals, new_vals + vals_size, val);
+    });
   }
 
   template <typename Fn>
@@ -259,15 +328,17 @@ struct SourceBlock {
 
   void max(const SourceBlock& other) {
     size_t len = std::min(vals_size, other.vals_size);
-    for (size_t i = 0; i != len; ++i) {
-      if (!vals[i]) {
-        vals[i] = other.vals[i];
-      } else if (other.vals[i]) {
-        vals[i]->val = std::max(vals[i]->val, other.vals[i]->val);
-        vals[i]->appear100 =
-            std::max(vals[i]->appear100, other.vals[i]->appear100);
+    update_vals([&](Val* new_vals) {
+      for (size_t i = 0; i != len; ++i) {
+        if (!new_vals[i]) {
+          new_vals[i] = other.vals[i];
+        } else if (other.vals[i]) {
+          new_vals[i]->val = std::max(new_vals[i]->val, other.vals[i]->val);
+          new_vals[i]->appear100 =
+              std::max(new_vals[i]->appear100, other.vals[i]->appear100);
+        }
       }
-    }
+    });
   }
 };
 
@@ -357,6 +428,10 @@ struct MethodItemEntry {
   MethodItemEntry() : type(MFLOW_FALLTHROUGH) {}
   ~MethodItemEntry();
 
+  // Entries may come from a pool, see IRPoolAllocator.h.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /*
    * This should only ever be used by the instruction lowering step. Do NOT use
    * it in passes!
@@ -7,18 +7,26 @@
 
 #include "IRMetaIO.h"
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 
 #include "Show.h"
 #include "StringBuilder.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 constexpr const char* IRMETA_FILE_NAME = "/irmeta.bin";
 
+constexpr const char* IRMETA_SHARD_FILE_PREFIX = "/irmeta.";
+
 constexpr const char* IRMETA_MAGIC_NUMBER = "rdx.\n\x14\x12\x00";
 
+// The top-level file only lists how many shards there are. Each shard is
+// laid out like a single unsharded file used to be.
+constexpr const char* IRMETA_INDEX_MAGIC_NUMBER = "rdx.\n\x14\x13\x00";
+
 PACKED(struct ir_meta_header_t {
   char magic[8];
   uint32_t checksum; // reserved
@@ -27,6 +35,12 @@ PACKED(struct ir_meta_header_t {
   uint32_t rstate_size; // size of IRMetaIO::bit_rstate_t.
 });
 
+PACKED(struct ir_meta_index_t {
+  char magic[8];
+  uint32_t num_shards;
+  uint32_t rstate_size; // size of IRMetaIO::bit_rstate_t.
+});
+
 void serialize_str(const std::string_view str, std::ofstream& ostrm) {
   char data[5];
   write_uleb128((uint8_t*)data, str.size());
@@ -208,12 +222,12 @@ void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
     }
   }
 }
-} // namespace
 
-namespace ir_meta_io {
+std::string get_shard_file_name(const std::string& dir, size_t shard) {
+  return dir + IRMETA_SHARD_FILE_PREFIX + std::to_string(shard) + ".bin";
+}
 
-void dump(const Scope& classes, const std::string& output_dir) {
-  std::string output_file = output_dir + IRMETA_FILE_NAME;
+void dump_shard(const Scope& classes, const std::string& output_file) {
   std::ofstream ostrm(output_file, std::ios::binary | std::ios::trunc);
 
   ir_meta_header_t meta_header;
@@ -221,7 +235,7 @@ void dump(const Scope& classes, const std::string& output_dir) {
   meta_header.checksum = 0;
   meta_header.file_size = 0;
   meta_header.classes_size = 0;
-  meta_header.rstate_size = sizeof(IRMetaIO::bit_rstate_t);
+  meta_header.rstate_size = sizeof(ir_meta_io::IRMetaIO::bit_rstate_t);
   ostrm.write((char*)&meta_header, sizeof(meta_header));
 
   serialize_class_data(classes, ostrm);
@@ -234,8 +248,7 @@ void dump(const Scope& classes, const std::string& output_dir) {
   ostrm.write((char*)&meta_header, sizeof(meta_header));
 }
 
-bool load(const std::string& input_dir) {
-  std::string input_file = input_dir + IRMETA_FILE_NAME;
+bool load_shard(const std::string& input_file) {
   std::ifstream istrm(input_file, std::ios::binary | std::ios::in);
   if (!istrm.is_open()) {
     std::cerr << "Can not open " << input_file << std::endl;
@@ -244,11 +257,11 @@ bool load(const std::string& input_dir) {
 
   ir_meta_header_t meta_header;
   istrm.read((char*)&meta_header, sizeof(meta_header));
-  if (strcmp(meta_header.magic, IRMETA_MAGIC_NUMBER) != 0) {
+  if (memcmp(meta_header.magic, IRMETA_MAGIC_NUMBER, 8) != 0) {
     std::cerr << "May be not valid meta file\n";
     return false;
   }
-  if (meta_header.rstate_size != sizeof(IRMetaIO::bit_rstate_t)) {
+  if (meta_header.rstate_size != sizeof(ir_meta_io::IRMetaIO::bit_rstate_t)) {
     std::cerr << "Could not load the outdated IR meta data\n";
     return false;
   }
@@ -258,6 +271,71 @@ bool load(const std::string& input_dir) {
 
   return true;
 }
+} // namespace
+
+namespace ir_meta_io {
+
+void dump(const Scope& classes, const std::string& output_dir) {
+  dump(std::vector<Scope>{classes}, output_dir);
+}
+
+void dump(const std::vector<Scope>& shards, const std::string& output_dir) {
+  workqueue_run_for<size_t>(0, shards.size(), [&](size_t i) {
+    dump_shard(shards[i], get_shard_file_name(output_dir, i));
+  });
+
+  std::string output_file = output_dir + IRMETA_FILE_NAME;
+  std::ofstream ostrm(output_file, std::ios::binary | std::ios::trunc);
+  ir_meta_index_t meta_index;
+  memcpy(meta_index.magic, IRMETA_INDEX_MAGIC_NUMBER, 8);
+  meta_index.num_shards = shards.size();
+  meta_index.rstate_size = sizeof(IRMetaIO::bit_rstate_t);
+  ostrm.write((char*)&meta_index, sizeof(meta_index));
+}
+
+bool load(const std::string& input_dir) {
+  std::string input_file = input_dir + IRMETA_FILE_NAME;
+  std::ifstream istrm(input_file, std::ios::binary | std::ios::in);
+  if (!istrm.is_open()) {
+    std::cerr << "Can not open " << input_file << std::endl;
+    return false;
+  }
+
+  char magic[8] = {};
+  istrm.read(magic, sizeof(magic));
+  if (memcmp(magic, IRMETA_MAGIC_NUMBER, 8) == 0) {
+    // A single unsharded file, as written by older versions.
+    istrm.close();
+    return load_shard(input_file);
+  }
+  if (memcmp(magic, IRMETA_INDEX_MAGIC_NUMBER, 8) != 0) {
+    std::cerr << "May be not valid meta file\n";
+    return false;
+  }
+
+  ir_meta_index_t meta_index;
+  memcpy(meta_index.magic, magic, sizeof(magic));
+  istrm.read((char*)&meta_index + sizeof(magic),
+             sizeof(meta_index) - sizeof(magic));
+  if (!istrm) {
+    std::cerr << "Truncated meta index " << input_file << std::endl;
+    return false;
+  }
+  if (meta_index.rstate_size != sizeof(IRMetaIO::bit_rstate_t)) {
+    std::cerr << "Could not load the outdated IR meta data\n";
+    return false;
+  }
+
+  // Every class is in exactly one shard, so the shards update disjoint
+  // objects and can be loaded concurrently.
+  std::atomic<bool> success{true};
+  workqueue_run_for<size_t>(0, meta_index.num_shards, [&](size_t i) {
+    if (!load_shard(get_shard_file_name(input_dir, i))) {
+      success = false;
+    }
+  });
+  return success;
+}
 
 void IRMetaIO::serialize_rstate(const ReferencedState& rstate,
                                 std::ofstream& ostrm) {
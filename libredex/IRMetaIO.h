@@ -16,6 +16,12 @@ namespace ir_meta_io {
 
 void dump(const Scope& classes, const std::string& output_dir);
 
+/**
+ * Write the meta data of each shard, typically one per dex, into its own file
+ * in parallel. `load` reads the shards back in parallel as well.
+ */
+void dump(const std::vector<Scope>& shards, const std::string& output_dir);
+
 bool load(const std::string& input_dir);
 
 class IRMetaIO {
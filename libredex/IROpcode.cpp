@@ -21,22 +21,6 @@ std::ostream& operator<<(std::ostream& os, const IROpcode& op) {
 
 namespace opcode {
 
-// clang-format off
-Ref ref(IROpcode opcode) {
-  switch (opcode) {
-#define OP(uc, lc, ref, ...) \
-  case OPCODE_##uc:          \
-    return ref;
-#define IOP(uc, lc, ref, ...) \
-  case IOPCODE_##uc:          \
-    return ref;
-#define OPRANGE(...)
-#include "IROpcodes.def"
-  }
-  not_reached_log("Unexpected opcode 0x%x", opcode);
-}
-// clang-format on
-
 std::optional<IROpcode> from_dex_opcode(DexOpcode op) {
   switch (op) {
   case DOPCODE_NOP:
@@ -854,151 +838,6 @@ DexOpcode range_version(IROpcode op) {
   }
 }
 
-bool has_variable_srcs_size(IROpcode op) {
-  switch (op) {
-  case OPCODE_INVOKE_VIRTUAL:
-  case OPCODE_INVOKE_DIRECT:
-  case OPCODE_INVOKE_SUPER:
-  case OPCODE_INVOKE_STATIC:
-  case OPCODE_INVOKE_INTERFACE:
-  case OPCODE_INVOKE_CUSTOM:
-  case OPCODE_INVOKE_POLYMORPHIC:
-  case OPCODE_FILLED_NEW_ARRAY:
-    return true;
-  default:
-    return false;
-  }
-}
-
-bool may_throw(IROpcode op) {
-  switch (op) {
-  case OPCODE_CONST_STRING:
-  case OPCODE_CONST_CLASS:
-  case IOPCODE_INIT_CLASS:
-  case IOPCODE_WRITE_BARRIER:
-  case OPCODE_MONITOR_ENTER:
-  case OPCODE_MONITOR_EXIT:
-  case OPCODE_CHECK_CAST:
-  case OPCODE_INSTANCE_OF:
-  case OPCODE_ARRAY_LENGTH:
-  case OPCODE_NEW_INSTANCE:
-  case OPCODE_NEW_ARRAY:
-  case OPCODE_FILLED_NEW_ARRAY:
-  case OPCODE_FILL_ARRAY_DATA:
-  case OPCODE_AGET:
-  case OPCODE_AGET_WIDE:
-  case OPCODE_AGET_OBJECT:
-  case OPCODE_AGET_BOOLEAN:
-  case OPCODE_AGET_BYTE:
-  case OPCODE_AGET_CHAR:
-  case OPCODE_AGET_SHORT:
-  case OPCODE_APUT:
-  case OPCODE_APUT_WIDE:
-  case OPCODE_APUT_OBJECT:
-  case OPCODE_APUT_BOOLEAN:
-  case OPCODE_APUT_BYTE:
-  case OPCODE_APUT_CHAR:
-  case OPCODE_APUT_SHORT:
-  case OPCODE_IGET:
-  case OPCODE_IGET_WIDE:
-  case OPCODE_IGET_OBJECT:
-  case OPCODE_IGET_BOOLEAN:
-  case OPCODE_IGET_BYTE:
-  case OPCODE_IGET_CHAR:
-  case OPCODE_IGET_SHORT:
-  case OPCODE_IPUT:
-  case OPCODE_IPUT_WIDE:
-  case OPCODE_IPUT_OBJECT:
-  case OPCODE_IPUT_BOOLEAN:
-  case OPCODE_IPUT_BYTE:
-  case OPCODE_IPUT_CHAR:
-  case OPCODE_IPUT_SHORT:
-  case OPCODE_SGET:
-  case OPCODE_SGET_WIDE:
-  case OPCODE_SGET_OBJECT:
-  case OPCODE_SGET_BOOLEAN:
-  case OPCODE_SGET_BYTE:
-  case OPCODE_SGET_CHAR:
-  case OPCODE_SGET_SHORT:
-  case OPCODE_SPUT:
-  case OPCODE_SPUT_WIDE:
-  case OPCODE_SPUT_OBJECT:
-  case OPCODE_SPUT_BOOLEAN:
-  case OPCODE_SPUT_BYTE:
-  case OPCODE_SPUT_CHAR:
-  case OPCODE_SPUT_SHORT:
-  case OPCODE_INVOKE_VIRTUAL:
-  case OPCODE_INVOKE_SUPER:
-  case OPCODE_INVOKE_DIRECT:
-  case OPCODE_INVOKE_STATIC:
-  case OPCODE_INVOKE_INTERFACE:
-  case OPCODE_INVOKE_CUSTOM:
-  case OPCODE_INVOKE_POLYMORPHIC:
-  case OPCODE_DIV_INT:
-  case OPCODE_REM_INT:
-  case OPCODE_DIV_LONG:
-  case OPCODE_REM_LONG:
-  case OPCODE_DIV_INT_LIT:
-  case OPCODE_REM_INT_LIT:
-  case OPCODE_CONST_METHOD_HANDLE:
-  case OPCODE_CONST_METHOD_TYPE:
-    return true;
-  default:
-    return false;
-  }
-}
-
-Branchingness branchingness(IROpcode op) {
-  if (may_throw(op)) {
-    return BRANCH_THROW;
-  }
-
-  switch (op) {
-  case OPCODE_RETURN_VOID:
-  case OPCODE_RETURN:
-  case OPCODE_RETURN_WIDE:
-  case OPCODE_RETURN_OBJECT:
-    return BRANCH_RETURN;
-  case OPCODE_THROW:
-    return BRANCH_THROW;
-  case OPCODE_GOTO:
-    return BRANCH_GOTO;
-  case OPCODE_SWITCH:
-    return BRANCH_SWITCH;
-  case OPCODE_IF_EQ:
-  case OPCODE_IF_NE:
-  case OPCODE_IF_LT:
-  case OPCODE_IF_GE:
-  case OPCODE_IF_GT:
-  case OPCODE_IF_LE:
-  case OPCODE_IF_EQZ:
-  case OPCODE_IF_NEZ:
-  case OPCODE_IF_LTZ:
-  case OPCODE_IF_GEZ:
-  case OPCODE_IF_GTZ:
-  case OPCODE_IF_LEZ:
-    return BRANCH_IF;
-  default:
-    return BRANCH_NONE;
-  }
-}
-
-bool has_range_form(IROpcode op) {
-  switch (op) {
-  case OPCODE_INVOKE_DIRECT:
-  case OPCODE_INVOKE_STATIC:
-  case OPCODE_INVOKE_SUPER:
-  case OPCODE_INVOKE_VIRTUAL:
-  case OPCODE_INVOKE_INTERFACE:
-  case OPCODE_INVOKE_CUSTOM:
-  case OPCODE_INVOKE_POLYMORPHIC:
-  case OPCODE_FILLED_NEW_ARRAY:
-    return true;
-  default:
-    return false;
-  }
-}
-
 bool is_move_result_any(IROpcode op) {
   return is_a_move_result(op) || is_a_move_result_pseudo(op);
 }
@@ -1325,68 +1164,6 @@ IROpcode invert_conditional_branch(IROpcode op) {
   }
 }
 
-bool has_side_effects(IROpcode opc) {
-  switch (opc) {
-  case OPCODE_RETURN_VOID:
-  case OPCODE_RETURN:
-  case OPCODE_RETURN_WIDE:
-  case OPCODE_RETURN_OBJECT:
-  case OPCODE_MONITOR_ENTER:
-  case OPCODE_MONITOR_EXIT:
-  case OPCODE_FILL_ARRAY_DATA:
-  case OPCODE_THROW:
-  case OPCODE_GOTO:
-  case OPCODE_SWITCH:
-  case OPCODE_IF_EQ:
-  case OPCODE_IF_NE:
-  case OPCODE_IF_LT:
-  case OPCODE_IF_GE:
-  case OPCODE_IF_GT:
-  case OPCODE_IF_LE:
-  case OPCODE_IF_EQZ:
-  case OPCODE_IF_NEZ:
-  case OPCODE_IF_LTZ:
-  case OPCODE_IF_GEZ:
-  case OPCODE_IF_GTZ:
-  case OPCODE_IF_LEZ:
-  case OPCODE_APUT:
-  case OPCODE_APUT_WIDE:
-  case OPCODE_APUT_OBJECT:
-  case OPCODE_APUT_BOOLEAN:
-  case OPCODE_APUT_BYTE:
-  case OPCODE_APUT_CHAR:
-  case OPCODE_APUT_SHORT:
-  case OPCODE_IPUT:
-  case OPCODE_IPUT_WIDE:
-  case OPCODE_IPUT_OBJECT:
-  case OPCODE_IPUT_BOOLEAN:
-  case OPCODE_IPUT_BYTE:
-  case OPCODE_IPUT_CHAR:
-  case OPCODE_IPUT_SHORT:
-  case OPCODE_SPUT:
-  case OPCODE_SPUT_WIDE:
-  case OPCODE_SPUT_OBJECT:
-  case OPCODE_SPUT_BOOLEAN:
-  case OPCODE_SPUT_BYTE:
-  case OPCODE_SPUT_CHAR:
-  case OPCODE_SPUT_SHORT:
-  case OPCODE_INVOKE_VIRTUAL:
-  case OPCODE_INVOKE_SUPER:
-  case OPCODE_INVOKE_DIRECT:
-  case OPCODE_INVOKE_STATIC:
-  case OPCODE_INVOKE_INTERFACE:
-  case IOPCODE_LOAD_PARAM:
-  case IOPCODE_LOAD_PARAM_OBJECT:
-  case IOPCODE_LOAD_PARAM_WIDE:
-  case IOPCODE_INIT_CLASS:
-  case IOPCODE_WRITE_BARRIER:
-    return true;
-  default:
-    return false;
-  }
-  not_reached();
-}
-
 } // namespace opcode
 
 namespace opcode_impl {
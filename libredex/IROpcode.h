@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <iosfwd>
 #include <optional>
@@ -34,6 +35,15 @@ enum class Ref {
   Proto
 };
 
+enum Branchingness : uint8_t {
+  BRANCH_NONE,
+  BRANCH_RETURN,
+  BRANCH_GOTO,
+  BRANCH_IF,
+  BRANCH_SWITCH,
+  BRANCH_THROW // both always throw and may_throw
+};
+
 } // namespace opcode
 
 enum IROpcode : uint16_t {
@@ -50,9 +60,285 @@ std::ostream& operator<<(std::ostream& os, const IROpcode& op);
 
 using bit_width_t = uint8_t;
 
+// The values of IROpcode are dense, starting at 0.
+constexpr size_t NUM_IROPCODES = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+/*
+ * The opcode properties that are queried most often are looked up in a table
+ * that is computed at compile time from the definitions below, so that their
+ * predicates are single loads, and can be used in constant expressions.
+ */
+namespace opcode_properties_impl {
+
+// clang-format off
+constexpr opcode::Ref ref(IROpcode opcode) {
+  switch (opcode) {
+#define OP(uc, lc, ref, ...) \
+  case OPCODE_##uc:          \
+    return opcode::ref;
+#define IOP(uc, lc, ref, ...) \
+  case IOPCODE_##uc:          \
+    return opcode::ref;
+#define OPRANGE(...)
+#include "IROpcodes.def"
+  }
+  return opcode::Ref::None;
+}
+// clang-format on
+
+constexpr bool may_throw(IROpcode op) {
+  switch (op) {
+  case OPCODE_CONST_STRING:
+  case OPCODE_CONST_CLASS:
+  case IOPCODE_INIT_CLASS:
+  case IOPCODE_WRITE_BARRIER:
+  case OPCODE_MONITOR_ENTER:
+  case OPCODE_MONITOR_EXIT:
+  case OPCODE_CHECK_CAST:
+  case OPCODE_INSTANCE_OF:
+  case OPCODE_ARRAY_LENGTH:
+  case OPCODE_NEW_INSTANCE:
+  case OPCODE_NEW_ARRAY:
+  case OPCODE_FILLED_NEW_ARRAY:
+  case OPCODE_FILL_ARRAY_DATA:
+  case OPCODE_AGET:
+  case OPCODE_AGET_WIDE:
+  case OPCODE_AGET_OBJECT:
+  case OPCODE_AGET_BOOLEAN:
+  case OPCODE_AGET_BYTE:
+  case OPCODE_AGET_CHAR:
+  case OPCODE_AGET_SHORT:
+  case OPCODE_APUT:
+  case OPCODE_APUT_WIDE:
+  case OPCODE_APUT_OBJECT:
+  case OPCODE_APUT_BOOLEAN:
+  case OPCODE_APUT_BYTE:
+  case OPCODE_APUT_CHAR:
+  case OPCODE_APUT_SHORT:
+  case OPCODE_IGET:
+  case OPCODE_IGET_WIDE:
+  case OPCODE_IGET_OBJECT:
+  case OPCODE_IGET_BOOLEAN:
+  case OPCODE_IGET_BYTE:
+  case OPCODE_IGET_CHAR:
+  case OPCODE_IGET_SHORT:
+  case OPCODE_IPUT:
+  case OPCODE_IPUT_WIDE:
+  case OPCODE_IPUT_OBJECT:
+  case OPCODE_IPUT_BOOLEAN:
+  case OPCODE_IPUT_BYTE:
+  case OPCODE_IPUT_CHAR:
+  case OPCODE_IPUT_SHORT:
+  case OPCODE_SGET:
+  case OPCODE_SGET_WIDE:
+  case OPCODE_SGET_OBJECT:
+  case OPCODE_SGET_BOOLEAN:
+  case OPCODE_SGET_BYTE:
+  case OPCODE_SGET_CHAR:
+  case OPCODE_SGET_SHORT:
+  case OPCODE_SPUT:
+  case OPCODE_SPUT_WIDE:
+  case OPCODE_SPUT_OBJECT:
+  case OPCODE_SPUT_BOOLEAN:
+  case OPCODE_SPUT_BYTE:
+  case OPCODE_SPUT_CHAR:
+  case OPCODE_SPUT_SHORT:
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_INTERFACE:
+  case OPCODE_INVOKE_CUSTOM:
+  case OPCODE_INVOKE_POLYMORPHIC:
+  case OPCODE_DIV_INT:
+  case OPCODE_REM_INT:
+  case OPCODE_DIV_LONG:
+  case OPCODE_REM_LONG:
+  case OPCODE_DIV_INT_LIT:
+  case OPCODE_REM_INT_LIT:
+  case OPCODE_CONST_METHOD_HANDLE:
+  case OPCODE_CONST_METHOD_TYPE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+constexpr bool has_side_effects(IROpcode opc) {
+  switch (opc) {
+  case OPCODE_RETURN_VOID:
+  case OPCODE_RETURN:
+  case OPCODE_RETURN_WIDE:
+  case OPCODE_RETURN_OBJECT:
+  case OPCODE_MONITOR_ENTER:
+  case OPCODE_MONITOR_EXIT:
+  case OPCODE_FILL_ARRAY_DATA:
+  case OPCODE_THROW:
+  case OPCODE_GOTO:
+  case OPCODE_SWITCH:
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_NE:
+  case OPCODE_IF_LT:
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GT:
+  case OPCODE_IF_LE:
+  case OPCODE_IF_EQZ:
+  case OPCODE_IF_NEZ:
+  case OPCODE_IF_LTZ:
+  case OPCODE_IF_GEZ:
+  case OPCODE_IF_GTZ:
+  case OPCODE_IF_LEZ:
+  case OPCODE_APUT:
+  case OPCODE_APUT_WIDE:
+  case OPCODE_APUT_OBJECT:
+  case OPCODE_APUT_BOOLEAN:
+  case OPCODE_APUT_BYTE:
+  case OPCODE_APUT_CHAR:
+  case OPCODE_APUT_SHORT:
+  case OPCODE_IPUT:
+  case OPCODE_IPUT_WIDE:
+  case OPCODE_IPUT_OBJECT:
+  case OPCODE_IPUT_BOOLEAN:
+  case OPCODE_IPUT_BYTE:
+  case OPCODE_IPUT_CHAR:
+  case OPCODE_IPUT_SHORT:
+  case OPCODE_SPUT:
+  case OPCODE_SPUT_WIDE:
+  case OPCODE_SPUT_OBJECT:
+  case OPCODE_SPUT_BOOLEAN:
+  case OPCODE_SPUT_BYTE:
+  case OPCODE_SPUT_CHAR:
+  case OPCODE_SPUT_SHORT:
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_INTERFACE:
+  case IOPCODE_LOAD_PARAM:
+  case IOPCODE_LOAD_PARAM_OBJECT:
+  case IOPCODE_LOAD_PARAM_WIDE:
+  case IOPCODE_INIT_CLASS:
+  case IOPCODE_WRITE_BARRIER:
+    return true;
+  default:
+    return false;
+  }
+}
+
+constexpr bool has_range_form(IROpcode op) {
+  switch (op) {
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_INTERFACE:
+  case OPCODE_INVOKE_CUSTOM:
+  case OPCODE_INVOKE_POLYMORPHIC:
+  case OPCODE_FILLED_NEW_ARRAY:
+    return true;
+  default:
+    return false;
+  }
+}
+
+constexpr bool has_variable_srcs_size(IROpcode op) {
+  switch (op) {
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_INTERFACE:
+  case OPCODE_INVOKE_CUSTOM:
+  case OPCODE_INVOKE_POLYMORPHIC:
+  case OPCODE_FILLED_NEW_ARRAY:
+    return true;
+  default:
+    return false;
+  }
+}
+
+constexpr opcode::Branchingness branchingness(IROpcode op) {
+  if (may_throw(op)) {
+    return opcode::BRANCH_THROW;
+  }
+
+  switch (op) {
+  case OPCODE_RETURN_VOID:
+  case OPCODE_RETURN:
+  case OPCODE_RETURN_WIDE:
+  case OPCODE_RETURN_OBJECT:
+    return opcode::BRANCH_RETURN;
+  case OPCODE_THROW:
+    return opcode::BRANCH_THROW;
+  case OPCODE_GOTO:
+    return opcode::BRANCH_GOTO;
+  case OPCODE_SWITCH:
+    return opcode::BRANCH_SWITCH;
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_NE:
+  case OPCODE_IF_LT:
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GT:
+  case OPCODE_IF_LE:
+  case OPCODE_IF_EQZ:
+  case OPCODE_IF_NEZ:
+  case OPCODE_IF_LTZ:
+  case OPCODE_IF_GEZ:
+  case OPCODE_IF_GTZ:
+  case OPCODE_IF_LEZ:
+    return opcode::BRANCH_IF;
+  default:
+    return opcode::BRANCH_NONE;
+  }
+}
+
+enum Flag : uint8_t {
+  MAY_THROW = 1 << 0,
+  HAS_SIDE_EFFECTS = 1 << 1,
+  HAS_RANGE_FORM = 1 << 2,
+  HAS_VARIABLE_SRCS_SIZE = 1 << 3,
+};
+
+struct Properties {
+  opcode::Ref ref{opcode::Ref::None};
+  opcode::Branchingness branchingness{opcode::BRANCH_NONE};
+  uint8_t flags{0};
+};
+
+constexpr std::array<Properties, NUM_IROPCODES> make_properties() {
+  std::array<Properties, NUM_IROPCODES> properties{};
+  for (size_t i = 0; i < NUM_IROPCODES; ++i) {
+    auto op = static_cast<IROpcode>(i);
+    auto& p = properties[i];
+    p.ref = ref(op);
+    p.branchingness = branchingness(op);
+    p.flags = (may_throw(op) ? MAY_THROW : 0) |
+              (has_side_effects(op) ? HAS_SIDE_EFFECTS : 0) |
+              (has_range_form(op) ? HAS_RANGE_FORM : 0) |
+              (has_variable_srcs_size(op) ? HAS_VARIABLE_SRCS_SIZE : 0);
+  }
+  return properties;
+}
+
+inline constexpr std::array<Properties, NUM_IROPCODES> properties =
+    make_properties();
+
+constexpr bool has_flag(IROpcode op, Flag flag) {
+  return (properties[op].flags & flag) != 0;
+}
+
+} // namespace opcode_properties_impl
+
 namespace opcode {
 
-Ref ref(IROpcode);
+constexpr Ref ref(IROpcode op) {
+  return opcode_properties_impl::properties[op].ref;
+}
 
 /*
  * 2addr and non-2addr DexOpcode pairs will get mapped to the same IROpcode.
@@ -76,15 +362,24 @@ std::optional<IROpcode> from_dex_opcode(DexOpcode);
 DexOpcode to_dex_opcode(IROpcode);
 
 // if an IROpcode can be translated to a DexOpcode of /range format
-bool has_range_form(IROpcode);
+constexpr bool has_range_form(IROpcode op) {
+  return opcode_properties_impl::has_flag(
+      op, opcode_properties_impl::HAS_RANGE_FORM);
+}
 
-bool has_variable_srcs_size(IROpcode op);
+constexpr bool has_variable_srcs_size(IROpcode op) {
+  return opcode_properties_impl::has_flag(
+      op, opcode_properties_impl::HAS_VARIABLE_SRCS_SIZE);
+}
 
 /*
  * These instructions have observable side effects so must always be considered
  * live, regardless of whether their output is consumed by another instruction.
  */
-bool has_side_effects(IROpcode opc);
+constexpr bool has_side_effects(IROpcode op) {
+  return opcode_properties_impl::has_flag(
+      op, opcode_properties_impl::HAS_SIDE_EFFECTS);
+}
 
 bool is_move_result_any(IROpcode op);
 
@@ -97,7 +392,14 @@ bool is_binop64(IROpcode op);
  * https://cs.android.com/android/platform/superproject/main/+/main:art/libdexfile/dex/dex_instruction_list.h
  * except OPCODE_THROW, this get covered in can_throw
  */
-bool may_throw(IROpcode);
+constexpr bool may_throw(IROpcode op) {
+  return opcode_properties_impl::has_flag(op,
+                                          opcode_properties_impl::MAY_THROW);
+}
+
+constexpr Branchingness branchingness(IROpcode op) {
+  return opcode_properties_impl::properties[op].branchingness;
+}
 
 /**
  * Creates predicates from definitions in IROpcode.defs, e.g. with the
@@ -108,24 +410,26 @@ bool may_throw(IROpcode);
  *   inline bool is_load_param(IROpcode); // IOP(LOAD_PARAM, load_param, ...)
  */
 #define OPRANGE(NAME, FST, LST) \
-  inline bool is_##NAME(IROpcode op) { return (FST) <= op && op <= (LST); }
+  constexpr bool is_##NAME(IROpcode op) { return (FST) <= op && op <= (LST); }
 #define OP(UC, LC, ...) \
-  inline bool is_##LC(IROpcode op) { return op == OPCODE_##UC; }
+  constexpr bool is_##LC(IROpcode op) { return op == OPCODE_##UC; }
 #define IOP(UC, LC, ...) \
-  inline bool is_##LC(IROpcode op) { return op == IOPCODE_##UC; }
+  constexpr bool is_##LC(IROpcode op) { return op == IOPCODE_##UC; }
 #include "IROpcodes.def"
 
 /**
  * Should represent value in
  * https://cs.android.com/android/platform/superproject/main/+/main:art/libdexfile/dex/dex_instruction_list.h
  */
-inline bool can_throw(IROpcode op) { return may_throw(op) || is_throw(op); }
+constexpr bool can_throw(IROpcode op) {
+  return may_throw(op) || is_throw(op);
+}
 
-inline bool writes_result_register(IROpcode op) {
+constexpr bool writes_result_register(IROpcode op) {
   return is_an_invoke(op) || is_filled_new_array(op);
 }
 
-inline bool is_branch(IROpcode op) {
+constexpr bool is_branch(IROpcode op) {
   switch (op) {
   case OPCODE_SWITCH:
   case OPCODE_IF_EQ:
@@ -191,17 +495,6 @@ IROpcode iget_opcode_for_field(const DexField* field);
 
 IROpcode sget_opcode_for_field(const DexField* field);
 
-enum Branchingness : uint8_t {
-  BRANCH_NONE,
-  BRANCH_RETURN,
-  BRANCH_GOTO,
-  BRANCH_IF,
-  BRANCH_SWITCH,
-  BRANCH_THROW // both always throw and may_throw
-};
-
-Branchingness branchingness(IROpcode op);
-
 } // namespace opcode
 
 /*
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRPoolAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace ir_pool {
+
+bool enabled() {
+  static const bool enabled = []() {
+    const char* env = getenv("REDEX_IR_POOL");
+    return env != nullptr && strcmp(env, "0") != 0;
+  }();
+  return enabled;
+}
+
+} // namespace ir_pool
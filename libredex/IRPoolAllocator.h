@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace ir_pool {
+
+/*
+ * Whether IRInstructions and MethodItemEntries are carved out of pooled
+ * chunks instead of being individually heap-allocated. Controlled by the
+ * REDEX_IR_POOL environment variable, and fixed at the first query, as the
+ * memory of an object must be released the same way it was allocated.
+ */
+bool enabled();
+
+/*
+ * A thread-caching free-list allocator for objects of a single size.
+ *
+ * IR objects are created and destroyed in huge numbers, and they routinely
+ * migrate between methods (e.g. during inlining), so they cannot be tied to
+ * the lifetime of a single IRCode. Instead, memory is handed out from large
+ * chunks, and freed objects go onto the free list of the releasing thread,
+ * from where they are reused by the next allocation, e.g. when a cfg is
+ * rebuilt. This keeps IR objects densely packed together and avoids
+ * fragmenting the general-purpose heap. Chunks are never returned.
+ *
+ * When a thread exits, its free list is handed over to a global list, which
+ * other threads adopt once their own list is exhausted.
+ */
+template <size_t kSize, size_t kChunkSize = 64 * 1024>
+class FixedSizePool {
+  static_assert(kSize >= sizeof(void*), "object too small to be pooled");
+
+ public:
+  static void* allocate() {
+    auto& cache = thread_cache();
+    if (cache.head == nullptr) {
+      cache.refill();
+    }
+    auto* node = cache.head;
+    cache.head = node->next;
+    return node;
+  }
+
+  static void deallocate(void* ptr) {
+    auto& cache = thread_cache();
+    auto* node = static_cast<Node*>(ptr);
+    node->next = cache.head;
+    cache.head = node;
+  }
+
+ private:
+  static constexpr size_t kAlign = alignof(std::max_align_t);
+  static constexpr size_t kSlotSize = (kSize + kAlign - 1) / kAlign * kAlign;
+  static constexpr size_t kSlotsPerChunk = kChunkSize / kSlotSize;
+
+  struct Node {
+    Node* next;
+  };
+
+  struct Global {
+    std::mutex lock;
+    std::vector<Node*> orphaned_lists;
+  };
+
+  static Global& global() {
+    // Leaked on purpose, so that it outlives all threads.
+    static auto* global = new Global();
+    return *global;
+  }
+
+  struct ThreadCache {
+    Node* head{nullptr};
+
+    void refill() {
+      {
+        auto& g = global();
+        std::lock_guard<std::mutex> lock(g.lock);
+        if (!g.orphaned_lists.empty()) {
+          head = g.orphaned_lists.back();
+          g.orphaned_lists.pop_back();
+          return;
+        }
+      }
+      auto* chunk =
+          static_cast<uint8_t*>(::operator new(kSlotsPerChunk * kSlotSize));
+      for (size_t i = kSlotsPerChunk; i-- > 0;) {
+        auto* node = reinterpret_cast<Node*>(chunk + i * kSlotSize);
+        node->next = head;
+        head = node;
+      }
+    }
+
+    ~ThreadCache() {
+      if (head == nullptr) {
+        return;
+      }
+      auto& g = global();
+      std::lock_guard<std::mutex> lock(g.lock);
+      g.orphaned_lists.push_back(head);
+    }
+  };
+
+  static ThreadCache& thread_cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+};
+
+/*
+ * Class-specific allocation functions forward to these, so that the object
+ * layout, and thus the pool, is only visible to the translation unit defining
+ * the class.
+ */
+template <typename Pool>
+void* allocate(size_t size, size_t pooled_size) {
+  if (size == pooled_size && enabled()) {
+    return Pool::allocate();
+  }
+  return ::operator new(size);
+}
+
+template <typename Pool>
+void deallocate(void* ptr, size_t size, size_t pooled_size) {
+  if (size == pooled_size && enabled()) {
+    Pool::deallocate(ptr);
+    return;
+  }
+  ::operator delete(ptr);
+}
+
+} // namespace ir_pool
@@ -957,8 +957,8 @@ void IRTypeChecker::run() {
     return;
   }
 
-  m_type_inference = std::make_unique<TypeInference>(*cfg);
-  m_type_inference->run(m_dex_method);
+  m_type_inference = type_inference::get_shared_type_inference(*cfg,
+                                                               m_dex_method);
 
   // Finally, we use the inferred types to type-check each instruction in the
   // method. We stop at the first type error encountered.
@@ -969,7 +969,9 @@ void IRTypeChecker::run() {
       auto it = type_envs.find(insn);
       always_assert_log(
           it != type_envs.end(), "%s in:\n%s", SHOW(mie), SHOW(*cfg));
-      check_instruction(insn, &it->second);
+      // The inference may be shared, so don't hand out its environments.
+      auto env = it->second;
+      check_instruction(insn, &env);
     } catch (const TypeCheckingException& e) {
       m_good = false;
       std::ostringstream out;
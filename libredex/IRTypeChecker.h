@@ -165,7 +165,7 @@ class IRTypeChecker final {
   bool m_relaxed_init_check;
   bool m_good;
   std::string m_what;
-  std::unique_ptr<type_inference::TypeInference> m_type_inference;
+  std::shared_ptr<const type_inference::TypeInference> m_type_inference;
 
   friend std::ostream& operator<<(std::ostream&, const IRTypeChecker&);
 };
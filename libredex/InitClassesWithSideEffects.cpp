@@ -10,41 +10,70 @@
 #include "MethodUtil.h"
 #include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 #include <memory>
 
 namespace init_classes {
 
-const InitClasses* InitClassesWithSideEffects::compute(
+namespace {
+
+// Groups the classes of the scope, and all their superclasses, by their depth
+// in the class hierarchy.
+std::vector<std::vector<const DexClass*>> get_hierarchy_levels(
+    const Scope& scope) {
+  std::vector<std::vector<const DexClass*>> levels;
+  std::unordered_map<const DexClass*, size_t> depths;
+  std::vector<const DexClass*> chain;
+  for (const auto* scope_cls : scope) {
+    chain.clear();
+    size_t depth = 0;
+    for (const DexClass* cls = scope_cls; cls != nullptr;
+         cls = type_class(cls->get_super_class())) {
+      auto it = depths.find(cls);
+      if (it != depths.end()) {
+        depth = it->second + 1;
+        break;
+      }
+      chain.push_back(cls);
+    }
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it, ++depth) {
+      depths.emplace(*it, depth);
+      if (levels.size() <= depth) {
+        levels.resize(depth + 1);
+      }
+      levels[depth].push_back(*it);
+    }
+  }
+  return levels;
+}
+
+} // namespace
+
+void InitClassesWithSideEffects::compute(
     const DexClass* cls,
     const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
     const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals) {
-  const DexType* key = cls->get_type();
-  auto [ptr, emplaced] =
-      m_init_classes.get_or_create_and_assert_equal(key, [&](const auto*) {
-        InitClasses classes;
-        const auto* refined_cls = method::clinit_may_have_side_effects(
-            cls, /* allow_benign_method_invocations */ true,
-            &clinit_has_no_side_effects, non_true_virtuals);
-        if (refined_cls == nullptr) {
-        } else if (refined_cls != cls) {
-          classes = *compute(refined_cls, clinit_has_no_side_effects,
-                             non_true_virtuals);
-        } else {
-          classes.push_back(cls);
-          auto super_cls = type_class(cls->get_super_class());
-          if (super_cls) {
-            const auto super_classes = compute(
-                super_cls, clinit_has_no_side_effects, non_true_virtuals);
-            classes.insert(classes.end(), super_classes->begin(),
-                           super_classes->end());
-          }
-        }
-        return classes;
-      });
-  if (emplaced && ptr->empty()) {
+  auto& entry = (*m_init_classes)[cls->get_type()];
+  always_assert(!entry.computed);
+  const auto* refined_cls = method::clinit_may_have_side_effects(
+      cls, /* allow_benign_method_invocations */ true,
+      &clinit_has_no_side_effects, non_true_virtuals);
+  if (refined_cls == nullptr) {
+  } else if (refined_cls != cls) {
+    entry.init_classes = *get(refined_cls->get_type());
+  } else {
+    entry.init_classes.push_back(cls);
+    auto super_cls = type_class(cls->get_super_class());
+    if (super_cls) {
+      const auto* super_classes = get(super_cls->get_type());
+      entry.init_classes.insert(entry.init_classes.end(),
+                                super_classes->begin(), super_classes->end());
+    }
+  }
+  entry.computed = true;
+  if (entry.init_classes.empty()) {
     m_trivial_init_classes++;
   }
-  return ptr;
 }
 
 InitClassesWithSideEffects::InitClassesWithSideEffects(
@@ -59,24 +88,32 @@ InitClassesWithSideEffects::InitClassesWithSideEffects(
         method_override_graph::get_non_true_virtuals(*method_override_graph,
                                                      scope));
   }
+  auto levels = get_hierarchy_levels(scope);
   size_t prev_trivial_init_classes;
   do {
     auto prev_init_classes = std::move(m_init_classes);
+    m_init_classes = std::make_unique<InitClassesTable>();
     prev_trivial_init_classes = m_trivial_init_classes.exchange(0);
     method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
         [&](const DexType* type) {
-          auto it = prev_init_classes.find(type);
-          if (it != prev_init_classes.end()) {
-            return it->second.empty();
+          const auto* entry = prev_init_classes->get(type);
+          if (entry != nullptr && entry->computed) {
+            return entry->init_classes.empty();
           }
           auto cls = type_class(type);
           return cls && (cls->is_external() ||
                          cls->rstate.clinit_has_no_side_effects());
         };
+    for (const auto& level : levels) {
+      workqueue_run<const DexClass*>(
+          [&](const DexClass* cls) {
+            compute(cls, clinit_has_no_side_effects, non_true_virtuals.get());
+          },
+          level);
+    }
     ConcurrentSet<DexClass*> added_clinit_has_no_side_effects;
     walk::parallel::classes(scope, [&](DexClass* cls) {
-      if (compute(cls, clinit_has_no_side_effects, non_true_virtuals.get())
-              ->empty() &&
+      if (get(cls->get_type())->empty() &&
           !cls->rstate.clinit_has_no_side_effects()) {
         added_clinit_has_no_side_effects.insert(cls);
       }
@@ -93,10 +130,9 @@ InitClassesWithSideEffects::InitClassesWithSideEffects(
 }
 
 const InitClasses* InitClassesWithSideEffects::get(const DexType* type) const {
-  auto it = m_init_classes.find(type);
-  return it == m_init_classes.end() ? &m_empty_init_classes : &it->second;
+  const auto* entry = m_init_classes->get(type);
+  return entry == nullptr ? &m_empty_init_classes : &entry->init_classes;
 }
-
 const DexType* InitClassesWithSideEffects::refine(const DexType* type) const {
   auto init_classes = get(type);
   return init_classes->empty() ? nullptr : init_classes->front()->get_type();
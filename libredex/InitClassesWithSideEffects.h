@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "ConcurrentContainers.h"
+#include "DenseSideTable.h"
 #include "DexClass.h"
 #include "IRInstruction.h"
 #include "MethodOverrideGraph.h"
@@ -23,15 +24,28 @@ using InitClasses = std::vector<const DexClass*>;
 /**
  * For a given scope, this class provides information about which static
  * initializer with side effects get triggered when some class is initialized.
+ *
+ * The results are stored in a table indexed by the dense index of the types.
+ * As the result for a class only depends on those of its superclasses, they
+ * are computed in parallel for all classes at the same depth of the class
+ * hierarchy, one level after another.
  */
 class InitClassesWithSideEffects {
  private:
-  InsertOnlyConcurrentMap<const DexType*, InitClasses> m_init_classes;
+  struct Entry {
+    InitClasses init_classes;
+    bool computed{false};
+  };
+  using InitClassesTable = DenseSideTable<DexType, Entry>;
+
+  std::unique_ptr<InitClassesTable> m_init_classes{
+      std::make_unique<InitClassesTable>()};
   std::atomic<size_t> m_trivial_init_classes{0};
   InitClasses m_empty_init_classes;
   bool m_create_init_class_insns;
 
-  const InitClasses* compute(
+  // Requires the results of all superclasses to be computed already.
+  void compute(
       const DexClass* cls,
       const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
       const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals);
@@ -59,6 +59,12 @@ struct InlinerConfig {
   // analysis redex compiler can tolerate when making decision to inline
   size_t max_cost_for_constant_propagation{MAX_COST_FOR_CONSTANT_PROPAGATION};
 
+  // Bounds the number of distinct call-site summaries for which the cost of
+  // inlining a particular callee is estimated by simulating the callee. Other
+  // call-sites of callees with many distinct call-site summaries just use the
+  // cost of fully inlining the callee. Zero means no limit.
+  size_t max_call_site_summaries_per_callee{0};
+
   // We will populate the information to rstate of classes and methods.
   std::unordered_set<DexType*> no_inline_annos;
   std::unordered_set<DexType*> force_inline_annos;
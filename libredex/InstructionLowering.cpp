@@ -536,14 +536,15 @@ Stats lower(DexMethod* method, bool lower_with_cfg, ConfigFiles* conf) {
 
 Stats run(DexStoresVector& stores, bool lower_with_cfg, ConfigFiles* conf) {
   auto scope = build_class_scope(stores);
-  return walk::parallel::methods<Stats>(scope,
-                                        [lower_with_cfg, conf](DexMethod* m) {
-                                          Stats stats;
-                                          if (m->get_code() == nullptr) {
-                                            return stats;
-                                          }
-                                          return lower(m, lower_with_cfg, conf);
-                                        });
+  // Every method is lowered independently, with its own switch layout
+  // decisions, so methods rather than classes are the units of work.
+  return walk::parallel::methods_by_cost<Stats>(
+      scope, [lower_with_cfg, conf](DexMethod* m) {
+        if (m->get_code() == nullptr) {
+          return Stats();
+        }
+        return lower(m, lower_with_cfg, conf);
+      });
 }
 
 CaseKeysExtent CaseKeysExtent::from_ordered(
@@ -554,6 +555,19 @@ CaseKeysExtent CaseKeysExtent::from_ordered(
                         (uint32_t)case_keys.size()};
 }
 
+CaseKeysExtent CaseKeysExtent::from_unordered(
+    const std::vector<int32_t>& case_keys) {
+  always_assert(!case_keys.empty());
+  // Plain loop rather than std::minmax_element, so that it gets vectorized.
+  int32_t first_key = case_keys.front();
+  int32_t last_key = case_keys.front();
+  for (auto case_key : case_keys) {
+    first_key = std::min(first_key, case_key);
+    last_key = std::max(last_key, case_key);
+  }
+  return CaseKeysExtent{first_key, last_key, (uint32_t)case_keys.size()};
+}
+
 // Computes number of entries needed for a packed switch, accounting for any
 // holes that might exist
 uint64_t CaseKeysExtent::get_packed_switch_size() const {
@@ -100,6 +100,10 @@ struct CaseKeysExtent {
   // Assumes case_keys are not empty and sorted.
   static CaseKeysExtent from_ordered(const std::vector<int32_t>& case_keys);
 
+  // Assumes case_keys are not empty and unique, but not that they are sorted.
+  // Takes a single linear pass, so callers need not sort.
+  static CaseKeysExtent from_unordered(const std::vector<int32_t>& case_keys);
+
   // Computes number of entries needed for a packed switch, accounting for any
   // holes that might exist; assumes case_keys are sorted
   uint64_t get_packed_switch_size() const;
@@ -8,12 +8,13 @@
 #include <boost/iostreams/device/mapped_file.hpp>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
-#include <zlib.h>
 
 #include "Macros.h"
 
@@ -32,6 +33,8 @@
 #include "Trace.h"
 #include "TypeUtil.h"
 #include "Util.h"
+#include "WorkQueue.h"
+#include "ZipArchive.h"
 
 /******************
  * Begin Class Loading code.
@@ -442,15 +445,10 @@ DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   return method;
 }
 
-} // namespace
-
-bool parse_class(uint8_t* buffer,
-                 size_t buffer_size,
-                 Scope* classes,
-                 attribute_hook_t attr_hook,
-                 const jar_loader::duplicate_allowed_hook_t& is_allowed,
-                 const DexLocation* jar_location) {
-  auto buffer_end = buffer + buffer_size;
+// Reads the header of a class file up to and including its constant pool.
+bool parse_constant_pool(uint8_t*& buffer,
+                         uint8_t* buffer_end,
+                         std::vector<cp_entry>* cpool) {
   uint32_t magic = read32(buffer, buffer_end);
   uint16_t vminor DEBUG_ONLY = read16(buffer, buffer_end);
   uint16_t vmajor DEBUG_ONLY = read16(buffer, buffer_end);
@@ -459,20 +457,63 @@ bool parse_class(uint8_t* buffer,
     std::cerr << "Bad class magic " << std::hex << magic << ", Bailing\n";
     return false;
   }
-  std::vector<cp_entry> cpool;
-  cpool.resize(cp_count);
+  cpool->resize(cp_count);
   /* The zero'th entry is always empty.  Java is annoying. */
   for (size_t i = 1; i < cp_count; i++) {
-    if (!parse_cp_entry(buffer, buffer_end, cpool[i])) return false;
-    if (cpool[i].tag == CP_CONST_LONG || cpool[i].tag == CP_CONST_DOUBLE) {
+    if (!parse_cp_entry(buffer, buffer_end, (*cpool)[i])) return false;
+    if ((*cpool)[i].tag == CP_CONST_LONG ||
+        (*cpool)[i].tag == CP_CONST_DOUBLE) {
       if (i + 1 >= cp_count) {
         std::cerr << "Bad long/double constant, bailing.\n";
         return false;
       }
-      cpool[i + 1] = cpool[i];
+      (*cpool)[i + 1] = (*cpool)[i];
       i++;
     }
   }
+  return true;
+}
+
+// Determines the type a class file defines, without creating anything else.
+// Leaves `type` null for module-info classes, which are ignored.
+bool peek_class_type(uint8_t* buffer, size_t buffer_size, DexType** type) {
+  auto buffer_end = buffer + buffer_size;
+  std::vector<cp_entry> cpool;
+  if (!parse_constant_pool(buffer, buffer_end, &cpool)) {
+    return false;
+  }
+  uint16_t aflags = read16(buffer, buffer_end);
+  uint16_t clazz = read16(buffer, buffer_end);
+  if (is_module((DexAccessFlags)aflags)) {
+    *type = nullptr;
+    return true;
+  }
+  *type = make_dextype_from_cref(cpool, clazz);
+  if (*type == nullptr) {
+    std::cerr << "Bad class cpool index " << clazz << ", Bailing\n";
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Parses a class file into a ClassCreator for it, creating the types and
+ * members it defines, but without publishing the class itself. Leaves
+ * `creator` empty if there is nothing to create, e.g. because the class has
+ * already been defined.
+ */
+bool parse_class_unpublished(
+    uint8_t* buffer,
+    size_t buffer_size,
+    const attribute_hook_t& attr_hook,
+    const jar_loader::duplicate_allowed_hook_t& is_allowed,
+    const DexLocation* jar_location,
+    std::unique_ptr<ClassCreator>* creator) {
+  auto buffer_end = buffer + buffer_size;
+  std::vector<cp_entry> cpool;
+  if (!parse_constant_pool(buffer, buffer_end, &cpool)) {
+    return false;
+  }
   uint16_t aflags = read16(buffer, buffer_end);
   uint16_t clazz = read16(buffer, buffer_end);
   uint16_t super = read16(buffer, buffer_end);
@@ -523,17 +564,17 @@ bool parse_class(uint8_t* buffer,
     return true;
   }
 
-  ClassCreator cc(self, jar_location);
-  cc.set_external();
+  auto cc = std::make_unique<ClassCreator>(self, jar_location);
+  cc->set_external();
   if (super != 0) {
     DexType* sclazz = make_dextype_from_cref(cpool, super);
     if (sclazz == nullptr) {
       std::cerr << "Bad super class cpool index " << super << ", Bailing\n";
       return false;
     }
-    cc.set_super(sclazz);
+    cc->set_super(sclazz);
   }
-  cc.set_access((DexAccessFlags)aflags);
+  cc->set_access((DexAccessFlags)aflags);
   if (ifcount) {
     for (int i = 0; i < ifcount; i++) {
       uint16_t iface = read16(buffer, buffer_end);
@@ -542,7 +583,7 @@ bool parse_class(uint8_t* buffer,
         std::cerr << "Bad interface cpool index " << super << ", Bailing\n";
         return false;
       }
-      cc.add_interface(iftype);
+      cc->add_interface(iftype);
     }
   }
   uint16_t fcount = read16(buffer, buffer_end);
@@ -579,7 +620,7 @@ bool parse_class(uint8_t* buffer,
     skip_attributes(buffer, buffer_end);
     DexField* field = make_dexfield(cpool, self, cpfield, added_fields);
     if (field == nullptr) return false;
-    cc.add_field(field);
+    cc->add_field(field);
     invoke_attr_hook({field}, attrPtr);
   }
 
@@ -596,11 +637,31 @@ bool parse_class(uint8_t* buffer,
       skip_attributes(buffer, buffer_end);
       DexMethod* method = make_dexmethod(cpool, self, cpmethod, added_methods);
       if (method == nullptr) return false;
-      cc.add_method(method);
+      cc->add_method(method);
       invoke_attr_hook({method}, attrPtr);
     }
   }
-  DexClass* dc = cc.create();
+  *creator = std::move(cc);
+  return true;
+}
+
+} // namespace
+
+bool parse_class(uint8_t* buffer,
+                 size_t buffer_size,
+                 Scope* classes,
+                 attribute_hook_t attr_hook,
+                 const jar_loader::duplicate_allowed_hook_t& is_allowed,
+                 const DexLocation* jar_location) {
+  std::unique_ptr<ClassCreator> cc;
+  if (!parse_class_unpublished(buffer, buffer_size, attr_hook, is_allowed,
+                               jar_location, &cc)) {
+    return false;
+  }
+  if (!cc) {
+    return true;
+  }
+  DexClass* dc = cc->create();
   if (classes != nullptr) {
     classes->emplace_back(dc);
   }
@@ -663,299 +724,38 @@ bool load_class_file(const std::string& filename, Scope* classes) {
 
 namespace {
 
-/* CDFile
- * Central directory file header entry structures.
- */
-constexpr uint16_t kCompMethodStore = 0;
-constexpr uint16_t kCompMethodDeflate = 8;
-constexpr std::array<uint8_t, 4> kCDFile = {'P', 'K', 0x01, 0x02};
-
-PACKED(struct pk_cd_file {
-  uint32_t signature;
-  uint16_t vmade;
-  uint16_t vextract;
-  uint16_t flags;
-  uint16_t comp_method;
-  uint16_t mod_time;
-  uint16_t mod_date;
-  uint32_t crc32;
-  uint32_t comp_size;
-  uint32_t ucomp_size;
-  uint16_t fname_len;
-  uint16_t extra_len;
-  uint16_t comment_len;
-  uint16_t diskno;
-  uint16_t interal_attr;
-  uint32_t external_attr;
-  uint32_t disk_offset;
-});
-
-/* CDirEnd:
- * End of central directory record structures.
- */
-constexpr int kMaxCDirEndSearch = 100;
-constexpr std::array<uint8_t, 4> kCDirEnd = {'P', 'K', 0x05, 0x06};
-
-PACKED(struct pk_cdir_end {
-  uint32_t signature;
-  uint16_t diskno;
-  uint16_t cd_diskno;
-  uint16_t cd_disk_entries;
-  uint16_t cd_entries;
-  uint32_t cd_size;
-  uint32_t cd_disk_offset;
-  uint16_t comment_len;
-});
-
-/* LFile:
- * Local file header structures.
- * (Yes, this made more sense in the world of floppies and tapes.)
- */
-constexpr std::array<uint8_t, 4> kLFile = {'P', 'K', 0x03, 0x04};
-
-PACKED(struct pk_lfile {
-  uint32_t signature;
-  uint16_t vextract;
-  uint16_t flags;
-  uint16_t comp_method;
-  uint16_t mod_time;
-  uint16_t mod_date;
-  uint32_t crc32;
-  uint32_t comp_size;
-  uint32_t ucomp_size;
-  uint16_t fname_len;
-  uint16_t extra_len;
-});
-
-struct jar_entry {
-  struct pk_cd_file cd_entry;
-  std::string filename;
-};
-
-bool find_central_directory(const uint8_t* mapping,
-                            ssize_t size,
-                            pk_cdir_end& pce) {
-  ssize_t soffset = (size - sizeof(pk_cdir_end));
-  ssize_t eoffset = soffset - kMaxCDirEndSearch;
-  if (soffset < 0) return false;
-  if (eoffset < 0) eoffset = 0;
-  do {
-    const uint8_t* cdsearch = mapping + soffset;
-    if (memcmp(cdsearch, kCDirEnd.data(), kCDirEnd.size()) == 0) {
-      memcpy(&pce, cdsearch, sizeof(pk_cdir_end));
-      return true;
-    }
-  } while (soffset-- > eoffset);
-  std::cerr << "End of central directory record not found, bailing\n";
-  return false;
-}
-
-bool validate_pce(pk_cdir_end& pce, ssize_t size) {
-  /* We only support a limited feature set.  We
-   * don't support disk-spanning, so bail if that's the case.
-   */
-  if (pce.cd_diskno != pce.diskno || pce.cd_diskno != 0 ||
-      pce.cd_entries != pce.cd_disk_entries) {
-    std::cerr << "Disk spanning is not supported, bailing\n";
-    return false;
-  }
-  ssize_t data_size = size - sizeof(pk_cdir_end);
-  if (pce.cd_disk_offset + pce.cd_size > data_size) {
-    std::cerr << "Central directory overflow, invalid pce structure\n";
-    return false;
-  }
-  return true;
-}
-
-bool extract_jar_entry(const uint8_t*& mapping,
-                       size_t& offset,
-                       size_t total_size,
-                       jar_entry& je) {
-  if (offset + kCDFile.size() > total_size) {
-    std::cerr << "Reading mapping out of bound, bailing\n";
-    return false;
-  }
-  if (memcmp(mapping, kCDFile.data(), kCDFile.size()) != 0) {
-    std::cerr << "Invalid central directory entry, bailing\n";
-    return false;
-  }
-  offset += sizeof(pk_cd_file);
-  if (offset >= total_size) {
-    std::cerr << "Reading mapping out of bound\n";
-    return false;
-  }
-  memcpy(&je.cd_entry, mapping, sizeof(pk_cd_file));
-  mapping += sizeof(pk_cd_file);
-  offset += je.cd_entry.fname_len;
-  if (offset >= total_size) {
-    std::cerr << "Reading mapping out of bound\n";
-    return false;
-  }
-  je.filename = std::string((const char*)mapping, je.cd_entry.fname_len);
-  mapping += je.cd_entry.fname_len;
-  offset = offset + je.cd_entry.extra_len + je.cd_entry.comment_len;
-  mapping += je.cd_entry.extra_len;
-  mapping += je.cd_entry.comment_len;
-  return true;
-}
-
-bool get_jar_entries(const uint8_t* mapping,
-                     size_t size,
-                     pk_cdir_end& pce,
-                     std::vector<jar_entry>& files) {
-  const uint8_t* cdir = mapping + pce.cd_disk_offset;
-  files.resize(pce.cd_entries);
-  size_t offset = pce.cd_disk_offset;
-  for (int entry = 0; entry < pce.cd_entries; entry++) {
-    if (!extract_jar_entry(cdir, offset, size, files[entry])) return false;
-  }
-  return true;
-}
-
-int jar_uncompress(Bytef* dest,
-                   uLongf* destLen,
-                   const Bytef* source,
-                   uLong sourceLen,
-                   uint32_t comp_method) {
-  if (comp_method == kCompMethodStore) {
-    if (sourceLen > *destLen) {
-      std::cerr << "Not enough space for STOREd entry: " << sourceLen << " vs "
-                << *destLen << std::endl;
-      return Z_BUF_ERROR;
-    }
-    memcpy(dest, source, sourceLen);
-    *destLen = sourceLen;
-    return Z_OK;
-  }
-
-  z_stream stream;
-  int err;
-
-  stream.next_in = (Bytef*)source;
-  stream.avail_in = (uInt)sourceLen;
-  stream.next_out = dest;
-  stream.avail_out = (uInt)*destLen;
-  stream.zalloc = (alloc_func)0;
-  stream.zfree = (free_func)0;
-
-  err = inflateInit2(&stream, -MAX_WBITS);
-  if (err != Z_OK) return err;
-
-  err = inflate(&stream, Z_FINISH);
-  if (err != Z_STREAM_END) {
-    inflateEnd(&stream);
-    return err;
-  }
-  *destLen = stream.total_out;
-
-  err = inflateEnd(&stream);
-  return err;
-}
-
-bool decompress_class(jar_entry& file,
-                      const uint8_t* mapping,
-                      size_t map_size,
-                      uint8_t* outbuffer,
-                      ssize_t bufsize) {
-  if (file.cd_entry.comp_method != kCompMethodDeflate &&
-      file.cd_entry.comp_method != kCompMethodStore) {
-    std::cerr << "Unknown compression method " << file.cd_entry.comp_method
-              << " for " << file.filename << ", Bailing\n";
-    return false;
-  }
-
-  static_assert(kLFile.size() <= sizeof(pk_lfile));
-  if (file.cd_entry.disk_offset + sizeof(pk_lfile) >= map_size) {
-    std::cerr << "Entry out of map bounds!\n";
-    return false;
-  }
-  const uint8_t* lfile = mapping + file.cd_entry.disk_offset;
-  if (memcmp(lfile, kLFile.data(), kLFile.size()) != 0) {
-    std::cerr << "Invalid local file entry, bailing\n";
-    return false;
-  }
-
-  pk_lfile pkf;
-  memcpy(&pkf, lfile, sizeof(pk_lfile));
-  if (pkf.comp_size == 0 && pkf.ucomp_size == 0 &&
-      pkf.comp_size != file.cd_entry.comp_size &&
-      pkf.ucomp_size != file.cd_entry.ucomp_size) {
-    pkf.comp_size = file.cd_entry.comp_size;
-    pkf.ucomp_size = file.cd_entry.ucomp_size;
-  }
-
-  lfile += sizeof(pk_lfile);
-
-  if (file.cd_entry.disk_offset + sizeof(pk_lfile) + pkf.fname_len +
-          pkf.extra_len + pkf.comp_size >=
-      map_size) {
-    std::cerr << "Complete entry exceeds mapping bounds.\n";
-    return false;
-  }
-
-  if (pkf.fname_len != file.cd_entry.fname_len ||
-      pkf.comp_size != file.cd_entry.comp_size ||
-      pkf.ucomp_size != file.cd_entry.ucomp_size ||
-      pkf.comp_method != file.cd_entry.comp_method ||
-      file.filename != std::string_view((const char*)lfile, pkf.fname_len)) {
-    std::cerr << "Directory entry doesn't match local file header, Bailing "
-              << pkf.fname_len << " " << pkf.comp_size << " " << pkf.ucomp_size
-              << " " << pkf.comp_method << " " << file.cd_entry.fname_len << " "
-              << file.cd_entry.comp_size << " " << file.cd_entry.ucomp_size
-              << " " << file.cd_entry.comp_method << " extra " << pkf.extra_len
-              << "\n";
-    return false;
-  }
-
-  lfile += pkf.fname_len;
-  lfile += pkf.extra_len;
+constexpr size_t kStartBufferSize = 128 * 1024;
 
-  uLongf dlen = bufsize;
-  int zlibrv = jar_uncompress(outbuffer, &dlen, lfile, pkf.comp_size,
-                              file.cd_entry.comp_method);
-  if (zlibrv != Z_OK) {
-    std::cerr << "uncompress failed with code " << zlibrv << ", Bailing\n";
-    return false;
-  }
-  if (dlen != pkf.ucomp_size) {
-    std::cerr << "mis-match on uncompressed size, Bailing\n";
-    return false;
-  }
-  return true;
+bool is_class_file(const ZipArchive::Entry& file) {
+  constexpr std::string_view kClassEndString = ".class";
+  if (file.ucomp_size == 0) return false;
+  std::string_view filename = file.name;
+  if (filename.length() < kClassEndString.length()) return false;
+  auto endcomp = filename.substr(filename.length() - kClassEndString.length());
+  return endcomp == kClassEndString;
 }
 
-constexpr size_t kStartBufferSize = 128 * 1024;
-
 bool process_jar_entries(
     const DexLocation* location,
-    std::vector<jar_entry>& files,
-    const uint8_t* mapping,
-    const size_t map_size,
+    const ZipArchive& archive,
     Scope* classes,
     const attribute_hook_t& attr_hook,
     const jar_loader::duplicate_allowed_hook_t& is_allowed) {
   ssize_t bufsize = kStartBufferSize;
   std::unique_ptr<uint8_t[]> outbuffer = std::make_unique<uint8_t[]>(bufsize);
-  constexpr std::string_view kClassEndString = ".class";
   init_basic_types();
-  for (auto& file : files) {
-    if (file.cd_entry.ucomp_size == 0) continue;
-
+  for (const auto& file : archive.entries()) {
     // Skip non-class files
-    std::string_view filename = file.filename;
-    if (filename.length() < kClassEndString.length()) continue;
-    auto endcomp =
-        filename.substr(filename.length() - kClassEndString.length());
-    if (endcomp != kClassEndString) continue;
+    if (!is_class_file(file)) continue;
 
     // Resize output if necessary.
-    if (bufsize < file.cd_entry.ucomp_size) {
-      while (bufsize < file.cd_entry.ucomp_size)
+    if (bufsize < file.ucomp_size) {
+      while (bufsize < file.ucomp_size)
         bufsize *= 2;
       outbuffer = std::make_unique<uint8_t[]>(bufsize);
     }
 
-    if (!decompress_class(file, mapping, map_size, outbuffer.get(), bufsize)) {
+    if (!archive.extract(file, outbuffer.get(), bufsize)) {
       return false;
     }
 
@@ -983,19 +783,11 @@ bool process_jar(const DexLocation* location,
                  Scope* classes,
                  const attribute_hook_t& attr_hook,
                  const jar_loader::duplicate_allowed_hook_t& is_allowed) {
-  pk_cdir_end pce;
-  std::vector<jar_entry> files;
-  if (!find_central_directory(mapping, size, pce)) {
-    return false;
-  }
-  if (!validate_pce(pce, size)) {
-    return false;
-  }
-  if (!get_jar_entries(mapping, size, pce, files)) {
+  ZipArchive archive(mapping, size);
+  if (!archive.is_valid()) {
     return false;
   }
-  if (!process_jar_entries(location, files, mapping, size, classes, attr_hook,
-                           is_allowed)) {
+  if (!process_jar_entries(location, archive, classes, attr_hook, is_allowed)) {
     return false;
   }
   return true;
@@ -1025,6 +817,138 @@ bool load_jar_file(const DexLocation* location,
   return true;
 }
 
+namespace {
+
+struct JarClassFile {
+  const DexLocation* location;
+  Scope* classes;
+  const ZipArchive* archive;
+  const ZipArchive::Entry* entry;
+  std::unique_ptr<uint8_t[]> data;
+  DexType* type{nullptr};
+  // Whether this is the first definition of a class that did not exist
+  // before, or a class that already existed, and thus has to be parsed.
+  bool is_parsed{false};
+  std::unique_ptr<ClassCreator> creator;
+};
+
+} // namespace
+
+bool load_jar_files(
+    const std::vector<std::pair<const DexLocation*, Scope*>>& jars,
+    const jar_loader::duplicate_allowed_hook_t& is_allowed) {
+  std::vector<boost::iostreams::mapped_file> files(jars.size());
+  std::vector<std::unique_ptr<ZipArchive>> archives;
+  std::vector<JarClassFile> class_files;
+  for (size_t i = 0; i < jars.size(); i++) {
+    auto [location, classes] = jars[i];
+    try {
+      files[i].open(location->get_file_name().c_str(),
+                    boost::iostreams::mapped_file::readonly);
+    } catch (const std::exception&) {
+      std::cerr << "error: cannot open jar file: " << location->get_file_name()
+                << "\n";
+      return false;
+    }
+    archives.push_back(std::make_unique<ZipArchive>(
+        reinterpret_cast<const uint8_t*>(files[i].const_data()),
+        files[i].size()));
+    if (!archives.back()->is_valid()) {
+      std::cerr << "error: cannot process jar: " << location->get_file_name()
+                << "\n";
+      return false;
+    }
+    for (const auto& entry : archives.back()->entries()) {
+      if (is_class_file(entry)) {
+        class_files.push_back(JarClassFile{location, classes,
+                                           archives.back().get(), &entry});
+      }
+    }
+  }
+  init_basic_types();
+
+  // Decompress all class files, and find the types they define. Interning
+  // types does not depend on the order.
+  std::atomic<bool> failed{false};
+  workqueue_run_for<size_t>(0, class_files.size(), [&](size_t i) {
+    auto& class_file = class_files[i];
+    auto size = class_file.entry->ucomp_size;
+    class_file.data = std::make_unique<uint8_t[]>(size);
+    if (!class_file.archive->extract(*class_file.entry, class_file.data.get(),
+                                     size) ||
+        !peek_class_type(class_file.data.get(), size, &class_file.type)) {
+      std::cerr << "error: cannot process jar: "
+                << class_file.location->get_file_name() << "\n";
+      failed = true;
+    }
+  });
+  if (failed) {
+    return false;
+  }
+
+  // As when loading the jars one after the other, the first definition of a
+  // class wins.
+  std::unordered_map<const DexType*, const JarClassFile*> first_definitions;
+  for (auto& class_file : class_files) {
+    if (class_file.type == nullptr) {
+      TRACE(MAIN, 5, "Warning: ignoring module-info class in jar '%s'",
+            class_file.location->get_file_name().c_str());
+      continue;
+    }
+    if (type_class(class_file.type) != nullptr) {
+      // Only checked against the existing class while parsing.
+      class_file.is_parsed = true;
+      continue;
+    }
+    auto [it, emplaced] =
+        first_definitions.emplace(class_file.type, &class_file);
+    if (emplaced) {
+      class_file.is_parsed = true;
+    } else {
+      TRACE(MAIN, 1,
+            "Warning: Found a duplicate class '%s' in two .jar files:\n "
+            "  Current: '%s'\n"
+            "  Previous: '%s'",
+            SHOW(class_file.type), class_file.location->get_file_name().c_str(),
+            it->second->location->get_file_name().c_str());
+    }
+  }
+
+  // The classes to create are all distinct, so their members can be created
+  // in parallel.
+  workqueue_run_for<size_t>(0, class_files.size(), [&](size_t i) {
+    auto& class_file = class_files[i];
+    if (!class_file.is_parsed) {
+      return;
+    }
+    if (!parse_class_unpublished(class_file.data.get(),
+                                 class_file.entry->ucomp_size,
+                                 /* attr_hook */ nullptr, is_allowed,
+                                 class_file.location, &class_file.creator)) {
+      std::cerr << "error: cannot process jar: "
+                << class_file.location->get_file_name() << "\n";
+      failed = true;
+    }
+    class_file.data.reset();
+  });
+  if (failed) {
+    return false;
+  }
+
+  // Publish the classes in order, so that e.g. the external classes of the
+  // RedexContext do not depend on scheduling.
+  for (auto& class_file : class_files) {
+    if (class_file.creator == nullptr) {
+      continue;
+    }
+    DexClass* cls = class_file.creator->create();
+    if (class_file.classes != nullptr) {
+      class_file.classes->emplace_back(cls);
+    }
+  }
+  return true;
+}
+
 // #define LOCAL_MAIN
 #ifdef LOCAL_MAIN
 int main(int argc, char* argv[]) {
@@ -18,6 +18,8 @@ class DexMethod;
 
 #include <functional>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace JarLoaderUtil {
 uint32_t read32(uint8_t*& buffer, uint8_t* buffer_end);
@@ -46,6 +48,17 @@ bool load_jar_file(const DexLocation* location,
                    const jar_loader::duplicate_allowed_hook_t& is_allowed =
                        jar_loader::default_duplicate_allow_fn);
 
+/*
+ * Loads the given jars like consecutive calls to load_jar_file would, adding
+ * the classes of each jar to its scope unless that is null. The class files
+ * of all jars are decompressed and parsed in parallel, but classes are
+ * published in jar and entry order. `is_allowed` may be called concurrently.
+ */
+bool load_jar_files(
+    const std::vector<std::pair<const DexLocation*, Scope*>>& jars,
+    const jar_loader::duplicate_allowed_hook_t& is_allowed =
+        jar_loader::default_duplicate_allow_fn);
+
 bool load_class_file(const std::string& filename, Scope* classes = nullptr);
 
 void init_basic_types();
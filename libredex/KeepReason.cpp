@@ -7,6 +7,7 @@
 
 #include "KeepReason.h"
 
+#include <mutex>
 #include <ostream>
 
 #include "ConcurrentContainers.h"
@@ -53,12 +54,17 @@ size_t hash_value(const Reason& reason) {
 
 namespace {
 
+struct InternedReasons {
+  InsertOnlyConcurrentSet<Reason*, ReasonPtrHash, ReasonPtrEqual> by_value;
+  InsertOnlyConcurrentMap<ReasonId, std::unique_ptr<Reason>> by_id;
+  // Guards the assignment of new ids. Only taken for reasons not seen before.
+  std::mutex mutex;
+  ReasonId next_id{0};
+};
+
 // Lint will complain about this, but it is better than having to
 // forward-declare all of concurrent containers.
-std::unique_ptr<InsertOnlyConcurrentSet<keep_reason::Reason*,
-                                        keep_reason::ReasonPtrHash,
-                                        keep_reason::ReasonPtrEqual>>
-    s_keep_reasons{nullptr};
+std::unique_ptr<InternedReasons> s_keep_reasons{nullptr};
 
 } // namespace
 
@@ -67,18 +73,30 @@ bool Reason::s_record_keep_reasons = false;
 void Reason::set_record_keep_reasons(bool v) {
   s_record_keep_reasons = v;
   if (v && s_keep_reasons == nullptr) {
-    s_keep_reasons = std::make_unique<InsertOnlyConcurrentSet<
-        keep_reason::Reason*, keep_reason::ReasonPtrHash,
-        keep_reason::ReasonPtrEqual>>();
+    s_keep_reasons = std::make_unique<InternedReasons>();
   }
 }
 
 Reason* Reason::try_insert(std::unique_ptr<Reason> to_insert) {
-  auto [reason_ptr, emplaced] = s_keep_reasons->insert(to_insert.get());
-  if (emplaced) {
-    return to_insert.release();
+  auto& interned = *s_keep_reasons;
+  if (auto* existing = interned.by_value.get(to_insert.get())) {
+    return *existing;
+  }
+  std::lock_guard<std::mutex> lock(interned.mutex);
+  if (auto* existing = interned.by_value.get(to_insert.get())) {
+    return *existing;
   }
-  return const_cast<Reason*>(*reason_ptr);
+  auto* reason = to_insert.get();
+  reason->id = interned.next_id++;
+  always_assert(interned.next_id != 0);
+  interned.by_id.insert(std::make_pair(reason->id, std::move(to_insert)));
+  // Only published once its id is assigned.
+  interned.by_value.insert(reason);
+  return reason;
+}
+
+const Reason* Reason::get(ReasonId id) {
+  return s_keep_reasons->by_id.at(id).get();
 }
 
 void Reason::release_keep_reasons() { s_keep_reasons.reset(); }
@@ -8,7 +8,9 @@
 #pragma once
 
 #include <boost/functional/hash.hpp>
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <unordered_set>
 
 #include "Debug.h"
@@ -38,12 +40,21 @@ enum KeepReasonType {
   UNKNOWN,
 };
 
+/*
+ * Dense index of an interned Reason. Most reasons are shared by many members
+ * (think of a single rule keeping a whole package), so members refer to them
+ * by id rather than by pointer.
+ */
+using ReasonId = uint32_t;
+
 struct Reason {
   KeepReasonType type;
   union {
     const keep_rules::KeepSpec* keep_rule{nullptr};
     const DexMethod* method;
   };
+  // Assigned when the reason is interned. Not part of its identity.
+  ReasonId id{0};
 
   explicit Reason(KeepReasonType type) : type(type) {
     always_assert(type != KEEP_RULE && type != REFLECTION);
@@ -75,6 +86,9 @@ struct Reason {
 
   static Reason* try_insert(std::unique_ptr<Reason> to_insert);
 
+  // Returns the interned reason with the given id.
+  static const Reason* get(ReasonId id);
+
   static bool s_record_keep_reasons;
 
   friend bool operator==(const Reason&, const Reason&);
@@ -9,7 +9,9 @@
 
 #include <algorithm>
 #include <functional>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "ControlFlow.h"
@@ -41,30 +43,43 @@ bool is_default_constructor(const DexMethod* meth);
 
 } // namespace detail
 
-// N.B. recursive template for matching opcode pattern against insn sequence
+namespace detail {
+
+// Matches the instructions starting at `at` against the elements Is... of the
+// pattern `t`. The fold expands into a flat chain of inlined `matches` calls,
+// so a pattern costs no more than the equivalent hand-written conditions.
+template <typename T, size_t... Is>
+bool insns_match_at(size_t at,
+                    const std::vector<IRInstruction*>& insns,
+                    const T& t,
+                    std::index_sequence<Is...> /* unused */) {
+  return (std::get<Is>(t).matches(insns[at + Is]) && ...);
+}
+
+template <size_t Offset, size_t... Is>
+std::index_sequence<(Offset + Is)...> offset_sequence(
+    std::index_sequence<Is...> /* unused */) {
+  return {};
+}
+
+} // namespace detail
+
+// Matches the elements N and up of the opcode pattern `t` against `insns`,
+// starting at `at`. Returns false if `insns` is too short.
 template <typename T, typename N>
 struct insns_matcher {
   static bool matches_at(int at,
                          const std::vector<IRInstruction*>& insns,
                          const T& t) {
-    const auto& insn = insns.at(at);
-    typename std::tuple_element<N::value, T>::type insn_match =
-        std::get<N::value>(t);
-    return insn_match.matches(insn) &&
-           insns_matcher<T, std::integral_constant<size_t, N::value + 1>>::
-               matches_at(at + 1, insns, t);
-  }
-};
-
-// N.B. base case of recursive template where N = opcode pattern length
-template <typename T>
-struct insns_matcher<
-    T,
-    std::integral_constant<size_t, std::tuple_size<T>::value>> {
-  static bool matches_at(int at,
-                         const std::vector<IRInstruction*>& insns,
-                         const T& t) {
-    return true;
+    constexpr size_t remaining = std::tuple_size<T>::value - N::value;
+    if (at < 0 || insns.size() < remaining ||
+        static_cast<size_t>(at) > insns.size() - remaining) {
+      return false;
+    }
+    return detail::insns_match_at(
+        at - N::value, insns, t,
+        detail::offset_sequence<N::value>(
+            std::make_index_sequence<remaining>()));
   }
 };
 
@@ -77,14 +92,8 @@ void find_matches(const std::vector<IRInstruction*>& insns,
   if (insns.size() >= N) {
     // Try to match starting at i
     for (size_t i = 0; i <= insns.size() - N; ++i) {
-      if (m::insns_matcher<P, std::integral_constant<size_t, 0>>::matches_at(
-              i, insns, p)) {
-        matches.emplace_back();
-        auto& matching_insns = matches.back();
-        matching_insns.reserve(N);
-        for (size_t c = 0; c < N; ++c) {
-          matching_insns.push_back(insns.at(i + c));
-        }
+      if (detail::insns_match_at(i, insns, p, std::make_index_sequence<N>())) {
+        matches.emplace_back(insns.begin() + i, insns.begin() + i + N);
       }
     }
   }
@@ -9,6 +9,7 @@
 #include "Show.h"
 #include "Trace.h"
 
+#include <algorithm>
 #include <ostream>
 #include <unordered_set>
 
@@ -37,6 +38,24 @@ result_t flow_t::find(cfg::ControlFlowGraph& cfg,
   return result_t{dfg.locations(lixs), std::move(order)};
 }
 
+result_t flow_t::find(cfg::ControlFlowGraph& cfg,
+                      std::initializer_list<location_t> ls,
+                      std::initializer_list<IROpcode> anchors) const {
+  auto ii = cfg::ConstInstructionIterable(cfg);
+  bool has_anchor = std::any_of(ii.begin(), ii.end(), [&](const auto& mie) {
+    auto op = mie.insn->opcode();
+    return std::find(anchors.begin(), anchors.end(), op) != anchors.end();
+  });
+  if (!has_anchor) {
+    TRACE(MFLOW, 6, "find: No anchor instructions, skipping.");
+    for (auto l : ls) {
+      always_assert(this == l.m_owner && "location_t from another flow_t");
+    }
+    return result_t{detail::Locations{}, std::make_shared<detail::Order>()};
+  }
+  return find(cfg, ls);
+}
+
 result_t::insn_range result_t::matching(location_t l) const {
   if (l.m_ix >= m_results.size()) {
     return insn_range::empty();
@@ -247,6 +247,18 @@ struct flow_t {
   result_t find(cfg::ControlFlowGraph& cfg,
                 std::initializer_list<location_t> ls) const;
 
+  /**
+   * As above, but first scans `cfg` for an instruction whose opcode is one of
+   * `anchors`, and returns an empty result without building the instruction
+   * graph (or calculating an exit block) if there is none.  Every match of the
+   * constraints at ls must involve an instruction with one of these opcodes,
+   * which makes this a cheap way to skip the bulk of the methods a flow is
+   * searched in.
+   */
+  result_t find(cfg::ControlFlowGraph& cfg,
+                std::initializer_list<location_t> ls,
+                std::initializer_list<IROpcode> anchors) const;
+
  private:
   friend struct location_t;
 
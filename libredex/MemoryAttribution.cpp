@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MemoryAttribution.h"
+
+#include <chrono>
+
+#include "ControlFlow.h"
+#include "DebugUtils.h"
+#include "DexClass.h"
+#include "DexPosition.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "PassManager.h"
+#include "RedexContext.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace memory_attribution {
+
+ScopedRssPeakSampler::ScopedRssPeakSampler(uint64_t interval_ms) {
+  if (interval_ms == 0) {
+    return;
+  }
+  sample();
+  m_thread = std::thread([this, interval_ms]() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cv.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                          [this]() { return m_done; })) {
+      sample();
+    }
+  });
+}
+
+ScopedRssPeakSampler::~ScopedRssPeakSampler() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+  sample();
+}
+
+void ScopedRssPeakSampler::sample() {
+  auto rss = get_mem_stats().vm_rss;
+  auto peak = m_peak.load();
+  while (rss > peak && !m_peak.compare_exchange_weak(peak, rss)) {
+  }
+}
+
+namespace {
+
+struct IRSizes {
+  size_t methods{0};
+  size_t methods_with_code{0};
+  size_t methods_with_pending_code{0};
+  size_t cfgs{0};
+  size_t blocks{0};
+  size_t edges{0};
+  size_t entries{0};
+  size_t instructions{0};
+  size_t positions{0};
+  size_t source_blocks{0};
+  size_t source_block_vals{0};
+
+  IRSizes& operator+=(const IRSizes& other) {
+    methods += other.methods;
+    methods_with_code += other.methods_with_code;
+    methods_with_pending_code += other.methods_with_pending_code;
+    cfgs += other.cfgs;
+    blocks += other.blocks;
+    edges += other.edges;
+    entries += other.entries;
+    instructions += other.instructions;
+    positions += other.positions;
+    source_blocks += other.source_blocks;
+    source_block_vals += other.source_block_vals;
+    return *this;
+  }
+
+  void add(const MethodItemEntry& mie) {
+    ++entries;
+    switch (mie.type) {
+    case MFLOW_OPCODE:
+      ++instructions;
+      break;
+    case MFLOW_POSITION:
+      ++positions;
+      break;
+    case MFLOW_SOURCE_BLOCK:
+      for (auto* sb = mie.src_block.get(); sb != nullptr; sb = sb->next.get()) {
+        ++source_blocks;
+        source_block_vals += sb->vals_size;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  size_t estimated_bytes() const {
+    return entries * sizeof(MethodItemEntry) +
+           methods_with_code * sizeof(IRCode) +
+           instructions * sizeof(IRInstruction) +
+           positions * sizeof(DexPosition) +
+           source_blocks * sizeof(SourceBlock) +
+           cfgs * sizeof(cfg::ControlFlowGraph) +
+           blocks * sizeof(cfg::Block) + edges * sizeof(cfg::Edge);
+  }
+};
+
+IRSizes get_ir_sizes(const DexMethod* method) {
+  IRSizes sizes;
+  sizes.methods = 1;
+  if (method->is_code_pending()) {
+    sizes.methods_with_pending_code = 1;
+    return sizes;
+  }
+  const auto* code = method->get_code();
+  if (code == nullptr) {
+    return sizes;
+  }
+  sizes.methods_with_code = 1;
+  if (code->editable_cfg_built()) {
+    const auto& cfg = code->cfg();
+    sizes.cfgs = 1;
+    for (const auto* block : cfg.blocks()) {
+      ++sizes.blocks;
+      sizes.edges += block->succs().size();
+      for (const auto& mie : *block) {
+        sizes.add(mie);
+      }
+    }
+  } else {
+    for (const auto& mie : *code) {
+      sizes.add(mie);
+    }
+  }
+  return sizes;
+}
+
+} // namespace
+
+void report_structure_sizes(const DexStoresVector& stores, PassManager& mgr) {
+  auto interning = g_redex->get_interning_stats();
+  mgr.set_metric("~mem.context.strings", interning.strings);
+  mgr.set_metric("~mem.context.string_bytes",
+                 interning.string_bytes_allocated);
+  mgr.set_metric("~mem.context.types", interning.types);
+  mgr.set_metric("~mem.context.type_lists", interning.type_lists);
+  mgr.set_metric("~mem.context.protos", interning.protos);
+  mgr.set_metric("~mem.context.field_refs", interning.fields);
+  mgr.set_metric("~mem.context.method_refs", interning.methods);
+  mgr.set_metric("~mem.context.classes", interning.classes);
+
+  auto scope = build_class_scope(stores);
+  auto ir = walk::parallel::methods<IRSizes>(
+      scope, [](const DexMethod* method) { return get_ir_sizes(method); });
+  mgr.set_metric("~mem.scope.classes", scope.size());
+  mgr.set_metric("~mem.scope.methods", ir.methods);
+  mgr.set_metric("~mem.ir.methods_with_code", ir.methods_with_code);
+  mgr.set_metric("~mem.ir.methods_with_pending_code",
+                 ir.methods_with_pending_code);
+  mgr.set_metric("~mem.ir.cfgs", ir.cfgs);
+  mgr.set_metric("~mem.ir.blocks", ir.blocks);
+  mgr.set_metric("~mem.ir.edges", ir.edges);
+  mgr.set_metric("~mem.ir.entries", ir.entries);
+  mgr.set_metric("~mem.ir.instructions", ir.instructions);
+  mgr.set_metric("~mem.ir.positions", ir.positions);
+  mgr.set_metric("~mem.ir.source_blocks", ir.source_blocks);
+  mgr.set_metric("~mem.ir.source_block_vals", ir.source_block_vals);
+  // Source block values are interned, so they are only stored once.
+  auto vals_pool = SourceBlock::InternedVals::get_pool_stats();
+  mgr.set_metric("~mem.ir.interned_source_block_vals", vals_pool.vals);
+  auto ir_bytes = ir.estimated_bytes() + vals_pool.bytes;
+  mgr.set_metric("~mem.ir.estimated_bytes", ir_bytes);
+
+  TRACE(STATS, 1,
+        "Structures: %zu strings (%s), %zu types, %zu method refs, %zu "
+        "classes; IR of %zu methods with %zu instructions and %zu source "
+        "blocks (~%s)",
+        interning.strings,
+        pretty_bytes(interning.string_bytes_allocated).c_str(),
+        interning.types, interning.methods, scope.size(), ir.methods_with_code,
+        ir.instructions, ir.source_blocks, pretty_bytes(ir_bytes).c_str());
+}
+
+} // namespace memory_attribution
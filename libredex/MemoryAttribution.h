@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "DexStore.h"
+
+class PassManager;
+
+/*
+ * Helpers to attribute the memory of the process to the passes and to the
+ * major long-lived data structures.
+ */
+namespace memory_attribution {
+
+/*
+ * Polls the resident set size in the background while alive, to find the peak
+ * within a scope. Unlike VmHWM, this does not depend on the high-watermark
+ * being resettable, which is not permitted in every environment.
+ */
+class ScopedRssPeakSampler final {
+ public:
+  // An interval of zero disables sampling.
+  explicit ScopedRssPeakSampler(uint64_t interval_ms);
+  ~ScopedRssPeakSampler();
+
+  ScopedRssPeakSampler(const ScopedRssPeakSampler&) = delete;
+  ScopedRssPeakSampler& operator=(const ScopedRssPeakSampler&) = delete;
+
+  // The largest resident set size seen so far, in bytes.
+  uint64_t get_peak() const { return m_peak.load(); }
+
+ private:
+  void sample();
+
+  std::atomic<uint64_t> m_peak{0};
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_done{false};
+  std::thread m_thread;
+};
+
+/*
+ * Sets `~mem.*` metrics of the current pass with the sizes of the interning
+ * tables of the RedexContext, of the classes and methods in the stores, and of
+ * all IRCode, CFGs and source blocks. Byte figures are estimates from the
+ * sizes of the involved types, excluding allocator overhead. Code that was
+ * loaded lazily and not accessed yet is only counted, not materialized.
+ */
+void report_structure_sizes(const DexStoresVector& stores, PassManager& mgr);
+
+} // namespace memory_attribution
@@ -9,14 +9,18 @@
 
 #include <boost/range/adaptor/map.hpp>
 
+#include <boost/functional/hash.hpp>
 #include <iterator>
+#include <mutex>
 #include <sparta/PatriciaTreeMap.h>
 #include <sparta/PatriciaTreeSet.h>
 
 #include "BinarySerialization.h"
 #include "CppUtil.h"
+#include "RedexContext.h"
 #include "Show.h"
 #include "Timer.h"
+#include "Trace.h"
 #include "Walkers.h"
 
 using namespace method_override_graph;
@@ -86,7 +90,19 @@ class GraphBuilder {
 
   std::unique_ptr<Graph> run() {
     m_graph = std::make_unique<Graph>();
-    walk::parallel::classes(m_scope, [&](const DexClass* cls) {
+    // Every class recursively analyzes its superclass and interfaces first.
+    // Handing out the classes top-down means that those are mostly done
+    // already, instead of being analyzed redundantly by racing threads.
+    std::unordered_map<const DexClass*, size_t> depths;
+    for (auto* cls : m_scope) {
+      get_depth(cls, &depths);
+    }
+    Scope ordered_scope = m_scope;
+    std::stable_sort(ordered_scope.begin(), ordered_scope.end(),
+                     [&](const DexClass* a, const DexClass* b) {
+                       return depths.at(a) < depths.at(b);
+                     });
+    walk::parallel::classes(ordered_scope, [&](const DexClass* cls) {
       if (is_interface(cls)) {
         analyze_interface(cls);
       } else {
@@ -97,6 +113,30 @@ class GraphBuilder {
   }
 
  private:
+  // The length of the longest chain of superclasses and interfaces.
+  static size_t get_depth(const DexClass* cls,
+                          std::unordered_map<const DexClass*, size_t>* depths) {
+    auto it = depths->find(cls);
+    if (it != depths->end()) {
+      return it->second;
+    }
+    size_t depth = 0;
+    auto visit = [&](const DexType* type) {
+      auto* parent = type_class(type);
+      if (parent != nullptr) {
+        depth = std::max(depth, get_depth(parent, depths) + 1);
+      }
+    };
+    if (cls->get_super_class() != nullptr) {
+      visit(cls->get_super_class());
+    }
+    for (auto* intf : *cls->get_interfaces()) {
+      visit(intf);
+    }
+    depths->emplace(cls, depth);
+    return depth;
+  }
+
   const ClassSignatureMap& analyze_non_interface(const DexClass* cls) {
     always_assert(!is_interface(cls));
     auto* res = m_class_signature_maps.get(cls);
@@ -502,6 +542,61 @@ std::unique_ptr<const Graph> build_graph(const Scope& scope) {
   return GraphBuilder(scope).run();
 }
 
+namespace {
+
+// Everything the graph depends on: the classes with their superclasses,
+// interfaces and kinds, and the signatures of their virtual methods. The
+// per-class hashes are summed up, as the order of the scope does not matter.
+size_t fingerprint(const Scope& scope) {
+  return walk::parallel::classes<size_t>(scope, [](const DexClass* cls) {
+    size_t hash = 0;
+    boost::hash_combine(hash, cls);
+    boost::hash_combine(hash, cls->get_super_class());
+    boost::hash_combine(hash, cls->get_interfaces());
+    boost::hash_combine(hash, is_interface(cls));
+    for (auto* method : cls->get_vmethods()) {
+      boost::hash_combine(hash, method);
+      boost::hash_combine(hash, method->get_name());
+      boost::hash_combine(hash, method->get_proto());
+    }
+    return hash;
+  });
+}
+
+struct CachedGraph {
+  std::mutex mutex;
+  size_t scope_size{0};
+  size_t fingerprint{0};
+  std::shared_ptr<const Graph> graph;
+};
+
+CachedGraph s_cached_graph;
+
+} // namespace
+
+std::shared_ptr<const Graph> build_graph_cached(const Scope& scope) {
+  auto scope_fingerprint = fingerprint(scope);
+  std::lock_guard<std::mutex> lock(s_cached_graph.mutex);
+  if (s_cached_graph.graph != nullptr &&
+      s_cached_graph.scope_size == scope.size() &&
+      s_cached_graph.fingerprint == scope_fingerprint) {
+    TRACE(VIRT, 1, "Reusing method override graph");
+    return s_cached_graph.graph;
+  }
+  if (s_cached_graph.graph == nullptr) {
+    // In tests, we create and destroy g_redex repeatedly, and the graph must
+    // not outlive the methods it refers to.
+    g_redex->add_destruction_task([]() {
+      std::lock_guard<std::mutex> lock(s_cached_graph.mutex);
+      s_cached_graph.graph = nullptr;
+    });
+  }
+  s_cached_graph.graph = build_graph(scope);
+  s_cached_graph.scope_size = scope.size();
+  s_cached_graph.fingerprint = scope_fingerprint;
+  return s_cached_graph.graph;
+}
+
 std::vector<const DexMethod*> get_overriding_methods(const Graph& graph,
                                                      const DexMethod* method,
                                                      bool include_interfaces,
@@ -31,6 +31,15 @@ class Graph;
  */
 std::unique_ptr<const Graph> build_graph(const Scope&);
 
+/*
+ * Like build_graph, but returns the graph built by a previous call for the
+ * same scope, as long as the class hierarchy and the signatures of all virtual
+ * methods have not changed in the meantime. Changes are detected by a
+ * fingerprint that is much cheaper to compute than the graph itself, so that
+ * consecutive passes which do not touch virtual methods share one graph.
+ */
+std::shared_ptr<const Graph> build_graph_cached(const Scope&);
+
 /*
  * Returns all the methods that override :method. The set does *not* include
  * :method itself.
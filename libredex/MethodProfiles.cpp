@@ -8,13 +8,16 @@
 #include "MethodProfiles.h"
 
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "CppUtil.h"
 #include "GlobalConfig.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "StlUtil.h"
 #include "WorkQueue.h"
@@ -44,6 +47,49 @@ bool parse_cells(std::string_view line, const Func& parse_cell) {
 
 bool empty_column(std::string_view sv) { return sv.empty() || sv == "\n"; }
 
+/*
+ * The binary format: a header, followed by the interaction table, the record
+ * table, and finally the string table. All tables are 8-byte aligned, and
+ * strings are referred to by their offset and size in the string table.
+ */
+constexpr char BINARY_MAGIC[8] = {'R', 'D', 'X', 'M', 'P', 'R', 'O', 'F'};
+constexpr uint32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_interactions;
+  uint32_t num_records;
+  uint32_t strings_size;
+};
+
+struct BinaryString {
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct BinaryInteraction {
+  BinaryString id;
+  // The records of an interaction are consecutive, in file order.
+  uint32_t first_record;
+  uint32_t num_records;
+  uint32_t has_count;
+  uint32_t count;
+};
+
+struct BinaryRecord {
+  double appear_percent;
+  double call_count;
+  double order_percent;
+  BinaryString name;
+  int16_t min_api_level;
+  uint8_t padding[6];
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0);
+static_assert(sizeof(BinaryInteraction) % 8 == 0);
+static_assert(sizeof(BinaryRecord) % 8 == 0);
+
 } // namespace
 
 AccumulatingTimer MethodProfiles::s_process_unresolved_lines_timer(
@@ -69,6 +115,43 @@ const StatsMap& MethodProfiles::method_stats(
   return empty_map;
 }
 
+boost::optional<uint32_t> MethodProfiles::get_interaction_index(
+    const std::string& interaction_id) const {
+  auto it = m_method_stats.find(interaction_id);
+  if (it == m_method_stats.end() && interaction_id == COLD_START) {
+    // See method_stats.
+    it = m_method_stats.find("");
+  }
+  if (it == m_method_stats.end()) {
+    return boost::none;
+  }
+  return std::distance(m_method_stats.begin(), it);
+}
+
+void MethodProfiles::freeze() {
+  if (m_frozen != nullptr || m_method_stats.empty()) {
+    return;
+  }
+  Timer t("Freezing method profiles");
+  auto frozen = std::make_unique<FrozenStats>();
+  frozen->num_interactions = m_method_stats.size();
+  frozen->rows.resize(DexMethodRef::num_dense_indices());
+  uint32_t interaction_index = 0;
+  for (const auto& [_, stats_map] : m_method_stats) {
+    for (const auto& [m, stats] : stats_map) {
+      auto& row = frozen->rows.at(m->get_dense_index());
+      if (row == 0) {
+        frozen->stats.resize(frozen->stats.size() + frozen->num_interactions);
+        row = frozen->stats.size() / frozen->num_interactions;
+      }
+      frozen->stats[(row - 1) * frozen->num_interactions + interaction_index] =
+          stats;
+    }
+    interaction_index++;
+  }
+  m_frozen = std::move(frozen);
+}
+
 bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
   TRACE(METH_PROF, 3, "input csv filename: %s", csv_filename.c_str());
   if (csv_filename.empty()) {
@@ -116,6 +199,180 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
   return true;
 }
 
+bool MethodProfiles::is_binary_file(const std::string& filename) {
+  std::ifstream ifs(filename, std::ios::binary);
+  char magic[sizeof(BINARY_MAGIC)];
+  return ifs.read(magic, sizeof(magic)) &&
+         memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool MethodProfiles::parse_binary_file(const std::string& filename) {
+  TRACE(METH_PROF, 3, "input binary filename: %s", filename.c_str());
+  auto file = RedexMappedFile::open(filename);
+  const auto* data = file.const_data();
+  const size_t file_size = file.size();
+  if (file_size < sizeof(BinaryHeader)) {
+    std::cerr << "FAILED to read header of " << filename << std::endl;
+    return false;
+  }
+  const auto* header = reinterpret_cast<const BinaryHeader*>(data);
+  if (header->version != BINARY_VERSION) {
+    std::cerr << "Unsupported version " << header->version << " of "
+              << filename << std::endl;
+    return false;
+  }
+  const uint64_t interactions_offset = sizeof(BinaryHeader);
+  const uint64_t records_offset =
+      interactions_offset +
+      (uint64_t)header->num_interactions * sizeof(BinaryInteraction);
+  const uint64_t strings_offset =
+      records_offset + (uint64_t)header->num_records * sizeof(BinaryRecord);
+  if (strings_offset + header->strings_size != file_size) {
+    std::cerr << "Unexpected size of " << filename << std::endl;
+    return false;
+  }
+  const auto* interactions =
+      reinterpret_cast<const BinaryInteraction*>(data + interactions_offset);
+  const auto* records =
+      reinterpret_cast<const BinaryRecord*>(data + records_offset);
+  const char* strings = data + strings_offset;
+  auto get_string = [&](const BinaryString& s) {
+    always_assert_log((uint64_t)s.offset + s.size <= header->strings_size,
+                      "String out of bounds in %s", filename.c_str());
+    return std::string_view(strings + s.offset, s.size);
+  };
+
+  // Resolving the methods is the only real work left, and is independent
+  // for all records.
+  std::vector<DexMethodRef*> refs(header->num_records);
+  workqueue_run_for<size_t>(0, header->num_records, [&](size_t i) {
+    auto mdt = dex_member_refs::parse_method</*kCheckFormat=*/true>(
+        get_string(records[i].name));
+    refs[i] = DexMethod::get_method(mdt);
+  });
+
+  for (uint32_t i = 0; i < header->num_interactions; i++) {
+    const auto& interaction = interactions[i];
+    always_assert_log((uint64_t)interaction.first_record +
+                              interaction.num_records <=
+                          header->num_records,
+                      "Records out of bounds in %s", filename.c_str());
+    std::string interaction_id(get_string(interaction.id));
+    if (interaction.has_count) {
+      m_interaction_counts.emplace(interaction_id, interaction.count);
+    }
+    for (uint32_t j = interaction.first_record;
+         j < interaction.first_record + interaction.num_records; j++) {
+      const auto& record = records[j];
+      ParsedMain parsed_main;
+      parsed_main.ref = refs[j];
+      parsed_main.stats.appear_percent = record.appear_percent;
+      parsed_main.stats.call_count = record.call_count;
+      parsed_main.stats.order_percent = record.order_percent;
+      parsed_main.stats.min_api_level = record.min_api_level;
+      if (parsed_main.ref == nullptr) {
+        // Keep a copy of the name, as the mapping goes away.
+        parsed_main.ref_str =
+            std::make_unique<std::string>(get_string(record.name));
+        parsed_main.mdt = dex_member_refs::parse_method(*parsed_main.ref_str);
+        TRACE(METH_PROF, 6, "failed to resolve %s",
+              parsed_main.ref_str->c_str());
+      }
+      (void)apply_main_internal_result(std::move(parsed_main),
+                                       &interaction_id);
+    }
+  }
+
+  TRACE(METH_PROF, 1,
+        "MethodProfiles successfully loaded %zu rows; %zu unresolved lines",
+        size(), unresolved_size());
+  return true;
+}
+
+bool MethodProfiles::convert_to_binary(const std::string& csv_filename,
+                                       const std::string& binary_filename) {
+  MethodProfiles profiles;
+  if (!profiles.parse_stats_file(csv_filename)) {
+    return false;
+  }
+
+  std::string strings;
+  std::unordered_map<std::string, BinaryString> string_offsets;
+  auto intern = [&](const std::string& s) {
+    auto [it, emplaced] = string_offsets.emplace(
+        s, BinaryString{(uint32_t)strings.size(), (uint32_t)s.size()});
+    if (emplaced) {
+      strings += s;
+    }
+    return it->second;
+  };
+
+  // Rows that were resolved against the currently loaded classes, if any,
+  // come first, in a deterministic order. All others keep their file order.
+  std::map<std::string, std::vector<std::pair<std::string, Stats>>>
+      rows_by_interaction;
+  for (const auto& [interaction_id, _] : profiles.m_interaction_counts) {
+    rows_by_interaction[interaction_id];
+  }
+  for (const auto& [interaction_id, stats_map] : profiles.m_method_stats) {
+    auto& rows = rows_by_interaction[interaction_id];
+    for (const auto& [ref, stats] : stats_map) {
+      rows.emplace_back(show(ref), stats);
+    }
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+      return a.first < b.first;
+    });
+  }
+  for (const auto& parsed_main : profiles.m_unresolved_lines) {
+    rows_by_interaction[*parsed_main.line_interaction_id].emplace_back(
+        *parsed_main.ref_str, parsed_main.stats);
+  }
+
+  std::vector<BinaryInteraction> interactions;
+  std::vector<BinaryRecord> records;
+  for (const auto& [interaction_id, rows] : rows_by_interaction) {
+    BinaryInteraction interaction{};
+    interaction.id = intern(interaction_id);
+    interaction.first_record = records.size();
+    interaction.num_records = rows.size();
+    auto count = profiles.get_interaction_count(interaction_id);
+    interaction.has_count = count ? 1 : 0;
+    interaction.count = count ? *count : 0;
+    interactions.push_back(interaction);
+    for (const auto& [name, stats] : rows) {
+      BinaryRecord record{};
+      record.appear_percent = stats.appear_percent;
+      record.call_count = stats.call_count;
+      record.order_percent = stats.order_percent;
+      record.name = intern(name);
+      record.min_api_level = stats.min_api_level;
+      records.push_back(record);
+    }
+  }
+
+  BinaryHeader header{};
+  memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.version = BINARY_VERSION;
+  header.num_interactions = interactions.size();
+  header.num_records = records.size();
+  header.strings_size = strings.size();
+
+  std::ofstream ofs(binary_filename, std::ios::binary);
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(interactions.data()),
+            interactions.size() * sizeof(BinaryInteraction));
+  ofs.write(reinterpret_cast<const char*>(records.data()),
+            records.size() * sizeof(BinaryRecord));
+  ofs.write(strings.data(), strings.size());
+  if (!ofs.good()) {
+    std::cerr << "FAILED to write " << binary_filename << std::endl;
+    return false;
+  }
+  TRACE(METH_PROF, 1, "Wrote %zu rows and %zu bytes of strings to %s",
+        records.size(), strings.size(), binary_filename.c_str());
+  return true;
+}
+
 // `strtol` and `strtod` requires c string to be null terminated,
 // std::string_view::data() doesn't have this guarantee. Our `string_view`s are
 // taken from `std::string`s. This should be safe.
@@ -261,6 +518,7 @@ bool MethodProfiles::apply_main_internal_result(ParsedMain v,
           interaction_id->c_str(), v.stats.appear_percent, v.stats.call_count,
           v.stats.order_percent, v.stats.min_api_level);
     m_method_stats[*interaction_id].emplace(v.ref, v.stats);
+    m_frozen.reset();
     return true;
   } else if (v.ref_str == nullptr) {
     std::cerr << "FAILED to parse line. Missing name column\n";
@@ -279,6 +537,7 @@ void MethodProfiles::set_method_stats(const std::string& interaction_id,
                                       const DexMethodRef* m,
                                       Stats stats) {
   m_method_stats.at(interaction_id)[m] = stats;
+  m_frozen.reset();
 }
 
 size_t MethodProfiles::derive_stats(DexMethod* target,
@@ -314,6 +573,9 @@ size_t MethodProfiles::derive_stats(DexMethod* target,
       res++;
     }
   }
+  if (res > 0) {
+    m_frozen.reset();
+  }
   return res;
 }
 
@@ -359,6 +621,9 @@ size_t MethodProfiles::substitute_stats(
       }
     }
   }
+  if (res > 0) {
+    m_frozen.reset();
+  }
   return res;
 }
 
@@ -606,6 +871,11 @@ dexmethods_profiled_comparator::dexmethods_profiled_comparator(
               return a < b;
             });
 
+  for (const auto& interaction_id : m_interactions) {
+    m_interaction_indices.push_back(
+        m_method_profiles->get_interaction_index(interaction_id));
+  }
+
   for (auto method : initial_order) {
     m_initial_order.emplace(method, m_initial_order.size());
   }
@@ -617,7 +887,8 @@ double dexmethods_profiled_comparator::get_method_sort_num(
 
   std::optional<double> secondary_ordering = std::nullopt;
 
-  for (const auto& interaction_id : m_interactions) {
+  for (size_t i = 0; i < m_interactions.size(); ++i) {
+    const auto& interaction_id = m_interactions[i];
     if (interaction_id == COLD_START && m_coldstart_start_marker != nullptr &&
         m_coldstart_end_marker != nullptr) {
       if (method == m_coldstart_start_marker) {
@@ -626,10 +897,13 @@ double dexmethods_profiled_comparator::get_method_sort_num(
         return range_begin + RANGE_SIZE;
       }
     }
-    const auto& stats_map = m_method_profiles->method_stats(interaction_id);
-    auto it = stats_map.find(method);
-    if (it != stats_map.end()) {
-      const auto& stat = it->second;
+    auto maybe_stat =
+        m_interaction_indices[i]
+            ? m_method_profiles->get_method_stat(*m_interaction_indices[i],
+                                                 method)
+            : boost::none;
+    if (maybe_stat) {
+      const auto& stat = *maybe_stat;
 
       auto mixed_ordering = [](double appear_percent, double appear_bias,
                                double order_percent, double order_multiplier) {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <boost/optional.hpp>
+#include <memory>
 #include <string_view>
 
 #include "DexClass.h"
@@ -69,13 +70,17 @@ class MethodProfiles {
  public:
   MethodProfiles() {}
 
+  // Profiles may be given as csv files, or in the binary format written by
+  // convert_to_binary().
   void initialize(const std::vector<std::string>& csv_filenames) {
     m_initialized = true;
     Timer t("Parsing agg_method_stats_files");
     for (const std::string& csv_filename : csv_filenames) {
       m_interaction_id = "";
       m_mode = NONE;
-      bool success = parse_stats_file(csv_filename);
+      bool success = is_binary_file(csv_filename)
+                         ? parse_binary_file(csv_filename)
+                         : parse_stats_file(csv_filename);
       always_assert_log(success,
                         "Failed to parse %s. See stderr for more details",
                         csv_filename.c_str());
@@ -96,6 +101,16 @@ class MethodProfiles {
     return ret;
   }
 
+  /*
+   * Converts a csv profile into a compact binary format that can be loaded
+   * without any parsing: a table of interactions and a table of fixed-width
+   * stats records, which refer to an interned string table for interaction
+   * ids and method names. Methods are not resolved, so this does not need any
+   * dex files to be loaded.
+   */
+  static bool convert_to_binary(const std::string& csv_filename,
+                                const std::string& binary_filename);
+
   bool is_initialized() const { return m_initialized; }
 
   bool has_stats() const { return !m_method_stats.empty(); }
@@ -118,7 +133,26 @@ class MethodProfiles {
 
   boost::optional<Stats> get_method_stat(const std::string& interaction_id,
                                          const DexMethodRef* m) const {
-    const auto& stats = method_stats(interaction_id);
+    auto index = get_interaction_index(interaction_id);
+    if (!index) {
+      return boost::none;
+    }
+    return get_method_stat(*index, m);
+  }
+
+  // The position of the interaction in all_interactions(), which stays valid
+  // until another interaction gets added. Like method_stats(), falls back to
+  // the default interaction for cold start.
+  boost::optional<uint32_t> get_interaction_index(
+      const std::string& interaction_id) const;
+
+  boost::optional<Stats> get_method_stat(uint32_t interaction_index,
+                                         const DexMethodRef* m) const {
+    if (m_frozen != nullptr) {
+      return m_frozen->get(interaction_index, m);
+    }
+    const auto& stats =
+        std::next(m_method_stats.begin(), interaction_index)->second;
     auto it = stats.find(m);
     if (it == stats.end()) {
       return boost::none;
@@ -126,6 +160,14 @@ class MethodProfiles {
     return it->second;
   }
 
+  // Builds a dense form of all stats, indexed by the dense index of methods,
+  // with the stats of all interactions of a method next to each other. Until
+  // the stats get modified again, get_method_stat then does not hash at all.
+  // Does nothing if the stats did not change since the last call.
+  void freeze();
+
+  bool is_frozen() const { return m_frozen != nullptr; }
+
   void set_method_stats(const std::string& interaction_id,
                         const DexMethodRef* m,
                         Stats stats);
@@ -155,6 +197,27 @@ class MethodProfiles {
  private:
   static AccumulatingTimer s_process_unresolved_lines_timer;
   AllInteractions m_method_stats;
+
+  struct FrozenStats {
+    size_t num_interactions{0};
+    // Indexed by the dense index of a method. Zero for methods without stats,
+    // otherwise one more than the row of the method in `stats`.
+    std::vector<uint32_t> rows;
+    // `num_interactions` entries per row.
+    std::vector<boost::optional<Stats>> stats;
+
+    boost::optional<Stats> get(uint32_t interaction_index,
+                               const DexMethodRef* m) const {
+      auto dense_index = m->get_dense_index();
+      if (dense_index >= rows.size() || rows[dense_index] == 0) {
+        return boost::none;
+      }
+      return stats[(rows[dense_index] - 1) * num_interactions +
+                   interaction_index];
+    }
+  };
+  // Dropped whenever m_method_stats changes.
+  std::unique_ptr<FrozenStats> m_frozen;
   // Resolution may fail because of renaming or generated methods. Store the
   // unresolved lines here (per interaction) so we can update after passes run
   // and change the names of methods
@@ -181,6 +244,12 @@ class MethodProfiles {
   // m_method_stats
   bool parse_stats_file(const std::string& csv_filename);
 
+  static bool is_binary_file(const std::string& filename);
+  // Memory-map a file written by convert_to_binary() and populate
+  // m_method_stats. Only the names of methods that cannot be resolved yet get
+  // copied.
+  bool parse_binary_file(const std::string& filename);
+
   // Read a line of data (not a header)
   bool parse_line(const std::string& line);
   // Read a line from the main section of the aggregated stats file and put an
@@ -205,6 +274,8 @@ class dexmethods_profiled_comparator {
   double m_min_appear_percent;
   double m_second_min_appear_percent;
   std::vector<std::string> m_interactions;
+  // Parallel to m_interactions, none for interactions without stats.
+  std::vector<boost::optional<uint32_t>> m_interaction_indices;
 
   const DexMethod* m_coldstart_start_marker;
   const DexMethod* m_coldstart_end_marker;
@@ -7,6 +7,9 @@
 
 #include "MethodSimilarityGreedyOrderer.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "DexInstruction.h"
 #include "Show.h"
 #include "Timer.h"
@@ -35,6 +38,15 @@ struct CountingFakeOutputIterator {
   }
   T& operator*() { return fake; }
 };
+
+// A stand-in for a random hash function of the family used for MinHash
+// signatures, selected by the seed (the splitmix64 finalizer).
+inline uint64_t seeded_hash(uint64_t value, uint64_t seed) {
+  uint64_t z = value + (seed + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
 }; // namespace
 
 void MethodSimilarityGreedyOrderer::gather_code_hash_ids(
@@ -104,6 +116,66 @@ static inline Score get_score(
   return score;
 }
 
+std::vector<std::vector<MethodSimilarityGreedyOrderer::MethodId>>
+MethodSimilarityGreedyOrderer::compute_lsh_candidates() const {
+  const size_t num_methods = m_id_to_method.size();
+  const uint32_t num_bands = m_lsh_config.num_bands;
+  const uint32_t rows_per_band = m_lsh_config.rows_per_band;
+  always_assert(rows_per_band > 0);
+
+  // The hash of each band of the MinHash signature of each method. Methods
+  // without code all get the same signature, and thus end up together.
+  std::vector<std::vector<uint64_t>> band_hashes(num_methods);
+  workqueue_run_for<size_t>(0, num_methods, [&](size_t id) {
+    const auto& code_hash_ids = m_method_id_to_code_hash_ids.at(id);
+    auto& hashes = band_hashes[id];
+    hashes.reserve(num_bands);
+    for (uint32_t band = 0; band < num_bands; band++) {
+      uint64_t band_hash = band;
+      for (uint32_t row = 0; row < rows_per_band; row++) {
+        uint64_t min_hash = std::numeric_limits<uint64_t>::max();
+        for (auto code_hash_id : code_hash_ids) {
+          min_hash = std::min(
+              min_hash, seeded_hash(code_hash_id, band * rows_per_band + row));
+        }
+        band_hash = seeded_hash(band_hash ^ min_hash, row);
+      }
+      hashes.push_back(band_hash);
+    }
+  });
+
+  // Group the methods by the hash of each band. Groups list the methods in
+  // source order, and each method gets the next few methods of its group as
+  // candidates (wrapping around), so that a large group of identical methods
+  // still gets chained together.
+  std::vector<std::vector<MethodId>> candidates(num_methods);
+  std::vector<std::unordered_map<uint64_t, std::vector<MethodId>>> groups(
+      num_bands);
+  workqueue_run_for<uint32_t>(0, num_bands, [&](uint32_t band) {
+    for (size_t id = 0; id < num_methods; id++) {
+      groups[band][band_hashes[id][band]].push_back(id);
+    }
+  });
+  const size_t max_candidates = m_lsh_config.max_candidates_per_band;
+  workqueue_run_for<size_t>(0, num_methods, [&](size_t id) {
+    auto& method_candidates = candidates[id];
+    for (uint32_t band = 0; band < num_bands; band++) {
+      const auto& group = groups[band].at(band_hashes[id][band]);
+      auto pos = std::lower_bound(group.begin(), group.end(), id) -
+                 group.begin();
+      auto n = std::min(max_candidates, group.size() - 1);
+      for (size_t k = 1; k <= n; k++) {
+        method_candidates.push_back(group[(pos + k) % group.size()]);
+      }
+    }
+    std::sort(method_candidates.begin(), method_candidates.end());
+    method_candidates.erase(
+        std::unique(method_candidates.begin(), method_candidates.end()),
+        method_candidates.end());
+  });
+  return candidates;
+}
+
 void MethodSimilarityGreedyOrderer::compute_score() {
   m_score_map.clear();
   m_score_map.resize(m_id_to_method.size());
@@ -111,20 +183,20 @@ void MethodSimilarityGreedyOrderer::compute_score() {
   // Maximum number of code items can be 65536.
   redex_assert(m_id_to_method.size() <= (1 << 16));
 
+  std::vector<std::vector<MethodId>> lsh_candidates;
+  if (m_lsh_config.num_bands > 0) {
+    lsh_candidates = compute_lsh_candidates();
+  }
+
   std::vector<MethodId> indices(m_id_to_method.size());
   std::iota(indices.begin(), indices.end(), 0);
   workqueue_run<MethodId>(
       [&](MethodId i_id) {
-        const auto& code_hash_ids_i = m_method_id_to_code_hash_ids[i_id];
+        const auto& code_hash_ids_i = m_method_id_to_code_hash_ids.at(i_id);
         std::unordered_map<ScoreValue, boost::dynamic_bitset<>> score_map;
 
-        for (uint32_t j_id = 0; j_id < (uint32_t)m_id_to_method.size();
-             j_id++) {
-          if (i_id == j_id) {
-            continue;
-          }
-
-          const auto& code_hash_ids_j = m_method_id_to_code_hash_ids[j_id];
+        auto score_against = [&](uint32_t j_id) {
+          const auto& code_hash_ids_j = m_method_id_to_code_hash_ids.at(j_id);
           auto score = get_score(code_hash_ids_i, code_hash_ids_j);
           if (score.value() >= 0) {
             auto& method_id_bitset = score_map[score.value()];
@@ -133,6 +205,18 @@ void MethodSimilarityGreedyOrderer::compute_score() {
             }
             method_id_bitset.set(static_cast<size_t>(j_id));
           }
+        };
+        if (m_lsh_config.num_bands > 0) {
+          for (auto j_id : lsh_candidates[i_id]) {
+            score_against(j_id);
+          }
+        } else {
+          for (uint32_t j_id = 0; j_id < (uint32_t)m_id_to_method.size();
+               j_id++) {
+            if (i_id != j_id) {
+              score_against(j_id);
+            }
+          }
         }
 
         if (!score_map.empty()) {
@@ -29,6 +29,13 @@ class DexInstruction;
  * highly similar methods. For example, methods with a small body like "return
  * true;" would all get co-located right after the first such method, resulting
  * in better compression.
+ *
+ * By default, every method is scored against every other method, which is
+ * quadratic in the number of methods of a dex. Alternatively, locality
+ * sensitive hashing over MinHash signatures of the code hash ids restricts the
+ * scoring to methods that share at least one band of their signature, i.e.
+ * that are likely to be similar. More bands find more of the similar methods,
+ * at the cost of more comparisons.
  */
 class MethodSimilarityGreedyOrderer {
  public:
@@ -45,7 +52,24 @@ class MethodSimilarityGreedyOrderer {
 
   using ScoreValue = int32_t;
 
+  struct LshConfig {
+    // The number of bands of the MinHash signatures; 0 means that all pairs of
+    // methods are compared.
+    uint32_t num_bands{0};
+    // The number of MinHash values per band.
+    uint32_t rows_per_band{2};
+    // How many of the other methods sharing a band are considered; this
+    // bounds the comparisons for large groups of (near) identical methods.
+    uint32_t max_candidates_per_band{64};
+  };
+
+  MethodSimilarityGreedyOrderer() = default;
+  explicit MethodSimilarityGreedyOrderer(const LshConfig& lsh_config)
+      : m_lsh_config(lsh_config) {}
+
  private:
+  LshConfig m_lsh_config;
+
   // Mirrors the order in each the methods have been added to the orderer
   std::map<MethodId, DexMethod*> m_id_to_method;
 
@@ -80,6 +104,10 @@ class MethodSimilarityGreedyOrderer {
 
   boost::optional<MethodId> get_next();
 
+  // For each method, the sorted ids of the other methods that are likely
+  // similar to it, according to the MinHash signatures of their code hash ids.
+  std::vector<std::vector<MethodId>> compute_lsh_candidates() const;
+
   void compute_score();
 
  public:
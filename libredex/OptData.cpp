@@ -10,9 +10,11 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
-#include <json/value.h>
+#include <ostream>
+#include <json/writer.h>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -27,6 +29,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -97,6 +100,77 @@ std::string get_deobfuscated_name(const DexMethod* method) {
   always_assert_log(!name.empty(), "A method is always named\n");
   return name;
 }
+
+/**
+ * Appends a json object on a line of its own to a string of table rows. Each
+ * row is prefixed with a separating comma.
+ */
+class JsonRow {
+ public:
+  explicit JsonRow(std::string* rows) : m_rows(rows) {
+    m_rows->append(",\n    {");
+  }
+
+  JsonRow& add(const char* key, uint64_t value) {
+    add_key(key);
+    m_rows->append(std::to_string(value));
+    return *this;
+  }
+
+  JsonRow& add(const char* key, const std::string& value) {
+    add_key(key);
+    m_rows->append(Json::valueToQuotedString(value.c_str()));
+    return *this;
+  }
+
+  void end() { m_rows->push_back('}'); }
+
+ private:
+  void add_key(const char* key) {
+    if (m_has_keys) {
+      m_rows->append(", ");
+    }
+    m_has_keys = true;
+    m_rows->push_back('"');
+    m_rows->append(key);
+    m_rows->append("\": ");
+  }
+
+  std::string* m_rows;
+  bool m_has_keys{false};
+};
+
+constexpr size_t ROW_BATCH_SIZE = 1 << 14;
+
+/**
+ * Writes a table as a json array named `name`, with the rows that `format`
+ * appends for each of the items. The items are formatted in parallel, one
+ * batch at a time, which bounds the memory needed for the formatted rows.
+ */
+template <typename Item, typename Format>
+void write_table(std::ostream& os,
+                 const char* name,
+                 const std::vector<Item>& items,
+                 const Format& format) {
+  os << "  \"" << name << "\": [";
+  bool first = true;
+  std::vector<std::string> rows;
+  for (size_t begin = 0; begin < items.size(); begin += ROW_BATCH_SIZE) {
+    auto end = std::min(items.size(), begin + ROW_BATCH_SIZE);
+    rows.assign(end - begin, std::string());
+    workqueue_run_for<size_t>(
+        begin, end, [&](size_t i) { format(items[i], &rows[i - begin]); });
+    for (const auto& row : rows) {
+      if (row.empty()) {
+        continue;
+      }
+      // Drop the separator of the first row.
+      os << (first ? std::string_view(row).substr(1) : std::string_view(row));
+      first = false;
+    }
+  }
+  os << (first ? "]" : "\n  ]");
+}
 } // namespace
 
 namespace opt_metadata {
@@ -254,170 +328,152 @@ void OptDataMapper::log_nopt(NoptReason nopt, const DexClass* cls) {
   cls_opt_data->m_nopts.emplace_back(nopt);
 }
 
-Json::Value OptDataMapper::serialize_sql() {
-  constexpr const char* CLASS_OPTS = "class_opts";
-  constexpr const char* METHOD_OPTS = "method_opts";
-  constexpr const char* INSTRUCTION_OPTS = "instruction_opts";
-  constexpr const char* CLASS_NOPTS = "class_nopts";
-  constexpr const char* METHOD_NOPTS = "method_nopts";
-  constexpr const char* INSTRUCTION_NOPTS = "instruction_nopts";
-  constexpr const char* INSTRUCTIONS = "instructions";
-  constexpr const char* METHODS = "methods";
-  constexpr const char* CLASSES = "classes";
-  constexpr const char* OPT_MESSAGES = "opt_messages";
-  constexpr const char* NOPT_MESSAGES = "nopt_messages";
-  Json::Value top;
-
-  Json::Value opt_msg_arr;
-  Json::Value nopt_msg_arr;
-  serialize_messages_helper(m_opt_msg_map, &opt_msg_arr);
-  serialize_messages_helper(m_nopt_msg_map, &nopt_msg_arr);
-  top[OPT_MESSAGES] = opt_msg_arr;
-  top[NOPT_MESSAGES] = nopt_msg_arr;
-
-  size_t cls_id{0};
-  size_t meth_id{0};
-  size_t insn_id{0};
-  Json::Value cls_arr;
-  Json::Value cls_opt_arr;
-  Json::Value cls_nopt_arr;
-  Json::Value meth_arr;
-  Json::Value meth_opt_arr;
-  Json::Value meth_nopt_arr;
-  Json::Value insn_arr;
-  Json::Value insn_opt_arr;
-  Json::Value insn_nopt_arr;
-
+void OptDataMapper::serialize_sql(std::ostream& os) {
+  struct ClassRow {
+    const ClassOptData* data;
+    size_t id;
+  };
+  struct MethodRow {
+    const MethodOptData* data;
+    size_t id;
+    size_t cls_id;
+  };
+  struct InsnRow {
+    const InsnOptData* data;
+    size_t id;
+    size_t meth_id;
+  };
+  using MessageRow = std::pair<int, std::string>;
+
+  // Assign the ids up front, so that all tables can be written independently.
+  std::vector<ClassRow> classes;
+  std::vector<MethodRow> methods;
+  std::vector<InsnRow> insns;
   for (const auto& cls_pair : m_cls_opt_map) {
-    auto cls_opt_data = cls_pair.second;
-    serialize_class(cls_opt_data, cls_id, &cls_arr, &cls_opt_arr,
-                    &cls_nopt_arr);
-
+    const auto& cls_opt_data = cls_pair.second;
+    auto cls_id = classes.size();
+    classes.push_back({cls_opt_data.get(), cls_id});
     for (const auto& meth_pair : cls_opt_data->m_meth_opt_map) {
-      auto meth_opt_data = meth_pair.second;
-      serialize_method(meth_opt_data, cls_id, meth_id, &meth_arr, &meth_opt_arr,
-                       &meth_nopt_arr);
-
+      const auto& meth_opt_data = meth_pair.second;
+      auto meth_id = methods.size();
+      methods.push_back({meth_opt_data.get(), meth_id, cls_id});
       for (const auto& insn_pair : meth_opt_data->m_insn_opt_map) {
-        auto insn_opt_data = insn_pair.second;
-        serialize_insn(insn_opt_data, meth_id, insn_id, &insn_arr,
-                       &insn_opt_arr, &insn_nopt_arr);
-        insn_id++;
+        insns.push_back({insn_pair.second.get(), insns.size(), meth_id});
       }
-      meth_id++;
     }
-    cls_id++;
   }
-
-  top[CLASSES] = cls_arr;
-  top[METHODS] = meth_arr;
-  top[INSTRUCTIONS] = insn_arr;
-  top[INSTRUCTION_OPTS] = insn_opt_arr;
-  top[METHOD_OPTS] = meth_opt_arr;
-  top[CLASS_OPTS] = cls_opt_arr;
-  top[INSTRUCTION_NOPTS] = insn_nopt_arr;
-  top[METHOD_NOPTS] = meth_nopt_arr;
-  top[CLASS_NOPTS] = cls_nopt_arr;
-  return top;
+  std::vector<MessageRow> opt_msgs(m_opt_msg_map.begin(), m_opt_msg_map.end());
+  std::vector<MessageRow> nopt_msgs(m_nopt_msg_map.begin(),
+                                    m_nopt_msg_map.end());
+
+  // The tables and columns are written in alphabetical order, like JsonCpp
+  // would.
+  auto format_message = [](const MessageRow& msg, std::string* rows) {
+    JsonRow(rows)
+        .add("message", msg.second)
+        .add("reason_code", (uint64_t)msg.first)
+        .end();
+  };
+  auto format_class = [](const ClassRow& row, std::string* rows) {
+    const auto* cls_opt_data = row.data;
+    JsonRow(rows)
+        .add("id", row.id)
+        .add("name", get_deobfuscated_name_substr(cls_opt_data->m_cls))
+        .add("package", str_copy(cls_opt_data->m_package))
+        .add("source_file", cls_opt_data->m_has_srcfile
+                                ? str_copy(cls_opt_data->m_filename)
+                                : "")
+        .end();
+  };
+  auto format_method = [](const MethodRow& row, std::string* rows) {
+    const auto* meth_opt_data = row.data;
+    const auto* method = meth_opt_data->m_method;
+    JsonRow(rows)
+        .add("cls_id", row.cls_id)
+        .add("code_size",
+             method->get_code() ? method->get_code()->sum_opcode_sizes() : 0)
+        .add("has_line_num", meth_opt_data->m_has_line_num ? 1 : 0)
+        .add("id", row.id)
+        .add("line_num", meth_opt_data->m_line_num)
+        .add("signature", get_deobfuscated_name(method))
+        .end();
+  };
+  // TODO In case of invokes, we want to show the deobfuscated name for clarity,
+  // if possible.
+  auto format_insn = [](const InsnRow& row, std::string* rows) {
+    const auto* insn_opt_data = row.data;
+    JsonRow(rows)
+        .add("has_line_num", insn_opt_data->m_has_line_num ? 1 : 0)
+        .add("id", row.id)
+        .add("instruction", insn_opt_data->m_insn_orig)
+        .add("line_num", insn_opt_data->m_line_num)
+        .add("meth_id", row.meth_id)
+        .end();
+  };
+
+  os << "{\n";
+  write_table(os, "class_nopts", classes, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_nopts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "class_opts", classes, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_opts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "classes", classes, format_class);
+  os << ",\n";
+  write_table(os, "instruction_nopts", insns, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_nopts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "instruction_opts", insns, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_opts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "instructions", insns, format_insn);
+  os << ",\n";
+  write_table(os, "method_nopts", methods, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_nopts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "method_opts", methods, [&](const auto& row, auto* rows) {
+    format_reason_rows(row.data->m_opts, row.id, rows);
+  });
+  os << ",\n";
+  write_table(os, "methods", methods, format_method);
+  os << ",\n";
+  write_table(os, "nopt_messages", nopt_msgs, format_message);
+  os << ",\n";
+  write_table(os, "opt_messages", opt_msgs, format_message);
+  os << "\n}\n";
 }
 
-void OptDataMapper::serialize_messages_helper(
-    const std::unordered_map<int, std::string>& msg_map, Json::Value* arr) {
-  for (const auto& reason_msg_pair : msg_map) {
-    auto reason = reason_msg_pair.first;
-    const auto& message = reason_msg_pair.second;
-    Json::Value msg_pair;
-    msg_pair["reason_code"] = reason;
-    msg_pair["message"] = message;
-    arr->append(msg_pair);
+void OptDataMapper::format_reason_rows(const std::vector<OptReason>& opts,
+                                       size_t id,
+                                       std::string* rows) {
+  for (size_t i = 0; i < opts.size(); ++i) {
+    verify_opt(opts[i]);
+    JsonRow(rows)
+        .add("id", id)
+        .add("reason_code", (uint64_t)opts[i])
+        .add("reason_idx", i)
+        .end();
   }
 }
 
-void OptDataMapper::serialize_opt_nopt_helper(
-    const std::vector<OptReason>& opts,
-    const std::vector<NoptReason>& nopts,
-    size_t id,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  for (size_t i = 0; i < opts.size(); ++i) {
-    verify_opt(opts.at(i));
-    Json::Value opt_data;
-    opt_data["reason_idx"] = (uint32_t)i;
-    opt_data["id"] = (uint32_t)id;
-    opt_data["reason_code"] = opts.at(i);
-    opt_arr->append(opt_data);
-  }
+void OptDataMapper::format_reason_rows(const std::vector<NoptReason>& nopts,
+                                       size_t id,
+                                       std::string* rows) {
   for (size_t i = 0; i < nopts.size(); ++i) {
-    verify_nopt(nopts.at(i));
-    Json::Value nopt_data;
-    nopt_data["reason_idx"] = (uint32_t)i;
-    nopt_data["id"] = (uint32_t)id;
-    nopt_data["reason_code"] = nopts.at(i);
-    nopt_arr->append(nopt_data);
+    verify_nopt(nopts[i]);
+    JsonRow(rows)
+        .add("id", id)
+        .add("reason_code", (uint64_t)nopts[i])
+        .add("reason_idx", i)
+        .end();
   }
 }
 
-void OptDataMapper::serialize_class(
-    const std::shared_ptr<ClassOptData>& cls_opt_data,
-    size_t cls_id,
-    Json::Value* arr,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  std::string name = get_deobfuscated_name_substr(cls_opt_data->m_cls);
-  Json::Value cls_data;
-  cls_data["id"] = (uint32_t)cls_id;
-  cls_data["package"] = str_copy(cls_opt_data->m_package);
-  cls_data["source_file"] =
-      cls_opt_data->m_has_srcfile ? str_copy(cls_opt_data->m_filename) : "";
-  cls_data["name"] = std::move(name);
-  arr->append(cls_data);
-  serialize_opt_nopt_helper(cls_opt_data->m_opts, cls_opt_data->m_nopts, cls_id,
-                            opt_arr, nopt_arr);
-}
-
-void OptDataMapper::serialize_method(
-    const std::shared_ptr<MethodOptData>& meth_opt_data,
-    size_t cls_id,
-    size_t meth_id,
-    Json::Value* arr,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  const auto& method = meth_opt_data->m_method;
-  Json::Value meth_data;
-  meth_data["id"] = (uint32_t)meth_id;
-  meth_data["cls_id"] = (uint32_t)cls_id;
-  meth_data["has_line_num"] = meth_opt_data->m_has_line_num ? 1 : 0;
-  meth_data["line_num"] = (uint32_t)meth_opt_data->m_line_num;
-  meth_data["signature"] = get_deobfuscated_name(method);
-  meth_data["code_size"] =
-      (uint32_t)(method->get_code() ? method->get_code()->sum_opcode_sizes()
-                                    : 0);
-  arr->append(meth_data);
-  serialize_opt_nopt_helper(meth_opt_data->m_opts, meth_opt_data->m_nopts,
-                            meth_id, opt_arr, nopt_arr);
-}
-
-void OptDataMapper::serialize_insn(
-    const std::shared_ptr<InsnOptData>& insn_opt_data,
-    size_t meth_id,
-    size_t insn_id,
-    Json::Value* arr,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  Json::Value insn_data;
-  insn_data["id"] = (uint32_t)insn_id;
-  insn_data["meth_id"] = (uint32_t)meth_id;
-  insn_data["has_line_num"] = insn_opt_data->m_has_line_num ? 1 : 0;
-  insn_data["line_num"] = (uint32_t)insn_opt_data->m_line_num;
-  insn_data["instruction"] = insn_opt_data->m_insn_orig;
-
-  // TODO In case of invokes, we want to show the deobfuscated name for clarity,
-  // if possible.
-  arr->append(insn_data);
-  serialize_opt_nopt_helper(insn_opt_data->m_opts, insn_opt_data->m_nopts,
-                            insn_id, opt_arr, nopt_arr);
-}
-
 /**
  * NOTE: Double up on single quotes for escaping in sql strings.
  */
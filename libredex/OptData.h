@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <iosfwd>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -18,10 +19,6 @@
 #include "Trace.h"
 #include "Util.h"
 
-namespace Json {
-class Value;
-} // namespace Json
-
 /**
  * Usage:
  * To log an optimization/non-opt:
@@ -161,8 +158,8 @@ class OptDataMapper {
   void log_nopt(NoptReason opt, const DexClass* cls);
 
   /**
-   * Writes the gathered optimization data in terms of sql queries, separated
-   * by newlines for easy parsing later on.
+   * Writes the gathered optimization data as a json object of tables, for
+   * easy import into a database later on.
    * 11 tables are created:
    *  - opt_messages maps an optimization reason_code to a message.
    *  - nopt_messages maps a non-optimization reason_code to a message.
@@ -173,8 +170,12 @@ class OptDataMapper {
    *    specific {level}_id.
    *  - classes/methods/instructions contain basic information: a unique id,
    *    names, and in the case of instructions, the instruction itself.
+   *
+   * The tables are streamed to the output row by row. Rows are formatted in
+   * parallel, a bounded batch at a time, instead of building the whole json
+   * document in memory.
    */
-  Json::Value serialize_sql();
+  void serialize_sql(std::ostream& os);
 
  private:
   bool m_logs_enabled{false};
@@ -195,52 +196,15 @@ class OptDataMapper {
   std::shared_ptr<ClassOptData> get_cls_opt_data(DexType* cls_type);
 
   /**
-   * For the table {msg_type}_messages, append each row as an entry to arr.
-   */
-  void serialize_messages_helper(
-      const std::unordered_map<int, std::string>& msg_map, Json::Value* arr);
-
-  /**
-   * For the tables {level}_opts and {level}_nopts, append each row as an
-   * entry in the corresponding json arr.
-   */
-  void serialize_opt_nopt_helper(const std::vector<OptReason>& opts,
-                                 const std::vector<NoptReason>& nopts,
-                                 size_t id,
-                                 Json::Value* opt_arr,
-                                 Json::Value* nopt_arr);
-
-  /**
-   * For the table 'classes', append class info to arr. Append cls opt info to
-   * opt/nopt arrs.
-   */
-  void serialize_class(const std::shared_ptr<ClassOptData>& cls_opt_data,
-                       size_t cls_id,
-                       Json::Value* arr,
-                       Json::Value* opt_arr,
-                       Json::Value* nopt_arr);
-
-  /**
-   * For the table 'methods', append method info to arr. Append meth opt info to
-   * opt/nopt arrs.
-   */
-  void serialize_method(const std::shared_ptr<MethodOptData>& meth_opt_data,
-                        size_t cls_id,
-                        size_t meth_id,
-                        Json::Value* arr,
-                        Json::Value* opt_arr,
-                        Json::Value* nopt_arr);
-
-  /**
-   * For the table 'instructions', append instruction info to arr. Append insn
-   * opt info to opt/nopt arrs.
+   * For the tables {level}_opts and {level}_nopts, append a row for each
+   * reason to rows.
    */
-  void serialize_insn(const std::shared_ptr<InsnOptData>& insn_opt_data,
-                      size_t meth_id,
-                      size_t insn_id,
-                      Json::Value* arr,
-                      Json::Value* opt_arr,
-                      Json::Value* nopt_arr);
+  void format_reason_rows(const std::vector<OptReason>& opts,
+                          size_t id,
+                          std::string* rows);
+  void format_reason_rows(const std::vector<NoptReason>& nopts,
+                          size_t id,
+                          std::string* rows);
 
   /**
    * NOTE: Register an opt/non-opt message to the corresponding init_ function.
@@ -33,6 +33,14 @@ Configurable::Reflection Pass::reflect() {
         /*is_required=*/false, /*bindflags=*/0, "bool",
         /*default_value=*/Json::nullValue);
   }
+  if (cr.params.count("num_threads") == 0) {
+    // Add in a "num_threads" param for the PassManager.
+    cr.params["num_threads"] = Configurable::ReflectionParam(
+        "num_threads",
+        "Number of threads for the parallel work of the pass, if not all",
+        /*is_required=*/false, /*bindflags=*/0, "int",
+        /*default_value=*/Json::nullValue);
+  }
   return cr;
 }
 
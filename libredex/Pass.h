@@ -39,6 +39,13 @@ class Pass : public Configurable {
   // \returns True means this pass is NOT guaranteed to fully use editable cfg.
   virtual bool is_cfg_legacy() { return false; }
 
+  // \returns True if run_pass never modifies the stores, e.g. for checkers.
+  // The PassManager runs consecutive read-only passes concurrently. Such a
+  // pass must report its metrics from the thread that calls run_pass, as
+  // metrics from worker threads are attributed to the first pass of the
+  // group.
+  virtual bool is_read_only() const { return false; }
+
   virtual void destroy_analysis_result() {
     always_assert_log(m_kind != ANALYSIS,
                       "destroy_analysis_result not implemented for %s",
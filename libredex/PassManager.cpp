@@ -8,20 +8,25 @@
 #include "PassManager.h"
 #include "DexAssessments.h"
 
+#include <atomic>
 #include <boost/filesystem.hpp>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <json/json.h>
 #include <limits>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <thread>
+#include <tuple>
 #include <typeinfo>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifdef __linux__
@@ -46,6 +51,7 @@
 #include "IRCode.h"
 #include "IRTypeChecker.h"
 #include "JemallocUtil.h"
+#include "MemoryAttribution.h"
 #include "MethodProfiles.h"
 #include "Native.h"
 #include "OptData.h"
@@ -55,6 +61,7 @@
 #include "ProguardReporting.h"
 #include "RedexContext.h"
 #include "RedexPropertiesManager.h"
+#include "SamplingProfiler.h"
 #include "Sanitizers.h"
 #include "ScopedMemStats.h"
 #include "ScopedMetrics.h"
@@ -92,6 +99,52 @@ std::string get_apk_dir(const ConfigFiles& config) {
   return apkdir;
 }
 
+// Remembers which methods passed the IRTypeChecker after an earlier pass, so
+// that later checks only need to look at the methods that may have been
+// mutated since (see DexMethod::is_type_check_dirty()). As checking a method
+// also depends on the declarations it refers to, methods are only skipped if
+// no mutation invalidated all cached hashes in the meantime (see
+// hashing::invalidate_cached_hashes()), and if neither the class hierarchy nor
+// any class or method access flags changed.
+class IncrementalTypeCheckState {
+ public:
+  // Returns whether methods that are not dirty may be skipped by the check
+  // that is about to run on the given scope.
+  bool can_skip_clean_methods(const Scope& scope) {
+    auto epoch = hashing::cached_hashes_epoch();
+    auto declarations = get_declarations(scope);
+    bool unchanged =
+        m_valid && epoch == m_epoch && declarations == m_declarations;
+    m_valid = true;
+    m_epoch = epoch;
+    m_declarations = std::move(declarations);
+    return unchanged;
+  }
+
+ private:
+  using Declarations =
+      std::vector<std::tuple<const void*, const void*, const void*, uint32_t>>;
+
+  static Declarations get_declarations(const Scope& scope) {
+    Declarations declarations;
+    for (auto* cls : scope) {
+      declarations.emplace_back(cls, cls->get_super_class(),
+                                cls->get_interfaces(), cls->get_access());
+      for (const auto& methods : {cls->get_dmethods(), cls->get_vmethods()}) {
+        for (auto* m : methods) {
+          declarations.emplace_back(m, nullptr, nullptr,
+                                    m->get_access() | (m->is_virtual() << 31));
+        }
+      }
+    }
+    return declarations;
+  }
+
+  bool m_valid{false};
+  uint64_t m_epoch{0};
+  Declarations m_declarations;
+};
+
 class CheckerConfig {
  public:
   explicit CheckerConfig(const ConfigFiles& conf,
@@ -119,6 +172,10 @@ class CheckerConfig {
 
     m_check_classes = type_checker_args.get("check_classes", true).asBool();
 
+    if (type_checker_args.get("incremental", false).asBool()) {
+      m_incremental_state = std::make_shared<IncrementalTypeCheckState>();
+    }
+
     for (auto& trigger_pass : type_checker_args["run_after_passes"]) {
       m_type_checker_trigger_passes.insert(trigger_pass.asString());
     }
@@ -181,14 +238,23 @@ class CheckerConfig {
     return ret;
   }
 
+  // With `incremental`, and if enabled by `ir_type_checker.incremental`, only
+  // checks the methods that may have changed since they last passed such an
+  // incremental check. Otherwise, all methods are checked.
   boost::optional<std::string> run_verifier(const Scope& scope,
-                                            bool exit_on_fail = true) {
+                                            bool exit_on_fail = true,
+                                            bool incremental = false) {
     if (m_disabled) {
       return boost::none;
     }
     TRACE(PM, 1, "Running IRTypeChecker...");
     Timer t("IRTypeChecker");
 
+    auto* incremental_state = incremental ? m_incremental_state.get() : nullptr;
+    bool skip_clean_methods = incremental_state != nullptr &&
+                              incremental_state->can_skip_clean_methods(scope);
+    std::atomic<size_t> skipped{0};
+
     struct Result {
       size_t errors{0};
       DexMethod* smallest_error_method{nullptr};
@@ -246,12 +312,24 @@ class CheckerConfig {
 
     auto res =
         walk::parallel::methods<Result>(scope, [&](DexMethod* dex_method) {
+          if (skip_clean_methods && !dex_method->is_type_check_dirty()) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            return Result();
+          }
           auto checker = run_checker(dex_method);
           if (!checker.fail()) {
+            if (incremental_state != nullptr) {
+              // Running the checker itself marks the method as dirty.
+              dex_method->clear_type_check_dirty();
+            }
             return Result();
           }
           return Result(dex_method);
         });
+    if (incremental_state != nullptr) {
+      TRACE(PM, 1, "IRTypeChecker skipped %zu unchanged methods",
+            skipped.load());
+    }
 
     if (res.errors != 0) {
       // Re-run the smallest method to produce error message.
@@ -316,6 +394,8 @@ class CheckerConfig {
   bool m_check_classes;
   bool m_relaxed_init_check;
   bool m_disabled;
+  // Shared by all copies, see run_verifier().
+  std::shared_ptr<IncrementalTypeCheckState> m_incremental_state;
 };
 
 class CheckUniqueDeobfuscatedNames {
@@ -369,7 +449,7 @@ class CheckUniqueDeobfuscatedNames {
     });
     std::unordered_map<std::string, DexField*> field_names;
     walk::fields(scope, [&field_names, pass_name](DexField* dex_field) {
-      auto deob = dex_field->get_deobfuscated_name();
+      auto deob = dex_field->get_deobfuscated_name_or_empty_copy();
       auto it = field_names.find(deob);
       if (it != field_names.end()) {
         fprintf(stderr,
@@ -390,8 +470,12 @@ class CheckUniqueDeobfuscatedNames {
 class VisualizerHelper {
  public:
   explicit VisualizerHelper(const ConfigFiles& conf)
-      : m_class_cfgs(conf.metafile(CFG_DUMP_BASE_NAME),
-                     conf.get_json_config().get("write_cfg_each_pass", false)) {
+      : m_class_cfgs(
+            conf.metafile(CFG_DUMP_BASE_NAME),
+            conf.get_json_config().get("write_cfg_each_pass", false),
+            conf.get_json_config().get("dump_cfg_method_filter",
+                                       std::string("")),
+            get_num_shards(conf)) {
     m_class_cfgs.add_all(
         conf.get_json_config().get("dump_cfg_classes", std::string("")));
   }
@@ -408,6 +492,12 @@ class VisualizerHelper {
   }
 
  private:
+  static size_t get_num_shards(const ConfigFiles& conf) {
+    size_t num_shards;
+    conf.get_json_config().get("dump_cfg_shards", 1, num_shards);
+    return num_shards;
+  }
+
   static constexpr visualizer::Options VISUALIZER_PASS_OPTIONS =
       (visualizer::Options)(visualizer::Options::SKIP_NO_CHANGE |
                             visualizer::Options::FORCE_CFG);
@@ -420,8 +510,8 @@ class AnalysisUsageHelper {
  public:
   using PreservedMap = std::unordered_map<AnalysisID, Pass*>;
 
-  explicit AnalysisUsageHelper(PreservedMap& m)
-      : m_preserved_analysis_passes(m) {}
+  AnalysisUsageHelper(PreservedMap& m, AnalysisCache& cache)
+      : m_preserved_analysis_passes(m), m_analysis_cache(cache) {}
 
   void pre_pass(Pass* pass) { pass->set_analysis_usage(m_analysis_usage); }
 
@@ -429,6 +519,7 @@ class AnalysisUsageHelper {
     // Invalidate existing preserved analyses according to policy set by each
     // pass.
     m_analysis_usage.do_pass_invalidation(&m_preserved_analysis_passes);
+    m_analysis_cache.invalidate(m_analysis_usage);
 
     if (pass->is_analysis_pass()) {
       // If the pass is an analysis pass, preserve it.
@@ -439,6 +530,7 @@ class AnalysisUsageHelper {
  private:
   AnalysisUsage m_analysis_usage;
   PreservedMap& m_preserved_analysis_passes;
+  AnalysisCache& m_analysis_cache;
 };
 
 class JNINativeContextHelper {
@@ -528,6 +620,8 @@ void process_method_profiles(PassManager& mgr, ConfigFiles& conf) {
   // unresolved methods to see if we can match them now (so that future passes
   // using method profiles benefit)
   conf.process_unresolved_method_profile_lines();
+  // Let the next pass look up stats without hashing.
+  conf.get_method_profiles().freeze();
   mgr.set_metric("~result~MethodProfiles~", conf.get_method_profiles().size());
   mgr.set_metric("~result~MethodProfiles~unresolved~",
                  conf.get_method_profiles().unresolved_size());
@@ -618,10 +712,54 @@ bool is_run_hasher_after_each_pass(const ConfigFiles& conf,
 void ensure_editable_cfg(DexStoresVector& stores) {
   auto temp_scope = build_class_scope(stores);
   walk::parallel::code(temp_scope, [&](DexMethod*, IRCode& code) {
-    code.build_cfg(/* editable */ true, /*fresh_editable_build*/ false);
+    code.build_cfg(/* editable */ true);
   });
 }
 
+// Runs the passes that are necessary to be able to write out the current
+// state of the stores, e.g., register allocation. Used by forked children
+// which leave the main pass loop early. Returns the names of the passes that
+// ran, in order.
+std::vector<std::string> run_passes_required_for_output(PassManager* mgr,
+                                                        DexStoresVector* stores,
+                                                        ConfigFiles* conf,
+                                                        bool run_interdex,
+                                                        bool debug) {
+  std::vector<std::string> ran;
+  auto maybe_run = [&](const char* pass_name) {
+    auto pass = mgr->find_pass(pass_name);
+    if (pass != nullptr) {
+      if (debug) {
+        std::cerr << "Running " << pass_name << std::endl;
+      }
+      if (!pass->is_cfg_legacy()) {
+        ensure_editable_cfg(*stores);
+      }
+      pass->run_pass(*stores, *conf, *mgr);
+      ran.emplace_back(pass_name);
+    }
+  };
+
+  // If configured with InterDexPass, better run that. Expensive, but may be
+  // required for dex constraints.
+  if (run_interdex && !mgr->interdex_has_run()) {
+    maybe_run("InterDexPass");
+  }
+  // Better run MakePublicPass.
+  maybe_run("MakePublicPass");
+  // Run ReBindRefsPass to not get a 'trying to encode too many method refs in
+  // dex' error
+  maybe_run("ReBindRefsPass");
+  // May need register allocation. Run InjectionIdLoweringPass too so
+  // RegAllocPass doesn't fail on injection-id opcodes
+  if (!mgr->regalloc_has_run()) {
+    maybe_run("IntrinsifyInjectionIdsPass");
+    maybe_run("InjectionIdLoweringPass");
+    maybe_run("RegAllocPass");
+  }
+  return ran;
+}
+
 class AfterPassSizes {
  private:
   PassManager* m_mgr;
@@ -786,36 +924,8 @@ class AfterPassSizes {
     // Ensure that aborts work correctly.
     set_abort_if_not_this_thread();
 
-    auto maybe_run = [&](const char* pass_name) {
-      auto pass = m_mgr->find_pass(pass_name);
-      if (pass != nullptr) {
-        if (m_debug) {
-          std::cerr << "Running " << pass_name << std::endl;
-        }
-        if (!pass->is_cfg_legacy()) {
-          ensure_editable_cfg(*stores);
-        }
-        pass->run_pass(*stores, *conf, *m_mgr);
-      }
-    };
-
-    // If configured with InterDexPass, better run that. Expensive, but may be
-    // required for dex constraints.
-    if (m_run_interdex && !m_mgr->interdex_has_run()) {
-      maybe_run("InterDexPass");
-    }
-    // Better run MakePublicPass.
-    maybe_run("MakePublicPass");
-    // Run ReBindRefsPass to not get a 'trying to encode too many method refs in
-    // dex' error
-    maybe_run("ReBindRefsPass");
-    // May need register allocation. Run InjectionIdLoweringPass too so
-    // RegAllocPass doesn't fail on injection-id opcodes
-    if (!m_mgr->regalloc_has_run()) {
-      maybe_run("IntrinsifyInjectionIdsPass");
-      maybe_run("InjectionIdLoweringPass");
-      maybe_run("RegAllocPass");
-    }
+    run_passes_required_for_output(m_mgr, stores, conf, m_run_interdex,
+                                   m_debug);
 
     // Ensure we do not wait for anything copied from the parent.
     m_open_jobs.clear();
@@ -827,11 +937,139 @@ class AfterPassSizes {
 #endif
 };
 
-void run_assessor(PassManager& pm, const Scope& scope, bool initially = false) {
+// Writes a snapshot of the stores after a configured pass, so that the
+// remaining passes can be resumed with redex-opt. The scope is not in a
+// writable state in the middle of the pipeline, so the work happens in a
+// forked child, which runs register allocation and then leaves the pass loop.
+// Passes run for that are dropped from the remaining passes.
+// The driver is expected to check `PassManager::get_checkpoint()` and dump the
+// intermediate dex and IR meta files.
+class PassCheckpoint {
+ private:
+  PassManager* m_mgr;
+  std::string m_after_pass;
+  std::string m_dir;
+  bool m_run_interdex{false};
+#ifdef __linux__
+  pid_t m_pid{-1};
+#endif
+
+ public:
+  PassCheckpoint(PassManager* mgr, const ConfigFiles& conf) : m_mgr(mgr) {
+    const auto& json = conf.get_json_config();
+    json.get("checkpoint_after_pass", "", m_after_pass);
+    json.get("checkpoint_dir", "", m_dir);
+    m_run_interdex = json.get("checkpoint_interdex", m_run_interdex);
+    if (!m_after_pass.empty() &&
+        m_after_pass.find('#') == std::string::npos) {
+      m_after_pass += "#1";
+    }
+    always_assert_log(m_after_pass.empty() || !m_dir.empty(),
+                      "checkpoint_after_pass requires checkpoint_dir");
+  }
+
+  bool handle(const PassManager::PassInfo* pass_info,
+              const std::vector<Pass*>& activated_passes,
+              DexStoresVector* stores,
+              ConfigFiles* conf,
+              boost::optional<PassManager::Checkpoint>* checkpoint) {
+    if (m_after_pass.empty() || pass_info->name != m_after_pass) {
+      return false;
+    }
+
+#ifdef __linux__
+    boost::filesystem::create_directories(m_dir);
+
+    auto thread_pool_instance = redex_thread_pool::ThreadPool::get_instance();
+    if (thread_pool_instance != nullptr) {
+      thread_pool_instance->join();
+    }
+
+    pid_t p = fork();
+
+    if (p < 0) {
+      std::cerr << "Fork failed!" << strerror(errno) << std::endl;
+      return false;
+    }
+
+    if (p > 0) {
+      // Parent (=this).
+      m_pid = p;
+      return false;
+    }
+
+    // Child.
+    std::cerr << "Writing checkpoint after " << pass_info->name << " to "
+              << m_dir << std::endl;
+    conf->set_outdir(m_dir);
+    set_abort_if_not_this_thread();
+
+    PassManager::Checkpoint result;
+    result.dir = m_dir;
+    result.after_pass = pass_info->name;
+    result.passes_run_for_output = run_passes_required_for_output(
+        m_mgr, stores, conf, m_run_interdex, /* debug */ false);
+
+    // The snapshot already reflects the passes that ran for output, so a
+    // resumed pipeline must not run them again.
+    auto already_run = result.passes_run_for_output;
+    for (size_t i = pass_info->order + 1; i < activated_passes.size(); ++i) {
+      const auto& name = activated_passes[i]->name();
+      auto it = std::find(already_run.begin(), already_run.end(), name);
+      if (it != already_run.end()) {
+        already_run.erase(it);
+        continue;
+      }
+      result.next_passes.push_back(name);
+    }
+
+    *checkpoint = std::move(result);
+    m_after_pass.clear();
+    return true;
+#else
+    (void)activated_passes;
+    (void)stores;
+    (void)conf;
+    (void)checkpoint;
+    fprintf(stderr, "Checkpoints are not supported on this platform\n");
+    return false;
+#endif
+  }
+
+  void wait() {
+#ifdef __linux__
+    if (m_pid < 0) {
+      return;
+    }
+    int stat;
+    pid_t wait_res;
+    for (;;) {
+      wait_res = waitpid(m_pid, &stat, 0);
+      if (wait_res != -1 || errno != EINTR) {
+        break;
+      }
+    }
+    if (wait_res == -1 || !WIFEXITED(stat) || WEXITSTATUS(stat) != 0) {
+      std::cerr << "Checkpoint child failed: " << std::hex << stat << std::dec
+                << std::endl;
+    }
+    m_pid = -1;
+#endif
+  }
+};
+
+void run_assessor(PassManager& pm,
+                  const Scope& scope,
+                  assessments::DexScopeAssessmentCache* cache,
+                  bool initially = false) {
   TRACE(PM, 2, "Running assessor...");
   Timer t("Assessor");
-  assessments::DexScopeAssessor assessor(scope);
+  assessments::DexScopeAssessor assessor(scope, cache);
   auto assessment = assessor.run();
+  if (cache != nullptr) {
+    TRACE(PM, 2, "Assessor cache: %zu hits, %zu misses", cache->hits(),
+          cache->misses());
+  }
   std::string prefix =
       std::string("~") + (initially ? "PRE" : "") + "assessment~";
   // log metric value in a way that fits into JSON number value
@@ -841,6 +1079,10 @@ void run_assessor(PassManager& pm, const Scope& scope, bool initially = false) {
 }
 
 namespace {
+// The pass on whose behalf a thread runs while read-only passes run
+// concurrently; null on all other threads. See PassManager::run_passes.
+thread_local PassManager::PassInfo* t_concurrent_pass_info{nullptr};
+
 // Return a set of the items denoted by the given input. Items will have
 // leading/trailing spaces trimmed.
 std::set<std::string_view> extract_delimited_items(const std::string& input,
@@ -1055,6 +1297,7 @@ struct JemallocStats {
   PassManager* pm;
   const ConfigFiles& c;
   bool full_stats{false};
+  bool purge_after_each_pass{false};
 
   JemallocStats(PassManager* pm, const ConfigFiles& c) : pm(pm), c(c) {
     const auto* pmc =
@@ -1063,6 +1306,17 @@ struct JemallocStats {
     redex_assert(pmc != nullptr);
 
     full_stats = pmc->jemalloc_full_stats;
+    purge_after_each_pass = pmc->purge_memory_after_each_pass;
+  }
+
+  // Memory freed by a pass otherwise stays mapped, so the RSS of later passes
+  // builds on the peak of earlier ones.
+  void maybe_purge_after_pass() {
+    if (!purge_after_each_pass) {
+      return;
+    }
+    auto released = jemalloc_util::purge_unused_memory();
+    pm->set_metric("~mem.purged_bytes", released);
   }
 
   void process_jemalloc_stats_for_pass(const Pass* pass, size_t run) {
@@ -1137,8 +1391,63 @@ std::unique_ptr<keep_rules::ProguardConfiguration> empty_pg_config() {
 
 struct PassManager::InternalFields {
   std::mutex m_metrics_lock;
+
+  // Metric increments of one thread, not yet added to the metrics of the pass
+  // they were made for. Only the owning thread updates them, so incrementing
+  // does not contend across threads; they are merged whenever metrics are
+  // read or set.
+  struct ThreadMetrics {
+    std::mutex mutex;
+    PassInfo* pass_info{nullptr};
+    std::unordered_map<std::string, int64_t> increments;
+  };
+
+  // Identifies this PassManager in the thread-local caches.
+  const uint64_t m_id{s_next_id.fetch_add(1) + 1};
+  std::mutex m_thread_metrics_lock;
+  std::unordered_map<std::thread::id, std::unique_ptr<ThreadMetrics>>
+      m_thread_metrics;
+
+  static std::atomic<uint64_t> s_next_id;
+
+  ThreadMetrics* get_thread_metrics() {
+    thread_local uint64_t cached_id{0};
+    thread_local ThreadMetrics* cached_metrics{nullptr};
+    if (cached_id != m_id) {
+      std::lock_guard<std::mutex> lock(m_thread_metrics_lock);
+      auto& metrics = m_thread_metrics[std::this_thread::get_id()];
+      if (!metrics) {
+        metrics = std::make_unique<ThreadMetrics>();
+      }
+      cached_id = m_id;
+      cached_metrics = metrics.get();
+    }
+    return cached_metrics;
+  }
+
+  // Requires the lock of the given thread metrics to be held.
+  void flush_locked(ThreadMetrics* thread_metrics) {
+    if (thread_metrics->increments.empty()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_metrics_lock);
+    for (auto& [key, value] : thread_metrics->increments) {
+      thread_metrics->pass_info->metrics[key] += value;
+    }
+    thread_metrics->increments.clear();
+  }
+
+  void merge_thread_metrics() {
+    std::lock_guard<std::mutex> lock(m_thread_metrics_lock);
+    for (auto& [_, thread_metrics] : m_thread_metrics) {
+      std::lock_guard<std::mutex> thread_lock(thread_metrics->mutex);
+      flush_locked(thread_metrics.get());
+    }
+  }
 };
 
+std::atomic<uint64_t> PassManager::InternalFields::s_next_id{0};
+
 PassManager::PassManager(const std::vector<Pass*>& passes)
     : PassManager(
           passes, ConfigFiles(Json::Value(Json::objectValue)), RedexOptions{}) {
@@ -1222,8 +1531,12 @@ hashing::DexHash PassManager::run_hasher(const char* pass_name,
   TRACE(PM, 2, "Running hasher...");
   Timer t("Hasher");
   auto timer = m_hashers_timer.scope();
-  hashing::DexScopeHasher hasher(scope);
+  hashing::DexScopeHasher hasher(scope, m_hash_cache.get());
   auto hash = hasher.run();
+  if (m_hash_cache) {
+    TRACE(PM, 2, "Hasher cache: %zu hits, %zu misses", m_hash_cache->hits(),
+          m_hash_cache->misses());
+  }
   if (pass_name) {
     // log metric value in a way that fits into JSON number value
     set_metric("~result~code~hash~",
@@ -1254,6 +1567,7 @@ void PassManager::eval_passes(DexStoresVector& stores, ConfigFiles& conf) {
     Timer t(pass->name() + " (eval)");
     m_current_pass_info = &m_pass_info[i];
     pass->eval_pass(stores, conf, *this);
+    m_internal_fields->merge_thread_metrics();
     m_current_pass_info = nullptr;
   }
 }
@@ -1294,6 +1608,15 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   }
   auto profiler_all_info =
       ScopedCommandProfiling::maybe_info_from_env("ALL_PASSES_");
+  auto sampling_profiler_options =
+      sampling_profiler::ScopedProfiling::maybe_options_from_env();
+  const Pass* sampling_profiler_pass = nullptr;
+  if (sampling_profiler_options && getenv("SAMPLING_PROFILE_PASS")) {
+    sampling_profiler_pass = find_pass(getenv("SAMPLING_PROFILE_PASS"));
+    always_assert_log(sampling_profiler_pass != nullptr,
+                      "Cannot find pass %s to profile",
+                      getenv("SAMPLING_PROFILE_PASS"));
+  }
 
   if (conf.force_single_dex()) {
     // Squash the dexes into one, so that the passes all see only one dex and
@@ -1306,6 +1629,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   // Clear stale data. Make sure we start fresh.
   m_preserved_analysis_passes.clear();
+  m_analysis_cache.clear();
 
   {
     Timer t("API Level Checker");
@@ -1334,6 +1658,10 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   // Retrieve the assessor's settings.
   const auto* assessor_config =
       conf.get_global_config().get_config_by_name<AssessorConfig>("assessor");
+  if (assessor_config->incremental) {
+    m_assessment_cache =
+        std::make_unique<assessments::DexScopeAssessmentCache>();
+  }
 
   // Retrieve the type checker's settings.
   bool relaxed_init_check = m_redex_options.min_sdk >= 21;
@@ -1345,6 +1673,9 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   conf.get_method_profiles();
 
   if (run_hasher_after_each_pass) {
+    if (conf.get_json_config()["hasher"].get("incremental", false).asBool()) {
+      m_hash_cache = std::make_unique<hashing::DexScopeHashCache>();
+    }
     m_initial_hash = run_hasher(nullptr, scope);
   }
 
@@ -1362,11 +1693,21 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       traceEnabled(STATS, 1) || conf.get_json_config().get("mem_stats", true);
   const bool hwm_per_pass =
       conf.get_json_config().get("mem_stats_per_pass", true);
+  // Polling the RSS gives the peak of each pass even where VmHWM cannot be
+  // reset.
+  size_t rss_sample_interval_ms = 0;
+  if (mem_pass_stats) {
+    conf.get_json_config().get("mem_stats_rss_sample_ms", (size_t)100,
+                               rss_sample_interval_ms);
+  }
+  const bool mem_stats_structures =
+      conf.get_json_config().get("mem_stats_structures", false);
 
   // Abort if the analysis pass dependencies are not satisfied.
   AnalysisUsage::check_dependencies(m_activated_passes);
 
   AfterPassSizes after_pass_size(this, conf);
+  PassCheckpoint checkpoint(this, conf);
 
   if (pm_config->check_pass_order_properties) {
     std::vector<std::pair<std::string, redex_properties::PropertyInteractions>>
@@ -1389,7 +1730,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   auto pre_pass_verifiers = [&](Pass* pass, size_t i) {
     if (i == 0 && assessor_config->run_initially) {
-      ::run_assessor(*this, scope, /* initially */ true);
+      ::run_assessor(*this, scope, m_assessment_cache.get(),
+                     /* initially */ true);
     }
   };
 
@@ -1441,7 +1783,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
             this->run_hasher(pass->name().c_str(), scope));
       }
       if (run_assessor) {
-        ::run_assessor(*this, scope);
+        ::run_assessor(*this, scope, m_assessment_cache.get());
         ScopedMetrics sm(*this);
         source_blocks::track_source_block_coverage(sm, stores);
       }
@@ -1450,7 +1792,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         // output phase -- the register allocator can fix it up later.
         checker_conf.check_no_overwrite_this(false)
             .validate_access(false)
-            .run_verifier(scope);
+            .run_verifier(scope, /* exit_on_fail= */ true,
+                          /* incremental= */ true);
       }
       auto timer = m_check_unique_deobfuscateds_timer.scope();
       check_unique_deobfuscated.run_after_pass(pass, scope);
@@ -1475,6 +1818,21 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   std::unordered_map<const Pass*, size_t> runs;
 
+  // Consecutive passes that declare themselves read-only run concurrently,
+  // unless something has to attribute resources to them one at a time.
+  auto runs_concurrently = [&](size_t i) {
+    Pass* pass = m_activated_passes[i];
+    size_t pass_num_threads{0};
+    m_pass_info[i].config.get("num_threads", (size_t)0, pass_num_threads);
+    return pass->is_read_only() && !pass->is_cfg_legacy() &&
+           pass_num_threads == 0 && pass != profiler_info_pass &&
+           pass != m_malloc_profile_pass && pass != sampling_profiler_pass;
+  };
+  // Passes up to this index already ran along with an earlier one; if they
+  // threw, the exception is rethrown in their own iteration.
+  size_t concurrent_end{0};
+  std::vector<std::exception_ptr> concurrent_errors(m_activated_passes.size());
+
   /////////////////////
   // MAIN PASS LOOP. //
   /////////////////////
@@ -1483,7 +1841,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
     const size_t pass_run = ++runs[pass];
-    AnalysisUsageHelper analysis_usage_helper{m_preserved_analysis_passes};
+    AnalysisUsageHelper analysis_usage_helper{m_preserved_analysis_passes,
+                                              m_analysis_cache};
     analysis_usage_helper.pre_pass(pass);
 
     if (!after_interdex && pass->name() == "InterDexPass") {
@@ -1492,6 +1851,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
     TRACE(PM, 1, "Running %s...", pass->name().c_str());
     ScopedMemStats scoped_mem_stats{mem_pass_stats, hwm_per_pass};
+    memory_attribution::ScopedRssPeakSampler rss_peak_sampler{
+        rss_sample_interval_ms};
     Timer t(pass->name() + " " + std::to_string(pass_run) + " (run)");
     m_current_pass_info = &m_pass_info[i];
 
@@ -1499,6 +1860,11 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
     double cpu_time;
     std::chrono::duration<double> wall_time;
+    // Busy time of the busiest work queue thread, and the sum over all of
+    // them. Comparing against wall and CPU time tells whether a pass is
+    // effectively serial or suffers from a long tail.
+    double max_thread_busy_time{0};
+    double sum_thread_busy_time{0};
 
     {
       auto scoped_command_prof = profiler_info_pass == pass
@@ -1508,10 +1874,21 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       auto scoped_command_all_prof = ScopedCommandProfiling::maybe_from_info(
           profiler_all_info, &pass->name());
       jemalloc_util::ScopedProfiling malloc_prof(m_malloc_profile_pass == pass);
+      // Profiles are named like `ConstantPropagationPass.2.prof` for the
+      // second run of a pass.
+      boost::optional<sampling_profiler::ScopedProfiling> sampling_prof;
+      if (sampling_profiler_options &&
+          (sampling_profiler_pass == nullptr ||
+           sampling_profiler_pass == pass)) {
+        sampling_prof.emplace(*sampling_profiler_options,
+                              pass->name() + "." + std::to_string(pass_run));
+      }
       auto maybe_track_violations =
           violatios_tracking.maybe_track(this, stores);
       double cpu_time_start = ((double)std::clock()) / CLOCKS_PER_SEC;
       auto wall_time_start = std::chrono::steady_clock::now();
+      auto busy_times_start = redex_parallel::get_busy_times_us();
+      auto cfg_cycles_start = IRCode::get_cfg_cycle_counts();
       if (pass->is_cfg_legacy()) {
         // if this pass hasn't been updated to editable_cfg yet, clear_cfg. In
         // the future, once all editable cfg updates are done, this branch will
@@ -1528,9 +1905,65 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         ensure_editable_cfg(stores);
         TRACE(PM, 2, "%s Pass uses editable cfg.\n", SHOW(pass->name()));
       }
-      pass->run_pass(stores, conf, *this);
+      if (i < concurrent_end) {
+        // Already ran with the first pass of its read-only group.
+        if (concurrent_errors[i]) {
+          std::rethrow_exception(concurrent_errors[i]);
+        }
+      } else {
+        size_t group_end = i + 1;
+        if (runs_concurrently(i)) {
+          while (group_end < m_activated_passes.size() &&
+                 runs_concurrently(group_end)) {
+            ++group_end;
+          }
+        }
+        // The futures wait for their passes even if this one throws.
+        std::vector<std::future<void>> concurrent;
+        for (size_t j = i + 1; j < group_end; ++j) {
+          TRACE(PM, 1, "Running %s concurrently...",
+                m_activated_passes[j]->name().c_str());
+          concurrent.push_back(std::async(std::launch::async, [&, j]() {
+            t_concurrent_pass_info = &m_pass_info[j];
+            m_activated_passes[j]->run_pass(stores, conf, *this);
+          }));
+        }
+        concurrent_end = group_end;
+        {
+          // E.g. passes that do not scale past one NUMA node may ask for
+          // fewer threads than there are cores.
+          size_t pass_num_threads{0};
+          m_current_pass_info->config.get("num_threads", (size_t)0,
+                                          pass_num_threads);
+          boost::optional<redex_parallel::ScopedDefaultNumThreads>
+              scoped_num_threads;
+          if (pass_num_threads != 0) {
+            scoped_num_threads.emplace(pass_num_threads);
+          }
+          pass->run_pass(stores, conf, *this);
+        }
+        for (size_t j = i + 1; j < group_end; ++j) {
+          try {
+            concurrent[j - i - 1].get();
+          } catch (...) {
+            concurrent_errors[j] = std::current_exception();
+          }
+        }
+      }
+      m_internal_fields->merge_thread_metrics();
       auto wall_time_end = std::chrono::steady_clock::now();
       double cpu_time_end = ((double)std::clock()) / CLOCKS_PER_SEC;
+      {
+        auto busy_times_end = redex_parallel::get_busy_times_us();
+        for (size_t t = 0; t < busy_times_end.size(); ++t) {
+          auto busy_us =
+              busy_times_end[t] -
+              (t < busy_times_start.size() ? busy_times_start[t] : 0);
+          max_thread_busy_time =
+              std::max(max_thread_busy_time, busy_us / 1000000.0);
+          sum_thread_busy_time += busy_us / 1000000.0;
+        }
+      }
 
       // Collect dex info metrics after InterDexPass.
       if (after_interdex) {
@@ -1580,6 +2013,13 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
           code.cfg().simplify();
         });
       }
+      // CFGs are kept across passes, so these only count the cycles caused by
+      // the pass itself, including the linearization before a legacy pass.
+      auto cfg_cycles_end = IRCode::get_cfg_cycle_counts();
+      set_metric("~cfg.builds",
+                 cfg_cycles_end.builds - cfg_cycles_start.builds);
+      set_metric("~cfg.linearizations", cfg_cycles_end.linearizations -
+                                            cfg_cycles_start.linearizations);
 
       g_redex->compact();
 
@@ -1590,7 +2030,15 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     }
 
     scoped_mem_stats.trace_log(this, pass);
+    if (rss_sample_interval_ms != 0) {
+      set_metric("vm_rss_peak", rss_peak_sampler.get_peak());
+    }
+    if (mem_stats_structures) {
+      memory_attribution::report_structure_sizes(stores, *this);
+      set_metric("~mem.analysis_cache.entries", m_analysis_cache.size());
+    }
 
+    jemalloc_stats.maybe_purge_after_pass();
     jemalloc_stats.process_jemalloc_stats_for_pass(pass, pass_run);
 
     sanitizers::lsan_do_recoverable_leak_check();
@@ -1609,8 +2057,27 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       break;
     }
 
+    handled_child = checkpoint.handle(m_current_pass_info, m_activated_passes,
+                                      &stores, &conf, &m_checkpoint);
+    if (handled_child) {
+      // Checkpoint child. Return to write the snapshot out.
+      break;
+    }
+
     set_metric("timing.cpu_time.100", (int64_t)(cpu_time * 100));
     set_metric("timing.wall_time.100", (int64_t)(wall_time.count() * 100));
+    set_metric("timing.max_thread_busy_time.100",
+               (int64_t)(max_thread_busy_time * 100));
+    set_metric("timing.sum_thread_busy_time.100",
+               (int64_t)(sum_thread_busy_time * 100));
+    {
+      // Also surface these in the "time_stats" of redex-stats.json, next to
+      // the wall time recorded by the pass timer.
+      auto timer_prefix = pass->name() + " " + std::to_string(pass_run);
+      Timer::add_timer(timer_prefix + " (cpu)", cpu_time);
+      Timer::add_timer(timer_prefix + " (max thread busy)",
+                       max_thread_busy_time);
+    }
     if (wall_time.count() != 0) {
       set_metric("timing.speedup.100",
                  (int64_t)(100.0 * cpu_time / wall_time.count()));
@@ -1623,6 +2090,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   }
 
   after_pass_size.wait();
+  checkpoint.wait();
+  m_analysis_cache.clear();
 
   // Always clear cfg and run the type checker before generating the optimized
   // dex code.
@@ -1753,29 +2222,50 @@ Pass* PassManager::find_pass(const std::string& pass_name) const {
   return pass_it != m_activated_passes.end() ? *pass_it : nullptr;
 }
 
+PassManager::PassInfo* PassManager::current_pass_info() const {
+  return t_concurrent_pass_info != nullptr ? t_concurrent_pass_info
+                                           : m_current_pass_info;
+}
+
+const PassManager::PassInfo* PassManager::get_current_pass_info() const {
+  return current_pass_info();
+}
+
 void PassManager::incr_metric(const std::string& key, int64_t value) {
-  always_assert_log(m_current_pass_info != nullptr, "No current pass!");
-  std::unique_lock<std::mutex> lock{m_internal_fields->m_metrics_lock};
-  (m_current_pass_info->metrics)[key] += value;
+  auto* pass_info = current_pass_info();
+  always_assert_log(pass_info != nullptr, "No current pass!");
+  auto* thread_metrics = m_internal_fields->get_thread_metrics();
+  std::lock_guard<std::mutex> lock(thread_metrics->mutex);
+  if (thread_metrics->pass_info != pass_info) {
+    m_internal_fields->flush_locked(thread_metrics);
+    thread_metrics->pass_info = pass_info;
+  }
+  thread_metrics->increments[key] += value;
 }
 
 void PassManager::set_metric(const std::string& key, int64_t value) {
-  always_assert_log(m_current_pass_info != nullptr, "No current pass!");
+  auto* pass_info = current_pass_info();
+  always_assert_log(pass_info != nullptr, "No current pass!");
+  m_internal_fields->merge_thread_metrics();
   std::unique_lock<std::mutex> lock{m_internal_fields->m_metrics_lock};
-  (m_current_pass_info->metrics)[key] = value;
+  (pass_info->metrics)[key] = value;
 }
 
 int64_t PassManager::get_metric(const std::string& key) {
+  auto* pass_info = current_pass_info();
+  m_internal_fields->merge_thread_metrics();
   std::unique_lock<std::mutex> lock{m_internal_fields->m_metrics_lock};
-  return (m_current_pass_info->metrics)[key];
+  return (pass_info->metrics)[key];
 }
 
 const std::vector<PassManager::PassInfo>& PassManager::get_pass_info() const {
+  m_internal_fields->merge_thread_metrics();
   return m_pass_info;
 }
 
 const std::unordered_map<std::string, int64_t>&
 PassManager::get_interdex_metrics() {
+  m_internal_fields->merge_thread_metrics();
   for (const auto& pass_info : m_pass_info) {
     if (pass_info.pass->name() == "InterDexPass") {
       return pass_info.metrics;
@@ -18,6 +18,7 @@
 
 #include "AnalysisUsage.h"
 #include "AssetManager.h"
+#include "DexAssessments.h"
 #include "DexHasher.h"
 #include "JsonWrapper.h"
 #include "RedexOptions.h"
@@ -78,6 +79,9 @@ class PassManager {
   };
 
   void run_passes(DexStoresVector&, ConfigFiles&);
+  // Increments are buffered per thread, so this is cheap to call from
+  // parallel workers; they are added to the metrics of the current pass
+  // whenever metrics are read or set, and when the pass finishes.
   void incr_metric(const std::string& key, int64_t value);
   void set_metric(const std::string& key, int64_t value);
   int64_t get_metric(const std::string& key);
@@ -98,7 +102,9 @@ class PassManager {
   // do not use ProGuard configuration keep rules.
   void set_testing_mode() { m_testing_mode = true; }
 
-  const PassInfo* get_current_pass_info() const { return m_current_pass_info; }
+  // While read-only passes run concurrently, this is the pass that the calling
+  // thread runs.
+  const PassInfo* get_current_pass_info() const;
 
   AssetManager& asset_manager() { return m_asset_mgr; }
 
@@ -138,6 +144,21 @@ class PassManager {
     return nullptr;
   }
 
+  // Returns the cached instance of an analysis, building it with `build` if
+  // there is none. See AnalysisCache.
+  template <typename Analysis, typename Build>
+  std::shared_ptr<const Analysis> get_cached_analysis(const Build& build) {
+    return m_analysis_cache.get<Analysis>(build);
+  }
+
+  // Like get_cached_analysis, for analyses that survive all passes as they
+  // detect changes by themselves. See AnalysisCache.
+  template <typename Analysis, typename Build>
+  std::shared_ptr<const Analysis> get_self_validating_analysis(
+      const Build& build) {
+    return m_analysis_cache.get_self_validating<Analysis>(build);
+  }
+
   Pass* find_pass(const std::string& pass_name) const;
 
   struct ActivatedPasses {
@@ -159,6 +180,20 @@ class PassManager {
 
   ReserveRefsInfo get_reserved_refs() const;
 
+  // Describes the snapshot a forked child is expected to write when
+  // `checkpoint_after_pass` is configured. Only set in that child.
+  struct Checkpoint {
+    std::string dir;
+    std::string after_pass;
+    // The passes that ran after `after_pass` to make the snapshot writable,
+    // e.g. RegAllocPass. They are not repeated in `next_passes`.
+    std::vector<std::string> passes_run_for_output;
+    std::vector<std::string> next_passes;
+  };
+  const boost::optional<Checkpoint>& get_checkpoint() const {
+    return m_checkpoint;
+  }
+
   // FOR TESTING ONLY!
   void disable_checker() { m_checker_disabled = true; }
 
@@ -173,10 +208,13 @@ class PassManager {
 
   void check_unreleased_reserved_refs();
 
+  PassInfo* current_pass_info() const;
+
   AssetManager m_asset_mgr;
   std::vector<Pass*> m_registered_passes;
   std::vector<Pass*> m_activated_passes;
   std::unordered_map<AnalysisID, Pass*> m_preserved_analysis_passes;
+  AnalysisCache m_analysis_cache;
 
   // Per-pass information and metrics
   std::vector<PassManager::PassInfo> m_pass_info;
@@ -195,6 +233,8 @@ class PassManager {
   Pass* m_malloc_profile_pass{nullptr};
 
   boost::optional<hashing::DexHash> m_initial_hash;
+  std::unique_ptr<hashing::DexScopeHashCache> m_hash_cache;
+  std::unique_ptr<assessments::DexScopeAssessmentCache> m_assessment_cache;
 
   std::vector<std::unique_ptr<Pass>> m_cloned_passes;
 
@@ -205,4 +245,6 @@ class PassManager {
   redex_properties::Manager* m_properties_manager{nullptr};
 
   bool m_checker_disabled{false};
+
+  boost::optional<Checkpoint> m_checkpoint;
 };
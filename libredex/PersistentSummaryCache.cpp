@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PersistentSummaryCache.h"
+
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "Debug.h"
+#include "Sha1.h"
+#include "Trace.h"
+
+namespace {
+
+constexpr const char* VERSION_TAG = "version";
+
+} // namespace
+
+PersistentSummaryCache::PersistentSummaryCache(const std::string& dir,
+                                               const std::string& name,
+                                               const std::string& version)
+    : m_path((boost::filesystem::path(dir) / (name + ".cache")).string()),
+      m_version(version) {
+  std::ifstream input(m_path);
+  if (!input) {
+    TRACE(LIB, 1, "No summary cache at %s", m_path.c_str());
+    return;
+  }
+  sparta::s_expr_istream s_expr_input(input);
+  sparta::s_expr header;
+  s_expr_input >> header;
+  if (s_expr_input.fail() || !header.is_list() || header.size() != 2 ||
+      !header[0].is_string() || header[0].get_string() != VERSION_TAG ||
+      !header[1].is_string() || header[1].get_string() != m_version) {
+    TRACE(LIB, 1, "Ignoring outdated summary cache at %s", m_path.c_str());
+    return;
+  }
+  while (s_expr_input.good()) {
+    sparta::s_expr entry;
+    s_expr_input >> entry;
+    if (s_expr_input.eoi()) {
+      break;
+    }
+    if (s_expr_input.fail() || !entry.is_list() || entry.size() != 2 ||
+        !entry[0].is_string()) {
+      // A truncated file, e.g. from an interrupted build. Whatever could not
+      // be read will just be recomputed.
+      TRACE(LIB, 1, "Malformed summary cache at %s: %s", m_path.c_str(),
+            s_expr_input.what().c_str());
+      break;
+    }
+    m_loaded.emplace(entry[0].get_string(), entry[1]);
+  }
+  TRACE(LIB, 1, "Loaded %zu entries from summary cache at %s", m_loaded.size(),
+        m_path.c_str());
+}
+
+std::string PersistentSummaryCache::make_key(const std::string& content) {
+  Sha1Context context;
+  sha1_init(&context);
+  sha1_update(&context,
+              reinterpret_cast<const unsigned char*>(content.data()),
+              content.size());
+  unsigned char digest[20];
+  sha1_final(digest, &context);
+  std::string key;
+  key.reserve(2 * sizeof(digest));
+  constexpr const char* HEX_DIGITS = "0123456789abcdef";
+  for (auto byte : digest) {
+    key += HEX_DIGITS[byte >> 4];
+    key += HEX_DIGITS[byte & 0xf];
+  }
+  return key;
+}
+
+std::optional<sparta::s_expr> PersistentSummaryCache::get_s_expr(
+    const std::string& key) {
+  auto it = m_loaded.find(key);
+  if (it == m_loaded.end()) {
+    m_misses++;
+    return std::nullopt;
+  }
+  m_hits++;
+  m_used.emplace(key, it->second);
+  return it->second;
+}
+
+void PersistentSummaryCache::put_s_expr(const std::string& key,
+                                        sparta::s_expr s_expr) {
+  m_used.insert_or_assign(std::make_pair(key, std::move(s_expr)));
+}
+
+void PersistentSummaryCache::save() const {
+  std::map<std::string, sparta::s_expr> ordered(m_used.begin(), m_used.end());
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(
+      boost::filesystem::path(m_path).parent_path(), ec);
+  // Write to a temporary file first, so that an interrupted build never
+  // leaves a partial cache behind.
+  auto tmp_path = m_path + ".tmp";
+  {
+    std::ofstream output(tmp_path);
+    if (!output) {
+      TRACE(LIB, 1, "Cannot write summary cache at %s", m_path.c_str());
+      return;
+    }
+    output << sparta::s_expr({sparta::s_expr(VERSION_TAG),
+                              sparta::s_expr(m_version)})
+           << std::endl;
+    for (const auto& [key, s_expr] : ordered) {
+      output << sparta::s_expr({sparta::s_expr(key), s_expr}) << std::endl;
+    }
+  }
+  always_assert_log(std::rename(tmp_path.c_str(), m_path.c_str()) == 0,
+                    "Cannot move %s to %s", tmp_path.c_str(), m_path.c_str());
+  TRACE(LIB, 1, "Saved %zu entries to summary cache at %s", ordered.size(),
+        m_path.c_str());
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <sparta/S_Expression.h>
+
+#include "ConcurrentContainers.h"
+
+/*
+ * A content-addressed store of method summaries that persists across builds.
+ *
+ * Entries are keyed by a digest (see make_key()) of everything that goes into
+ * the computation of a summary, typically the hash of the method itself (see
+ * hashing::DexMethodHasher) and the summaries of its callees. Unchanged
+ * methods of a later build thus find the summaries of an earlier build, while
+ * any change to a method, or to what it depends on, simply leads to a
+ * different key. There is no explicit invalidation: save() only writes back
+ * the entries that were looked up or added since the cache was loaded, which
+ * drops the entries of methods that changed or went away.
+ *
+ * Summaries are stored as s-expressions, so any summary type providing the
+ * to_s_expr() / from_s_expr() pair used by summary_serialization can be
+ * cached.
+ */
+class PersistentSummaryCache final {
+ public:
+  // Loads `<dir>/<name>.cache`, unless it is missing or was written with a
+  // different `version`. The version should be bumped whenever the analysis
+  // changes in a way that affects its summaries.
+  PersistentSummaryCache(const std::string& dir,
+                         const std::string& name,
+                         const std::string& version);
+
+  // Returns the hex-encoded SHA1 digest of `content`.
+  static std::string make_key(const std::string& content);
+
+  template <typename Summary>
+  std::optional<Summary> get(const std::string& key) {
+    auto s_expr = get_s_expr(key);
+    if (!s_expr) {
+      return std::nullopt;
+    }
+    return Summary::from_s_expr(*s_expr);
+  }
+
+  template <typename Summary>
+  void put(const std::string& key, const Summary& summary) {
+    put_s_expr(key, to_s_expr(summary));
+  }
+
+  // Writes back all entries that were looked up or added. Entries are written
+  // in key order, so that the cache file is deterministic.
+  void save() const;
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  std::optional<sparta::s_expr> get_s_expr(const std::string& key);
+  void put_s_expr(const std::string& key, sparta::s_expr s_expr);
+
+  std::string m_path;
+  std::string m_version;
+  // Only written while loading, and thus safe to read concurrently.
+  std::unordered_map<std::string, sparta::s_expr> m_loaded;
+  ConcurrentMap<std::string, sparta::s_expr> m_used;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
@@ -13,7 +13,10 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <thread>
 #include <vector>
@@ -30,21 +33,62 @@
  *
  * The thread-pool must be initialized with a positive number of threads to be
  * functional.
+ *
+ * With many threads, a single queue guarded by a single lock becomes a
+ * bottleneck when many small work items become ready at the same time. So
+ * pending work items are spread over several shards, each with its own lock.
+ * Work items are posted to the shard of the posting worker thread (or to the
+ * shards in round-robin fashion when posted from other threads), and idle
+ * workers take the highest-priority work item of whichever shard currently
+ * has the highest-priority work item. Priorities are thus only approximately
+ * respected across shards, but exactly within a shard; with up to
+ * THREADS_PER_SHARD threads, there is just one shard.
  */
 class PriorityThreadPool {
+ public:
+  static constexpr size_t THREADS_PER_SHARD = 8;
+
  private:
+  struct alignas(64) Shard {
+    // Guards pending_work_items.
+    std::mutex mutex;
+    std::map<int, std::queue<std::function<void()>>> pending_work_items;
+    // Mirrors of the size and the highest priority of the pending work items,
+    // so that idle workers can pick a shard without locking all shards.
+    std::atomic<size_t> size{0};
+    std::atomic<int> top_priority{0};
+  };
+
   std::vector<boost::thread> m_pool;
   size_t m_threads{0};
-  // The following data structures are guarded by this mutex.
+  std::unique_ptr<Shard[]> m_shards;
+  size_t m_num_shards{0};
+  std::atomic<size_t> m_next_shard{0};
+  std::atomic<size_t> m_next_worker{0};
+  // Pending work items are counted when posted, before they are added to a
+  // shard, and running work items are counted before they are removed from
+  // a shard, so that the pool never appears to be done while there is work,
+  // provided that the pending count is read before the running count.
+  std::atomic<size_t> m_pending_work_items{0};
+  std::atomic<size_t> m_running_work_items{0};
+  std::atomic<size_t> m_sleeping{0};
+  std::atomic<bool> m_shutdown{false};
+  // The following data structures are guarded by this mutex, which is also
+  // held when waiting for or signaling any of the conditions.
   std::mutex m_mutex;
   size_t m_running{0};
   std::condition_variable m_work_condition;
   std::condition_variable m_done_condition;
   std::condition_variable m_not_running_condition;
-  std::map<int, std::queue<std::function<void()>>> m_pending_work_items;
-  std::atomic<size_t> m_running_work_items{0};
   std::chrono::duration<double> m_waited_time{0};
-  bool m_shutdown{false};
+
+  // Identifies the worker threads of a pool. Zero-initialized, as it is a
+  // thread-local variable.
+  struct WorkerIdentity {
+    const PriorityThreadPool* pool;
+    size_t index;
+  };
+  static inline thread_local WorkerIdentity s_worker;
 
  public:
   // Creates an instance with a default number of threads
@@ -58,7 +102,7 @@ class PriorityThreadPool {
   ~PriorityThreadPool() {
     // If the pool was created (>0 threads), `join` must be manually called
     // before the executor may be destroyed.
-    always_assert(m_pending_work_items.empty());
+    always_assert(m_pending_work_items == 0);
     if (m_threads > 0) {
       always_assert(m_shutdown);
       always_assert(m_running_work_items == 0);
@@ -84,6 +128,9 @@ class PriorityThreadPool {
       return;
     }
 
+    m_num_shards = (num_threads + THREADS_PER_SHARD - 1) / THREADS_PER_SHARD;
+    m_shards = std::make_unique<Shard[]>(m_num_shards);
+
     sparta::AsyncRunner* async_runner =
         redex_thread_pool::ThreadPool::get_instance();
     if (async_runner) {
@@ -104,10 +151,21 @@ class PriorityThreadPool {
   // Post a work item with a priority. This method is thread safe.
   void post(int priority, const std::function<void()>& f) {
     always_assert(m_threads > 0);
-    std::unique_lock<std::mutex> lock{m_mutex};
     always_assert(!m_shutdown);
-    m_pending_work_items[priority].push(f);
-    m_work_condition.notify_one();
+    m_pending_work_items++;
+    {
+      auto& shard = m_shards[get_home_shard()];
+      std::unique_lock<std::mutex> lock{shard.mutex};
+      shard.pending_work_items[priority].push(f);
+      shard.size.store(shard.size.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+      shard.top_priority.store(shard.pending_work_items.rbegin()->first,
+                               std::memory_order_relaxed);
+    }
+    if (m_sleeping > 0) {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_work_condition.notify_one();
+    }
   }
 
   // Wait for all work items to be processed.
@@ -117,9 +175,7 @@ class PriorityThreadPool {
     {
       // We wait until *all* work is done, i.e. nothing is running or pending.
       std::unique_lock<std::mutex> lock{m_mutex};
-      m_done_condition.wait(lock, [&]() {
-        return m_running_work_items == 0 && m_pending_work_items.empty();
-      });
+      m_done_condition.wait(lock, [&]() { return is_done(); });
       if (init_shutdown) {
         m_shutdown = true;
         m_work_condition.notify_all();
@@ -150,51 +206,91 @@ class PriorityThreadPool {
   }
 
  private:
+  bool is_done() const {
+    // A work item that is no longer pending is already counted as running,
+    // so pending must be read first. In the other order, a work item could be
+    // taken between the two reads and be missed by both.
+    return m_pending_work_items == 0 && m_running_work_items == 0;
+  }
+
+  size_t get_home_shard() {
+    if (s_worker.pool == this) {
+      return s_worker.index % m_num_shards;
+    }
+    return m_next_shard.fetch_add(1, std::memory_order_relaxed) % m_num_shards;
+  }
+
+  // Takes the highest-priority work item of the shard which, as far as can be
+  // told without locking, has the highest-priority work item.
+  std::optional<std::function<void()>> try_take_work_item() {
+    auto home = get_home_shard();
+    Shard* best = nullptr;
+    int best_priority{0};
+    for (size_t i = 0; i < m_num_shards; ++i) {
+      auto& shard = m_shards[(home + i) % m_num_shards];
+      if (shard.size.load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      auto priority = shard.top_priority.load(std::memory_order_relaxed);
+      if (best == nullptr || priority > best_priority) {
+        best = &shard;
+        best_priority = priority;
+      }
+    }
+    if (best == nullptr) {
+      return std::nullopt;
+    }
+    std::unique_lock<std::mutex> lock{best->mutex};
+    if (best->pending_work_items.empty()) {
+      return std::nullopt;
+    }
+    m_running_work_items++;
+    const auto& p_it = std::prev(best->pending_work_items.end());
+    auto& queue = p_it->second;
+    auto f = std::move(queue.front());
+    queue.pop();
+    if (queue.empty()) {
+      best->pending_work_items.erase(p_it);
+    }
+    best->size.store(best->size.load(std::memory_order_relaxed) - 1,
+                     std::memory_order_relaxed);
+    if (!best->pending_work_items.empty()) {
+      best->top_priority.store(best->pending_work_items.rbegin()->first,
+                               std::memory_order_relaxed);
+    }
+    m_pending_work_items--;
+    return f;
+  }
+
   void run() {
+    s_worker = WorkerIdentity{this, m_next_worker++};
     auto not_running = [&]() {
+      s_worker = WorkerIdentity{};
       std::unique_lock<std::mutex> lock{m_mutex};
       if (--m_running == 0) {
         m_not_running_condition.notify_one();
       }
     };
 
-    for (bool first = true;; first = false) {
-      auto highest_priority_f = [&]() -> std::optional<std::function<void()>> {
+    for (;;) {
+      auto highest_priority_f = try_take_work_item();
+      if (!highest_priority_f) {
         std::unique_lock<std::mutex> lock{m_mutex};
-
-        // Notify when *all* work is done, i.e. nothing is running or pending.
-        //
-        // Moving this check here from the end of the loop avoids
-        // potential repeated lock acquisition.
-        if (!first && m_pending_work_items.empty() &&
-            m_running_work_items == 0) {
-          m_done_condition.notify_one();
+        // Wait for work or shutdown. Announcing that we are sleeping before
+        // checking for pending work ensures that concurrent posters notice
+        // us, and their notification is delivered while we are waiting.
+        m_sleeping++;
+        m_work_condition.wait(
+            lock, [&]() { return m_pending_work_items > 0 || m_shutdown; });
+        m_sleeping--;
+        if (m_pending_work_items == 0 && m_shutdown) {
+          lock.unlock();
+          not_running();
+          return;
         }
-
-        // Wait for work or shutdown.
-        m_work_condition.wait(lock, [&]() {
-          return !m_pending_work_items.empty() || m_shutdown;
-        });
-        if (m_pending_work_items.empty()) {
-          redex_assert(m_shutdown);
-          return std::nullopt;
-        }
-
-        m_running_work_items++;
-
-        // Find work item with highest priority
-        const auto& p_it = std::prev(m_pending_work_items.end());
-        auto& queue = p_it->second;
-        auto f = queue.front();
-        queue.pop();
-        if (queue.empty()) {
-          m_pending_work_items.erase(p_it);
-        }
-        return f;
-      }();
-      if (!highest_priority_f) {
-        not_running();
-        return;
+        // Some work item is pending, though it may not have been added to its
+        // shard yet, or another worker may have taken it already.
+        continue;
       }
 
       // Run!
@@ -206,7 +302,11 @@ class PriorityThreadPool {
         throw;
       }
 
-      --m_running_work_items;
+      // Notify when *all* work is done, i.e. nothing is running or pending.
+      if (--m_running_work_items == 0 && m_pending_work_items == 0) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_done_condition.notify_all();
+      }
     }
   }
 };
@@ -7,7 +7,9 @@
 
 #include "ProguardMap.h"
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 
 #include "DexPosition.h"
 #include "DexUtil.h"
@@ -226,20 +228,41 @@ ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
 
   if (use_new_rename_map) {
     parse_full_map(fp);
-  } else {
-    parse_proguard_map(fp);
+    return;
+  }
+  fp.seekg(0, std::ios::end);
+  if (fp.tellg() <= 0) {
+    // Empty files cannot be mapped.
+    return;
   }
+  fp.close();
+  m_mapped_file =
+      std::make_unique<RedexMappedFile>(RedexMappedFile::open(filename));
+  m_data = std::string_view(m_mapped_file->const_data(), m_mapped_file->size());
+  index_proguard_map();
+}
+
+ProguardMap::ProguardMap(std::istream& is) {
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  m_contents = ss.str();
+  m_data = m_contents;
+  index_proguard_map();
 }
 
+ProguardMap::~ProguardMap() = default;
+
 std::string ProguardMap::translate_class(const std::string& cls) const {
   return find_or_same(cls, m_classMap);
 }
 
 std::string ProguardMap::translate_field(const std::string& field) const {
+  parse_translations();
   return find_or_same(field, m_fieldMap);
 }
 
 std::string ProguardMap::translate_method(const std::string& method) const {
+  parse_translations();
   return find_or_same(method, m_methodMap);
 }
 
@@ -248,20 +271,24 @@ std::string ProguardMap::deobfuscate_class(const std::string& cls) const {
 }
 
 std::string ProguardMap::deobfuscate_field(const std::string& field) const {
-  return find_or_same(find_or_same(field, m_obfFieldMap), m_obfUntypedFieldMap);
+  const auto& members = obfuscated_members(field);
+  return find_or_same(find_or_same(field, members.fields),
+                      members.untyped_fields);
 }
 
 std::string ProguardMap::deobfuscate_method(const std::string& method) const {
-  return find_or_same(find_or_same(method, m_obfMethodMap),
-                      m_obfUntypedMethodMap);
+  const auto& members = obfuscated_members(method);
+  return find_or_same(find_or_same(method, members.methods),
+                      members.untyped_methods);
 }
 
 std::vector<ProguardMap::Frame> ProguardMap::deobfuscate_frame(
     const DexString* method_name, uint32_t line) const {
   std::vector<Frame> frames;
-  auto ranges_it = m_obfMethodLinesMap.find(
+  const auto& members = obfuscated_members(method_name->str());
+  auto ranges_it = members.method_lines.find(
       str_copy(pg_impl::lines_key(method_name->str())));
-  if (ranges_it != m_obfMethodLinesMap.end()) {
+  if (ranges_it != members.method_lines.end()) {
     for (const auto& range : ranges_it->second) {
       if (!range->matches(line)) {
         continue;
@@ -285,34 +312,133 @@ std::vector<ProguardMap::Frame> ProguardMap::deobfuscate_frame(
 
 ProguardLineRangeVector& ProguardMap::method_lines(
     const std::string& obfuscated_method) {
-  return m_obfMethodLinesMap.at(
+  auto* cls = find_obfuscated_class(obfuscated_method);
+  auto& members = cls != nullptr ? parse_obfuscated_members(cls) : m_obfMembers;
+  return members.method_lines.at(
       str_copy(pg_impl::lines_key(obfuscated_method)));
 }
 
-void ProguardMap::parse_proguard_map(std::istream& fp) {
+template <typename Fn>
+void ProguardMap::for_each_line(const Section& section, const Fn& fn) const {
   std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
+  size_t pos = section.begin;
+  while (pos < section.end) {
+    auto eol = std::min(m_data.find('\n', pos), section.end);
+    line.assign(m_data.data() + pos, eol - pos);
+    fn(line);
+    pos = eol + 1;
   }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
+}
+
+void ProguardMap::index_proguard_map() {
+  std::string line;
+  size_t pos = 0;
+  while (pos < m_data.size()) {
+    auto eol = std::min(m_data.find('\n', pos), m_data.size());
+    line.assign(m_data.data() + pos, eol - pos);
+    auto next = std::min(eol + 1, m_data.size());
     if (parse_class(line)) {
-      continue;
+      if (!m_sections.empty()) {
+        m_sections.back().end = pos;
+      }
+      m_sections.push_back(Section{m_currClass, m_currNewClass, next, next});
+    } else if (m_sections.empty()) {
+      // Not attributed to any class, so only check that it is well-formed.
+      parse_member(line, Section{}, nullptr, false);
+    } else if (!comment(line)) {
+      m_has_members = true;
     }
-    if (parse_field(line)) {
-      continue;
+    pos = next;
+  }
+  if (!m_sections.empty()) {
+    m_sections.back().end = m_data.size();
+  }
+
+  std::unordered_map<std::string_view, ObfuscatedClass*> by_name;
+  for (size_t i = 0; i < m_sections.size(); ++i) {
+    auto& cls = by_name[m_sections[i].new_cls];
+    if (cls == nullptr) {
+      m_obfuscated_classes.push_back(std::make_unique<ObfuscatedClass>());
+      cls = m_obfuscated_classes.back().get();
+      cls->name = m_sections[i].new_cls;
     }
-    if (parse_method(line)) {
-      continue;
+    cls->sections.push_back(i);
+  }
+  std::sort(m_obfuscated_classes.begin(), m_obfuscated_classes.end(),
+            [](const auto& a, const auto& b) { return a->name < b->name; });
+}
+
+ProguardMap::ObfuscatedClass* ProguardMap::find_obfuscated_class(
+    std::string_view member) const {
+  auto end = member.find(";.");
+  if (end == std::string_view::npos) {
+    return nullptr;
+  }
+  auto name = member.substr(0, end + 1);
+  auto it = std::lower_bound(
+      m_obfuscated_classes.begin(), m_obfuscated_classes.end(), name,
+      [](const auto& cls, std::string_view n) { return cls->name < n; });
+  if (it == m_obfuscated_classes.end() || (*it)->name != name) {
+    return nullptr;
+  }
+  return it->get();
+}
+
+const ProguardMap::ObfuscatedMembers& ProguardMap::obfuscated_members(
+    std::string_view member) const {
+  if (m_sections.empty()) {
+    return m_obfMembers;
+  }
+  auto* cls = find_obfuscated_class(member);
+  if (cls == nullptr) {
+    static const ObfuscatedMembers empty_members;
+    return empty_members;
+  }
+  return parse_obfuscated_members(cls);
+}
+
+ProguardMap::ObfuscatedMembers& ProguardMap::parse_obfuscated_members(
+    ObfuscatedClass* cls) const {
+  std::call_once(cls->parsed, [&]() {
+    for (auto idx : cls->sections) {
+      const auto& section = m_sections[idx];
+      for_each_line(section, [&](const std::string& line) {
+        parse_member(line, section, &cls->members, false);
+      });
     }
-    if (comment(line)) {
-      continue;
+  });
+  return cls->members;
+}
+
+void ProguardMap::parse_translations() const {
+  if (m_sections.empty()) {
+    // Nothing to parse lazily.
+    return;
+  }
+  std::call_once(m_translations_parsed, [&]() {
+    for (const auto& section : m_sections) {
+      for_each_line(section, [&](const std::string& line) {
+        parse_member(line, section, nullptr, true);
+      });
     }
-    not_reached_log("Bogus line encountered in proguard map: %s\n",
-                    line.c_str());
+  });
+}
+
+bool ProguardMap::parse_member(const std::string& line,
+                               const Section& section,
+                               ObfuscatedMembers* obfuscated,
+                               bool translations) const {
+  if (parse_field(line, section, obfuscated, translations)) {
+    return true;
+  }
+  if (parse_method(line, section, obfuscated, translations)) {
+    return true;
+  }
+  if (comment(line)) {
+    return true;
   }
+  not_reached_log("Bogus line encountered in proguard map: %s\n",
+                  line.c_str());
 }
 
 void ProguardMap::parse_full_map(std::istream& fp) {
@@ -395,7 +521,7 @@ bool ProguardMap::parse_field_full_format(const std::string& line) {
   auto pgold = old_field_name;
 
   m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
+  m_obfMembers.fields[pgnew] = pgold;
   return true;
 }
 
@@ -424,7 +550,7 @@ bool ProguardMap::parse_method_full_format(const std::string& line) {
   auto pgold = old_method_name;
   auto pgnew = new_method_name;
   m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
+  m_obfMembers.methods[pgnew] = pgold;
   return true;
 }
 
@@ -442,7 +568,10 @@ bool ProguardMap::parse_class(const std::string& line) {
   return true;
 }
 
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              const Section& section,
+                              ObfuscatedMembers* obfuscated,
+                              bool translations) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -457,27 +586,34 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgnew_notype = convert_field(m_currNewClass, "", newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
-  // Record interfaces that are coalesced by Proguard.
-  if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
-    fprintf(stderr,
-            "Type '%s' is touched by Proguard in '%s'\n",
-            ctype.c_str(),
-            pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
+  auto pgnew = convert_field(section.new_cls, xtype, newname);
+  auto pgold = convert_field(section.cls, ctype, fieldname);
+  if (translations) {
+    // Record interfaces that are coalesced by Proguard.
+    if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
+      fprintf(stderr,
+              "Type '%s' is touched by Proguard in '%s'\n",
+              ctype.c_str(),
+              pgold.c_str());
+      m_pg_coalesced_interfaces.insert(ctype);
+    }
+    m_fieldMap[pgold] = pgnew;
+  }
+  if (obfuscated != nullptr) {
+    auto pgnew_notype = convert_field(section.new_cls, "", newname);
+    obfuscated->fields[pgnew] = pgold;
+    obfuscated->untyped_fields[pgnew_notype] = pgold;
   }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
-  m_obfUntypedFieldMap[pgnew_notype] = pgold;
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               const Section& section,
+                               ObfuscatedMembers* obfuscated,
+                               bool translations) const {
   std::string type;
   std::string methodname;
-  std::string classname = m_currClass;
+  std::string classname = section.cls;
   std::string old_args;
   std::string new_args;
   std::string newname;
@@ -518,14 +654,19 @@ bool ProguardMap::parse_method(const std::string& line) {
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
   auto pgold = convert_method(classname, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  auto pgnew_no_rtype = convert_method(m_currNewClass, "", newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  m_obfUntypedMethodMap[pgnew_no_rtype] = pgold;
-  lines->original_name = pgold;
-  m_obfMethodLinesMap[str_copy(pg_impl::lines_key(pgnew))].push_back(
-      std::move(lines));
+  auto pgnew = convert_method(section.new_cls, new_rtype, newname, new_args);
+  if (translations) {
+    m_methodMap[pgold] = pgnew;
+  }
+  if (obfuscated != nullptr) {
+    auto pgnew_no_rtype =
+        convert_method(section.new_cls, "", newname, new_args);
+    obfuscated->methods[pgnew] = pgold;
+    obfuscated->untyped_methods[pgnew_no_rtype] = pgold;
+    lines->original_name = pgold;
+    obfuscated->method_lines[str_copy(pg_impl::lines_key(pgnew))].push_back(
+        std::move(lines));
+  }
   return true;
 }
 
@@ -9,12 +9,17 @@
 
 #include <cstddef>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "DexClass.h"
 #include "ProguardLineRange.h"
+#include "RedexMappedFile.h"
 
 /**
  * ProguardMap parses ProGuard's mapping.txt file that maps de-obfuscated class
@@ -37,6 +42,12 @@
  * For classes, this is the full descriptor.
  * For methods, it's <class descriptor>.<name>(<args descs>)<return desc> .
  * For fields,  it's <class descriptor>.<name>:<type desc> .
+ *
+ * Mapping files can be huge, while only the members of the classes in the
+ * APK are looked up. So only the class lines are parsed up front, and the
+ * member lines of a class are parsed on the first lookup of one of its
+ * members. Files are memory-mapped for that. The map in the full format
+ * (use_new_rename_map) is still parsed eagerly.
  */
 struct ProguardMap {
   /**
@@ -44,6 +55,8 @@ struct ProguardMap {
    */
   explicit ProguardMap() = default;
 
+  ~ProguardMap();
+
   /**
    * Construct map from the given file.
    */
@@ -53,7 +66,7 @@ struct ProguardMap {
   /**
    * Construct map from a given stream.
    */
-  explicit ProguardMap(std::istream& is) { parse_proguard_map(is); }
+  explicit ProguardMap(std::istream& is);
 
   /**
    * Translate un-obfuscated class name to obfuscated name.
@@ -102,22 +115,74 @@ struct ProguardMap {
    */
   ProguardLineRangeVector& method_lines(const std::string& obfuscated_method);
 
-  bool empty() const {
-    return m_classMap.empty() && m_fieldMap.empty() && m_methodMap.empty();
-  }
+  bool empty() const { return m_classMap.empty() && !m_has_members; }
 
   bool is_special_interface(const std::string& type) const {
+    parse_translations();
     return m_pg_coalesced_interfaces.find(type) !=
            m_pg_coalesced_interfaces.end();
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
+  // Obfuscated to unobfuscated member maps, of the members of one class, or
+  // of all classes for maps in the full format.
+  struct ObfuscatedMembers {
+    std::unordered_map<std::string, std::string> fields;
+    std::unordered_map<std::string, std::string> methods;
+
+    // Field map for reflection analysis when type is unknown
+    // Stores Lcom/facebook/Class;.field -> original name without class name
+    std::unordered_map<std::string, std::string> untyped_fields;
+
+    // Method map for reflection analysis when return type is unknown
+    // Stores Lcom/facebook/Class;.method(II) -> original name without class
+    // name
+    std::unordered_map<std::string, std::string> untyped_methods;
+
+    std::unordered_map<std::string, ProguardLineRangeVector> method_lines;
+  };
+
+  // A class line of the map, and the byte range of its member lines.
+  struct Section {
+    std::string cls;
+    std::string new_cls;
+    size_t begin;
+    size_t end;
+  };
+
+  // The members of an obfuscated class, which may be spread over several
+  // sections, parsed on first use.
+  struct ObfuscatedClass {
+    std::string name;
+    std::vector<size_t> sections;
+    std::once_flag parsed;
+    ObfuscatedMembers members;
+  };
+
+  void index_proguard_map();
   void parse_full_map(std::istream& fp);
 
+  ObfuscatedClass* find_obfuscated_class(std::string_view member) const;
+  const ObfuscatedMembers& obfuscated_members(std::string_view member) const;
+  ObfuscatedMembers& parse_obfuscated_members(ObfuscatedClass* cls) const;
+  void parse_translations() const;
+
+  template <typename Fn>
+  void for_each_line(const Section& section, const Fn& fn) const;
+
   bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+  bool parse_member(const std::string& line,
+                    const Section& section,
+                    ObfuscatedMembers* obfuscated,
+                    bool translations) const;
+  bool parse_field(const std::string& line,
+                   const Section& section,
+                   ObfuscatedMembers* obfuscated,
+                   bool translations) const;
+  bool parse_method(const std::string& line,
+                    const Section& section,
+                    ObfuscatedMembers* obfuscated,
+                    bool translations) const;
 
   bool parse_class_full_format(const std::string& line);
   bool parse_store_full_format(const std::string& line);
@@ -125,28 +190,31 @@ struct ProguardMap {
   bool parse_method_full_format(const std::string& line);
 
  private:
-  // Unobfuscated to obfuscated maps
+  // The contents of the map, mapped from a file or copied from a stream.
+  std::unique_ptr<RedexMappedFile> m_mapped_file;
+  std::string m_contents;
+  std::string_view m_data;
+
+  // The class lines, in the order of the file, and the obfuscated classes
+  // sorted by name.
+  std::vector<Section> m_sections;
+  std::vector<std::unique_ptr<ObfuscatedClass>> m_obfuscated_classes;
+  bool m_has_members{false};
+
+  // Unobfuscated to obfuscated maps. The member maps are only filled in
+  // when first needed.
   std::unordered_map<std::string, std::string> m_classMap;
-  std::unordered_map<std::string, std::string> m_fieldMap;
-  std::unordered_map<std::string, std::string> m_methodMap;
+  mutable std::unordered_map<std::string, std::string> m_fieldMap;
+  mutable std::unordered_map<std::string, std::string> m_methodMap;
+  mutable std::once_flag m_translations_parsed;
 
   // Obfuscated to unobfuscated maps from proguard
   std::unordered_map<std::string, std::string> m_obfClassMap;
-  std::unordered_map<std::string, std::string> m_obfFieldMap;
-  std::unordered_map<std::string, std::string> m_obfMethodMap;
-
-  // Field map for reflection analysis when type is unknown
-  // Stores Lcom/facebook/Class;.field -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedFieldMap;
-
-  // Method map for reflection analysis when return type is unknown
-  // Stores Lcom/facebook/Class;.method(II) -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedMethodMap;
-
-  std::unordered_map<std::string, ProguardLineRangeVector> m_obfMethodLinesMap;
+  // Members of all classes in the full format.
+  ObfuscatedMembers m_obfMembers;
 
   // Interfaces that are (most likely) coalesced by Proguard.
-  std::unordered_set<std::string> m_pg_coalesced_interfaces;
+  mutable std::unordered_set<std::string> m_pg_coalesced_interfaces;
 
   std::string m_currClass;
   std::string m_currNewClass;
@@ -6,7 +6,9 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <boost/regex.hpp>
+#include <cctype>
 #include <fstream>
 #include <iostream>
 #include <mutex>
@@ -38,13 +40,19 @@ namespace {
 
 using RegexMap = std::unordered_map<std::string, boost::regex>;
 
-using MatchingStringsCache =
-    ConcurrentMap<std::string, InsertOnlyConcurrentMap<const DexString*, bool>>;
+// A pattern is compiled only once, no matter how many rules use it, and the
+// results of matching it are shared as well.
+struct CompiledPattern {
+  std::unique_ptr<boost::regex> regex;
+  InsertOnlyConcurrentMap<const DexString*, bool> matches;
+};
+
+using MatchingStringsCache = ConcurrentMap<std::string, CompiledPattern>;
 
 struct RegexWithCache {
-  std::unique_ptr<boost::regex> regex;
+  const boost::regex* regex;
   InsertOnlyConcurrentMap<const DexString*, bool>* cache;
-  explicit operator bool() const { return !!regex; }
+  explicit operator bool() const { return regex != nullptr; }
   bool match(const DexString* s) const {
     return boost::regex_match(s->c_str(), *regex);
   }
@@ -53,15 +61,97 @@ struct RegexWithCache {
 RegexWithCache make_rx(const std::string& s,
                        MatchingStringsCache* cache,
                        bool convert = true) {
-  if (s.empty()) return {{}, nullptr};
+  if (s.empty()) return {nullptr, nullptr};
   auto wc = convert ? proguard_parser::convert_wildcard_type(s) : s;
-  auto rx =
-      std::make_unique<boost::regex>(proguard_parser::form_type_regex(wc));
-  InsertOnlyConcurrentMap<const DexString*, bool>* c = nullptr;
-  cache->update(wc, [&](auto, auto& value, bool) { c = &value; });
-  return (RegexWithCache){std::move(rx), c};
+  RegexWithCache rx{nullptr, nullptr};
+  cache->update(wc, [&](auto, CompiledPattern& value, bool exists) {
+    if (!exists) {
+      value.regex = std::make_unique<boost::regex>(
+          proguard_parser::form_type_regex(wc));
+    }
+    rx = {value.regex.get(), &value.matches};
+  });
+  return rx;
+}
+
+// The part of a converted class name pattern before its first wildcard, which
+// every name matching the pattern starts with. Conservatively stops at any
+// character that may have a special meaning.
+std::string_view literal_prefix(std::string_view wildcard_type) {
+  size_t i = 0;
+  for (; i < wildcard_type.size(); i++) {
+    char ch = wildcard_type[i];
+    if (!isalnum(static_cast<unsigned char>(ch)) && ch != '_' && ch != '/' &&
+        ch != '$' && ch != ';') {
+      break;
+    }
+  }
+  return wildcard_type.substr(0, i);
 }
 
+/*
+ * Classes sorted by deobfuscated name. All classes that a class name pattern
+ * can match start with the literal prefix of the pattern, and thus form a
+ * contiguous range, so a rule only needs to look at the ranges of its class
+ * names instead of at all classes.
+ */
+class SortedClasses {
+ public:
+  explicit SortedClasses(const Scope& classes) {
+    m_classes.reserve(classes.size());
+    for (auto* cls : classes) {
+      m_classes.emplace_back(cls->get_deobfuscated_name().str(), cls);
+    }
+    std::stable_sort(
+        m_classes.begin(), m_classes.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+  }
+
+  size_t size() const { return m_classes.size(); }
+
+  // Calls `fn` once on each class that may match the class names of the rule,
+  // and returns the number of such classes. Negated class names only ever
+  // exclude classes, and so do not add any candidates.
+  template <typename Fn>
+  size_t for_each_candidate(const KeepSpec& keep_rule, const Fn& fn) const {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (const auto& class_name : keep_rule.class_spec.classNames) {
+      if (class_name.negated) {
+        continue;
+      }
+      if (class_name.name.empty()) {
+        ranges.emplace_back(0, m_classes.size());
+        continue;
+      }
+      auto wc = proguard_parser::convert_wildcard_type(class_name.name);
+      auto prefix = literal_prefix(wc);
+      auto begin = std::lower_bound(
+          m_classes.begin(), m_classes.end(), prefix,
+          [](const auto& p, std::string_view s) { return p.first < s; });
+      auto end = std::partition_point(begin, m_classes.end(), [&](auto& p) {
+        return p.first.substr(0, prefix.size()) == prefix;
+      });
+      ranges.emplace_back(begin - m_classes.begin(), end - m_classes.begin());
+    }
+    // Visit overlapping ranges, e.g. of `com.foo.*` and `com.foo.bar.*`, only
+    // once.
+    std::sort(ranges.begin(), ranges.end());
+    size_t count = 0;
+    size_t next = 0;
+    for (auto [begin, end] : ranges) {
+      for (auto i = std::max(begin, next); i < end; i++) {
+        fn(m_classes[i].second);
+        count++;
+      }
+      next = std::max(next, end);
+    }
+    return count;
+  }
+
+ private:
+  std::vector<std::pair<std::string_view, DexClass*>> m_classes;
+};
+
 std::vector<RegexWithCache> make_rxs(
     const std::vector<ClassSpecification::ClassNameSpec>& strs,
     MatchingStringsCache* cache) {
@@ -301,10 +391,14 @@ class KeepRuleMatcher {
         m_regex_map(regex_map) {}
 
   ~KeepRuleMatcher() {
-    TRACE(PGR, 3, "%s matched %zu classes and %zu members",
-          show_keep(m_keep_rule).c_str(), m_class_matches, m_member_matches);
+    TRACE(PGR, 3,
+          "%s matched %zu classes and %zu members out of %zu candidates",
+          show_keep(m_keep_rule).c_str(), m_class_matches, m_member_matches,
+          m_candidates);
   }
 
+  void add_candidates(size_t candidates) { m_candidates += candidates; }
+
   void keep_processor(DexClass*);
 
   void mark_class_and_members_for_keep(DexClass* cls);
@@ -385,6 +479,7 @@ class KeepRuleMatcher {
 
   size_t m_member_matches{0};
   size_t m_class_matches{0};
+  size_t m_candidates{0};
   RuleType m_rule_type;
   const KeepSpec& m_keep_rule;
   RegexMap& m_regex_map;
@@ -400,7 +495,9 @@ class ProguardMatcher {
                   const Scope& external_classes)
       : m_pg_map(pg_map),
         m_classes(classes),
-        m_external_classes(external_classes) {
+        m_external_classes(external_classes),
+        m_sorted_classes(classes),
+        m_sorted_external_classes(external_classes) {
     build_extends_or_implements_hierarchy(m_classes, &m_hierarchy);
     // We need to include external classes in the hierarchy because keep rules
     // may, for instance, forbid renaming of all classes that inherit from a
@@ -427,6 +524,8 @@ class ProguardMatcher {
   const ProguardMap& m_pg_map;
   const Scope& m_classes;
   const Scope& m_external_classes;
+  SortedClasses m_sorted_classes;
+  SortedClasses m_sorted_external_classes;
   ClassHierarchy m_hierarchy;
   ProguardRuleRecorder m_recorder;
   MatchingStringsCache m_matching_strings_cache;
@@ -527,12 +626,15 @@ bool KeepRuleMatcher::has_annotation(const DexMember* member,
 
 // From a fully qualified descriptor for a field, extract just the
 // name of the field which occurs between the ;. and : characters.
-const char* extract_field_name_cstr(const std::string& qualified_fieldname) {
-  auto p = qualified_fieldname.find(";.");
+const char* extract_field_name_cstr(const DexString* qualified_fieldname) {
+  if (qualified_fieldname == nullptr) {
+    return "";
+  }
+  auto p = qualified_fieldname->str().find(";.");
   if (p == std::string::npos) {
-    return qualified_fieldname.c_str();
+    return qualified_fieldname->c_str();
   }
-  return qualified_fieldname.c_str() + p + 2;
+  return qualified_fieldname->c_str() + p + 2;
 }
 
 const char* extract_method_name_and_type_cstr(
@@ -559,7 +661,7 @@ bool KeepRuleMatcher::field_level_match(
   }
   // Match field name against regex.
   auto dequalified_name_cstr =
-      extract_field_name_cstr(field->get_deobfuscated_name());
+      extract_field_name_cstr(field->get_deobfuscated_name_or_null());
   return boost::regex_match(dequalified_name_cstr, fieldname_regex);
 }
 
@@ -952,20 +1054,26 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
     }
   };
 
-  // We only parallelize if keep_rule needs to be applied to all classes.
+  // We only parallelize if keep_rule needs to be applied to many classes.
+  std::atomic<size_t> slow_rules{0};
+  std::atomic<size_t> slow_rule_candidates{0};
   auto wq = workqueue_foreach<const KeepSpec*>([&](const KeepSpec* keep_rule) {
     RegexMap regex_map;
     ClassMatcher class_match(*keep_rule, &m_matching_strings_cache);
     KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
-
-    for (const auto& cls : m_classes) {
+    auto process = [&](DexClass* cls) {
       process_single_keep(class_match, rule_matcher, cls);
-    }
+    };
+
+    size_t candidates =
+        m_sorted_classes.for_each_candidate(*keep_rule, process);
     if (process_external) {
-      for (const auto& cls : m_external_classes) {
-        process_single_keep(class_match, rule_matcher, cls);
-      }
+      candidates +=
+          m_sorted_external_classes.for_each_candidate(*keep_rule, process);
     }
+    rule_matcher.add_candidates(candidates);
+    slow_rules++;
+    slow_rule_candidates += candidates;
 
     classify_rules(rule_matcher, rule_type, keep_rule);
   });
@@ -986,6 +1094,7 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
         if (!classname_contains_wildcard(className.name)) {
           DexClass* cls = find_single_class(className.name);
           KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
+          rule_matcher.add_candidates(cls != nullptr);
           process_single_keep(class_match, rule_matcher, cls);
           classify_rules(rule_matcher, rule_type, &keep_rule);
         } else {
@@ -1004,6 +1113,7 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
         if (super != nullptr) {
           KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
           auto children = get_all_children(m_hierarchy, super->get_type());
+          rule_matcher.add_candidates(1 + children.size());
           process_single_keep(class_match, rule_matcher, super);
           for (auto const* type : children) {
             process_single_keep(class_match, rule_matcher, type_class(type));
@@ -1020,6 +1130,14 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
   }
 
   wq.run_all();
+
+  size_t num_classes = m_sorted_classes.size();
+  if (process_external) {
+    num_classes += m_sorted_external_classes.size();
+  }
+  TRACE(PGR, 1, "%zu slow rules for %s tested %zu of %zu possible classes",
+        slow_rules.load(), to_string(rule_type).c_str(),
+        slow_rule_candidates.load(), slow_rules.load() * num_classes);
 }
 
 void ProguardMatcher::process_proguard_rules(
@@ -1142,6 +1260,14 @@ bool matches(const KeepSpec& ks, const DexClass* c) {
   return cm.match(c);
 }
 
+std::vector<const DexClass*> candidate_classes(const KeepSpec& ks,
+                                               const Scope& scope) {
+  std::vector<const DexClass*> candidates;
+  SortedClasses(scope).for_each_candidate(
+      ks, [&](const DexClass* cls) { candidates.push_back(cls); });
+  return candidates;
+}
+
 } // namespace testing
 
 } // namespace keep_rules
@@ -40,6 +40,11 @@ namespace testing {
 
 bool matches(const KeepSpec& ks, const DexClass* c);
 
+// The classes that a rule may match based on the literal prefixes of its
+// class names, in order of their deobfuscated names.
+std::vector<const DexClass*> candidate_classes(const KeepSpec& ks,
+                                               const Scope& scope);
+
 } // namespace testing
 
 } // namespace keep_rules
@@ -5,8 +5,12 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Debug.h"
@@ -16,6 +20,7 @@
 #include "ProguardParser.h"
 #include "ProguardRegex.h"
 #include "ReadMaybeMapped.h"
+#include "WorkQueue.h"
 
 namespace keep_rules {
 namespace proguard_parser {
@@ -1156,12 +1161,11 @@ void parse(const std::vector<Token>& vec,
   }
 }
 
-Stats parse(const std::string_view& config,
-            ProguardConfiguration* pg_config,
-            const std::string& filename) {
+Stats parse_tokens(const std::vector<Token>& tokens,
+                   ProguardConfiguration* pg_config,
+                   const std::string& filename) {
   Stats ret{};
 
-  std::vector<Token> tokens = lex(config);
   bool ok = true;
   // Check for bad tokens.
   for (auto& tok : tokens) {
@@ -1192,6 +1196,92 @@ Stats parse(const std::string_view& config,
   return ret;
 }
 
+Stats parse(const std::string_view& config,
+            ProguardConfiguration* pg_config,
+            const std::string& filename) {
+  return parse_tokens(lex(config), pg_config, filename);
+}
+
+// A config file that was read and lexed ahead of parsing. Lexing does not
+// depend on any parser state, so it can be done for many files in parallel,
+// while parsing has to follow the include order.
+struct LexedFile {
+  std::string contents;
+  std::vector<Token> tokens;
+  // Rethrown when the file is parsed, as if it had been read then.
+  std::exception_ptr error;
+};
+
+using LexedFiles =
+    std::unordered_map<std::string, std::unique_ptr<const LexedFile>>;
+
+std::unique_ptr<const LexedFile> read_and_lex(const std::string& filename) {
+  auto file = std::make_unique<LexedFile>();
+  try {
+    redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
+      file->contents.assign(data, s);
+    });
+  } catch (...) {
+    file->error = std::current_exception();
+    return file;
+  }
+  file->tokens = lex(file->contents);
+  return file;
+}
+
+// Reads and lexes those of the given files in parallel that have neither been
+// parsed nor lexed yet.
+void lex_ahead(const std::vector<std::string>& filenames,
+               const ProguardConfiguration& pg_config,
+               LexedFiles* lexed_files) {
+  std::vector<std::string> todo;
+  std::unordered_set<std::string> seen;
+  for (const auto& filename : filenames) {
+    if (!pg_config.already_included.count(filename) &&
+        !lexed_files->count(filename) && seen.insert(filename).second) {
+      todo.push_back(filename);
+    }
+  }
+  std::vector<std::unique_ptr<const LexedFile>> files(todo.size());
+  workqueue_run_for<size_t>(
+      0, todo.size(), [&](size_t i) { files[i] = read_and_lex(todo[i]); });
+  for (size_t i = 0; i < todo.size(); ++i) {
+    lexed_files->emplace(std::move(todo[i]), std::move(files[i]));
+  }
+}
+
+Stats parse_file(const std::string& filename,
+                 ProguardConfiguration* pg_config,
+                 LexedFiles* lexed_files) {
+  std::unique_ptr<const LexedFile> file;
+  auto it = lexed_files->find(filename);
+  if (it != lexed_files->end()) {
+    file = std::move(it->second);
+    lexed_files->erase(it);
+  } else {
+    file = read_and_lex(filename);
+  }
+  if (file->error) {
+    std::rethrow_exception(file->error);
+  }
+  Stats ret = parse_tokens(file->tokens, pg_config, filename);
+  file.reset();
+
+  // Parse the included files. Their includes are appended as they are parsed,
+  // and have been handled by then.
+  lex_ahead(pg_config->includes, *pg_config, lexed_files);
+  for (size_t i = 0; i < pg_config->includes.size(); ++i) {
+    auto included_filename = pg_config->includes[i];
+    if (pg_config->already_included.find(included_filename) !=
+        pg_config->already_included.end()) {
+      continue;
+    }
+    pg_config->already_included.emplace(included_filename);
+    ret += parse_file(included_filename, pg_config, lexed_files);
+  }
+  return ret;
+}
+
 } // namespace
 
 Stats parse(std::istream& config,
@@ -1204,20 +1294,17 @@ Stats parse(std::istream& config,
 
 Stats parse_file(const std::string& filename,
                  ProguardConfiguration* pg_config) {
+  return parse_files({filename}, pg_config);
+}
+
+Stats parse_files(const std::vector<std::string>& filenames,
+                  ProguardConfiguration* pg_config) {
+  LexedFiles lexed_files;
+  lex_ahead(filenames, *pg_config, &lexed_files);
   Stats ret{};
-  redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
-    std::string_view view(data, s);
-    ret += parse(view, pg_config, filename);
-    // Parse the included files.
-    for (const auto& included_filename : pg_config->includes) {
-      if (pg_config->already_included.find(included_filename) !=
-          pg_config->already_included.end()) {
-        continue;
-      }
-      pg_config->already_included.emplace(included_filename);
-      ret += parse_file(included_filename, pg_config);
-    }
-  });
+  for (const auto& filename : filenames) {
+    ret += parse_file(filename, pg_config, &lexed_files);
+  }
   return ret;
 }
 
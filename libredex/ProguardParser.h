@@ -9,6 +9,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include "ProguardConfiguration.h"
 
@@ -31,6 +32,13 @@ struct Stats {
 };
 
 Stats parse_file(const std::string& filename, ProguardConfiguration* pg_config);
+/*
+ * Like parse_file for each of the files in order, with the same result. The
+ * files and everything they include are read and lexed in parallel ahead of
+ * parsing.
+ */
+Stats parse_files(const std::vector<std::string>& filenames,
+                  ProguardConfiguration* pg_config);
 Stats parse(std::istream& config,
             ProguardConfiguration* pg_config,
             const std::string& filename = "");
@@ -9,15 +9,15 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <vector>
 
-#include <sparta/WeakTopologicalOrdering.h>
-
 #include "ConfigFiles.h"
 #include "ControlFlow.h"
 #include "DexClass.h"
 #include "EditableCfgAdapter.h"
+#include "GraphUtil.h"
 #include "IRInstruction.h"
 #include "Resolver.h"
 #include "Show.h"
@@ -27,12 +27,6 @@
 #include "Walkers.h"
 #include "WorkQueue.h"
 
-namespace {
-
-constexpr double kWtoOrderingThreshold = 50.0;
-
-} // namespace
-
 std::ostream& operator<<(std::ostream& o, const CseLocation& l) {
   switch (l.special_location) {
   case CseSpecialLocations::GENERAL_MEMORY_BARRIER:
@@ -458,225 +452,63 @@ bool process_base_and_overriding_methods(
 
 namespace {
 
-AccumulatingTimer s_wto_timer("compute_locations_closure_wto");
+constexpr size_t kMinParallelWaveSize = 64;
 
-class WtoOrdering {
-  static constexpr const DexMethod* WTO_ROOT = nullptr;
+// The dependency graph of the methods with known locations, with the methods
+// numbered densely and the successors of all of them in one array.
+struct DependencyGraph {
+  std::vector<const DexMethod*> methods;
+  std::vector<LocationsAndDependencies*> lads;
+  std::vector<uint32_t> succ_offsets;
+  std::vector<uint32_t> succs;
+  // Whether a method depends on a method without known locations.
+  std::vector<uint8_t> depends_on_unknown;
 
-  struct FirstIterationData {
-    std::vector<const DexMethod*> root_cache;
-    std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-        inverse_dependencies;
-    const std::vector<const DexMethod*> empty{};
+  size_t size() const { return methods.size(); }
 
-    const std::vector<const DexMethod*>& get(const DexMethod* m) {
-      if (m == WTO_ROOT) {
-        // Pre-initialized and pre-sorted
-        return root_cache;
-      }
-      auto it = inverse_dependencies.find(m);
-      if (it != inverse_dependencies.end()) {
-        // Pre-sorted
-        return it->second;
-      }
-      return empty;
+  template <typename Fn>
+  void for_each_succ(uint32_t v, const Fn& fn) const {
+    for (auto i = succ_offsets[v]; i < succ_offsets[v + 1]; ++i) {
+      fn(succs[i]);
     }
-  };
-
-  static FirstIterationData create_first_iteration_data(
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> wto_nodes{WTO_ROOT};
-    wto_nodes.reserve(wto_nodes.size() + impacted_methods.size());
-    wto_nodes.insert(wto_nodes.end(), impacted_methods.begin(),
-                     impacted_methods.end());
-
-    // In the first iteration, besides computing the sorted root successors, we
-    // also sort all inverse_dependencies entries in-place. They represent the
-    // full successor vectors.
-    std::vector<const DexMethod*> root_cache;
-    workqueue_run<const DexMethod*>(
-        [&inverse_dependencies, &root_cache,
-         &impacted_methods](const DexMethod* m) {
-          if (m == WTO_ROOT) {
-            root_cache = get_sorted_impacted_methods(impacted_methods);
-            return;
-          }
-          auto it = inverse_dependencies.find(m);
-          if (it != inverse_dependencies.end()) {
-            auto& entries = it->second;
-            entries.shrink_to_fit();
-            std::sort(entries.begin(), entries.end(), compare_dexmethods);
-          }
-        },
-        wto_nodes);
-
-    return {std::move(root_cache), inverse_dependencies};
-  }
-
-  struct OtherIterationData {
-    InsertOnlyConcurrentMap<const DexMethod*, std::vector<const DexMethod*>>
-        concurrent_cache;
-
-    const std::vector<const DexMethod*>& get(const DexMethod* const& m) {
-      return concurrent_cache.at_unsafe(m);
-    }
-  };
-
-  static OtherIterationData create_other_iteration_data(
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> wto_nodes{WTO_ROOT};
-    wto_nodes.reserve(wto_nodes.size() + impacted_methods.size());
-    wto_nodes.insert(wto_nodes.end(), impacted_methods.begin(),
-                     impacted_methods.end());
-
-    // In subsequent iteration, besides computing the sorted root successors
-    // again, we also filter all previously sorted inverse_dependencies entries.
-    InsertOnlyConcurrentMap<const DexMethod*, std::vector<const DexMethod*>>
-        concurrent_cache;
-    workqueue_run<const DexMethod*>(
-        [&impacted_methods, &concurrent_cache,
-         &inverse_dependencies](const DexMethod* m) {
-          std::vector<const DexMethod*> successors;
-          if (m == WTO_ROOT) {
-            // Re-initialize and re-sort
-            successors = get_sorted_impacted_methods(impacted_methods);
-          }
-          auto it = inverse_dependencies.find(m);
-          if (it != inverse_dependencies.end()) {
-            // Note that we are filtering on an already pre-sorted vector
-            for (auto n : it->second) {
-              if (impacted_methods.count(n)) {
-                successors.push_back(n);
-              }
-            }
-          }
-          auto [_, emplaced] =
-              concurrent_cache.emplace(m, std::move(successors));
-          always_assert(emplaced);
-        },
-        wto_nodes);
-
-    return {std::move(concurrent_cache)};
-  }
-
-  static std::vector<const DexMethod*> get_sorted_impacted_methods(
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> successors;
-    successors.reserve(impacted_methods.size());
-    successors.insert(successors.end(), impacted_methods.begin(),
-                      impacted_methods.end());
-    std::sort(successors.begin(), successors.end(), compare_dexmethods);
-    return successors;
-  }
-
-  static std::vector<const DexMethod*> sort_by_inverse_deps(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      const std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies) {
-    // First translate to pair to avoid repeated map lookups.
-    std::vector<std::pair<const DexMethod*, size_t>> sorted_by_inv_deps;
-    sorted_by_inv_deps.reserve(impacted_methods.size());
-    std::transform(impacted_methods.begin(), impacted_methods.end(),
-                   std::back_inserter(sorted_by_inv_deps),
-                   [&inverse_dependencies](auto* m) {
-                     auto it = inverse_dependencies.find(m);
-                     return std::make_pair(m, it != inverse_dependencies.end()
-                                                  ? it->second.size()
-                                                  : 0);
-                   });
-    std::sort(sorted_by_inv_deps.begin(), sorted_by_inv_deps.end(),
-              [](const std::pair<const DexMethod*, size_t>& lhs,
-                 const std::pair<const DexMethod*, size_t>& rhs) {
-                if (lhs.second != rhs.second) {
-                  return lhs.second > rhs.second;
-                }
-                return compare_dexmethods(lhs.first, rhs.first);
-              });
-    std::vector<const DexMethod*> res;
-    res.reserve(impacted_methods.size());
-    std::transform(sorted_by_inv_deps.begin(), sorted_by_inv_deps.end(),
-                   std::back_inserter(res),
-                   [](const auto& p) { return p.first; });
-    return res;
   }
+};
 
-  // We saw big slowdowns when there are too many components, possibly
-  // driven by the fact there is a lot of dependencies.
-  template <typename SuccFn>
-  static void run_wto(const SuccFn& succ_fn,
-                      std::vector<const DexMethod*>& ordered_impacted_methods) {
-    sparta::WeakTopologicalOrdering<const DexMethod*> wto(WTO_ROOT, succ_fn);
-    wto.visit_depth_first([&ordered_impacted_methods](const DexMethod* m) {
-      if (m) {
-        ordered_impacted_methods.push_back(m);
+DependencyGraph build_dependency_graph(
+    InsertOnlyConcurrentMap<const DexMethod*, LocationsAndDependencies>*
+        method_lads) {
+  DependencyGraph graph;
+  std::unordered_map<const DexMethod*, uint32_t> indices;
+  indices.reserve(method_lads->size());
+  for (auto& [method, lads] : *method_lads) {
+    indices.emplace(method, graph.methods.size());
+    graph.methods.push_back(method);
+    graph.lads.push_back(const_cast<LocationsAndDependencies*>(&lads));
+  }
+  auto n = graph.size();
+  std::vector<std::vector<uint32_t>> succs(n);
+  graph.depends_on_unknown.resize(n);
+  workqueue_run_for<size_t>(0, n, [&](size_t v) {
+    for (auto* d : graph.lads[v]->dependencies) {
+      if (d == graph.methods[v]) {
+        continue;
       }
-    });
-  }
-
-  static bool should_use_wto(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      const std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies) {
-    size_t impacted_methods_size = impacted_methods.size();
-    size_t inv_dep_sum{0}, inv_dep_max{0};
-    for (auto& entry : inverse_dependencies) {
-      inv_dep_sum += entry.second.size();
-      inv_dep_max = std::max(inv_dep_max, entry.second.size());
-    }
-    auto inv_dep_avg = ((double)inv_dep_sum) / inverse_dependencies.size();
-    // Purity is too low-level for nice configuration switches. Think
-    // about it.
-    TRACE(CSE, 4,
-          "UseWto: impacted methods = %zu inverse_deps_max = %zu "
-          "inverse_deps avg = %.2f",
-          impacted_methods_size, inv_dep_max, inv_dep_avg);
-    return inv_dep_avg < kWtoOrderingThreshold;
-  }
-
- public:
-  static std::vector<const DexMethod*> order_impacted_methods(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      size_t iterations) {
-    Timer prepare_wto{"Prepare Ordering"};
-    auto wto_timer_scope = s_wto_timer.scope();
-
-    std::vector<const DexMethod*> ordered_impacted_methods;
-
-    // To avoid std::function overhead we have to split here.
-    if (iterations == 1 &&
-        should_use_wto(impacted_methods, inverse_dependencies)) {
-      auto first_data =
-          create_first_iteration_data(inverse_dependencies, impacted_methods);
-      run_wto(
-          [&first_data](
-              const DexMethod* m) -> const std::vector<const DexMethod*>& {
-            return first_data.get(m);
-          },
-          ordered_impacted_methods);
-    } else if (iterations == 1) {
-      // Simple sorting for determinism.
-      ordered_impacted_methods =
-          sort_by_inverse_deps(impacted_methods, inverse_dependencies);
-    } else {
-      auto other_data =
-          create_other_iteration_data(inverse_dependencies, impacted_methods);
-      run_wto(
-          [&other_data](
-              const DexMethod* m) -> const std::vector<const DexMethod*>& {
-            return other_data.get(m);
-          },
-          ordered_impacted_methods);
+      auto it = indices.find(d);
+      if (it == indices.end()) {
+        graph.depends_on_unknown[v] = true;
+        return;
+      }
+      succs[v].push_back(it->second);
     }
-
-    return ordered_impacted_methods;
+  });
+  graph.succ_offsets.reserve(n + 1);
+  graph.succ_offsets.push_back(0);
+  for (auto& v_succs : succs) {
+    graph.succs.insert(graph.succs.end(), v_succs.begin(), v_succs.end());
+    graph.succ_offsets.push_back(graph.succs.size());
   }
-};
+  return graph;
+}
 
 template <typename InitFuncT>
 size_t compute_locations_closure_impl(
@@ -698,100 +530,109 @@ size_t compute_locations_closure_impl(
     });
   }
 
-  // 2. Compute inverse dependencies so that we know what needs to be recomputed
-  // during the fixpoint computation, and determine set of methods that are
-  // initially "impacted" in the sense that they have dependencies.
-  std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>
-      inverse_dependencies;
-  std::unordered_set<const DexMethod*> impacted_methods;
+  // 2. Condense the dependency graph into its strongly connected components.
+  //    All methods of a component depend on each other, so they end up with
+  //    the same locations.
+  DependencyGraph graph;
+  std::vector<uint32_t> component_of;
+  std::vector<std::vector<uint32_t>> sccs;
   {
-    Timer t{"Compute inverse dependencies"};
-    for (auto&& [method, lads] : method_lads) {
-      if (!lads.dependencies.empty()) {
-        for (auto d : lads.dependencies) {
-          inverse_dependencies[d].push_back(method);
+    Timer t{"Compute dependency components"};
+    graph = build_dependency_graph(&method_lads);
+    sccs = graph::strongly_connected_components(graph.succ_offsets,
+                                                graph.succs, &component_of);
+  }
+
+  // 3. Let's (semantically) inline locations, a wave of components at a time,
+  //    where each wave only depends on the previous ones. Methods for which
+  //    information is directly or indirectly absent are equivalent to a
+  //    general memory barrier, and are systematically pruned.
+  std::vector<uint32_t> component_wave(sccs.size());
+  std::vector<std::vector<uint32_t>> waves;
+  for (uint32_t c = 0; c < sccs.size(); ++c) {
+    // Components come after the ones they depend on, so those have their wave
+    // already.
+    uint32_t wave = 0;
+    for (auto v : sccs[c]) {
+      graph.for_each_succ(v, [&](uint32_t w) {
+        auto other = component_of[w];
+        if (other != c) {
+          wave = std::max(wave, component_wave[other] + 1);
         }
-        impacted_methods.insert(method);
-      }
+      });
     }
-  }
-
-  // 3. Let's try to (semantically) inline locations, computing a fixed
-  //    point. Methods for which information is directly or indirectly absent
-  //    are equivalent to a general memory barrier, and are systematically
-  //    pruned.
-
-  // TODO: Instead of custom fixpoint computation using WTO, consider using the
-  // MonotonicFixpointIterator, operating on a callgraph, capture the
-  // dependencies, and have the Locations as the abstract domain.
-
-  size_t iterations = 0;
-  while (!impacted_methods.empty()) {
-    iterations++;
-    Timer t{std::string("Iteration ") + std::to_string(iterations)};
-
-    // We order the impacted methods in a deterministic way that's likely
-    // helping to reduce the number of needed iterations.
-    auto ordered_impacted_methods = WtoOrdering::order_impacted_methods(
-        impacted_methods, inverse_dependencies, iterations);
-    impacted_methods.clear();
-
-    std::vector<const DexMethod*> changed_methods;
-    for (const DexMethod* method : ordered_impacted_methods) {
-      auto& lads = method_lads.at_unsafe(method);
-      bool unknown = false;
-      size_t lads_locations_size = lads.locations.size();
-      for (const DexMethod* d : lads.dependencies) {
-        if (d == method) {
-          continue;
+    component_wave[c] = wave;
+    if (wave >= waves.size()) {
+      waves.resize(wave + 1);
+    }
+    waves[wave].push_back(c);
+  }
+
+  std::vector<CseUnorderedLocationSet> component_locations(sccs.size());
+  std::vector<uint8_t> component_unknown(sccs.size());
+  auto process_component = [&](uint32_t c) {
+    auto& locations = component_locations[c];
+    bool unknown = false;
+    for (auto v : sccs[c]) {
+      if (graph.depends_on_unknown[v]) {
+        unknown = true;
+        break;
+      }
+      const auto& own_locations = graph.lads[v]->locations;
+      locations.insert(own_locations.begin(), own_locations.end());
+      graph.for_each_succ(v, [&](uint32_t w) {
+        auto other = component_of[w];
+        if (other == c || unknown) {
+          return;
         }
-        auto it = method_lads.find(d);
-        if (it == method_lads.end()) {
+        if (component_unknown[other]) {
           unknown = true;
-          break;
-        }
-        const auto& other_locations = it->second.locations;
-        lads.locations.insert(other_locations.begin(), other_locations.end());
-      }
-      if (unknown || lads_locations_size < lads.locations.size()) {
-        // something changed
-        changed_methods.push_back(method);
-        if (unknown) {
-          method_lads.erase_unsafe(method);
+          return;
         }
+        const auto& other_locations = component_locations[other];
+        locations.insert(other_locations.begin(), other_locations.end());
+      });
+      if (unknown) {
+        break;
       }
     }
-
-    // Given set of changed methods, determine set of dependents for which
-    // we need to re-run the analysis in another iteration.
-    for (auto changed_method : changed_methods) {
-      auto it = inverse_dependencies.find(changed_method);
-      if (it == inverse_dependencies.end()) {
-        continue;
-      }
-
-      // remove inverse dependency entries as appropriate
-      auto& entries = it->second;
-      std20::erase_if(entries,
-                      [&](auto* m) { return !method_lads.count_unsafe(m); });
-
-      if (entries.empty()) {
-        // remove inverse dependency
-        inverse_dependencies.erase(changed_method);
+    if (unknown) {
+      component_unknown[c] = true;
+      locations.clear();
+    }
+  };
+  {
+    Timer t{"Propagate locations"};
+    for (const auto& components : waves) {
+      // Dependency chains can be long, with few components per wave, where
+      // starting a work queue would not pay off.
+      if (components.size() < kMinParallelWaveSize) {
+        for (auto c : components) {
+          process_component(c);
+        }
       } else {
-        // add inverse dependencies entries to impacted methods
-        impacted_methods.insert(entries.begin(), entries.end());
+        workqueue_run_for<size_t>(0, components.size(), [&](size_t i) {
+          process_component(components[i]);
+        });
       }
     }
   }
 
   // For all methods which have a known set of locations at this point,
   // persist that information
-  for (auto&& [method, lads] : method_lads) {
-    result->emplace(method, std::move(lads.locations));
+  for (uint32_t c = 0; c < sccs.size(); ++c) {
+    if (component_unknown[c]) {
+      continue;
+    }
+    const auto& scc = sccs[c];
+    for (size_t i = 0; i + 1 < scc.size(); ++i) {
+      result->emplace(graph.methods[scc[i]], component_locations[c]);
+    }
+    result->emplace(graph.methods[scc.back()],
+                    std::move(component_locations[c]));
   }
 
-  return iterations;
+  return waves.empty() ? 0 : waves.size() - 1;
 }
 
 } // namespace
@@ -147,8 +147,10 @@ bool process_base_and_overriding_methods(
 // account all overriding methods.
 // When encountering unknown method implementations, the resulting map will have
 // no entry for the relevant (base) methods.
-// The return value indicates how many iterations the fixed-point computation
-// required.
+// Methods that depend on each other are grouped into strongly connected
+// components, which are processed in parallel waves, in dependency order.
+// The return value is the length of the longest chain of dependencies between
+// such components, i.e. the number of waves after the first.
 size_t compute_locations_closure(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
@@ -160,8 +162,8 @@ size_t compute_locations_closure(
 // that they may read from a set of well-known locations (not including
 // GENERAL_MEMORY_BARRIER). For each conditionally pure method, the returned
 // map indicates the set of read locations.
-// The return value indicates how many iterations the fixed-point computation
-// required.
+// The return value is the number of waves after the first, see
+// compute_locations_closure.
 size_t compute_conditionally_pure_methods(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
@@ -171,10 +173,8 @@ size_t compute_conditionally_pure_methods(
 
 // Compute all methods with no side effects, i.e. methods which do not mutate
 // state and only call other methods which do not have side effects.
-// The return value indicates how many iterations the fixed-point computation
-// required.
-// The return value indicates how many iterations the fixed-point computation
-// required.
+// The return value is the number of waves after the first, see
+// compute_locations_closure.
 size_t compute_no_side_effects_methods(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
@@ -10,8 +10,11 @@
 #include <algorithm>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,129 +34,9 @@ using namespace sparta;
 template <typename... Args>
 class Forest {
  public:
-  class DecisionTreeNode {
-   public:
-    virtual ~DecisionTreeNode() {}
+  using FeatureFn = std::function<float(Args...)>;
+  using FeatureFunctionMap = std::unordered_map<std::string, FeatureFn>;
 
-    virtual float accept(Args... args) const = 0;
-    virtual std::unique_ptr<DecisionTreeNode> clone() const = 0;
-    virtual std::string dump() const = 0; // Meant for testing.
-  };
-
-  struct DecisionTreeCategory : public DecisionTreeNode {
-    float acc;
-
-    explicit DecisionTreeCategory(float acc) : acc(acc) {}
-
-    float accept(Args...) const override { return acc; }
-
-    std::unique_ptr<DecisionTreeNode> clone() const override {
-      return std::make_unique<DecisionTreeCategory>(acc);
-    }
-
-    std::string dump() const override {
-      return std::string("(accf ") + std::to_string(acc) + ")";
-    }
-  };
-
-  struct DecisionTreeFeature : public DecisionTreeNode {
-    std::unique_ptr<DecisionTreeNode> true_branch;
-    std::unique_ptr<DecisionTreeNode> false_branch;
-    std::string feature_name; // For dumping only.
-    using FeatureFn = std::function<float(Args...)>;
-    // Note: for simplicity, feature nodes copy the functions, so that a given
-    //       FeatureFunctionMap may go out of scope after a call to deserialize.
-    const FeatureFn feature_fn;
-    float threshold;
-
-    DecisionTreeFeature(std::unique_ptr<DecisionTreeNode> true_branch,
-                        std::unique_ptr<DecisionTreeNode> false_branch,
-                        std::string feature_name,
-                        const FeatureFn& fn,
-                        float threshold)
-        : true_branch(std::move(true_branch)),
-          false_branch(std::move(false_branch)),
-          feature_name(std::move(feature_name)),
-          feature_fn(fn),
-          threshold(threshold) {}
-
-    float accept(Args... args) const override {
-      return feature_fn(args...) <= threshold ? true_branch->accept(args...)
-                                              : false_branch->accept(args...);
-    }
-
-    std::unique_ptr<DecisionTreeNode> clone() const override {
-      return std::make_unique<DecisionTreeFeature>(
-          true_branch->clone(), false_branch->clone(), feature_name, feature_fn,
-          threshold);
-    }
-
-    std::string dump() const override {
-      return std::string("(feat \"") + feature_name + "\" " +
-             std::to_string(threshold) + " " + true_branch->dump() + " " +
-             false_branch->dump() + ")";
-    }
-  };
-
-  using FeatureFunctionMap =
-      std::unordered_map<std::string, typename DecisionTreeFeature::FeatureFn>;
-
-  static std::unique_ptr<DecisionTreeNode> deserialize_tree(
-      const s_expr& expr, const FeatureFunctionMap& feature_fns) {
-    s_expr tail;
-    // Old boolean style
-    if (s_patn({s_patn("acc")}, tail).match_with(expr)) {
-      always_assert(tail.size() == 2);
-      std::string acc_str, rej_str;
-      s_expr rest;
-      s_patn({s_patn(&acc_str), s_patn(&rej_str)}, rest)
-          .must_match(tail, "Need acc and rej count");
-      always_assert(rest.is_nil());
-      size_t idx;
-      size_t acc = std::stoul(acc_str, &idx);
-      always_assert(idx == acc_str.length());
-      size_t rej = std::stoul(rej_str, &idx);
-      always_assert(idx == rej_str.length());
-      always_assert(acc != 0 || rej != 0);
-      return std::make_unique<DecisionTreeCategory>(acc >= rej ? 1.0 : 0.0);
-    }
-
-    if (s_patn({s_patn("accf")}, tail).match_with(expr)) {
-      always_assert(tail.size() == 1);
-      std::string acc_str;
-      s_expr rest;
-      s_patn({s_patn(&acc_str)}, rest).must_match(tail, "Need acc value");
-      always_assert(rest.is_nil());
-      size_t idx;
-      auto acc = std::stof(acc_str, &idx);
-      always_assert(idx == acc_str.length());
-      return std::make_unique<DecisionTreeCategory>(acc);
-    }
-
-    s_patn({s_patn("feat")}, tail).must_match(expr, "Expected feat or acc");
-    always_assert(tail.size() == 4);
-    std::string feature;
-    std::string threshold_str;
-    s_expr rest;
-    s_patn({s_patn(&feature), s_patn(&threshold_str)}, rest)
-        .must_match(tail, "Expected feature format");
-
-    size_t idx;
-    float threshold = std::stof(threshold_str, &idx);
-    always_assert(idx == threshold_str.length());
-    always_assert(threshold >= 0);
-
-    auto fn_it = feature_fns.find(feature);
-    always_assert_log(fn_it != feature_fns.end(), "%s", feature.c_str());
-
-    auto lhs = deserialize_tree(rest[0], feature_fns);
-    auto rhs = deserialize_tree(rest[1], feature_fns);
-
-    return std::make_unique<DecisionTreeFeature>(
-        std::move(lhs), std::move(rhs), feature, fn_it->second, threshold);
-  }
-
- public:
   Forest() = default;
   Forest(Forest&&) noexcept = default;
   Forest& operator=(Forest&& other) noexcept = default;
@@ -161,15 +44,18 @@ class Forest {
   // Do not enable copy semantics to avoid accidental expensive copies.
   Forest clone() const {
     Forest ret;
-    ret.m_trees.reserve(m_trees.size());
-    std::transform(m_trees.begin(), m_trees.end(),
-                   std::back_inserter(ret.m_trees),
-                   [](const auto& tree) { return tree->clone(); });
+    ret.m_feature_names = m_feature_names;
+    ret.m_feature_fns = m_feature_fns;
+    ret.m_roots = m_roots;
+    ret.m_node_feature = m_node_feature;
+    ret.m_node_threshold = m_node_threshold;
+    ret.m_node_false_child = m_node_false_child;
     return ret;
   }
 
-  // Note: for simplicity, feature nodes copy the functions, so that a given
-  //       FeatureFunctionMap may go out of scope after a call to deserialize.
+  // Note: for simplicity, the forest copies the feature functions it uses, so
+  //       that a given FeatureFunctionMap may go out of scope after a call to
+  //       deserialize.
   static Forest deserialize(const std::string& serialized_forest,
                             const FeatureFunctionMap& feature_fns) {
     std::istringstream input(serialized_forest);
@@ -190,42 +76,180 @@ class Forest {
     always_assert(trees_expr.size() > 0);
 
     Forest ret;
-    ret.m_trees.reserve(trees_expr.size());
+    ret.m_roots.reserve(trees_expr.size());
+    std::unordered_map<std::string, uint32_t> feature_indices;
     for (size_t i = 0; i < trees_expr.size(); ++i) {
       TRACE(METH_PROF, 5, "Parsing tree %zu", i);
-      ret.m_trees.emplace_back(deserialize_tree(trees_expr[i], feature_fns));
+      ret.m_roots.push_back(ret.m_node_feature.size());
+      ret.deserialize_tree(trees_expr[i], feature_fns, &feature_indices);
     }
     return ret;
   }
 
-  size_t size() const { return m_trees.size(); }
+  size_t size() const { return m_roots.size(); }
 
-  bool accept(Args... args, float* c = nullptr) const {
-    float acc_sum{0};
-    for (const auto& dec_tree : m_trees) {
-      acc_sum += dec_tree->accept(args...);
+  // The number of distinct features the trees test, i.e., the width of a row
+  // of feature values as taken by `score`.
+  size_t num_features() const { return m_feature_fns.size(); }
+
+  void compute_features(Args... args, float* row) const {
+    for (size_t i = 0; i < m_feature_fns.size(); ++i) {
+      row[i] = m_feature_fns[i](args...);
     }
+  }
+
+  // Sums up the results of all trees for each of the `num_rows` rows of
+  // feature values in `rows`, as computed by `compute_features`, into `sums`.
+  // The trees are walked one at a time over all rows, so that the nodes of a
+  // tree stay in cache.
+  void score(const float* rows, size_t num_rows, float* sums) const {
+    std::fill(sums, sums + num_rows, 0.0f);
+    const auto num_features = m_feature_fns.size();
+    for (auto root : m_roots) {
+      for (size_t r = 0; r < num_rows; ++r) {
+        const float* row = rows + r * num_features;
+        auto node = root;
+        while (m_node_feature[node] != LEAF) {
+          node = row[m_node_feature[node]] <= m_node_threshold[node]
+                     ? node + 1
+                     : m_node_false_child[node];
+        }
+        sums[r] += m_node_threshold[node];
+      }
+    }
+  }
+
+  bool accept_score(float acc_sum) const {
+    return 2 * acc_sum >= m_roots.size();
+  }
+
+  bool accept(Args... args, float* c = nullptr) const {
+    std::vector<float> row(m_feature_fns.size());
+    compute_features(args..., row.data());
+    float acc_sum;
+    score(row.data(), 1, &acc_sum);
     if (c != nullptr) {
       *c = acc_sum;
     }
-    return 2 * acc_sum >= m_trees.size();
+    return accept_score(acc_sum);
   }
 
   std::string dump() const {
     std::ostringstream oss;
     bool first = true;
-    for (const auto& tree : m_trees) {
+    for (auto root : m_roots) {
       if (!first) {
         oss << "\n";
       }
       first = false;
-      oss << tree->dump();
+      oss << dump_tree(root);
     }
     return oss.str();
   }
 
  private:
-  std::vector<std::unique_ptr<DecisionTreeNode>> m_trees;
+  static constexpr uint32_t LEAF = std::numeric_limits<uint32_t>::max();
+
+  static float deserialize_acc(const s_expr& expr) {
+    s_expr tail;
+    // Old boolean style
+    if (s_patn({s_patn("acc")}, tail).match_with(expr)) {
+      always_assert(tail.size() == 2);
+      std::string acc_str, rej_str;
+      s_expr rest;
+      s_patn({s_patn(&acc_str), s_patn(&rej_str)}, rest)
+          .must_match(tail, "Need acc and rej count");
+      always_assert(rest.is_nil());
+      size_t idx;
+      size_t acc = std::stoul(acc_str, &idx);
+      always_assert(idx == acc_str.length());
+      size_t rej = std::stoul(rej_str, &idx);
+      always_assert(idx == rej_str.length());
+      always_assert(acc != 0 || rej != 0);
+      return acc >= rej ? 1.0 : 0.0;
+    }
+
+    s_patn({s_patn("accf")}, tail).must_match(expr, "Expected feat or acc");
+    always_assert(tail.size() == 1);
+    std::string acc_str;
+    s_expr rest;
+    s_patn({s_patn(&acc_str)}, rest).must_match(tail, "Need acc value");
+    always_assert(rest.is_nil());
+    size_t idx;
+    auto acc = std::stof(acc_str, &idx);
+    always_assert(idx == acc_str.length());
+    return acc;
+  }
+
+  // Appends the nodes of the tree in pre-order, so that the true branch of a
+  // feature node always directly follows it.
+  void deserialize_tree(
+      const s_expr& expr,
+      const FeatureFunctionMap& feature_fns,
+      std::unordered_map<std::string, uint32_t>* feature_indices) {
+    s_expr tail;
+    if (!s_patn({s_patn("feat")}, tail).match_with(expr)) {
+      auto acc = deserialize_acc(expr);
+      m_node_feature.push_back(LEAF);
+      m_node_threshold.push_back(acc);
+      m_node_false_child.push_back(0);
+      return;
+    }
+
+    always_assert(tail.size() == 4);
+    std::string feature;
+    std::string threshold_str;
+    s_expr rest;
+    s_patn({s_patn(&feature), s_patn(&threshold_str)}, rest)
+        .must_match(tail, "Expected feature format");
+
+    size_t idx;
+    float threshold = std::stof(threshold_str, &idx);
+    always_assert(idx == threshold_str.length());
+    always_assert(threshold >= 0);
+
+    auto fn_it = feature_fns.find(feature);
+    always_assert_log(fn_it != feature_fns.end(), "%s", feature.c_str());
+    auto [feature_it, emplaced] =
+        feature_indices->emplace(feature, m_feature_fns.size());
+    if (emplaced) {
+      m_feature_names.push_back(feature);
+      m_feature_fns.push_back(fn_it->second);
+    }
+
+    auto node = m_node_feature.size();
+    m_node_feature.push_back(feature_it->second);
+    m_node_threshold.push_back(threshold);
+    m_node_false_child.push_back(0);
+    deserialize_tree(rest[0], feature_fns, feature_indices);
+    m_node_false_child[node] = m_node_feature.size();
+    deserialize_tree(rest[1], feature_fns, feature_indices);
+  }
+
+  std::string dump_tree(uint32_t node) const {
+    if (m_node_feature[node] == LEAF) {
+      return std::string("(accf ") + std::to_string(m_node_threshold[node]) +
+             ")";
+    }
+    return std::string("(feat \"") + m_feature_names[m_node_feature[node]] +
+           "\" " + std::to_string(m_node_threshold[node]) + " " +
+           dump_tree(node + 1) + " " + dump_tree(m_node_false_child[node]) +
+           ")";
+  }
+
+  // The features tested by any of the trees, in order of first use.
+  std::vector<std::string> m_feature_names; // For dumping only.
+  std::vector<FeatureFn> m_feature_fns;
+
+  // All trees are laid out flat in the node arrays below, each starting at its
+  // root index. A feature node tests whether the value of its feature is at
+  // most its threshold, in which case evaluation continues with the next node,
+  // and otherwise with its false child. For leaves, the feature is LEAF and
+  // the threshold holds the result of the tree.
+  std::vector<uint32_t> m_roots;
+  std::vector<uint32_t> m_node_feature;
+  std::vector<float> m_node_threshold;
+  std::vector<uint32_t> m_node_false_child;
 };
 
 } // namespace random_forest
@@ -696,6 +696,7 @@ MethodReferencesGatherer::MethodReferencesGatherer(
     : m_shared_state(shared_state),
       m_method(method),
       m_consider_code(consider_code),
+      m_default_gather_mie(!gather_mie),
       m_gather_mie(gather_mie ? std::move(gather_mie)
                               : default_gather_mie_with_gather_methods) {}
 
@@ -864,66 +865,157 @@ MethodReferencesGatherer::get_returning_dependency(
 void MethodReferencesGatherer::default_gather_mie(const MethodItemEntry& mie,
                                                   References* refs,
                                                   bool gather_methods) {
+  gather_code_references(mie, refs, gather_methods);
+  if (m_shared_state->relaxed_keep_class_members) {
+    relaxed_keep_class_members_impl::gather_dynamic_references(&mie, refs);
+  }
+  if (gather_methods && mie.type == MFLOW_OPCODE) {
+    gather_invoke_targets(mie.insn, refs);
+  }
+}
+
+void MethodReferencesGatherer::gather_code_references(
+    const MethodItemEntry& mie, References* refs, bool gather_methods) const {
   mie.gather_strings(refs->strings);
   mie.gather_types(refs->types);
   mie.gather_fields(refs->fields);
   if (gather_methods) {
     mie.gather_methods(refs->methods);
   }
-  if (m_shared_state->relaxed_keep_class_members) {
-    relaxed_keep_class_members_impl::gather_dynamic_references(&mie, refs);
-  }
   if (mie.type == MFLOW_OPCODE) {
-    auto* insn = mie.insn;
-    auto op = insn->opcode();
+    auto op = mie.insn->opcode();
     if (opcode::is_new_instance(op)) {
-      refs->new_instances.push_back(insn->get_type());
-    } else if (gather_methods && opcode::is_invoke_super(op)) {
-      auto callee =
-          resolve_method(insn->get_method(), MethodSearch::Super, m_method);
-      if (callee && !callee->is_external()) {
-        always_assert(callee->is_virtual());
-        if (is_abstract(callee)) {
-          TRACE(REACH, 1,
-                "invoke super target of {%s} is abstract method %s in %s",
-                SHOW(insn), SHOW(callee), SHOW(m_method));
-        } else {
-          refs->invoke_super_targets.insert(callee);
-        }
+      refs->new_instances.push_back(mie.insn->get_type());
+    } else if (opcode::is_a_return(op)) {
+      refs->returns = true;
+    }
+  }
+}
+
+void MethodReferencesGatherer::gather_invoke_targets(const IRInstruction* insn,
+                                                     References* refs) const {
+  auto op = insn->opcode();
+  if (opcode::is_invoke_super(op)) {
+    auto callee =
+        resolve_method(insn->get_method(), MethodSearch::Super, m_method);
+    if (callee && !callee->is_external()) {
+      always_assert(callee->is_virtual());
+      if (is_abstract(callee)) {
+        TRACE(REACH, 1,
+              "invoke super target of {%s} is abstract method %s in %s",
+              SHOW(insn), SHOW(callee), SHOW(m_method));
+      } else {
+        refs->invoke_super_targets.insert(callee);
       }
-    } else if (gather_methods && (opcode::is_invoke_virtual(op) ||
-                                  opcode::is_invoke_interface(op))) {
-      auto resolved_callee = resolve_invoke_method(insn, m_method);
-      if (!resolved_callee) {
-        // Typically clone() on an array, or other obscure external references
-        TRACE(REACH, 2, "Unresolved virtual callee at %s", SHOW(insn));
+    }
+  } else if (opcode::is_invoke_virtual(op) || opcode::is_invoke_interface(op)) {
+    auto resolved_callee = resolve_invoke_method(insn, m_method);
+    if (!resolved_callee) {
+      // Typically clone() on an array, or other obscure external references
+      TRACE(REACH, 2, "Unresolved virtual callee at %s", SHOW(insn));
+      refs->unknown_invoke_virtual_targets = true;
+      return;
+    }
+    auto method_ref = insn->get_method();
+    auto base_type = method_ref->get_class();
+    refs->base_invoke_virtual_targets_if_class_instantiable[resolved_callee]
+        .insert(base_type);
+    auto* base_cls = type_class(base_type);
+    always_assert(base_cls);
+    if (base_cls == nullptr || base_cls->is_external() ||
+        (!is_abstract(resolved_callee) && resolved_callee->is_external())) {
+      refs->unknown_invoke_virtual_targets = true;
+    } else if (opcode::is_invoke_interface(op) && is_interface(base_cls)) {
+      // Why can_rename? To mirror what VirtualRenamer looks at.
+      if (root(resolved_callee) || !can_rename(resolved_callee)) {
+        // We cannot rule out that there are dynamically added classes,
+        // possibly even created at runtime via Proxy.newProxyInstance, that
+        // override this method. So we assume the worst.
         refs->unknown_invoke_virtual_targets = true;
-        return;
-      }
-      auto method_ref = insn->get_method();
-      auto base_type = method_ref->get_class();
-      refs->base_invoke_virtual_targets_if_class_instantiable[resolved_callee]
-          .insert(base_type);
-      auto* base_cls = type_class(base_type);
-      always_assert(base_cls);
-      if (base_cls == nullptr || base_cls->is_external() ||
-          (!is_abstract(resolved_callee) && resolved_callee->is_external())) {
+      } else if (is_annotation(base_cls)) {
         refs->unknown_invoke_virtual_targets = true;
-      } else if (opcode::is_invoke_interface(op) && is_interface(base_cls)) {
-        // Why can_rename? To mirror what VirtualRenamer looks at.
-        if (root(resolved_callee) || !can_rename(resolved_callee)) {
-          // We cannot rule out that there are dynamically added classes,
-          // possibly even created at runtime via Proxy.newProxyInstance, that
-          // override this method. So we assume the worst.
-          refs->unknown_invoke_virtual_targets = true;
-        } else if (is_annotation(base_cls)) {
-          refs->unknown_invoke_virtual_targets = true;
+      }
+    }
+  }
+}
+
+bool MethodReferencesGatherer::can_use_references_cache() const {
+  return m_shared_state->method_references_cache != nullptr &&
+         m_consider_code && m_default_gather_mie &&
+         !m_shared_state->relaxed_keep_class_members &&
+         !m_shared_state->cfg_gathering_check_instantiable &&
+         !m_shared_state->cfg_gathering_check_instance_callable &&
+         !m_shared_state->cfg_gathering_check_returning;
+}
+
+void MethodReferencesGatherer::advance_callable_cached(const IRCode& code,
+                                                       References* refs) {
+  auto* cache = m_shared_state->method_references_cache;
+  auto entry = cache->m_entries.get(m_method, nullptr);
+  if (entry && entry->code == &code && !m_method->is_references_dirty()) {
+    cache->m_hits++;
+  } else {
+    cache->m_misses++;
+    // Clear the bit before gathering, so that any later change is noticed.
+    const_cast<DexMethod*>(m_method)->clear_references_dirty();
+    auto fresh = std::make_shared<MethodReferencesCache::Entry>();
+    fresh->code = &code;
+    // Without any of the cfg_gathering_check_* options, all blocks that are
+    // reachable from the entry are visited at once, see advance().
+    auto& cfg = code.cfg();
+    std::unordered_set<cfg::Block*> pushed_blocks{cfg.entry_block()};
+    std::unordered_set<DexType*> covered_catch_types;
+    std::queue<cfg::Block*> queue;
+    queue.push(cfg.entry_block());
+    while (!queue.empty()) {
+      auto* block = queue.front();
+      queue.pop();
+      for (const auto& mie : *block) {
+        if (mie.type == MFLOW_OPCODE) {
+          fresh->instructions_visited++;
+          auto op = mie.insn->opcode();
+          if (opcode::is_invoke_super(op) || opcode::is_invoke_virtual(op) ||
+              opcode::is_invoke_interface(op) || opcode::is_check_cast(op) ||
+              opcode::is_instance_of(op)) {
+            fresh->resolved_insns.push_back(mie.insn);
+          }
+        }
+        gather_code_references(mie, &fresh->refs, /* gather_methods */ true);
+      }
+      for (auto* e : block->succs()) {
+        if (e->type() == cfg::EDGE_THROW) {
+          auto catch_type = e->throw_info()->catch_type;
+          if (catch_type && covered_catch_types.insert(catch_type).second) {
+            fresh->refs.types.push_back(catch_type);
+          }
+        }
+        if (pushed_blocks.insert(e->target()).second) {
+          queue.push(e->target());
         }
       }
-    } else if (opcode::is_a_return(op)) {
-      refs->returns = true;
     }
+    cache->m_entries.insert_or_assign(std::make_pair(m_method, fresh));
+    entry = std::move(fresh);
   }
+
+  const auto& cached = entry->refs;
+  auto append = [](auto& to, const auto& from) {
+    to.insert(to.end(), from.begin(), from.end());
+  };
+  append(refs->strings, cached.strings);
+  append(refs->types, cached.types);
+  append(refs->fields, cached.fields);
+  append(refs->methods, cached.methods);
+  append(refs->new_instances, cached.new_instances);
+  refs->returns |= cached.returns;
+  for (auto* insn : entry->resolved_insns) {
+    // This only adds to classes_if_instantiable here, as there are no
+    // instantiable dependencies without cfg_gathering_check_instantiable.
+    auto instantiable_dep = get_instantiable_dependency(insn, refs);
+    always_assert(!instantiable_dep);
+    gather_invoke_targets(insn, refs);
+  }
+  m_instructions_visited += entry->instructions_visited;
 }
 
 void MethodReferencesGatherer::advance(const Advance& advance,
@@ -962,6 +1054,14 @@ void MethodReferencesGatherer::advance(const Advance& advance,
   if (advance.kind() == AdvanceKind::Callable) {
     std::vector<CFGNeedle> cfg_needles;
     auto code = m_method->get_code();
+    if (code && can_use_references_cache()) {
+      always_assert_log(code->editable_cfg_built(),
+                        "%s does not have editable cfg", SHOW(m_method));
+      advance_callable_cached(*code, refs);
+      m_next_advance_kinds = AdvanceKind::InstantiableDependencyResolved |
+                             AdvanceKind::ReturningDependencyResolved;
+      return;
+    }
     if (code) {
       if (m_consider_code) {
         always_assert_log(code->editable_cfg_built(),
@@ -1914,7 +2014,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool cfg_gathering_check_instance_callable,
     bool cfg_gathering_check_returning,
     bool should_mark_all_as_seed,
-    bool remove_no_argument_constructors) {
+    bool remove_no_argument_constructors,
+    MethodReferencesCache* method_references_cache) {
   Timer t("Marking");
   std::unordered_set<const DexClass*> scope_set(scope.begin(), scope.end());
   auto reachable_objects = std::make_unique<ReachableObjects>();
@@ -1947,7 +2048,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
       &cond_marked,
       reachable_objects.get(),
       reachable_aspects,
-      &stats};
+      &stats,
+      method_references_cache};
 
   workqueue_run<ReachableObject>(
       [&](TransitiveClosureMarkerWorkerState* worker_state,
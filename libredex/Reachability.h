@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -112,6 +114,69 @@ using ReachableObjectGraph =
 
 struct ReachableAspects;
 
+/*
+ * A concurrent set of classes, fields or methods, represented as a bitset over
+ * their dense indices (see e.g. DexMethodRef::get_dense_index()), so that
+ * membership checks and insertions are a single atomic operation on a word.
+ * The bitset covers all objects that existed when the set was created; the
+ * rare objects created afterwards go into an overflow set.
+ */
+template <class Object>
+class MarkedObjects {
+ public:
+  MarkedObjects()
+      : m_num_bits(Object::num_dense_indices()),
+        m_words(new std::atomic<uint64_t>[num_words()]) {
+    for (size_t i = 0; i < num_words(); ++i) {
+      m_words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Returns whether the object was not marked before.
+  bool insert(const Object* obj) {
+    auto idx = obj->get_dense_index();
+    if (idx >= m_num_bits) {
+      if (!m_overflow.insert(obj)) {
+        return false;
+      }
+    } else {
+      uint64_t mask = uint64_t(1) << (idx % 64);
+      if (m_words[idx / 64].fetch_or(mask, std::memory_order_relaxed) & mask) {
+        return false;
+      }
+    }
+    m_size.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool count(const Object* obj) const {
+    auto idx = obj->get_dense_index();
+    if (idx >= m_num_bits) {
+      return m_overflow.count(obj);
+    }
+    uint64_t mask = uint64_t(1) << (idx % 64);
+    return m_words[idx / 64].load(std::memory_order_relaxed) & mask;
+  }
+
+  bool count_unsafe(const Object* obj) const {
+    auto idx = obj->get_dense_index();
+    if (idx >= m_num_bits) {
+      return m_overflow.count_unsafe(obj);
+    }
+    return count(obj);
+  }
+
+  size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+ private:
+  size_t num_words() const { return (m_num_bits + 63) / 64; }
+
+  size_t m_num_bits;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+  ConcurrentSet<const Object*> m_overflow;
+  std::atomic<size_t> m_size{0};
+};
+
 class ReachableObjects {
  public:
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
@@ -166,23 +231,9 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  static constexpr size_t MARK_SLOTS = 127;
-
-  ConcurrentSet<const DexClass*,
-                std::hash<const DexClass*>,
-                std::equal_to<const DexClass*>,
-                MARK_SLOTS>
-      m_marked_classes;
-  ConcurrentSet<const DexFieldRef*,
-                std::hash<const DexFieldRef*>,
-                std::equal_to<const DexFieldRef*>,
-                MARK_SLOTS>
-      m_marked_fields;
-  ConcurrentSet<const DexMethodRef*,
-                std::hash<const DexMethodRef*>,
-                std::equal_to<const DexMethodRef*>,
-                MARK_SLOTS>
-      m_marked_methods;
+  MarkedObjects<DexClass> m_marked_classes;
+  MarkedObjects<DexFieldRef> m_marked_fields;
+  MarkedObjects<DexMethodRef> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
@@ -211,6 +262,8 @@ struct CFGNeedle {
 
 class MethodReferencesGatherer;
 
+class MethodReferencesCache;
+
 using GatherMieFunction = std::function<void(
     MethodReferencesGatherer*, const MethodItemEntry&, References*)>;
 
@@ -273,6 +326,23 @@ class MethodReferencesGatherer {
                           bool gather_methods = true);
 
  private:
+  // The parts of default_gather_mie that only depend on the code itself.
+  void gather_code_references(const MethodItemEntry& mie,
+                              References* refs,
+                              bool gather_methods) const;
+
+  // The parts of default_gather_mie that resolve invoked methods, and thus
+  // depend on the current class hierarchy.
+  void gather_invoke_targets(const IRInstruction* insn,
+                             References* refs) const;
+
+  // Whether gathering from the code reaches all blocks in one go, and yields
+  // the same code references as long as the code does not change.
+  bool can_use_references_cache() const;
+
+  // Callable advance via the MethodReferencesCache.
+  void advance_callable_cached(const IRCode& code, References* refs);
+
   struct InstantiableDependency {
     const DexClass* cls{nullptr};
     bool may_continue_normally_if_uninstantiable{true};
@@ -289,6 +359,7 @@ class MethodReferencesGatherer {
   const TransitiveClosureMarkerSharedState* m_shared_state;
   const DexMethod* m_method;
   bool m_consider_code;
+  bool m_default_gather_mie;
   GatherMieFunction m_gather_mie;
   std::mutex m_mutex;
   std::unordered_set<cfg::Block*> m_pushed_blocks;
@@ -409,6 +480,40 @@ struct References {
   bool maybe_from_code() const;
 };
 
+/*
+ * Keeps what MethodReferencesGatherer collected from the code of each method
+ * across reachability computations, e.g. the repeated runs of
+ * RemoveUnreachablePass, so that later runs only need to look again at
+ * methods whose code may have changed in between (see
+ * DexMethod::is_references_dirty()). Only references that are determined by
+ * the code alone are kept; invoked methods are resolved again in each run, as
+ * the class hierarchy may have changed.
+ *
+ * The cache is only used when gathering does not depend on which classes are
+ * instantiable or which methods return, i.e. without any of the
+ * cfg_gathering_check_* options, and without relaxed_keep_class_members.
+ */
+class MethodReferencesCache final {
+ public:
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    const IRCode* code;
+    // Strings, types, fields, methods, new-instances and returns.
+    References refs;
+    // Instructions whose references must be resolved in each run.
+    std::vector<const IRInstruction*> resolved_insns;
+    uint32_t instructions_visited{0};
+  };
+  ConcurrentMap<const DexMethod*, std::shared_ptr<const Entry>> m_entries;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+
+  friend class MethodReferencesGatherer;
+};
+
 void gather_dynamic_references(const DexAnnotation* item,
                                References* references);
 
@@ -517,6 +622,7 @@ struct TransitiveClosureMarkerSharedState {
   ReachableObjects* reachable_objects;
   ReachableAspects* reachable_aspects;
   Stats* stats;
+  MethodReferencesCache* method_references_cache{nullptr};
 };
 
 using TransitiveClosureMarkerWorkerState = sparta::WorkerState<ReachableObject>;
@@ -702,7 +808,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool cfg_gathering_check_instance_callable = false,
     bool cfg_gathering_check_returning = false,
     bool should_mark_all_as_seed = false,
-    bool remove_no_argument_constructors = false);
+    bool remove_no_argument_constructors = false,
+    MethodReferencesCache* method_references_cache = nullptr);
 
 void compute_zombie_methods(
     const method_override_graph::Graph& method_override_graph,
@@ -23,11 +23,13 @@
 #include "Match.h"
 #include "RedexResources.h"
 #include "ReflectionAnalysis.h"
+#include "ScopedCFG.h"
 #include "Show.h"
 #include "StringUtil.h"
 #include "Trace.h"
 #include "TypeSystem.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -193,9 +195,9 @@ void analyze_reflection(const Scope& scope) {
 
   std::mutex mutation_mutex;
   walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
-    std::unique_ptr<ReflectionAnalysis> analysis = nullptr;
-    code.build_cfg(true, false);
-    auto& cfg = code.cfg();
+    std::shared_ptr<const ReflectionAnalysis> analysis = nullptr;
+    cfg::ScopedCFG scoped_cfg(&code);
+    auto& cfg = *scoped_cfg;
     for (auto& mie : InstructionIterable(cfg)) {
       IRInstruction* insn = mie.insn;
       if (!opcode::is_an_invoke(insn->opcode())) {
@@ -219,13 +221,9 @@ void analyze_reflection(const Scope& scope) {
 
       // Instantiating the analysis object also runs the reflection analysis
       // on the method. So, we wait until we're sure we need it.
-      // We use a unique_ptr so that we'll still only have one per method.
+      // We use a shared_ptr so that we'll still only have one per method.
       if (!analysis) {
-        analysis = std::make_unique<ReflectionAnalysis>(
-            /* dex_method */ method,
-            /* context (interprocedural only) */ nullptr,
-            /* summary_query_fn (interprocedural only) */ nullptr,
-            /* metadata_cache */ &refl_metadata_cache);
+        analysis = get_shared_reflection_analysis(method, &refl_metadata_cache);
       }
 
       const auto& arg_cls = analysis->get_abstract_object(insn->src(0), insn);
@@ -279,7 +277,6 @@ void analyze_reflection(const Scope& scope) {
         break;
       }
     }
-    code.clear_cfg();
   });
 }
 
@@ -360,7 +357,7 @@ bool matches_onclick_method(
 // is overkill. We only need to keep methods "foo" defined on a subclass of
 // android.content.Context that accept 1 argument (an android.view.View).
 void mark_onclick_attributes_reachable(
-    const Scope& scope,
+    const ClassHierarchy& class_hierarchy,
     const std::unordered_set<std::string_view>& onclick_attribute_values) {
   if (onclick_attribute_values.empty()) {
     return;
@@ -368,7 +365,6 @@ void mark_onclick_attributes_reachable(
   auto type_context = DexType::get_type("Landroid/content/Context;");
   always_assert(type_context != nullptr);
 
-  auto class_hierarchy = build_type_hierarchy(scope);
   auto children = get_all_children(class_hierarchy, type_context);
 
   for (const auto& t : children) {
@@ -438,8 +434,18 @@ void mark_manifest_root(const std::string& classname) {
  * are sufficient to statically determine their reachability, so I am taking the
  * conservative approach. This may be worth revisiting.
  */
+ManifestClassInfo read_manifest_class_info(const std::string& apk_dir) {
+  try {
+    auto resources = create_resource_reader(apk_dir);
+    return resources->get_manifest_class_info();
+  } catch (const std::exception& e) {
+    std::cerr << "Error reading manifest: " << e.what() << std::endl;
+    return ManifestClassInfo{};
+  }
+}
+
 void analyze_reachable_from_manifest(
-    const std::string& apk_dir,
+    const ManifestClassInfo& manifest_class_info,
     const std::unordered_set<std::string>& prune_unexported_components_str) {
   std::unordered_map<std::string, ComponentTag> string_to_tag{
       {"activity", ComponentTag::Activity},
@@ -449,16 +455,6 @@ void analyze_reachable_from_manifest(
     prune_unexported_components.emplace(string_to_tag.at(s));
   }
 
-  auto manifest_class_info = [&apk_dir]() {
-    try {
-      auto resources = create_resource_reader(apk_dir);
-      return resources->get_manifest_class_info();
-    } catch (const std::exception& e) {
-      std::cerr << "Error reading manifest: " << e.what() << std::endl;
-      return ManifestClassInfo{};
-    }
-  }();
-
   for (const auto& classname : manifest_class_info.application_classes) {
     mark_manifest_root(classname);
   }
@@ -528,33 +524,43 @@ std::unordered_set<std::string_view> multimap_values_to_set(
   return result;
 }
 
-// 1) Marks classes (Fragments, Views) found in XML layouts as reachable along
-// with their constructors.
-// 2) Marks candidate methods that could be called via android:onClick
-// attributes.
-void analyze_reachable_from_xml_layouts(const Scope& scope,
-                                        const std::string& apk_dir) {
+// What the XML layouts of an app refer to. Reading this is independent of the
+// code, so it can overlap with the analyses of the code.
+struct XmlLayoutReferences {
   std::unordered_set<std::string> layout_classes;
+  std::unordered_multimap<std::string, std::string> attribute_values;
+};
+
+XmlLayoutReferences read_xml_layout_references(const std::string& apk_dir) {
+  XmlLayoutReferences refs;
   std::unordered_set<std::string> attrs_to_read;
   // Method names used by reflection
   attrs_to_read.emplace(ONCLICK_ATTRIBUTE);
-  std::unordered_multimap<std::string, std::string> attribute_values;
   auto resources = create_resource_reader(apk_dir);
   resources->collect_layout_classes_and_attributes(
-      attrs_to_read, &layout_classes, &attribute_values);
-  for (const std::string& classname : layout_classes) {
+      attrs_to_read, &refs.layout_classes, &refs.attribute_values);
+  return refs;
+}
+
+// 1) Marks classes (Fragments, Views) found in XML layouts as reachable along
+// with their constructors.
+// 2) Marks candidate methods that could be called via android:onClick
+// attributes.
+void analyze_reachable_from_xml_layouts(const ClassHierarchy& class_hierarchy,
+                                        const XmlLayoutReferences& refs) {
+  for (const std::string& classname : refs.layout_classes) {
     TRACE(PGR, 4, "xml_layout candidate: %s", classname.c_str());
     mark_reachable_by_xml(classname);
   }
   auto attr_values =
-      multimap_values_to_set(attribute_values, ONCLICK_ATTRIBUTE);
-  mark_onclick_attributes_reachable(scope, attr_values);
+      multimap_values_to_set(refs.attribute_values, ONCLICK_ATTRIBUTE);
+  mark_onclick_attributes_reachable(class_hierarchy, attr_values);
 }
 
 // Set is_serde to be true for all JSON serializer and deserializer classes
 // that extend any one of supercls_names.
 void initialize_reachable_for_json_serde(
-    const Scope& scope, const std::vector<std::string>& supercls_names) {
+    const ClassHierarchy& ch, const std::vector<std::string>& supercls_names) {
   std::unordered_set<const DexType*> serde_superclses;
   for (auto& cls_name : supercls_names) {
     const DexType* supercls = DexType::get_type(cls_name);
@@ -565,30 +571,74 @@ void initialize_reachable_for_json_serde(
   if (serde_superclses.empty()) {
     return;
   }
-  ClassHierarchy ch = build_type_hierarchy(scope);
+  TypeSet children;
   for (auto* serde_supercls : serde_superclses) {
-    for (auto* child : get_all_children(ch, serde_supercls)) {
-      type_class(child)->rstate.set_is_serde();
-    }
+    get_all_children(ch, serde_supercls, children);
   }
+  std::vector<const DexType*> children_vec(children.begin(), children.end());
+  workqueue_run_for<size_t>(0, children_vec.size(), [&](size_t i) {
+    type_class(children_vec[i])->rstate.set_is_serde();
+  });
 }
 
 /*
  * Returns true iff this class or any of its super classes are in the set of
  * classes banned due to use of complex reflection.
  */
-bool in_reflected_pkg(DexClass* dclass,
-                      std::unordered_set<DexClass*>& reflected_pkg_classes) {
-  if (dclass == nullptr) {
-    // Not in our dex files
-    return false;
+bool in_reflected_pkg(
+    const DexClass* dclass,
+    const std::unordered_set<const DexClass*>& reflected_pkg_classes) {
+  for (; dclass != nullptr;
+       dclass = type_class_internal(dclass->get_super_class())) {
+    if (reflected_pkg_classes.count(dclass)) {
+      return true;
+    }
   }
+  // Not in our dex files
+  return false;
+}
 
-  if (reflected_pkg_classes.count(dclass)) {
-    return true;
+/*
+ * Marks the classes in the reflected packages, and the classes that extend
+ * them, as reachable by name.
+ */
+void analyze_reflected_packages(
+    const Scope& scope, const std::vector<std::string>& reflected_packages) {
+  if (reflected_packages.empty()) {
+    return;
+  }
+  std::vector<uint8_t> in_pkg(scope.size());
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    const auto name = scope[i]->get_type()->get_name()->str();
+    for (const auto& pkg : reflected_packages) {
+      if (boost::starts_with(name, pkg)) {
+        in_pkg[i] = true;
+        break;
+      }
+    }
+  });
+  std::unordered_set<const DexClass*> reflected_package_classes;
+  for (size_t i = 0; i < scope.size(); ++i) {
+    if (in_pkg[i]) {
+      reflected_package_classes.insert(scope[i]);
+    }
   }
-  return in_reflected_pkg(type_class_internal(dclass->get_super_class()),
-                          reflected_pkg_classes);
+  if (reflected_package_classes.empty()) {
+    return;
+  }
+  // Every task only marks its own class.
+  walk::parallel::classes(scope, [&](DexClass* clazz) {
+    if (in_reflected_pkg(clazz, reflected_package_classes)) {
+      /* Note:
+       * Some of these are by string, others by type
+       * but we have no way in the config to distinguish
+       * them currently.  So, we mark with the most
+       * conservative sense here.
+       */
+      TRACE(PGR, 3, "reflected_package: %s", SHOW(clazz));
+      mark_reachable_by_classname(clazz);
+    }
+  });
 }
 
 /**
@@ -603,6 +653,11 @@ void analyze_serializable(const Scope& scope) {
   TypeSet children;
   get_all_implementors(scope, serializable, children);
 
+  // We should keep the no argument constructors of the superclasses of
+  // any Serializable class, if they are themselves not Serializable. Many
+  // classes share a superclass, so collect them first, and then mark each one
+  // on its own.
+  std::unordered_set<DexClass*> superclses_set;
   for (auto* child : children) {
     DexClass* child_cls = type_class(child);
     DexType* child_super_type = child_cls->get_super_class();
@@ -610,21 +665,28 @@ void analyze_serializable(const Scope& scope) {
     if (!child_supercls || child_supercls->is_external()) {
       continue;
     }
-    // We should keep the no argument constructors of the superclasses of
-    // any Serializable class, if they are themselves not Serializable.
     if (!children.count(child_super_type)) {
-      for (auto meth : child_supercls->get_dmethods()) {
-        if (method::is_init(meth) && meth->get_proto()->get_args()->empty()) {
-          TRACE(PGR, 3, "serializable super class: no-arg ctor %s", SHOW(meth));
-          meth->rstate.set_root(keep_reason::SERIALIZABLE);
-          // Also mark the super class as referenced_by_string, to retain it in
-          // case there's no other reference to the class itself. Otherwise, the
-          // ctor might be removed after all.
-          child_supercls->rstate.referenced_by_string();
+      superclses_set.insert(child_supercls);
+    }
+  }
+  std::vector<DexClass*> superclses(superclses_set.begin(),
+                                    superclses_set.end());
+  workqueue_run<DexClass*>(
+      [](DexClass* child_supercls) {
+        for (auto meth : child_supercls->get_dmethods()) {
+          if (method::is_init(meth) &&
+              meth->get_proto()->get_args()->empty()) {
+            TRACE(PGR, 3, "serializable super class: no-arg ctor %s",
+                  SHOW(meth));
+            meth->rstate.set_root(keep_reason::SERIALIZABLE);
+            // Also mark the super class as referenced_by_string, to retain it
+            // in case there's no other reference to the class itself.
+            // Otherwise, the ctor might be removed after all.
+            child_supercls->rstate.referenced_by_string();
+          }
         }
-      }
-    }
-  }
+      },
+      superclses);
 }
 
 } // namespace
@@ -655,24 +717,65 @@ void mark_meta_inf_root(const std::string& classname) {
  */
 void init_reachable_classes(const Scope& scope,
                             const ReachableClassesConfig& config) {
+  // Reading the resources of the app and analyzing the code are independent,
+  // so they overlap. Of these, only the reflection analysis marks anything;
+  // everything else is applied afterwards.
+  ManifestClassInfo manifest_class_info;
+  XmlLayoutReferences xml_layout_refs;
+  std::unordered_set<std::string> service_loader_classes;
+  std::unordered_set<std::string> native_classes;
+  ClassHierarchy class_hierarchy;
+  {
+    Timer t{"Analyzing reflection and reading resources"};
+    std::vector<std::function<void()>> tasks;
+    if (!config.apk_dir.empty()) {
+      if (config.compute_xml_reachability) {
+        tasks.emplace_back([&] {
+          manifest_class_info = read_manifest_class_info(config.apk_dir);
+        });
+        tasks.emplace_back([&] {
+          Timer t2{"Reading XML layouts"};
+          xml_layout_refs = read_xml_layout_references(config.apk_dir);
+        });
+      }
+      tasks.emplace_back([&] {
+        auto resources = create_resource_reader(config.apk_dir);
+        service_loader_classes = resources->get_service_loader_classes();
+        if (config.analyze_native_lib_reachability) {
+          Timer t2{"Reading native classes"};
+          // Classnames present in native libraries (lib/*/*.so)
+          native_classes = resources->get_native_classes();
+        }
+      });
+    }
+    tasks.emplace_back([&] {
+      Timer t2{"Analyzing reflection"};
+      analyze_reflection(scope);
+    });
+    tasks.emplace_back([&] {
+      Timer t2{"Building class hierarchy"};
+      class_hierarchy = build_type_hierarchy(scope);
+    });
+    workqueue_run<std::function<void()>>(
+        [](const std::function<void()>& fn) { fn(); }, tasks, tasks.size());
+  }
+
   if (!config.apk_dir.empty()) {
     if (config.compute_xml_reachability) {
       Timer t{"Computing XML reachability"};
       // Classes present in manifest
-      analyze_reachable_from_manifest(config.apk_dir,
+      analyze_reachable_from_manifest(manifest_class_info,
                                       config.prune_unexported_components);
       // Classes present in XML layouts
-      analyze_reachable_from_xml_layouts(scope, config.apk_dir);
+      analyze_reachable_from_xml_layouts(class_hierarchy, xml_layout_refs);
     }
-    auto resources = create_resource_reader(config.apk_dir);
-    for (const auto& classname : resources->get_service_loader_classes()) {
+    for (const auto& classname : service_loader_classes) {
       mark_meta_inf_root(classname);
     }
 
     if (config.analyze_native_lib_reachability) {
       Timer t{"Computing native reachability"};
-      // Classnames present in native libraries (lib/*/*.so)
-      for (const std::string& classname : resources->get_native_classes()) {
+      for (const std::string& classname : native_classes) {
         auto type = DexType::get_type(classname);
         if (type == nullptr) continue;
         TRACE(PGR, 3, "native_lib: %s", classname.c_str());
@@ -684,7 +787,9 @@ void init_reachable_classes(const Scope& scope,
         mark_native_classes_from_fbjni_configs(config.fbjni_json_files);
       }
     }
-    walk::methods(scope, [&](DexMethod* meth) {
+    // Methods are walked class by class, so every task only marks its own
+    // class and methods.
+    walk::parallel::methods(scope, [&](DexMethod* meth) {
       // These were probably already marked by the native lib reachability
       // analysis above, but just to be doubly sure...
       if (is_native(meth)) {
@@ -696,31 +801,8 @@ void init_reachable_classes(const Scope& scope,
   }
 
   {
-    Timer t{"Analyzing reflection"};
-    analyze_reflection(scope);
-    std::unordered_set<DexClass*> reflected_package_classes;
-    for (auto clazz : scope) {
-      const auto name = clazz->get_type()->get_name()->str();
-      for (const auto& pkg : config.reflected_package_names) {
-        if (boost::starts_with(name, pkg)) {
-          reflected_package_classes.insert(clazz);
-          continue;
-        }
-      }
-    }
-    for (auto clazz : scope) {
-      if (in_reflected_pkg(clazz, reflected_package_classes)) {
-        reflected_package_classes.insert(clazz);
-        /* Note:
-         * Some of these are by string, others by type
-         * but we have no way in the config to distinguish
-         * them currently.  So, we mark with the most
-         * conservative sense here.
-         */
-        TRACE(PGR, 3, "reflected_package: %s", SHOW(clazz));
-        mark_reachable_by_classname(clazz);
-      }
-    }
+    Timer t{"Analyzing reflected packages"};
+    analyze_reflected_packages(scope, config.reflected_package_names);
   }
 
   {
@@ -730,7 +812,8 @@ void init_reachable_classes(const Scope& scope,
 
   {
     Timer t{"Initializing for json serde"};
-    initialize_reachable_for_json_serde(scope, config.json_serde_supercls);
+    initialize_reachable_for_json_serde(class_hierarchy,
+                                        config.json_serde_supercls);
   }
 }
 
@@ -751,7 +834,8 @@ void recompute_reachable_from_xml_layouts(const Scope& scope,
       field->rstate.unset_referenced_by_resource_xml();
     }
   });
-  analyze_reachable_from_xml_layouts(scope, apk_dir);
+  analyze_reachable_from_xml_layouts(build_type_hierarchy(scope),
+                                     read_xml_layout_references(apk_dir));
 }
 
 std::string ReferencedState::str() const {
@@ -17,6 +17,7 @@
 #include "Debug.h"
 #include "DexCallSite.h"
 #include "DexClass.h"
+#include "DexIdx.h"
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "KeepReason.h"
@@ -78,16 +79,10 @@ RedexContext::~RedexContext() {
                 },
                 [&] {
                   Timer timer("Delete DexTypeLists", /* indent */ false);
-                  for (auto const& p : s_typelist_map) {
-                    delete p.second;
-                  }
-                  s_typelist_map.clear();
+                  s_typelist_set.clear();
                 },
                 [&] {
                   Timer timer("Delete DexProtos", /* indent */ false);
-                  for (auto* proto : s_proto_set) {
-                    delete proto;
-                  }
                   s_proto_set.clear();
                 },
                 [&] {
@@ -182,7 +177,7 @@ RedexContext::~RedexContext() {
   parallel_run(
       [&]() {
         std::vector<std::function<void()>> fns;
-        fns.reserve(s_small_string_set.size() + s_large_string_set.slots());
+        fns.reserve(s_small_string_set.size() + 1);
         for (size_t i = 0; i < s_small_string_set.size(); ++i) {
           auto* small_string_set = s_small_string_set[i];
           small_strings_size += small_string_set->size();
@@ -191,10 +186,8 @@ RedexContext::~RedexContext() {
             delete small_string_set;
           });
         }
-        for (auto& segment : s_large_string_set) {
-          large_strings_size += segment.size();
-          fns.push_back([&segment]() { segment.release(); });
-        }
+        large_strings_size = s_large_string_set.size();
+        fns.push_back([this]() { s_large_string_set.clear(); });
         return fns;
       }(),
       "Delete DexStrings");
@@ -220,21 +213,6 @@ RedexContext::~RedexContext() {
         boost::thread::hardware_concurrency(), oss.str().c_str());
 }
 
-/*
- * Try and insert :key into :container. This insertion may fail if
- * another thread has already inserted that key. In that case, return the
- * existing value and discard the one we were trying to insert.
- */
-template <class Key, class Deleter = std::default_delete<Key>, class Container>
-static const Key* const* try_insert(std::unique_ptr<Key, Deleter> key,
-                                    Container* container) {
-  auto [rv_ptr, inserted] = container->insert(key.get());
-  if (inserted) {
-    (void)key.release();
-  }
-  return rv_ptr;
-}
-
 /*
  * Try and insert (:key, :value) into :container. This insertion may fail if
  * another thread has already inserted that key. In that case, return the
@@ -259,6 +237,29 @@ static StoredValue* try_insert(Key key,
   return ptr->load();
 }
 
+/*
+ * Lock the stripes of :locks for the classes a member spec is mutated from and
+ * to. All specs a mutation checks for collisions have the new class, so that
+ * mutations of members of unrelated classes can go ahead concurrently. The
+ * stripes are locked in index order to avoid deadlocks.
+ */
+template <size_t N>
+static std::pair<std::unique_lock<std::mutex>, std::unique_lock<std::mutex>>
+lock_spec_stripes(std::array<std::mutex, N>& locks,
+                  const DexType* old_cls,
+                  const DexType* new_cls) {
+  auto first = std::hash<const DexType*>()(old_cls) % N;
+  auto second = std::hash<const DexType*>()(new_cls) % N;
+  if (first > second) {
+    std::swap(first, second);
+  }
+  std::unique_lock<std::mutex> first_lock(locks[first]);
+  if (first == second) {
+    return {std::move(first_lock), std::unique_lock<std::mutex>()};
+  }
+  return {std::move(first_lock), std::unique_lock<std::mutex>(locks[second])};
+}
+
 RedexContext::ConcurrentStringStorage::Container::~Container() {
   for (const auto* p = buffer; p;) {
     auto next = p->next;
@@ -388,6 +389,26 @@ char* RedexContext::store_string(std::string_view str) {
 }
 
 const DexString* RedexContext::make_string(std::string_view str) {
+  return intern_string(str, /* in_place */ false);
+}
+
+const DexString* RedexContext::make_string_in_place(std::string_view str) {
+  redex_assert(str.data()[str.size()] == '\0');
+  return intern_string(str, /* in_place */ true);
+}
+
+void RedexContext::retain_mapped_file(RedexMappedFile file) {
+  std::lock_guard<std::mutex> lock(m_retained_files_lock);
+  m_retained_files.push_back(std::move(file));
+}
+
+void RedexContext::retain_dex_idx(std::unique_ptr<DexIdx> idx) {
+  std::lock_guard<std::mutex> lock(m_retained_files_lock);
+  m_retained_idxs.push_back(std::move(idx));
+}
+
+const DexString* RedexContext::intern_string(std::string_view str,
+                                             bool in_place) {
   auto mutf8_next_cp = [](const char*& s) -> uint32_t {
     uint8_t v = *s++;
     /* Simple common case first, a utf8 char... */
@@ -431,7 +452,7 @@ const DexString* RedexContext::make_string(std::string_view str) {
     if (rv_ptr != nullptr) {
       return reinterpret_cast<const DexString*>(rv_ptr);
     }
-    char* storage = store_string(str);
+    const char* storage = in_place ? str.data() : store_string(str);
     uint32_t utfsize = length_of_utf8_string(storage);
     return reinterpret_cast<const DexString*>(
         s_small_string_set[str.size()]
@@ -440,40 +461,36 @@ const DexString* RedexContext::make_string(std::string_view str) {
     // If unsuccessful, we have wasted a bit of string storage. Oh well...
   }
 
-  auto* key = reinterpret_cast<const DexString*>(&repr);
-  auto& segment = s_large_string_set.at(key);
-  auto rv_ptr = segment.get(key);
+  auto* rv_ptr = s_large_string_set.get(repr);
   if (rv_ptr != nullptr) {
-    return *rv_ptr;
+    return reinterpret_cast<const DexString*>(rv_ptr);
   }
-  char* storage = store_string(str);
+  const char* storage = in_place ? str.data() : store_string(str);
   uint32_t utfsize = length_of_utf8_string(storage);
-  std::unique_ptr<DexString> string(
-      new DexString(storage, str.length(), utfsize));
-  return *try_insert(std::move(string), &segment);
+  return reinterpret_cast<const DexString*>(
+      s_large_string_set
+          .insert(DexStringRepr{storage, (uint32_t)str.length(), utfsize})
+          .first);
   // If unsuccessful, we have wasted a bit of string storage. Oh well...
 }
 
-size_t RedexContext::StringSetKeyHash::operator()(StringSetKey k) const {
-  return k->size();
-}
-
-bool RedexContext::StringSetKeyCompare::operator()(StringSetKey a,
-                                                   StringSetKey b) const {
-  if (a->size() != b->size()) {
-    return a->size() < b->size();
-  }
-  return memcmp(a->c_str(), b->c_str(), a->size()) < 0;
-}
-
-size_t RedexContext::TruncatedStringHash::operator()(StringSetKey k) {
-  const char* s = k->c_str();
-  uint32_t string_size = k->size();
+// Hash the length and two 32-byte windows of the string: one offset by 32
+// bytes from the start, and the end. Dex files tend to contain many strings
+// with the same prefixes, because every class / method under a given package
+// will share the same prefix. The first window stays within one cache line,
+// while the second one covers the most distinguishing part of a type name.
+size_t RedexContext::LargeDexStringReprHash::operator()(
+    const DexStringRepr& k) const {
   constexpr size_t hash_prefix_len = 32;
   constexpr size_t offset = 32;
-  size_t len = std::min<size_t>(string_size, offset + hash_prefix_len);
+  const char* s = k.storage;
+  size_t len = std::min<size_t>(k.length, offset + hash_prefix_len);
   size_t start = std::max<int64_t>(0, int64_t(len - hash_prefix_len));
-  return boost::hash_range(s + start, s + len);
+  size_t hash = k.length;
+  boost::hash_combine(hash, boost::hash_range(s + start, s + len));
+  size_t suffix_start = std::max<int64_t>(len, int64_t(k.length) - 32);
+  boost::hash_combine(hash, boost::hash_range(s + suffix_start, s + k.length));
+  return hash;
 }
 
 size_t RedexContext::DexStringReprHash::operator()(
@@ -497,10 +514,7 @@ const DexString* RedexContext::get_string(std::string_view str) {
         s_small_string_set[str.size()]->get(repr));
   }
 
-  auto* key = reinterpret_cast<const DexString*>(&repr);
-  const auto& segment = s_large_string_set.at(key);
-  auto rv_ptr = segment.get(key);
-  return rv_ptr == nullptr ? nullptr : *rv_ptr;
+  return reinterpret_cast<const DexString*>(s_large_string_set.get(repr));
 }
 
 DexType* RedexContext::make_type(const DexString* dstring) {
@@ -521,10 +535,24 @@ DexType* RedexContext::get_type(const DexString* dstring) {
 }
 
 void RedexContext::set_type_name(DexType* type, const DexString* new_name) {
+  hashing::invalidate_cached_hashes();
   alias_type_name(type, new_name);
   type->m_name = new_name;
 }
 
+void RedexContext::set_type_names(
+    const std::vector<std::pair<DexType*, const DexString*>>& renames) {
+  hashing::invalidate_cached_hashes();
+  workqueue_run_for<size_t>(0, renames.size(), [&](size_t i) {
+    auto [type, new_name] = renames[i];
+    always_assert_log(
+        s_type_map.emplace(new_name, type).second,
+        "Bailing, attempting to alias a symbol that already exists! '%s'\n",
+        new_name->c_str());
+    type->m_name = new_name;
+  });
+}
+
 void RedexContext::alias_type_name(DexType* type, const DexString* new_name) {
   always_assert_log(
       !s_type_map.count(new_name),
@@ -595,7 +623,15 @@ void RedexContext::erase_field(const DexType* container,
 void RedexContext::mutate_field(DexFieldRef* field,
                                 const DexFieldSpec& ref,
                                 bool rename_on_collision) {
-  std::lock_guard<std::mutex> lock(s_field_lock);
+  hashing::invalidate_cached_hashes();
+  if (ref.cls != nullptr && ref.cls != field->m_spec.cls) {
+    // Pending annotations are decoded through the class of the member, so
+    // they have to be decoded before it moves elsewhere.
+    lazy_annotations::materialize_if_pending(field->m_spec.cls);
+  }
+  auto locks = lock_spec_stripes(
+      s_field_locks, field->m_spec.cls,
+      ref.cls != nullptr ? ref.cls : field->m_spec.cls);
   DexFieldSpec& r = field->m_spec;
   s_field_map.erase(r);
   r.cls = ref.cls != nullptr ? ref.cls : field->m_spec.cls;
@@ -618,43 +654,57 @@ void RedexContext::mutate_field(DexFieldRef* field,
   s_field_map.emplace(r, field);
 }
 
+size_t RedexContext::DexTypeListReprHash::operator()(
+    const DexTypeListRepr& k) const {
+  return k.hash;
+}
+
+bool RedexContext::DexTypeListReprEqual::operator()(
+    const DexTypeListRepr& a, const DexTypeListRepr& b) const {
+  return a.hash == b.hash && a.list == b.list;
+}
+
 DexTypeList* RedexContext::make_type_list(
     RedexContext::DexTypeListContainerType&& p) {
-  auto rv = s_typelist_map.load(&p, nullptr);
-  if (rv != nullptr) {
-    return rv;
+  auto hash = boost::hash<DexTypeListContainerType>()(p);
+  DexTypeListRepr repr{std::move(p), hash};
+  auto* rv_ptr = s_typelist_set.get(repr);
+  if (rv_ptr == nullptr) {
+    rv_ptr = s_typelist_set.insert(std::move(repr)).first;
   }
-  std::unique_ptr<DexTypeList> typelist(new DexTypeList(std::move(p)));
-  auto key = &typelist->m_list;
-  return try_insert(key, std::move(typelist), &s_typelist_map);
+  return reinterpret_cast<DexTypeList*>(const_cast<DexTypeListRepr*>(rv_ptr));
 }
 
 DexTypeList* RedexContext::get_type_list(
     const RedexContext::DexTypeListContainerType& p) {
-  return s_typelist_map.load(&p, nullptr);
+  // Copies the list, but this is rarely used.
+  DexTypeListRepr repr{p, boost::hash<DexTypeListContainerType>()(p)};
+  return reinterpret_cast<DexTypeList*>(
+      const_cast<DexTypeListRepr*>(s_typelist_set.get(repr)));
 }
 
-size_t RedexContext::DexProtoKeyHash::operator()(DexProto* k) const {
-  return (size_t)k->get_rtype() ^ (size_t)k->get_args();
+size_t RedexContext::DexProtoReprHash::operator()(const DexProtoRepr& k) const {
+  size_t hash = (size_t)k.rtype;
+  boost::hash_combine(hash, (size_t)k.args);
+  return hash;
 }
-bool RedexContext::DexProtoKeyEqual::operator()(DexProto* a,
-                                                DexProto* b) const {
-  return a->get_rtype() == b->get_rtype() && a->get_args() == b->get_args();
+
+bool RedexContext::DexProtoReprEqual::operator()(const DexProtoRepr& a,
+                                                 const DexProtoRepr& b) const {
+  return a.rtype == b.rtype && a.args == b.args;
 }
 
 DexProto* RedexContext::make_proto(const DexType* rtype,
                                    const DexTypeList* args,
                                    const DexString* shorty) {
   always_assert(rtype != nullptr && args != nullptr && shorty != nullptr);
-  DexProto key(const_cast<DexType*>(rtype), const_cast<DexTypeList*>(args),
-               nullptr);
-  auto rv_ptr = s_proto_set.get(&key);
-  if (rv_ptr != nullptr) {
-    return const_cast<DexProto*>(*rv_ptr);
+  DexProtoRepr repr{const_cast<DexTypeList*>(args),
+                    const_cast<DexType*>(rtype), shorty};
+  auto* rv_ptr = s_proto_set.get(repr);
+  if (rv_ptr == nullptr) {
+    rv_ptr = s_proto_set.insert(repr).first;
   }
-  std::unique_ptr<DexProto> proto(new DexProto(
-      const_cast<DexType*>(rtype), const_cast<DexTypeList*>(args), shorty));
-  return const_cast<DexProto*>(*try_insert(std::move(proto), &s_proto_set));
+  return reinterpret_cast<DexProto*>(const_cast<DexProtoRepr*>(rv_ptr));
 }
 
 DexProto* RedexContext::get_proto(const DexType* rtype,
@@ -662,10 +712,10 @@ DexProto* RedexContext::get_proto(const DexType* rtype,
   if (rtype == nullptr || args == nullptr) {
     return nullptr;
   }
-  DexProto key(const_cast<DexType*>(rtype), const_cast<DexTypeList*>(args),
-               nullptr);
-  auto rv_ptr = s_proto_set.get(&key);
-  return rv_ptr == nullptr ? nullptr : const_cast<DexProto*>(*rv_ptr);
+  DexProtoRepr repr{const_cast<DexTypeList*>(args),
+                    const_cast<DexType*>(rtype), nullptr};
+  return reinterpret_cast<DexProto*>(
+      const_cast<DexProtoRepr*>(s_proto_set.get(repr)));
 }
 
 DexMethodRef* RedexContext::make_method(const DexType* type_,
@@ -741,7 +791,14 @@ void RedexContext::erase_method(const DexType* type,
 void RedexContext::mutate_method(DexMethodRef* method,
                                  const DexMethodSpec& new_spec,
                                  bool rename_on_collision) {
-  std::lock_guard<std::mutex> lock(s_method_lock);
+  hashing::invalidate_cached_hashes();
+  if (new_spec.cls != nullptr && new_spec.cls != method->m_spec.cls) {
+    // See mutate_field.
+    lazy_annotations::materialize_if_pending(method->m_spec.cls);
+  }
+  auto locks = lock_spec_stripes(
+      s_method_locks, method->m_spec.cls,
+      new_spec.cls != nullptr ? new_spec.cls : method->m_spec.cls);
   DexMethodSpec old_spec = method->m_spec;
   s_method_map.erase(method->m_spec);
 
@@ -861,6 +918,13 @@ bool RedexContext::class_already_loaded(DexClass* cls) {
   } else {
     const auto& prev_loc = prev_cls->get_location()->get_file_name();
     const auto& cur_loc = cls->get_location()->get_file_name();
+    if (library_classes_preloaded && prev_cls->is_external() &&
+        !cls->is_external()) {
+      throw RedexException(
+          RedexError::DUPLICATE_CLASSES,
+          "Found a dex class that shadows a preloaded library class.",
+          {{"class", show(cls)}, {"jar", prev_loc}, {"dex", cur_loc}});
+    }
     if (prev_loc == cur_loc || dup_classes::is_known_dup(cls)) {
       // benign duplicates
       TRACE(MAIN, 1, "Warning: found a duplicate class: %s", SHOW(cls));
@@ -902,7 +966,7 @@ void RedexContext::publish_class(DexClass* cls) {
 }
 
 DexClass* RedexContext::type_class(const DexType* t) const {
-  return t ? t->m_self.load(std::memory_order_relaxed) : nullptr;
+  return ::type_class(t);
 }
 
 DexType* RedexContext::class_type(const DexClass* cls) const {
@@ -956,6 +1020,26 @@ void RedexContext::set_sb_interaction_index(
   m_sb_interaction_indices = input;
 }
 
+RedexContext::InterningStats RedexContext::get_interning_stats() const {
+  InterningStats stats;
+  stats.strings = s_large_string_set.size();
+  for (const auto* small_string_set : s_small_string_set) {
+    stats.strings += small_string_set->size();
+  }
+  for (const auto* storage : {&s_small_string_storage,
+                              &s_medium_string_storage,
+                              &s_large_string_storage}) {
+    stats.string_bytes_allocated += storage->get_stats().allocated;
+  }
+  stats.types = s_type_map.size();
+  stats.type_lists = s_typelist_set.size();
+  stats.protos = s_proto_set.size();
+  stats.fields = s_field_map.size();
+  stats.methods = s_method_map.size();
+  stats.classes = m_classes.size();
+  return stats;
+}
+
 void RedexContext::compact() {
   // We parallelize destruction for efficiency.
   auto parallel_run = [](const std::vector<std::function<void()>>& fns) {
@@ -966,7 +1050,7 @@ void RedexContext::compact() {
   parallel_run({
       [&] { s_type_map.compact(); },
       [&] { s_field_map.compact(); },
-      [&] { s_typelist_map.compact(); },
+      [&] { s_typelist_set.compact(); },
       [&] { s_proto_set.compact(); },
       [&] { s_method_map.compact(); },
       [&] { s_location_map.compact(); },
@@ -27,6 +27,7 @@
 #include "Debug.h"
 #include "DexMemberRefs.h"
 #include "FrequentlyUsedPointersCache.h"
+#include "RedexMappedFile.h"
 
 class DexCallSite;
 class DexClass;
@@ -34,14 +35,17 @@ class DexLocation;
 class DexDebugInstruction;
 class DexField;
 class DexFieldRef;
+class DexIdx;
 class DexMethod;
 class DexMethodHandle;
 class DexMethodRef;
 class DexProto;
 class DexString;
+struct DexProtoRepr;
 struct DexStringRepr;
 class DexType;
 class DexTypeList;
+struct DexTypeListRepr;
 class PositionPatternSwitchManager;
 struct DexDebugEntry;
 struct DexFieldSpec;
@@ -64,6 +68,28 @@ struct RedexContext {
   const DexString* make_string(std::string_view s);
   const DexString* get_string(std::string_view s);
 
+  /**
+   * Like make_string, but if the string does not exist yet, the new DexString
+   * refers to the given data instead of a copy of it. The data must be
+   * zero-terminated, and must not change or go away for the lifetime of the
+   * context; see retain_mapped_file.
+   */
+  const DexString* make_string_in_place(std::string_view s);
+
+  /**
+   * Keep a mapped file alive for the lifetime of the context, e.g. because
+   * DexStrings were created in place in its data.
+   */
+  void retain_mapped_file(RedexMappedFile file);
+
+  /**
+   * Keep the index of a loaded dex alive for the lifetime of the context,
+   * because the code of its methods will only be decoded on first access; see
+   * lazy_dex_code and lazy_dex_annotations. The dex data itself has to be
+   * retained as well.
+   */
+  void retain_dex_idx(std::unique_ptr<DexIdx> idx);
+
   DexType* make_type(const DexString* dstring);
   DexType* get_type(const DexString* dstring);
 
@@ -71,6 +97,12 @@ struct RedexContext {
    * Change the name of a type, but do not remove the old name from the mapping
    */
   void set_type_name(DexType* type, const DexString* new_name);
+  /**
+   * Like set_type_name for many types at once. The new names are added to the
+   * mapping in parallel, and cached hashes are only invalidated once.
+   */
+  void set_type_names(
+      const std::vector<std::pair<DexType*, const DexString*>>& renames);
   /**
    * Add an additional name to refer to a type (a deobfuscated name for example)
    */
@@ -213,6 +245,28 @@ struct RedexContext {
   // This is for convenience.
   bool instrument_mode{false};
 
+  // Whether DexStrings of loaded dex files refer directly to the memory-mapped
+  // string data of those files, instead of copying it.
+  bool zero_copy_dex_strings{false};
+
+  // Whether the code of methods in loaded dex files is only decoded and
+  // ballooned into IRCode when it is first accessed, instead of at load time.
+  bool lazy_dex_code{false};
+
+  // Whether the annotations of classes in loaded dex files, and of their
+  // members, are only decoded when they are first accessed.
+  bool lazy_dex_annotations{false};
+
+  // Whether the editable CFG of methods is built right when their code is
+  // ballooned, so that the IRList with its try, catch and branch target markers
+  // only lives briefly instead of until a pass first asks for the CFG.
+  bool build_cfg_at_balloon{false};
+
+  // Whether the classes of library jars were loaded before any dex, see
+  // `redex-all --serve`. Dex classes cannot shadow them then, as they usually
+  // would, so loading a dex class that a library jar defines fails.
+  bool library_classes_preloaded{false};
+
   bool ordering_changes_allowed() const { return m_ordering_changes_allowed; }
   void set_ordering_changes_allowed(bool new_val) {
     m_ordering_changes_allowed = new_val;
@@ -225,12 +279,23 @@ struct RedexContext {
   // versions.
   void compact();
 
+  // Sizes of the interning tables, for memory attribution. Must not be called
+  // while other threads are interning strings.
+  struct InterningStats {
+    size_t strings{0};
+    size_t string_bytes_allocated{0};
+    size_t types{0};
+    size_t type_lists{0};
+    size_t protos{0};
+    size_t fields{0};
+    size_t methods{0};
+    size_t classes{0};
+  };
+  InterningStats get_interning_stats() const;
+
   InsertOnlyConcurrentSet<const DexString*> library_names;
 
  private:
-  struct Strcmp;
-  struct TruncatedStringHash;
-
   // A thread-safe container for raw string storage
   struct ConcurrentStringStorage {
     static constexpr size_t n_slots = 11;
@@ -304,105 +369,19 @@ struct RedexContext {
     }
   };
 
-  // Hashing is expensive on large strings (long Java type names, string
-  // literals), so we avoid using `std::unordered_map` directly.
+  // All strings are interned in `InsertOnlyConcurrentSet`s, which are backed
+  // by `ConcurrentHashtable`s: lookups take no locks, and an insertion that
+  // finds an existing string does not either.
   //
-  // For leaf-level storage we use `std::set` (i.e., a tree). In a sparse
-  // string keyset with large keys this performs better as only the suffix
-  // until first change needs to be compared.
-  //
-  // For sharding, we use two layers. The first layer is a partial string
-  // hash as defined by `TruncatedStringHash`. It picks a segment "close"
-  // to the front and performs reasonably well. A std::array is used for
-  // sharding here (see `LargeStringMap`).
-  //
-  // The second layer optimizes the string comparison. We have additional
-  // data besides the string data pointer, namely the UTF size. We can
-  // avoid comparisons for different string lengths. The second layer
-  // thus shards over it. We use the `ConcurrentContainer` sharding for
-  // this (see `ConcurrentProjectedStringSet`).
-  //
-  // The two layers give infrastructure overhead, however, the base size
-  // of a `std::set` and `ConcurrentContainer` is quite small.
-  //
-  // We use `const DexString*` for the keys, however, we have to be careful not
-  // to assume that the referenced `const char*` data is zero-terminated.
-  using StringSetKey = const DexString*;
-  struct StringSetKeyHash {
-    size_t operator()(StringSetKey k) const;
-  };
-  struct StringSetKeyCompare {
-    bool operator()(StringSetKey a, StringSetKey b) const;
-  };
-
-  template <size_t n_slots = 31>
-  class ConcurrentProjectedStringSet {
-    std::array<std::set<StringSetKey, StringSetKeyCompare>, n_slots> m_slots;
-    mutable std::array<std::mutex, n_slots> m_locks;
-
-   public:
-    const StringSetKey* get(StringSetKey str) const {
-      size_t i = StringSetKeyHash()(str) % n_slots;
-      auto& map = m_slots[i];
-      std::lock_guard<std::mutex> lock(m_locks[i]);
-      auto it = map.find(str);
-      return it == map.end() ? nullptr : &*it;
-    }
-
-    std::pair<const StringSetKey*, bool> insert(StringSetKey str) {
-      size_t i = StringSetKeyHash()(str) % n_slots;
-      auto& map = m_slots[i];
-      std::lock_guard<std::mutex> lock(m_locks[i]);
-      auto [it, emplaced] = map.emplace(str);
-      return std::make_pair(&*it, emplaced);
-    }
-
-    size_t size() const {
-      size_t res = 0;
-      for (auto& set : m_slots) {
-        res += set.size();
-      }
-      return res;
-    }
-
-    void release() {
-      for (auto& set : m_slots) {
-        for (auto* s : set) {
-          delete s;
-        }
-        set.clear();
-      }
-    }
-  };
-
-  template <size_t n_slots, size_t m_slots>
-  struct LargeStringSet {
-    using AType = std::array<ConcurrentProjectedStringSet<n_slots>, m_slots>;
-
-    AType sets;
-
-    ConcurrentProjectedStringSet<n_slots>& at(StringSetKey k) {
-      size_t hashed = TruncatedStringHash()(k) % m_slots;
-      return sets[hashed];
-    }
-
-    typename AType::iterator begin() { return sets.begin(); }
-    typename AType::iterator end() { return sets.end(); }
-
-    size_t slots() const { return sets.size(); }
-  };
-
-  // Hash a 32-byte subsequence of a given string, offset by 32 bytes from the
-  // start. Dex files tend to contain many strings with the same prefixes,
-  // because every class / method under a given package will share the same
-  // prefix. The offset ensures that we have more unique subsequences to hash.
+  // Short strings go into one set per length, which spreads out the load and
+  // makes the (full) hash cheap. Hashing is expensive on large strings (long
+  // Java type names, string literals), so for those we only hash the length
+  // and two sampled windows as defined by `LargeDexStringReprHash`.
   //
-  // An offset of 32 and hash prefix length of 32 seemed to perform best on the
-  // typical strings in an android app. It's important to remain within one
-  // cache line (offset + hash_prefix_len <= 64) and hash enough of the string
-  // to minimize the chance of duplicate sections
-  struct TruncatedStringHash {
-    size_t operator()(StringSetKey k);
+  // We have to be careful not to assume that the referenced `const char*` data
+  // of a lookup key is zero-terminated.
+  struct LargeDexStringReprHash {
+    size_t operator()(const DexStringRepr& k) const;
   };
 
   struct DexStringReprHash {
@@ -413,7 +392,10 @@ struct RedexContext {
   };
 
   // DexString
-  LargeStringSet<31, 127> s_large_string_set;
+  InsertOnlyConcurrentSet<DexStringRepr,
+                          LargeDexStringReprHash,
+                          DexStringReprEqual>
+      s_large_string_set;
   std::array<InsertOnlyConcurrentSet<DexStringRepr,
                                      DexStringReprHash,
                                      DexStringReprEqual>*,
@@ -426,45 +408,43 @@ struct RedexContext {
   ConcurrentStringStorage s_large_string_storage;
 
   char* store_string(std::string_view);
+  const DexString* intern_string(std::string_view, bool in_place);
 
   // DexType
   AtomicMap<const DexString*, DexType*> s_type_map;
 
   // DexFieldRef
   AtomicMap<DexFieldSpec, DexFieldRef*> s_field_map;
-  std::mutex s_field_lock;
-
-  // DexTypeList
-  struct DexTypeListContainerTypePtrHash {
-    size_t operator()(const DexTypeListContainerType* d) const {
-      return boost::hash<DexTypeListContainerType>()(*d);
-    }
+  // Striped by class, see mutate_field().
+  std::array<std::mutex, 64> s_field_locks;
+
+  // DexTypeList and DexProto are interned in place like strings, in
+  // `InsertOnlyConcurrentSet`s whose nodes live in arenas. The hash of a type
+  // list is computed once, when it gets interned, and then stored with it.
+  struct DexTypeListReprHash {
+    size_t operator()(const DexTypeListRepr& k) const;
   };
-  struct DexTypeListContainerTypePtrEquals {
-    size_t operator()(const DexTypeListContainerType* lhs,
-                      const DexTypeListContainerType* rhs) const {
-      return lhs == rhs || *lhs == *rhs;
-    }
+  struct DexTypeListReprEqual {
+    bool operator()(const DexTypeListRepr& a, const DexTypeListRepr& b) const;
   };
-  AtomicMap<const DexTypeListContainerType*,
-            DexTypeList*,
-            DexTypeListContainerTypePtrHash,
-            DexTypeListContainerTypePtrEquals>
-      s_typelist_map;
-
-  // DexProto
-  struct DexProtoKeyHash {
-    size_t operator()(DexProto* k) const;
+  InsertOnlyConcurrentSet<DexTypeListRepr,
+                          DexTypeListReprHash,
+                          DexTypeListReprEqual>
+      s_typelist_set;
+
+  struct DexProtoReprHash {
+    size_t operator()(const DexProtoRepr& k) const;
   };
-  struct DexProtoKeyEqual {
-    bool operator()(DexProto* a, DexProto* b) const;
+  struct DexProtoReprEqual {
+    bool operator()(const DexProtoRepr& a, const DexProtoRepr& b) const;
   };
-  InsertOnlyConcurrentSet<DexProto*, DexProtoKeyHash, DexProtoKeyEqual>
+  InsertOnlyConcurrentSet<DexProtoRepr, DexProtoReprHash, DexProtoReprEqual>
       s_proto_set;
 
   // DexMethod
   AtomicMap<DexMethodSpec, DexMethodRef*> s_method_map;
-  std::mutex s_method_lock;
+  // Striped by class, see mutate_method().
+  std::array<std::mutex, 64> s_method_locks;
 
   // DexLocation
   using ClassLocationKey = std::pair<std::string_view, std::string_view>;
@@ -492,6 +472,10 @@ struct RedexContext {
 
   std::unordered_map<std::string, size_t> m_sb_interaction_indices;
 
+  std::mutex m_retained_files_lock;
+  std::vector<RedexMappedFile> m_retained_files;
+  std::vector<std::unique_ptr<DexIdx>> m_retained_idxs;
+
   bool m_allow_class_duplicates;
 
   bool m_pointers_cache_loaded{false};
@@ -11,6 +11,7 @@
 #include <fstream>
 
 #include "Debug.h"
+#include "HugePages.h"
 
 RedexMappedFile::RedexMappedFile(
     std::unique_ptr<boost::iostreams::mapped_file> file,
@@ -43,6 +44,7 @@ RedexMappedFile RedexMappedFile::open(std::string path, bool read_only) {
   if (!map->is_open()) {
     throw std::runtime_error(std::string("Could not map ") + path);
   }
+  huge_pages::advise(map->const_data(), map->size());
 
   return RedexMappedFile(std::move(map), std::move(path), read_only);
 }
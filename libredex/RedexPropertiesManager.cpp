@@ -8,15 +8,19 @@
 #include "RedexPropertiesManager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <sstream>
 #include <string_view>
 
 #include "ConfigFiles.h"
+#include "DexClass.h"
+#include "DexStore.h"
 #include "RedexProperties.h"
 #include "RedexPropertyChecker.h"
 #include "StlUtil.h"
 #include "Trace.h"
+#include "Walkers.h"
 
 namespace redex_properties {
 
@@ -89,7 +93,69 @@ std::unordered_set<Property> Manager::get_required(
 }
 
 void Manager::check(DexStoresVector& stores, PassManager& mgr) {
+  const auto* pm_config =
+      m_conf.get_global_config().get_config_by_name<PassManagerConfig>(
+          "pass_manager");
+  bool incremental =
+      pm_config != nullptr && pm_config->check_properties_incremental;
+
+  // Method-local properties are all checked in a single walk over the methods,
+  // instead of one walk per checker.
+  std::vector<const MethodPropertyChecker*> method_checkers;
+  std::vector<bool> skip_clean_methods;
+  std::vector<PropertyChecker*> other_checkers;
   for (auto* checker : m_checkers) {
+    auto* method_checker = dynamic_cast<MethodPropertyChecker*>(checker);
+    if (method_checker == nullptr) {
+      other_checkers.push_back(checker);
+      continue;
+    }
+    TRACE(PM, 3, "Checking for %s...", get_name(checker->get_property()));
+    if (!method_checker->begin_checks(
+            m_established.count(checker->get_property()))) {
+      continue;
+    }
+    method_checkers.push_back(method_checker);
+    skip_clean_methods.push_back(
+        incremental && m_incrementally_checkable.count(method_checker));
+  }
+
+  if (!method_checkers.empty()) {
+    bool any_skip_clean_methods =
+        std::find(skip_clean_methods.begin(), skip_clean_methods.end(),
+                  true) != skip_clean_methods.end();
+    std::atomic<size_t> skipped{0};
+    const auto& scope = build_class_scope(stores);
+    walk::parallel::methods(scope, [&](DexMethod* method) {
+      bool dirty = method->is_property_check_dirty();
+      if (any_skip_clean_methods && !dirty) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+      }
+      for (size_t i = 0; i < method_checkers.size(); ++i) {
+        if (dirty || !skip_clean_methods[i]) {
+          method_checkers[i]->check_method(method);
+        }
+      }
+      if (incremental) {
+        // Checking a method may mark it as dirty.
+        method->clear_property_check_dirty();
+      }
+    });
+    if (incremental) {
+      TRACE(PM, 2, "Property checks skipped %zu unchanged methods",
+            skipped.load());
+    }
+  }
+
+  // Dirty methods were only checked by the checkers that ran just now, so the
+  // other ones need to look at all methods again.
+  m_incrementally_checkable.clear();
+  if (incremental) {
+    m_incrementally_checkable.insert(method_checkers.begin(),
+                                     method_checkers.end());
+  }
+
+  for (auto* checker : other_checkers) {
     TRACE(PM, 3, "Checking for %s...", get_name(checker->get_property()));
     checker->run_checker(stores, m_conf, mgr,
                          m_established.count(checker->get_property()));
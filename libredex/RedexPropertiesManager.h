@@ -66,6 +66,10 @@ class Manager {
   std::unordered_set<Property> m_established;
 
   std::vector<redex_properties::PropertyChecker*> m_checkers;
+
+  // The method checkers that checked all methods that were dirty at the last
+  // check. Only these may skip clean methods in an incremental check.
+  std::unordered_set<const PropertyChecker*> m_incrementally_checkable;
 };
 
 } // namespace redex_properties
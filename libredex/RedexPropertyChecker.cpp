@@ -7,6 +7,7 @@
 
 #include "RedexPropertyChecker.h"
 #include "RedexPropertyCheckerRegistry.h"
+#include "Walkers.h"
 
 namespace redex_properties {
 
@@ -16,4 +17,16 @@ PropertyChecker::PropertyChecker(Property property) : m_property(property) {
 
 PropertyChecker::~PropertyChecker() {}
 
+void MethodPropertyChecker::run_checker(DexStoresVector& stores,
+                                        ConfigFiles& /* conf */,
+                                        PassManager& /* mgr */,
+                                        bool established) {
+  if (!begin_checks(established)) {
+    return;
+  }
+  const auto& scope = build_class_scope(stores);
+  walk::parallel::methods(scope,
+                          [&](DexMethod* method) { check_method(method); });
+}
+
 } // namespace redex_properties
@@ -12,6 +12,7 @@
 #include "DexStore.h"
 
 struct ConfigFiles;
+class DexMethod;
 class PassManager;
 
 namespace redex_properties {
@@ -29,4 +30,30 @@ class PropertyChecker {
                            bool established) = 0;
 };
 
+/*
+ * A checker of a property that only depends on the code of each method, so
+ * that methods can be checked independently of each other. The Manager runs
+ * all of these checkers together in a single parallel walk over the methods
+ * and, with `check_properties_incremental`, only revisits the methods that may
+ * have been mutated since they last passed (see
+ * DexMethod::is_property_check_dirty()).
+ */
+class MethodPropertyChecker : public PropertyChecker {
+ public:
+  explicit MethodPropertyChecker(Property property)
+      : PropertyChecker(property) {}
+
+  // Called once before methods are checked. Returns whether any method needs
+  // to be checked, given whether the property is currently established.
+  virtual bool begin_checks(bool established) = 0;
+
+  // Called concurrently for different methods.
+  virtual void check_method(DexMethod* method) const = 0;
+
+  void run_checker(DexStoresVector& stores,
+                   ConfigFiles& conf,
+                   PassManager& mgr,
+                   bool established) final;
+};
+
 } // namespace redex_properties
@@ -46,6 +46,8 @@ namespace {
 constexpr size_t MIN_CLASSNAME_LENGTH = 10;
 constexpr size_t MAX_CLASSNAME_LENGTH = 500;
 
+// Limits the threads rewriting xml files. Scanning them is mostly parsing, and
+// uses all threads.
 constexpr decltype(redex_parallel::default_num_threads()) kReadXMLThreads = 4u;
 constexpr decltype(redex_parallel::default_num_threads()) kReadNativeThreads =
     2u;
@@ -260,10 +262,14 @@ void AndroidResources::collect_layout_classes_and_attributes(
     std::unordered_multimap<std::string, std::string>* out_attributes) {
   auto res_table = load_res_table();
   auto collect_fn = [&](const std::vector<std::string>& prefixes) {
-    std::mutex out_mutex;
-    resources::StringOrReferenceSet classes;
-    std::unordered_multimap<std::string, resources::StringOrReference>
-        attributes;
+    // Every worker collects into its own sets, which are merged at the end.
+    struct WorkerResult {
+      resources::StringOrReferenceSet classes;
+      std::unordered_multimap<std::string, resources::StringOrReference>
+          attributes;
+    };
+    auto num_threads = redex_parallel::default_num_threads();
+    std::vector<WorkerResult> worker_results(num_threads);
     workqueue_run<std::string>(
         [&](sparta::WorkerState<std::string>* worker_state,
             const std::string& input) {
@@ -283,22 +289,21 @@ void AndroidResources::collect_layout_classes_and_attributes(
             return;
           }
 
-          resources::StringOrReferenceSet local_classes;
-          std::unordered_multimap<std::string, resources::StringOrReference>
-              local_attributes;
+          auto& result = worker_results[worker_state->worker_id()];
           collect_layout_classes_and_attributes_for_file(
-              input, attributes_to_read, &local_classes, &local_attributes);
-          if (!local_classes.empty() || !local_attributes.empty()) {
-            std::unique_lock<std::mutex> lock(out_mutex);
-            // C++17: use merge to avoid copies.
-            classes.insert(local_classes.begin(), local_classes.end());
-            attributes.insert(local_attributes.begin(), local_attributes.end());
-          }
+              input, attributes_to_read, &result.classes, &result.attributes);
         },
         std::vector<std::string>{""},
-        std::min(redex_parallel::default_num_threads(), kReadXMLThreads),
+        num_threads,
         /*push_tasks_while_running=*/true);
 
+    auto& classes = worker_results[0].classes;
+    auto& attributes = worker_results[0].attributes;
+    for (size_t i = 1; i < num_threads; ++i) {
+      classes.merge(worker_results[i].classes);
+      attributes.merge(worker_results[i].attributes);
+    }
+
     // Resolve references that were encountered while reading xml files
     for (const auto& val : classes) {
       if (val.is_reference()) {
@@ -341,7 +346,9 @@ void AndroidResources::collect_layout_classes_and_attributes(
 
 void AndroidResources::collect_xml_attribute_string_values(
     std::unordered_set<std::string>* out) {
-  std::mutex out_mutex;
+  // Every worker collects into its own set, which are merged at the end.
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<std::unordered_set<std::string>> worker_values(num_threads);
   workqueue_run<std::string>(
       [&](sparta::WorkerState<std::string>* worker_state,
           const std::string& input) {
@@ -359,17 +366,15 @@ void AndroidResources::collect_xml_attribute_string_values(
           return;
         }
 
-        std::unordered_set<std::string> local_out_values;
-        collect_xml_attribute_string_values_for_file(input, &local_out_values);
-        if (!local_out_values.empty()) {
-          std::unique_lock<std::mutex> lock(out_mutex);
-          // C++17: use merge to avoid copies.
-          out->insert(local_out_values.begin(), local_out_values.end());
-        }
+        collect_xml_attribute_string_values_for_file(
+            input, &worker_values[worker_state->worker_id()]);
       },
       std::vector<std::string>{""},
-      std::min(redex_parallel::default_num_threads(), kReadXMLThreads),
+      num_threads,
       /*push_tasks_while_running=*/true);
+  for (auto& values : worker_values) {
+    out->merge(values);
+  }
 }
 
 void AndroidResources::rename_classes_in_layouts(
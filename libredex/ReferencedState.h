@@ -7,11 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <boost/optional.hpp>
 #include <limits>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "Debug.h"
 #include "KeepReason.h"
@@ -195,9 +197,11 @@ class ReferencedState {
 
   // Going through hoops here to reduce the size of ReferencedState while
   // keeping memory requirements still small in non-default case.
+  // The reasons are interned, so a sorted vector of their ids is all we need
+  // to store per member.
   struct KeepReasons {
     std::mutex m_keep_reasons_mtx;
-    keep_reason::ReasonPtrSet m_keep_reasons;
+    std::vector<keep_reason::ReasonId> m_keep_reasons;
   };
   mutable std::atomic<KeepReasons*> m_keep_reasons{nullptr};
 
@@ -415,14 +419,20 @@ class ReferencedState {
     inner_struct.m_unset_allowobfuscation = false;
   }
 
-  const keep_reason::ReasonPtrSet& keep_reasons() const {
-    if (!keep_reason::Reason::record_keep_reasons()) {
-      // We really should not allow this.
-      static keep_reason::ReasonPtrSet SINGLETON;
-      return SINGLETON;
+  std::vector<const keep_reason::Reason*> keep_reasons() const {
+    std::vector<const keep_reason::Reason*> res;
+    // We really should not allow this when not recording.
+    auto* keep_reasons = m_keep_reasons.load();
+    if (!keep_reason::Reason::record_keep_reasons() ||
+        keep_reasons == nullptr) {
+      return res;
     }
-    auto& keep_reasons = ensure_keep_reasons();
-    return keep_reasons.m_keep_reasons;
+    std::lock_guard<std::mutex> lock(keep_reasons->m_keep_reasons_mtx);
+    res.reserve(keep_reasons->m_keep_reasons.size());
+    for (auto id : keep_reasons->m_keep_reasons) {
+      res.push_back(keep_reason::Reason::get(id));
+    }
+    return res;
   }
 
   template <class... Args>
@@ -673,7 +683,11 @@ class ReferencedState {
     always_assert(keep_reason::Reason::record_keep_reasons());
     auto& keep_reasons = ensure_keep_reasons();
     std::lock_guard<std::mutex> lock(keep_reasons.m_keep_reasons_mtx);
-    keep_reasons.m_keep_reasons.emplace(reason);
+    auto& ids = keep_reasons.m_keep_reasons;
+    auto it = std::lower_bound(ids.begin(), ids.end(), reason->id);
+    if (it == ids.end() || *it != reason->id) {
+      ids.insert(it, reason->id);
+    }
   }
 
   friend class keep_rules::impl::KeepState;
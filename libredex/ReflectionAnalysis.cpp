@@ -1106,6 +1106,17 @@ ReflectionAnalysis::ReflectionAnalysis(DexMethod* dex_method,
                                        CallingContext* context,
                                        SummaryQueryFn* summary_query_fn,
                                        const MetadataCache* cache)
+    : ReflectionAnalysis(dex_method,
+                         context,
+                         summary_query_fn,
+                         cache,
+                         /* calculate_exit_block */ true) {}
+
+ReflectionAnalysis::ReflectionAnalysis(DexMethod* dex_method,
+                                       CallingContext* context,
+                                       SummaryQueryFn* summary_query_fn,
+                                       const MetadataCache* cache,
+                                       bool calculate_exit_block)
     : m_dex_method(dex_method) {
   always_assert(dex_method != nullptr);
   IRCode* code = dex_method->get_code();
@@ -1114,7 +1125,11 @@ ReflectionAnalysis::ReflectionAnalysis(DexMethod* dex_method,
   }
   always_assert(code->editable_cfg_built());
   auto& cfg = code->cfg();
-  cfg.calculate_exit_block();
+  if (calculate_exit_block) {
+    // This changes the structure of the cfg, so the shared analyses skip it.
+    cfg.calculate_exit_block();
+    m_has_exit_block = true;
+  }
   if (!cache) {
     m_fallback_cache = new MetadataCache;
     cache = m_fallback_cache;
@@ -1239,7 +1254,49 @@ CallingContextMap ReflectionAnalysis::get_calling_context_partition() const {
   if (m_analyzer == nullptr) {
     return CallingContextMap::top();
   }
+  always_assert(m_has_exit_block);
   return this->m_analyzer->get_exit_state().get_calling_context_partition();
 }
 
+namespace {
+
+// Tag of the shared intraprocedural analyses in the cfg's code data.
+struct SharedAnalysisTag {};
+
+} // namespace
+
+std::shared_ptr<const ReflectionAnalysis> get_shared_reflection_analysis(
+    DexMethod* dex_method, const MetadataCache* cache) {
+  always_assert(dex_method != nullptr);
+  auto make = [&]() {
+    return std::shared_ptr<const ReflectionAnalysis>(
+        new ReflectionAnalysis(dex_method, nullptr, nullptr, cache,
+                               /* calculate_exit_block */ false));
+  };
+  const auto* code = const_cast<const DexMethod*>(dex_method)->get_code();
+  if (code == nullptr) {
+    return make();
+  }
+  always_assert(code->editable_cfg_built());
+  return code->cfg().get_code_data<SharedAnalysisTag, ReflectionAnalysis>(
+      make);
+}
+
+std::shared_ptr<const ReflectionAnalysis> SharedReflectionAnalyses::get(
+    DexMethod* dex_method, const MetadataCache* cache) const {
+  auto analysis = get_shared_reflection_analysis(dex_method, cache);
+  // A retained analysis is what get_shared_reflection_analysis() returns
+  // while it is still valid, so only new ones need to be recorded.
+  auto retained = m_retained.get(dex_method, nullptr);
+  if (retained == analysis) {
+    return analysis;
+  }
+  if (analysis->has_found_reflection()) {
+    m_retained.insert_or_assign(std::make_pair(dex_method, analysis));
+  } else if (retained != nullptr) {
+    m_retained.erase(dex_method);
+  }
+  return analysis;
+}
+
 } // namespace reflection
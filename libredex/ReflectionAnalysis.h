@@ -18,6 +18,7 @@
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeMapAbstractPartition.h>
 
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
@@ -382,18 +383,59 @@ class ReflectionAnalysis final {
   boost::optional<ClassObjectSource> get_class_source(
       size_t reg, IRInstruction* insn) const;
 
+  // Not available on the shared analyses, which don't compute the exit block.
   CallingContextMap get_calling_context_partition() const;
 
  private:
+  friend std::shared_ptr<const ReflectionAnalysis>
+  get_shared_reflection_analysis(DexMethod*, const MetadataCache*);
+
+  ReflectionAnalysis(DexMethod* dex_method,
+                     CallingContext* context,
+                     SummaryQueryFn* summary_query_fn,
+                     const MetadataCache* cache,
+                     bool calculate_exit_block);
+
   const DexMethod* m_dex_method;
   std::unique_ptr<impl::Analyzer> m_analyzer;
   MetadataCache* m_fallback_cache = nullptr;
+  bool m_has_exit_block{false};
 
   void gather_reflection_sites(
       IRInstruction* insn,
       std::map<reg_t, ReflectionAbstractObject>* abstract_objects) const;
 };
 
+/*
+ * Runs the intraprocedural ReflectionAnalysis of the given method, i.e.
+ * without a calling context or callee summaries, or returns one that is still
+ * in use elsewhere, as long as the code did not change in the meantime; see
+ * ControlFlowGraph::get_code_data(). The editable cfg must be built. The
+ * metadata cache is only used while the analysis runs.
+ */
+std::shared_ptr<const ReflectionAnalysis> get_shared_reflection_analysis(
+    DexMethod* dex_method, const MetadataCache* cache = nullptr);
+
+/*
+ * Keeps the shared analyses of the methods that use reflection alive, so that
+ * consumers that don't overlap in time reuse them, e.g. passes that get this
+ * from PassManager::get_cached_analysis(). Analyses of methods that changed
+ * since are detected and recomputed on lookup. Methods without reflection are
+ * not retained, as they would pin the results of the whole scope.
+ */
+class SharedReflectionAnalyses {
+ public:
+  std::shared_ptr<const ReflectionAnalysis> get(
+      DexMethod* dex_method, const MetadataCache* cache = nullptr) const;
+
+  size_t size() const { return m_retained.size(); }
+
+ private:
+  mutable ConcurrentMap<const DexMethod*,
+                        std::shared_ptr<const ReflectionAnalysis>>
+      m_retained;
+};
+
 } // namespace reflection
 
 std::ostream& operator<<(std::ostream& out,
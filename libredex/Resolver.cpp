@@ -6,7 +6,14 @@
  */
 
 #include "Resolver.h"
+
+#include <atomic>
+#include <boost/functional/hash.hpp>
+#include <mutex>
+#include <tuple>
+
 #include "DexUtil.h"
+#include "RedexContext.h"
 
 namespace {
 
@@ -41,31 +48,78 @@ DexMethod* resolve_intf_method_ref(const DexClass* cls,
   return nullptr;
 }
 
-} // namespace
+/*
+ * Lookups that start at an external class only ever visit external classes,
+ * which are loaded once and never modified by passes. Unlike lookups within
+ * internal classes, their results can thus be shared across all passes,
+ * without any invalidation. The caches live as long as the RedexContext.
+ */
+using ExternalMethodKey =
+    std::tuple<const DexClass*, const DexString*, const DexProto*,
+               MethodSearch>;
+using ExternalFieldKey =
+    std::tuple<const DexClass*, const DexString*, const DexType*, FieldSearch>;
 
-DexMethod* resolve_method(const DexClass* cls,
-                          const DexString* name,
-                          const DexProto* proto,
-                          MethodSearch search,
-                          const DexMethod* caller) {
-  if (search == MethodSearch::Interface) {
-    if (cls) {
-      return resolve_intf_method_ref(cls, name, proto);
-    }
+struct ExternalResolutionCaches {
+  InsertOnlyConcurrentMap<ExternalMethodKey,
+                          DexMethod*,
+                          boost::hash<ExternalMethodKey>>
+      methods;
+  InsertOnlyConcurrentMap<ExternalFieldKey,
+                          DexField*,
+                          boost::hash<ExternalFieldKey>>
+      fields;
+};
+
+std::atomic<ExternalResolutionCaches*> s_external_caches{nullptr};
+std::mutex s_external_caches_mutex;
+
+ExternalResolutionCaches& get_external_caches() {
+  auto* caches = s_external_caches.load(std::memory_order_acquire);
+  if (caches != nullptr) {
+    return *caches;
   }
-  if (search == MethodSearch::Super) {
-    if (caller) {
-      // caller must be provided. This condition is here to be compatible with
-      // old behavior.
-      DexType* containing_type = caller->get_class();
-      DexClass* containing_class = type_class(containing_type);
-      if (containing_class == nullptr) return nullptr;
-      DexType* super_class = containing_class->get_super_class();
-      if (!super_class) return nullptr;
-      cls = type_class(super_class);
-    }
-    // The rest is the same as virtual.
-    search = MethodSearch::Virtual;
+  std::lock_guard<std::mutex> lock(s_external_caches_mutex);
+  caches = s_external_caches.load(std::memory_order_relaxed);
+  if (caches == nullptr) {
+    caches = new ExternalResolutionCaches();
+    s_external_caches.store(caches, std::memory_order_release);
+    // In tests, we create and destroy g_redex repeatedly, and the caches must
+    // not outlive the classes they refer to.
+    g_redex->add_destruction_task([]() {
+      std::lock_guard<std::mutex> lock(s_external_caches_mutex);
+      delete s_external_caches.exchange(nullptr);
+    });
+  }
+  return *caches;
+}
+
+DexMethod* resolve_method_uncached(const DexClass* cls,
+                                   const DexString* name,
+                                   const DexProto* proto,
+                                   MethodSearch search);
+
+DexMethod* resolve_external_method(const DexClass* cls,
+                                   const DexString* name,
+                                   const DexProto* proto,
+                                   MethodSearch search) {
+  auto& cache = get_external_caches().methods;
+  ExternalMethodKey key{cls, name, proto, search};
+  auto* cached = cache.get(key);
+  if (cached != nullptr) {
+    return *cached;
+  }
+  auto* resolved = resolve_method_uncached(cls, name, proto, search);
+  cache.emplace(key, resolved);
+  return resolved;
+}
+
+DexMethod* resolve_method_uncached(const DexClass* cls,
+                                   const DexString* name,
+                                   const DexProto* proto,
+                                   MethodSearch search) {
+  if (search == MethodSearch::Interface) {
+    return resolve_intf_method_ref(cls, name, proto);
   }
   while (cls) {
     if (search == MethodSearch::InterfaceVirtual) {
@@ -90,44 +144,30 @@ DexMethod* resolve_method(const DexClass* cls,
       }
     }
     // direct methods only look up the given class
-    cls = search != MethodSearch::Direct ? type_class(cls->get_super_class())
-                                         : nullptr;
-  }
-  return nullptr;
-}
-
-DexMethod* resolve_method_ref(const DexClass* cls,
-                              const DexString* name,
-                              const DexProto* proto,
-                              MethodSearch search) {
-  always_assert(search != MethodSearch::Super);
-  if (search != MethodSearch::Interface) {
-    const auto& super = cls->get_super_class();
-    if (super == nullptr) return nullptr;
-    const auto& super_cls = type_class(super);
-    auto resolved = resolve_method(super_cls, name, proto, search);
-    if (resolved || search != MethodSearch::InterfaceVirtual) {
-      return resolved;
+    if (search == MethodSearch::Direct) {
+      break;
+    }
+    cls = type_class(cls->get_super_class());
+    if (cls != nullptr && cls->is_external()) {
+      return resolve_external_method(cls, name, proto, search);
     }
-  }
-  for (const auto& super_intf : *cls->get_interfaces()) {
-    const auto& super_intf_cls = type_class(super_intf);
-    if (super_intf_cls == nullptr) continue;
-    auto method = resolve_intf_method_ref(super_intf_cls, name, proto);
-    if (method) return method;
   }
   return nullptr;
 }
 
-DexField* resolve_field(const DexType* owner,
-                        const DexString* name,
-                        const DexType* type,
-                        FieldSearch fs) {
+DexField* resolve_external_field(const DexClass* cls,
+                                 const DexString* name,
+                                 const DexType* type,
+                                 FieldSearch fs);
+
+DexField* resolve_field_uncached(const DexClass* cls,
+                                 const DexString* name,
+                                 const DexType* type,
+                                 FieldSearch fs) {
   auto field_eq = [&](const DexField* a) {
     return a->get_name() == name && a->get_type() == type;
   };
 
-  const DexClass* cls = type_class(owner);
   while (cls) {
     if (fs == FieldSearch::Instance || fs == FieldSearch::Any) {
       for (auto ifield : cls->get_ifields()) {
@@ -150,10 +190,95 @@ DexField* resolve_field(const DexType* owner,
       }
     }
     cls = type_class(cls->get_super_class());
+    if (cls != nullptr && cls->is_external()) {
+      return resolve_external_field(cls, name, type, fs);
+    }
   }
   return nullptr;
 }
 
+DexField* resolve_external_field(const DexClass* cls,
+                                 const DexString* name,
+                                 const DexType* type,
+                                 FieldSearch fs) {
+  auto& cache = get_external_caches().fields;
+  ExternalFieldKey key{cls, name, type, fs};
+  auto* cached = cache.get(key);
+  if (cached != nullptr) {
+    return *cached;
+  }
+  auto* resolved = resolve_field_uncached(cls, name, type, fs);
+  cache.emplace(key, resolved);
+  return resolved;
+}
+
+} // namespace
+
+DexMethod* resolve_method(const DexClass* cls,
+                          const DexString* name,
+                          const DexProto* proto,
+                          MethodSearch search,
+                          const DexMethod* caller) {
+  if (search == MethodSearch::Super) {
+    if (caller) {
+      // caller must be provided. This condition is here to be compatible with
+      // old behavior.
+      DexType* containing_type = caller->get_class();
+      DexClass* containing_class = type_class(containing_type);
+      if (containing_class == nullptr) return nullptr;
+      DexType* super_class = containing_class->get_super_class();
+      if (!super_class) return nullptr;
+      cls = type_class(super_class);
+    }
+    // The rest is the same as virtual.
+    search = MethodSearch::Virtual;
+  }
+  if (cls == nullptr) {
+    return nullptr;
+  }
+  if (cls->is_external()) {
+    return resolve_external_method(cls, name, proto, search);
+  }
+  return resolve_method_uncached(cls, name, proto, search);
+}
+
+DexMethod* resolve_method_ref(const DexClass* cls,
+                              const DexString* name,
+                              const DexProto* proto,
+                              MethodSearch search) {
+  always_assert(search != MethodSearch::Super);
+  if (search != MethodSearch::Interface) {
+    const auto& super = cls->get_super_class();
+    if (super == nullptr) return nullptr;
+    const auto& super_cls = type_class(super);
+    auto resolved = resolve_method(super_cls, name, proto, search);
+    if (resolved || search != MethodSearch::InterfaceVirtual) {
+      return resolved;
+    }
+  }
+  for (const auto& super_intf : *cls->get_interfaces()) {
+    const auto& super_intf_cls = type_class(super_intf);
+    if (super_intf_cls == nullptr) continue;
+    auto method = resolve_intf_method_ref(super_intf_cls, name, proto);
+    if (method) return method;
+  }
+  return nullptr;
+}
+
+DexField* resolve_field(const DexType* owner,
+                        const DexString* name,
+                        const DexType* type,
+                        FieldSearch fs) {
+  const DexClass* cls = type_class(owner);
+  if (cls == nullptr) {
+    return nullptr;
+  }
+  if (cls->is_external()) {
+    return resolve_external_field(cls, name, type, fs);
+  }
+  return resolve_field_uncached(cls, name, type, fs);
+}
+
 DexMethod* find_top_impl(const DexClass* cls,
                          const DexString* name,
                          const DexProto* proto) {
@@ -408,7 +408,7 @@ struct InsertHelper {
       for (auto* b : cfg.blocks()) {
         auto vec = gather_source_blocks(b);
         for (auto* sb : vec) {
-          const_cast<SourceBlock*>(sb)->vals[i] = val;
+          const_cast<SourceBlock*>(sb)->set_val(i, val);
         }
       }
     }
@@ -551,6 +551,42 @@ size_t num_interactions(const cfg::ControlFlowGraph& cfg,
   return 0;
 }
 
+void normalize(ControlFlowGraph& cfg,
+               SourceBlock* dominating,
+               SourceBlock* dominated,
+               size_t interactions) {
+  if (interactions == 0) {
+    return;
+  }
+  std::vector<float> factors;
+  factors.reserve(interactions);
+  for (size_t i = 0; i != interactions; ++i) {
+    factors.push_back(get_factor(dominating, dominated, i));
+  }
+  // Maps interned values to their scaled version. The original values are
+  // kept alive, so that their address cannot be reused while scaling.
+  std::unordered_map<const SourceBlock::Val*,
+                     std::pair<SourceBlock::InternedVals,
+                               SourceBlock::InternedVals>>
+      scaled;
+  for (auto* b : cfg.blocks()) {
+    source_blocks::foreach_source_block(b, [&](auto* sb) {
+      const auto* key = sb->vals.data();
+      if (key == nullptr) {
+        return;
+      }
+      auto it = scaled.find(key);
+      if (it != scaled.end()) {
+        sb->vals = it->second.second;
+        return;
+      }
+      auto original = sb->vals;
+      normalize(sb, factors);
+      scaled.emplace(key, std::make_pair(std::move(original), sb->vals));
+    });
+  }
+}
+
 } // namespace normalize
 
 namespace {
@@ -1171,10 +1207,10 @@ struct ViolationsHelper::ViolationsHelperImpl {
     // Some passes may leave around unreachable blocks which the fast-dom
     // does not deal well with.
     cfg.remove_unreachable_blocks();
-    dominators::SimpleFastDominators<cfg::GraphInterface> dom{cfg};
+    auto dom = dominators::get_cached_dominators<cfg::GraphInterface>(cfg);
 
     for (auto* b : cfg.blocks()) {
-      sum += hot_immediate_dom_not_hot(b, dom);
+      sum += hot_immediate_dom_not_hot(b, *dom);
     }
     return sum;
   }
@@ -1185,10 +1221,10 @@ struct ViolationsHelper::ViolationsHelperImpl {
     // Some passes may leave around unreachable blocks which the fast-dom
     // does not deal well with.
     cfg.remove_unreachable_blocks();
-    dominators::SimpleFastDominators<cfg::GraphInterface> dom{cfg};
+    auto dom = dominators::get_cached_dominators<cfg::GraphInterface>(cfg);
 
     for (auto* b : cfg.blocks()) {
-      sum += chain_and_dom_violations(b, dom);
+      sum += chain_and_dom_violations(b, *dom);
     }
     return sum;
   }
@@ -1534,9 +1570,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(SourceBlock* sb,
   if (ref) {
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
-  for (size_t i = 0; i < new_sb->vals_size; i++) {
-    new_sb->vals[i] = val;
-  }
+  new_sb->fill_vals(val);
   return new_sb;
 }
 
@@ -1551,9 +1585,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
   if (opt_val) {
-    for (size_t i = 0; i < new_sb->vals_size; i++) {
-      new_sb->vals[i] = *opt_val;
-    }
+    new_sb->fill_vals(*opt_val);
   }
   return new_sb;
 }
@@ -1566,9 +1598,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(
   if (ref) {
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
-  for (size_t i = 0; i < new_sb->vals_size; i++) {
-    new_sb->vals[i] = SourceBlock::Val::none();
-  }
+  new_sb->fill_vals(SourceBlock::Val::none());
   for (auto& other : many) {
     new_sb->max(*other);
   }
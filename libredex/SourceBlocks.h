@@ -430,23 +430,29 @@ inline float get_factor(SourceBlock* dominating,
   return caller_val / callee_val;
 }
 
-inline void normalize(SourceBlock* sb, size_t idx, float factor) {
-  if (sb->vals[idx]) {
-    sb->vals[idx]->val *= factor;
+// Scales the first `n` values by the given factors. This has no branches, so
+// that it vectorizes.
+inline void scale_vals(SourceBlock::Val* vals, const float* factors, size_t n) {
+  for (size_t i = 0; i != n; ++i) {
+    vals[i].scale(factors[i]);
   }
 }
 
-inline void normalize(SourceBlock* dominating,
-                      SourceBlock* dominated,
-                      size_t interactions) {
-  for (size_t i = 0; i != interactions; ++i) {
-    auto sb_factor = get_factor(dominating, dominated, i);
-    normalize(dominated, i, sb_factor);
+// Scales the first `factors.size()` values of the block by the given factors.
+inline void normalize(SourceBlock* sb, const std::vector<float>& factors) {
+  size_t len = std::min<size_t>(factors.size(), sb->vals_size);
+  sb->update_vals([&](SourceBlock::Val* vals) {
+    scale_vals(vals, factors.data(), len);
+  });
+}
+
+inline void normalize(SourceBlock* sb, size_t idx, float factor) {
+  if (sb->vals[idx]) {
+    sb->update_vals([&](SourceBlock::Val* vals) { vals[idx].scale(factor); });
   }
 }
 
-inline void normalize(ControlFlowGraph& cfg,
-                      SourceBlock* dominating,
+inline void normalize(SourceBlock* dominating,
                       SourceBlock* dominated,
                       size_t interactions) {
   if (interactions == 0) {
@@ -457,15 +463,16 @@ inline void normalize(ControlFlowGraph& cfg,
   for (size_t i = 0; i != interactions; ++i) {
     factors.push_back(get_factor(dominating, dominated, i));
   }
-  for (auto* b : cfg.blocks()) {
-    source_blocks::foreach_source_block(b, [&](auto* sb) {
-      for (size_t i = 0; i != interactions; ++i) {
-        normalize(sb, i, factors[i]);
-      }
-    });
-  }
+  normalize(dominated, factors);
 }
 
+// Scales all source blocks of the CFG. As blocks mostly share their interned
+// values, every distinct array of values is only scaled once.
+void normalize(ControlFlowGraph& cfg,
+               SourceBlock* dominating,
+               SourceBlock* dominated,
+               size_t interactions);
+
 inline void normalize(ControlFlowGraph& cfg,
                       SourceBlock* dominating,
                       size_t interactions) {
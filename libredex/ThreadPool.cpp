@@ -7,10 +7,90 @@
 
 #include "ThreadPool.h"
 
+#ifdef __linux__
+#include <fstream>
+#include <sched.h>
+#include <set>
+#include <sstream>
+#include <string>
+#endif
+
+#include "Trace.h"
+
 namespace {
 
 redex_thread_pool::ThreadPool* s_threadpool{nullptr};
 
+#ifdef __linux__
+
+// Parses a CPU list like "0-15,64-79".
+std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  std::istringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    auto dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last =
+          dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception&) {
+      // Ignore what we cannot parse, like a trailing newline.
+    }
+  }
+  return cpus;
+}
+
+// The CPUs this process may run on, grouped by NUMA node as far as the
+// topology is known.
+std::vector<int> get_cpus_by_node() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return {};
+  }
+  std::vector<int> cpus;
+  std::set<int> seen;
+  auto add = [&](int cpu) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed) &&
+        seen.insert(cpu).second) {
+      cpus.push_back(cpu);
+    }
+  };
+  for (int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in) {
+      break;
+    }
+    std::string list;
+    std::getline(in, list);
+    for (auto cpu : parse_cpu_list(list)) {
+      add(cpu);
+    }
+  }
+  // Without a known topology, or for CPUs without a node, keep the order of
+  // the CPU ids.
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    add(cpu);
+  }
+  return cpus;
+}
+
+void pin_current_thread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    TRACE(MAIN, 1, "Could not pin thread to CPU %d", cpu);
+  }
+}
+
+#endif
+
 } // anonymous namespace
 
 namespace redex_thread_pool {
@@ -21,10 +101,32 @@ boost::thread ThreadPool::create_thread(std::function<void()> bound_f) {
   boost::thread::attributes attrs;
   attrs.set_stack_size(8 * 1024 * 1024); // 8MB stack.
   auto bound_run = std::bind(&ThreadPool::run, this, std::move(bound_f));
+  size_t index = m_num_created_threads++;
+  if (m_cpus.empty()) {
+    return boost::thread(attrs, std::move(bound_run));
+  }
+#ifdef __linux__
+  int cpu = m_cpus[index % m_cpus.size()];
+  return boost::thread(attrs, [cpu, bound_run = std::move(bound_run)]() {
+    pin_current_thread(cpu);
+    bound_run();
+  });
+#else
+  (void)index;
   return boost::thread(attrs, std::move(bound_run));
+#endif
 }
 
-void ThreadPool::create() { s_threadpool = new ThreadPool(); }
+void ThreadPool::create(bool pin_threads) {
+  s_threadpool = new ThreadPool();
+#ifdef __linux__
+  if (pin_threads) {
+    s_threadpool->m_cpus = get_cpus_by_node();
+  }
+#else
+  (void)pin_threads;
+#endif
+}
 
 void ThreadPool::destroy() {
   delete s_threadpool;
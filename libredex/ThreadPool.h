@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <vector>
+
 // We for now need a larger stack size than the default, and on Mac OS
 // this is the only way (or pthreads directly), as `ulimit -s` does not
 // apply to non-main threads.
@@ -20,12 +22,24 @@ class ThreadPool : public sparta::ThreadPool<boost::thread> {
  public:
   static ThreadPool* get_instance();
 
-  static void create();
+  // With `pin_threads`, every thread of the pool gets bound to one of the
+  // CPUs the process may run on, so that it stays close to the memory it
+  // touched first. CPUs are handed out NUMA node by NUMA node, so that the
+  // first threads of the pool share a node. Pinning is only supported on
+  // Linux, and ignored elsewhere.
+  static void create(bool pin_threads = false);
 
   static void destroy();
 
  protected:
   boost::thread create_thread(std::function<void()> bound_f) override;
+
+ private:
+  // The CPUs to pin the threads to, in order; empty if not pinning.
+  std::vector<int> m_cpus;
+  // Only accessed by create_thread(), which runs under the lock of the
+  // sparta::ThreadPool.
+  size_t m_num_created_threads{0};
 };
 
 } // namespace redex_thread_pool
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TimelineTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <json/json.h>
+
+#include "Debug.h"
+
+namespace timeline_trace {
+
+namespace {
+
+// Work queue tasks of a thread that are separated by less than this are
+// merged into a single span.
+constexpr uint64_t kWorkCoalescingGapUs = 1000;
+
+struct Event {
+  std::string name;
+  uint64_t start_us;
+  uint64_t dur_us;
+};
+
+struct ThreadEvents {
+  std::mutex lock;
+  size_t tid;
+  std::vector<Event> events;
+  // The work span that is still being extended, if any.
+  bool has_work{false};
+  uint64_t work_start_us{0};
+  uint64_t work_end_us{0};
+
+  explicit ThreadEvents(size_t tid) : tid(tid) {}
+
+  void flush_work() {
+    if (has_work) {
+      events.push_back(
+          Event{"work", work_start_us, work_end_us - work_start_us});
+      has_work = false;
+    }
+  }
+};
+
+struct Recorder {
+  std::atomic<bool> enabled{false};
+  std::atomic<bool> work_queues{false};
+  clock::time_point epoch{clock::now()};
+  std::mutex lock;
+  // A deque, so that entries do not move when threads get added.
+  std::deque<ThreadEvents> threads;
+};
+
+Recorder& recorder() {
+  // Leaked on purpose, as threads may outlive static destruction.
+  static auto* recorder = new Recorder();
+  return *recorder;
+}
+
+ThreadEvents& thread_events() {
+  thread_local ThreadEvents* events = []() {
+    auto& r = recorder();
+    std::lock_guard<std::mutex> lock(r.lock);
+    return &r.threads.emplace_back(r.threads.size());
+  }();
+  return *events;
+}
+
+uint64_t to_us(clock::time_point tp) {
+  auto since_epoch = tp - recorder().epoch;
+  if (since_epoch.count() < 0) {
+    return 0;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(since_epoch)
+      .count();
+}
+
+} // namespace
+
+void enable(bool work_queues) {
+  auto& r = recorder();
+  // Make sure the enabling thread, usually the main thread, gets tid 0.
+  thread_events();
+  r.work_queues = work_queues;
+  r.enabled = true;
+}
+
+bool is_enabled() {
+  return recorder().enabled.load(std::memory_order_relaxed);
+}
+
+bool work_queues_enabled() {
+  return recorder().work_queues.load(std::memory_order_relaxed);
+}
+
+void record(const std::string& name, clock::time_point start,
+            clock::time_point end) {
+  if (!is_enabled()) {
+    return;
+  }
+  auto start_us = to_us(start);
+  auto end_us = std::max(start_us, to_us(end));
+  auto& te = thread_events();
+  std::lock_guard<std::mutex> lock(te.lock);
+  te.events.push_back(Event{name, start_us, end_us - start_us});
+}
+
+void record_work(clock::time_point start, clock::time_point end) {
+  if (!work_queues_enabled()) {
+    return;
+  }
+  auto start_us = to_us(start);
+  auto end_us = std::max(start_us, to_us(end));
+  auto& te = thread_events();
+  std::lock_guard<std::mutex> lock(te.lock);
+  if (te.has_work && start_us <= te.work_end_us + kWorkCoalescingGapUs) {
+    te.work_end_us = std::max(te.work_end_us, end_us);
+    return;
+  }
+  te.flush_work();
+  te.has_work = true;
+  te.work_start_us = start_us;
+  te.work_end_us = end_us;
+}
+
+void write(const std::string& file) {
+  always_assert(is_enabled());
+  std::ofstream out(file);
+  always_assert_log(out, "Could not open %s", file.c_str());
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  auto& r = recorder();
+  std::lock_guard<std::mutex> lock(r.lock);
+  for (auto& te : r.threads) {
+    std::lock_guard<std::mutex> thread_lock(te.lock);
+    te.flush_work();
+    if (!first) {
+      out << ",\n";
+    }
+    first = false;
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << te.tid << ",\"args\":{\"name\":\""
+        << (te.tid == 0 ? "main" : "thread " + std::to_string(te.tid))
+        << "\"}}";
+    for (const auto& event : te.events) {
+      out << ",\n{\"name\":" << Json::valueToQuotedString(event.name.c_str())
+          << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << te.tid
+          << ",\"ts\":" << event.start_us << ",\"dur\":" << event.dur_us
+          << "}";
+    }
+  }
+  out << "\n]}\n";
+}
+
+} // namespace timeline_trace
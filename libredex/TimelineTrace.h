@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+/*
+ * Records a timeline of the run in the Chrome trace event format, which can be
+ * viewed with chrome://tracing or Perfetto. Every Timer scope becomes a
+ * complete event on the thread that ran it, so nested Timers and passes show
+ * up as a hierarchy. Optionally, the work queue tasks each thread runs are
+ * recorded as well, coalesced into spans of activity, which makes idle cores
+ * and serial phases visible.
+ *
+ * Recording is off by default and costs a relaxed atomic load then.
+ */
+namespace timeline_trace {
+
+using clock = std::chrono::steady_clock;
+
+// Call before any events of interest happen, typically at startup.
+void enable(bool work_queues);
+
+bool is_enabled();
+
+bool work_queues_enabled();
+
+// Records a complete event on the current thread.
+void record(const std::string& name, clock::time_point start,
+            clock::time_point end);
+
+// Records that the current thread ran a work queue task. Tasks that follow
+// each other closely are merged, to keep the trace small.
+void record_work(clock::time_point start, clock::time_point end);
+
+// Writes all events recorded so far. There should be no running Timers or
+// work queues when this is called.
+void write(const std::string& file);
+
+} // namespace timeline_trace
@@ -9,9 +9,10 @@
 
 #include <list>
 
+#include "TimelineTrace.h"
 #include "Trace.h"
 
-unsigned Timer::s_indent = 0;
+std::atomic<unsigned> Timer::s_indent{0};
 std::mutex Timer::s_lock;
 Timer::times_t Timer::s_times;
 std::mutex AccumulatingTimer::s_lock;
@@ -19,7 +20,7 @@ AccumulatingTimer::times_impl_t* AccumulatingTimer::s_times{nullptr};
 
 Timer::Timer(const std::string& msg, bool indent)
     : m_msg(msg),
-      m_start(std::chrono::high_resolution_clock::now()),
+      m_start(std::chrono::steady_clock::now()),
       m_indent(indent) {
   if (indent) {
     ++s_indent;
@@ -30,10 +31,11 @@ Timer::~Timer() {
   if (m_indent) {
     --s_indent;
   }
-  auto end = std::chrono::high_resolution_clock::now();
+  auto end = std::chrono::steady_clock::now();
   auto duration_s = std::chrono::duration<double>(end - m_start).count();
-  TRACE(TIME, 1, "%*s%s completed in %.1lf seconds", 4 * s_indent, "",
+  TRACE(TIME, 1, "%*s%s completed in %.1lf seconds", 4 * s_indent.load(), "",
         m_msg.c_str(), duration_s);
+  timeline_trace::record(m_msg, m_start, end);
 
   Timer::add_timer(std::move(m_msg), duration_s);
 }
@@ -30,9 +30,9 @@ struct Timer {
  private:
   static std::mutex s_lock;
   static times_t s_times;
-  static unsigned s_indent;
+  static std::atomic<unsigned> s_indent;
   std::string m_msg;
-  std::chrono::high_resolution_clock::time_point m_start;
+  std::chrono::steady_clock::time_point m_start;
   bool m_indent;
 };
 
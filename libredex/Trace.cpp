@@ -8,16 +8,22 @@
 #include "Trace.h"
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "ControlFlow.h"
 #include "Debug.h"
@@ -25,14 +31,27 @@
 #include "IRCode.h"
 #include "Macros.h"
 #include "Show.h"
+#include "StlUtil.h"
 #include "TraceContextAccess.h"
 
 namespace {
 
+// The output of a thread in buffered mode, waiting to be written out.
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::string data;
+};
+
+// Buffers are handed to the writer early once they grow beyond this size.
+constexpr size_t kFlushThreshold = 64 * 1024;
+constexpr std::chrono::milliseconds kFlushInterval{100};
+
 struct Tracer {
 
   bool m_show_timestamps{false};
   bool m_show_tracemodule{false};
+  bool m_show_thread{false};
+  bool m_buffered{false};
   const char* m_method_filter;
   std::unordered_map<int /*TraceModule*/, std::string> m_module_id_name_map;
 
@@ -41,6 +60,8 @@ struct Tracer {
     const char* envfile = getenv("TRACEFILE");
     const char* show_timestamps = getenv("SHOW_TIMESTAMPS");
     const char* show_tracemodule = getenv("SHOW_TRACEMODULE");
+    const char* show_thread = getenv("SHOW_TRACETHREAD");
+    const char* buffered = getenv("TRACE_BUFFERED");
     m_method_filter = getenv("TRACE_METHOD_FILTER");
     if (!traceenv) {
       init_trace_file(nullptr);
@@ -56,9 +77,13 @@ struct Tracer {
     std::cerr << "SHOW_TRACEMODULE="
               << (show_tracemodule == nullptr ? "" : show_tracemodule)
               << std::endl;
+    std::cerr << "SHOW_TRACETHREAD="
+              << (show_thread == nullptr ? "" : show_thread) << std::endl;
     std::cerr << "TRACE_METHOD_FILTER="
               << (m_method_filter == nullptr ? "" : m_method_filter)
               << std::endl;
+    std::cerr << "TRACE_BUFFERED=" << (buffered == nullptr ? "" : buffered)
+              << std::endl;
 
     init_trace_modules(traceenv);
     init_trace_file(envfile);
@@ -69,13 +94,30 @@ struct Tracer {
     if (show_tracemodule) {
       m_show_tracemodule = true;
     }
+    if (show_thread) {
+      m_show_thread = true;
+    }
 
 #define TM(x) m_module_id_name_map[static_cast<int>(x)] = #x;
     TMS
 #undef TM
+
+    if (buffered) {
+      m_buffered = true;
+      m_writer = std::thread([this]() { run_writer(); });
+    }
   }
 
   ~Tracer() {
+    if (m_writer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_stop_writer = true;
+      }
+      m_writer_cv.notify_one();
+      m_writer.join();
+      write_buffers(/* best_effort */ false);
+    }
     if (m_file != nullptr && m_file != stderr) {
       fclose(m_file);
     }
@@ -112,7 +154,11 @@ struct Tracer {
              va_list ap) {
     // Assume that `trace` is never called without `traceEnabled`, so we
     // do not need to check anything (including context) here.
-    std::lock_guard<std::mutex> guard(m_trace_mutex);
+    //
+    // The line is formatted without holding any lock, and then either written
+    // out right away, or appended to the buffer of the current thread.
+    thread_local std::string line;
+    line.clear();
     if (m_show_timestamps) {
       auto t = std::time(nullptr);
       struct tm local_tm;
@@ -123,22 +169,144 @@ struct Tracer {
 #endif
       std::array<char, 40> buf;
       std::strftime(buf.data(), sizeof(buf), "%c", &local_tm);
-      fprintf(m_file, "[%s]", buf.data());
-      if (!m_show_tracemodule) {
-        fprintf(m_file, " ");
+      line.append("[").append(buf.data()).append("]");
+      if (!m_show_tracemodule && !m_show_thread) {
+        line.append(" ");
       }
     }
+    if (m_show_thread) {
+      line.append("[T").append(std::to_string(thread_id())).append("] ");
+    }
     if (m_show_tracemodule) {
-      fprintf(m_file, "[%s:%d] ", m_module_id_name_map[module].c_str(), level);
+      line.append("[")
+          .append(m_module_id_name_map.at(module))
+          .append(":")
+          .append(std::to_string(level))
+          .append("] ");
     }
-    vfprintf(m_file, fmt, ap);
+    append_vformat(&line, fmt, ap);
     if (!suppress_newline) {
-      fprintf(m_file, "\n");
+      line.append("\n");
+    }
+
+    if (!m_buffered) {
+      std::lock_guard<std::mutex> guard(m_trace_mutex);
+      fwrite(line.data(), 1, line.size(), m_file);
+      fflush(m_file);
+      return;
+    }
+    auto& buffer = get_thread_buffer();
+    size_t size;
+    {
+      std::lock_guard<std::mutex> guard(buffer.mutex);
+      buffer.data.append(line);
+      size = buffer.data.size();
+    }
+    if (size >= kFlushThreshold) {
+      m_writer_cv.notify_one();
+    }
+  }
+
+  /*
+   * Writes out the buffered output of all threads. In best-effort mode, which
+   * is used when crashing, buffers that are currently locked are skipped.
+   */
+  void write_buffers(bool best_effort) {
+    if (!m_buffered) {
+      return;
+    }
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+      std::unique_lock<std::mutex> lock(m_buffers_mutex, std::defer_lock);
+      if (best_effort) {
+        if (!lock.try_lock()) {
+          return;
+        }
+      } else {
+        lock.lock();
+      }
+      // Drop the buffers of threads that have exited once they are empty.
+      std20::erase_if(m_buffers, [](const auto& buffer) {
+        return buffer.use_count() == 1 && buffer->data.empty();
+      });
+      buffers = m_buffers;
+    }
+    std::unique_lock<std::mutex> file_lock(m_trace_mutex, std::defer_lock);
+    if (best_effort) {
+      if (!file_lock.try_lock()) {
+        return;
+      }
+    } else {
+      file_lock.lock();
+    }
+    std::string data;
+    for (auto& buffer : buffers) {
+      {
+        std::unique_lock<std::mutex> lock(buffer->mutex, std::defer_lock);
+        if (best_effort) {
+          if (!lock.try_lock()) {
+            continue;
+          }
+        } else {
+          lock.lock();
+        }
+        data.swap(buffer->data);
+      }
+      fwrite(data.data(), 1, data.size(), m_file);
+      data.clear();
     }
     fflush(m_file);
   }
 
  private:
+  static uint32_t thread_id() {
+    static std::atomic<uint32_t> s_next_thread_id{0};
+    thread_local uint32_t id = s_next_thread_id.fetch_add(1);
+    return id;
+  }
+
+  static void append_vformat(std::string* out, const char* fmt, va_list ap) {
+    va_list backup;
+    va_copy(backup, ap);
+    auto offset = out->size();
+    std::array<char, 256> buf;
+    int size = vsnprintf(buf.data(), buf.size(), fmt, ap);
+    if (size < 0) {
+      va_end(backup);
+      return;
+    }
+    if ((size_t)size < buf.size()) {
+      out->append(buf.data(), size);
+    } else {
+      out->resize(offset + size + 1);
+      vsnprintf(&(*out)[offset], size + 1, fmt, backup);
+      out->resize(offset + size);
+    }
+    va_end(backup);
+  }
+
+  ThreadBuffer& get_thread_buffer() {
+    // The buffers are shared with the writer, so that output of threads that
+    // have exited in the meantime is not lost.
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+      buffer = std::make_shared<ThreadBuffer>();
+      std::lock_guard<std::mutex> lock(m_buffers_mutex);
+      m_buffers.push_back(buffer);
+    }
+    return *buffer;
+  }
+
+  void run_writer() {
+    std::unique_lock<std::mutex> lock(m_writer_mutex);
+    while (!m_stop_writer) {
+      m_writer_cv.wait_for(lock, kFlushInterval);
+      lock.unlock();
+      write_buffers(/* best_effort */ false);
+      lock.lock();
+    }
+  }
+
   void init_trace_modules(const char* traceenv) {
     std::unordered_map<std::string, int> module_id_map{{
 #define TM(x) {std::string(#x), x},
@@ -199,6 +367,13 @@ struct Tracer {
   std::array<long, N_TRACE_MODULES> m_traces;
 
   std::mutex m_trace_mutex;
+
+  std::mutex m_buffers_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+  std::mutex m_writer_mutex;
+  std::condition_variable m_writer_cv;
+  bool m_stop_writer{false};
+  std::thread m_writer;
 };
 
 static Tracer tracer;
@@ -221,6 +396,8 @@ void trace(TraceModule module,
   va_end(ap);
 }
 
+void trace_flush() { tracer.write_buffers(/* best_effort */ true); }
+
 #if !IS_WINDOWS
 const std::string& TraceContext::get_string_value() const {
   if (string_value->empty()) {
@@ -203,6 +203,14 @@ void trace(TraceModule module,
            const char* fmt,
            ...) ATTR_FORMAT(4, 5);
 
+/*
+ * With TRACE_BUFFERED set, trace output is buffered per thread and written
+ * out periodically by a background thread. This writes out whatever is
+ * buffered right away, e.g. before crashing. It does not block, and may skip
+ * buffers that are in use.
+ */
+void trace_flush();
+
 #define TRACE(module, level, fmt, ...)                                        \
   do {                                                                        \
     if (traceEnabled(module, level)) {                                        \
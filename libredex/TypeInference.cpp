@@ -1623,4 +1623,53 @@ void TypeInference::populate_type_environments() {
   }
 }
 
+namespace {
+
+struct SharedTypeInference {
+  bool is_static;
+  DexType* declaring_type;
+  DexTypeList* args;
+  TypeInference inference;
+
+  SharedTypeInference(const cfg::ControlFlowGraph& cfg,
+                      bool is_static,
+                      DexType* declaring_type,
+                      DexTypeList* args)
+      : is_static(is_static),
+        declaring_type(declaring_type),
+        args(args),
+        inference(cfg) {
+    inference.run(is_static, declaring_type, args);
+  }
+};
+
+} // namespace
+
+std::shared_ptr<const TypeInference> get_shared_type_inference(
+    const cfg::ControlFlowGraph& cfg,
+    bool is_static,
+    DexType* declaring_type,
+    DexTypeList* args) {
+  auto make = [&]() {
+    return std::make_shared<const SharedTypeInference>(cfg, is_static,
+                                                       declaring_type, args);
+  };
+  auto shared =
+      cfg.get_code_data<SharedTypeInference, SharedTypeInference>(make);
+  if (shared->is_static != is_static ||
+      shared->declaring_type != declaring_type || shared->args != args) {
+    // The shared inference was run for a different signature. Don't replace
+    // it for the callers using it.
+    shared = make();
+  }
+  return std::shared_ptr<const TypeInference>(shared, &shared->inference);
+}
+
+std::shared_ptr<const TypeInference> get_shared_type_inference(
+    const cfg::ControlFlowGraph& cfg, const DexMethod* dex_method) {
+  return get_shared_type_inference(cfg, is_static(dex_method),
+                                   dex_method->get_class(),
+                                   dex_method->get_proto()->get_args());
+}
+
 } // namespace type_inference
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <ostream>
 
 #include <boost/optional/optional_io.hpp>
@@ -285,7 +286,9 @@ class TypeInference final
         m_cfg(cfg),
         m_skip_check_cast_upcasting(skip_check_cast_upcasting),
         m_annotations{annotations},
-        m_method_override_graph(method_override_graph) {}
+        m_method_override_graph(method_override_graph) {
+    ir_analyzer::run_in_parallel_if_large(cfg, this);
+  }
 
   void run(const DexMethod* dex_method);
 
@@ -371,4 +374,19 @@ class TypeInference final
                       const DexType* type) const;
 };
 
+/*
+ * Runs a TypeInference with the default options on the given cfg, or returns
+ * one that is still in use elsewhere for the same parameters, as long as the
+ * code did not change in the meantime; see
+ * ControlFlowGraph::get_code_data().
+ */
+std::shared_ptr<const TypeInference> get_shared_type_inference(
+    const cfg::ControlFlowGraph& cfg,
+    bool is_static,
+    DexType* declaring_type,
+    DexTypeList* args);
+
+std::shared_ptr<const TypeInference> get_shared_type_inference(
+    const cfg::ControlFlowGraph& cfg, const DexMethod* dex_method);
+
 } // namespace type_inference
@@ -36,6 +36,7 @@ class TypeSystem {
   static const TypeVector empty_vec;
 
   ClassScopes m_class_scopes;
+  ClassHierarchyIndex m_hierarchy_index;
   ClassHierarchy m_intf_children;
   InstanceOfTable m_instanceof_table;
   TypeToTypeSet m_interfaces;
@@ -59,8 +60,17 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   void get_all_children(const DexType* type, TypeSet& children) const {
-    return ::get_all_children(
-        m_class_scopes.get_class_hierarchy(), type, children);
+    auto range = m_hierarchy_index.get_all_children(type);
+    children.insert(range.begin(), range.end());
+  }
+
+  /**
+   * Get all the children of a given type, in pre-order, without building a
+   * set.
+   * The type must be a class (not an interface).
+   */
+  ClassHierarchyIndex::TypeRange get_all_children(const DexType* type) const {
+    return m_hierarchy_index.get_all_children(type);
   }
 
   /**
@@ -107,16 +117,7 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   bool is_subtype(const DexType* parent, const DexType* child) const {
-    const auto& parent_it = m_instanceof_table.find(parent);
-    const auto& child_it = m_instanceof_table.find(child);
-    if (parent_it == m_instanceof_table.end() ||
-        child_it == m_instanceof_table.end()) {
-      return false;
-    }
-    const auto& p_chain = parent_it->second;
-    const auto& c_chain = child_it->second;
-    if (p_chain.size() > c_chain.size()) return false;
-    return c_chain.at(p_chain.size() - 1) == parent;
+    return m_hierarchy_index.is_subclass(parent, child);
   }
 
   /**
@@ -125,9 +126,7 @@ class TypeSystem {
    * or an interface DAG.
    */
   bool implements(const DexType* cls, const DexType* intf) const {
-    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
-    if (implementors == m_class_scopes.get_interface_map().end()) return false;
-    return implementors->second.count(cls) > 0;
+    return m_hierarchy_index.implements(cls, intf);
   }
 
   /**
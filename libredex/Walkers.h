@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <functional>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "ControlFlow.h"
@@ -55,6 +57,26 @@ inline CacheAligned<T>::operator T&() {
   return m_aligned;
 }
 
+namespace walk_detail {
+
+template <typename MemFn>
+struct takes_const_code : std::false_type {};
+template <typename R, typename C, typename M>
+struct takes_const_code<R (C::*)(M, const IRCode&) const> : std::true_type {};
+template <typename R, typename C, typename M>
+struct takes_const_code<R (C::*)(M, const IRCode&)> : std::true_type {};
+
+// Whether `WalkerFn` is a non-generic callable that takes the code as
+// `const IRCode&`. Walking such code does not mark the methods as mutated
+// (see DexMethod::is_hash_dirty()).
+template <typename WalkerFn, typename = void>
+struct reads_code_only : std::false_type {};
+template <typename WalkerFn>
+struct reads_code_only<WalkerFn, std::void_t<decltype(&WalkerFn::operator())>>
+    : takes_const_code<decltype(&WalkerFn::operator())> {};
+
+} // namespace walk_detail
+
 /**
  * A collection of methods useful for iterating over elements of DexClasses.
  *
@@ -67,6 +89,9 @@ inline CacheAligned<T>::operator T&() {
 class walk {
  private:
   static constexpr bool all_methods(DexMethod*) { return true; }
+  static size_t method_size_cost(DexMethod*, const IRCode& code) {
+    return code.count_opcodes();
+  }
 
  public:
   // This is a "static class". Disallow construction.
@@ -268,14 +293,26 @@ class walk {
                            const WalkerFn& walker) {
     iterate_methods(cls, [&filter, &walker](DexMethod* m) {
       if (filter(m)) {
-        auto code = m->get_code();
-        if (code) {
-          walker(m, *code);
-        }
+        walk_code(m, walker);
       }
     });
   }
 
+  // Calls `walker` on the code of `m`, if it has any. Only walkers that may
+  // change the code get it through the non-const accessor.
+  template <typename WalkerFn>
+  static void walk_code(DexMethod* m, const WalkerFn& walker) {
+    if constexpr (walk_detail::reads_code_only<WalkerFn>::value) {
+      if (const auto* code = std::as_const(*m).get_code()) {
+        walker(m, *code);
+      }
+    } else {
+      if (auto* code = m->get_code()) {
+        walker(m, *code);
+      }
+    }
+  }
+
   template <typename FilterFn, typename WalkerFn>
   static void iterate_opcodes(const DexClass* cls,
                               const FilterFn& filter,
@@ -325,9 +362,19 @@ class walk {
                                       IRCode& ir_code,
                                       const Predicate& predicate,
                                       const Walker& walker) {
+    // Only collect instructions from the first one matching the head of the
+    // pattern onwards, which skips most methods without copying anything.
+    const auto& head = std::get<0>(predicate);
+    auto ii = ir_list::InstructionIterable(ir_code);
+    auto it = std::find_if(ii.begin(), ii.end(), [&head](auto& mie) {
+      return head.matches(mie.insn);
+    });
+    if (it == ii.end()) {
+      return;
+    }
     std::vector<IRInstruction*> insns;
-    for (MethodItemEntry& mie : ir_list::InstructionIterable(ir_code)) {
-      insns.emplace_back(mie.insn);
+    for (; it != ii.end(); ++it) {
+      insns.emplace_back(it->insn);
     }
 
     std::vector<std::vector<IRInstruction*>> matches;
@@ -400,12 +447,118 @@ class walk {
     }
   };
 
+  // A range of the classes of a chunked parallel walk that forms one task.
+  struct ClassChunk {
+    size_t begin;
+    size_t end;
+    size_t cost;
+  };
+
+  // Every thread gets about this many tasks, which leaves enough room for
+  // balancing the load by work stealing.
+  static constexpr size_t CHUNKS_PER_THREAD = 8;
+  // Smaller tasks are not worth their overhead.
+  static constexpr size_t MIN_CHUNK_COST = 512;
+  // Lazily loaded code is not decoded just to estimate its size.
+  static constexpr size_t PENDING_CODE_COST = 32;
+
+  // A cheap estimate of the cost of visiting the class and its methods, in
+  // the order of the number of instructions.
+  static size_t class_cost(const DexClass* cls) {
+    size_t cost{1};
+    auto add_method_costs = [&cost](const std::vector<DexMethod*>& methods) {
+      for (const DexMethod* m : methods) {
+        ++cost;
+        if (m->is_code_pending()) {
+          cost += PENDING_CODE_COST;
+        } else if (const auto* code = m->get_code()) {
+          cost += code->estimate_num_entries();
+        }
+      }
+    };
+    add_method_costs(cls->get_dmethods());
+    add_method_costs(cls->get_vmethods());
+    return cost;
+  }
+
+  // Reorders `classes` so that every chunk is a contiguous range, and returns
+  // the chunks by decreasing cost. Classes that are at least as expensive as
+  // a chunk should be, get a chunk of their own, and all others are batched in
+  // their original order.
+  static std::vector<ClassChunk> make_class_chunks(
+      std::vector<DexClass*>* classes, size_t num_threads) {
+    std::vector<size_t> costs;
+    costs.reserve(classes->size());
+    size_t total_cost{0};
+    for (auto* cls : *classes) {
+      costs.push_back(class_cost(cls));
+      total_cost += costs.back();
+    }
+    size_t chunk_cost = std::max(
+        MIN_CHUNK_COST, total_cost / (std::max<size_t>(num_threads, 1) *
+                                      CHUNKS_PER_THREAD));
+
+    std::vector<DexClass*> ordered;
+    ordered.reserve(classes->size());
+    std::vector<ClassChunk> chunks;
+    for (size_t i = 0; i < classes->size(); ++i) {
+      if (costs[i] >= chunk_cost) {
+        chunks.push_back({ordered.size(), ordered.size() + 1, costs[i]});
+        ordered.push_back((*classes)[i]);
+      }
+    }
+    ClassChunk batch{ordered.size(), ordered.size(), 0};
+    for (size_t i = 0; i < classes->size(); ++i) {
+      if (costs[i] >= chunk_cost) {
+        continue;
+      }
+      ordered.push_back((*classes)[i]);
+      batch.end = ordered.size();
+      batch.cost += costs[i];
+      if (batch.cost >= chunk_cost) {
+        chunks.push_back(batch);
+        batch = ClassChunk{batch.end, batch.end, 0};
+      }
+    }
+    if (batch.begin != batch.end) {
+      chunks.push_back(batch);
+    }
+    std::stable_sort(
+        chunks.begin(), chunks.end(),
+        [](const auto& a, const auto& b) { return a.cost > b.cost; });
+    *classes = std::move(ordered);
+    return chunks;
+  }
+
+  // Runs `fn` on all classes in parallel, on chunks of classes made by
+  // make_class_chunks(). All methods of a class are still visited by a single
+  // task.
+  //   Fn should accept `(DexClass*, size_t worker_id)`.
+  template <class Classes, typename Fn>
+  static void run_class_chunks(const Classes& classes,
+                               const Fn& fn,
+                               size_t num_threads) {
+    std::vector<DexClass*> ordered(classes.begin(), classes.end());
+    auto chunks = make_class_chunks(&ordered, num_threads);
+    workqueue_run<ClassChunk>(
+        [&](sparta::WorkerState<ClassChunk>* state, const ClassChunk& chunk) {
+          for (size_t i = chunk.begin; i < chunk.end; ++i) {
+            fn(ordered[i], state->worker_id());
+          }
+        },
+        chunks,
+        num_threads);
+  }
+
  public:
   /**
    * The parallel:: methods have very similar signatures (and names) to their
    * sequential counterparts.
    * The unit of parallelization is a DexClass. The reason is that we don't want
    * to create too many tasks on the WorkQueue, paying the overhead for each.
+   * The classes(), methods(), code() and opcodes() walks go further and hand
+   * out chunks of classes of similar estimated cost, biggest first (see
+   * make_class_chunks()).
    */
   class parallel {
    public:
@@ -423,9 +576,8 @@ class walk {
         Classes const& classes,
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads()) {
-      workqueue_run<DexClass*>( // over-parallelized maybe
-          [&walker](DexClass* cls) { walker(cls); },
-          classes,
+      run_class_chunks(
+          classes, [&walker](DexClass* cls, size_t) { walker(cls); },
           num_threads);
     }
 
@@ -440,13 +592,12 @@ class walk {
         Accumulator init = Accumulator()) {
       std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
       auto reduce = Reduce();
-      workqueue_run<DexClass*>( // over-parallelized maybe
-          [&walker, &acc_vec, &reduce](sparta::WorkerState<DexClass*>* state,
-                                       DexClass* cls) {
-            Accumulator& acc = acc_vec[state->worker_id()];
+      run_class_chunks(
+          classes,
+          [&walker, &acc_vec, &reduce](DexClass* cls, size_t worker_id) {
+            Accumulator& acc = acc_vec[worker_id];
             reduce(walker(cls), &acc);
           },
-          classes,
           num_threads);
       for (Accumulator& acc : acc_vec) {
         reduce(acc, &init);
@@ -461,9 +612,11 @@ class walk {
         const Classes& classes,
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads()) {
-      workqueue_run<DexClass*>(
-          [&walker](DexClass* cls) { walk::iterate_methods(cls, walker); },
+      run_class_chunks(
           classes,
+          [&walker](DexClass* cls, size_t) {
+            walk::iterate_methods(cls, walker);
+          },
           num_threads);
     }
 
@@ -487,9 +640,10 @@ class walk {
         Accumulator init = Accumulator()) {
       std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
 
-      workqueue_run<DexClass*>(
-          [&](sparta::WorkerState<DexClass*>* state, DexClass* cls) {
-            Accumulator& acc = acc_vec[state->worker_id()];
+      run_class_chunks(
+          classes,
+          [&](DexClass* cls, size_t worker_id) {
+            Accumulator& acc = acc_vec[worker_id];
             for (auto dmethod : cls->get_dmethods()) {
               TraceContext context(dmethod);
               walker(dmethod, &acc);
@@ -499,7 +653,6 @@ class walk {
               walker(vmethod, &acc);
             }
           },
-          classes,
           num_threads);
 
       auto reduce = Reduce();
@@ -538,6 +691,44 @@ class walk {
     }
 
     //
+    // Like the `methods()` variant above whose walker returns an Accumulator,
+    // but with methods as the unit of parallelization, started in order of
+    // decreasing size of their code, so that huge methods do not end up
+    // running alone at the end.
+    template <class Accumulator,
+              class Reduce = plus_assign<Accumulator>,
+              class Classes,
+              typename WalkerFn>
+    static Accumulator methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      std::vector<DexMethod*> methods;
+      for (const auto& cls : classes) {
+        iterate_methods(cls,
+                        [&methods](DexMethod* m) { methods.push_back(m); });
+      }
+      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
+      auto reduce = Reduce();
+      workqueue_run_by_cost<DexMethod*>(
+          [&](sparta::WorkerState<DexMethod*>* state, DexMethod* m) {
+            Accumulator& acc = acc_vec[state->worker_id()];
+            TraceContext context(m);
+            reduce(walker(m), &acc);
+          },
+          methods,
+          [](DexMethod* m) -> size_t {
+            const auto* code = std::as_const(*m).get_code();
+            return code == nullptr ? 0 : method_size_cost(m, *code);
+          },
+          num_threads);
+      for (Accumulator& acc : acc_vec) {
+        reduce(acc, &init);
+      }
+      return init;
+    }
+
     // Call `walker` on all fields in `classes` in parallel.
     //   WalkerFn should accept a `DexField*`.
     template <class Classes, typename WalkerFn>
@@ -587,11 +778,11 @@ class walk {
         const FilterFn& filter,
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads()) {
-      workqueue_run<DexClass*>(
-          [&filter, &walker](DexClass* cls) {
+      run_class_chunks(
+          classes,
+          [&filter, &walker](DexClass* cls, size_t) {
             walk::iterate_code(cls, filter, walker);
           },
-          classes,
           num_threads);
     }
 
@@ -604,6 +795,51 @@ class walk {
       walk::parallel::code(classes, all_methods, walker, num_threads);
     }
 
+    // Call `walker` on all code (of methods approved by `filter`) in `classes`
+    // in parallel, with methods as the unit of parallelization. Methods are
+    // started in order of decreasing cost, so that huge methods do not end up
+    // running alone at the end.
+    //   FilterFn should accept a `DexMethod*` and return a bool.
+    //   WalkerFn should accept `(DexMethod*, IRCode&)`.
+    //   CostFn should accept `(DexMethod*, const IRCode&)` and return a size_t.
+    template <class Classes,
+              typename FilterFn,
+              typename WalkerFn,
+              typename CostFn>
+    static void code_by_cost(
+        const Classes& classes,
+        const FilterFn& filter,
+        const WalkerFn& walker,
+        const CostFn& cost,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      std::vector<DexMethod*> methods;
+      for (const auto& cls : classes) {
+        iterate_methods(cls, [&filter, &methods](DexMethod* m) {
+          if (filter(m) && std::as_const(*m).get_code() != nullptr) {
+            methods.push_back(m);
+          }
+        });
+      }
+      workqueue_run_by_cost<DexMethod*>(
+          [&walker](DexMethod* m) { walk_code(m, walker); },
+          methods,
+          [&cost](DexMethod* m) -> size_t {
+            return cost(m, *std::as_const(*m).get_code());
+          },
+          num_threads);
+    }
+
+    // Same as `code_by_cost()` but with a filter function that accepts all
+    // methods, and the number of instructions as the cost.
+    template <class Classes, typename WalkerFn>
+    static void code_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::parallel::code_by_cost(classes, all_methods, walker,
+                                   method_size_cost, num_threads);
+    }
+
     // Call `walker` on all opcodes (of methods approved by `filter`) in
     // `classes` in parallel.
     //   FilterFn should accept a `DexMethod*` and return a bool.
@@ -614,11 +850,11 @@ class walk {
         const FilterFn& filter,
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads()) {
-      workqueue_run<DexClass*>(
-          [&filter, &walker](DexClass* cls) {
+      run_class_chunks(
+          classes,
+          [&filter, &walker](DexClass* cls, size_t) {
             walk::iterate_opcodes(cls, filter, walker);
           },
-          classes,
           num_threads);
     }
 
@@ -7,9 +7,42 @@
 
 #include "WorkQueue.h"
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iostream>
+#include <mutex>
 
 #include "DebugUtils.h"
+#include "TimelineTrace.h"
+
+namespace {
+
+struct BusyTimes {
+  std::mutex lock;
+  // A deque, so that slots do not move when threads get added.
+  std::deque<std::atomic<uint64_t>> slots;
+};
+
+BusyTimes& busy_times() {
+  // Leaked on purpose, as threads may outlive static destruction.
+  static auto* busy_times = new BusyTimes();
+  return *busy_times;
+}
+
+std::atomic<uint64_t>& thread_busy_time_slot() {
+  thread_local std::atomic<uint64_t>* slot = []() {
+    auto& bt = busy_times();
+    std::lock_guard<std::mutex> lock(bt.lock);
+    return &bt.slots.emplace_back(0);
+  }();
+  return *slot;
+}
+
+// Zero if default_num_threads() is not overridden.
+std::atomic<size_t> s_num_threads_override{0};
+
+} // namespace
 
 namespace redex_workqueue_impl {
 
@@ -17,4 +50,45 @@ void redex_queue_exception_handler(std::exception& e) {
   print_stack_trace(std::cerr, e);
 }
 
+ScopedBusyTime::~ScopedBusyTime() {
+  auto end = std::chrono::steady_clock::now();
+  auto us =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - m_start);
+  thread_busy_time_slot().fetch_add((uint64_t)us.count(),
+                                    std::memory_order_relaxed);
+  timeline_trace::record_work(m_start, end);
+}
+
 } // namespace redex_workqueue_impl
+
+namespace redex_parallel {
+
+size_t default_num_threads() {
+  auto num_threads = s_num_threads_override.load(std::memory_order_relaxed);
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  // We prefer boost over std. Use hardware over physical concurrency
+  // to take advantage of SMT.
+  return std::max(1u, boost::thread::hardware_concurrency());
+}
+
+ScopedDefaultNumThreads::ScopedDefaultNumThreads(size_t num_threads)
+    : m_previous(s_num_threads_override.exchange(num_threads)) {}
+
+ScopedDefaultNumThreads::~ScopedDefaultNumThreads() {
+  s_num_threads_override.store(m_previous);
+}
+
+std::vector<uint64_t> get_busy_times_us() {
+  auto& bt = busy_times();
+  std::lock_guard<std::mutex> lock(bt.lock);
+  std::vector<uint64_t> res;
+  res.reserve(bt.slots.size());
+  for (const auto& slot : bt.slots) {
+    res.push_back(slot.load(std::memory_order_relaxed));
+  }
+  return res;
+}
+
+} // namespace redex_parallel
@@ -8,7 +8,10 @@
 #pragma once
 
 #include <boost/thread/thread.hpp>
+#include <chrono>
+#include <cstdint>
 #include <exception>
+#include <vector>
 
 #include <sparta/WorkQueue.h>
 
@@ -18,11 +21,26 @@ namespace redex_workqueue_impl {
 
 void redex_queue_exception_handler(std::exception& e);
 
+// Accounts the wall time the current thread spends running a work queue task,
+// see `redex_parallel::get_busy_times_us()`.
+class ScopedBusyTime {
+ public:
+  ScopedBusyTime() : m_start(std::chrono::steady_clock::now()) {}
+  ~ScopedBusyTime();
+
+  ScopedBusyTime(const ScopedBusyTime&) = delete;
+  ScopedBusyTime& operator=(const ScopedBusyTime&) = delete;
+
+ private:
+  std::chrono::steady_clock::time_point m_start;
+};
+
 // Helper classes so the type of Executor can be inferred
 template <typename Input, typename Fn>
 struct NoStateWorkQueueHelper {
   Fn fn;
   void operator()(sparta::WorkerState<Input>*, Input a) {
+    ScopedBusyTime busy_time;
     try {
       fn(std::move(a));
     } catch (std::exception& e) {
@@ -36,6 +54,7 @@ template <typename Input, typename Fn>
 struct WithStateWorkQueueHelper {
   Fn fn;
   void operator()(sparta::WorkerState<Input>* state, Input a) {
+    ScopedBusyTime busy_time;
     try {
       fn(state, std::move(a));
     } catch (std::exception& e) {
@@ -48,11 +67,28 @@ struct WithStateWorkQueueHelper {
 } // namespace redex_workqueue_impl
 
 namespace redex_parallel {
-inline size_t default_num_threads() {
-  // We prefer boost over std. Use hardware over physical concurrency
-  // to take advantage of SMT.
-  return std::max(1u, boost::thread::hardware_concurrency());
-}
+// The hardware concurrency, unless overridden by a ScopedDefaultNumThreads.
+size_t default_num_threads();
+
+// Overrides default_num_threads() while in scope, e.g. for a pass that does
+// not scale well to all cores. Meant to be used between parallel phases, by
+// the thread that starts them.
+class ScopedDefaultNumThreads {
+ public:
+  explicit ScopedDefaultNumThreads(size_t num_threads);
+  ~ScopedDefaultNumThreads();
+
+  ScopedDefaultNumThreads(const ScopedDefaultNumThreads&) = delete;
+  ScopedDefaultNumThreads& operator=(const ScopedDefaultNumThreads&) = delete;
+
+ private:
+  size_t m_previous;
+};
+
+// Returns, for every thread that has run a work queue task so far, the
+// accumulated time in microseconds it spent running tasks. Threads keep their
+// index, so that two snapshots can be compared to attribute work to a phase.
+std::vector<uint64_t> get_busy_times_us();
 } // namespace redex_parallel
 
 // These functions are the most convenient way to create a sparta::WorkQueue
@@ -160,6 +196,47 @@ void workqueue_run(
   }
   wq.run_all();
 }
+// Like `workqueue_run`, but items with a higher cost estimate are started
+// first, which shrinks the tail of a parallel phase that has a few very
+// expensive items. CostFn should accept `const Input&` and return an unsigned
+// integer, e.g., an instruction count.
+template <class Input,
+          typename Fn,
+          typename Items,
+          typename CostFn,
+          typename std::enable_if<sparta::Arity<Fn>::value == 1, int>::type = 0>
+void workqueue_run_by_cost(
+    const Fn& fn,
+    const Items& items,
+    const CostFn& cost,
+    unsigned int num_threads = redex_parallel::default_num_threads(),
+    bool push_tasks_while_running = false) {
+  auto wq = sparta::WorkQueue<
+      Input, redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>>(
+      redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>{fn}, num_threads,
+      push_tasks_while_running, redex_thread_pool::ThreadPool::get_instance());
+  wq.add_items_by_cost(items, cost);
+  wq.run_all();
+}
+template <class Input,
+          typename Fn,
+          typename Items,
+          typename CostFn,
+          typename std::enable_if<sparta::Arity<Fn>::value == 2, int>::type = 0>
+void workqueue_run_by_cost(
+    const Fn& fn,
+    const Items& items,
+    const CostFn& cost,
+    unsigned int num_threads = redex_parallel::default_num_threads(),
+    bool push_tasks_while_running = false) {
+  auto wq = sparta::WorkQueue<
+      Input, redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>>(
+      redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>{fn},
+      num_threads, push_tasks_while_running,
+      redex_thread_pool::ThreadPool::get_instance());
+  wq.add_items_by_cost(items, cost);
+  wq.run_all();
+}
 template <class InteralType, typename Fn>
 void workqueue_run_for(
     InteralType start,
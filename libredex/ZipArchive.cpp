@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ZipArchive.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <iostream>
+#include <zlib.h>
+
+#include "Util.h"
+#include "WorkQueue.h"
+
+namespace {
+
+/* CDFile
+ * Central directory file header entry structures.
+ */
+constexpr uint16_t kCompMethodStore = 0;
+constexpr uint16_t kCompMethodDeflate = 8;
+constexpr std::array<uint8_t, 4> kCDFile = {'P', 'K', 0x01, 0x02};
+
+PACKED(struct pk_cd_file {
+  uint32_t signature;
+  uint16_t vmade;
+  uint16_t vextract;
+  uint16_t flags;
+  uint16_t comp_method;
+  uint16_t mod_time;
+  uint16_t mod_date;
+  uint32_t crc32;
+  uint32_t comp_size;
+  uint32_t ucomp_size;
+  uint16_t fname_len;
+  uint16_t extra_len;
+  uint16_t comment_len;
+  uint16_t diskno;
+  uint16_t interal_attr;
+  uint32_t external_attr;
+  uint32_t disk_offset;
+});
+
+/* CDirEnd:
+ * End of central directory record structures.
+ */
+constexpr int kMaxCDirEndSearch = 100;
+constexpr std::array<uint8_t, 4> kCDirEnd = {'P', 'K', 0x05, 0x06};
+
+PACKED(struct pk_cdir_end {
+  uint32_t signature;
+  uint16_t diskno;
+  uint16_t cd_diskno;
+  uint16_t cd_disk_entries;
+  uint16_t cd_entries;
+  uint32_t cd_size;
+  uint32_t cd_disk_offset;
+  uint16_t comment_len;
+});
+
+/* LFile:
+ * Local file header structures.
+ * (Yes, this made more sense in the world of floppies and tapes.)
+ */
+constexpr std::array<uint8_t, 4> kLFile = {'P', 'K', 0x03, 0x04};
+
+PACKED(struct pk_lfile {
+  uint32_t signature;
+  uint16_t vextract;
+  uint16_t flags;
+  uint16_t comp_method;
+  uint16_t mod_time;
+  uint16_t mod_date;
+  uint32_t crc32;
+  uint32_t comp_size;
+  uint32_t ucomp_size;
+  uint16_t fname_len;
+  uint16_t extra_len;
+});
+
+bool find_central_directory(const uint8_t* mapping,
+                            ssize_t size,
+                            pk_cdir_end& pce) {
+  ssize_t soffset = (size - sizeof(pk_cdir_end));
+  ssize_t eoffset = soffset - kMaxCDirEndSearch;
+  if (soffset < 0) return false;
+  if (eoffset < 0) eoffset = 0;
+  do {
+    const uint8_t* cdsearch = mapping + soffset;
+    if (memcmp(cdsearch, kCDirEnd.data(), kCDirEnd.size()) == 0) {
+      memcpy(&pce, cdsearch, sizeof(pk_cdir_end));
+      return true;
+    }
+  } while (soffset-- > eoffset);
+  std::cerr << "End of central directory record not found, bailing\n";
+  return false;
+}
+
+bool validate_pce(pk_cdir_end& pce, ssize_t size) {
+  /* We only support a limited feature set.  We
+   * don't support disk-spanning, so bail if that's the case.
+   */
+  if (pce.cd_diskno != pce.diskno || pce.cd_diskno != 0 ||
+      pce.cd_entries != pce.cd_disk_entries) {
+    std::cerr << "Disk spanning is not supported, bailing\n";
+    return false;
+  }
+  ssize_t data_size = size - sizeof(pk_cdir_end);
+  if (pce.cd_disk_offset + pce.cd_size > data_size) {
+    std::cerr << "Central directory overflow, invalid pce structure\n";
+    return false;
+  }
+  return true;
+}
+
+bool extract_cd_entry(const uint8_t*& mapping,
+                      size_t& offset,
+                      size_t total_size,
+                      ZipArchive::Entry& entry) {
+  if (offset + kCDFile.size() > total_size) {
+    std::cerr << "Reading mapping out of bound, bailing\n";
+    return false;
+  }
+  if (memcmp(mapping, kCDFile.data(), kCDFile.size()) != 0) {
+    std::cerr << "Invalid central directory entry, bailing\n";
+    return false;
+  }
+  offset += sizeof(pk_cd_file);
+  if (offset >= total_size) {
+    std::cerr << "Reading mapping out of bound\n";
+    return false;
+  }
+  pk_cd_file cd_entry;
+  memcpy(&cd_entry, mapping, sizeof(pk_cd_file));
+  mapping += sizeof(pk_cd_file);
+  offset += cd_entry.fname_len;
+  if (offset >= total_size) {
+    std::cerr << "Reading mapping out of bound\n";
+    return false;
+  }
+  entry.name = std::string((const char*)mapping, cd_entry.fname_len);
+  entry.comp_method = cd_entry.comp_method;
+  entry.crc32 = cd_entry.crc32;
+  entry.comp_size = cd_entry.comp_size;
+  entry.ucomp_size = cd_entry.ucomp_size;
+  entry.local_header_offset = cd_entry.disk_offset;
+  mapping += cd_entry.fname_len;
+  offset = offset + cd_entry.extra_len + cd_entry.comment_len;
+  mapping += cd_entry.extra_len;
+  mapping += cd_entry.comment_len;
+  return true;
+}
+
+int uncompress_entry(Bytef* dest,
+                     uLongf* destLen,
+                     const Bytef* source,
+                     uLong sourceLen,
+                     uint32_t comp_method) {
+  if (comp_method == kCompMethodStore) {
+    if (sourceLen > *destLen) {
+      std::cerr << "Not enough space for STOREd entry: " << sourceLen << " vs "
+                << *destLen << std::endl;
+      return Z_BUF_ERROR;
+    }
+    memcpy(dest, source, sourceLen);
+    *destLen = sourceLen;
+    return Z_OK;
+  }
+
+  z_stream stream;
+  int err;
+
+  stream.next_in = (Bytef*)source;
+  stream.avail_in = (uInt)sourceLen;
+  stream.next_out = dest;
+  stream.avail_out = (uInt)*destLen;
+  stream.zalloc = (alloc_func)0;
+  stream.zfree = (free_func)0;
+
+  err = inflateInit2(&stream, -MAX_WBITS);
+  if (err != Z_OK) return err;
+
+  err = inflate(&stream, Z_FINISH);
+  if (err != Z_STREAM_END) {
+    inflateEnd(&stream);
+    return err;
+  }
+  *destLen = stream.total_out;
+
+  err = inflateEnd(&stream);
+  return err;
+}
+
+// Deflates the contents without zlib header, as ZIP entries are stored.
+bool raw_deflate(const std::string& contents, int level, std::string* out) {
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&stream, contents.size()));
+  stream.next_in = (Bytef*)contents.data();
+  stream.avail_in = (uInt)contents.size();
+  stream.next_out = (Bytef*)out->data();
+  stream.avail_out = (uInt)out->size();
+  int err = deflate(&stream, Z_FINISH);
+  out->resize(stream.total_out);
+  deflateEnd(&stream);
+  return err == Z_STREAM_END;
+}
+
+constexpr size_t kStoredAlignment = 4;
+constexpr size_t kPageAlignment = 4096;
+// 1980-01-01 00:00:00, the earliest DOS date.
+constexpr uint16_t kDosTime = 0;
+constexpr uint16_t kDosDate = (1 << 5) | 1;
+
+bool is_shared_library(const std::string& name) {
+  return name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0;
+}
+
+template <typename T>
+void write_struct(std::ostream& out, const T& t) {
+  out.write(reinterpret_cast<const char*>(&t), sizeof(T));
+}
+
+} // namespace
+
+ZipArchive::ZipArchive(const uint8_t* data, size_t size)
+    : m_data(data), m_size(size) {
+  pk_cdir_end pce;
+  if (!find_central_directory(data, size, pce) || !validate_pce(pce, size)) {
+    return;
+  }
+  const uint8_t* cdir = data + pce.cd_disk_offset;
+  m_entries.resize(pce.cd_entries);
+  size_t offset = pce.cd_disk_offset;
+  for (auto& entry : m_entries) {
+    if (!extract_cd_entry(cdir, offset, size, entry)) {
+      m_entries.clear();
+      return;
+    }
+  }
+  m_valid = true;
+}
+
+const ZipArchive::Entry* ZipArchive::find(std::string_view name) const {
+  for (const auto& entry : m_entries) {
+    if (entry.name == name) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const uint8_t* ZipArchive::get_data(const Entry& entry) const {
+  if (entry.comp_method != kCompMethodDeflate &&
+      entry.comp_method != kCompMethodStore) {
+    std::cerr << "Unknown compression method " << entry.comp_method << " for "
+              << entry.name << ", Bailing\n";
+    return nullptr;
+  }
+
+  static_assert(kLFile.size() <= sizeof(pk_lfile));
+  if (entry.local_header_offset + sizeof(pk_lfile) >= m_size) {
+    std::cerr << "Entry out of map bounds!\n";
+    return nullptr;
+  }
+  const uint8_t* lfile = m_data + entry.local_header_offset;
+  if (memcmp(lfile, kLFile.data(), kLFile.size()) != 0) {
+    std::cerr << "Invalid local file entry, bailing\n";
+    return nullptr;
+  }
+
+  pk_lfile pkf;
+  memcpy(&pkf, lfile, sizeof(pk_lfile));
+  if (pkf.comp_size == 0 && pkf.ucomp_size == 0 &&
+      pkf.comp_size != entry.comp_size && pkf.ucomp_size != entry.ucomp_size) {
+    pkf.comp_size = entry.comp_size;
+    pkf.ucomp_size = entry.ucomp_size;
+  }
+
+  lfile += sizeof(pk_lfile);
+
+  if (entry.local_header_offset + sizeof(pk_lfile) + pkf.fname_len +
+          pkf.extra_len + pkf.comp_size >=
+      m_size) {
+    std::cerr << "Complete entry exceeds mapping bounds.\n";
+    return nullptr;
+  }
+
+  if (pkf.fname_len != entry.name.size() ||
+      pkf.comp_size != entry.comp_size ||
+      pkf.ucomp_size != entry.ucomp_size ||
+      pkf.comp_method != entry.comp_method ||
+      entry.name != std::string_view((const char*)lfile, pkf.fname_len)) {
+    std::cerr << "Directory entry doesn't match local file header, Bailing "
+              << pkf.fname_len << " " << pkf.comp_size << " " << pkf.ucomp_size
+              << " " << pkf.comp_method << " " << entry.name.size() << " "
+              << entry.comp_size << " " << entry.ucomp_size << " "
+              << entry.comp_method << " extra " << pkf.extra_len << "\n";
+    return nullptr;
+  }
+
+  lfile += pkf.fname_len;
+  lfile += pkf.extra_len;
+  return lfile;
+}
+
+const uint8_t* ZipArchive::get_stored_data(const Entry& entry) const {
+  if (entry.comp_method != kCompMethodStore) {
+    return nullptr;
+  }
+  return get_data(entry);
+}
+
+bool ZipArchive::extract(const Entry& entry,
+                         uint8_t* out,
+                         size_t out_size) const {
+  auto data = get_data(entry);
+  if (data == nullptr) {
+    return false;
+  }
+  uLongf dlen = out_size;
+  int zlibrv =
+      uncompress_entry(out, &dlen, data, entry.comp_size, entry.comp_method);
+  if (zlibrv != Z_OK) {
+    std::cerr << "uncompress failed with code " << zlibrv << ", Bailing\n";
+    return false;
+  }
+  if (dlen != entry.ucomp_size) {
+    std::cerr << "mis-match on uncompressed size, Bailing\n";
+    return false;
+  }
+  return true;
+}
+
+void ZipArchiveWriter::add(std::string name, std::string contents, bool store) {
+  PendingEntry entry;
+  entry.name = std::move(name);
+  entry.comp_method = store ? kCompMethodStore : kCompMethodDeflate;
+  entry.ucomp_size = contents.size();
+  entry.contents = std::move(contents);
+  m_entries.push_back(std::move(entry));
+}
+
+bool ZipArchiveWriter::add(const ZipArchive& archive,
+                           const ZipArchive::Entry& entry) {
+  auto* data = archive.get_data(entry);
+  if (data == nullptr) {
+    return false;
+  }
+  PendingEntry pending;
+  pending.name = entry.name;
+  pending.comp_method = entry.comp_method;
+  pending.crc32 = entry.crc32;
+  pending.ucomp_size = entry.ucomp_size;
+  pending.data = data;
+  pending.data_size = entry.comp_size;
+  m_entries.push_back(std::move(pending));
+  return true;
+}
+
+bool ZipArchiveWriter::write(std::ostream& out) {
+  if (m_entries.size() > std::numeric_limits<uint16_t>::max()) {
+    std::cerr << "Too many entries without ZIP64 support\n";
+    return false;
+  }
+  std::atomic<bool> failed{false};
+  workqueue_run_for<size_t>(0, m_entries.size(), [&](size_t i) {
+    auto& entry = m_entries[i];
+    if (entry.data != nullptr) {
+      return;
+    }
+    entry.crc32 = crc32(0, (const Bytef*)entry.contents.data(),
+                        (uInt)entry.contents.size());
+    if (entry.comp_method == kCompMethodDeflate) {
+      std::string compressed;
+      if (!raw_deflate(entry.contents, m_options.compression_level,
+                       &compressed)) {
+        std::cerr << "Failed to compress " << entry.name << "\n";
+        failed = true;
+        return;
+      }
+      entry.contents = std::move(compressed);
+    }
+    entry.data = (const uint8_t*)entry.contents.data();
+    entry.data_size = entry.contents.size();
+  });
+  if (failed) {
+    return false;
+  }
+
+  std::string central_directory;
+  size_t offset = 0;
+  for (const auto& entry : m_entries) {
+    // Pad the extra field of STOREd entries, so that their data is aligned.
+    size_t header_size = sizeof(pk_lfile) + entry.name.size();
+    uint16_t padding = 0;
+    if (entry.comp_method == kCompMethodStore) {
+      size_t alignment = m_options.page_align_libs &&
+                                 is_shared_library(entry.name)
+                             ? kPageAlignment
+                             : kStoredAlignment;
+      padding = (alignment - (offset + header_size) % alignment) % alignment;
+    }
+
+    pk_lfile lfile;
+    memcpy(&lfile.signature, kLFile.data(), kLFile.size());
+    lfile.vextract = 20;
+    lfile.flags = 0;
+    lfile.comp_method = entry.comp_method;
+    lfile.mod_time = kDosTime;
+    lfile.mod_date = kDosDate;
+    lfile.crc32 = entry.crc32;
+    lfile.comp_size = entry.data_size;
+    lfile.ucomp_size = entry.ucomp_size;
+    lfile.fname_len = entry.name.size();
+    lfile.extra_len = padding;
+    write_struct(out, lfile);
+    out << entry.name;
+    for (uint16_t i = 0; i < padding; i++) {
+      out.put(0);
+    }
+    out.write((const char*)entry.data, entry.data_size);
+
+    pk_cd_file cd_file;
+    memcpy(&cd_file.signature, kCDFile.data(), kCDFile.size());
+    cd_file.vmade = 20;
+    cd_file.vextract = 20;
+    cd_file.flags = 0;
+    cd_file.comp_method = entry.comp_method;
+    cd_file.mod_time = kDosTime;
+    cd_file.mod_date = kDosDate;
+    cd_file.crc32 = entry.crc32;
+    cd_file.comp_size = entry.data_size;
+    cd_file.ucomp_size = entry.ucomp_size;
+    cd_file.fname_len = entry.name.size();
+    cd_file.extra_len = 0;
+    cd_file.comment_len = 0;
+    cd_file.diskno = 0;
+    cd_file.interal_attr = 0;
+    cd_file.external_attr = 0;
+    cd_file.disk_offset = offset;
+    central_directory.append((const char*)&cd_file, sizeof(cd_file));
+    central_directory += entry.name;
+
+    offset += header_size + padding + entry.data_size;
+  }
+  if (offset + central_directory.size() >
+      std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Archive too large without ZIP64 support\n";
+    return false;
+  }
+
+  pk_cdir_end pce;
+  memcpy(&pce.signature, kCDirEnd.data(), kCDirEnd.size());
+  pce.diskno = 0;
+  pce.cd_diskno = 0;
+  pce.cd_disk_entries = m_entries.size();
+  pce.cd_entries = m_entries.size();
+  pce.cd_size = central_directory.size();
+  pce.cd_disk_offset = offset;
+  pce.comment_len = 0;
+  out << central_directory;
+  write_struct(out, pce);
+  return out.good();
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Read-only view of a ZIP archive (jar, apk, ...) in memory, typically a
+ * memory-mapped file, which has to outlive the view. Entries are found via
+ * the central directory, so nothing is extracted that isn't asked for.
+ *
+ * Only the subset of the format that Java and Android tooling produce is
+ * supported: no disk spanning, no ZIP64, and only STOREd or DEFLATEd entries.
+ */
+class ZipArchive {
+ public:
+  struct Entry {
+    std::string name;
+    uint16_t comp_method;
+    uint32_t crc32;
+    uint32_t comp_size;
+    uint32_t ucomp_size;
+    uint32_t local_header_offset;
+  };
+
+  // Parses the central directory. Problems are reported on stderr, and leave
+  // the archive invalid.
+  ZipArchive(const uint8_t* data, size_t size);
+
+  bool is_valid() const { return m_valid; }
+
+  const std::vector<Entry>& entries() const { return m_entries; }
+
+  const Entry* find(std::string_view name) const;
+
+  // The contents of a STOREd entry, directly from the archive; nullptr if the
+  // entry is compressed or malformed.
+  const uint8_t* get_stored_data(const Entry& entry) const;
+
+  // Writes the uncompressed contents of the entry to `out`, which must have
+  // room for at least `entry.ucomp_size` bytes.
+  bool extract(const Entry& entry, uint8_t* out, size_t out_size) const;
+
+  // Validates the local file header of the entry, and returns the start of its
+  // (possibly compressed) data, which is `entry.comp_size` bytes long.
+  const uint8_t* get_data(const Entry& entry) const;
+
+ private:
+  const uint8_t* m_data;
+  size_t m_size;
+  bool m_valid{false};
+  std::vector<Entry> m_entries;
+};
+
+/*
+ * Writes a ZIP archive, aligning the data of STOREd entries like zipalign
+ * does, i.e. to 4 bytes, and optionally shared libraries to pages.
+ *
+ * Entries are only compressed when the archive is written, in parallel, and
+ * entries taken from other archives are copied as they are, directly from
+ * their (typically memory-mapped) data. Both their data and the archives have
+ * to outlive the writer. Modification times are not preserved, every entry is
+ * written with the same fixed timestamp.
+ */
+class ZipArchiveWriter {
+ public:
+  struct Options {
+    int compression_level{6};
+    bool page_align_libs{false};
+  };
+
+  ZipArchiveWriter() = default;
+  explicit ZipArchiveWriter(Options options) : m_options(options) {}
+
+  // Adds an entry with the given contents, which are DEFLATEd unless `store`.
+  void add(std::string name, std::string contents, bool store);
+
+  // Adds an entry of another archive without decompressing it. Returns false
+  // if the entry is malformed.
+  bool add(const ZipArchive& archive, const ZipArchive::Entry& entry);
+
+  // Compresses the pending entries, and writes the archive.
+  bool write(std::ostream& out);
+
+ private:
+  struct PendingEntry {
+    std::string name;
+    uint16_t comp_method;
+    uint32_t crc32{0};
+    uint32_t ucomp_size{0};
+    // Owned contents, which are replaced by their compressed form on write.
+    std::string contents;
+    // Or borrowed data in its final form.
+    const uint8_t* data{nullptr};
+    uint32_t data_size{0};
+  };
+
+  Options m_options;
+  std::vector<PendingEntry> m_entries;
+};
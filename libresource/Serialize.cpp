@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <vector>
@@ -97,11 +98,7 @@ void encode_string8(const char* string,
   auto u16_len = utf8_to_utf16_length((const uint8_t*)string, len);
   push_u8_length(u16_len, vec);
   push_u8_length(len, vec);
-  // Push each char
-  size_t i = 0;
-  for (auto c = (char*)string; i < len; c++, i++) {
-    vec->push_back(*c);
-  }
+  vec->appendArray(string, len);
   vec->push_back('\0');
 }
 
@@ -120,11 +117,15 @@ void encode_string16(const char16_t* s,
   } else {
     push_short((uint16_t)len, vec);
   }
-  size_t i = 0;
-  for (uint16_t* c = (uint16_t*)s; i < len; c++, i++) {
-    push_short(*c, vec);
+  // Grow once, zero filled so that the null terminator is already in place.
+  auto pos = vec->size();
+  vec->insertAt('\0', pos, (len + 1) * sizeof(uint16_t));
+  auto dest = vec->editArray() + pos;
+  for (size_t i = 0; i < len; i++) {
+    auto swapped = htods((uint16_t)s[i]);
+    *dest++ = swapped;
+    *dest++ = swapped >> 8;
   }
-  push_short('\0', vec);
 }
 
 // Does not swap byte order, just copy data as-is
@@ -683,7 +684,7 @@ void ResStringPoolBuilder::add_style(std::string s, SpanVector spans) {
 std::string ResStringPoolBuilder::get_string(size_t idx) {
   arsc::StringHolder holder = m_strings.at(idx);
   if (holder.is_char_ptr()) {
-    return std::string(std::get<const char*>(holder.data));
+    return std::string(std::get<const char*>(holder.data), holder.length);
   } else if (holder.is_char16_ptr()) {
     auto ptr = std::get<const char16_t*>(holder.data);
     android::String16 s16(ptr, holder.length);
@@ -696,6 +697,23 @@ std::string ResStringPoolBuilder::get_string(size_t idx) {
 }
 
 namespace {
+// Converts the given (M)UTF-8 data straight to UTF-16 and encodes it, without
+// the intermediate String8 and String16 copies. Invalid data is encoded as an
+// empty string, like String16 would.
+void encode_utf8_as_string16(const char* s,
+                             size_t len,
+                             android::Vector<char>* out) {
+  auto u8 = (const uint8_t*)s;
+  auto u16_len = len == 0 ? 0 : utf8_to_utf16_length(u8, len);
+  if (u16_len <= 0) {
+    encode_string16(u"", 0, out);
+    return;
+  }
+  std::vector<char16_t> u16(u16_len + 1);
+  utf8_to_utf16(u8, len, u16.data(), u16.size());
+  encode_string16(u16.data(), u16_len, out);
+}
+
 void write_string8(const StringHolder& holder, android::Vector<char>* out) {
   if (holder.is_char_ptr()) {
     encode_string8(std::get<const char*>(holder.data), holder.length, out);
@@ -705,25 +723,22 @@ void write_string8(const StringHolder& holder, android::Vector<char>* out) {
     encode_string8(s8.string(), len, out);
   } else {
     LOG_ALWAYS_FATAL_IF(!holder.is_str(), "unknown variant");
-    android::String8 s8(std::get<std::string>(holder.data).c_str());
-    size_t len = s8.length();
-    encode_string8(s8.string(), len, out);
+    // Encoded as-is up to the first null, like a String8 of it would be.
+    const auto& str = std::get<std::string>(holder.data);
+    encode_string8(str.c_str(), strlen(str.c_str()), out);
   }
 }
 
 void write_string16(const StringHolder& holder, android::Vector<char>* out) {
   if (holder.is_char_ptr()) {
-    android::String8 s8(std::get<const char*>(holder.data), holder.length);
-    android::String16 s16(s8);
-    size_t len = s16.size();
-    encode_string16(s16.string(), len, out);
+    encode_utf8_as_string16(std::get<const char*>(holder.data), holder.length,
+                            out);
   } else if (holder.is_char16_ptr()) {
     encode_string16(std::get<const char16_t*>(holder.data), holder.length, out);
   } else {
     LOG_ALWAYS_FATAL_IF(!holder.is_str(), "unknown variant");
-    android::String16 s16(std::get<std::string>(holder.data).c_str());
-    size_t len = s16.size();
-    encode_string16(s16.string(), len, out);
+    const auto& str = std::get<std::string>(holder.data);
+    encode_utf8_as_string16(str.c_str(), strlen(str.c_str()), out);
   }
 }
 
@@ -873,34 +888,16 @@ ResPackageBuilder::ResPackageBuilder(android::ResTable_package* package) {
 }
 
 void ResPackageBuilder::serialize(android::Vector<char>* out) {
-  android::Vector<char> temp;
-  // Type strings
-  write_string_pool(m_type_strings, &temp);
-  auto type_strings_size = temp.size();
-  write_string_pool(m_key_strings, &temp);
-  // Types
-  for (auto& entry : m_id_to_type) {
-    auto pair = entry.second;
-    if (pair.first != nullptr) {
-      pair.first->serialize(&temp);
-    } else {
-      auto type_info = pair.second;
-      push_chunk((android::ResChunk_header*)type_info.spec, &temp);
-      for (auto type : type_info.configs) {
-        push_chunk((android::ResChunk_header*)type, &temp);
-      }
-    }
-  }
-  // All other chunks
-  for (auto header : m_unknown_chunks) {
-    push_chunk(header, &temp);
-  }
+  // The header is emitted first with placeholders for the sizes and offsets,
+  // so that the (potentially large) type data is written straight to the
+  // output instead of being staged in, and then copied from, a temp vector.
+  auto initial_size = out->size();
   // ResTable_package's ResChunk_header
   auto header_size = sizeof(android::ResTable_package);
   push_short(android::RES_TABLE_PACKAGE_TYPE, out);
   push_short(header_size, out);
-  auto total_size = header_size + temp.size();
-  push_long(total_size, out);
+  auto total_size_pos = out->size();
+  push_long(FILL_IN_LATER, out);
   // ResTable_package's other members
   push_long(m_id, out);
   // Package name, this array is always a fixed size.
@@ -911,10 +908,32 @@ void ResPackageBuilder::serialize(android::Vector<char>* out) {
   push_long(header_size, out);
   push_long(m_last_public_type, out);
   // Offset to key strings, which are after the type strings
-  push_long(header_size + type_strings_size, out);
+  auto key_strings_pos = out->size();
+  push_long(FILL_IN_LATER, out);
   push_long(m_last_public_key, out);
   push_long(m_type_id_offset, out);
-  push_vec(temp, out);
+  // Type strings
+  write_string_pool(m_type_strings, out);
+  write_long_at_pos(key_strings_pos, out->size() - initial_size, out);
+  write_string_pool(m_key_strings, out);
+  // Types
+  for (auto& entry : m_id_to_type) {
+    auto& pair = entry.second;
+    if (pair.first != nullptr) {
+      pair.first->serialize(out);
+    } else {
+      const auto& type_info = pair.second;
+      push_chunk((android::ResChunk_header*)type_info.spec, out);
+      for (auto type : type_info.configs) {
+        push_chunk((android::ResChunk_header*)type, out);
+      }
+    }
+  }
+  // All other chunks
+  for (auto header : m_unknown_chunks) {
+    push_chunk(header, out);
+  }
+  write_long_at_pos(total_size_pos, out->size() - initial_size, out);
 }
 
 void ResTableBuilder::serialize(android::Vector<char>* out) {
@@ -49,7 +49,7 @@ void AnalyzePureMethodsPass::run_pass(DexStoresVector& stores,
 
 AnalyzePureMethodsPass::Stats
 AnalyzePureMethodsPass::analyze_and_set_pure_methods(Scope& scope) {
-  auto method_override_graph = method_override_graph::build_graph(scope);
+  auto method_override_graph = method_override_graph::build_graph_cached(scope);
   init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
       scope, /* create_init_class_insns */ false, method_override_graph.get());
 
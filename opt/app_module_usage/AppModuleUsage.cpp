@@ -108,6 +108,10 @@ void write_app_module_use_stats(
 }
 } // namespace
 
+void AppModuleUsagePass::set_analysis_usage(AnalysisUsage& au) const {
+  au.add_preserve_specific<reflection::SharedReflectionAnalyses>();
+}
+
 void AppModuleUsagePass::run_pass(DexStoresVector& stores,
                                   ConfigFiles& conf,
                                   PassManager& mgr) {
@@ -130,7 +134,12 @@ void AppModuleUsagePass::run_pass(DexStoresVector& stores,
 
   const auto& full_scope = build_class_scope(stores);
   // TODO: Remove classes from scope that are exempt from checking.
-  auto method_store_refs = analyze_method_xstore_references(full_scope);
+  auto reflection_analyses =
+      mgr.get_cached_analysis<reflection::SharedReflectionAnalyses>([]() {
+        return std::make_shared<reflection::SharedReflectionAnalyses>();
+      });
+  auto method_store_refs =
+      analyze_method_xstore_references(full_scope, *reflection_analyses);
   auto field_store_refs = analyze_field_xstore_references(full_scope);
 
   if (m_output_module_use) {
@@ -201,7 +210,9 @@ void AppModuleUsagePass::load_preexisting_violations(DexStoresVector& stores) {
 }
 
 app_module_usage::MethodStoresReferenced
-AppModuleUsagePass::analyze_method_xstore_references(const Scope& scope) {
+AppModuleUsagePass::analyze_method_xstore_references(
+    const Scope& scope,
+    const reflection::SharedReflectionAnalyses& reflection_analyses) {
 
   auto get_type_ref_for_insn = [](IRInstruction* insn) -> DexType* {
     if (insn->has_method()) {
@@ -219,12 +230,7 @@ AppModuleUsagePass::analyze_method_xstore_references(const Scope& scope) {
 
   walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
     const auto* method_store = m_type_store_map.at(method->get_class());
-    std::unique_ptr<reflection::ReflectionAnalysis> analysis =
-        std::make_unique<reflection::ReflectionAnalysis>(
-            /* dex_method */ method,
-            /* context (interprocedural only) */ nullptr,
-            /* summary_query_fn (interprocedural only) */ nullptr,
-            /* metadata_cache */ &refl_metadata_cache);
+    auto analysis = reflection_analyses.get(method, &refl_metadata_cache);
 
     auto get_reflective_type_ref_for_insn =
         [&analysis](IRInstruction* insn) -> DexType* {
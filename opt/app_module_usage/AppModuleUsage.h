@@ -69,6 +69,9 @@ number of places it's referenced.
     bind("crash_with_violations", false, m_crash_with_violations);
   }
 
+  // Only reports, so the shared reflection analyses stay valid.
+  void set_analysis_usage(AnalysisUsage& au) const override;
+
   // Entrypoint for the AppModuleUsagePass pass
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
@@ -81,7 +84,8 @@ number of places it's referenced.
   void load_preexisting_violations(DexStoresVector&);
 
   app_module_usage::MethodStoresReferenced analyze_method_xstore_references(
-      const Scope& scope);
+      const Scope& scope,
+      const reflection::SharedReflectionAnalyses& reflection_analyses);
 
   InsertOnlyConcurrentMap<DexField*, DexStore*> analyze_field_xstore_references(
       const Scope& scope);
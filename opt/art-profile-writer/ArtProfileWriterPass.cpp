@@ -16,6 +16,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 #include <fstream>
+#include <sstream>
 #include <string>
 
 #include "BaselineProfile.h"
@@ -30,6 +31,7 @@
 #include "Show.h"
 #include "SourceBlocks.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 const std::string BASELINE_PROFILES_FILE = "additional-baseline-profiles.list";
@@ -570,8 +572,12 @@ void ArtProfileWriterPass::run_pass(DexStoresVector& stores,
     baseline_profile.classes.insert(store_fence_helper_cls);
   }
 
-  std::ofstream ofs{conf.metafile(BASELINE_PROFILES_FILE)};
-  walk::classes(scope, [&](DexClass* cls) {
+  // Format the lines of each class in parallel, and write them out in scope
+  // order.
+  std::vector<std::string> class_lines(scope.size());
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    auto* cls = scope[i];
+    std::ostringstream oss;
     for (auto* method : cls->get_all_methods()) {
       auto it = baseline_profile.methods.find(method);
       if (it == baseline_profile.methods.end()) {
@@ -582,12 +588,17 @@ void ArtProfileWriterPass::run_pass(DexStoresVector& stores,
       // in post-process can recognize the method
       boost::replace_all(descriptor, ".", "->");
       boost::replace_all(descriptor, ":(", "(");
-      ofs << it->second << descriptor << std::endl;
+      oss << it->second << descriptor << '\n';
     }
     if (baseline_profile.classes.count(cls)) {
-      ofs << show_deobfuscated(cls) << std::endl;
+      oss << show_deobfuscated(cls) << '\n';
     }
+    class_lines[i] = oss.str();
   });
+  std::ofstream ofs{conf.metafile(BASELINE_PROFILES_FILE)};
+  for (auto& lines : class_lines) {
+    ofs << lines;
+  }
 
   std::atomic<size_t> methods_with_baseline_profile_code_units{0};
   std::atomic<size_t> compiled{0};
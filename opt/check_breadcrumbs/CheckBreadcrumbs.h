@@ -21,6 +21,8 @@ class CheckBreadcrumbsPass : public Pass {
  public:
   CheckBreadcrumbsPass() : Pass("CheckBreadcrumbsPass") {}
 
+  bool is_read_only() const override { return true; }
+
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
     using namespace redex_properties::interactions;
@@ -227,6 +227,8 @@ void ClassMergingPass::bind_config() {
       model_spec.get("merge_types_with_static_fields", false,
                      model.merge_types_with_static_fields);
       model_spec.get("keep_debug_info", false, model.keep_debug_info);
+      model_spec.get("peel_hot_dispatch_case", false,
+                     model.peel_hot_dispatch_case);
 
       // TypeLikeStringConfig defaults to `exclude`.
       std::string type_like_string_config;
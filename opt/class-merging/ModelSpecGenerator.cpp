@@ -67,12 +67,8 @@ TypeSet collect_reflected_mergeables(
   if (!code) {
     return non_mergeables;
   }
-  std::unique_ptr<reflection::ReflectionAnalysis> analysis =
-      std::make_unique<reflection::ReflectionAnalysis>(
-          /* dex_method */ method,
-          /* context (interprocedural only) */ nullptr,
-          /* summary_query_fn (interprocedural only) */ nullptr,
-          /* metadata_cache */ &refl_metadata_cache);
+  auto analysis =
+      reflection::get_shared_reflection_analysis(method, &refl_metadata_cache);
 
   if (!analysis->has_found_reflection()) {
     return non_mergeables;
@@ -30,6 +30,7 @@
 
 #include "ApiLevelChecker.h"
 #include "ClassSplitting.h"
+#include "ConcurrentContainers.h"
 #include "ControlFlow.h"
 #include "Creators.h"
 #include "IRCode.h"
@@ -67,27 +68,33 @@ void ClassSplittingPass::run_pass(DexStoresVector& stores,
   // InterDex pass run can reshuffle the split-off classes across dexes
   // properly, accounting for all the changes to refs from the beginning.
 
-  std::unordered_set<DexMethod*> sufficiently_popular_methods;
+  ConcurrentSet<DexMethod*> concurrent_sufficiently_popular_methods;
   // Methods that appear in the profiles and whose frequency does not exceed
   // the threashold.
-  std::unordered_set<DexMethod*> insufficiently_popular_methods;
+  ConcurrentSet<DexMethod*> concurrent_insufficiently_popular_methods;
 
   Scope scope = build_class_scope(stores);
-  for (auto& p : method_profiles.all_interactions()) {
-    auto& method_stats = p.second;
-    walk::methods(scope, [&](DexMethod* method) {
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    for (auto& p : method_profiles.all_interactions()) {
+      auto& method_stats = p.second;
       auto it = method_stats.find(method);
       if (it == method_stats.end()) {
-        return;
+        continue;
       }
       if (it->second.appear_percent >=
           m_config.method_profiles_appear_percent_threshold) {
-        sufficiently_popular_methods.insert(method);
+        concurrent_sufficiently_popular_methods.insert(method);
       } else {
-        insufficiently_popular_methods.insert(method);
+        concurrent_insufficiently_popular_methods.insert(method);
       }
-    });
-  }
+    }
+  });
+  std::unordered_set<DexMethod*> sufficiently_popular_methods(
+      concurrent_sufficiently_popular_methods.begin(),
+      concurrent_sufficiently_popular_methods.end());
+  std::unordered_set<DexMethod*> insufficiently_popular_methods(
+      concurrent_insufficiently_popular_methods.begin(),
+      concurrent_insufficiently_popular_methods.end());
 
   ClassSplitter class_splitter(m_config, mgr, sufficiently_popular_methods,
                                insufficiently_popular_methods);
@@ -151,9 +158,9 @@ void ClassSplittingPass::run_pass(DexStoresVector& stores,
         continue;
       }
       classes.push_back(cls);
-      class_splitter.prepare(cls, nullptr /* mrefs */, nullptr /* trefs */);
     }
   }
+  class_splitter.prepare(classes);
   auto classes_to_add = class_splitter.additional_classes(classes);
   dexen.push_back(classes_to_add);
   TRACE(CS, 1, "[class splitting] Added %zu classes", classes_to_add.size());
@@ -28,6 +28,17 @@ void ConstantPropagationPass::run_pass(DexStoresVector& stores,
   ScopedMetrics sm(mgr);
   stats.log_metrics(sm, /* with_scope= */ false);
 
+  const auto& methods_over_budget = impl.get_methods_over_budget();
+  sm.set_metric("methods_over_step_budget", methods_over_budget.size());
+  if (traceEnabled(CONSTP, 1)) {
+    std::vector<const DexMethod*> methods(methods_over_budget.begin(),
+                                          methods_over_budget.end());
+    std::sort(methods.begin(), methods.end(), compare_dexmethods);
+    for (auto* method : methods) {
+      TRACE(CONSTP, 1, "Over the fixpoint step budget: %s", SHOW(method));
+    }
+  }
+
   TRACE(CONSTP, 1, "num_branch_propagated: %zu", stats.branches_removed);
   TRACE(CONSTP,
         1,
@@ -30,6 +30,11 @@ class ConstantPropagationPass : public Pass {
          true,
          m_config.transform.replace_moves_with_consts);
     bind("remove_dead_switch", true, m_config.transform.remove_dead_switch);
+    bind("fixpoint_step_budget",
+         uint64_t(0),
+         m_config.fixpoint_step_budget,
+         "Maximum number of block analyses per method, or 0 for no limit. "
+         "Methods whose analysis exceeds it are left unchanged.");
   }
 
   void run_pass(DexStoresVector& stores,
@@ -326,6 +326,10 @@ void PassImpl::run_pass(DexStoresVector& stores,
                   m_stats.fp_iter.method_cache_hits);
   mgr.incr_metric("fp_iter.method_cache_misses",
                   m_stats.fp_iter.method_cache_misses);
+  mgr.incr_metric("fp_iter.collected_values_cache_hits",
+                  m_stats.fp_iter.collected_values_cache_hits);
+  mgr.incr_metric("fp_iter.collected_values_cache_misses",
+                  m_stats.fp_iter.collected_values_cache_misses);
 }
 
 static PassImpl s_pass;
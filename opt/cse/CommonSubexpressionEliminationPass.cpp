@@ -11,7 +11,9 @@
 #include "ConfigFiles.h"
 #include "CopyPropagation.h"
 #include "DexUtil.h"
+#include "InitClassesWithSideEffects.h"
 #include "LocalDce.h"
+#include "MethodOverrideGraph.h"
 #include "Purity.h"
 #include "Show.h"
 #include "Walkers.h"
@@ -48,12 +50,29 @@ void CommonSubexpressionEliminationPass::bind_config() {
   bind("runtime_assertions", false, m_runtime_assertions);
 }
 
+void CommonSubexpressionEliminationPass::set_analysis_usage(
+    AnalysisUsage& au) const {
+  au.add_preserve_specific<method_override_graph::Graph>();
+  // Eliminating redundant instructions never adds side effects to a static
+  // initializer, but runtime assertions do.
+  if (!m_runtime_assertions) {
+    au.add_preserve_specific<init_classes::InitClassesWithSideEffects>();
+  }
+}
+
 void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
                                                   ConfigFiles& conf,
                                                   PassManager& mgr) {
   const auto scope = build_class_scope(stores);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns());
+  auto init_classes_with_side_effects =
+      mgr.get_cached_analysis<init_classes::InitClassesWithSideEffects>([&]() {
+        auto method_override_graph =
+            mgr.get_cached_analysis<method_override_graph::Graph>([&]() {
+              return method_override_graph::build_graph_cached(scope);
+            });
+        return std::make_unique<init_classes::InitClassesWithSideEffects>(
+            scope, conf.create_init_class_insns(), method_override_graph.get());
+      });
 
   auto pure_methods = /* Android framework */ get_pure_methods();
   auto configured_pure_methods = conf.get_pure_methods();
@@ -67,7 +86,7 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
       pure_methods, conf.get_finalish_field_names(), finalish_fields);
   method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
       [&](const DexType* type) {
-        return !init_classes_with_side_effects.refine(type);
+        return !init_classes_with_side_effects->refine(type);
       };
   shared_state.init_scope(scope, clinit_has_no_side_effects);
 
@@ -109,7 +128,7 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
               copy_prop_config);
           copy_propagation.run(code, method);
 
-          auto local_dce = LocalDce(&init_classes_with_side_effects,
+          auto local_dce = LocalDce(init_classes_with_side_effects.get(),
                                     shared_state.get_pure_methods(),
                                     shared_state.get_method_override_graph(),
                                     /* may_allocate_registers */ true);
@@ -26,6 +26,10 @@ class CommonSubexpressionEliminationPass : public Pass {
     };
   }
 
+  // Only code is changed, so the method override graph and, without runtime
+  // assertions, the init classes with side effects are preserved.
+  void set_analysis_usage(AnalysisUsage& au) const override;
+
   void bind_config() override;
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
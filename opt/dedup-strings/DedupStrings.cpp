@@ -10,7 +10,6 @@
 #include <vector>
 
 #include "CFGMutation.h"
-#include "ConcurrentContainers.h"
 #include "Creators.h"
 #include "DexAccess.h"
 #include "DexClass.h"
@@ -119,9 +118,8 @@ void DedupStrings::run(DexStoresVector& stores) {
   });
 
   // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-      occurrences = get_occurrences(scope, methods_to_dex,
-                                    perf_sensitive_methods, non_load_strings);
+  StringOccurrences occurrences = get_occurrences(
+      scope, methods_to_dex, perf_sensitive_methods, non_load_strings);
 
   // Use heuristics to determine which strings to dedup,
   // and figure out factory method details
@@ -300,34 +298,67 @@ void DedupStrings::gather_non_load_strings(
   strings->insert(library_names.begin(), library_names.end());
 }
 
-ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-DedupStrings::get_occurrences(
+namespace {
+
+// The const-string loads of some methods, counted by each thread on its own
+// and then summed up once.
+struct StringLoads {
+  // For each dex, the number of loads of each string outside of
+  // perf-sensitive code.
+  std::vector<std::unordered_map<const DexString*, size_t>> occurrences;
+  // For each dex, the strings loaded in perf-sensitive code.
+  std::vector<std::unordered_set<const DexString*>> perf_sensitive_strings;
+  size_t perf_sensitive_insns{0};
+  size_t non_perf_sensitive_insns{0};
+
+  StringLoads() = default;
+  explicit StringLoads(size_t dexes)
+      : occurrences(dexes), perf_sensitive_strings(dexes) {}
+
+  StringLoads& operator+=(const StringLoads& other) {
+    always_assert(occurrences.size() == other.occurrences.size());
+    for (size_t dexnr = 0; dexnr < occurrences.size(); dexnr++) {
+      auto& loads = occurrences[dexnr];
+      for (const auto& [str, count] : other.occurrences[dexnr]) {
+        loads[str] += count;
+      }
+      perf_sensitive_strings[dexnr].insert(
+          other.perf_sensitive_strings[dexnr].begin(),
+          other.perf_sensitive_strings[dexnr].end());
+    }
+    perf_sensitive_insns += other.perf_sensitive_insns;
+    non_perf_sensitive_insns += other.non_perf_sensitive_insns;
+    return *this;
+  }
+};
+
+} // namespace
+
+DedupStrings::StringOccurrences DedupStrings::get_occurrences(
     const Scope& scope,
     const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
     const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
     std::vector<std::unordered_set<const DexString*>>& non_load_strings) {
   // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-      occurrences;
-  ConcurrentMap<const DexString*, std::unordered_set<size_t>>
-      perf_sensitive_strings;
-  std::atomic<size_t> perf_sensitive_insns{0};
-  std::atomic<size_t> non_perf_sensitive_insns{0};
-  walk::parallel::code(
-      scope, [this, &occurrences, &perf_sensitive_strings, &methods_to_dex,
-              &perf_sensitive_methods, &perf_sensitive_insns,
-              &non_perf_sensitive_insns](DexMethod* method, IRCode& code) {
+  auto loads = walk::parallel::methods<StringLoads>(
+      scope,
+      [this, &methods_to_dex, &perf_sensitive_methods](DexMethod* method,
+                                                       StringLoads* acc) {
+        auto* code = method->get_code();
+        if (code == nullptr) {
+          return;
+        }
         const auto dexnr = methods_to_dex.at(method);
         const auto perf_sensitive_method =
             perf_sensitive_methods.count(method) != 0;
-        always_assert(code.editable_cfg_built());
-        auto& cfg = code.cfg();
+        always_assert(code->editable_cfg_built());
+        auto& cfg = code->cfg();
         const auto check_for_hot_blocks =
             m_perf_mode == DedupStringsPerfMode::
                                EXCLUDE_HOT_BLOCKS_IN_HOT_METHODS_OR_CLASSES &&
             perf_sensitive_method && !treat_all_blocks_as_hot(dexnr, method);
-        size_t local_perf_sensitive_insns{0};
-        size_t local_non_perf_sensitive_insns{0};
+        auto& occurrences = acc->occurrences.at(dexnr);
+        auto& perf_sensitive_strings = acc->perf_sensitive_strings.at(dexnr);
         for (auto* block : cfg.blocks()) {
           for (auto& mie : InstructionIterable(block)) {
             const auto insn = mie.insn;
@@ -335,56 +366,50 @@ DedupStrings::get_occurrences(
               const auto str = insn->get_string();
               if (perf_sensitive_method &&
                   (!check_for_hot_blocks || is_hot(block))) {
-                perf_sensitive_strings.update(
-                    str,
-                    [dexnr](const DexString*,
-                            std::unordered_set<size_t>& s,
-                            bool /* exists */) { s.emplace(dexnr); });
-                local_perf_sensitive_insns++;
+                perf_sensitive_strings.emplace(str);
+                acc->perf_sensitive_insns++;
               } else {
-                occurrences.update(
-                    str,
-                    [dexnr](const DexString*,
-                            std::unordered_map<size_t, size_t>& m,
-                            bool /* exists */) { ++m[dexnr]; });
-                local_non_perf_sensitive_insns++;
+                ++occurrences[str];
+                acc->non_perf_sensitive_insns++;
               }
             }
           }
         }
-        if (local_perf_sensitive_insns) {
-          perf_sensitive_insns += local_perf_sensitive_insns;
-        }
-        if (local_non_perf_sensitive_insns) {
-          non_perf_sensitive_insns += local_non_perf_sensitive_insns;
-        }
-      });
+      },
+      redex_parallel::default_num_threads(),
+      StringLoads(non_load_strings.size()));
+
+  StringOccurrences occurrences;
+  for (size_t dexnr = 0; dexnr < loads.occurrences.size(); dexnr++) {
+    for (const auto& [str, count] : loads.occurrences[dexnr]) {
+      occurrences[str].emplace(dexnr, count);
+    }
+  }
 
   // Also, add all the strings that occurred in perf-sensitive methods
   // to the non_load_strings datastructure, as we won't attempt to dedup them.
-  for (const auto& it : perf_sensitive_strings) {
-    const auto str = it.first;
-    TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
-
-    const auto& dexes = it.second;
-    for (const auto dexnr : dexes) {
-      auto& strings = non_load_strings[dexnr];
-      strings.emplace(str);
+  std::unordered_set<const DexString*> perf_sensitive_strings;
+  for (size_t dexnr = 0; dexnr < loads.perf_sensitive_strings.size();
+       dexnr++) {
+    for (const auto str : loads.perf_sensitive_strings[dexnr]) {
+      if (perf_sensitive_strings.insert(str).second) {
+        TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
+      }
+      non_load_strings[dexnr].emplace(str);
     }
   }
 
   m_stats.perf_sensitive_strings = perf_sensitive_strings.size();
   m_stats.non_perf_sensitive_strings = occurrences.size();
-  m_stats.perf_sensitive_insns = (size_t)perf_sensitive_insns;
-  m_stats.non_perf_sensitive_insns = (size_t)non_perf_sensitive_insns;
+  m_stats.perf_sensitive_insns = loads.perf_sensitive_insns;
+  m_stats.non_perf_sensitive_insns = loads.non_perf_sensitive_insns;
   return occurrences;
 }
 
 std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>
 DedupStrings::get_strings_to_dedup(
     DexClassesVector& dexen,
-    const ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>&
-        occurrences,
+    const StringOccurrences& occurrences,
     std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
     std::unordered_set<const DexMethod*>& perf_sensitive_methods,
     const std::vector<std::unordered_set<const DexString*>>& non_load_strings) {
@@ -410,7 +435,7 @@ DedupStrings::get_strings_to_dedup(
   std::sort(ordered_strings.begin(), ordered_strings.end(), compare_dexstrings);
   for (auto* s : ordered_strings) {
     // We are going to look at the situation of a particular string here
-    const auto& m = occurrences.at_unsafe(s);
+    const auto& m = occurrences.at(s);
     always_assert(m.size() > 1);
     const auto entry_size = s->get_entry_size();
     const auto get_size_reduction = [entry_size, &non_load_strings](
@@ -68,6 +68,10 @@ class DedupStrings {
     DexMethod* const_string_method{nullptr};
   };
 
+  // For each string, the number of loads per dex.
+  using StringOccurrences =
+      std::unordered_map<const DexString*, std::unordered_map<size_t, size_t>>;
+
   std::unordered_map<const DexMethod*, size_t> get_methods_to_dex(
       const DexClassesVector& dexen);
   std::unordered_set<const DexMethod*> get_perf_sensitive_methods(
@@ -78,16 +82,14 @@ class DedupStrings {
       const std::vector<const DexString*>& strings);
   void gather_non_load_strings(DexClasses& classes,
                                std::unordered_set<const DexString*>* strings);
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-  get_occurrences(
+  StringOccurrences get_occurrences(
       const Scope& scope,
       const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
       const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
       std::vector<std::unordered_set<const DexString*>>& non_load_strings);
   std::unordered_map<const DexString*, DedupStringInfo> get_strings_to_dedup(
       DexClassesVector& dexen,
-      const ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>&
-          occurrences,
+      const StringOccurrences& occurrences,
       std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
       std::unordered_set<const DexMethod*>& perf_sensitive_methods,
       const std::vector<std::unordered_set<const DexString*>>&
@@ -7,10 +7,11 @@
 
 #include "DedupResources.h"
 
+#include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
-#include <fstream>
+#include <cstring>
 #include <map>
 #include <unordered_set>
 
@@ -33,8 +34,6 @@
 
 namespace {
 
-constexpr decltype(redex_parallel::default_num_threads()) kReadFileThreads = 4u;
-
 template <typename ItemType>
 void print_duplicates(
     const std::vector<std::vector<ItemType>>& duplicates,
@@ -271,37 +270,38 @@ void compute_res_file_hashes(
       }
     }
   }
-  std::mutex out_mutex;
-  workqueue_run<std::string>(
-      [&](sparta::WorkerState<std::string>* /* unused */, std::string path) {
-        HashType hash = 31;
-        redex::read_file_with_contents(path,
-                                       [&](const char* data, size_t size) {
-                                         hash = hash_fn(data, size, hash);
-                                       });
-        {
-          std::unique_lock<std::mutex> lock(out_mutex);
-          (*hash_to_absolute_paths)[hash].push_back(std::move(path));
-        }
-      },
-      tasks,
-      std::min(redex_parallel::default_num_threads(), kReadFileThreads));
+  // Files are read concurrently with all threads, as their contents are mapped
+  // when large. Hashes are stored by task index, so no lock is needed.
+  std::vector<HashType> hashes(tasks.size());
+  workqueue_run_for<size_t>(0, tasks.size(), [&](size_t i) {
+    HashType hash = 31;
+    redex::read_file_with_contents(tasks[i],
+                                   [&](const char* data, size_t size) {
+                                     hash = hash_fn(data, size, hash);
+                                   });
+    hashes[i] = hash;
+  });
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    (*hash_to_absolute_paths)[hashes[i]].push_back(std::move(tasks[i]));
+  }
 }
 
 bool compare_files(const std::string& p1, const std::string& p2) {
-  std::ifstream f1(p1, std::ifstream::binary | std::ifstream::ate);
-  std::ifstream f2(p2, std::ifstream::binary | std::ifstream::ate);
-  always_assert_log(!f1.fail(), "Failed to read path %s", p1.c_str());
-  always_assert_log(!f2.fail(), "Failed to read path %s", p2.c_str());
-  if (f1.tellg() != f2.tellg()) {
+  boost::system::error_code ec1, ec2;
+  auto size1 = boost::filesystem::file_size(p1, ec1);
+  auto size2 = boost::filesystem::file_size(p2, ec2);
+  always_assert_log(!ec1, "Failed to read path %s", p1.c_str());
+  always_assert_log(!ec2, "Failed to read path %s", p2.c_str());
+  if (size1 != size2) {
     return false; // size mismatch
   }
-  // seek back to beginning and use std::equal to compare contents
-  f1.seekg(0, std::ifstream::beg);
-  f2.seekg(0, std::ifstream::beg);
-  return std::equal(std::istreambuf_iterator<char>(f1.rdbuf()),
-                    std::istreambuf_iterator<char>(),
-                    std::istreambuf_iterator<char>(f2.rdbuf()));
+  bool equal = false;
+  redex::read_file_with_contents(p1, [&](const char* data1, size_t len1) {
+    redex::read_file_with_contents(p2, [&](const char* data2, size_t len2) {
+      equal = len1 == len2 && (len1 == 0 || memcmp(data1, data2, len1) == 0);
+    });
+  });
+  return equal;
 }
 
 void deduplicate_resource_files(PassManager& mgr, const std::string& zip_dir) {
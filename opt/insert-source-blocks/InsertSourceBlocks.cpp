@@ -253,8 +253,13 @@ struct ProfileFile {
 
   using StringPos = std::pair<size_t, size_t>;
 
-  using MethodMeta = std::unordered_map<const DexMethodRef*, StringPos>;
-  MethodMeta method_meta;
+  // Ids of the methods that profiles are looked up for.
+  using MethodIds = std::unordered_map<const DexMethodRef*, uint32_t>;
+
+  // The profiles of methods with an id, in file order. Moved into the
+  // ProfileIndex once all files are read.
+  using MethodEntries = std::vector<std::pair<uint32_t, StringPos>>;
+  MethodEntries method_entries;
 
   using UnresolvedMethods = std::unordered_set<std::string_view>;
 
@@ -268,22 +273,22 @@ struct ProfileFile {
 
   ProfileFile(RedexMappedFile mapped_file,
               std::string interaction,
-              MethodMeta method_meta,
+              MethodEntries method_entries,
               UnresolvedMethods unresolved_methods,
               AccessMethods access_methods)
       : mapped_file(std::move(mapped_file)),
         interaction(std::move(interaction)),
-        method_meta(std::move(method_meta)),
+        method_entries(std::move(method_entries)),
         unresolved_methods(std::move(unresolved_methods)),
         access_methods(std::move(access_methods)) {}
 
   static std::unique_ptr<ProfileFile> prepare_profile_file(
-      const std::string& profile_file_name) {
+      const std::string& profile_file_name, const MethodIds& method_ids) {
     if (profile_file_name.empty()) {
       return std::unique_ptr<ProfileFile>();
     }
     auto file = RedexMappedFile::open(profile_file_name, /*read_only=*/true);
-    MethodMeta meta;
+    MethodEntries entries;
     UnresolvedMethods unresolved_methods;
     AccessMethods access_methods;
 
@@ -333,8 +338,8 @@ struct ProfileFile {
       }
       pos = linefeed_pos + 1;
       // Do not use pos anymore! Ensure by scope from lambda.
-      [&data, &src_pos, &linefeed_pos, &meta, &unresolved_methods,
-       &access_methods]() {
+      [&data, &src_pos, &linefeed_pos, &method_ids, &entries,
+       &unresolved_methods, &access_methods]() {
         size_t comma_pos = data.find(',', src_pos);
         always_assert(comma_pos < linefeed_pos);
 
@@ -369,24 +374,70 @@ struct ProfileFile {
         }
         TRACE(METH_PROF, 7, "Found normal method %s.",
               std::string(method_view).c_str());
-        meta.emplace(mref, string_pos);
+        auto it = method_ids.find(mref);
+        if (it != method_ids.end()) {
+          entries.emplace_back(it->second, string_pos);
+        }
       }();
     }
 
     return std::make_unique<ProfileFile>(
-        std::move(file), std::move(interaction), std::move(meta),
+        std::move(file), std::move(interaction), std::move(entries),
         std::move(unresolved_methods), std::move(access_methods));
   }
 };
 
+// The block profiles of all methods with code, indexed by method id. The
+// profiles of method i are entries[offsets[i]] up to entries[offsets[i + 1]],
+// ordered by profile file.
+struct ProfileIndex {
+  struct Entry {
+    uint32_t file;
+    ProfileFile::StringPos pos;
+  };
+  std::vector<size_t> offsets;
+  std::vector<Entry> entries;
+
+  ProfileIndex(size_t num_methods,
+               const std::vector<std::unique_ptr<ProfileFile>>& profile_files)
+      : offsets(num_methods + 1, 0) {
+    for (const auto& profile_file : profile_files) {
+      for (const auto& [id, _] : profile_file->method_entries) {
+        offsets[id + 1]++;
+      }
+    }
+    for (size_t i = 0; i != num_methods; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    entries.resize(offsets.back());
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (uint32_t f = 0; f != profile_files.size(); ++f) {
+      auto& method_entries = profile_files[f]->method_entries;
+      for (const auto& [id, pos] : method_entries) {
+        entries[next[id]++] = Entry{f, pos};
+      }
+      ProfileFile::MethodEntries().swap(method_entries);
+    }
+  }
+
+  ProfileIndex() : offsets(1, 0) {}
+};
+
 struct Injector {
   ConfigFiles& conf;
+  ProfileFile::MethodIds method_ids;
   std::vector<std::unique_ptr<ProfileFile>> profile_files;
+  ProfileIndex profile_index;
   std::vector<std::string> interactions;
+  // The method profile stats of each interaction, if any.
+  std::vector<const method_profiles::StatsMap*> interaction_stats;
   bool use_default_value;
   bool always_inject;
 
-  Injector(ConfigFiles& conf, bool always_inject, bool use_default_value)
+  Injector(ConfigFiles& conf,
+           const Scope& scope,
+           bool always_inject,
+           bool use_default_value)
       : conf(conf),
         use_default_value(use_default_value),
         always_inject(always_inject) {
@@ -394,24 +445,21 @@ struct Injector {
     // are missing and it's easier to do it here than have to synchronize
     // loading later. (It's probably also amortized with later passes.)
     conf.get_method_profiles();
+
+    walk::code(scope, [&](DexMethod* method, IRCode&) {
+      method_ids.emplace(method, method_ids.size());
+    });
   }
 
   boost::optional<SourceBlock::Val> maybe_val_from_mp(
-      const std::string& interaction, const DexMethodRef* mref) {
-    auto& method_profiles = conf.get_method_profiles();
-    if (!method_profiles.has_stats()) {
+      size_t interaction_idx, const DexMethodRef* mref) {
+    const auto* inter_map = interaction_stats.at(interaction_idx);
+    if (inter_map == nullptr) {
       return boost::none;
     }
 
-    const auto& mp_map = method_profiles.all_interactions();
-    const auto& inter_it = mp_map.find(interaction);
-    if (inter_it == mp_map.end()) {
-      return boost::none;
-    }
-
-    const auto& inter_map = inter_it->second;
-    auto it = inter_map.find(mref);
-    if (it == inter_map.end()) {
+    auto it = inter_map->find(mref);
+    if (it == inter_map->end()) {
       return boost::none;
     }
 
@@ -432,8 +480,8 @@ struct Injector {
       // Some effort to recover from method profiles in general.
       redex_assert(method_profiles.has_stats() || interactions.empty());
 
-      for (const auto& inter : interactions) {
-        auto val_opt = maybe_val_from_mp(inter, mref);
+      for (size_t i = 0; i != interactions.size(); ++i) {
+        auto val_opt = maybe_val_from_mp(i, mref);
         profiles.emplace_back(val_opt ? *val_opt : SourceBlock::Val(0, 0));
       }
     }
@@ -461,9 +509,22 @@ struct Injector {
     std::vector<source_blocks::ProfileData> profiles;
     profiles.reserve(profile_files.size());
 
+    auto method_id = method_ids.at(mref);
+    auto entry_it = profile_index.entries.begin() +
+                    profile_index.offsets.at(method_id);
+    auto entry_end = profile_index.entries.begin() +
+                     profile_index.offsets.at(method_id + 1);
+
     bool found_one = false;
-    for (auto& profile_file : profile_files) {
-      auto val_opt = maybe_val_from_mp(profile_file->interaction, mref);
+    for (uint32_t f = 0; f != profile_files.size(); ++f) {
+      auto& profile_file = profile_files[f];
+      auto val_opt = maybe_val_from_mp(f, mref);
+
+      std::optional<ProfileFile::StringPos> method_strpos;
+      if (entry_it != entry_end && entry_it->file == f) {
+        method_strpos = entry_it->pos;
+        ++entry_it;
+      }
 
       auto maybe_strpos = [&]() -> std::optional<ProfileFile::StringPos> {
         if (access_method_type_or_null != nullptr) {
@@ -503,12 +564,7 @@ struct Injector {
           }
         }
 
-        auto it = profile_file->method_meta.find(mref);
-        if (it != profile_file->method_meta.end()) {
-          return it->second;
-        }
-
-        return std::nullopt;
+        return method_strpos;
       }();
 
       if (!maybe_strpos) {
@@ -552,12 +608,10 @@ struct Injector {
     return std::make_pair(std::move(profiles), found_one);
   }
 
-  void run_source_blocks(DexStoresVector& stores,
+  void run_source_blocks(const Scope& scope,
                          PassManager& mgr,
                          bool serialize,
                          bool exc_inject) {
-    auto scope = build_class_scope(stores);
-
     // operator+= does not work well, too much copying around.
     struct SerializedMethodInfo {
       const DexString* method;
@@ -818,7 +872,8 @@ struct Injector {
 
       profile_files.resize(files.size());
       workqueue_run_for<size_t>(0, files.size(), [&](size_t i) {
-        profile_files.at(i) = ProfileFile::prepare_profile_file(files.at(i));
+        profile_files.at(i) =
+            ProfileFile::prepare_profile_file(files.at(i), method_ids);
         TRACE(METH_PROF, 1, "Loaded basic block profile %s",
               profile_files.at(i)->interaction.c_str());
       });
@@ -832,6 +887,8 @@ struct Injector {
       std::transform(profile_files.begin(), profile_files.end(),
                      std::back_inserter(interactions),
                      [](const auto& p) { return p->interaction; });
+
+      profile_index = ProfileIndex(method_ids.size(), profile_files);
     } else if (always_inject) {
       // Need to recover interaction names from method profiles.
       if (conf.get_method_profiles().has_stats()) {
@@ -844,6 +901,21 @@ struct Injector {
             interaction_less);
       }
     }
+
+    // Resolve the method profiles of the interactions once, instead of for
+    // every method.
+    const auto& method_profiles = conf.get_method_profiles();
+    for (const auto& interaction : interactions) {
+      const method_profiles::StatsMap* stats = nullptr;
+      if (method_profiles.has_stats()) {
+        const auto& mp_map = method_profiles.all_interactions();
+        auto it = mp_map.find(interaction);
+        if (it != mp_map.end()) {
+          stats = &it->second;
+        }
+      }
+      interaction_stats.push_back(stats);
+    }
   }
 
   void write_unresolved_methods(const std::string& fname) const {
@@ -888,14 +960,15 @@ void InsertSourceBlocksPass::run_pass(DexStoresVector& stores,
   bool is_instr_mode = mgr.get_redex_options().instrument_pass_enabled;
   bool always_inject = m_always_inject || m_force_serialize || is_instr_mode;
 
-  Injector inj(conf, always_inject, m_use_default_value);
+  auto scope = build_class_scope(stores);
+  Injector inj(conf, scope, always_inject, m_use_default_value);
 
   inj.prepare_profile_files_and_interactions(m_profile_files,
                                              m_ordered_interactions);
   inj.write_unresolved_methods(
       conf.metafile("redex-isb-unresolved-methods.txt"));
 
-  inj.run_source_blocks(stores,
+  inj.run_source_blocks(scope,
                         mgr,
                         /* serialize= */ m_force_serialize || is_instr_mode,
                         m_insert_after_excs);
@@ -21,6 +21,7 @@
 #include "TypeSystem.h"
 #include "TypeUtil.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 #include <boost/algorithm/string/join.hpp>
 #include <fstream>
@@ -235,6 +236,7 @@ struct MethodInfo {
   size_t num_instrumented_blocks = 0;
   size_t num_merged{0};
   size_t num_merged_not_instrumented{0};
+  size_t num_combined_coverage_updates{0};
 
   std::vector<cfg::BlockId> bit_id_2_block_id;
   std::vector<cfg::BlockId> hit_id_2_block_id;
@@ -259,6 +261,7 @@ struct MethodInfo {
     num_instrumented_blocks += rhs.num_instrumented_blocks;
     num_merged += rhs.num_merged;
     num_merged_not_instrumented += rhs.num_merged_not_instrumented;
+    num_combined_coverage_updates += rhs.num_combined_coverage_updates;
     num_too_many_blocks += rhs.num_too_many_blocks;
 
     return *this;
@@ -1078,10 +1081,17 @@ void create_block_info(
                                 BlockType::Instrumentable | type, insert_pos});
 }
 
-auto get_blocks_to_instrument(const DexMethod* m,
-                              const cfg::ControlFlowGraph& cfg,
-                              const size_t max_num_blocks,
-                              const InstrumentPass::Options& options) {
+// The sorted blocks to instrument with their information, the number of
+// blocks to instrument, the number of hit blocks, and whether there were too
+// many blocks.
+using BlocksToInstrument = std::tuple<std::vector<BlockInfo>, BitId, size_t,
+                                      bool /* too many blocks */>;
+
+BlocksToInstrument get_blocks_to_instrument(
+    const DexMethod* m,
+    const cfg::ControlFlowGraph& cfg,
+    const size_t max_num_blocks,
+    const InstrumentPass::Options& options) {
   // Collect basic blocks in the order of the source blocks (DFS).
   std::vector<cfg::Block*> blocks;
 
@@ -1140,9 +1150,103 @@ auto get_blocks_to_instrument(const DexMethod* m,
   return std::make_tuple(block_info_list, id, hit_id, false);
 }
 
-void insert_block_coverage_computations(const std::vector<BlockInfo>& blocks,
-                                        const std::vector<reg_t>& reg_vectors) {
-  for (const auto& info : blocks) {
+size_t get_num_vectors(size_t num_to_instrument) {
+  return std::ceil(num_to_instrument / double(BIT_VECTOR_SIZE));
+}
+
+// A block that cannot throw, and that is the only way into each of its
+// successors, runs exactly when one of its successors runs. If all those
+// successors are instrumented, with bits in the same vector, they can set the
+// bit of the block along with their own, and the block needs no update. This
+// may repeat along chains of such blocks. (Abnormal exits that skip a
+// successor also skip onMethodExit, so no coverage of the method is lost.)
+//
+// Returns, for each block, the bits its update sets, which is zero for blocks
+// whose update got combined into their successors.
+std::vector<uint16_t> combine_block_coverage_masks(
+    const std::vector<BlockInfo>& blocks) {
+  std::unordered_map<const cfg::Block*, size_t> block_indices;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (blocks[i].is_instrumentable()) {
+      block_indices.emplace(blocks[i].block, i);
+    }
+  }
+  auto instrumented_index =
+      [&](const cfg::Block* b) -> std::optional<size_t> {
+    auto it = block_indices.find(b);
+    if (it == block_indices.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  };
+  auto vector_of = [&](size_t i) { return blocks[i].bit_id / BIT_VECTOR_SIZE; };
+  auto unique_pred = [](const cfg::Block* b) -> const cfg::Block* {
+    const auto& preds = b->preds();
+    if (preds.empty()) {
+      return nullptr;
+    }
+    for (const auto* e : preds) {
+      if (e->src() != preds.front()->src()) {
+        return nullptr;
+      }
+    }
+    return preds.front()->src();
+  };
+
+  std::vector<bool> combined(blocks.size(), false);
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const auto& info = blocks[i];
+    if (!info.is_instrumentable() || info.block->succs().empty()) {
+      continue;
+    }
+    combined[i] = std::all_of(
+        info.block->succs().begin(), info.block->succs().end(),
+        [&](const cfg::Edge* e) {
+          if (e->type() != cfg::EDGE_GOTO && e->type() != cfg::EDGE_BRANCH) {
+            return false;
+          }
+          auto succ = instrumented_index(e->target());
+          return succ && e->target() != info.block &&
+                 unique_pred(e->target()) == info.block &&
+                 vector_of(*succ) == vector_of(i);
+        });
+  }
+
+  std::vector<uint16_t> masks(blocks.size(), 0);
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (!blocks[i].is_instrumentable() || combined[i]) {
+      continue;
+    }
+    uint16_t mask = 1u << (blocks[i].bit_id % BIT_VECTOR_SIZE);
+    // Collect the bits of the chain of combined blocks leading here. Every
+    // block in it is the unique predecessor of the next one.
+    std::unordered_set<const cfg::Block*> visited{blocks[i].block};
+    for (auto* pred = unique_pred(blocks[i].block); pred != nullptr;
+         pred = unique_pred(pred)) {
+      auto pred_index = instrumented_index(pred);
+      if (!pred_index || !combined[*pred_index] ||
+          !visited.insert(pred).second) {
+        break;
+      }
+      mask |= 1u << (blocks[*pred_index].bit_id % BIT_VECTOR_SIZE);
+    }
+    masks[i] = mask;
+  }
+  return masks;
+}
+
+// Returns the number of blocks whose update got combined into others.
+size_t insert_block_coverage_computations(
+    const std::vector<BlockInfo>& blocks,
+    const std::vector<reg_t>& reg_vectors,
+    bool combine_bits) {
+  std::vector<uint16_t> masks;
+  if (combine_bits) {
+    masks = combine_block_coverage_masks(blocks);
+  }
+  size_t num_combined = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const auto& info = blocks[i];
     if (!info.is_instrumentable()) {
       continue;
     }
@@ -1151,14 +1255,20 @@ void insert_block_coverage_computations(const std::vector<BlockInfo>& blocks,
     const size_t vector_id = bit_id / BIT_VECTOR_SIZE;
     cfg::Block* block = info.block;
     const auto& insert_pos = info.it;
+    uint16_t mask = combine_bits ? masks[i] : 1u << (bit_id % BIT_VECTOR_SIZE);
+    if (mask == 0) {
+      num_combined++;
+      continue;
+    }
 
-    // bit_vectors[vector_id] |= 1 << bit_id'
+    // bit_vectors[vector_id] |= mask, where the mask includes 1 << bit_id'
     IRInstruction* inst = new IRInstruction(OPCODE_OR_INT_LIT);
-    inst->set_literal(static_cast<int16_t>(1ULL << (bit_id % BIT_VECTOR_SIZE)));
+    inst->set_literal(static_cast<int16_t>(mask));
     inst->set_src(0, reg_vectors.at(vector_id));
     inst->set_dest(reg_vectors.at(vector_id));
     block->insert_before(block->to_cfg_instruction_iterator(*insert_pos), inst);
   }
+  return num_combined;
 }
 
 std::vector<IRInstruction*> insert_hit_count_insts(
@@ -1221,7 +1331,7 @@ MethodInfo instrument_basic_blocks(
     const size_t max_vector_arity_hit,
     const size_t method_offset,
     const size_t hit_offset,
-    const size_t max_num_blocks,
+    BlocksToInstrument blocks_to_instrument,
     MultiMethodInliner& inliner,
     const InstrumentPass::Options& options) {
   MethodInfo info;
@@ -1235,7 +1345,8 @@ MethodInfo instrument_basic_blocks(
   std::string before_cfg =
       traceEnabled(INSTRUMENT, 7) ? show(cfg) : std::string("");
 
-  // Step 1: Get sorted basic blocks to instrument with their information.
+  // Step 1: Take the sorted basic blocks to instrument with their information,
+  // as computed up front by get_blocks_to_instrument.
   //
   // The blocks are sorted in RPO. We don't instrument entry blocks. If too many
   // blocks, it falls back to empty blocks, which is method tracing.
@@ -1245,8 +1356,7 @@ MethodInfo instrument_basic_blocks(
   size_t num_instrument_loop_blocks = 0;
   bool too_many_blocks;
   std::tie(blocks, num_to_instrument, num_instrument_hit_blocks,
-           too_many_blocks) =
-      get_blocks_to_instrument(method, cfg, max_num_blocks, options);
+           too_many_blocks) = std::move(blocks_to_instrument);
 
   TRACE(INSTRUMENT, DEBUG_CFG ? 0 : 10, "BEFORE: %s, %s\n%s",
         show_deobfuscated(method).c_str(), SHOW(method), SHOW(cfg));
@@ -1291,8 +1401,7 @@ MethodInfo instrument_basic_blocks(
   //         allocation code in its method entry point.
   //
   const size_t origin_num_non_entry_blocks = cfg.num_blocks() - 1;
-  const size_t num_vectors =
-      std::ceil(num_to_instrument / double(BIT_VECTOR_SIZE));
+  const size_t num_vectors = get_num_vectors(num_to_instrument);
 
   std::vector<reg_t> reg_vectors;
   std::vector<short> loop_shorts(num_vectors);
@@ -1305,7 +1414,12 @@ MethodInfo instrument_basic_blocks(
 
   // Step 4: Insert block coverage update instructions to each blocks.
   //
-  insert_block_coverage_computations(blocks, reg_vectors);
+  // Hit counting relies on the per-block bits, so blocks are only combined
+  // for plain block tracing.
+  info.num_combined_coverage_updates = insert_block_coverage_computations(
+      blocks, reg_vectors,
+      options.combine_block_coverage_bits &&
+          options.instrumentation_strategy != "basic_block_hit_count");
 
   TRACE(INSTRUMENT, DEBUG_CFG ? 0 : 10, "WITH COVERAGE INSNS: %s, %s\n%s",
         show_deobfuscated(method).c_str(), SHOW(method), SHOW(cfg));
@@ -1650,6 +1764,10 @@ void print_stats(ScopedMetrics& sm,
           print_ratio(total.num_merged_not_instrumented).c_str());
     sm.set_metric("merged_not_instrumentable",
                   total.num_merged_not_instrumented);
+    TRACE(INSTRUMENT, 4, "- Coverage updates combined into successors: %s",
+          print_ratio(total.num_combined_coverage_updates).c_str());
+    sm.set_metric("combined_coverage_updates",
+                  total.num_combined_coverage_updates);
     TRACE(INSTRUMENT, 4, "- Skipped catch blocks: %s",
           SHOW(print_ratio(total_catches - total_instrumented_catches)));
     {
@@ -1898,6 +2016,7 @@ void BlockInstrumentHelper::do_basic_block_tracing(
   size_t method_offset = 8;
   size_t hit_offset = 8;
   std::vector<MethodInfo> instrumented_methods;
+  std::vector<DexMethod*> selected_methods;
 
   int all_methods = 0;
   int eligibles = 0;
@@ -2002,24 +2121,51 @@ void BlockInstrumentHelper::do_basic_block_tracing(
       return;
     }
 
-    instrumented_methods.emplace_back(instrument_basic_blocks(
-        code, method, onMethodBegin, onMethodExit_map,
+    selected_methods.push_back(method);
+  });
+
+  // Find the blocks to instrument of all selected methods, which determines
+  // how many slots they need in the stats arrays.
+  std::vector<BlocksToInstrument> blocks_to_instrument(
+      selected_methods.size());
+  workqueue_run_for<size_t>(0, selected_methods.size(), [&](size_t i) {
+    auto* method = selected_methods[i];
+    TraceContext trace_context(method);
+    blocks_to_instrument[i] = get_blocks_to_instrument(
+        method, method->get_code()->cfg(), max_num_blocks, options);
+  });
+
+  // Assign the offsets in scope order, so that they do not depend on the
+  // order in which methods get instrumented.
+  std::vector<std::pair<size_t, size_t>> offsets;
+  offsets.reserve(selected_methods.size());
+  for (const auto& b : blocks_to_instrument) {
+    offsets.emplace_back(method_offset, hit_offset);
+    // Update method offset for next method. 2 shorts are for method stats.
+    method_offset += 2 + get_num_vectors(std::get<1>(b));
+    hit_offset += std::get<2>(b);
+  }
+
+  instrumented_methods.resize(selected_methods.size());
+  workqueue_run_for<size_t>(0, selected_methods.size(), [&](size_t i) {
+    auto* method = selected_methods[i];
+    TraceContext trace_context(method);
+    instrumented_methods[i] = instrument_basic_blocks(
+        *method->get_code(), method, onMethodBegin, onMethodExit_map,
         onMethodExitUnchecked_map, onBlockHit, onNonLoopBlockHit_map,
-        max_vector_arity, max_vector_arity_other, method_offset, hit_offset,
-        max_num_blocks, inliner, options));
+        max_vector_arity, max_vector_arity_other, offsets[i].first,
+        offsets[i].second, std::move(blocks_to_instrument[i]), inliner,
+        options);
+  });
 
-    const auto& method_info = instrumented_methods.back();
+  for (const auto& method_info : instrumented_methods) {
     if (method_info.too_many_blocks) {
       TRACE(INSTRUMENT, 7, "Too many blocks: %s",
-            SHOW(show_deobfuscated(method)));
+            SHOW(show_deobfuscated(method_info.method)));
     } else {
       block_instrumented++;
     }
-
-    // Update method offset for next method. 2 shorts are for method stats.
-    method_offset += 2 + method_info.num_vectors;
-    hit_offset += method_info.num_hit_blocks;
-  });
+  }
 
   // Patch static fields.
   const auto field_name = array_fields.at(1)->get_name()->str();
@@ -543,6 +543,11 @@ void InstrumentPass::bind_config() {
   bind("inline_onBlockHit", false, m_options.inline_onBlockHit);
   bind("inline_onNonLoopBlockHit", false, m_options.inline_onNonLoopBlockHit);
   bind("apply_CSE_CopyProp", false, m_options.apply_CSE_CopyProp);
+  bind("combine_block_coverage_bits", false,
+       m_options.combine_block_coverage_bits,
+       "For block tracing, let successors set the coverage bit of blocks "
+       "that cannot throw and are the only way into them, instead of "
+       "updating the bit vector in every block.");
   bind("analysis_package_prefix", std::nullopt,
        m_options.analysis_package_prefix);
 
@@ -924,7 +929,8 @@ InstrumentPass::patch_sharded_arrays(
               suggested_names.count(i)
                   ? suggested_names.at(i)
                   : InstrumentPass::STATS_FIELD_NAME + std::to_string(i);
-          auto deobfuscated_name = template_field->get_deobfuscated_name();
+          auto deobfuscated_name =
+              template_field->get_deobfuscated_name_or_empty_copy();
           boost::replace_first(deobfuscated_name,
                                InstrumentPass::STATS_FIELD_NAME, new_name);
 
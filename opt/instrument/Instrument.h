@@ -105,6 +105,7 @@ class InstrumentPass : public Pass {
     bool inline_onBlockHit;
     bool inline_onNonLoopBlockHit;
     bool apply_CSE_CopyProp;
+    bool combine_block_coverage_bits;
     std::optional<std::string> analysis_package_prefix;
   };
 
@@ -1149,6 +1149,7 @@ void InterDex::emit_remaining_classes_exploring_alternatives(
     }
 
     best->cross_dex_ref_minimizer.compact();
+    best->emitting_state.dexes_structure.compact();
     std::unique_ptr<Alternative> last;
     std::swap(last, best);
     std::mutex best_mutex;
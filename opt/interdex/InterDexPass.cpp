@@ -98,6 +98,10 @@ void InterDexPass::bind_config() {
        m_minimize_cross_dex_refs_config.small_string_seed_weight);
   bind("minimize_cross_dex_refs_emit_json", false,
        m_minimize_cross_dex_refs_config.emit_json);
+  bind("minimize_cross_dex_refs_lazy_reprioritization", false,
+       m_minimize_cross_dex_refs_config.lazy_reprioritization,
+       "Only recompute the priority of a class affected by another class "
+       "when it reaches the front of the queue; faster, but approximate");
   bind("minimize_cross_dex_refs_explore_alternatives", 1,
        m_minimize_cross_dex_refs_explore_alternatives);
 
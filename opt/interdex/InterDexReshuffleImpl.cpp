@@ -306,13 +306,14 @@ void InterDexReshuffleImpl::compute_plan() {
       }
 
       // Check if it is a valid move.
+      auto source_dex_index = m_class_dex_indices.at(move.cls);
       if (!try_plan_move(move, /*mergeability_aware=*/m_mergeability_aware)) {
         continue;
       }
       if (traceEnabled(IDEXR, 5)) {
         print_stats();
       }
-      move_gains.moved_class(move);
+      move_gains.moved_class(move, source_dex_index);
     }
     total_moves += move_gains.moves_this_epoch();
     TRACE(IDEXR, 2, "executed %zu moves in epoch %zu",
@@ -389,13 +390,14 @@ bool InterDexReshuffleImpl::compute_dex_removal_plan() {
       }
       const Move& move = *move_opt;
       // Check if it is a valid move.
+      auto source_dex_index = m_class_dex_indices.at(move.cls);
       if (!try_plan_move(move)) {
         continue;
       }
       if (traceEnabled(IDEXR, 5)) {
         print_stats();
       }
-      move_gains.moved_class(move);
+      move_gains.moved_class(move, source_dex_index);
       TRACE(IDEXR, 2, "Move class %s to Dex %zu", SHOW(move.cls),
             move.target_dex_index);
     }
@@ -114,13 +114,33 @@ class MoveGains {
         m_deduped_weight(deduped_weight),
         m_other_weight(other_weight) {}
 
+  // Recomputes the gains of all moves that became stale. A gain only depends
+  // on the state of the source dex of the class and of the target dex, so
+  // after the first round, only the moves out of or into a dex that classes
+  // got moved out of or into are recomputed, and all others are carried over.
   void recompute_gains(size_t removal_dex = 0) {
     Timer t("recompute_gains");
+    auto is_stale = [&](size_t dex_index) {
+      return !m_has_gains || m_touched_dexes.count(dex_index) != 0;
+    };
+    size_t old_gains_size = m_gains_size;
     m_gains_size = 0;
+    for (size_t i = 0; i < old_gains_size; ++i) {
+      const auto& move = m_gains.at(i);
+      if (!is_stale(m_class_dex_indices.at(move.cls)) &&
+          !is_stale(move.target_dex_index)) {
+        m_gains.at(m_gains_size++) = move;
+      }
+    }
+    size_t carried_over = m_gains_size;
     std::mutex mutex;
     walk::parallel::classes(m_movable_classes, [&](DexClass* cls) {
+      bool stale_source = is_stale(m_class_dex_indices.at(cls));
       for (size_t dex_index = m_first_dex_index; dex_index < m_dexen.size();
            ++dex_index) {
+        if (!stale_source && !is_stale(dex_index)) {
+          continue;
+        }
         if (m_dynamically_dead_dexes.count(dex_index) != 0) {
           // m_dynamically_dead_dexes should not be involved during reshuffle.
           continue;
@@ -155,6 +175,10 @@ class MoveGains {
         }
       }
     });
+    TRACE(IDEXR, 2, "carried over %zu of %zu gains", carried_over,
+          m_gains_size);
+    m_has_gains = true;
+    m_touched_dexes.clear();
 
     m_gains_heap_size = m_gains_size;
     if (m_gains_heap.size() < m_gains_heap_size) {
@@ -194,7 +218,9 @@ class MoveGains {
     return std::nullopt;
   }
 
-  void moved_class(const Move& move) {
+  void moved_class(const Move& move, size_t source_dex_index) {
+    m_touched_dexes.insert(source_dex_index);
+    m_touched_dexes.insert(move.target_dex_index);
     size_t& class_epoch = m_move_epoch[move.cls];
     const bool was_moved_last_epoch = class_epoch == m_epoch - 1;
     class_epoch = m_epoch;
@@ -373,6 +399,11 @@ class MoveGains {
   std::vector<size_t> m_gains_heap;
   size_t m_gains_heap_size{0};
 
+  // Whether the gains were computed before, and which dexes classes got moved
+  // out of or into since.
+  bool m_has_gains{false};
+  std::unordered_set<size_t> m_touched_dexes;
+
   // This value is from expriment.
   gain_t m_min_gain_val{-24299166313522127};
 
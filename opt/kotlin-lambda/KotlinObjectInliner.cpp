@@ -7,6 +7,8 @@
 
 #include "KotlinObjectInliner.h"
 
+#include <optional>
+
 #include "CFGMutation.h"
 #include "ConcurrentContainers.h"
 #include "Creators.h"
@@ -17,6 +19,7 @@
 #include "Show.h"
 #include "TypeInference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 void dump_cls(DexClass* cls) {
@@ -399,7 +402,11 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
     }
   }
 
-  // Filter out any instance whose use is not tracktable
+  // Filter out any instance whose use is not tracktable. At the same time,
+  // index the methods that invoke methods of candidates, which are the only
+  // ones that need fixing up after relocation.
+  InsertOnlyConcurrentMap<DexMethod*, std::unordered_set<DexClass*>>
+      invoked_candidates;
   walk::parallel::methods(scope, [&](DexMethod* method) {
     auto code = method->get_code();
     if (!code) {
@@ -420,13 +427,27 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
     always_assert(code->editable_cfg_built());
     auto& cfg = code->cfg();
     auto iterable = cfg::InstructionIterable(cfg);
-    live_range::MoveAwareChains move_aware_chains(cfg);
-    type_inference::TypeInference type_inference(cfg);
-    type_inference.run(method);
-    auto& type_environments = type_inference.get_type_environments();
+    // Most methods do not touch any candidate, so only run the analyses when
+    // an instruction needs them.
+    std::optional<live_range::MoveAwareChains> move_aware_chains;
+    std::optional<type_inference::TypeInference> type_inference;
+    auto get_type_environment = [&](IRInstruction* insn) -> auto& {
+      if (!type_inference) {
+        type_inference.emplace(cfg);
+        type_inference->run(method);
+      }
+      return type_inference->get_type_environments().at(insn);
+    };
+    std::unordered_set<DexClass*> invoked;
 
     for (auto it = iterable.begin(); it != iterable.end(); it++) {
       auto insn = it->insn;
+      if (opcode::is_an_invoke(insn->opcode())) {
+        auto* callee_cls = type_class(insn->get_method()->get_class());
+        if (callee_cls && map.count(callee_cls)) {
+          invoked.insert(callee_cls);
+        }
+      }
       switch (insn->opcode()) {
       case OPCODE_SPUT_OBJECT: {
         auto* from = type_class(insn->get_field()->get_type());
@@ -461,7 +482,10 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
         }
         // Check we can track the uses of the Companion object instance.
         // i.e. Companion object is only used to invoke methods
-        if (!is_def_trackable(insn, from, move_aware_chains)) {
+        if (!move_aware_chains) {
+          move_aware_chains.emplace(cfg);
+        }
+        if (!is_def_trackable(insn, from, *move_aware_chains)) {
           bad.insert(from);
         }
         break;
@@ -499,7 +523,7 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
 
       case OPCODE_APUT_OBJECT:
       case OPCODE_AGET_OBJECT: {
-        auto& env = type_environments.at(insn);
+        auto& env = get_type_environment(insn);
         auto dex_type = env.get_dex_type(insn->src(0));
         if (!dex_type) {
           break;
@@ -543,6 +567,9 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
         break;
       }
     }
+    if (!invoked.empty()) {
+      invoked_candidates.emplace(method, std::move(invoked));
+    }
   });
   stats.kotlin_untrackable_companion_objects = bad.size();
 
@@ -564,15 +591,16 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
   }
 
   // Fix virtual call arguments
-  walk::parallel::methods(scope, [&](DexMethod* method) {
-    auto code = method->get_code();
-    if (code == nullptr) {
-      return;
+  std::vector<DexMethod*> callers;
+  for (auto& [method, invoked] : invoked_candidates) {
+    if (std::any_of(invoked.begin(), invoked.end(),
+                    [&](DexClass* cls) { return !bad.count(cls); })) {
+      callers.push_back(method);
     }
+  }
+  auto fix_invokes = [&](DexMethod* method) {
     bool changed = false;
     auto& cfg = method->get_code()->cfg();
-    cfg::CFGMutation m(cfg);
-    live_range::MoveAwareChains move_aware_chains(cfg);
     auto iterable = cfg::InstructionIterable(cfg);
 
     for (auto it = iterable.begin(); it != iterable.end(); it++) {
@@ -599,11 +627,11 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
       }
     }
     if (changed) {
-      m.flush();
       TRACE(KOTLIN_OBJ_INLINE, 5, "After : %s\n", SHOW(method));
       TRACE(KOTLIN_OBJ_INLINE, 5, "%s\n", SHOW(cfg));
     }
-  });
+  };
+  workqueue_run<DexMethod*>(fix_invokes, callers);
 
   stats.report(mgr);
 }
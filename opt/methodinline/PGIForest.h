@@ -74,14 +74,18 @@ class MethodContextContext {
 
   explicit MethodContextContext(const MethodProfiles* profiles)
       : m_interaction_list(create_interaction_list(profiles)),
-        m_profiles(profiles) {}
+        m_profiles(profiles) {
+    for (const auto& i : m_interaction_list) {
+      m_interaction_indices.push_back(*profiles->get_interaction_index(i));
+    }
+  }
 
   MethodContext create(const DexMethod* m) {
     std::vector<boost::optional<float>> hits;
     std::vector<boost::optional<float>> appear;
     bool has_data = false;
     boost::optional<MethodContext::Vals> vals = boost::none;
-    for (const auto& i : m_interaction_list) {
+    for (auto i : m_interaction_indices) {
       auto maybe_stat = m_profiles->get_method_stat(i, m);
       if (maybe_stat) {
         has_data = true;
@@ -138,6 +142,8 @@ class MethodContextContext {
     return res;
   }
 
+  // Parallel to m_interaction_list, to look up stats without hashing.
+  std::vector<uint32_t> m_interaction_indices;
   const MethodProfiles* m_profiles{nullptr};
 
   friend struct RandomForestTestHelper;
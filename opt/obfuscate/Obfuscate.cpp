@@ -20,6 +20,7 @@
 #include "Trace.h"
 #include "VirtualRenamer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -140,6 +141,44 @@ void update_refs(Scope& scope,
   });
 }
 
+void obfuscate_fields(DexClass* cls,
+                      DexFieldManager& field_name_manager,
+                      const ClassHierarchy& ch) {
+  // Checks to short-circuit expensive name-gathering logic (code is still
+  // correct w/o this, but does unnecessary work)
+  bool operate_on_ifields =
+      contains_renamable_elem(cls->get_ifields(), field_name_manager);
+  bool operate_on_sfields =
+      contains_renamable_elem(cls->get_sfields(), field_name_manager);
+  if (!operate_on_ifields && !operate_on_sfields) {
+    return;
+  }
+  FieldObfuscationState f_ob_state;
+  FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
+                                          f_ob_state.used_ids);
+
+  TRACE(OBFUSCATE, 3, "Renaming the fields of class %s",
+        SHOW(cls->get_name()));
+
+  f_ob_state.populate_ids_to_avoid(cls, field_name_manager,
+                                   /* unused */ ch);
+
+  if (operate_on_ifields) {
+    obfuscate_elems(
+        FieldRenamingContext(cls->get_ifields(), field_name_generator),
+        field_name_manager);
+  }
+  if (operate_on_sfields) {
+    obfuscate_elems(
+        FieldRenamingContext(cls->get_sfields(), field_name_generator),
+        field_name_manager);
+  }
+
+  // Make sure to bind the new names otherwise not all generators will
+  // assign names to the members
+  field_name_generator.bind_names();
+}
+
 void get_totals(Scope& scope, RenameStats& stats) {
   for (const auto& cls : scope) {
     stats.fields_total += cls->get_ifields().size();
@@ -160,45 +199,30 @@ void obfuscate(Scope& scope,
   DexFieldManager field_name_manager = new_dex_field_manager();
   DexMethodManager method_name_manager = new_dex_method_manager();
 
-  std::unordered_map<const DexClass*, int> next_dmethod_seeds;
+  // Field names only need to be unique within their class, so classes are
+  // renamed independently. Create all wrappers upfront, so that the name
+  // manager is only read from while renaming.
   for (DexClass* cls : scope) {
     always_assert_log(!cls->is_external(),
                       "Shouldn't rename members of external classes. %s",
                       SHOW(cls));
+    for (auto* f : cls->get_ifields()) {
+      field_name_manager[f];
+    }
+    for (auto* f : cls->get_sfields()) {
+      field_name_manager[f];
+    }
+  }
+  workqueue_run<DexClass*>(
+      [&](DexClass* cls) { obfuscate_fields(cls, field_name_manager, ch); },
+      scope);
+
+  std::unordered_map<const DexClass*, int> next_dmethod_seeds;
+  for (DexClass* cls : scope) {
     // Checks to short-circuit expensive name-gathering logic (code is still
     // correct w/o this, but does unnecessary work)
-    bool operate_on_ifields =
-        contains_renamable_elem(cls->get_ifields(), field_name_manager);
-    bool operate_on_sfields =
-        contains_renamable_elem(cls->get_sfields(), field_name_manager);
     bool operate_on_dmethods =
         contains_renamable_elem(cls->get_dmethods(), method_name_manager);
-    if (operate_on_ifields || operate_on_sfields) {
-      FieldObfuscationState f_ob_state;
-      FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
-                                              f_ob_state.used_ids);
-
-      TRACE(OBFUSCATE, 3, "Renaming the fields of class %s",
-            SHOW(cls->get_name()));
-
-      f_ob_state.populate_ids_to_avoid(cls, field_name_manager,
-                                       /* unused */ ch);
-
-      if (operate_on_ifields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_ifields(), field_name_generator),
-            field_name_manager);
-      }
-      if (operate_on_sfields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_sfields(), field_name_generator),
-            field_name_manager);
-      }
-
-      // Make sure to bind the new names otherwise not all generators will
-      // assign names to the members
-      field_name_generator.bind_names();
-    }
 
     // =========== Obfuscate Methods Below ==========
     if (operate_on_dmethods) {
@@ -511,11 +511,23 @@ class DexElemManager {
   virtual ~DexElemManager() {}
 
   // Mirrors the map [] operator, but ensures we create correct wrappers
-  // if they don't exist
+  // if they don't exist. Looking up existing wrappers does not modify the
+  // maps, so it can be done concurrently once all wrappers of interest have
+  // been created.
   inline DexNameWrapper<T>* operator[](T elem) {
-    auto [it, emplaced] =
-        elements[elem->get_class()][sig_getter_fn(elem)].emplace(
-            elem->get_name(), nullptr);
+    auto sig = sig_getter_fn(elem);
+    auto cls_it = elements.find(elem->get_class());
+    if (cls_it != elements.end()) {
+      auto sig_it = cls_it->second.find(sig);
+      if (sig_it != cls_it->second.end()) {
+        auto it = sig_it->second.find(elem->get_name());
+        if (it != sig_it->second.end()) {
+          return it->second.get();
+        }
+      }
+    }
+    auto [it, emplaced] = elements[elem->get_class()][sig].emplace(
+        elem->get_name(), nullptr);
     if (emplaced) {
       it->second = std::unique_ptr<DexNameWrapper<T>>(elemCtr(elem));
     }
@@ -1807,9 +1807,20 @@ void select_reduced_methods(
     return res;
   };
 
-  MutablePriorityQueue<Ref, int64_t> pq;
+  // Computing the initial priorities only reads the state, so it is done in
+  // parallel; the priorities are unique, so insertion order does not matter.
+  std::vector<Ref> initial_refs;
+  initial_refs.reserve(ref_sizes.size());
   for (auto [ref, _] : ref_sizes) {
-    pq.insert(ref, get_priority(ref));
+    initial_refs.push_back(ref);
+  }
+  std::vector<int64_t> initial_priorities(initial_refs.size());
+  workqueue_run_for<size_t>(0, initial_refs.size(), [&](size_t i) {
+    initial_priorities[i] = get_priority(initial_refs[i]);
+  });
+  MutablePriorityQueue<Ref, int64_t> pq;
+  for (size_t i = 0; i < initial_refs.size(); i++) {
+    pq.insert(initial_refs[i], initial_priorities[i]);
   }
 
   while (!pq.empty()) {
@@ -1888,8 +1899,9 @@ void select_reduced_methods(
       auto it = ref_rmvs.find(ref);
       if (it != ref_rmvs.end()) {
         always_assert(!it->second.empty());
-        pq.update_priority(ref, get_priority(ref));
-        always_assert(pq.get_priority(ref) == get_priority(ref));
+        auto priority = get_priority(ref);
+        pq.update_priority(ref, priority);
+        always_assert(pq.get_priority(ref) == priority);
         stats->reprioritizations++;
       } else {
         pq.erase(ref);
@@ -9,6 +9,7 @@
 
 #include <fstream>
 #include <functional>
+#include <memory>
 
 #include "CFGMutation.h"
 #include "ConcurrentContainers.h"
@@ -18,8 +19,10 @@
 #include "InitClassPruner.h"
 #include "InitClassesWithSideEffects.h"
 #include "LocalPointersAnalysis.h"
+#include "MethodOverrideGraph.h"
 #include "ObjectSensitiveDce.h"
 #include "PassManager.h"
+#include "PersistentSummaryCache.h"
 #include "Purity.h"
 #include "ScopedCFG.h"
 #include "SummarySerialization.h"
@@ -27,6 +30,21 @@
 
 namespace ptrs = local_pointers;
 
+namespace {
+
+// Each run of the pass gets its own cache file, as the methods it sees differ
+// from run to run.
+size_t s_run_count{0};
+
+} // namespace
+
+void ObjectSensitiveDcePass::set_analysis_usage(AnalysisUsage& au) const {
+  au.add_preserve_specific<method_override_graph::Graph>();
+  // Only instructions without side effects are removed, so the cached init
+  // classes remain a sound over-approximation.
+  au.add_preserve_specific<init_classes::InitClassesWithSideEffects>();
+}
+
 void ObjectSensitiveDcePass::run_pass(DexStoresVector& stores,
                                       ConfigFiles& conf,
                                       PassManager& mgr) {
@@ -36,9 +54,14 @@ void ObjectSensitiveDcePass::run_pass(DexStoresVector& stores,
       "init-class instructions.");
 
   auto scope = build_class_scope(stores);
-  auto method_override_graph = method_override_graph::build_graph(scope);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns(), method_override_graph.get());
+  auto method_override_graph =
+      mgr.get_cached_analysis<method_override_graph::Graph>(
+          [&]() { return method_override_graph::build_graph_cached(scope); });
+  auto init_classes_with_side_effects =
+      mgr.get_cached_analysis<init_classes::InitClassesWithSideEffects>([&]() {
+        return std::make_unique<init_classes::InitClassesWithSideEffects>(
+            scope, conf.create_init_class_insns(), method_override_graph.get());
+      });
 
   auto pure_methods = get_pure_methods();
   auto configured_pure_methods = conf.get_pure_methods();
@@ -61,15 +84,31 @@ void ObjectSensitiveDcePass::run_pass(DexStoresVector& stores,
   }
   mgr.incr_metric("external_side_effect_summaries", effect_summaries.size());
 
+  std::unique_ptr<PersistentSummaryCache> effect_summary_cache;
+  auto run = s_run_count++;
+  if (m_summary_cache_dir) {
+    effect_summary_cache = std::make_unique<PersistentSummaryCache>(
+        *m_summary_cache_dir,
+        "side_effect_summaries." + std::to_string(run),
+        side_effects::SUMMARY_CACHE_VERSION);
+  }
+
   ObjectSensitiveDce impl(scope,
-                          &init_classes_with_side_effects,
+                          init_classes_with_side_effects.get(),
                           pure_methods,
                           *method_override_graph,
                           m_big_override_threshold,
                           &escape_summaries,
-                          &effect_summaries);
+                          &effect_summaries,
+                          effect_summary_cache.get());
   impl.dce();
 
+  if (effect_summary_cache) {
+    effect_summary_cache->save();
+    mgr.set_metric("summary_cache_hits", effect_summary_cache->hits());
+    mgr.set_metric("summary_cache_misses", effect_summary_cache->misses());
+  }
+
   auto& stats = impl.get_stats();
   auto invokes_with_summaries = stats.invokes_with_summaries;
   mgr.set_metric("removed_instructions", stats.removed_instructions);
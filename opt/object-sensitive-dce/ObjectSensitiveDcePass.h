@@ -25,6 +25,10 @@ class ObjectSensitiveDcePass final : public Pass {
     };
   }
 
+  // Only code is changed, so the method override graph and the init classes
+  // with side effects are preserved.
+  void set_analysis_usage(AnalysisUsage& au) const override;
+
   void bind_config() override {
     bind("side_effect_summaries", {std::nullopt},
          m_external_side_effect_summaries_file, "TODO: Document me!",
@@ -33,6 +37,11 @@ class ObjectSensitiveDcePass final : public Pass {
          "TODO: Document me!",
          Configurable::bindflags::optionals::skip_empty_string);
     bind("big_override_threshold", UINT32_C(5), m_big_override_threshold);
+    bind("summary_cache_dir", {std::nullopt}, m_summary_cache_dir,
+         "Directory in which side-effect summaries are kept across builds, "
+         "so that only methods that changed, or whose callees' summaries "
+         "changed, need to be analyzed again.",
+         Configurable::bindflags::optionals::skip_empty_string);
 
     if (!m_external_escape_summaries_file ||
         !m_external_side_effect_summaries_file) {
@@ -48,4 +57,5 @@ class ObjectSensitiveDcePass final : public Pass {
   std::optional<std::string> m_external_side_effect_summaries_file;
   std::optional<std::string> m_external_escape_summaries_file;
   uint32_t m_big_override_threshold;
+  std::optional<std::string> m_summary_cache_dir;
 };
@@ -1075,12 +1075,20 @@ class EnumTransformer final {
   EnumTransformer(const Config& config, DexStoresVector* stores)
       : m_stores(*stores), m_int_objs(0) {
     m_enum_util = std::make_unique<EnumUtil>(config);
-    for (auto it = config.candidate_enums.begin();
-         it != config.candidate_enums.end();
-         ++it) {
-      auto enum_cls = type_class(*it);
-      auto attributes = optimize_enums::analyze_enum_clinit(
-          enum_cls, config.support_kt_19_enum_entries);
+    // The <clinit> of each enum only concerns that enum, so they are analyzed
+    // in parallel, and then cleaned up in parallel.
+    std::vector<DexType*> candidates(config.candidate_enums.begin(),
+                                     config.candidate_enums.end());
+    std::sort(candidates.begin(), candidates.end(), compare_dextypes);
+    std::vector<EnumAttributes> candidate_attributes(candidates.size());
+    workqueue_run_for<size_t>(0, candidates.size(), [&](size_t i) {
+      candidate_attributes[i] = optimize_enums::analyze_enum_clinit(
+          type_class(candidates[i]), config.support_kt_19_enum_entries);
+    });
+    std::vector<DexClass*> enum_classes;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      auto enum_cls = type_class(candidates[i]);
+      auto& attributes = candidate_attributes[i];
       size_t num_enum_constants = attributes.m_constants_map.size();
       if (num_enum_constants == 0) {
         TRACE(ENUM, 2, "\tCannot analyze enum %s : ord %zu sfields %zu",
@@ -1088,7 +1096,8 @@ class EnumTransformer final {
               enum_cls->get_sfields().size());
         continue;
       } else if (num_enum_constants > config.max_enum_size) {
-        if (!config.breaking_reference_equality_allowlist.count(*it)) {
+        if (!config.breaking_reference_equality_allowlist.count(
+                candidates[i])) {
           TRACE(ENUM, 2, "\tSkip %s %zu values", SHOW(enum_cls),
                 num_enum_constants);
           continue;
@@ -1101,10 +1110,10 @@ class EnumTransformer final {
       }
       m_int_objs = std::max<uint32_t>(m_int_objs, num_enum_constants);
       m_enum_objs += num_enum_constants;
-      m_enum_attributes_map.emplace(*it, attributes);
+      m_enum_attributes_map.emplace(candidates[i], std::move(attributes));
       TRACE(ENUM, 2, "\tcleaning enum %s with num const values %zu",
             SHOW(enum_cls), num_enum_constants);
-      clean_generated_methods_fields(enum_cls);
+      enum_classes.push_back(enum_cls);
       opt_metadata::log_opt(ENUM_OPTIMIZED, enum_cls);
       TRACE(ENUM, 2, "\tOptimized %s to %zu Integers", SHOW(enum_cls),
             num_enum_constants);
@@ -1112,6 +1121,9 @@ class EnumTransformer final {
         m_kotlin_enum_classes++;
       }
     }
+    workqueue_run<DexClass*>(
+        [&](DexClass* enum_cls) { clean_generated_methods_fields(enum_cls); },
+        enum_classes);
     m_enum_util->create_util_class(stores, m_int_objs);
   }
 
@@ -1151,12 +1163,8 @@ class EnumTransformer final {
     for (auto method : instance_methods) {
       mutators::make_static(method);
     }
-    std::map<DexFieldRef*, DexMethodRef*, dexfields_comparator> field_to_method(
-        m_enum_util->m_get_instance_field_methods.begin(),
-        m_enum_util->m_get_instance_field_methods.end());
-    for (auto& pair : field_to_method) {
-      create_get_instance_field_method(pair.second, pair.first);
-    }
+    create_get_instance_field_methods(
+        m_enum_util->m_get_instance_field_methods);
     post_update_enum_classes(scope);
     // Update all methods and fields references by replacing the candidate enum
     // types with Integer type.
@@ -1217,18 +1225,60 @@ class EnumTransformer final {
     });
   }
 
+  /**
+   * The substitute methods of each enum are created, and added to the enum
+   * class, by one thread, in parallel with those of other enums.
+   */
   void create_substitute_methods(const ConcurrentSet<DexMethodRef*>& methods) {
+    std::unordered_map<DexType*, std::vector<DexMethodRef*>> methods_by_enum;
     for (auto ref : methods) {
-      if (ref->get_name() == m_enum_util->REDEX_NAME) {
-        create_name_method(ref);
-      } else if (ref->get_name() == m_enum_util->REDEX_HASHCODE) {
-        create_hashcode_method(ref);
-      } else if (ref->get_name() == m_enum_util->REDEX_VALUEOF) {
-        create_valueof_method(ref);
-      } else if (ref->get_name() == m_enum_util->REDEX_STRING_VALUEOF) {
-        create_stringvalueof_method(ref);
-      }
+      methods_by_enum[ref->get_class()].push_back(ref);
     }
+    std::vector<const std::vector<DexMethodRef*>*> groups;
+    for (auto& p : methods_by_enum) {
+      groups.push_back(&p.second);
+    }
+    workqueue_run<const std::vector<DexMethodRef*>*>(
+        [&](const std::vector<DexMethodRef*>* refs) {
+          for (auto ref : *refs) {
+            create_substitute_method(ref);
+          }
+        },
+        groups);
+  }
+
+  void create_substitute_method(DexMethodRef* ref) {
+    if (ref->get_name() == m_enum_util->REDEX_NAME) {
+      create_name_method(ref);
+    } else if (ref->get_name() == m_enum_util->REDEX_HASHCODE) {
+      create_hashcode_method(ref);
+    } else if (ref->get_name() == m_enum_util->REDEX_VALUEOF) {
+      create_valueof_method(ref);
+    } else if (ref->get_name() == m_enum_util->REDEX_STRING_VALUEOF) {
+      create_stringvalueof_method(ref);
+    }
+  }
+
+  // Likewise for the getters of instance fields.
+  void create_get_instance_field_methods(
+      const InsertOnlyConcurrentMap<DexFieldRef*, DexMethodRef*>&
+          field_to_method) {
+    using FieldMethods = std::vector<std::pair<DexFieldRef*, DexMethodRef*>>;
+    std::unordered_map<DexType*, FieldMethods> methods_by_enum;
+    for (auto& [field, method] : field_to_method) {
+      methods_by_enum[method->get_class()].emplace_back(field, method);
+    }
+    std::vector<const FieldMethods*> groups;
+    for (auto& p : methods_by_enum) {
+      groups.push_back(&p.second);
+    }
+    workqueue_run<const FieldMethods*>(
+        [&](const FieldMethods* field_methods) {
+          for (auto& [field, method] : *field_methods) {
+            create_get_instance_field_method(method, field);
+          }
+        },
+        groups);
   }
 
   /**
@@ -1295,7 +1345,7 @@ class EnumTransformer final {
     auto& cfg = code->cfg();
     auto prev_block = cfg.entry_block();
     for (auto& pair :
-         m_enum_attributes_map[ref->get_class()].get_ordered_names()) {
+         m_enum_attributes_map.at(ref->get_class()).get_ordered_names()) {
       prev_block->push_back({dasm(OPCODE_CONST_STRING, pair.second),
                              dasm(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT, {1_v}),
                              dasm(OPCODE_INVOKE_VIRTUAL,
@@ -1350,7 +1400,7 @@ class EnumTransformer final {
 
     std::vector<std::pair<int32_t, cfg::Block*>> cases;
     for (auto& pair :
-         m_enum_attributes_map[ref->get_class()].get_ordered_names()) {
+         m_enum_attributes_map.at(ref->get_class()).get_ordered_names()) {
       auto block = cfg.create_block();
       cases.emplace_back(pair.first, block);
       block->push_back({dasm(OPCODE_CONST_STRING, pair.second),
@@ -1434,7 +1484,7 @@ class EnumTransformer final {
     auto ifield_type = ifield_ref->get_type();
     std::vector<std::pair<int32_t, cfg::Block*>> cases;
     for (auto& pair :
-         m_enum_attributes_map[cls->get_type()].m_field_map[ifield_ref]) {
+         m_enum_attributes_map.at(cls->get_type()).m_field_map.at(ifield_ref)) {
       auto ordinal = pair.first;
       auto block = cfg.create_block();
       cases.emplace_back(ordinal, block);
@@ -1476,7 +1526,7 @@ class EnumTransformer final {
   void clean_generated_methods_fields(DexClass* enum_cls) {
     auto& sfields = enum_cls->get_sfields();
     auto& enum_constants =
-        m_enum_attributes_map[enum_cls->get_type()].m_constants_map;
+        m_enum_attributes_map.at(enum_cls->get_type()).m_constants_map;
     auto synth_field_access = synth_access();
     std::unordered_set<DexField*> synth_fields;
 
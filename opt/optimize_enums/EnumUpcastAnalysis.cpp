@@ -20,9 +20,45 @@ namespace {
 using namespace optimize_enums;
 using namespace ir_analyzer;
 
+/**
+ * The enums rejected by one thread, with the reasons they were rejected for.
+ * Some enums are rejected without a reason to report. Each thread collects its
+ * own, and they are merged once all threads are done, so that no locks are
+ * taken while analyzing.
+ */
+struct Rejections {
+  std::unordered_map<DexType*, UnsafeTypes> enums;
+
+  void reject(DexType* type) { enums[type]; }
+
+  void reject(DexType* type, UnsafeType u) { enums[type].insert(u); }
+
+  bool is_rejected(DexType* type) const { return enums.count(type); }
+
+  Rejections& operator+=(const Rejections& other) {
+    for (const auto& [type, unsafe_types] : other.enums) {
+      enums[type].insert(unsafe_types.begin(), unsafe_types.end());
+    }
+    return *this;
+  }
+
+  // Reports the reasons and removes the rejected enums from the candidates.
+  template <typename RejectFn>
+  void apply(ConcurrentSet<DexType*>* candidate_enums,
+             const RejectFn& reject_fn) const {
+    for (const auto& [type, unsafe_types] : enums) {
+      for (auto u : unsafe_types) {
+        reject_fn(type, u);
+      }
+      candidate_enums->erase(type);
+    }
+  }
+};
+
+template <typename IsRejected>
 bool need_analyze(const DexMethod* method,
                   const ConcurrentSet<DexType*>& candidate_enums,
-                  const ConcurrentSet<DexType*>& rejected_enums) {
+                  const IsRejected& is_rejected) {
   const IRCode* code = method->get_code();
   if (!code) {
     return false;
@@ -33,7 +69,7 @@ bool need_analyze(const DexMethod* method,
     if (type::is_array(t)) {
       t = type::get_array_element_type(t);
     }
-    if (candidate_enums.count_unsafe(t) && !rejected_enums.count(t)) {
+    if (candidate_enums.count_unsafe(t) && !is_rejected(t)) {
       return true;
     }
   }
@@ -633,208 +669,230 @@ EnumTypeEnvironment EnumFixpointIterator::gen_env(const DexMethod* method) {
  * become identical.
  */
 void reject_enums_for_colliding_constructors(
-    const std::vector<DexClass*>& classes,
-    ConcurrentSet<DexType*>* candidate_enums) {
-  ConcurrentSet<DexType*> rejected_enums;
-
-  walk::parallel::classes(classes, [&](DexClass* cls) {
-    const auto& ctors = cls->get_ctors();
-    if (ctors.size() <= 1) {
-      return;
+    const DexClass* cls,
+    const ConcurrentSet<DexType*>& candidate_enums,
+    Rejections* rejected_enums) {
+  const auto& ctors = cls->get_ctors();
+  if (ctors.size() <= 1) {
+    return;
+  }
+  std::unordered_set<DexTypeList*> modified_params_lists;
+  for (auto ctor : ctors) {
+    std::unordered_set<DexType*> transforming_enums;
+    DexTypeList::ContainerType param_types{
+        ctor->get_proto()->get_args()->begin(),
+        ctor->get_proto()->get_args()->end()};
+    for (size_t i = 0; i < param_types.size(); i++) {
+      auto base_type = const_cast<DexType*>(
+          type::get_element_type_if_array(param_types[i]));
+      if (candidate_enums.count_unsafe(base_type)) {
+        transforming_enums.insert(base_type);
+        param_types[i] = type::make_array_type(
+            type::java_lang_Integer(), type::get_array_level(param_types[i]));
+      }
     }
-    std::unordered_set<DexTypeList*> modified_params_lists;
-    for (auto ctor : ctors) {
-      std::unordered_set<DexType*> transforming_enums;
-      DexTypeList::ContainerType param_types{
-          ctor->get_proto()->get_args()->begin(),
-          ctor->get_proto()->get_args()->end()};
-      for (size_t i = 0; i < param_types.size(); i++) {
-        auto base_type = const_cast<DexType*>(
-            type::get_element_type_if_array(param_types[i]));
-        if (candidate_enums->count(base_type)) {
-          transforming_enums.insert(base_type);
-          param_types[i] = type::make_array_type(
-              type::java_lang_Integer(), type::get_array_level(param_types[i]));
-        }
+    auto new_params = DexTypeList::make_type_list(std::move(param_types));
+    if (modified_params_lists.count(new_params)) {
+      for (auto enum_type : transforming_enums) {
+        TRACE(ENUM, 4,
+              "Reject %s because it would create a method prototype "
+              "collision for %s",
+              SHOW(enum_type), SHOW(ctor));
+        rejected_enums->reject(enum_type);
       }
-      auto new_params = DexTypeList::make_type_list(std::move(param_types));
-      if (modified_params_lists.count(new_params)) {
+    } else {
+      auto new_proto = DexProto::make_proto(type::_void(), new_params);
+      if (DexMethod::get_method(ctor->get_class(), ctor->get_name(),
+                                new_proto) != nullptr) {
         for (auto enum_type : transforming_enums) {
           TRACE(ENUM, 4,
                 "Reject %s because it would create a method prototype "
                 "collision for %s",
                 SHOW(enum_type), SHOW(ctor));
-          rejected_enums.insert(enum_type);
+          rejected_enums->reject(enum_type);
         }
       } else {
-        auto new_proto = DexProto::make_proto(type::_void(), new_params);
-        if (DexMethod::get_method(ctor->get_class(), ctor->get_name(),
-                                  new_proto) != nullptr) {
-          for (auto enum_type : transforming_enums) {
-            TRACE(ENUM, 4,
-                  "Reject %s because it would create a method prototype "
-                  "collision for %s",
-                  SHOW(enum_type), SHOW(ctor));
-            rejected_enums.insert(enum_type);
-          }
-        } else {
-          modified_params_lists.insert(new_params);
-        }
+        modified_params_lists.insert(new_params);
       }
     }
-  });
-
-  for (DexType* type : rejected_enums) {
-    candidate_enums->erase(type);
   }
 }
 
-void reject_enums_for_relaxed_inits(const std::vector<DexClass*>& classes,
-                                    ConcurrentSet<DexType*>* candidate_enums) {
-  ConcurrentSet<DexType*> rejected_enums;
-  walk::parallel::code(classes, [&](DexMethod* method, IRCode& code) {
-    auto& cfg = code.cfg();
-    std::unordered_set<const IRInstruction*> new_instances_to_verify;
-    for (auto& mie : InstructionIterable(cfg)) {
-      auto insn = mie.insn;
-      if (insn->opcode() != OPCODE_NEW_INSTANCE ||
-          !candidate_enums->count(insn->get_type())) {
+void reject_enums_for_colliding_constructors(
+    const std::vector<DexClass*>& classes,
+    ConcurrentSet<DexType*>* candidate_enums) {
+  auto rejected_enums =
+      walk::parallel::classes<Rejections>(classes, [&](DexClass* cls) {
+        Rejections rejected;
+        reject_enums_for_colliding_constructors(cls, *candidate_enums,
+                                                &rejected);
+        return rejected;
+      });
+  rejected_enums.apply(candidate_enums, [](auto*, auto) {});
+}
+
+void reject_enums_for_relaxed_inits(
+    DexMethod* method,
+    const ConcurrentSet<DexType*>& candidate_enums,
+    Rejections* rejected) {
+  auto* code = method->get_code();
+  if (code == nullptr) {
+    return;
+  }
+  auto& cfg = code->cfg();
+  std::unordered_set<const IRInstruction*> new_instances_to_verify;
+  for (auto& mie : InstructionIterable(cfg)) {
+    auto insn = mie.insn;
+    if (insn->opcode() != OPCODE_NEW_INSTANCE ||
+        !candidate_enums.count_unsafe(insn->get_type())) {
+      continue;
+    }
+    new_instances_to_verify.insert(insn);
+  }
+  if (new_instances_to_verify.empty()) {
+    return;
+  }
+  live_range::MoveAwareChains chains(
+      cfg, /* ignore_unreachable */ false,
+      [&](auto* insn) { return new_instances_to_verify.count(insn); });
+  live_range::DefUseChains du_chains = chains.get_def_use_chains();
+  for (auto* new_instance_insn : new_instances_to_verify) {
+    auto* enum_type = new_instance_insn->get_type();
+    auto use_set = du_chains[const_cast<IRInstruction*>(new_instance_insn)];
+    for (const auto use : use_set) {
+      if (use.src_index != 0) {
         continue;
       }
-      new_instances_to_verify.insert(insn);
-    }
-    if (new_instances_to_verify.empty()) {
-      return;
-    }
-    live_range::MoveAwareChains chains(
-        cfg, /* ignore_unreachable */ false,
-        [&](auto* insn) { return new_instances_to_verify.count(insn); });
-    live_range::DefUseChains du_chains = chains.get_def_use_chains();
-    for (auto* new_instance_insn : new_instances_to_verify) {
-      auto* enum_type = new_instance_insn->get_type();
-      auto use_set = du_chains[const_cast<IRInstruction*>(new_instance_insn)];
-      for (const auto use : use_set) {
-        if (use.src_index != 0) {
-          continue;
-        }
-        auto use_insn = use.insn;
-        if (opcode::is_a_move(use_insn->opcode())) {
-          // Ignore moves
-          continue;
-        }
-        if (!use_insn->has_method()) {
-          continue;
-        }
-        auto callee = use_insn->get_method();
-        if (!method::is_init(callee)) {
-          continue;
-        }
-        const auto* resolved_callee =
-            resolve_method(callee, opcode_to_search(use_insn), method);
-        if (!resolved_callee || resolved_callee->get_class() != enum_type) {
-          TRACE(ENUM, 4,
-                "Reject %s because base constructor %s in invoke instruction "
-                "%s may be called on new-instance instruction %s in %s",
-                SHOW(enum_type), SHOW(resolved_callee), SHOW(use_insn),
-                SHOW(new_instance_insn), SHOW(method));
-          rejected_enums.insert(enum_type);
-          break;
-        }
+      auto use_insn = use.insn;
+      if (opcode::is_a_move(use_insn->opcode())) {
+        // Ignore moves
+        continue;
+      }
+      if (!use_insn->has_method()) {
+        continue;
+      }
+      auto callee = use_insn->get_method();
+      if (!method::is_init(callee)) {
+        continue;
+      }
+      const auto* resolved_callee =
+          resolve_method(callee, opcode_to_search(use_insn), method);
+      if (!resolved_callee || resolved_callee->get_class() != enum_type) {
+        TRACE(ENUM, 4,
+              "Reject %s because base constructor %s in invoke instruction "
+              "%s may be called on new-instance instruction %s in %s",
+              SHOW(enum_type), SHOW(resolved_callee), SHOW(use_insn),
+              SHOW(new_instance_insn), SHOW(method));
+        rejected->reject(enum_type);
+        break;
       }
     }
-  });
-  for (DexType* type : rejected_enums) {
-    candidate_enums->erase(type);
   }
 }
 
+void reject_enums_for_relaxed_inits(const std::vector<DexClass*>& classes,
+                                    ConcurrentSet<DexType*>* candidate_enums) {
+  auto rejected_enums = walk::parallel::methods<Rejections>(
+      classes, [&](DexMethod* method, Rejections* rejected) {
+        reject_enums_for_relaxed_inits(method, *candidate_enums, rejected);
+      });
+  rejected_enums.apply(candidate_enums, [](auto*, auto) {});
+}
+
 void reject_unsafe_enums(
     const std::vector<DexClass*>& classes,
     Config* config,
     const std::function<void(const DexType*, UnsafeType u)>& reject_fn) {
   auto candidate_enums = &config->candidate_enums;
-  ConcurrentSet<DexType*> rejected_enums;
 
-  walk::parallel::fields(
-      classes, [candidate_enums, &rejected_enums, &reject_fn](DexField* field) {
+  auto field_rejections = walk::parallel::fields<Rejections>(
+      classes, [candidate_enums](DexField* field) {
+        Rejections rejected;
         if (can_rename(field)) {
-          return;
+          return rejected;
         }
         if (candidate_enums->count_unsafe(field->get_class())) {
           auto access = field->get_access();
           if (check_required_access_flags(enum_field_access(), access) ||
               check_required_access_flags(synth_access(), access)) {
-            return;
+            return rejected;
           }
         }
         auto type = const_cast<DexType*>(
             type::get_element_type_if_array(field->get_type()));
         if (candidate_enums->count_unsafe(type)) {
-          rejected_enums.insert(type);
-          reject_fn(type, UnsafeType::kUsageUnrenamableFieldType);
+          rejected.reject(type, UnsafeType::kUsageUnrenamableFieldType);
         }
+        return rejected;
       });
 
-  walk::parallel::methods(classes, [&](DexMethod* method) {
-    // When doing static analysis, simply skip some javac-generated enum
-    // methods <init>, values(), and valueOf(String).
-    if (candidate_enums->count_unsafe(method->get_class()) &&
-        !rejected_enums.count(method->get_class()) &&
-        (method::is_init(method) || is_enum_values(method) ||
-         is_enum_valueof(method))) {
-      return;
-    }
-
-    auto reject_proto_types = [&](DexMethod* method, UnsafeType u) {
-      std::vector<DexType*> types;
-      method->get_proto()->gather_types(types);
-      for (auto type : types) {
-        auto elem_type =
-            const_cast<DexType*>(type::get_element_type_if_array(type));
-        if (candidate_enums->count_unsafe(elem_type)) {
-          TRACE(ENUM, 5,
-                "Rejecting %s due to !can_rename or usage from annotation",
-                SHOW(elem_type));
-          reject_fn(elem_type, u);
-          rejected_enums.insert(elem_type);
+  auto method_rejections = walk::parallel::methods_by_cost<Rejections>(
+      classes, [&](DexMethod* method) {
+        Rejections rejected;
+        // Rejections found by other threads are not visible here, so this may
+        // analyze methods that only concern enums rejected elsewhere, which
+        // is fine.
+        auto is_rejected = [&](DexType* type) {
+          return field_rejections.is_rejected(type) ||
+                 rejected.is_rejected(type);
+        };
+        // When doing static analysis, simply skip some javac-generated enum
+        // methods <init>, values(), and valueOf(String).
+        if (candidate_enums->count_unsafe(method->get_class()) &&
+            !is_rejected(method->get_class()) &&
+            (method::is_init(method) || is_enum_values(method) ||
+             is_enum_valueof(method))) {
+          return rejected;
         }
-      }
-    };
 
-    if (!can_rename(method)) {
-      reject_proto_types(method, UnsafeType::kUsageUnrenamableMethodRef);
-      if (!is_static(method) &&
-          candidate_enums->count_unsafe(method->get_class())) {
-        rejected_enums.insert(method->get_class());
-      }
-    }
+        auto reject_proto_types = [&](DexMethod* method, UnsafeType u) {
+          std::vector<DexType*> types;
+          method->get_proto()->gather_types(types);
+          for (auto type : types) {
+            auto elem_type =
+                const_cast<DexType*>(type::get_element_type_if_array(type));
+            if (candidate_enums->count_unsafe(elem_type)) {
+              TRACE(ENUM, 5,
+                    "Rejecting %s due to !can_rename or usage from annotation",
+                    SHOW(elem_type));
+              rejected.reject(elem_type, u);
+            }
+          }
+        };
 
-    auto method_cls = type_class(method->get_class());
-    if (method_cls != nullptr && is_annotation(method_cls)) {
-      reject_proto_types(method, UnsafeType::kUsageAnnotationMethodRef);
-    }
+        if (!can_rename(method)) {
+          reject_proto_types(method, UnsafeType::kUsageUnrenamableMethodRef);
+          if (!is_static(method) &&
+              candidate_enums->count_unsafe(method->get_class())) {
+            rejected.reject(method->get_class());
+          }
+        }
 
-    if (!need_analyze(method, *candidate_enums, rejected_enums)) {
-      return;
-    }
+        auto method_cls = type_class(method->get_class());
+        if (method_cls != nullptr && is_annotation(method_cls)) {
+          reject_proto_types(method, UnsafeType::kUsageAnnotationMethodRef);
+        }
 
-    auto& cfg = method->get_code()->cfg();
-    EnumTypeEnvironment env = EnumFixpointIterator::gen_env(method);
-    EnumFixpointIterator engine(cfg, *config);
-    engine.run(env);
+        if (!need_analyze(method, *candidate_enums, is_rejected)) {
+          return rejected;
+        }
 
-    auto local_reject_fn = [&](DexType* type, UnsafeType u) {
-      rejected_enums.insert(type);
-      reject_fn(type, u);
-    };
+        auto& cfg = method->get_code()->cfg();
+        EnumTypeEnvironment env = EnumFixpointIterator::gen_env(method);
+        EnumFixpointIterator engine(cfg, *config);
+        engine.run(env);
 
-    EnumUpcastDetector detector(method, config, local_reject_fn);
-    detector.run(engine, cfg);
-  });
+        auto local_reject_fn = [&](DexType* type, UnsafeType u) {
+          rejected.reject(type, u);
+        };
 
-  for (DexType* type : rejected_enums) {
-    candidate_enums->erase(type);
-  }
+        EnumUpcastDetector detector(method, config, local_reject_fn);
+        detector.run(engine, cfg);
+        return rejected;
+      });
+
+  field_rejections.apply(candidate_enums, reject_fn);
+  method_rejections.apply(candidate_enums, reject_fn);
 
   reject_enums_for_colliding_constructors(classes, candidate_enums);
   reject_enums_for_relaxed_inits(classes, candidate_enums);
@@ -153,7 +153,9 @@ class OptimizeEnumsUnmapCfg {
         m_flow.cmp_if_src0,
         m_flow.cmp_if_src1,
     };
-    auto res = m_flow.flow.find(m_cfg, cmp_locations);
+    // Every switchmap lookup goes through an aget, so don't bother building
+    // the instruction graph for methods without one.
+    auto res = m_flow.flow.find(m_cfg, cmp_locations, {OPCODE_AGET});
 
     for (auto cmp_location : cmp_locations) {
       unmap_location(res, cmp_location);
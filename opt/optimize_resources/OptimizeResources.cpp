@@ -35,6 +35,7 @@
 #include "Show.h"
 #include "StlUtil.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 #include "androidfw/ResourceTypes.h"
 #include "utils/Vector.h"
 
@@ -107,15 +108,23 @@ void compute_transitive_closure(
     }
 
     potential_file_paths.clear();
-    for (auto& str : next_xml_files) {
-      explored_xml_files->emplace(str);
-      for (uint32_t attribute : resources->get_xml_reference_attributes(str)) {
+    // Parsing the files of a wave is independent, and done in parallel; the
+    // walks that follow share the visited nodes, and run serially.
+    std::vector<std::string> files(next_xml_files.begin(),
+                                   next_xml_files.end());
+    next_xml_files.clear();
+    std::vector<std::unordered_set<uint32_t>> files_attributes(files.size());
+    workqueue_run_for<size_t>(0, files.size(), [&](size_t i) {
+      files_attributes[i] = resources->get_xml_reference_attributes(files[i]);
+    });
+    for (size_t i = 0; i < files.size(); ++i) {
+      explored_xml_files->emplace(std::move(files[i]));
+      for (uint32_t attribute : files_attributes[i]) {
         res_table->walk_references_for_resource(
             attribute, ResourcePathType::ZipPath, nodes_visited,
             &potential_file_paths);
       }
     }
-    next_xml_files.clear();
   }
 
   TRACE(OPTRES, 2, "nodes_visited count: %zu", nodes_visited->size());
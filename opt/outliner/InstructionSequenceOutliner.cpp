@@ -14,7 +14,9 @@
  * instructions in a block occurs sufficiently often. The average complexity is
  * held down by filtering out instruction sequences where adjacent sequences of
  * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
+ * in the scope. In addition, a suffix array over the cores of all instructions
+ * of a dex tells, for each instruction, how long the longest sequence starting
+ * there is that occurs elsewhere, which bounds how far we need to look.
  *
  * When reaching a conditional branch or switch instruction, different control-
  * paths are explored as well, as long as they eventually all arrive at a common
@@ -65,6 +67,8 @@
 #include "InstructionSequenceOutliner.h"
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
@@ -104,6 +108,7 @@
 #include "ReachingInitializeds.h"
 #include "RedexContext.h"
 #include "RefChecker.h"
+#include "RepeatedSequences.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
@@ -368,6 +373,14 @@ class CandidateInstructionCoresBuilder {
   size_t m_size{0};
 };
 
+// For instructions in blocks we may outline from, the length of the longest
+// sequence of cores starting at the instruction that also occurs elsewhere in
+// the dex. Only lengths below the maximum candidate size are recorded, as
+// others do not bound anything.
+using RepeatLengths = std::unordered_map<const IRInstruction*, uint32_t>;
+
+const Symbol SEPARATOR = std::numeric_limits<Symbol>::max();
+
 ////////////////////////////////////////////////////////////////////////////////
 // Normalization of partial candidate sequence to candidate sequence
 ////////////////////////////////////////////////////////////////////////////////
@@ -797,6 +810,7 @@ static bool explore_candidates_from(
     const Config& config,
     const RefChecker& ref_checker,
     const CandidateInstructionCoresSet& recurring_cores,
+    const RepeatLengths* repeat_lengths,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
@@ -806,10 +820,22 @@ static bool explore_candidates_from(
   CandidateInstructionCoresBuilder cores_builder;
   auto first_block = it.block();
   auto& cfg = first_block->cfg();
+  // The instructions of the root node must form a sequence that occurs
+  // elsewhere, as the instructions of any recurring candidate do.
+  boost::optional<uint32_t> max_root_insns_size;
+  if (repeat_lengths && pcn == &pc->root && it != end) {
+    auto repeat_it = repeat_lengths->find(it->insn);
+    if (repeat_it != repeat_lengths->end()) {
+      max_root_insns_size = repeat_it->second;
+    }
+  }
   for (; it != end; prev_opcode = it->insn->opcode(), it++) {
     if (pc->insns_size >= config.max_insns_size) {
       return false;
     }
+    if (max_root_insns_size && pcn->insns.size() >= *max_root_insns_size) {
+      return false;
+    }
     auto insn = it->insn;
     if (pcn->insns.size() + 1 < MIN_INSNS_SIZE &&
         !can_outline_insn(ref_checker, reaching_initialized_init_first_param,
@@ -856,11 +882,11 @@ static bool explore_candidates_from(
           always_assert(
               is_uniquely_reached_via_pred(succ_big_block->get_first_block()));
           auto succ_ii = big_blocks::InstructionIterable(*succ_big_block);
-          if (!explore_candidates_from(reaching_initialized_new_instances,
-                                       reaching_initialized_init_first_param,
-                                       config, ref_checker, recurring_cores, pc,
-                                       succ_pcn.get(), succ_ii.begin(),
-                                       succ_ii.end())) {
+          if (!explore_candidates_from(
+                  reaching_initialized_new_instances,
+                  reaching_initialized_init_first_param, config, ref_checker,
+                  recurring_cores, repeat_lengths, pc, succ_pcn.get(),
+                  succ_ii.begin(), succ_ii.end())) {
             return false;
           }
         }
@@ -937,6 +963,7 @@ static MethodCandidates find_method_candidates(
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
     const CandidateInstructionCoresSet& recurring_cores,
+    const RepeatLengths* repeat_lengths,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1169,8 +1196,8 @@ static MethodCandidates find_method_candidates(
       PartialCandidate pc;
       explore_candidates_from(reaching_initialized_new_instances,
                               reaching_initialized_init_first_param, config,
-                              ref_checker, recurring_cores, &pc, &pc.root, it,
-                              end, &explored_callback);
+                              ref_checker, recurring_cores, repeat_lengths, &pc,
+                              &pc.root, it, end, &explored_callback);
     }
   }
 
@@ -1207,15 +1234,28 @@ static void get_recurring_cores(
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
     CandidateInstructionCoresSet* recurring_cores,
+    RepeatLengths* repeat_lengths,
     InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>*
         block_deciders) {
   AtomicMap<CandidateInstructionCores, size_t, CandidateInstructionCoresHasher>
       concurrent_cores;
+  // The outlinable runs of instructions of each method, as symbols of a
+  // shared alphabet of cores. Runs are delimited by nullptr / SEPARATOR.
+  struct MethodSequence {
+    std::vector<IRInstruction*> insns;
+    std::vector<Symbol> symbols;
+  };
+  InsertOnlyConcurrentMap<DexMethod*, MethodSequence> method_sequences;
+  InsertOnlyConcurrentMap<CandidateInstructionCore, Symbol,
+                          CandidateInstructionCoreHasher>
+      alphabet;
+  std::atomic<Symbol> next_symbol{0};
   walk::parallel::code(
       scope,
       [&config, &ref_checker, &throughput_interaction_indices,
        &throughput_methods, &sufficiently_warm_methods,
-       &sufficiently_hot_methods, &concurrent_cores,
+       &sufficiently_hot_methods, &concurrent_cores, repeat_lengths,
+       &method_sequences, &alphabet, &next_symbol,
        block_deciders](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method)) {
           return;
@@ -1235,27 +1275,49 @@ static void get_recurring_cores(
               reaching_initializeds::get_reaching_initializeds(
                   cfg, reaching_initializeds::Mode::FirstLoadParam);
         }
+        MethodSequence sequence;
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
           if (block_decider.can_outline_from_big_block(big_block) !=
               CanOutlineBlockDecider::Result::CanOutline) {
             continue;
           }
           CandidateInstructionCoresBuilder cores_builder;
+          auto end_run = [&sequence]() {
+            if (!sequence.insns.empty() && sequence.insns.back() != nullptr) {
+              sequence.insns.push_back(nullptr);
+              sequence.symbols.push_back(SEPARATOR);
+            }
+          };
           for (auto& mie : big_blocks::InstructionIterable(big_block)) {
             auto insn = mie.insn;
             if (!can_outline_insn(ref_checker,
                                   reaching_initialized_init_first_param, insn,
                                   config.outline_control_flow)) {
               cores_builder.clear();
+              end_run();
               continue;
             }
             cores_builder.push_back(insn);
             if (cores_builder.has_value()) {
               concurrent_cores.fetch_add(cores_builder.get_value(), 1);
             }
+            if (repeat_lengths) {
+              auto core = to_core(insn);
+              const auto* symbol = alphabet.get(core);
+              if (symbol == nullptr) {
+                // Racing threads may waste a symbol, which doesn't matter.
+                symbol = alphabet.emplace(core, next_symbol.fetch_add(1)).first;
+              }
+              sequence.insns.push_back(insn);
+              sequence.symbols.push_back(*symbol);
+            }
           }
+          end_run();
         }
         block_deciders->emplace(method, std::move(block_decider));
+        if (!sequence.insns.empty()) {
+          method_sequences.emplace(method, std::move(sequence));
+        }
       });
   size_t singleton_cores{0};
   for (auto& p : concurrent_cores) {
@@ -1273,6 +1335,36 @@ static void get_recurring_cores(
         "[invoke sequence outliner] %zu singleton cores, %zu recurring "
         "cores",
         singleton_cores, recurring_cores->size());
+
+  if (!repeat_lengths) {
+    return;
+  }
+  // Concatenate all sequences, with a distinct symbol for each separator, so
+  // that no repeated sequence spans runs.
+  std::vector<Symbol> text;
+  std::vector<IRInstruction*> text_insns;
+  Symbol next_separator = next_symbol.load();
+  for (auto&& [_, sequence] : method_sequences) {
+    for (auto symbol : sequence.symbols) {
+      text.push_back(symbol == SEPARATOR ? next_separator++ : symbol);
+    }
+    text_insns.insert(text_insns.end(), sequence.insns.begin(),
+                      sequence.insns.end());
+  }
+  auto lengths = get_repeat_lengths(text);
+  size_t bounded_insns{0};
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text_insns[i] != nullptr && lengths[i] < config.max_insns_size) {
+      repeat_lengths->emplace(text_insns[i], lengths[i]);
+      bounded_insns++;
+    }
+  }
+  mgr.incr_metric("num_sequence_symbols", text.size());
+  mgr.incr_metric("num_repeat_bounded_insns", bounded_insns);
+  TRACE(ISO, 2,
+        "[invoke sequence outliner] %zu of %zu instructions start no repeated "
+        "sequence longer than %zu instructions",
+        bounded_insns, text.size(), config.max_insns_size);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1492,6 +1584,7 @@ static void get_beneficial_candidates(
     const Scope& dex,
     const RefChecker& ref_checker,
     const CandidateInstructionCoresSet& recurring_cores,
+    const RepeatLengths* repeat_lengths,
     const InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>&
         block_deciders,
     const ReusableOutlinedMethods* outlined_methods,
@@ -1502,14 +1595,15 @@ static void get_beneficial_candidates(
       concurrent_candidates;
   FindCandidatesStats stats;
   walk::parallel::code(dex, [&config, &ref_checker, &recurring_cores,
-                             &concurrent_candidates, &block_deciders,
+                             repeat_lengths, &concurrent_candidates,
+                             &block_deciders,
                              &stats](DexMethod* method, IRCode& code) {
     if (!can_outline_from_method(method)) {
       return;
     }
     for (auto& p : find_method_candidates(
              config, ref_checker, block_deciders.at_unsafe(method), method,
-             code.cfg(), recurring_cores, &stats)) {
+             code.cfg(), recurring_cores, repeat_lengths, &stats)) {
       std::vector<CandidateMethodLocation>& cmls = p.second;
       concurrent_candidates.update(p.first,
                                    [method, &cmls](const Candidate&,
@@ -3274,19 +3368,28 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
                                  }) == dex.end());
       RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
       CandidateInstructionCoresSet recurring_cores;
+      // A candidate that occurs only once may still be worth outlining when
+      // it can reuse a method outlined from an earlier dex, so repeated
+      // sequences only bound the search when there is nothing to reuse.
+      bool bound_by_repeats = !m_config.reuse_outlined_methods_across_dexes ||
+                              outlined_methods.map.empty();
+      RepeatLengths repeat_lengths;
       InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>
           block_deciders;
       get_recurring_cores(m_config, mgr, dex, throughput_interaction_indices,
                           throughput_methods, sufficiently_warm_methods,
                           sufficiently_hot_methods, ref_checker,
-                          &recurring_cores, &block_deciders);
+                          &recurring_cores,
+                          bound_by_repeats ? &repeat_lengths : nullptr,
+                          &block_deciders);
       std::vector<CandidateWithInfo> candidates_with_infos;
       std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>
           candidate_ids_by_methods;
-      get_beneficial_candidates(m_config, mgr, store, store_dependencies, dex,
-                                ref_checker, recurring_cores, block_deciders,
-                                &outlined_methods, &candidates_with_infos,
-                                &candidate_ids_by_methods);
+      get_beneficial_candidates(
+          m_config, mgr, store, store_dependencies, dex, ref_checker,
+          recurring_cores, bound_by_repeats ? &repeat_lengths : nullptr,
+          block_deciders, &outlined_methods, &candidates_with_infos,
+          &candidate_ids_by_methods);
 
       // TODO: Merge candidates that are equivalent except that one returns
       // something and the other doesn't. Affects around 1.5% of candidates.
@@ -53,9 +53,10 @@ OutlinerTypeAnalysis::OutlinerTypeAnalysis(DexMethod* method)
       }),
       m_type_environments([method]() {
         auto& cfg = method->get_code()->cfg();
-        type_inference::TypeInference type_inference(cfg);
-        type_inference.run(method);
-        return type_inference.get_type_environments();
+        // Shared with the type inference of m_constant_uses, if any.
+        auto type_inference =
+            type_inference::get_shared_type_inference(cfg, method);
+        return type_inference->get_type_environments();
       }),
       m_constant_uses([method]() {
         auto& cfg = method->get_code()->cfg();
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RepeatedSequences.h"
+
+#include <algorithm>
+
+#include "Debug.h"
+
+namespace outliner_impl {
+
+namespace {
+
+// Stable counting sort of `in` by `key(in[i])`, where keys are below
+// `num_keys`.
+template <typename KeyFn>
+void counting_sort(const std::vector<uint32_t>& in,
+                   size_t num_keys,
+                   const KeyFn& key,
+                   std::vector<uint32_t>* out) {
+  std::vector<uint32_t> counts(num_keys + 1, 0);
+  for (auto i : in) {
+    counts[key(i) + 1]++;
+  }
+  for (size_t k = 1; k <= num_keys; k++) {
+    counts[k] += counts[k - 1];
+  }
+  out->resize(in.size());
+  for (auto i : in) {
+    (*out)[counts[key(i)]++] = i;
+  }
+}
+
+} // namespace
+
+std::vector<uint32_t> build_suffix_array(const std::vector<Symbol>& text) {
+  const size_t n = text.size();
+  always_assert(n < UINT32_MAX);
+  std::vector<uint32_t> sa(n);
+  if (n == 0) {
+    return sa;
+  }
+  // Initial ranks are the dense indices of the sorted distinct symbols.
+  std::vector<uint32_t> rank(n);
+  {
+    for (uint32_t i = 0; i < n; i++) {
+      sa[i] = i;
+    }
+    std::sort(sa.begin(), sa.end(), [&text](uint32_t a, uint32_t b) {
+      return text[a] < text[b];
+    });
+    uint32_t r = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (i > 0 && text[sa[i]] != text[sa[i - 1]]) {
+        r++;
+      }
+      rank[sa[i]] = r;
+    }
+    if (r + 1 == n) {
+      return sa;
+    }
+  }
+  // Ranks are shifted by one in the second key, so that 0 can denote a suffix
+  // that ends before the offset.
+  std::vector<uint32_t> tmp;
+  std::vector<uint32_t> new_rank(n);
+  for (size_t offset = 1;; offset *= 2) {
+    auto second_key = [&rank, offset, n](uint32_t i) -> uint32_t {
+      return i + offset < n ? rank[i + offset] + 1 : 0;
+    };
+    counting_sort(sa, n + 1, second_key, &tmp);
+    counting_sort(
+        tmp, n, [&rank](uint32_t i) { return rank[i]; }, &sa);
+    uint32_t r = 0;
+    new_rank[sa[0]] = 0;
+    for (size_t i = 1; i < n; i++) {
+      if (rank[sa[i]] != rank[sa[i - 1]] ||
+          second_key(sa[i]) != second_key(sa[i - 1])) {
+        r++;
+      }
+      new_rank[sa[i]] = r;
+    }
+    rank.swap(new_rank);
+    if (r + 1 == n) {
+      return sa;
+    }
+  }
+}
+
+std::vector<uint32_t> build_lcp_array(const std::vector<Symbol>& text,
+                                      const std::vector<uint32_t>& sa) {
+  const size_t n = text.size();
+  std::vector<uint32_t> rank(n);
+  for (uint32_t i = 0; i < n; i++) {
+    rank[sa[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n, 0);
+  uint32_t h = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    auto j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+  return lcp;
+}
+
+std::vector<uint32_t> get_repeat_lengths(const std::vector<Symbol>& text) {
+  auto sa = build_suffix_array(text);
+  auto lcp = build_lcp_array(text, sa);
+  const size_t n = text.size();
+  std::vector<uint32_t> res(n, 0);
+  for (size_t i = 0; i < n; i++) {
+    // A suffix shares its longest prefix with one of its two neighbours in
+    // the suffix array.
+    res[sa[i]] = std::max(lcp[i], i + 1 < n ? lcp[i + 1] : 0u);
+  }
+  return res;
+}
+
+} // namespace outliner_impl
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace outliner_impl {
+
+using Symbol = uint32_t;
+
+// Suffix array of `text`, i.e. the starting positions of all suffixes of
+// `text` in lexicographic order. Built by prefix doubling, which converges
+// after log2(L) rounds, where L is the length of the longest repeated
+// substring; with many distinct separators in the text, that's far fewer than
+// log2(text.size()) rounds.
+std::vector<uint32_t> build_suffix_array(const std::vector<Symbol>& text);
+
+// Longest common prefix of each suffix in the suffix array with its
+// predecessor, computed in linear time (Kasai et al.); lcp[0] is 0.
+std::vector<uint32_t> build_lcp_array(const std::vector<Symbol>& text,
+                                      const std::vector<uint32_t>& sa);
+
+// For each position of `text`, the length of the longest sequence starting
+// there that also starts at some other position of `text`. Occurrences may
+// overlap.
+std::vector<uint32_t> get_repeat_lengths(const std::vector<Symbol>& text);
+
+} // namespace outliner_impl
@@ -7,6 +7,8 @@
 
 #include "SplittableClosures.h"
 
+#include <map>
+
 #include <sparta/PatriciaTreeSet.h>
 
 #include "ClosureAggregator.h"
@@ -39,6 +41,7 @@ struct ScoredClosure {
   bool is_large_packed_switch{false};
   bool creates_large_sparse_switch{false};
   bool destroys_large_packed_switch{false};
+  double overhead_ratio{};
   std::vector<ClosureArgument> args{};
 
   int is_switch() const { return switch_block ? 1 : 0; }
@@ -110,10 +113,10 @@ bool is_packed(cfg::Block* switch_block,
   return !ckeb->sufficiently_sparse();
 }
 
-std::optional<ScoredClosure> score(
+// Scores the closures without any bound on the overhead ratio.
+std::optional<ScoredClosure> score_unbounded(
     const Config& config,
     const MethodClosures& mcs,
-    float max_overhead_ratio,
     cfg::Block* switch_block,
     bool is_large_packed_switch,
     const std::vector<const Closure*>& closures) {
@@ -205,14 +208,43 @@ std::optional<ScoredClosure> score(
   sc.remaining_size = sc.remaining_size < remaining_size_reduction
                           ? 0
                           : sc.remaining_size - remaining_size_reduction;
-  auto overhead_ratio =
+  sc.overhead_ratio =
       (sc.split_size + sc.remaining_size) * 1.0 / mcs.original_size - 1.0;
-  if (overhead_ratio > max_overhead_ratio) {
-    return std::nullopt;
-  }
   return std::optional<ScoredClosure>(std::move(sc));
 };
 
+// Apart from the final check of the overhead ratio, scoring does not depend on
+// the maximum overhead ratio, which gets relaxed in rounds for large methods.
+// So the scores of a method's closures are computed once, and reused across
+// rounds.
+using ScoreCache =
+    std::map<std::pair<cfg::Block*, std::vector<const Closure*>>,
+             std::optional<ScoredClosure>>;
+
+std::optional<ScoredClosure> score(
+    const Config& config,
+    const MethodClosures& mcs,
+    float max_overhead_ratio,
+    cfg::Block* switch_block,
+    bool is_large_packed_switch,
+    const std::vector<const Closure*>& closures,
+    ScoreCache* cache) {
+  auto key = std::make_pair(switch_block, closures);
+  auto it = cache->find(key);
+  if (it == cache->end()) {
+    it = cache
+             ->emplace(std::move(key),
+                       score_unbounded(config, mcs, switch_block,
+                                       is_large_packed_switch, closures))
+             .first;
+  }
+  const auto& opt_sc = it->second;
+  if (!opt_sc || opt_sc->overhead_ratio > max_overhead_ratio) {
+    return std::nullopt;
+  }
+  return opt_sc;
+}
+
 std::unordered_set<const ReducedBlock*> get_critical_components(
     const std::vector<std::pair<int32_t, const Closure*>>& keyed,
     const Closure* fallthrough) {
@@ -240,10 +272,11 @@ std::optional<ScoredClosure> select_prefix(
     float max_overhead_ratio,
     cfg::Block* switch_block,
     bool is_large_packed_switch,
-    std::vector<const Closure*> aggregated) {
+    std::vector<const Closure*> aggregated,
+    ScoreCache* cache) {
   while (aggregated.size() > 1) {
     auto opt_sc = score(config, mcs, max_overhead_ratio, switch_block,
-                        is_large_packed_switch, aggregated);
+                        is_large_packed_switch, aggregated, cache);
     if (opt_sc) {
       return opt_sc;
     }
@@ -297,7 +330,8 @@ std::optional<ScoredClosure> aggregate(
     cfg::Block* switch_block,
     bool is_large_packed_switch,
     const std::vector<const Closure*>& switched,
-    const std::function<bool(const Closure*)>& predicate) {
+    const std::function<bool(const Closure*)>& predicate,
+    ScoreCache* cache) {
   always_assert(!switched.empty());
   if (switched.size() == 1) {
     return std::nullopt;
@@ -332,7 +366,8 @@ std::optional<ScoredClosure> aggregate(
       auto aggregated =
           aggregate_half_packed(fallthrough, keyed, switched.size());
       return select_prefix(config, mcs, max_overhead_ratio, switch_block,
-                           is_large_packed_switch, std::move(aggregated));
+                           is_large_packed_switch, std::move(aggregated),
+                           cache);
     };
 
     // First, consider suffix. Note that smallest keys are already last.
@@ -356,13 +391,14 @@ std::optional<ScoredClosure> aggregate(
 
   auto aggregated = aggregate_half_sparse(fallthrough, keyed, switched.size());
   return select_prefix(config, mcs, max_overhead_ratio, switch_block,
-                       is_large_packed_switch, std::move(aggregated));
+                       is_large_packed_switch, std::move(aggregated), cache);
 };
 
 // Select closures that meet the configured size thresholds, and score them.
 std::vector<ScoredClosure> get_scored_closures(const Config& config,
                                                const MethodClosures& mcs,
-                                               float max_overhead_ratio) {
+                                               float max_overhead_ratio,
+                                               ScoreCache* cache) {
   // For all possible closures, do some quick filtering, and score the
   // surviving ones
   std::vector<ScoredClosure> scored_closures;
@@ -371,7 +407,7 @@ std::vector<ScoredClosure> get_scored_closures(const Config& config,
   for (auto& c : mcs.closures) {
     auto opt_sc = score(config, mcs, max_overhead_ratio,
                         /* switch_block */ nullptr,
-                        /* is_large_packed_switch */ false, {&c});
+                        /* is_large_packed_switch */ false, {&c}, cache);
     if (opt_sc) {
       scored_closures.push_back(std::move(*opt_sc));
     }
@@ -394,7 +430,8 @@ std::vector<ScoredClosure> get_scored_closures(const Config& config,
         is_large(config, switch_block) && is_packed(switch_block);
     for (const auto& predicate : predicates) {
       auto opt_sc = aggregate(config, mcs, max_overhead_ratio, switch_block,
-                              is_large_packed_switch, switched, predicate);
+                              is_large_packed_switch, switched, predicate,
+                              cache);
       if (opt_sc) {
         scored_closures.push_back(std::move(*opt_sc));
         break;
@@ -630,8 +667,9 @@ select_splittable_closures_based_on_costs(
     auto end = is_huge  ? config.max_huge_overhead_ratio
                : is_hot ? config.max_hot_overhead_ratio
                         : config.max_overhead_ratio;
+    ScoreCache score_cache;
     for (auto r = begin; scored_closures.empty() && r <= end; r *= 2) {
-      scored_closures = get_scored_closures(config, *mcs, r);
+      scored_closures = get_scored_closures(config, *mcs, r, &score_cache);
     }
     if (scored_closures.empty()) {
       return;
@@ -652,7 +690,12 @@ select_splittable_closures_based_on_costs(
                    std::make_move_iterator(splittable_closures.end()));
         });
   };
-  workqueue_run<DexMethod*>(concurrent_process_method, methods);
+  // The closures of huge methods are the most expensive to discover and
+  // score, so they are started first.
+  workqueue_run_by_cost<DexMethod*>(
+      concurrent_process_method, methods, [](DexMethod* method) -> size_t {
+        return method->get_code()->estimate_num_entries();
+      });
   return concurrent_splittable_closures;
 }
 
@@ -279,6 +279,9 @@ void gather_caller_callees(
     MoveAwareChains move_aware_chains(code.cfg());
     const auto use_def_chains = move_aware_chains.get_use_def_chains();
     const auto def_use_chains = move_aware_chains.get_def_use_chains();
+    // Occurrences are counted locally first, so that the shared maps are
+    // only touched once per (caller, callee) pair, not once per invoke.
+    std::unordered_map<DexMethod*, size_t> callees;
     for (auto& big_block : big_blocks::get_big_blocks(code.cfg())) {
       auto can_outline = block_decider.can_outline_from_big_block(big_block) ==
                          CanOutlineBlockDecider::Result::CanOutline;
@@ -299,24 +302,26 @@ void gather_caller_callees(
           excluded_invoke_insns->insert(insn);
           continue;
         }
-        callee_caller->update(
-            callee,
-            [caller](const DexMethod*,
-                     std::unordered_map<DexMethod*, size_t>& v,
-                     bool) { ++v[caller]; });
-        caller_callee->update(
-            caller,
-            [callee](const DexMethod*,
-                     std::unordered_map<DexMethod*, size_t>& v,
-                     bool) { ++v[callee]; });
+        ++callees[callee];
         arg_exclusivity->emplace(insn, std::move(ae));
-        callee_caller_classes->update(
-            callee,
-            [caller](const DexMethod*,
-                     std::unordered_set<const DexType*>& value,
-                     bool) { value.insert(caller->get_class()); });
       }
     }
+    if (callees.empty()) {
+      return;
+    }
+    for (auto [callee, count] : callees) {
+      callee_caller->update(callee,
+                            [caller, count = count](
+                                const DexMethod*,
+                                std::unordered_map<DexMethod*, size_t>& v,
+                                bool) { v[caller] += count; });
+      callee_caller_classes->update(
+          callee,
+          [caller](const DexMethod*,
+                   std::unordered_set<const DexType*>& value,
+                   bool) { value.insert(caller->get_class()); });
+    }
+    caller_callee->emplace(caller, std::move(callees));
   });
 }
 
@@ -848,7 +853,6 @@ void select_invokes_and_callers(
   for (auto& p : callees_by_classes) {
     callee_classes.push_back(p.first);
   }
-  std::mutex mutex;
   workqueue_run<const DexType*>(
       [&](const DexType* callee_class) {
         auto& class_callees = callees_by_classes.at(callee_class);
@@ -900,15 +904,23 @@ void select_invokes_and_callers(
               pa_method_refs->emplace(ccss, pa_method_ref);
             }
           }
-          std::lock_guard<std::mutex> lock_guard(mutex);
-          selected_invokes->insert(callee_selected_invokes.begin(),
-                                   callee_selected_invokes.end());
-          for (auto& p : callee_caller.at_unsafe(callee)) {
-            selected_callers->insert(p.first);
-          }
         }
       },
       callee_classes);
+
+  // Merging the per-callee results at the end avoids serializing the workers
+  // on a shared lock.
+  for (auto callee : callees) {
+    auto& callee_selected_invokes = selected_invokes_by_callees.at(callee);
+    if (callee_selected_invokes.empty()) {
+      continue;
+    }
+    selected_invokes->insert(callee_selected_invokes.begin(),
+                             callee_selected_invokes.end());
+    for (auto& p : callee_caller.at_unsafe(callee)) {
+      selected_callers->insert(p.first);
+    }
+  }
 }
 
 IROpcode get_invoke_opcode(const DexMethod* callee) {
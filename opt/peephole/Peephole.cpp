@@ -8,6 +8,7 @@
 #include "Peephole.h"
 
 #include <algorithm>
+#include <bitset>
 #include <cinttypes>
 #include <cmath>
 #include <iostream>
@@ -1687,11 +1688,25 @@ bool contains(const std::vector<T>& vec, const T& value) {
   return std::find(vec.begin(), vec.end(), value) != vec.end();
 }
 
+constexpr size_t kNumIROpcodes = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+using OpcodeSet = std::bitset<kNumIROpcodes>;
+
 // Each thread will have its own instance of PeepholeOptimizer, so align it in
 // order to avoid false sharing.
 class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
  private:
   std::vector<Matcher> m_matchers;
+  // For each matcher, the opcodes accepted at each position of its pattern. A
+  // pattern can only match in a method that has an instruction for each of
+  // them, which lets us skip most patterns for most methods without scanning
+  // the code again.
+  std::vector<std::vector<OpcodeSet>> m_match_opcodes;
   std::vector<size_t> m_stats;
   PassManager& m_mgr;
   int m_stats_removed = 0;
@@ -1726,6 +1741,25 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
       }
     }
     m_stats.resize(m_matchers.size(), 0);
+    m_match_opcodes.reserve(m_matchers.size());
+    for (const auto& matcher : m_matchers) {
+      auto& match_opcodes = m_match_opcodes.emplace_back();
+      for (const auto& dex_pattern : matcher.pattern.match) {
+        auto& opcodes = match_opcodes.emplace_back();
+        for (auto op : dex_pattern.opcodes) {
+          always_assert(op < kNumIROpcodes);
+          opcodes.set(op);
+        }
+      }
+    }
+  }
+
+  bool may_match(size_t i, const OpcodeSet& present_opcodes) const {
+    return std::all_of(
+        m_match_opcodes[i].begin(), m_match_opcodes[i].end(),
+        [&](const OpcodeSet& opcodes) {
+          return (opcodes & present_opcodes).any();
+        });
   }
 
   PeepholeOptimizer(const PeepholeOptimizer&) = delete;
@@ -1736,9 +1770,17 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     always_assert(code->editable_cfg_built());
     auto& cfg = code->cfg();
 
+    OpcodeSet present_opcodes;
+    for (const auto& mie : cfg::InstructionIterable(cfg)) {
+      present_opcodes.set(mie.insn->opcode());
+    }
+
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
     for (size_t i = 0; i < m_matchers.size(); ++i) {
+      if (!may_match(i, present_opcodes)) {
+        continue;
+      }
       auto& matcher = m_matchers[i];
 
       const auto& blocks = cfg.blocks();
@@ -1775,6 +1817,9 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
             auto replace = matcher.get_replacements();
             for (const auto& r : replace) {
               TRACE(PEEPHOLE, 8, "-- %s", SHOW(r));
+              // Later patterns may match on the replacement. Removed opcodes
+              // are conservatively kept.
+              present_opcodes.set(r->opcode());
             }
             mutator.insert_before(it, replace);
 
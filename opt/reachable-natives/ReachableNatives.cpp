@@ -245,7 +245,7 @@ void ReachableNativesPass::run_pass(DexStoresVector& stores,
   auto reachable_objects = std::make_unique<reachability::ReachableObjects>();
   reachability::ReachableAspects reachable_aspects;
   reachability::ConditionallyMarked cond_marked;
-  auto method_override_graph = method_override_graph::build_graph(scope);
+  auto method_override_graph = method_override_graph::build_graph_cached(scope);
 
   ConcurrentSet<reachability::ReachableObject,
                 reachability::ReachableObjectHash>
@@ -24,7 +24,7 @@ void FastRegAllocPass::run_pass(DexStoresVector& stores,
   TRACE(FREG, 1, "FastRegAllocPass reached!");
   auto scope = build_class_scope(stores);
   walk::parallel::methods(scope, [&](DexMethod* m) {
-    LinearScanAllocator allocator(m);
+    LinearScanAllocator allocator(m, /* satisfy_encoding_constraints */ true);
     allocator.allocate();
   });
   ++m_run;
@@ -7,10 +7,16 @@
 
 #include "RegAlloc.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "Debug.h"
 #include "DexUtil.h"
 #include "GraphColoring.h"
+#include "IRCode.h"
+#include "LinearScan.h"
 #include "PassManager.h"
+#include "Show.h"
 #include "RegisterAllocation.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -19,6 +25,107 @@ namespace regalloc {
 
 using Stats = graph_coloring::Allocator::Stats;
 
+namespace {
+
+struct LinearScanConfig {
+  size_t min_instructions{0};
+  size_t min_registers{0};
+  bool compare_with_coloring{false};
+
+  bool applies_to(const IRCode& code) const {
+    if (min_instructions > 0 && code.cfg().num_opcodes() >= min_instructions) {
+      return true;
+    }
+    return min_registers > 0 &&
+           code.cfg().get_registers_size() >= min_registers;
+  }
+};
+
+struct AllocationStats {
+  Stats coloring;
+  size_t colored_methods{0};
+  size_t coloring_us{0};
+  size_t max_coloring_us{0};
+
+  size_t linear_scan_methods{0};
+  // Methods whose linear scan assignment could not be encoded, and which were
+  // then colored after all.
+  size_t linear_scan_fallbacks{0};
+  size_t linear_scan_registers{0};
+  size_t linear_scan_us{0};
+  size_t max_linear_scan_us{0};
+
+  // Only with compare_with_coloring: the registers that coloring needs for
+  // the methods that were allocated with linear scan.
+  size_t compared_coloring_registers{0};
+
+  AllocationStats& operator+=(const AllocationStats& that) {
+    coloring += that.coloring;
+    colored_methods += that.colored_methods;
+    coloring_us += that.coloring_us;
+    max_coloring_us = std::max(max_coloring_us, that.max_coloring_us);
+    linear_scan_methods += that.linear_scan_methods;
+    linear_scan_fallbacks += that.linear_scan_fallbacks;
+    linear_scan_registers += that.linear_scan_registers;
+    linear_scan_us += that.linear_scan_us;
+    max_linear_scan_us = std::max(max_linear_scan_us, that.max_linear_scan_us);
+    compared_coloring_registers += that.compared_coloring_registers;
+    return *this;
+  }
+};
+
+size_t micros_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+AllocationStats color(const graph_coloring::Allocator::Config& config,
+                      DexMethod* method) {
+  AllocationStats stats;
+  auto start = std::chrono::steady_clock::now();
+  stats.coloring = graph_coloring::allocate(config, method);
+  stats.colored_methods = 1;
+  stats.coloring_us = stats.max_coloring_us = micros_since(start);
+  return stats;
+}
+
+/*
+ * Graph coloring is superlinear in the size of the interference graph, so that
+ * a handful of huge methods can dominate the running time of the pass. Linear
+ * scan is much cheaper but uses more registers. It routes operands that do not
+ * fit their instruction through scratch registers; should its result still
+ * not be encodable, we color its output, which only costs what coloring would
+ * have cost in the first place.
+ */
+AllocationStats linear_scan(const graph_coloring::Allocator::Config& config,
+                            const LinearScanConfig& linear_scan_config,
+                            DexMethod* method) {
+  AllocationStats stats;
+  auto* code = method->get_code();
+  if (linear_scan_config.compare_with_coloring) {
+    IRCode copy(*code);
+    graph_coloring::allocate(config, &copy, is_static(method),
+                             [method]() { return show(method); });
+    stats.compared_coloring_registers = copy.cfg().get_registers_size();
+  }
+  auto start = std::chrono::steady_clock::now();
+  fastregalloc::LinearScanAllocator allocator(
+      method, /* satisfy_encoding_constraints */ true,
+      config.no_overwrite_this);
+  allocator.allocate();
+  stats.linear_scan_methods = 1;
+  stats.linear_scan_us = stats.max_linear_scan_us = micros_since(start);
+  if (!satisfies_encoding_constraints(code->cfg())) {
+    stats.linear_scan_fallbacks = 1;
+    stats += color(config, method);
+  }
+  stats.linear_scan_registers = code->cfg().get_registers_size();
+  return stats;
+}
+
+} // namespace
+
 void RegAllocPass::eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) {
   ++m_eval;
 }
@@ -31,11 +138,24 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   jw.get("live_range_splitting", false, allocator_config.use_splitting);
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
+  LinearScanConfig linear_scan_config;
+  jw.get("linear_scan_min_instructions", size_t(0),
+         linear_scan_config.min_instructions);
+  jw.get("linear_scan_min_registers", size_t(0),
+         linear_scan_config.min_registers);
+  jw.get("linear_scan_compare_with_coloring", false,
+         linear_scan_config.compare_with_coloring);
 
   auto scope = build_class_scope(stores);
-  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
-    return graph_coloring::allocate(allocator_config, m);
-  });
+  auto allocation_stats = walk::parallel::methods_by_cost<AllocationStats>(
+      scope, [&](DexMethod* m) {
+        auto* code = m->get_code();
+        if (code != nullptr && linear_scan_config.applies_to(*code)) {
+          return linear_scan(allocator_config, linear_scan_config, m);
+        }
+        return color(allocator_config, m);
+      });
+  const auto& stats = allocation_stats.coloring;
 
   TRACE(REG, 1, "Total reiteration count: %zu", stats.reiteration_count);
   TRACE(REG, 1, "Total Params spilled early: %zu", stats.params_spill_early);
@@ -53,6 +173,31 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
 
+  TRACE(REG, 1, "Colored %zu methods in %zu us (max %zu us)",
+        allocation_stats.colored_methods, allocation_stats.coloring_us,
+        allocation_stats.max_coloring_us);
+  TRACE(REG, 1,
+        "Linear scan for %zu methods in %zu us (max %zu us), %zu fallbacks, "
+        "%zu registers",
+        allocation_stats.linear_scan_methods, allocation_stats.linear_scan_us,
+        allocation_stats.max_linear_scan_us,
+        allocation_stats.linear_scan_fallbacks,
+        allocation_stats.linear_scan_registers);
+  mgr.incr_metric("colored_methods", allocation_stats.colored_methods);
+  mgr.incr_metric("coloring_us", allocation_stats.coloring_us);
+  mgr.incr_metric("max_coloring_us", allocation_stats.max_coloring_us);
+  mgr.incr_metric("linear_scan_methods", allocation_stats.linear_scan_methods);
+  mgr.incr_metric("linear_scan_fallbacks",
+                  allocation_stats.linear_scan_fallbacks);
+  mgr.incr_metric("linear_scan_registers",
+                  allocation_stats.linear_scan_registers);
+  mgr.incr_metric("linear_scan_us", allocation_stats.linear_scan_us);
+  mgr.incr_metric("max_linear_scan_us", allocation_stats.max_linear_scan_us);
+  if (linear_scan_config.compare_with_coloring) {
+    mgr.incr_metric("linear_scan_compared_coloring_registers",
+                    allocation_stats.compared_coloring_registers);
+  }
+
   ++m_run;
   // For the last invocation, record that final register allocation has been
   // done.
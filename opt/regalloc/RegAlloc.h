@@ -35,6 +35,17 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    size_t unused_size;
+    bind("linear_scan_min_instructions", 0, unused_size,
+         "Methods with at least this many instructions are allocated with the "
+         "linear scan allocator instead of graph coloring. 0 disables this.");
+    bind("linear_scan_min_registers", 0, unused_size,
+         "Methods with at least this many virtual registers are allocated "
+         "with the linear scan allocator instead of graph coloring. 0 disables "
+         "this.");
+    bind("linear_scan_compare_with_coloring", false, unused,
+         "Also color a copy of each method allocated with linear scan, to "
+         "measure how many registers linear scan costs.");
     trait(Traits::Pass::atleast, 1);
   }
 
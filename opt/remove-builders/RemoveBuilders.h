@@ -7,8 +7,14 @@
 
 #pragma once
 
+#include <vector>
+
 #include "Pass.h"
 
+namespace cfg {
+class Block;
+} // namespace cfg
+
 class RemoveBuildersPass : public Pass {
  public:
   RemoveBuildersPass() : Pass("RemoveBuildersPass") {}
@@ -34,5 +40,7 @@ class RemoveBuildersPass : public Pass {
   bool m_enable_buildee_constr_change;
 
   std::vector<DexType*> created_builders(DexMethod*);
-  bool escapes_stack(DexType*, DexMethod*);
+  bool escapes_stack(DexType*,
+                     DexMethod*,
+                     const std::vector<cfg::Block*>& blocks);
 };
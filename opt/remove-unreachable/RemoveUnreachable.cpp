@@ -26,6 +26,8 @@
 bool RemoveUnreachablePassBase::s_emit_graph_on_last_run{false};
 size_t RemoveUnreachablePassBase::s_all_reachability_runs{0};
 size_t RemoveUnreachablePassBase::s_all_reachability_run{0};
+std::unique_ptr<reachability::MethodReferencesCache>
+    RemoveUnreachablePassBase::s_method_references_cache;
 
 namespace {
 const std::string UNREACHABLE_SYMBOLS_FILENAME =
@@ -214,6 +216,11 @@ void RemoveUnreachablePassBase::bind_config() {
        m_prune_uncallable_virtual_methods);
   bind("prune_unreferenced_interfaces", false, m_prune_unreferenced_interfaces);
   bind("throw_propagation", false, m_throw_propagation);
+  // Reuse the references gathered from unchanged methods in earlier runs. This
+  // has no effect together with prune_uninstantiable_insns,
+  // prune_uncallable_instance_method_bodies, throw_propagation or
+  // relaxed_keep_class_members.
+  bind("incremental", false, m_incremental);
   after_configuration([emit_on_last]() {
     if (emit_on_last) {
       s_emit_graph_on_last_run = true;
@@ -389,7 +396,7 @@ std::unique_ptr<reachability::ReachableObjects>
 RemoveUnreachablePass::compute_reachable_objects(
     const Scope& scope,
     const method_override_graph::Graph& method_override_graph,
-    PassManager& /* pm */,
+    PassManager& pm,
     int* num_ignore_check_strings,
     reachability::ReachableAspects* reachable_aspects,
     bool emit_graph_this_run,
@@ -399,12 +406,29 @@ RemoveUnreachablePass::compute_reachable_objects(
     bool cfg_gathering_check_instance_callable,
     bool cfg_gathering_check_returning,
     bool remove_no_argument_constructors) {
-  return reachability::compute_reachable_objects(
+  if (m_incremental && !s_method_references_cache) {
+    s_method_references_cache =
+        std::make_unique<reachability::MethodReferencesCache>();
+  }
+  auto* cache = m_incremental ? s_method_references_cache.get() : nullptr;
+  size_t hits_before = cache ? cache->hits() : 0;
+  size_t misses_before = cache ? cache->misses() : 0;
+  auto reachable_objects = reachability::compute_reachable_objects(
       scope, method_override_graph, m_ignore_sets, num_ignore_check_strings,
       reachable_aspects, emit_graph_this_run, relaxed_keep_class_members,
       relaxed_keep_interfaces, cfg_gathering_check_instantiable,
       cfg_gathering_check_instance_callable, cfg_gathering_check_returning,
-      false, remove_no_argument_constructors);
+      false, remove_no_argument_constructors, cache);
+  if (cache) {
+    pm.set_metric("method_references_cache_hits",
+                  cache->hits() - hits_before);
+    pm.set_metric("method_references_cache_misses",
+                  cache->misses() - misses_before);
+  }
+  if (s_all_reachability_run == s_all_reachability_runs) {
+    s_method_references_cache.reset();
+  }
+  return reachable_objects;
 }
 
 static RemoveUnreachablePass s_pass;
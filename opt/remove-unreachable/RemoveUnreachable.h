@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <optional>
 
 #include "Pass.h"
@@ -73,10 +74,14 @@ class RemoveUnreachablePassBase : public Pass {
   bool m_prune_uncallable_virtual_methods = false;
   bool m_prune_unreferenced_interfaces = false;
   bool m_throw_propagation = false;
+  bool m_incremental = false;
 
   static bool s_emit_graph_on_last_run;
   static size_t s_all_reachability_runs;
   static size_t s_all_reachability_run;
+  // Shared by all runs, as each method's dirty bit can only track one cache.
+  static std::unique_ptr<reachability::MethodReferencesCache>
+      s_method_references_cache;
 };
 
 class RemoveUnreachablePass : public RemoveUnreachablePassBase {
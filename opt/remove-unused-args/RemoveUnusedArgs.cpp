@@ -7,8 +7,10 @@
 
 #include "RemoveUnusedArgs.h"
 
+#include <algorithm>
 #include <deque>
 #include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -562,15 +564,6 @@ void RemoveArgs::gather_updated_entries(
   using MethodAndMethodSet =
       std::pair<const DexMethod* const, std::unordered_set<const DexMethod*>>;
 
-  InsertOnlyConcurrentMap<const DexMethod*,
-                          std::map<uint16_t, cfg::InstructionIterator>>
-      all_dead_insns;
-
-  // Fill in preliminary dead instruction data for methods.
-  walk::parallel::code(m_scope, [&](DexMethod* method, IRCode& code) {
-    all_dead_insns.emplace(method, compute_dead_insns(method, code));
-  });
-
   auto kvp_workqueue = workqueue_foreach<const MethodAndMethodSet*>(
       [&](const MethodAndMethodSet* kvp) {
         bool remove_result = true;
@@ -597,6 +590,32 @@ void RemoveArgs::gather_updated_entries(
           remove_result &= compute_remove_result(m);
         }
 
+        auto reordered_it = m_reordered_protos.find(kvp->first->get_proto());
+        auto is_affected = [&](const DexMethod* m) {
+          return m_affected_methods->count(m) != 0;
+        };
+        if (m_affected_methods && reordered_it == m_reordered_protos.end() &&
+            !method::is_constructor(kvp->first) &&
+            std::none_of(kvp->second.begin(), kvp->second.end(),
+                         is_affected)) {
+          // Nothing that this group depends on changed in the previous run,
+          // and constructors may no longer collide with renamed methods.
+          return;
+        }
+
+        // Compute the dead instruction data of the methods of the group.
+        std::unordered_map<const DexMethod*,
+                           std::map<uint16_t, cfg::InstructionIterator>>
+            all_dead_insns;
+        for (auto m : kvp->second) {
+          auto* code = const_cast<DexMethod*>(m)->get_code();
+          if (code != nullptr) {
+            always_assert(code->editable_cfg_built());
+            code->cfg().calculate_exit_block();
+            all_dead_insns.emplace(m, compute_dead_insns(m, *code));
+          }
+        }
+
         // Second iteration, at this point we have all the dead args for the
         // related group. We need to iterate over the methods again and take the
         // intersection of the dead args
@@ -621,7 +640,7 @@ void RemoveArgs::gather_updated_entries(
         // `running_dead_args`.
         for (auto m : kvp->second) {
           if (m->get_code()) {
-            auto& dead_insn_map = all_dead_insns.at_unsafe(m);
+            auto& dead_insn_map = all_dead_insns.at(m);
             std20::erase_if(dead_insn_map, [&](auto e) {
               return !running_dead_args.count(e.first);
             });
@@ -634,7 +653,6 @@ void RemoveArgs::gather_updated_entries(
         bool is_reordered;
         DexProto* updated_proto;
         std::deque<uint16_t> live_arg_idxs;
-        auto reordered_it = m_reordered_protos.find(kvp->first->get_proto());
         if (reordered_it != m_reordered_protos.end()) {
           is_reordered = true;
           live_arg_idxs = live_args(kvp->first, {});
@@ -704,17 +722,7 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
     const mog::Graph& override_graph,
     const std::unordered_set<DexType*>& no_devirtualize_annos) {
 
-  // Phase 1: Calculate exit blocks for all methods
-  walk::parallel::methods(m_scope, [&](DexMethod* method) {
-    auto code = method->get_code();
-    if (code != nullptr) {
-      always_assert(code->editable_cfg_built());
-      auto& cfg = code->cfg();
-      cfg.calculate_exit_block();
-    }
-  });
-
-  // Phase 2: Removing args for virtual methods is slightly more complex
+  // Phase 1: Removing args for virtual methods is slightly more complex
   // because we need to make sure that the args are unused across all
   // implementations of the method. In order to do this, we need to partition
   // the methods into related groups. A related group is a group of methods
@@ -722,7 +730,8 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
   // assign a single representative method as an identifier for the graph.
   populate_representative_ids(override_graph, no_devirtualize_annos);
 
-  // Phase 3: Find all methods that we can potentially update
+  // Phase 2: Find all methods that we can potentially update. This computes
+  // the exit blocks that the liveness analysis needs.
   InsertOnlyConcurrentMap<DexMethod*, Entry> unordered_entries;
   gather_updated_entries(no_devirtualize_annos, &unordered_entries);
 
@@ -762,7 +771,7 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
   }
   sort_unique(classes);
 
-  // Phase 4: Update body of updated methods (in parallel)
+  // Phase 3: Update body of updated methods (in parallel)
 
   std::mutex local_dce_stats_mutex;
   auto& local_dce_stats = method_stats.local_dce_stats;
@@ -770,6 +779,7 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
     for (auto& p : class_entries.at(cls)) {
       DexMethod* method = p.first;
       const Entry& entry = p.second;
+      m_changed_methods.insert(method);
 
       if (!entry.is_reordered) {
         if (!entry.dead_insns.empty()) {
@@ -874,6 +884,7 @@ std::pair<size_t, LocalDce::Stats> RemoveArgs::update_callsites() {
         }
 
         if (callsite_args_removed) {
+          m_changed_methods.insert(method);
           run_cleanup(method,
                       cfg,
                       &m_init_classes_with_side_effects,
@@ -887,6 +898,30 @@ std::pair<size_t, LocalDce::Stats> RemoveArgs::update_callsites() {
   return std::make_pair(cnt, local_dce_stats);
 }
 
+std::unordered_set<const DexMethod*> RemoveArgs::get_affected_methods()
+    const {
+  std::unordered_set<const DexMethod*> affected;
+  for (auto* method : m_changed_methods) {
+    affected.insert(method);
+    auto* code = const_cast<DexMethod*>(method)->get_code();
+    if (code == nullptr) {
+      continue;
+    }
+    for (const auto& mie : InstructionIterable(code->cfg())) {
+      auto insn = mie.insn;
+      if (!opcode::is_an_invoke(insn->opcode())) {
+        continue;
+      }
+      auto callee =
+          resolve_method(insn->get_method(), opcode_to_search(insn->opcode()));
+      if (callee) {
+        affected.insert(callee);
+      }
+    }
+  }
+  return affected;
+}
+
 void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
                                     ConfigFiles& conf,
                                     PassManager& mgr) {
@@ -902,14 +937,19 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   size_t num_iterations = 0;
   LocalDce::Stats local_dce_stats;
   auto pure_methods = get_pure_methods();
+  // After the first iteration, only the methods affected by the changes of
+  // the previous iteration need to be considered again.
+  std::optional<std::unordered_set<const DexMethod*>> affected_methods;
   while (true) {
     num_iterations++;
     RemoveArgs rm_args(scope, init_classes_with_side_effects, m_blocklist,
-                       pure_methods, m_total_iterations++);
+                       pure_methods, m_total_iterations++,
+                       affected_methods ? &*affected_methods : nullptr);
     auto pass_stats = rm_args.run(conf);
     if (pass_stats.methods_updated_count == 0) {
       break;
     }
+    affected_methods = rm_args.get_affected_methods();
     num_callsite_args_removed += pass_stats.callsite_args_removed_count;
     num_method_params_removed += pass_stats.method_params_removed_count;
     num_methods_updated += pass_stats.methods_updated_count;
@@ -46,14 +46,25 @@ class RemoveArgs {
                  init_classes_with_side_effects,
              const std::vector<std::string>& blocklist,
              const std::unordered_set<DexMethodRef*>& pure_methods,
-             size_t iteration = 0)
+             size_t iteration = 0,
+             const std::unordered_set<const DexMethod*>* affected_methods =
+                 nullptr)
       : m_scope(scope),
         m_init_classes_with_side_effects(init_classes_with_side_effects),
         m_blocklist(blocklist),
         m_iteration(iteration),
-        m_pure_methods(pure_methods) {}
+        m_pure_methods(pure_methods),
+        m_affected_methods(affected_methods) {}
   RemoveArgs::PassStats run(ConfigFiles& conf);
 
+  /*
+   * The methods that a following run needs to consider after this run: the
+   * methods whose signature or code changed, and the methods they call, whose
+   * results may have become unused. Related methods, constructors, and
+   * methods with reordered protos are considered anyway.
+   */
+  std::unordered_set<const DexMethod*> get_affected_methods() const;
+
  private:
   const Scope& m_scope;
   InsertOnlyConcurrentMap<const DexMethod*, const DexMethod*>
@@ -80,6 +91,10 @@ class RemoveArgs {
   const std::vector<std::string>& m_blocklist;
   size_t m_iteration;
   const std::unordered_set<DexMethodRef*>& m_pure_methods;
+  // When set, groups of related methods without any affected method are
+  // skipped, as they cannot have changed since the previous run.
+  const std::unordered_set<const DexMethod*>* m_affected_methods;
+  InsertOnlyConcurrentSet<const DexMethod*> m_changed_methods;
 
   DexTypeList::ContainerType get_live_arg_type_list(
       const DexMethod* method, const std::deque<uint16_t>& live_arg_idxs);
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/regex.hpp>
+#include <fstream>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -25,11 +26,13 @@
 #include "ProguardConfiguration.h"
 #include "ProguardMap.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "RedexResources.h"
 #include "Show.h"
 #include "TypeStringRewriter.h"
 #include "Walkers.h"
 #include "Warning.h"
+#include "WorkQueue.h"
 
 #include "Trace.h"
 #include <locator.h>
@@ -40,6 +43,7 @@ using facebook::Locator;
 static const char* METRIC_AVOIDED_COLLISIONS = "num_avoided_collisions";
 static const char* METRIC_SKIPPED_INDICES = "num_skipped_indices";
 static const char* METRIC_DIGITS = "num_digits";
+static const char* METRIC_CLASS_INDEX_TABLE_BYTES = "class_index_table_bytes";
 static const char* METRIC_CLASSES_IN_SCOPE = "num_classes_in_scope";
 static const char* METRIC_RENAMED_CLASSES = "**num_renamed**";
 static const char* METRIC_FORCE_RENAMED_CLASSES = "num_force_renamed";
@@ -958,17 +962,20 @@ void RenameClassesPassV2::rename_classes(
     const rewriter::TypeStringMap& name_mapping,
     PassManager& mgr) {
   const auto& class_map = name_mapping.get_class_map();
-  for (auto* clazz : scope) {
-    auto* dtype = clazz->get_type();
+  // Collect the renames of all classes and their array types in parallel, and
+  // apply them at once.
+  std::vector<std::vector<std::pair<DexType*, const DexString*>>>
+      class_renames(scope.size());
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    auto* dtype = scope[i]->get_type();
     const auto* oldname = dtype->get_name();
     auto it = class_map.find(oldname);
     if (it == class_map.end()) {
-      continue;
+      return;
     }
     const auto* dstring = it->second;
-    dtype->set_name(dstring);
-    m_base_strings_size += oldname->size();
-    m_ren_strings_size += dstring->size();
+    auto& renames = class_renames[i];
+    renames.emplace_back(dtype, dstring);
 
     while (1) {
       std::string arrayop("[");
@@ -984,9 +991,20 @@ void RenameClassesPassV2::rename_classes(
       std::string newarraytype("[");
       newarraytype += dstring->str();
       dstring = DexString::make_string(newarraytype);
-      arraytype->set_name(dstring);
+      renames.emplace_back(arraytype, dstring);
+    }
+  });
+  std::vector<std::pair<DexType*, const DexString*>> renames;
+  for (auto& class_rename : class_renames) {
+    if (class_rename.empty()) {
+      continue;
     }
+    auto [dtype, dstring] = class_rename.front();
+    m_base_strings_size += dtype->get_name()->size();
+    m_ren_strings_size += dstring->size();
+    renames.insert(renames.end(), class_rename.begin(), class_rename.end());
   }
+  g_redex->set_type_names(renames);
   /* Now rewrite all const-string strings for force renamed classes. */
   rewriter::TypeStringMap force_rename_map;
   for (const auto& pair : name_mapping.get_class_map()) {
@@ -1047,6 +1065,37 @@ std::string RenameClassesPassV2::prepend_package_prefix(
   return ss.str();
 }
 
+/*
+ * The global class index of a class is its position across the dexes of all
+ * stores, which is also what get_name_mapping encodes into the new names.
+ * The tables cover all classes, so that the classloader can find classes
+ * which kept their name with a single probe as well.
+ */
+void RenameClassesPassV2::emit_class_index_tables(
+    const DexStoresVector& stores, ConfigFiles& conf, PassManager& mgr) {
+  uint32_t global_class_index = 0;
+  size_t table_bytes = 0;
+  for (auto& store : stores) {
+    std::vector<std::pair<std::string, uint32_t>> classes;
+    for (auto& dex : store.get_dexen()) {
+      for (auto* cls : dex) {
+        classes.emplace_back(cls->get_name()->str_copy(),
+                             global_class_index++);
+      }
+    }
+    auto table = Locator::makeClassIndexTable(classes);
+    auto file_name =
+        conf.metafile("redex-class-index-" + store.get_name() + ".bin");
+    std::ofstream ofs(file_name, std::ios::binary);
+    always_assert_log(ofs, "Could not open %s", file_name.c_str());
+    ofs.write(reinterpret_cast<const char*>(table.data()), table.size());
+    table_bytes += table.size();
+    TRACE(RENAME, 1, "Wrote class index table for %zu classes of store %s",
+          classes.size(), store.get_name().c_str());
+  }
+  mgr.incr_metric(METRIC_CLASS_INDEX_TABLE_BYTES, table_bytes);
+}
+
 std::unordered_set<DexClass*> RenameClassesPassV2::get_renamable_classes(
     Scope& scope, ConfigFiles& conf, PassManager& mgr) {
   ClassHierarchy class_hierarchy = build_type_hierarchy(scope);
@@ -1081,6 +1130,11 @@ void RenameClassesPassV2::run_pass(DexStoresVector& stores,
 
   auto avoid_type_lookup_table_collisions =
       m_avoid_type_lookup_table_collisions;
+  always_assert_log(
+      !m_emit_class_index_tables || !avoid_type_lookup_table_collisions,
+      "emit_class_index_tables requires the global class indices of renamed "
+      "classes to be their positions, which "
+      "avoid_type_lookup_table_collisions does not preserve");
 
   size_t avoided_collisions = 0;
   size_t skipped_indices = 0;
@@ -1108,6 +1162,10 @@ void RenameClassesPassV2::run_pass(DexStoresVector& stores,
 
   rename_classes(scope, name_mapping, mgr);
 
+  if (m_emit_class_index_tables) {
+    emit_class_index_tables(stores, conf, mgr);
+  }
+
   mgr.incr_metric(METRIC_DIGITS, digits);
 
   TRACE(RENAME, 1, "String savings, at least %d-%d = %d bytes ",
@@ -87,6 +87,9 @@ class RenameClassesPassV2 : public Pass {
     bind("package_prefix", "", m_package_prefix);
     bind("avoid_type_lookup_table_collisions", false,
          m_avoid_type_lookup_table_collisions);
+    bind("emit_class_index_tables", false, m_emit_class_index_tables,
+         "Write a table per store that maps class descriptors to global class "
+         "indices, for the classloader to look classes up with.");
     trait(Traits::Pass::unique, true);
   }
 
@@ -170,6 +173,10 @@ class RenameClassesPassV2 : public Pass {
 
   std::string prepend_package_prefix(const char* descriptor);
 
+  void emit_class_index_tables(const DexStoresVector& stores,
+                               ConfigFiles& conf,
+                               PassManager& mgr);
+
   int m_base_strings_size = 0;
   int m_ren_strings_size = 0;
 
@@ -193,4 +200,5 @@ class RenameClassesPassV2 : public Pass {
   std::string m_apk_dir;
 
   bool m_avoid_type_lookup_table_collisions = false;
+  bool m_emit_class_index_tables = false;
 };
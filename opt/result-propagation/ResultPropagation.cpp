@@ -21,6 +21,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 
@@ -84,10 +85,12 @@ class Analyzer final : public BaseIRAnalyzer<ParamDomainEnvironment> {
   Analyzer(const cfg::ControlFlowGraph& cfg,
            const ReturnParamResolver& resolver,
            const std::unordered_map<const DexMethod*, ParamIndex>&
-               methods_which_return_parameter)
+               methods_which_return_parameter,
+           std::unordered_set<const DexMethod*>* missing_methods)
       : BaseIRAnalyzer(cfg),
         m_resolver(resolver),
         m_methods_which_return_parameter(methods_which_return_parameter),
+        m_missing_methods(missing_methods),
         m_load_param_map(get_load_param_map(cfg)) {
     MonotonicFixpointIterator::run(ParamDomainEnvironment::top());
   }
@@ -203,7 +206,8 @@ class Analyzer final : public BaseIRAnalyzer<ParamDomainEnvironment> {
       // beforehand if the result of this invoke instruction can ever flow
       // to a return instruction; if not, skip this
       const auto param_index = m_resolver.get_return_param_index(
-          insn, m_methods_which_return_parameter, m_resolved_refs);
+          insn, m_methods_which_return_parameter, m_resolved_refs,
+          m_missing_methods);
       if (!param_index) {
         default_case();
         break;
@@ -226,6 +230,7 @@ class Analyzer final : public BaseIRAnalyzer<ParamDomainEnvironment> {
   const ReturnParamResolver& m_resolver;
   const std::unordered_map<const DexMethod*, ParamIndex>&
       m_methods_which_return_parameter;
+  std::unordered_set<const DexMethod*>* m_missing_methods;
   const std::unordered_map<const IRInstruction*, ParamIndex> m_load_param_map;
   mutable MethodRefCache m_resolved_refs;
 };
@@ -237,7 +242,8 @@ boost::optional<ParamIndex> ReturnParamResolver::get_return_param_index(
     const IRInstruction* insn,
     const std::unordered_map<const DexMethod*, ParamIndex>&
         methods_which_return_parameter,
-    MethodRefCache& resolved_refs) const {
+    MethodRefCache& resolved_refs,
+    std::unordered_set<const DexMethod*>* missing_methods) const {
   always_assert(opcode::is_an_invoke(insn->opcode()));
   const auto method = insn->get_method();
   const auto proto = method->get_proto();
@@ -263,6 +269,9 @@ boost::optional<ParamIndex> ReturnParamResolver::get_return_param_index(
   } else {
     const auto& mwrpit = methods_which_return_parameter.find(callee);
     if (mwrpit == methods_which_return_parameter.end()) {
+      if (missing_methods != nullptr) {
+        missing_methods->insert(callee);
+      }
       return boost::none;
     }
     param = ParamDomain(mwrpit->second);
@@ -295,6 +304,9 @@ boost::optional<ParamIndex> ReturnParamResolver::get_return_param_index(
       }
       const auto& mwrpit = methods_which_return_parameter.find(overriding);
       if (mwrpit == methods_which_return_parameter.end()) {
+        if (missing_methods != nullptr) {
+          missing_methods->insert(overriding);
+        }
         return boost::none;
       }
       param.join_with(ParamDomain(mwrpit->second));
@@ -407,8 +419,10 @@ bool ReturnParamResolver::returns_receiver(const DexMethodRef* method) const {
 boost::optional<ParamIndex> ReturnParamResolver::get_return_param_index(
     const cfg::ControlFlowGraph& cfg,
     const std::unordered_map<const DexMethod*, ParamIndex>&
-        methods_which_return_parameter) const {
-  Analyzer analyzer(cfg, *this, methods_which_return_parameter);
+        methods_which_return_parameter,
+    std::unordered_set<const DexMethod*>* missing_methods) const {
+  Analyzer analyzer(cfg, *this, methods_which_return_parameter,
+                    missing_methods);
   auto return_param_index = ParamDomain::bottom();
   // join together return values of all blocks which end with a
   // return instruction
@@ -499,11 +513,17 @@ void ResultPropagation::patch(PassManager& mgr, cfg::ControlFlowGraph& cfg) {
   }
 }
 
+void ResultPropagationPass::set_analysis_usage(AnalysisUsage& au) const {
+  au.add_preserve_specific<method_override_graph::Graph>();
+}
+
 void ResultPropagationPass::run_pass(DexStoresVector& stores,
                                      ConfigFiles& /* conf */,
                                      PassManager& mgr) {
   const auto scope = build_class_scope(stores);
-  const auto method_override_graph = method_override_graph::build_graph(scope);
+  const auto method_override_graph =
+      mgr.get_cached_analysis<method_override_graph::Graph>(
+          [&]() { return method_override_graph::build_graph_cached(scope); });
   ReturnParamResolver resolver(*method_override_graph);
   const auto methods_which_return_parameter =
       find_methods_which_return_parameter(mgr, scope, resolver);
@@ -536,61 +556,70 @@ void ResultPropagationPass::run_pass(DexStoresVector& stores,
         stats.patched_move_results, stats.unverifiable_move_results);
 }
 
-using ParamIndexMap = std::unordered_map<const DexMethod*, ParamIndex>;
-
 std::unordered_map<const DexMethod*, ParamIndex>
 ResultPropagationPass::find_methods_which_return_parameter(
     PassManager& mgr, const Scope& scope, const ReturnParamResolver& resolver) {
   std::unordered_map<const DexMethod*, ParamIndex>
       methods_which_return_parameter;
-  // We iterate a few times to capture chains of method calls that all
-  // eventually return `this`.
+  // Summaries only ever get added. An analysis that did not find a return
+  // parameter can only come to a different conclusion once one of the
+  // callees it gave up on got a summary, so that is when it gets redone.
+  std::unordered_map<const DexMethod*, std::vector<DexMethod*>> dependents;
+  std::vector<DexMethod*> worklist;
+  walk::methods(scope, [&](DexMethod* method) {
+    // void methods cannot return a parameter, skip expensive analysis
+    if (method->get_code() != nullptr && !method->get_proto()->is_void()) {
+      worklist.push_back(method);
+    }
+  });
+
+  struct Result {
+    boost::optional<ParamIndex> return_param_index;
+    std::unordered_set<const DexMethod*> missing_methods;
+  };
   // TODO(perf): Add flag to limit number of iterations
-  // TODO(perf): For each analyzed method, keep track of the reasons (a set of
-  // methods) why the call resolution gave up, and use that "dependency"
-  // information to limit what needs to be processed in subsequent iterations
-  while (true) {
+  while (!worklist.empty()) {
     mgr.incr_metric(METRIC_METHODS_WHICH_RETURN_PARAMETER_ITERATIONS, 1);
-    const auto next_methods_which_return_parameter =
-        walk::parallel::methods<ParamIndexMap, MergeContainers<ParamIndexMap>>(
-            scope, [&](DexMethod* method) {
-              std::unordered_map<const DexMethod*, ParamIndex> res;
-
-              const auto* code = method->get_code();
-              if (code == nullptr) {
-                return res;
-              }
-              const auto* proto = method->get_proto();
-              if (proto->is_void()) {
-                // void methods cannot return a parameter, skip expensive
-                // analysis
-                return res;
-              }
-
-              const auto mwrpit = methods_which_return_parameter.find(method);
-              if (mwrpit != methods_which_return_parameter.end()) {
-                // Short-circuit re-computing for perf
-                res.insert({method, mwrpit->second});
-                return res;
-              }
-
-              always_assert(code->editable_cfg_built());
-              auto& cfg = code->cfg();
-              const auto return_param_index = resolver.get_return_param_index(
-                  cfg, methods_which_return_parameter);
-              if (return_param_index) {
-                res.insert({method, *return_param_index});
-              }
-
-              return res;
-            });
-
-    if (next_methods_which_return_parameter.size() ==
-        methods_which_return_parameter.size()) {
-      return methods_which_return_parameter;
+    std::vector<Result> results(worklist.size());
+    workqueue_run_for<size_t>(0, worklist.size(), [&](size_t i) {
+      auto* code = worklist[i]->get_code();
+      always_assert(code->editable_cfg_built());
+      auto& result = results[i];
+      result.return_param_index = resolver.get_return_param_index(
+          code->cfg(), methods_which_return_parameter,
+          &result.missing_methods);
+    });
+
+    std::vector<const DexMethod*> found;
+    for (size_t i = 0; i < worklist.size(); i++) {
+      auto& result = results[i];
+      if (result.return_param_index) {
+        found.push_back(worklist[i]);
+        methods_which_return_parameter.emplace(worklist[i],
+                                               *result.return_param_index);
+        continue;
+      }
+      for (auto* missing : result.missing_methods) {
+        dependents[missing].push_back(worklist[i]);
+      }
+    }
+
+    std::unordered_set<DexMethod*> next;
+    for (auto* method : found) {
+      auto it = dependents.find(method);
+      if (it == dependents.end()) {
+        continue;
+      }
+      for (auto* dependent : it->second) {
+        if (!methods_which_return_parameter.count(dependent)) {
+          next.insert(dependent);
+        }
+      }
+      dependents.erase(it);
     }
-    methods_which_return_parameter = next_methods_which_return_parameter;
+    worklist.assign(next.begin(), next.end());
   }
+  return methods_which_return_parameter;
 }
 
 static ResultPropagationPass s_pass;
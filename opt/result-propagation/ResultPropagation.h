@@ -42,21 +42,30 @@ class ReturnParamResolver {
   /*
    * For an invocation given by an instruction, figure out whether
    * it will always return one of its incoming sources.
+   *
+   * If given, the methods without a known return parameter that made the
+   * resolution give up are added to missing_methods.
    */
   boost::optional<ParamIndex> get_return_param_index(
       const IRInstruction* insn,
       const std::unordered_map<const DexMethod*, ParamIndex>&
           methods_which_return_parameter,
-      MethodRefCache& resolved_refs) const;
+      MethodRefCache& resolved_refs,
+      std::unordered_set<const DexMethod*>* missing_methods = nullptr) const;
 
   /*
    * For a method given by its cfg, figure out whether all regular return
    * instructions would return a particular incoming parameter.
+   *
+   * If given, the callees without a known return parameter that the result
+   * depends on are added to missing_methods. The result can only change once
+   * one of them becomes known.
    */
   boost::optional<ParamIndex> get_return_param_index(
       const cfg::ControlFlowGraph& cfg,
       const std::unordered_map<const DexMethod*, ParamIndex>&
-          methods_which_return_parameter) const;
+          methods_which_return_parameter,
+      std::unordered_set<const DexMethod*>* missing_methods = nullptr) const;
 
  private:
   bool returns_receiver(const DexMethodRef* method) const;
@@ -143,6 +152,9 @@ class ResultPropagationPass : public Pass {
     };
   }
 
+  // Only code is changed, so the method override graph is preserved.
+  void set_analysis_usage(AnalysisUsage& au) const override;
+
   void bind_config() override {
     bind("callee_blocklist",
          {},
@@ -155,9 +167,10 @@ class ResultPropagationPass : public Pass {
  private:
   std::unordered_set<DexMethod*> m_callee_blocklist;
   /*
-   * Via a fixed point computation that repeatedly inspects all methods,
-   * figure out all methods which return an incoming parameter, taking into
-   * account deep call chains.
+   * Via a fixed point computation, figure out all methods which return an
+   * incoming parameter, taking into account deep call chains. After a first
+   * round over all methods, only the callers of methods that were found in
+   * the previous round get inspected again.
    */
   static std::unordered_map<const DexMethod*, ParamIndex>
   find_methods_which_return_parameter(PassManager& mgr,
@@ -20,6 +20,7 @@
 #include "DexStore.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
+#include "InstructionLowering.h"
 #include "InterDexPass.h"
 #include "Macros.h"
 #include "MethodProfiles.h"
@@ -209,22 +210,30 @@ struct SwitchRange {
   int32_t max_case;
   std::vector<int32_t> mid_cases;
 };
-SwitchRange get_switch_range(const cfg::ControlFlowGraph& cfg,
-                             cfg::Block* b,
-                             size_t split_into) {
+SwitchRange get_switch_range(cfg::Block* b, size_t split_into) {
   redex_assert(CONSTP(b)->get_last_insn()->insn->opcode() == OPCODE_SWITCH);
   std::vector<int32_t> cases;
-  for (const auto* e : cfg.get_succ_edges_of_type(b, cfg::EDGE_BRANCH)) {
-    cases.push_back(*e->case_key());
+  cases.reserve(b->succs().size());
+  for (const auto* e : b->succs()) {
+    if (e->type() == cfg::EDGE_BRANCH) {
+      cases.push_back(*e->case_key());
+    }
   }
-  std::sort(cases.begin(), cases.end());
   int32_t min_case = 0, max_case = 0;
   std::vector<int32_t> mid_cases;
   if (!cases.empty() && cases.size() > split_into) {
-    min_case = cases.front();
-    max_case = cases.back();
+    auto extent = instruction_lowering::CaseKeysExtent::from_unordered(cases);
+    min_case = extent.first_key;
+    max_case = extent.last_key;
+    // Only the split points need to be in their sorted positions. They are
+    // strictly increasing, so each selection only looks at the remainder.
+    mid_cases.reserve(split_into);
+    auto begin = cases.begin();
     for (size_t i = 1; i < split_into; ++i) {
-      mid_cases.push_back(cases[(i * cases.size()) / split_into - 1]);
+      auto nth = cases.begin() + ((i * cases.size()) / split_into - 1);
+      std::nth_element(begin, nth, cases.end());
+      mid_cases.push_back(*nth);
+      begin = nth + 1;
     }
     mid_cases.push_back(max_case);
   }
@@ -557,8 +566,7 @@ AnalysisData analyze(DexMethod* m,
 
   size_t nr_splits = (size_t)std::ceil(((float)size) / code_units_threshold);
   redex_assert(nr_splits > 1);
-  auto switch_range =
-      get_switch_range(*scoped_cfg, switch_it.block(), nr_splits);
+  auto switch_range = get_switch_range(switch_it.block(), nr_splits);
   if (switch_range.cases < nr_splits) {
     // Cannot split into the requested amount.
     data.cannot_split = true;
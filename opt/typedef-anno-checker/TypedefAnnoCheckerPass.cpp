@@ -1419,6 +1419,88 @@ bool TypedefAnnoChecker::is_delegate(const DexMethod* m) {
   return false;
 }
 
+TypedefAnnoIndex::TypedefAnnoIndex(
+    const TypedefAnnoCheckerPass::Config& config) {
+  m_typedef_annos.emplace(config.int_typedef);
+  m_typedef_annos.emplace(config.str_typedef);
+}
+
+TypedefAnnoIndex::TypedefAnnoIndex(const Scope& scope,
+                                   const TypedefAnnoCheckerPass::Config& config)
+    : TypedefAnnoIndex(config) {
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    for (auto* m : cls->get_all_methods()) {
+      auto param_annos = compute_param_annos(m);
+      if (!param_annos.empty()) {
+        m_param_annos.emplace(m, std::move(param_annos));
+      }
+      auto return_anno = compute_member_anno(m);
+      if (return_anno) {
+        m_return_annos.emplace(m, *return_anno);
+      }
+    }
+    for (auto* f : cls->get_all_fields()) {
+      auto field_anno = compute_member_anno(f);
+      if (field_anno) {
+        m_field_annos.emplace(f, *field_anno);
+      }
+    }
+  });
+  m_indexed_scope = true;
+}
+
+TypedefAnnoIndex::ParamAnnos TypedefAnnoIndex::compute_param_annos(
+    const DexMethod* m) const {
+  ParamAnnos param_annos;
+  if (!m->get_param_anno()) {
+    return param_annos;
+  }
+  for (auto const& param_anno : *m->get_param_anno()) {
+    auto annotation = type_inference::get_typedef_annotation(
+        param_anno.second->get_annotations(), m_typedef_annos);
+    if (annotation) {
+      param_annos.emplace_back(param_anno.first, *annotation);
+    }
+  }
+  return param_annos;
+}
+
+const TypedefAnnoIndex::ParamAnnos& TypedefAnnoIndex::get_param_annos(
+    const DexMethod* m) const {
+  if (is_indexed(m)) {
+    auto* param_annos = m_param_annos.get(m);
+    return param_annos ? *param_annos : m_no_param_annos;
+  }
+  return *m_on_demand_param_annos
+              .get_or_create_and_assert_equal(
+                  m, [&](const DexMethod*) { return compute_param_annos(m); })
+              .first;
+}
+
+boost::optional<const DexType*> TypedefAnnoIndex::get_return_anno(
+    const DexMethod* m) const {
+  if (is_indexed(m)) {
+    auto* return_anno = m_return_annos.get(m);
+    return return_anno ? boost::optional<const DexType*>(*return_anno)
+                       : boost::none;
+  }
+  return compute_member_anno(m);
+}
+
+boost::optional<const DexType*> TypedefAnnoIndex::get_field_anno(
+    const DexFieldRef* f) const {
+  if (!f->is_def()) {
+    return boost::none;
+  }
+  auto* field = f->as_def();
+  if (is_indexed(field)) {
+    auto* field_anno = m_field_annos.get(field);
+    return field_anno ? boost::optional<const DexType*>(*field_anno)
+                      : boost::none;
+  }
+  return compute_member_anno(field);
+}
+
 void TypedefAnnoChecker::run(DexMethod* m) {
   IRCode* code = m->get_code();
   if (!code) {
@@ -1431,22 +1513,16 @@ void TypedefAnnoChecker::run(DexMethod* m) {
 
   always_assert(code->editable_cfg_built());
   auto& cfg = code->cfg();
-  std::unordered_set<DexType*> anno_set;
-  anno_set.emplace(m_config.int_typedef);
-  anno_set.emplace(m_config.str_typedef);
-  type_inference::TypeInference inference(cfg, false, anno_set,
+  type_inference::TypeInference inference(cfg, false,
+                                          m_anno_index->typedef_annos(),
                                           &m_method_override_graph);
   inference.run(m);
 
   live_range::MoveAwareChains chains(cfg);
   live_range::UseDefChains ud_chains = chains.get_use_def_chains();
 
-  boost::optional<const DexType*> return_annotation = boost::none;
-  DexAnnotationSet* return_annos = m->get_anno_set();
-  if (return_annos) {
-    return_annotation = type_inference::get_typedef_annotation(
-        return_annos->get_annotations(), inference.get_annotations());
-  }
+  boost::optional<const DexType*> return_annotation =
+      m_anno_index->get_return_anno(m);
   TypeEnvironments& envs = inference.get_type_environments();
   TRACE(TAC, 5, "Start checking %s", SHOW(m));
   TRACE(TAC, 5, "%s", SHOW(cfg));
@@ -1497,12 +1573,8 @@ void TypedefAnnoChecker::check_instruction(
         // Callee does not expect any Typedef value. Nothing to do.
         return;
       }
-      for (auto const& param_anno : *callee->get_param_anno()) {
-        auto annotation = type_inference::get_typedef_annotation(
-            param_anno.second->get_annotations(), inference->get_annotations());
-        if (annotation == boost::none) {
-          continue;
-        }
+      for (auto const& param_anno : m_anno_index->get_param_annos(callee)) {
+        boost::optional<const DexType*> annotation = param_anno.second;
         int param_index = insn->opcode() == OPCODE_INVOKE_STATIC
                               ? param_anno.first
                               : param_anno.first + 1;
@@ -1566,8 +1638,7 @@ void TypedefAnnoChecker::check_instruction(
   case OPCODE_SPUT_OBJECT:
   case OPCODE_IPUT_OBJECT: {
     auto env_anno = env.get_annotation(insn->src(0));
-    auto field_anno = type_inference::get_typedef_anno_from_member(
-        insn->get_field(), inference->get_annotations());
+    auto field_anno = m_anno_index->get_field_anno(insn->get_field());
     if (env_anno != boost::none && field_anno != boost::none &&
         env_anno.value() != field_anno.value()) {
       std::ostringstream out;
@@ -1802,8 +1873,7 @@ bool TypedefAnnoChecker::check_typedef_value(
       callees.push_back(def_method);
       for (const DexMethod* callee : callees) {
         boost::optional<const DexType*> anno =
-            type_inference::get_typedef_anno_from_member(
-                callee, inference->get_annotations());
+            m_anno_index->get_return_anno(callee);
         if (anno == boost::none || anno != annotation) {
           DexType* return_type = callee->get_proto()->get_rtype();
           // constant folding might cause the source to be the invoked boolean
@@ -1855,8 +1925,7 @@ bool TypedefAnnoChecker::check_typedef_value(
       if (is_synthetic(field)) {
         // TODO: add stats for this
       }
-      auto field_anno = type_inference::get_typedef_anno_from_member(
-          def->get_field(), inference->get_annotations());
+      auto field_anno = m_anno_index->get_field_anno(def->get_field());
       if (!field_anno || field_anno != annotation) {
         std::ostringstream out;
         out << "TypedefAnnoCheckerPass: in method " << show(m)
@@ -1931,9 +2000,13 @@ void TypedefAnnoCheckerPass::run_pass(DexStoresVector& stores,
   patcher.run(scope);
   TRACE(TAC, 2, "Finish patching synth accessors");
 
+  TypedefAnnoIndex anno_index(scope, m_config);
+  TRACE(TAC, 2, "Finish indexing typedef annotations");
+
   auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
-    TypedefAnnoChecker checker = TypedefAnnoChecker(
-        strdef_constants, intdef_constants, m_config, *method_override_graph);
+    TypedefAnnoChecker checker =
+        TypedefAnnoChecker(strdef_constants, intdef_constants, m_config,
+                           *method_override_graph, &anno_index);
     checker.run(m);
     if (!checker.complete()) {
       return Stats(checker.error());
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "ConcurrentContainers.h"
 #include "ControlFlow.h"
 #include "LiveRange.h"
@@ -87,6 +89,64 @@ using StrDefConstants =
 using IntDefConstants =
     InsertOnlyConcurrentMap<const DexClass*, std::unordered_set<uint64_t>>;
 
+/*
+ * The typedef annotations of parameters, returns and fields, resolved once so
+ * that the checker does not have to search the annotation sets of a member
+ * every time it is referenced.
+ *
+ * When built for a scope, all members of the scope are indexed up front in
+ * parallel, and members without a typedef annotation are not stored. Other
+ * members, like external ones, are resolved on demand. The index must be
+ * built after the annotations got patched, and the annotations must not
+ * change while it is in use.
+ */
+class TypedefAnnoIndex {
+ public:
+  using ParamAnnos = std::vector<std::pair<int, const DexType*>>;
+
+  // Resolves all annotations on demand.
+  explicit TypedefAnnoIndex(const TypedefAnnoCheckerPass::Config& config);
+
+  TypedefAnnoIndex(const Scope& scope,
+                   const TypedefAnnoCheckerPass::Config& config);
+
+  const std::unordered_set<DexType*>& typedef_annos() const {
+    return m_typedef_annos;
+  }
+
+  // The typedef annotations of the parameters of the method, ordered by
+  // parameter index, where index 0 is the first non-receiver parameter.
+  const ParamAnnos& get_param_annos(const DexMethod* m) const;
+
+  boost::optional<const DexType*> get_return_anno(const DexMethod* m) const;
+
+  boost::optional<const DexType*> get_field_anno(const DexFieldRef* f) const;
+
+ private:
+  template <typename DexMember>
+  bool is_indexed(const DexMember* member) const {
+    return m_indexed_scope && !member->is_external();
+  }
+
+  ParamAnnos compute_param_annos(const DexMethod* m) const;
+
+  template <typename DexMember>
+  boost::optional<const DexType*> compute_member_anno(
+      const DexMember* member) const {
+    return type_inference::get_typedef_anno_from_member(member,
+                                                        m_typedef_annos);
+  }
+
+  std::unordered_set<DexType*> m_typedef_annos;
+  bool m_indexed_scope{false};
+  InsertOnlyConcurrentMap<const DexMethod*, ParamAnnos> m_param_annos;
+  InsertOnlyConcurrentMap<const DexMethod*, const DexType*> m_return_annos;
+  InsertOnlyConcurrentMap<const DexField*, const DexType*> m_field_annos;
+  mutable InsertOnlyConcurrentMap<const DexMethod*, ParamAnnos>
+      m_on_demand_param_annos;
+  const ParamAnnos m_no_param_annos;
+};
+
 class SynthAccessorPatcher {
  public:
   explicit SynthAccessorPatcher(
@@ -139,11 +199,18 @@ class TypedefAnnoChecker {
       const StrDefConstants& strdef_constants,
       const IntDefConstants& intdef_constants,
       const TypedefAnnoCheckerPass::Config& config,
-      const method_override_graph::Graph& method_override_graph)
+      const method_override_graph::Graph& method_override_graph,
+      const TypedefAnnoIndex* anno_index = nullptr)
       : m_config(config),
         m_strdef_constants(strdef_constants),
         m_intdef_constants(intdef_constants),
-        m_method_override_graph(method_override_graph) {}
+        m_method_override_graph(method_override_graph) {
+    if (anno_index == nullptr) {
+      m_own_anno_index = std::make_unique<TypedefAnnoIndex>(config);
+      anno_index = m_own_anno_index.get();
+    }
+    m_anno_index = anno_index;
+  }
 
   bool is_value_of_opt(const DexMethod* m);
   bool is_delegate(const DexMethod* m);
@@ -178,4 +245,6 @@ class TypedefAnnoChecker {
   const StrDefConstants& m_strdef_constants;
   const IntDefConstants& m_intdef_constants;
   const method_override_graph::Graph& m_method_override_graph;
+  std::unique_ptr<TypedefAnnoIndex> m_own_anno_index;
+  const TypedefAnnoIndex* m_anno_index;
 };
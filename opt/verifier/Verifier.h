@@ -13,6 +13,8 @@ class VerifierPass : public Pass {
  public:
   VerifierPass() : Pass("VerifierPass") {}
 
+  bool is_read_only() const override { return true; }
+
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
     using namespace redex_properties::interactions;
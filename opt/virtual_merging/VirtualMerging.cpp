@@ -59,6 +59,7 @@
 #include "StlUtil.h"
 #include "TypeSystem.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -773,8 +774,12 @@ std::pair<std::vector<MethodData>, VirtualMergingStats> create_ordering(
     }
   }
 
-  // Sort out large methods already.
-  for (auto& p : ordering) {
+  // Sort out large methods already. Each overridden method is independent
+  // here, so this runs in parallel; the stats are summed up in order.
+  std::vector<VirtualMergingStats> filter_stats(ordering.size());
+  workqueue_run_for<size_t>(0, ordering.size(), [&](size_t i) {
+    auto& p = ordering[i];
+    auto& local_stats = filter_stats[i];
     auto overridden_method = const_cast<DexMethod*>(p.first);
     for (auto& q : p.second) {
       q.second.erase(
@@ -791,7 +796,7 @@ std::pair<std::vector<MethodData>, VirtualMergingStats> create_ordering(
                         "[VM] %s is too large to be merged into %s",
                         SHOW(m),
                         SHOW(overridden_method));
-                  stats.huge_methods++;
+                  local_stats.huge_methods++;
                   return true;
                 }
 
@@ -808,7 +813,7 @@ std::pair<std::vector<MethodData>, VirtualMergingStats> create_ordering(
                         "[VM] Cannot inline %s into %s",
                         SHOW(m),
                         SHOW(overridden_method));
-                  stats.uninlinable_methods++;
+                  local_stats.uninlinable_methods++;
                   return true;
                 }
 
@@ -907,9 +912,12 @@ std::pair<std::vector<MethodData>, VirtualMergingStats> create_ordering(
               removals,
               num_methods,
               SHOW(overridden_method));
-        stats.caller_size_removed_methods += removals;
+        local_stats.caller_size_removed_methods += removals;
       }
     }
+  });
+  for (const auto& local_stats : filter_stats) {
+    stats += local_stats;
   }
 
   // Remove methods that no longer have inlinees.
@@ -1005,15 +1013,17 @@ struct SBHelper {
                                      : parent->get_arbitrary_first_sb(),
             parent->overridden);
         if (overriding_sb != nullptr && first_sb != nullptr) {
-          for (size_t i = 0; i != new_sb->vals_size; ++i) {
-            if (!new_sb->get_val(i)) {
-              new_sb->vals[i] = first_sb->vals[i];
-            } else if (first_sb->get_val(i)) {
-              new_sb->vals[i]->val += first_sb->vals[i]->val;
-              new_sb->vals[i]->appear100 =
-                  std::max(new_sb->vals[i]->appear100, first_sb->vals[i]->val);
+          new_sb->update_vals([&](SourceBlock::Val* vals) {
+            for (size_t i = 0; i != new_sb->vals_size; ++i) {
+              if (!vals[i]) {
+                vals[i] = first_sb->vals[i];
+              } else if (first_sb->get_val(i)) {
+                vals[i]->val += first_sb->vals[i]->val;
+                vals[i]->appear100 =
+                    std::max(vals[i]->appear100, first_sb->vals[i]->val);
+              }
             }
-          }
+          });
         }
         block->insert_before(block->end(), std::move(new_sb));
       }
@@ -1066,283 +1076,387 @@ struct SBHelper {
   }
 };
 
-VirtualMergingStats apply_ordering(
-    MultiMethodInliner& inliner,
-    std::vector<MethodData>& ordering,
-    std::unordered_map<DexClass*, std::vector<const DexMethod*>>&
-        virtual_methods_to_remove,
-    std::unordered_map<DexMethod*, DexMethod*>& virtual_methods_to_remap,
-    VirtualMerging::InsertionStrategy insertion_strategy) {
+struct MergeResult {
   VirtualMergingStats stats;
-  for (auto& p : ordering) {
-    auto overridden_method = const_cast<DexMethod*>(p.first);
-    for (auto& q : p.second) {
-      if (q.second.empty()) {
-        continue;
-      }
-      SBHelper sb_helper(overridden_method, q.second);
-
-      auto* virtual_scope = q.first;
-
-      for (auto* overriding_method_const : q.second) {
-        auto overriding_method =
-            const_cast<DexMethod*>(overriding_method_const);
-        size_t estimated_callee_size =
-            overriding_method->get_code()->estimate_code_units();
-        size_t estimated_insn_size =
-            is_abstract(overridden_method)
-                ? 64 // we'll need some extra instruction; 64 is conservative
-                : overridden_method->get_code()->estimate_code_units();
-        bool is_inlineable =
-            inliner.is_inlinable(overridden_method, overriding_method,
-                                 nullptr /* invoke_virtual_insn */,
-                                 estimated_insn_size, estimated_callee_size);
-        always_assert_log(is_inlineable, "[VM] Cannot inline %s into %s",
-                          SHOW(overriding_method), SHOW(overridden_method));
-
-        TRACE(VM,
-              4,
-              "[VM] Merging %s into %s",
-              SHOW(overriding_method),
-              SHOW(overridden_method));
+  // Applied once the wave of the merge is done.
+  VisibilityChanges visibility_changes;
+  // The merged overriding methods, with the roots of their virtual scopes.
+  std::vector<std::pair<DexMethod*, DexMethod*>> merged;
+};
 
-        auto proto = overriding_method->get_proto();
-        always_assert(overridden_method->get_proto() == proto);
-        std::vector<uint32_t> param_regs;
-        std::function<void(IRInstruction*)> push_insn;
-        std::function<void(std::unique_ptr<SourceBlock>)> push_sb;
-        std::function<uint32_t()> allocate_temp;
-        std::function<uint32_t()> allocate_wide_temp;
-        std::function<void()> cleanup;
-        IRCode* overridden_code;
-        // We make the method public to avoid visibility issues. We could be
-        // more conservative (i.e. taking the strongest visibility control
-        // that encompasses the original pair) but I'm not sure it's worth the
-        // effort.
-        set_public(overridden_method);
-        if (is_abstract(overridden_method)) {
-          // We'll make the abstract method be not abstract, and give it a new
-          // method body.
-          // It starts out with just load-param instructions as needed, and
-          // then we'll add an invoke-virtual instruction that will get
-          // inlined.
-          stats.unabstracted_methods++;
-          overridden_method->make_concrete(
-              (DexAccessFlags)(overridden_method->get_access() & ~ACC_ABSTRACT),
-              std::make_unique<IRCode>(),
-              true /* is_virtual */);
-          overridden_code = overridden_method->get_code();
-          auto load_param_insn = new IRInstruction(IOPCODE_LOAD_PARAM_OBJECT);
-          load_param_insn->set_dest(overridden_code->allocate_temp());
+// Merges all overriding methods of one ordering entry into its overridden
+// method. This only modifies the overridden method.
+void merge_into_overridden_method(
+    MultiMethodInliner& inliner,
+    MethodData& p,
+    VirtualMerging::InsertionStrategy insertion_strategy,
+    MergeResult* result) {
+  auto overridden_method = const_cast<DexMethod*>(p.first);
+  for (auto& q : p.second) {
+    if (q.second.empty()) {
+      continue;
+    }
+    SBHelper sb_helper(overridden_method, q.second);
+
+    auto* virtual_scope = q.first;
+
+    for (auto* overriding_method_const : q.second) {
+      auto overriding_method =
+          const_cast<DexMethod*>(overriding_method_const);
+      size_t estimated_callee_size =
+          overriding_method->get_code()->estimate_code_units();
+      size_t estimated_insn_size =
+          is_abstract(overridden_method)
+              ? 64 // we'll need some extra instruction; 64 is conservative
+              : overridden_method->get_code()->estimate_code_units();
+      bool is_inlineable =
+          inliner.is_inlinable(overridden_method, overriding_method,
+                               nullptr /* invoke_virtual_insn */,
+                               estimated_insn_size, estimated_callee_size);
+      always_assert_log(is_inlineable, "[VM] Cannot inline %s into %s",
+                        SHOW(overriding_method), SHOW(overridden_method));
+
+      TRACE(VM,
+            4,
+            "[VM] Merging %s into %s",
+            SHOW(overriding_method),
+            SHOW(overridden_method));
+
+      auto proto = overriding_method->get_proto();
+      always_assert(overridden_method->get_proto() == proto);
+      std::vector<uint32_t> param_regs;
+      std::function<void(IRInstruction*)> push_insn;
+      std::function<void(std::unique_ptr<SourceBlock>)> push_sb;
+      std::function<uint32_t()> allocate_temp;
+      std::function<uint32_t()> allocate_wide_temp;
+      std::function<void()> cleanup;
+      IRCode* overridden_code;
+      // We make the method public to avoid visibility issues. We could be
+      // more conservative (i.e. taking the strongest visibility control
+      // that encompasses the original pair) but I'm not sure it's worth the
+      // effort.
+      set_public(overridden_method);
+      if (is_abstract(overridden_method)) {
+        // We'll make the abstract method be not abstract, and give it a new
+        // method body.
+        // It starts out with just load-param instructions as needed, and
+        // then we'll add an invoke-virtual instruction that will get
+        // inlined.
+        result->stats.unabstracted_methods++;
+        overridden_method->make_concrete(
+            (DexAccessFlags)(overridden_method->get_access() & ~ACC_ABSTRACT),
+            std::make_unique<IRCode>(),
+            true /* is_virtual */);
+        overridden_code = overridden_method->get_code();
+        auto load_param_insn = new IRInstruction(IOPCODE_LOAD_PARAM_OBJECT);
+        load_param_insn->set_dest(overridden_code->allocate_temp());
+        overridden_code->push_back(load_param_insn);
+        param_regs.push_back(load_param_insn->dest());
+        for (auto t : *proto->get_args()) {
+          if (type::is_wide_type(t)) {
+            load_param_insn = new IRInstruction(IOPCODE_LOAD_PARAM_WIDE);
+            load_param_insn->set_dest(overridden_code->allocate_wide_temp());
+          } else {
+            load_param_insn = new IRInstruction(
+                type::is_object(t) ? IOPCODE_LOAD_PARAM_OBJECT
+                                   : IOPCODE_LOAD_PARAM);
+            load_param_insn->set_dest(overridden_code->allocate_temp());
+          }
           overridden_code->push_back(load_param_insn);
           param_regs.push_back(load_param_insn->dest());
-          for (auto t : *proto->get_args()) {
-            if (type::is_wide_type(t)) {
-              load_param_insn = new IRInstruction(IOPCODE_LOAD_PARAM_WIDE);
-              load_param_insn->set_dest(overridden_code->allocate_wide_temp());
-            } else {
-              load_param_insn = new IRInstruction(
-                  type::is_object(t) ? IOPCODE_LOAD_PARAM_OBJECT
-                                     : IOPCODE_LOAD_PARAM);
-              load_param_insn->set_dest(overridden_code->allocate_temp());
-            }
-            overridden_code->push_back(load_param_insn);
-            param_regs.push_back(load_param_insn->dest());
-          }
-
-          if (sb_helper.create_source_blocks) {
-            overridden_code->push_back(sb_helper.get_source_block_creator()());
-          }
+        }
 
-          // we'll define helper functions in a way that lets them mutate the
-          // new IRCode
-          push_insn = [=](IRInstruction* insn) {
-            overridden_code->push_back(insn);
-          };
-          push_sb = [=](std::unique_ptr<SourceBlock> sb) {
-            overridden_code->push_back(std::move(sb));
-          };
-          allocate_temp = [=]() { return overridden_code->allocate_temp(); };
-          allocate_wide_temp = [=]() {
-            return overridden_code->allocate_wide_temp();
-          };
-          cleanup = [=]() { overridden_code->build_cfg(); };
-        } else {
-          // We are dealing with a non-abstract method. In this case, we'll
-          // first insert an if-instruction to decide whether to run the
-          // overriding method that we'll inline, or whether to jump to the
-          // old method body.
-          overridden_code = overridden_method->get_code();
-          always_assert(overridden_code);
-          overridden_code->build_cfg();
-          auto& overridden_cfg = overridden_code->cfg();
-
-          // Find block with load-param instructions
-          cfg::Block* block = overridden_cfg.entry_block();
-          while (block->get_first_insn() == block->end()) {
-            const auto& succs = block->succs();
-            always_assert(succs.size() == 1);
-            const auto& out = succs[0];
-            always_assert(out->type() == cfg::EDGE_GOTO);
-            block = out->target();
-          }
+        if (sb_helper.create_source_blocks) {
+          overridden_code->push_back(sb_helper.get_source_block_creator()());
+        }
 
-          // Scan load-param instructions
-          std::unordered_set<uint32_t> param_regs_set;
-          auto last_it = block->end();
-          for (auto it = block->begin(); it != block->end(); it++) {
-            auto& mie = *it;
-            if (mie.type != MFLOW_OPCODE) {
-              continue;
-            }
-            if (!opcode::is_a_load_param(mie.insn->opcode())) {
-              break;
-            }
-            param_regs.push_back(mie.insn->dest());
-            param_regs_set.insert(mie.insn->dest());
-            last_it = it;
-          }
-          always_assert(param_regs.size() == param_regs_set.size());
-          always_assert(1 + proto->get_args()->size() == param_regs_set.size());
-          always_assert(last_it != block->end());
+        // we'll define helper functions in a way that lets them mutate the
+        // new IRCode
+        push_insn = [=](IRInstruction* insn) {
+          overridden_code->push_back(insn);
+        };
+        push_sb = [=](std::unique_ptr<SourceBlock> sb) {
+          overridden_code->push_back(std::move(sb));
+        };
+        allocate_temp = [=]() { return overridden_code->allocate_temp(); };
+        allocate_wide_temp = [=]() {
+          return overridden_code->allocate_wide_temp();
+        };
+        cleanup = [=]() { overridden_code->build_cfg(); };
+      } else {
+        // We are dealing with a non-abstract method. In this case, we'll
+        // first insert an if-instruction to decide whether to run the
+        // overriding method that we'll inline, or whether to jump to the
+        // old method body.
+        overridden_code = overridden_method->get_code();
+        always_assert(overridden_code);
+        overridden_code->build_cfg();
+        auto& overridden_cfg = overridden_code->cfg();
+
+        // Find block with load-param instructions
+        cfg::Block* block = overridden_cfg.entry_block();
+        while (block->get_first_insn() == block->end()) {
+          const auto& succs = block->succs();
+          always_assert(succs.size() == 1);
+          const auto& out = succs[0];
+          always_assert(out->type() == cfg::EDGE_GOTO);
+          block = out->target();
+        }
 
-          // We'll split the block right after the last load-param instruction
-          // --- that's where we'll insert the new if-statement.
-          {
-            auto sb_scoped =
-                sb_helper.handle_split(block, last_it, overriding_method);
-            overridden_cfg.split_block(block, last_it);
+        // Scan load-param instructions
+        std::unordered_set<uint32_t> param_regs_set;
+        auto last_it = block->end();
+        for (auto it = block->begin(); it != block->end(); it++) {
+          auto& mie = *it;
+          if (mie.type != MFLOW_OPCODE) {
+            continue;
           }
-
-          auto new_block = overridden_cfg.create_block();
-          {
-            // instance-of param0, DeclaringTypeOfOverridingMethod
-            auto instance_of_insn = new IRInstruction(OPCODE_INSTANCE_OF);
-            instance_of_insn->set_type(overriding_method->get_class());
-            instance_of_insn->set_src(0, param_regs.at(0));
-            block->push_back(instance_of_insn);
-            // move-result-pseudo if_temp
-            auto if_temp_reg = overridden_cfg.allocate_temp();
-            auto move_result_pseudo_insn =
-                new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO);
-            move_result_pseudo_insn->set_dest(if_temp_reg);
-            block->push_back(move_result_pseudo_insn);
-
-            switch (insertion_strategy) {
-            case VirtualMerging::InsertionStrategy::kJumpTo: {
-              // if-nez if_temp, new_code
-              // (fall through to old code)
-              auto if_insn = new IRInstruction(OPCODE_IF_NEZ);
-              if_insn->set_src(0, if_temp_reg);
-              overridden_cfg.create_branch(
-                  block, if_insn, /*fls=*/block->goes_to(), /*tru=*/new_block);
-              break;
-            }
-
-            case VirtualMerging::InsertionStrategy::kFallthrough: {
-              // if-eqz if_temp, old code
-              // (fall through to new_code)
-              auto if_insn = new IRInstruction(OPCODE_IF_EQZ);
-              if_insn->set_src(0, if_temp_reg);
-              overridden_cfg.create_branch(block, if_insn, /*fls=*/new_block,
-                                           /*tru=*/block->goes_to());
-              break;
-            }
-            }
+          if (!opcode::is_a_load_param(mie.insn->opcode())) {
+            break;
           }
-          // we'll define helper functions in a way that lets them mutate the
-          // cfg
-          push_insn = [=](IRInstruction* insn) { new_block->push_back(insn); };
-          auto* cfg_ptr = &overridden_cfg;
-          push_sb = [=](std::unique_ptr<SourceBlock> sb) {
-            new_block->insert_before(new_block->end(), std::move(sb));
-          };
-          allocate_temp = [=]() { return cfg_ptr->allocate_temp(); };
-          allocate_wide_temp = [=]() { return cfg_ptr->allocate_wide_temp(); };
-          cleanup = []() {};
+          param_regs.push_back(mie.insn->dest());
+          param_regs_set.insert(mie.insn->dest());
+          last_it = it;
         }
+        always_assert(param_regs.size() == param_regs_set.size());
+        always_assert(1 + proto->get_args()->size() == param_regs_set.size());
+        always_assert(last_it != block->end());
 
-        if (sb_helper.create_source_blocks) {
-          // Insert source block with val == 1.0 so that inlining normalizes
-          // source-blocks properly
-          push_sb(sb_helper.get_source_block_creator(/* val */ 1.0)());
+        // We'll split the block right after the last load-param instruction
+        // --- that's where we'll insert the new if-statement.
+        {
+          auto sb_scoped =
+              sb_helper.handle_split(block, last_it, overriding_method);
+          overridden_cfg.split_block(block, last_it);
         }
 
-        always_assert(1 + proto->get_args()->size() == param_regs.size());
-
-        // invoke-virtual temp, param1, ..., paramN, OverridingMethod
-        auto invoke_virtual_insn = new IRInstruction(OPCODE_INVOKE_VIRTUAL);
-        invoke_virtual_insn->set_method(overriding_method);
-        invoke_virtual_insn->set_srcs_size(param_regs.size());
-        for (size_t i = 0; i < param_regs.size(); i++) {
-          uint32_t reg = param_regs[i];
-          if (i == 0) {
-            uint32_t temp_reg = allocate_temp();
-            auto check_cast_insn = new IRInstruction(OPCODE_CHECK_CAST);
-            check_cast_insn->set_type(overriding_method->get_class());
-            check_cast_insn->set_src(0, reg);
-            push_insn(check_cast_insn);
-            auto move_result_pseudo_insn =
-                new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
-            move_result_pseudo_insn->set_dest(temp_reg);
-            push_insn(move_result_pseudo_insn);
-            reg = temp_reg;
+        auto new_block = overridden_cfg.create_block();
+        {
+          // instance-of param0, DeclaringTypeOfOverridingMethod
+          auto instance_of_insn = new IRInstruction(OPCODE_INSTANCE_OF);
+          instance_of_insn->set_type(overriding_method->get_class());
+          instance_of_insn->set_src(0, param_regs.at(0));
+          block->push_back(instance_of_insn);
+          // move-result-pseudo if_temp
+          auto if_temp_reg = overridden_cfg.allocate_temp();
+          auto move_result_pseudo_insn =
+              new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO);
+          move_result_pseudo_insn->set_dest(if_temp_reg);
+          block->push_back(move_result_pseudo_insn);
+
+          switch (insertion_strategy) {
+          case VirtualMerging::InsertionStrategy::kJumpTo: {
+            // if-nez if_temp, new_code
+            // (fall through to old code)
+            auto if_insn = new IRInstruction(OPCODE_IF_NEZ);
+            if_insn->set_src(0, if_temp_reg);
+            overridden_cfg.create_branch(
+                block, if_insn, /*fls=*/block->goes_to(), /*tru=*/new_block);
+            break;
+          }
+
+          case VirtualMerging::InsertionStrategy::kFallthrough: {
+            // if-eqz if_temp, old code
+            // (fall through to new_code)
+            auto if_insn = new IRInstruction(OPCODE_IF_EQZ);
+            if_insn->set_src(0, if_temp_reg);
+            overridden_cfg.create_branch(block, if_insn, /*fls=*/new_block,
+                                         /*tru=*/block->goes_to());
+            break;
+          }
           }
-          invoke_virtual_insn->set_src(i, reg);
         }
-        push_insn(invoke_virtual_insn);
-        if (proto->is_void()) {
-          // return-void
-          sb_helper.add_return_sb(overriding_method, push_sb);
-          auto return_insn = new IRInstruction(OPCODE_RETURN_VOID);
-          push_insn(return_insn);
-        } else {
-          // move-result result_temp
-          auto rtype = proto->get_rtype();
-          auto op = opcode::move_result_for_invoke(overriding_method);
-          auto move_result_insn = new IRInstruction(op);
-          auto result_temp = op == OPCODE_MOVE_RESULT_WIDE
-                                 ? allocate_wide_temp()
-                                 : allocate_temp();
-          move_result_insn->set_dest(result_temp);
-          push_insn(move_result_insn);
-          sb_helper.add_return_sb(overriding_method, push_sb);
-          // return result_temp
-          op = opcode::return_opcode(rtype);
-          auto return_insn = new IRInstruction(op);
-          return_insn->set_src(0, result_temp);
-          push_insn(return_insn);
+        // we'll define helper functions in a way that lets them mutate the
+        // cfg
+        push_insn = [=](IRInstruction* insn) { new_block->push_back(insn); };
+        auto* cfg_ptr = &overridden_cfg;
+        push_sb = [=](std::unique_ptr<SourceBlock> sb) {
+          new_block->insert_before(new_block->end(), std::move(sb));
+        };
+        allocate_temp = [=]() { return cfg_ptr->allocate_temp(); };
+        allocate_wide_temp = [=]() { return cfg_ptr->allocate_wide_temp(); };
+        cleanup = []() {};
+      }
+
+      if (sb_helper.create_source_blocks) {
+        // Insert source block with val == 1.0 so that inlining normalizes
+        // source-blocks properly
+        push_sb(sb_helper.get_source_block_creator(/* val */ 1.0)());
+      }
+
+      always_assert(1 + proto->get_args()->size() == param_regs.size());
+
+      // invoke-virtual temp, param1, ..., paramN, OverridingMethod
+      auto invoke_virtual_insn = new IRInstruction(OPCODE_INVOKE_VIRTUAL);
+      invoke_virtual_insn->set_method(overriding_method);
+      invoke_virtual_insn->set_srcs_size(param_regs.size());
+      for (size_t i = 0; i < param_regs.size(); i++) {
+        uint32_t reg = param_regs[i];
+        if (i == 0) {
+          uint32_t temp_reg = allocate_temp();
+          auto check_cast_insn = new IRInstruction(OPCODE_CHECK_CAST);
+          check_cast_insn->set_type(overriding_method->get_class());
+          check_cast_insn->set_src(0, reg);
+          push_insn(check_cast_insn);
+          auto move_result_pseudo_insn =
+              new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
+          move_result_pseudo_insn->set_dest(temp_reg);
+          push_insn(move_result_pseudo_insn);
+          reg = temp_reg;
         }
+        invoke_virtual_insn->set_src(i, reg);
+      }
+      push_insn(invoke_virtual_insn);
+      if (proto->is_void()) {
+        // return-void
+        sb_helper.add_return_sb(overriding_method, push_sb);
+        auto return_insn = new IRInstruction(OPCODE_RETURN_VOID);
+        push_insn(return_insn);
+      } else {
+        // move-result result_temp
+        auto rtype = proto->get_rtype();
+        auto op = opcode::move_result_for_invoke(overriding_method);
+        auto move_result_insn = new IRInstruction(op);
+        auto result_temp = op == OPCODE_MOVE_RESULT_WIDE
+                               ? allocate_wide_temp()
+                               : allocate_temp();
+        move_result_insn->set_dest(result_temp);
+        push_insn(move_result_insn);
+        sb_helper.add_return_sb(overriding_method, push_sb);
+        // return result_temp
+        op = opcode::return_opcode(rtype);
+        auto return_insn = new IRInstruction(op);
+        return_insn->set_src(0, result_temp);
+        push_insn(return_insn);
+      }
+
+      cleanup();
+
+      // overriding_method->get_code()->build_cfg();
+      always_assert(overriding_method->get_code()->editable_cfg_built());
+      always_assert(overridden_method->get_code()->editable_cfg_built());
+      inliner::inline_with_cfg(
+          overridden_method, overriding_method, invoke_virtual_insn,
+          /* needs_receiver_cast */ nullptr, /* needs_init_class */ nullptr,
+          overridden_method->get_code()->cfg().get_registers_size());
+      result->visibility_changes.insert(get_visibility_changes(
+          overriding_method, overridden_method->get_class()));
+
+      // Check if everything was inlined.
+      for (const auto& mie :
+           cfg::InstructionIterable(overridden_code->cfg())) {
+        redex_assert(invoke_virtual_insn != mie.insn);
+      }
+
+      auto virtual_scope_root = virtual_scope->methods.front();
+      always_assert(overriding_method != virtual_scope_root.first);
+      result->merged.emplace_back(overriding_method, virtual_scope_root.first);
 
-        cleanup();
+      result->stats.removed_virtual_methods++;
+    }
+  }
+}
 
-        // overriding_method->get_code()->build_cfg();
-        always_assert(overriding_method->get_code()->editable_cfg_built());
-        always_assert(overridden_method->get_code()->editable_cfg_built());
-        inliner::inline_with_cfg(
-            overridden_method, overriding_method, invoke_virtual_insn,
-            /* needs_receiver_cast */ nullptr, /* needs_init_class */ nullptr,
-            overridden_method->get_code()->cfg().get_registers_size());
-        inliner.visibility_changes_apply_and_record_make_static(
-            get_visibility_changes(overriding_method,
-                                   overridden_method->get_class()));
+// Groups the ordering entries into waves which can be merged concurrently.
+// Merging an entry rewrites its overridden method, and reads its overriding
+// methods as well as the methods they reference, whose access flags may get
+// inspected. Every entry goes into the wave after the last earlier entry it
+// conflicts with, so that the outcome is the same as when processing the
+// ordering sequentially.
+std::vector<std::vector<size_t>> compute_merge_waves(
+    const std::vector<MethodData>& ordering) {
+  std::unordered_set<const DexMethod*> overridden_methods;
+  for (auto& p : ordering) {
+    overridden_methods.insert(p.first);
+  }
 
-        // Check if everything was inlined.
+  // For each entry, the overridden methods of any entry that it reads.
+  std::vector<std::vector<const DexMethod*>> reads(ordering.size());
+  workqueue_run_for<size_t>(0, ordering.size(), [&](size_t i) {
+    std::unordered_set<const DexMethod*> read;
+    auto add = [&](const DexMethod* m) {
+      if (m != nullptr && overridden_methods.count(m)) {
+        read.insert(m);
+      }
+    };
+    for (auto& q : ordering[i].second) {
+      for (auto* m : q.second) {
+        add(m);
         for (const auto& mie :
-             cfg::InstructionIterable(overridden_code->cfg())) {
-          redex_assert(invoke_virtual_insn != mie.insn);
+             cfg::ConstInstructionIterable(m->get_code()->cfg())) {
+          auto* insn = mie.insn;
+          if (insn->has_method()) {
+            add(insn->get_method()->as_def());
+            add(resolve_method(insn->get_method(), opcode_to_search(insn), m));
+          }
         }
+      }
+    }
+    reads[i].assign(read.begin(), read.end());
+  });
 
-        virtual_methods_to_remove[type_class(overriding_method->get_class())]
-            .push_back(overriding_method);
-        auto virtual_scope_root = virtual_scope->methods.front();
-        always_assert(overriding_method != virtual_scope_root.first);
-        virtual_methods_to_remap.emplace(overriding_method,
-                                         virtual_scope_root.first);
-
-        stats.removed_virtual_methods++;
+  std::vector<std::vector<size_t>> waves;
+  std::unordered_map<const DexMethod*, size_t> written_in_wave;
+  std::unordered_map<const DexMethod*, size_t> last_read_in_wave;
+  for (size_t i = 0; i < ordering.size(); i++) {
+    auto overridden_method = ordering[i].first;
+    size_t wave = 0;
+    for (auto* m : reads[i]) {
+      auto it = written_in_wave.find(m);
+      if (it != written_in_wave.end()) {
+        wave = std::max(wave, it->second + 1);
       }
     }
+    auto it = last_read_in_wave.find(overridden_method);
+    if (it != last_read_in_wave.end()) {
+      wave = std::max(wave, it->second + 1);
+    }
+    written_in_wave.emplace(overridden_method, wave);
+    for (auto* m : reads[i]) {
+      auto& last_read = last_read_in_wave[m];
+      last_read = std::max(last_read, wave);
+    }
+    if (wave == waves.size()) {
+      waves.emplace_back();
+    }
+    waves.at(wave).push_back(i);
+  }
+  return waves;
+}
+
+VirtualMergingStats apply_ordering(
+    MultiMethodInliner& inliner,
+    std::vector<MethodData>& ordering,
+    std::unordered_map<DexClass*, std::vector<const DexMethod*>>&
+        virtual_methods_to_remove,
+    std::unordered_map<DexMethod*, DexMethod*>& virtual_methods_to_remap,
+    VirtualMerging::InsertionStrategy insertion_strategy) {
+  std::vector<MergeResult> results(ordering.size());
+  auto waves = compute_merge_waves(ordering);
+  for (const auto& wave : waves) {
+    workqueue_run_for<size_t>(0, wave.size(), [&](size_t i) {
+      auto idx = wave[i];
+      merge_into_overridden_method(inliner, ordering[idx], insertion_strategy,
+                                   &results[idx]);
+    });
+    for (auto idx : wave) {
+      inliner.visibility_changes_apply_and_record_make_static(
+          results[idx].visibility_changes);
+    }
+  }
+  TRACE(VM, 2, "[VM] Merged %zu overridden methods in %zu waves",
+        ordering.size(), waves.size());
+
+  // Record the outcome in the order of the ordering, independent of the
+  // waves.
+  VirtualMergingStats stats;
+  for (auto& result : results) {
+    stats += result.stats;
+    for (auto [overriding_method, root_method] : result.merged) {
+      virtual_methods_to_remove[type_class(overriding_method->get_class())]
+          .push_back(overriding_method);
+      virtual_methods_to_remap.emplace(overriding_method, root_method);
+    }
   }
   return stats;
 }
@@ -16,6 +16,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace class_merging;
 
@@ -276,39 +277,53 @@ void MergeabilityChecker::exclude_static_fields(TypeSet& non_mergeables) {
     return;
   }
 
-  walk::fields(m_scope, [&non_mergeables, this](DexField* field) {
-    if (m_spec.merging_targets.count(field->get_class())) {
-      if (is_static(field)) {
-        auto rtype = type::get_element_type_if_array(field->get_type());
-        if (!type::is_primitive(rtype) && rtype != string_type) {
-          // If the type is either non-primitive or a list of
-          // non-primitive types (excluding Strings), then exclude it as
-          // we might change the initialization order.
-          TRACE(CLMG,
-                5,
-                "[non mergeable] %s as it contains a non-primitive "
-                "static field",
-                SHOW(field->get_class()));
-          non_mergeables.emplace(field->get_class());
-        }
+  // Only the merging targets matter, so there is no need to walk the fields of
+  // the whole scope.
+  for (auto* type : m_spec.merging_targets) {
+    auto* cls = type_class(type);
+    if (cls == nullptr) {
+      continue;
+    }
+    for (auto* field : cls->get_sfields()) {
+      auto rtype = type::get_element_type_if_array(field->get_type());
+      if (!type::is_primitive(rtype) && rtype != string_type) {
+        // If the type is either non-primitive or a list of
+        // non-primitive types (excluding Strings), then exclude it as
+        // we might change the initialization order.
+        TRACE(CLMG,
+              5,
+              "[non mergeable] %s as it contains a non-primitive "
+              "static field",
+              SHOW(type));
+        non_mergeables.emplace(type);
+        break;
       }
     }
-  });
+  }
 }
 
 void MergeabilityChecker::exclude_unsafe_sdk_and_store_refs(
     TypeSet& non_mergeables) {
   const auto mog = method_override_graph::build_graph(m_scope);
+  std::vector<const DexType*> candidates;
   for (auto type : m_spec.merging_targets) {
-    if (non_mergeables.count(type)) {
-      continue;
+    if (!non_mergeables.count(type)) {
+      candidates.push_back(type);
     }
+  }
+  // Checking the classes is independent, and the RefChecker caches are
+  // concurrent.
+  std::vector<uint8_t> excluded(candidates.size());
+  workqueue_run_for<size_t>(0, candidates.size(), [&](size_t i) {
+    auto type = candidates[i];
     auto cls = type_class(type);
-    if (!m_ref_checker.check_class(cls, mog)) {
-      non_mergeables.insert(type);
-    }
-    if (!m_spec.include_primary_dex && m_ref_checker.is_in_primary_dex(type)) {
-      non_mergeables.insert(type);
+    excluded[i] =
+        !m_ref_checker.check_class(cls, mog) ||
+        (!m_spec.include_primary_dex && m_ref_checker.is_in_primary_dex(type));
+  });
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (excluded[i]) {
+      non_mergeables.insert(candidates[i]);
     }
   }
 }
@@ -157,6 +157,9 @@ struct ModelSpec {
   bool merge_types_with_static_fields{false};
   // Preserve debug info like line numbers.
   bool keep_debug_info{false};
+  // Test the hottest type tag of a virtual dispatch ahead of its switch, based
+  // on the method profiles or the source block values of the merged methods.
+  bool peel_hot_dispatch_case{false};
   // A flag for method deduplication. Deduplicating block that explicitly
   // capture stack traces for human-written code may make java stack trace
   // confusing.
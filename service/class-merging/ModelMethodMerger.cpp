@@ -581,6 +581,10 @@ void ModelMethodMerger::merge_virtual_methods(
                         access,          type_tag_field,
                         overridden_meth, m_max_num_dispatch_target,
                         boost::none,     m_model_spec.keep_debug_info};
+    spec.peel_hot_case = m_model_spec.peel_hot_dispatch_case;
+    if (m_method_profiles != boost::none) {
+      spec.method_profiles = m_method_profiles.get();
+    }
     dispatch::DispatchMethod dispatch = create_dispatch_method(spec, meth_lst);
     for (const auto sub_dispatch : dispatch.sub_dispatches) {
       sub_dispatch->get_code()->build_cfg();
@@ -23,6 +23,7 @@
 #include "Show.h"
 #include "SourceBlocks.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace class_splitting {
 
@@ -159,25 +160,23 @@ bool ClassSplitter::has_source_block_positive_val(DexMethod* method) {
   return false;
 }
 
-void ClassSplitter::prepare(const DexClass* cls,
-                            std::vector<DexMethodRef*>* mrefs,
-                            std::vector<DexType*>* trefs) {
+ClassSplitter::ClassPlan ClassSplitter::plan_class(const DexClass* cls) {
+  ClassPlan plan;
   // Bail out if we just cannot or should not relocate methods of this class.
   if (!can_relocate(cls)) {
-    return;
+    return plan;
   }
+  plan.relocatable = true;
   auto cls_has_problematic_clinit = method::clinit_may_have_side_effects(
       cls, /* allow_benign_method_invocations */ false);
 
-  SplitClass& sc = m_split_classes[cls];
-  always_assert(sc.relocatable_methods.empty());
   auto process_method = [&](DexMethod* method) {
     if (!method->get_code()) {
       return;
     }
     auto& cfg = method->get_code()->cfg();
     if (get_trampoline_method_cost(method) >= cfg.estimate_code_units()) {
-      m_stats.method_size_too_small++;
+      plan.methods_too_small++;
       return;
     }
     if (m_sufficiently_popular_methods.count(method)) {
@@ -193,14 +192,38 @@ void ClassSplitter::prepare(const DexClass* cls,
 
     bool requires_trampoline{false};
     if (!can_relocate(cls_has_problematic_clinit, method, /* log */ true,
-                      &requires_trampoline)) {
+                      &requires_trampoline, &plan.visibility_changes)) {
       return;
     }
     if (requires_trampoline && !m_config.trampolines) {
       return;
     }
+    plan.candidates.push_back({method, requires_trampoline,
+                               api::LevelChecker::get_method_level(method)});
+  };
+  auto& dmethods = cls->get_dmethods();
+  std::for_each(dmethods.begin(), dmethods.end(), process_method);
+  auto& vmethods = cls->get_vmethods();
+  std::for_each(vmethods.begin(), vmethods.end(), process_method);
+  return plan;
+}
+
+void ClassSplitter::apply_plan(const DexClass* cls,
+                               const ClassPlan& plan,
+                               std::vector<DexMethodRef*>* mrefs,
+                               std::vector<DexType*>* trefs) {
+  m_stats.method_size_too_small += plan.methods_too_small;
+  if (!plan.relocatable) {
+    return;
+  }
+  m_delayed_visibility_changes->insert(plan.visibility_changes);
+
+  SplitClass& sc = m_split_classes[cls];
+  always_assert(sc.relocatable_methods.empty());
+  for (auto& candidate : plan.candidates) {
+    auto* method = candidate.method;
+    auto api_level = candidate.api_level;
     DexClass* target_cls;
-    int api_level = api::LevelChecker::get_method_level(method);
     if (m_config.combine_target_classes_by_api_level) {
       TargetClassInfo& target_class_info =
           m_target_classes_by_api_level[api_level];
@@ -233,7 +256,7 @@ void ClassSplitter::prepare(const DexClass* cls,
       }
     }
     DexMethod* trampoline_target_method = nullptr;
-    if (requires_trampoline) {
+    if (candidate.requires_trampoline) {
       trampoline_target_method =
           create_trampoline_method(method, target_cls, api_level);
     }
@@ -251,11 +274,24 @@ void ClassSplitter::prepare(const DexClass* cls,
     if (m_instrumentation_callback.target<void (*)(DexMethod*)>() != nullptr) {
       m_instrumentation_callback(method);
     }
-  };
-  auto& dmethods = cls->get_dmethods();
-  std::for_each(dmethods.begin(), dmethods.end(), process_method);
-  auto& vmethods = cls->get_vmethods();
-  std::for_each(vmethods.begin(), vmethods.end(), process_method);
+  }
+}
+
+void ClassSplitter::prepare(const DexClass* cls,
+                            std::vector<DexMethodRef*>* mrefs,
+                            std::vector<DexType*>* trefs) {
+  apply_plan(cls, plan_class(cls), mrefs, trefs);
+}
+
+void ClassSplitter::prepare(const std::vector<DexClass*>& classes) {
+  std::vector<ClassPlan> plans(classes.size());
+  workqueue_run_for<size_t>(0, classes.size(), [&](size_t i) {
+    plans[i] = plan_class(classes[i]);
+  });
+  // Target classes get created and filled in class order, as before.
+  for (size_t i = 0; i < classes.size(); ++i) {
+    apply_plan(classes[i], plans[i], nullptr, nullptr);
+  }
 }
 
 DexClasses ClassSplitter::additional_classes(const DexClasses& classes) {
@@ -318,7 +354,8 @@ DexClasses ClassSplitter::additional_classes(const DexClasses& classes) {
       const RelocatableMethodInfo& method_info = it->second;
       bool requires_trampoline{false};
       if (!can_relocate(cls_has_problematic_clinit, method, /* log */ false,
-                        &requires_trampoline)) {
+                        &requires_trampoline,
+                        m_delayed_visibility_changes.get())) {
         TRACE(CS,
               4,
               "[class splitting] Method earlier identified as relocatable is "
@@ -399,14 +436,14 @@ void ClassSplitter::materialize_trampoline_code(DexMethod* source,
   target->set_code(
       std::make_unique<IRCode>(std::make_unique<cfg::ControlFlowGraph>()));
   auto code = source->get_code();
-  auto& cfg = code->cfg();
+  auto& source_cfg = code->cfg();
   auto& target_cfg = target->get_code()->cfg();
-  cfg.deep_copy(&target_cfg);
+  source_cfg.deep_copy(&target_cfg);
   code->clear_cfg();
   source->set_code(
       std::make_unique<IRCode>(std::make_unique<cfg::ControlFlowGraph>()));
   // Create a new block containing all the load instructions.
-  cfg = source->get_code()->cfg();
+  auto& cfg = source->get_code()->cfg();
   cfg::Block* new_block = cfg.create_block();
   auto invoke_insn = new IRInstruction(OPCODE_INVOKE_STATIC);
   invoke_insn->set_method(target);
@@ -466,8 +503,13 @@ void ClassSplitter::cleanup(const Scope& final_scope) {
     }
   }
 
+  // Making members public may require turning further direct methods static.
+  // Relocated methods are made static anyway.
+  delayed_visibility_changes_apply(methods_to_staticize);
+
   // We now rewrite all invoke-instructions as needed to reflect the fact that
-  // we made some methods static as part of the relocation effort.
+  // we made some methods static as part of the relocation effort, or to make
+  // members public, in a single walk.
   std::unordered_map<IROpcode, std::atomic<size_t>, boost::hash<IROpcode>>
       rewritten_invokes;
   for (IROpcode op :
@@ -488,6 +530,11 @@ void ClassSplitter::cleanup(const Scope& final_scope) {
             insn->set_opcode(OPCODE_INVOKE_STATIC);
             insn->set_method(resolved_method);
             rewritten_invokes.at(op)++;
+          } else if (op == OPCODE_INVOKE_DIRECT) {
+            auto m = insn->get_method()->as_def();
+            if (m && m_delayed_make_static.count(m)) {
+              insn->set_opcode(OPCODE_INVOKE_STATIC);
+            }
           }
           break;
         }
@@ -535,9 +582,7 @@ void ClassSplitter::cleanup(const Scope& final_scope) {
     materialize_trampoline_code(p.first, p.second);
   }
 
-  delayed_visibility_changes_apply();
-  delayed_invoke_direct_to_static(final_scope);
-  m_delayed_make_static.clear();
+  delayed_make_static();
 
   m_mgr.incr_metric(METRIC_RELOCATION_CLASSES, m_stats.relocation_classes);
   m_mgr.incr_metric(METRIC_RELOCATED_STATIC_METHODS,
@@ -611,7 +656,8 @@ bool ClassSplitter::has_unresolvable_or_external_field_ref(const DexMethod* m) {
 bool ClassSplitter::can_relocate(bool cls_has_problematic_clinit,
                                  const DexMethod* m,
                                  bool log,
-                                 bool* requires_trampoline) {
+                                 bool* requires_trampoline,
+                                 VisibilityChanges* visibility_changes) {
   *requires_trampoline = false;
   if (!m->is_concrete() || m->is_external() || !m->get_code()) {
     return false;
@@ -717,21 +763,22 @@ bool ClassSplitter::can_relocate(bool cls_has_problematic_clinit,
     }
     return false;
   }
-  VisibilityChanges visibility_changes = get_visibility_changes(m);
-  if (!visibility_changes.empty()) {
-    m_delayed_visibility_changes->insert(visibility_changes);
+  VisibilityChanges method_visibility_changes = get_visibility_changes(m);
+  if (!method_visibility_changes.empty()) {
+    visibility_changes->insert(method_visibility_changes);
   }
   return true;
 }
 
-void ClassSplitter::delayed_visibility_changes_apply() {
+void ClassSplitter::delayed_visibility_changes_apply(
+    const std::unordered_set<DexMethod*>& methods_to_staticize) {
   m_delayed_visibility_changes->apply();
   // any method that was just made public and isn't virtual or a constructor or
   // static must be made static
   for (auto method : m_delayed_visibility_changes->methods) {
     always_assert(is_public(method));
     if (!method->is_virtual() && !method::is_init(method) &&
-        !is_static(method)) {
+        !is_static(method) && !methods_to_staticize.count(method)) {
       always_assert(can_rename(method));
       always_assert(method->is_concrete());
       m_delayed_make_static.insert(method);
@@ -739,7 +786,7 @@ void ClassSplitter::delayed_visibility_changes_apply() {
   }
 }
 
-void ClassSplitter::delayed_invoke_direct_to_static(const Scope& final_scope) {
+void ClassSplitter::delayed_make_static() {
   if (m_delayed_make_static.empty()) {
     return;
   }
@@ -766,17 +813,6 @@ void ClassSplitter::delayed_invoke_direct_to_static(const Scope& final_scope) {
     TRACE(MMINL, 6, "making %s static", method->get_name()->c_str());
     mutators::make_static(method);
   }
-  walk::parallel::opcodes(
-      final_scope, [](DexMethod* meth) { return true; },
-      [&](DexMethod*, IRInstruction* insn) {
-        auto op = insn->opcode();
-        if (op == OPCODE_INVOKE_DIRECT) {
-          auto m = insn->get_method()->as_def();
-          if (m && m_delayed_make_static.count(m)) {
-            insn->set_opcode(OPCODE_INVOKE_STATIC);
-          }
-        }
-      });
   m_delayed_make_static.clear();
 }
 
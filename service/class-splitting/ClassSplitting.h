@@ -100,6 +100,9 @@ class ClassSplitter final {
   void prepare(const DexClass* cls,
                std::vector<DexMethodRef*>* mrefs,
                std::vector<DexType*>* trefs);
+  // Same as preparing each class in order, but the relocation candidates of
+  // all classes are determined in parallel.
+  void prepare(const std::vector<DexClass*>& classes);
   DexClasses additional_classes(const DexClasses& classes);
   void cleanup(const Scope& final_scope);
 
@@ -116,6 +119,21 @@ class ClassSplitter final {
     std::unordered_map<DexMethod*, RelocatableMethodInfo> relocatable_methods;
   };
 
+  struct RelocationCandidate {
+    DexMethod* method;
+    bool requires_trampoline;
+    int32_t api_level;
+  };
+
+  // What prepare() decides about a class before any target class gets chosen,
+  // which only depends on the class itself.
+  struct ClassPlan {
+    bool relocatable{false};
+    std::vector<RelocationCandidate> candidates;
+    VisibilityChanges visibility_changes;
+    size_t methods_too_small{0};
+  };
+
   struct TargetClassInfo {
     DexClass* target_cls{nullptr};
     const DexClass* last_source_cls{nullptr};
@@ -128,7 +146,13 @@ class ClassSplitter final {
   bool can_relocate(bool cls_has_problematic_clinit,
                     const DexMethod* m,
                     bool log,
-                    bool* requires_trampoline);
+                    bool* requires_trampoline,
+                    VisibilityChanges* visibility_changes);
+  ClassPlan plan_class(const DexClass* cls);
+  void apply_plan(const DexClass* cls,
+                  const ClassPlan& plan,
+                  std::vector<DexMethodRef*>* mrefs,
+                  std::vector<DexType*>* trefs);
   DexClass* create_target_class(const std::string& target_type_name);
   DexMethod* create_trampoline_method(DexMethod* method,
                                       DexClass* target_cls,
@@ -165,15 +189,17 @@ class ClassSplitter final {
 
   /**
    * Change visibilities of methods, assuming that`m_visibility_changes` is
-   * non-null.
+   * non-null, and collect the direct methods that must become static as a
+   * result, except for the given ones.
    */
-  void delayed_visibility_changes_apply();
+  void delayed_visibility_changes_apply(
+      const std::unordered_set<DexMethod*>& methods_to_staticize);
 
   /**
-   * Staticize required methods (stored in `m_delayed_make_static`) and update
-   * opcodes accordingly.
+   * Staticize required methods (stored in `m_delayed_make_static`). Their
+   * invokes are rewritten as part of the walk in cleanup().
    */
-  void delayed_invoke_direct_to_static(const Scope& final_scope);
+  void delayed_make_static();
 };
 
 } // namespace class_splitting
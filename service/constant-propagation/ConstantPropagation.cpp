@@ -31,7 +31,13 @@ Transform::Stats ConstantPropagation::run(DexMethod* method,
   {
     intraprocedural::FixpointIterator fp_iter(&state, *cfg,
                                               ConstantPrimitiveAnalyzer());
+    fp_iter.set_step_budget(m_config.fixpoint_step_budget);
     fp_iter.run({});
+    if (fp_iter.has_exceeded_step_budget()) {
+      TRACE(CONSTP, 1, "Exceeded the fixpoint step budget: %s", SHOW(method));
+      m_methods_over_budget.insert(method);
+      return local_stats;
+    }
     constant_propagation::Transform tf(m_config.transform, state);
     tf.apply(fp_iter, WholeProgramState(), code->cfg(), xstores,
              is_static(method), method->get_class(), method->get_proto());
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "ConcurrentContainers.h"
 #include "ConstantPropagationState.h"
 #include "ConstantPropagationTransform.h"
 #include "IRCode.h"
@@ -15,6 +16,9 @@ namespace constant_propagation {
 
 struct Config {
   Transform::Config transform;
+  // The maximum number of block analyses of the fixpoint iteration of a
+  // method, or 0 for no limit. Methods that exceed it are left unchanged.
+  uint64_t fixpoint_step_budget{0};
 };
 
 class ConstantPropagation final {
@@ -28,7 +32,14 @@ class ConstantPropagation final {
                        const XStoreRefs* xstores,
                        const State& state);
 
+  // The methods that were given up on, as their analysis did not converge
+  // within the fixpoint step budget.
+  const ConcurrentSet<const DexMethod*>& get_methods_over_budget() const {
+    return m_methods_over_budget;
+  }
+
  private:
   const Config& m_config;
+  ConcurrentSet<const DexMethod*> m_methods_over_budget;
 };
 } // namespace constant_propagation
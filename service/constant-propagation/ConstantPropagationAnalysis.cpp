@@ -1561,7 +1561,10 @@ FixpointIterator::FixpointIterator(
     : BaseEdgeAwareIRAnalyzer(cfg),
       m_insn_analyzer(std::move(insn_analyzer)),
       m_state(state),
-      m_imprecise_switches(imprecise_switches) {}
+      m_imprecise_switches(imprecise_switches) {
+  ir_analyzer::retain_entry_states_only_if_large(cfg, this);
+  ir_analyzer::run_in_parallel_if_large(cfg, this);
+}
 
 void FixpointIterator::analyze_instruction_normal(
     const IRInstruction* insn, ConstantEnvironment* env) const {
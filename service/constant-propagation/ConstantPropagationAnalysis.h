@@ -8,6 +8,7 @@
 #pragma once
 
 #include <limits>
+#include <mutex>
 #include <unordered_set>
 #include <utility>
 
@@ -43,7 +44,10 @@ class FixpointIterator final
                    InstructionAnalyzer<ConstantEnvironment> insn_analyzer,
                    bool imprecise_switches = false);
 
-  void clear_switch_succ_cache() const { m_switch_succs.clear(); }
+  void clear_switch_succ_cache() const {
+    std::lock_guard<std::mutex> lock(m_switch_succs_mutex);
+    m_switch_succs.clear();
+  }
 
  protected:
   void analyze_instruction_normal(const IRInstruction* insn,
@@ -62,12 +66,15 @@ class FixpointIterator final
 
  private:
   using SwitchSuccs = std::unordered_map<int32_t, uint32_t>;
+  // Switch edges of the same method may be analyzed concurrently.
+  mutable std::mutex m_switch_succs_mutex;
   mutable std::unordered_map<cfg::Block*, SwitchSuccs> m_switch_succs;
   InstructionAnalyzer<ConstantEnvironment> m_insn_analyzer;
   const State* m_state;
   const bool m_imprecise_switches;
 
   const SwitchSuccs& find_switch_succs(cfg::Block* block) const {
+    std::lock_guard<std::mutex> lock(m_switch_succs_mutex);
     auto it = m_switch_succs.find(block);
     if (it == m_switch_succs.end()) {
       std::vector<int32_t> keys;
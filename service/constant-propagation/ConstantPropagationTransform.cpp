@@ -908,7 +908,7 @@ void Transform::forward_targets(
     const ConstantEnvironment& env,
     cfg::ControlFlowGraph& cfg,
     cfg::Block* block,
-    std::unique_ptr<LivenessFixpointIterator>& liveness_fixpoint_iter) {
+    std::unique_ptr<LivenessQuery>& liveness) {
   always_assert(!env.is_bottom());
   // normal edges are of type goto or branch, not throw or ghost
   auto is_normal = [](const cfg::Edge* e) {
@@ -990,27 +990,20 @@ void Transform::forward_targets(
 
   // Helper to check if any assigned register is live at the target block
   auto is_any_assigned_reg_live_at_target =
-      [&liveness_fixpoint_iter,
-       &cfg](const TargetAndAssignedRegs& unconditional_target) {
+      [&liveness, &cfg](const TargetAndAssignedRegs& unconditional_target) {
         auto& assigned_regs = unconditional_target.assigned_regs;
         if (assigned_regs.empty()) {
           return false;
         }
-        if (!liveness_fixpoint_iter) {
-          liveness_fixpoint_iter.reset(new LivenessFixpointIterator(cfg));
-          liveness_fixpoint_iter->run(LivenessDomain());
+        if (!liveness) {
+          liveness = std::make_unique<LivenessQuery>(cfg);
         }
-        const auto& live_in_vars = liveness_fixpoint_iter->get_live_in_vars_at(
-            unconditional_target.target);
-        if (live_in_vars.is_bottom()) {
-          // Could happen after having applied other transformations already
-          return true;
-        }
-        always_assert(!live_in_vars.is_top());
-        auto& elements = live_in_vars.elements();
+        // Blocks without liveness information could happen after having
+        // applied other transformations already, and are treated as live.
         return std::find_if(assigned_regs.begin(), assigned_regs.end(),
-                            [&elements](reg_t reg) {
-                              return elements.contains(reg);
+                            [&](reg_t reg) {
+                              return liveness->may_be_live_in(
+                                  unconditional_target.target, reg);
                             }) != assigned_regs.end();
       };
 
@@ -1203,7 +1196,7 @@ void Transform::legacy_apply_forward_targets(
 
   // Note that the given intra_cp might not be aware of all blocks that exist in
   // the cfg.
-  std::unique_ptr<LivenessFixpointIterator> liveness_fixpoint_iter;
+  std::unique_ptr<LivenessQuery> liveness;
   for (auto block : cfg.blocks()) {
     const auto& env = intra_cp.get_exit_state_at(block);
     if (env.is_bottom()) {
@@ -1211,7 +1204,7 @@ void Transform::legacy_apply_forward_targets(
       // intra_cp has run; just ignore it.
       continue;
     }
-    forward_targets(intra_cp, env, cfg, block, liveness_fixpoint_iter);
+    forward_targets(intra_cp, env, cfg, block, liveness);
   }
 }
 
@@ -12,8 +12,8 @@
 #include "ConstantPropagationAnalysis.h"
 #include "ConstantPropagationState.h"
 #include "ConstantPropagationWholeProgramState.h"
+#include "DenseLiveness.h"
 #include "IRCode.h"
-#include "Liveness.h"
 #include "NullPointerExceptionUtil.h"
 
 class ScopedMetrics;
@@ -152,7 +152,7 @@ class Transform final {
       const ConstantEnvironment&,
       cfg::ControlFlowGraph&,
       cfg::Block*,
-      std::unique_ptr<LivenessFixpointIterator>& liveness_fixpoint_iter);
+      std::unique_ptr<LivenessQuery>& liveness);
 
   // Check whether the code can return a value of a unavailable/external type,
   // or a type defined in a store different from the one where the method is
@@ -192,20 +192,40 @@ void WholeProgramState::collect(
       return;
     }
     auto& cfg = code->cfg();
-    auto ipa = fp_iter.get_intraprocedural_analysis(method);
-    auto& intra_cp = ipa->fp_iter;
-    for (cfg::Block* b : cfg.blocks()) {
-      auto env = intra_cp.get_entry_state_at(b);
-      auto last_insn = b->get_last_insn();
-      for (auto& mie : InstructionIterable(b)) {
-        auto* insn = mie.insn;
-        intra_cp.analyze_instruction(insn, &env, insn == last_insn->insn);
-        collect_field_values(insn, env,
-                             method::is_clinit(method) ? method->get_class()
-                                                       : nullptr,
-                             &fields_value_tmp);
-        collect_return_values(insn, env, method, &methods_value_tmp);
-      }
+    // The values only need to be recomputed when the entry arguments of the
+    // method, or what it reads from the previous WholeProgramState, changed.
+    auto values = fp_iter.get_collected_values(
+        method, [&](interprocedural::IntraproceduralAnalysis* ipa) {
+          MethodCollectedValues res;
+          auto& intra_cp = ipa->fp_iter;
+          const auto* clinit_cls =
+              method::is_clinit(method) ? method->get_class() : nullptr;
+          for (cfg::Block* b : cfg.blocks()) {
+            auto env = intra_cp.get_entry_state_at(b);
+            auto last_insn = b->get_last_insn();
+            for (auto& mie : InstructionIterable(b)) {
+              auto* insn = mie.insn;
+              intra_cp.analyze_instruction(insn, &env,
+                                           insn == last_insn->insn);
+              collect_field_values(insn, env, clinit_cls, &res);
+              collect_return_values(insn, env, &res);
+            }
+          }
+          return res;
+        });
+    for (const auto& [field, value] : values->field_values) {
+      fields_value_tmp.update(
+          field, [&value](const DexField*, ConstantValue& current_value,
+                          bool exists) {
+            if (exists) {
+              current_value.join_with(value);
+            } else {
+              current_value = value;
+            }
+          });
+    }
+    if (values->return_value) {
+      methods_value_tmp.emplace(method, *values->return_value);
     }
   });
   for (const auto& pair : fields_value_tmp) {
@@ -229,11 +249,10 @@ void WholeProgramState::collect(
  * visible to other methods if it remains unchanged up until the end of the
  * <clinit>. In that case, analyze_clinits() will record it.
  */
-void WholeProgramState::collect_field_values(
-    const IRInstruction* insn,
-    const ConstantEnvironment& env,
-    const DexType* clinit_cls,
-    ConcurrentMap<const DexField*, ConstantValue>* fields_value_tmp) {
+void WholeProgramState::collect_field_values(const IRInstruction* insn,
+                                             const ConstantEnvironment& env,
+                                             const DexType* clinit_cls,
+                                             MethodCollectedValues* values) {
   if (!opcode::is_an_sput(insn->opcode()) &&
       !opcode::is_an_iput(insn->opcode())) {
     return;
@@ -245,15 +264,10 @@ void WholeProgramState::collect_field_values(
       return;
     }
     auto value = env.get(insn->src(0));
-    fields_value_tmp->update(
-        field,
-        [&value](const DexField*, ConstantValue& current_value, bool exists) {
-          if (exists) {
-            current_value.join_with(value);
-          } else {
-            current_value = std::move(value);
-          }
-        });
+    auto [it, emplaced] = values->field_values.emplace(field, value);
+    if (!emplaced) {
+      it->second.join_with(value);
+    }
   }
 }
 
@@ -263,11 +277,9 @@ void WholeProgramState::collect_field_values(
  * If there are no reachable return opcodes in the method, then it never
  * returns. Its return value will be represented by Bottom in our analysis.
  */
-void WholeProgramState::collect_return_values(
-    const IRInstruction* insn,
-    const ConstantEnvironment& env,
-    const DexMethod* method,
-    ConcurrentMap<const DexMethod*, ConstantValue>* methods_value_tmp) {
+void WholeProgramState::collect_return_values(const IRInstruction* insn,
+                                              const ConstantEnvironment& env,
+                                              MethodCollectedValues* values) {
   auto op = insn->opcode();
   if (!opcode::is_a_return(op)) {
     return;
@@ -277,23 +289,15 @@ void WholeProgramState::collect_return_values(
     // does indeed return -- even though `void` is not actually a return value,
     // this tells us that the code following any invoke of this method is
     // reachable.
-    methods_value_tmp->update(
-        method,
-        [](const DexMethod*, ConstantValue& current_value, bool /* exists */) {
-          current_value = ConstantValue::top();
-        });
+    values->return_value = ConstantValue::top();
     return;
   }
   auto value = env.get(insn->src(0));
-  methods_value_tmp->update(
-      method,
-      [&value](const DexMethod*, ConstantValue& current_value, bool exists) {
-        if (exists) {
-          current_value.join_with(value);
-        } else {
-          current_value = std::move(value);
-        }
-      });
+  if (values->return_value) {
+    values->return_value->join_with(value);
+  } else {
+    values->return_value = std::move(value);
+  }
 }
 
 void WholeProgramState::collect_static_finals(const DexClass* cls,
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
 #include <sparta/HashedAbstractPartition.h>
 
 #include "CallGraph.h"
@@ -31,6 +32,16 @@ using ConstantFieldPartition =
 using ConstantMethodPartition =
     sparta::HashedAbstractPartition<const DexMethod*, ConstantValue>;
 
+/*
+ * The values that a single method writes to known fields and returns, which a
+ * WholeProgramState joins over all methods.
+ */
+struct MethodCollectedValues {
+  std::unordered_map<const DexField*, ConstantValue> field_values;
+  // None if the method has no reachable return.
+  boost::optional<ConstantValue> return_value;
+};
+
 /*
  * This class contains flow-insensitive information about fields and method
  * return values, i.e. it can tells us if a field or a return value is constant
@@ -132,17 +143,14 @@ class WholeProgramState {
       const interprocedural::FixpointIterator& fp_iter,
       const std::unordered_set<const DexField*>& definitely_assigned_ifields);
 
-  void collect_field_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexType* clinit_cls,
-      ConcurrentMap<const DexField*, ConstantValue>* fields_value_tmp);
+  void collect_field_values(const IRInstruction* insn,
+                            const ConstantEnvironment& env,
+                            const DexType* clinit_cls,
+                            MethodCollectedValues* values);
 
-  void collect_return_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, ConstantValue>* methods_value_tmp);
+  void collect_return_values(const IRInstruction* insn,
+                             const ConstantEnvironment& env,
+                             MethodCollectedValues* values);
 
   std::shared_ptr<const call_graph::Graph> m_call_graph;
 
@@ -46,6 +46,14 @@ FixpointIterator::~FixpointIterator() {
     wq.add_item(method);
   }
   wq.run_all();
+  auto values_wq = workqueue_foreach<const DexMethod*>(
+      [&](const DexMethod* method) {
+        m_collected_values_cache.at_unsafe(method).reset();
+      });
+  for (auto&& [method, entry] : m_collected_values_cache) {
+    values_wq.add_item(method);
+  }
+  values_wq.run_all();
 }
 
 void FixpointIterator::analyze_node(call_graph::NodeId const& node,
@@ -146,6 +154,36 @@ FixpointIterator::get_intraprocedural_analysis(const DexMethod* method) const {
       method, this->get_whole_program_state(), get_entry_args(method));
 }
 
+std::shared_ptr<const MethodCollectedValues>
+FixpointIterator::get_collected_values(const DexMethod* method,
+                                       const CollectValuesFn& collect) const {
+  const auto& args = get_entry_args(method);
+  auto entry = m_collected_values_cache.get(method, nullptr);
+  if (entry && entry->args.equals(args) &&
+      wps_accessor_record_matches(entry->wps_accessor_record)) {
+    std::lock_guard<std::mutex> lock_guard(m_stats_mutex);
+    m_stats.collected_values_cache_hits++;
+    return entry->values;
+  }
+
+  auto ipa = get_intraprocedural_analysis(method);
+  WholeProgramStateAccessorRecord record;
+  if (ipa->wps_accessor) {
+    ipa->wps_accessor->start_recording(&record);
+  }
+  auto values = std::make_shared<const MethodCollectedValues>(collect(&*ipa));
+  if (ipa->wps_accessor) {
+    ipa->wps_accessor->stop_recording();
+  }
+  m_collected_values_cache.insert_or_assign(std::make_pair(
+      method,
+      std::make_shared<const CollectedValuesCacheEntry>(
+          (CollectedValuesCacheEntry){args, std::move(record), values})));
+  std::lock_guard<std::mutex> lock_guard(m_stats_mutex);
+  m_stats.collected_values_cache_misses++;
+  return values;
+}
+
 IntraproceduralAnalysis::IntraproceduralAnalysis(
     const State* cp_state,
     std::unique_ptr<WholeProgramStateAccessor> wps_accessor,
@@ -175,25 +213,22 @@ FixpointIterator::MethodCache& FixpointIterator::get_method_cache(
   return *method_cache;
 }
 
-bool FixpointIterator::method_cache_entry_matches(
-    const MethodCacheEntry& mce, const ArgumentDomain& args) const {
-  if (!mce.args.equals(args)) {
-    return false;
-  }
+bool FixpointIterator::wps_accessor_record_matches(
+    const WholeProgramStateAccessorRecord& record) const {
   if (m_wps->has_call_graph()) {
-    for (auto&& [method, val] : mce.wps_accessor_record.method_dependencies) {
+    for (auto&& [method, val] : record.method_dependencies) {
       if (!m_wps->get_method_partition().get(method).equals(val)) {
         return false;
       }
     }
   } else {
-    for (auto&& [method, val] : mce.wps_accessor_record.method_dependencies) {
+    for (auto&& [method, val] : record.method_dependencies) {
       if (!m_wps->get_return_value(method).equals(val)) {
         return false;
       }
     }
   }
-  for (auto&& [field, val] : mce.wps_accessor_record.field_dependencies) {
+  for (auto&& [field, val] : record.field_dependencies) {
     if (!m_wps->get_field_value(field).equals(val)) {
       return false;
     }
@@ -201,6 +236,12 @@ bool FixpointIterator::method_cache_entry_matches(
   return true;
 }
 
+bool FixpointIterator::method_cache_entry_matches(
+    const MethodCacheEntry& mce, const ArgumentDomain& args) const {
+  return mce.args.equals(args) &&
+         wps_accessor_record_matches(mce.wps_accessor_record);
+}
+
 const FixpointIterator::MethodCacheEntry*
 FixpointIterator::find_matching_method_cache_entry(
     MethodCache& method_cache, const ArgumentDomain& args) const {
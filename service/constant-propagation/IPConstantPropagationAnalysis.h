@@ -83,6 +83,8 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   struct Stats {
     size_t method_cache_hits{0};
     size_t method_cache_misses{0};
+    size_t collected_values_cache_hits{0};
+    size_t collected_values_cache_misses{0};
   };
   FixpointIterator(
       std::shared_ptr<const call_graph::Graph> call_graph,
@@ -107,6 +109,19 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   std::unique_ptr<IntraproceduralAnalysis> get_intraprocedural_analysis(
       const DexMethod*) const;
 
+  using CollectValuesFn =
+      std::function<MethodCollectedValues(IntraproceduralAnalysis*)>;
+
+  /*
+   * Returns what `collect` computes from the intraprocedural analysis of the
+   * method. The result of a previous call is reused as long as the entry
+   * arguments of the method and the parts of the whole program state that the
+   * analysis read are unchanged, so that later rounds of building a
+   * WholeProgramState only re-analyze the methods affected by the last round.
+   */
+  std::shared_ptr<const MethodCollectedValues> get_collected_values(
+      const DexMethod* method, const CollectValuesFn& collect) const;
+
   const WholeProgramState& get_whole_program_state() const { return *m_wps; }
 
   void set_whole_program_state(std::unique_ptr<WholeProgramState> wps) {
@@ -133,6 +148,18 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
 
   MethodCache& get_method_cache(const DexMethod* method) const;
 
+  struct CollectedValuesCacheEntry {
+    ArgumentDomain args;
+    WholeProgramStateAccessorRecord wps_accessor_record;
+    std::shared_ptr<const MethodCollectedValues> values;
+  };
+  mutable ConcurrentMap<const DexMethod*,
+                        std::shared_ptr<const CollectedValuesCacheEntry>>
+      m_collected_values_cache;
+
+  bool wps_accessor_record_matches(
+      const WholeProgramStateAccessorRecord& record) const;
+
   bool method_cache_entry_matches(const MethodCacheEntry& mce,
                                   const ArgumentDomain& args) const;
 
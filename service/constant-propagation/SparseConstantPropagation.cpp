@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SparseConstantPropagation.h"
+
+#include <boost/optional.hpp>
+
+#include "IRInstruction.h"
+#include "Show.h"
+#include "Trace.h"
+
+// While undefined behavior C++-wise, the two's complement implementation of
+// modern processors matches the required Java semantics. So silence ubsan.
+#if defined(__clang__)
+#define NO_UBSAN_ARITH \
+  __attribute__((no_sanitize("signed-integer-overflow", "shift")))
+#else
+#define NO_UBSAN_ARITH
+#endif
+
+namespace {
+
+/*
+ * Keep the values in a lattice of finite height, so that every definition
+ * only changes a bounded number of times: bottom, constants, non-zero, top.
+ */
+SignedConstantDomain normalize(const SignedConstantDomain& value) {
+  if (value.is_bottom() || value.get_constant()) {
+    return value;
+  }
+  return value.is_nez() ? SignedConstantDomain::nez()
+                        : SignedConstantDomain::top();
+}
+
+// The same folding as PrimitiveAnalyzer::analyze_binop_lit.
+boost::optional<int64_t> fold_binop_lit(IROpcode op,
+                                        int64_t cst,
+                                        int32_t lit) NO_UBSAN_ARITH {
+  switch (op) {
+  case OPCODE_ADD_INT_LIT:
+    return cst + lit;
+  case OPCODE_RSUB_INT_LIT:
+    return lit - cst;
+  case OPCODE_MUL_INT_LIT:
+    return cst * lit;
+  case OPCODE_DIV_INT_LIT:
+    return lit != 0 ? boost::optional<int64_t>(cst / lit) : boost::none;
+  case OPCODE_REM_INT_LIT:
+    return lit != 0 ? boost::optional<int64_t>(cst % lit) : boost::none;
+  case OPCODE_AND_INT_LIT:
+    return cst & lit;
+  case OPCODE_OR_INT_LIT:
+    return cst | lit;
+  case OPCODE_XOR_INT_LIT:
+    return cst ^ lit;
+  case OPCODE_SHL_INT_LIT:
+    return (int32_t)((uint32_t)cst << (lit & 0x1f));
+  case OPCODE_SHR_INT_LIT:
+    return cst >> (lit & 0x1f);
+  case OPCODE_USHR_INT_LIT:
+    return (uint32_t)cst >> (lit & 0x1f);
+  default:
+    return boost::none;
+  }
+}
+
+// The same folding as PrimitiveAnalyzer::analyze_binop.
+boost::optional<int64_t> fold_binop(IROpcode op,
+                                    int64_t left,
+                                    int64_t right) NO_UBSAN_ARITH {
+  switch (op) {
+  case OPCODE_ADD_INT:
+  case OPCODE_ADD_LONG:
+    return left + right;
+  case OPCODE_SUB_INT:
+  case OPCODE_SUB_LONG:
+    return left - right;
+  case OPCODE_MUL_INT:
+  case OPCODE_MUL_LONG:
+    return left * right;
+  case OPCODE_DIV_INT:
+  case OPCODE_DIV_LONG:
+    return right != 0 ? boost::optional<int64_t>(left / right) : boost::none;
+  case OPCODE_REM_INT:
+  case OPCODE_REM_LONG:
+    return right != 0 ? boost::optional<int64_t>(left % right) : boost::none;
+  case OPCODE_AND_INT:
+  case OPCODE_AND_LONG:
+    return left & right;
+  case OPCODE_OR_INT:
+  case OPCODE_OR_LONG:
+    return left | right;
+  case OPCODE_XOR_INT:
+  case OPCODE_XOR_LONG:
+    return left ^ right;
+  default:
+    return boost::none;
+  }
+}
+
+boost::optional<bool> compare(IROpcode op, int64_t left, int64_t right) {
+  switch (op) {
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_EQZ:
+    return left == right;
+  case OPCODE_IF_NE:
+  case OPCODE_IF_NEZ:
+    return left != right;
+  case OPCODE_IF_LT:
+  case OPCODE_IF_LTZ:
+    return left < right;
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GEZ:
+    return left >= right;
+  case OPCODE_IF_GT:
+  case OPCODE_IF_GTZ:
+    return left > right;
+  case OPCODE_IF_LE:
+  case OPCODE_IF_LEZ:
+    return left <= right;
+  default:
+    not_reached_log("Unexpected conditional branch %s", SHOW(op));
+  }
+}
+
+/*
+ * Whether a conditional branch is taken, if that is known.
+ */
+boost::optional<bool> evaluate_condition(IROpcode op,
+                                         const SignedConstantDomain& left,
+                                         const SignedConstantDomain& right) {
+  auto left_cst = left.get_constant();
+  auto right_cst = right.get_constant();
+  if (left_cst && right_cst) {
+    return compare(op, *left_cst, *right_cst);
+  }
+  // A non-zero value is known to differ from zero.
+  if ((left.is_nez() && right_cst && *right_cst == 0) ||
+      (right.is_nez() && left_cst && *left_cst == 0)) {
+    switch (op) {
+    case OPCODE_IF_EQ:
+    case OPCODE_IF_EQZ:
+      return false;
+    case OPCODE_IF_NE:
+    case OPCODE_IF_NEZ:
+      return true;
+    default:
+      break;
+    }
+  }
+  return boost::none;
+}
+
+} // namespace
+
+namespace constant_propagation {
+
+SparseConstantAnalysis::SparseConstantAnalysis(
+    const cfg::ControlFlowGraph& cfg) {
+  {
+    live_range::MoveAwareChains chains(cfg, /* ignore_unreachable */ true);
+    m_use_def_chains = chains.get_use_def_chains();
+    m_def_use_chains = chains.get_def_use_chains();
+  }
+  for (auto* block : cfg.blocks()) {
+    for (auto& mie : InstructionIterable(block)) {
+      m_insn_blocks.emplace(mie.insn, block);
+    }
+  }
+
+  auto* entry = cfg.entry_block();
+  m_executable_blocks.insert(entry);
+  m_block_worklist.push_back(entry);
+  while (!m_block_worklist.empty() || !m_insn_worklist.empty()) {
+    if (!m_block_worklist.empty()) {
+      auto* block = m_block_worklist.back();
+      m_block_worklist.pop_back();
+      for (auto& mie : InstructionIterable(block)) {
+        visit_instruction(mie.insn);
+      }
+      visit_successors(block);
+      continue;
+    }
+    auto* insn = m_insn_worklist.back();
+    m_insn_worklist.pop_back();
+    auto* block = m_insn_blocks.at(insn);
+    // Instructions of blocks that are not executable yet will be visited
+    // when their block becomes executable.
+    if (!is_executable(block)) {
+      continue;
+    }
+    visit_instruction(insn);
+    auto op = insn->opcode();
+    if (opcode::is_a_conditional_branch(op) || opcode::is_switch(op)) {
+      visit_successors(block);
+    }
+  }
+}
+
+SignedConstantDomain SparseConstantAnalysis::get_value(
+    const IRInstruction* insn, src_index_t src_index) const {
+  auto* block = m_insn_blocks.at(insn);
+  if (!is_executable(block)) {
+    return SignedConstantDomain::bottom();
+  }
+  auto it = m_use_def_chains.find(
+      live_range::Use{const_cast<IRInstruction*>(insn), src_index});
+  if (it == m_use_def_chains.end()) {
+    return SignedConstantDomain::top();
+  }
+  auto value = SignedConstantDomain::bottom();
+  for (auto* def : it->second) {
+    value.join_with(get_def_value(def));
+  }
+  return normalize(value);
+}
+
+SignedConstantDomain SparseConstantAnalysis::get_def_value(
+    const IRInstruction* insn) const {
+  auto it = m_values.find(insn);
+  return it == m_values.end() ? SignedConstantDomain::bottom() : it->second;
+}
+
+SignedConstantDomain SparseConstantAnalysis::evaluate(
+    const IRInstruction* insn) const {
+  auto op = insn->opcode();
+  std::vector<SignedConstantDomain> srcs;
+  srcs.reserve(insn->srcs_size());
+  for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+    srcs.push_back(get_value(insn, i));
+    // Wait until all operands have been defined.
+    if (srcs.back().is_bottom()) {
+      return SignedConstantDomain::bottom();
+    }
+  }
+
+  switch (op) {
+  case OPCODE_CONST:
+  case OPCODE_CONST_WIDE:
+    return SignedConstantDomain(insn->get_literal());
+  case OPCODE_NEW_ARRAY:
+  case OPCODE_FILLED_NEW_ARRAY:
+  case OPCODE_NEW_INSTANCE:
+  case OPCODE_CONST_STRING:
+  case OPCODE_CONST_CLASS:
+  case OPCODE_MOVE_EXCEPTION:
+    return SignedConstantDomain::nez();
+  case OPCODE_CHECK_CAST:
+  case OPCODE_INSTANCE_OF: {
+    auto cst = srcs[0].get_constant();
+    if (cst && *cst == 0) {
+      return SignedConstantDomain(0);
+    }
+    return SignedConstantDomain::top();
+  }
+  default:
+    break;
+  }
+
+  boost::optional<int64_t> result;
+  if (opcode::is_an_int_lit(op)) {
+    if (auto cst = srcs[0].get_constant()) {
+      result = fold_binop_lit(op, *cst, insn->get_literal());
+    }
+  } else if (srcs.size() == 2) {
+    auto left = srcs[0].get_constant();
+    auto right = srcs[1].get_constant();
+    if (left && right) {
+      result = fold_binop(op, *left, *right);
+    }
+  }
+  if (!result) {
+    return SignedConstantDomain::top();
+  }
+  if (opcode::is_binop64(op)) {
+    return SignedConstantDomain(*result);
+  }
+  return SignedConstantDomain((int32_t)(*result & 0xFFFFFFFF));
+}
+
+void SparseConstantAnalysis::visit_instruction(IRInstruction* insn) {
+  auto op = insn->opcode();
+  if (opcode::is_a_move(op) || opcode::is_move_result_any(op) ||
+      (!insn->has_dest() && !insn->has_move_result_any())) {
+    return;
+  }
+  auto value = evaluate(insn);
+  auto it = m_values.find(insn);
+  if (it == m_values.end()) {
+    if (value.is_bottom()) {
+      return;
+    }
+  } else {
+    if (value.leq(it->second)) {
+      return;
+    }
+    value.join_with(it->second);
+  }
+  value = normalize(value);
+  TRACE(CONSTP, 5, "Sparse value of %s: %s", SHOW(insn), SHOW(value));
+  m_values[insn] = value;
+  auto uses_it = m_def_use_chains.find(insn);
+  if (uses_it != m_def_use_chains.end()) {
+    for (const auto& use : uses_it->second) {
+      m_insn_worklist.push_back(use.insn);
+    }
+  }
+}
+
+void SparseConstantAnalysis::visit_successors(cfg::Block* block) {
+  auto last = block->get_last_insn();
+  auto op = last == block->end() ? OPCODE_NOP : last->insn->opcode();
+  if (opcode::is_a_conditional_branch(op)) {
+    auto* insn = last->insn;
+    auto left = get_value(insn, 0);
+    auto right = insn->srcs_size() > 1 ? get_value(insn, 1)
+                                       : SignedConstantDomain(0);
+    if (left.is_bottom() || right.is_bottom()) {
+      return;
+    }
+    auto taken = evaluate_condition(op, left, right);
+    for (auto* edge : block->succs()) {
+      if (taken && ((edge->type() == cfg::EDGE_BRANCH && !*taken) ||
+                    (edge->type() == cfg::EDGE_GOTO && *taken))) {
+        continue;
+      }
+      mark_feasible(edge);
+    }
+    return;
+  }
+  if (opcode::is_switch(op)) {
+    auto selector = get_value(last->insn, 0);
+    if (selector.is_bottom()) {
+      return;
+    }
+    auto cst = selector.get_constant();
+    bool has_matching_case = false;
+    if (cst) {
+      for (auto* edge : block->succs()) {
+        if (edge->type() == cfg::EDGE_BRANCH && edge->case_key() &&
+            *edge->case_key() == *cst) {
+          has_matching_case = true;
+        }
+      }
+    }
+    for (auto* edge : block->succs()) {
+      if (cst && edge->type() == cfg::EDGE_BRANCH &&
+          (!edge->case_key() || *edge->case_key() != *cst)) {
+        continue;
+      }
+      if (cst && edge->type() == cfg::EDGE_GOTO && has_matching_case) {
+        continue;
+      }
+      mark_feasible(edge);
+    }
+    return;
+  }
+  for (auto* edge : block->succs()) {
+    mark_feasible(edge);
+  }
+}
+
+void SparseConstantAnalysis::mark_feasible(cfg::Edge* edge) {
+  if (!m_feasible_edges.insert(edge).second) {
+    return;
+  }
+  auto* target = edge->target();
+  if (m_executable_blocks.insert(target).second) {
+    m_block_worklist.push_back(target);
+  }
+}
+
+} // namespace constant_propagation
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "LiveRange.h"
+#include "SignedConstantDomain.h"
+
+namespace constant_propagation {
+
+/*
+ * Sparse conditional constant propagation (Wegman & Zadeck) of primitive
+ * values over the move-aware def-use chains of a method.
+ *
+ * Where the intraprocedural FixpointIterator computes an environment of all
+ * registers at every block, this analysis keeps a single value per definition,
+ * and only revisits the uses of a definition when its value changes. Blocks
+ * are only analyzed once they are found executable, and branches and switches
+ * whose operands are known only make the matching successor edges executable.
+ *
+ * Values are constants, non-zero, top, or bottom for definitions that are not
+ * (yet) known to be executed; this covers what the ConstantPrimitiveAnalyzer
+ * mostly finds in practice. Unlike the dense analysis, values are not refined
+ * along the edges of a conditional branch, and definitions reaching a use only
+ * via infeasible edges are still taken into account, so the results may be
+ * less precise, but are always sound. This makes it a cheaper alternative for
+ * large methods with many registers.
+ */
+class SparseConstantAnalysis final {
+ public:
+  explicit SparseConstantAnalysis(const cfg::ControlFlowGraph& cfg);
+
+  // The value of the given source register of an instruction. This is bottom
+  // if the instruction is not executable.
+  SignedConstantDomain get_value(const IRInstruction* insn,
+                                 src_index_t src_index) const;
+
+  // The value defined by an instruction, in its dest or in the result
+  // register. As the def-use chains see through moves, moves and
+  // move-results do not define values on their own.
+  SignedConstantDomain get_def_value(const IRInstruction* insn) const;
+
+  bool is_executable(const cfg::Block* block) const {
+    return m_executable_blocks.count(block);
+  }
+
+  bool is_feasible(const cfg::Edge* edge) const {
+    return m_feasible_edges.count(edge);
+  }
+
+ private:
+  SignedConstantDomain evaluate(const IRInstruction* insn) const;
+
+  void visit_instruction(IRInstruction* insn);
+
+  void visit_successors(cfg::Block* block);
+
+  void mark_feasible(cfg::Edge* edge);
+
+  live_range::UseDefChains m_use_def_chains;
+  live_range::DefUseChains m_def_use_chains;
+  std::unordered_map<const IRInstruction*, cfg::Block*> m_insn_blocks;
+  std::unordered_map<const IRInstruction*, SignedConstantDomain> m_values;
+  std::unordered_set<const cfg::Block*> m_executable_blocks;
+  std::unordered_set<const cfg::Edge*> m_feasible_edges;
+  std::vector<cfg::Block*> m_block_worklist;
+  std::vector<IRInstruction*> m_insn_worklist;
+};
+
+} // namespace constant_propagation
@@ -297,8 +297,7 @@ boost::optional<vertex_t> AliasedRegisters::find_in_tree(
   if (root == v) {
     return root;
   }
-  const auto& adj = m_graph.inv_adjacent_vertices(root);
-  if (std::find(adj.begin(), adj.end(), v) != adj.end()) {
+  if (m_graph.inv_adjacent_vertices(root).contains(v)) {
     return v;
   }
   return boost::none;
@@ -344,6 +343,9 @@ AbstractValueKind AliasedRegisters::kind() const {
 
 // leq (<=) is the superset relation on the alias groups
 bool AliasedRegisters::leq(const AliasedRegisters& other) const {
+  if (m_graph.reference_equals(other.m_graph)) {
+    return true;
+  }
   if (m_graph.edges_count() < other.m_graph.edges_count()) {
     // this cannot be a superset of other if this has fewer edges
     return false;
@@ -388,6 +390,13 @@ AbstractValueKind AliasedRegisters::meet_with(const AliasedRegisters& other) {
 // Alias group intersection.
 // Only keep the alias relationships that both `this` and `other` contain.
 AbstractValueKind AliasedRegisters::join_with(const AliasedRegisters& other) {
+  // Both sides commonly derive from the same state without changes to it,
+  // e.g. at the head of a loop that does not move any registers.
+  if (m_graph.reference_equals(other.m_graph) &&
+      m_insert_order.reference_equals(other.m_insert_order)) {
+    return AbstractValueKind::Value;
+  }
+
   auto this_before_groups = this->all_groups();
 
   // Remove all edges from this graph. We will add back the ones that `other`
@@ -685,56 +694,59 @@ vertex_t VertexValues::get_vertex(const Value& value) const {
 
 AliasGraph::AliasGraph() : m_values(std::make_shared<VertexValues>()) {}
 
+namespace {
+
+AliasGraph::Vertices remove_in_edge(const AliasGraph::Vertices& ins,
+                                    vertex_t u) {
+  always_assert(ins.contains(u));
+  auto copy = ins;
+  copy.remove(u);
+  return copy;
+}
+
+} // namespace
+
 void AliasGraph::add_edge(vertex_t u, vertex_t v) {
   always_assert(u != v);
-  always_assert(!m_vertices_outs.count(u));
-  m_vertices_outs[u] = v;
-  m_vertices_ins[v].push_back(u);
+  always_assert(m_vertices_outs.at(u) == 0);
+  m_vertices_outs.insert_or_assign(u, v);
+  m_vertices_ins.update(
+      [u](const Vertices& ins) {
+        auto copy = ins;
+        copy.insert(u);
+        return copy;
+      },
+      v);
   m_edges++;
 }
 
 void AliasGraph::remove_edge(vertex_t u, vertex_t v) {
   always_assert(u != v);
   always_assert(m_vertices_outs.at(u) == v);
-  m_vertices_outs.erase(u);
-  auto v_it = m_vertices_ins.find(v);
-  auto& v_in = v_it->second;
-  auto v_size = v_in.size();
-  always_assert(v_size >= 1);
-  v_in.erase(std::remove(v_in.begin(), v_in.end(), u), v_in.end());
-  always_assert(v_in.size() == v_size - 1);
-  if (v_in.empty()) {
-    m_vertices_ins.erase(v_it);
-  }
+  m_vertices_outs.remove(u);
+  m_vertices_ins.update(
+      [u](const Vertices& ins) { return remove_in_edge(ins, u); }, v);
   m_edges--;
 }
 
 void AliasGraph::clear_vertex(vertex_t v) {
-  auto v_in_it = m_vertices_ins.find(v);
-  if (v_in_it != m_vertices_ins.end()) {
-    auto& v_in = v_in_it->second;
-    always_assert(!v_in.empty());
+  const auto& v_in = m_vertices_ins.at(v);
+  if (!v_in.empty()) {
+    size_t removed = 0;
     for (auto u : v_in) {
       always_assert(m_vertices_outs.at(u) == v);
-      m_vertices_outs.erase(u);
-    }
-    m_edges -= v_in.size();
-    m_vertices_ins.erase(v_in_it);
-  }
-  auto v_out_it = m_vertices_outs.find(v);
-  if (v_out_it != m_vertices_outs.end()) {
-    auto w = v_out_it->second;
-    auto w_it = m_vertices_ins.find(w);
-    auto& w_in = w_it->second;
-    auto w_size = w_in.size();
-    always_assert(w_size >= 1);
-    w_in.erase(std::remove(w_in.begin(), w_in.end(), v), w_in.end());
-    always_assert(w_in.size() == w_size - 1);
-    if (w_in.empty()) {
-      m_vertices_ins.erase(w_it);
+      m_vertices_outs.remove(u);
+      removed++;
     }
+    m_edges -= removed;
+    m_vertices_ins.remove(v);
+  }
+  auto w = m_vertices_outs.at(v);
+  if (w != 0) {
+    m_vertices_ins.update(
+        [v](const Vertices& ins) { return remove_in_edge(ins, v); }, w);
     m_edges--;
-    m_vertices_outs.erase(v_out_it);
+    m_vertices_outs.remove(v);
   }
 }
 
@@ -12,6 +12,7 @@
 
 #include <sparta/AbstractDomain.h>
 #include <sparta/PatriciaTreeMap.h>
+#include <sparta/PatriciaTreeSet.h>
 
 #include "ConstantUses.h"
 #include "DexClass.h"
@@ -141,14 +142,24 @@ using VertexMapping = std::function<vertex_t(vertex_t)>;
  * The out-edge points to the representative of a group, and in-edges point to
  * all other members of a group. The graph and all copies of it will share one
  * underlying VertexValues mapping.
+ *
+ * The edges are held in Patricia trees, so copying a graph is constant time
+ * and updates only copy the paths to the modified nodes. This matters as the
+ * fixpoint iteration copies the environment whenever it is changed, and joins
+ * of environments that derive from the same state unchanged can be detected by
+ * reference equality.
  */
 class AliasGraph {
- private:
-  static const inline std::vector<vertex_t> no_vertices;
+ public:
+  using Vertices = sparta::PatriciaTreeSet<vertex_t>;
+  // Vertex 0 is never handed out, and stands for the absence of an out-edge.
+  using Outs = sparta::PatriciaTreeMap<vertex_t, vertex_t>;
+  using Ins = sparta::PatriciaTreeMap<vertex_t, Vertices>;
 
+ private:
   std::shared_ptr<VertexValues> m_values;
-  std::unordered_map<vertex_t, std::vector<vertex_t>> m_vertices_ins;
-  std::unordered_map<vertex_t, vertex_t> m_vertices_outs;
+  Ins m_vertices_ins;
+  Outs m_vertices_outs;
   size_t m_edges{0};
 
  public:
@@ -171,25 +182,27 @@ class AliasGraph {
 
   size_t edges_count() const { return m_edges; }
 
+  // Whether both graphs share the same vertices and the same edges, without
+  // comparing the trees. This may return false for equal graphs.
+  bool reference_equals(const AliasGraph& other) const {
+    return same_vertices(other) &&
+           m_vertices_outs.reference_equals(other.m_vertices_outs);
+  }
+
   std::optional<vertex_t> adjacent_vertex(vertex_t v) const {
-    auto v_it = m_vertices_outs.find(v);
-    return v_it == m_vertices_outs.end()
-               ? std::nullopt
-               : std::optional<vertex_t>(v_it->second);
+    auto w = m_vertices_outs.at(v);
+    return w == 0 ? std::nullopt : std::optional<vertex_t>(w);
   }
 
-  const std::vector<vertex_t>& inv_adjacent_vertices(vertex_t v) const {
-    auto v_it = m_vertices_ins.find(v);
-    return v_it == m_vertices_ins.end() ? no_vertices : v_it->second;
+  const Vertices& inv_adjacent_vertices(vertex_t v) const {
+    return m_vertices_ins.at(v);
   }
 
-  const std::unordered_map<vertex_t, vertex_t>&
-  get_vertices_with_adjacent_vertex() const {
+  const Outs& get_vertices_with_adjacent_vertex() const {
     return m_vertices_outs;
   }
 
-  const std::unordered_map<vertex_t, std::vector<vertex_t>>&
-  get_vertices_with_inv_adjacent_vertices() const {
+  const Ins& get_vertices_with_inv_adjacent_vertices() const {
     return m_vertices_ins;
   }
 
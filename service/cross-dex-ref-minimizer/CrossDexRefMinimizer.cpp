@@ -106,32 +106,83 @@ void CrossDexRefMinimizer::reprioritize(
         affected_classes) {
   TRACE(IDEX, 4, "[dex ordering] Reprioritizing %zu classes",
         affected_classes.size());
-  for (auto p : affected_classes) {
-    ++m_stats.reprioritizations;
-    DexClass* affected_class = p.first;
-    CrossDexRefMinimizer::ClassInfoDelta& delta = p.second;
-    CrossDexRefMinimizer::ClassInfo& affected_class_info =
-        m_class_infos.at(affected_class);
-    affected_class_info.applied_refs_weight += delta.applied_refs_weight;
-    for (size_t i = 0; i < INFREQUENT_REFS_COUNT; ++i) {
-      affected_class_info.infrequent_refs_weight[i] +=
-          delta.infrequent_refs_weight[i];
+  struct Affected {
+    DexClass* cls;
+    const ClassInfoDelta* delta;
+    ClassInfo* info;
+    uint64_t priority;
+  };
+  std::vector<Affected> affected;
+  affected.reserve(affected_classes.size());
+  for (const auto& [affected_class, delta] : affected_classes) {
+    affected.push_back({affected_class, &delta, nullptr, 0});
+  }
+
+  // Applying the deltas and computing the new priorities only touches the
+  // info of each affected class, so for large batches this happens in
+  // parallel; the priority queue is then updated serially.
+  auto apply_deltas = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto& a = affected[i];
+      a.info = &m_class_infos.at(a.cls);
+      a.info->applied_refs_weight += a.delta->applied_refs_weight;
+      for (size_t j = 0; j < INFREQUENT_REFS_COUNT; ++j) {
+        a.info->infrequent_refs_weight[j] += a.delta->infrequent_refs_weight[j];
+      }
+      if (!m_config.lazy_reprioritization) {
+        a.priority = a.info->get_priority();
+      }
+    }
+  };
+  constexpr size_t BATCH_SIZE = 4096;
+  if (affected.size() <= BATCH_SIZE) {
+    apply_deltas(0, affected.size());
+  } else {
+    workqueue_run_for<size_t>(
+        0, (affected.size() + BATCH_SIZE - 1) / BATCH_SIZE, [&](size_t batch) {
+          apply_deltas(batch * BATCH_SIZE,
+                       std::min((batch + 1) * BATCH_SIZE, affected.size()));
+        });
+  }
+
+  if (m_config.lazy_reprioritization) {
+    for (const auto& a : affected) {
+      m_stale_classes.insert(a.cls);
     }
+    refresh_front();
+    return;
+  }
 
-    const auto priority = affected_class_info.get_priority();
-    m_prioritized_classes.update_priority(affected_class, priority);
+  for (const auto& a : affected) {
+    ++m_stats.reprioritizations;
+    m_prioritized_classes.update_priority(a.cls, a.priority);
     TRACE(
         IDEX, 5,
         "[dex ordering] Reprioritized class {%s} with priority %016" PRIu64
         "; index %u; %" PRIu64 " (delta %" PRId64
         ") applied refs weight, %s (delta %s) infrequent refs weights, %zu "
         "total refs",
-        SHOW(affected_class), priority, affected_class_info.index,
-        affected_class_info.applied_refs_weight, delta.applied_refs_weight,
-        format_infrequent_refs_array(affected_class_info.infrequent_refs_weight)
-            .c_str(),
-        format_infrequent_refs_array(delta.infrequent_refs_weight).c_str(),
-        affected_class_info.refs->size());
+        SHOW(a.cls), a.priority, a.info->index, a.info->applied_refs_weight,
+        a.delta->applied_refs_weight,
+        format_infrequent_refs_array(a.info->infrequent_refs_weight).c_str(),
+        format_infrequent_refs_array(a.delta->infrequent_refs_weight).c_str(),
+        a.info->refs->size());
+  }
+}
+
+void CrossDexRefMinimizer::refresh_front() {
+  while (!m_prioritized_classes.empty()) {
+    DexClass* cls = m_prioritized_classes.front();
+    if (!m_stale_classes.erase(cls)) {
+      return;
+    }
+    ++m_stats.reprioritizations;
+    const auto priority = m_class_infos.at(cls).get_priority();
+    m_prioritized_classes.update_priority(cls, priority);
+    TRACE(IDEX, 5,
+          "[dex ordering] Lazily reprioritized class {%s} with priority "
+          "%016" PRIu64,
+          SHOW(cls), priority);
   }
 }
 
@@ -377,6 +428,7 @@ size_t CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
       m_class_infos.end();
   if (cls) {
     m_prioritized_classes.erase(cls);
+    m_stale_classes.erase(cls);
     class_info_it = m_class_infos.find(cls);
     always_assert(class_info_it != m_class_infos.end());
     const auto& class_info = class_info_it->second;
@@ -458,6 +510,7 @@ size_t CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
 
   if (reset) {
     m_prioritized_classes.clear();
+    m_stale_classes.clear();
     for (auto it = m_class_infos.begin(); it != m_class_infos.end(); ++it) {
       DexClass* reset_class = it->first;
       CrossDexRefMinimizer::ClassInfo& reset_class_info = it->second;
@@ -52,6 +52,11 @@ struct CrossDexRefMinimizerConfig {
 
   uint32_t min_large_string_size{50};
   bool emit_json{false};
+  // Instead of updating the priorities of all classes affected by an erased
+  // class, only mark them as stale, and recompute the priority of a class
+  // when it reaches the front. This is much cheaper, but only approximates
+  // the proper order, as stale classes whose priority went up stay behind.
+  bool lazy_reprioritization{false};
 };
 
 // Helper class that maintains a set of dex classes with associated priorities
@@ -86,6 +91,9 @@ struct CrossDexRefMinimizerConfig {
 // be the end of the world if an overflow ever happens.
 class CrossDexRefMinimizer {
   PrioritizedDexClasses m_prioritized_classes;
+  // Classes whose priority in m_prioritized_classes is outdated; only used
+  // with lazy_reprioritization.
+  std::unordered_set<DexClass*> m_stale_classes;
   std::unordered_set<const void*> m_applied_refs;
   struct ClassInfo {
     uint32_t index;
@@ -193,6 +201,9 @@ class CrossDexRefMinimizer {
   void reprioritize(
       const std::unordered_map<DexClass*, ClassInfoDelta>& affected_classes);
 
+  // Recomputes stale priorities until the front class is up-to-date.
+  void refresh_front();
+
   std::unordered_map<const void*, size_t> m_ref_counts;
   size_t m_max_ref_count{0};
 
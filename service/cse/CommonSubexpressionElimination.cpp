@@ -52,6 +52,7 @@
 #include "CommonSubexpressionElimination.h"
 
 #include <cinttypes>
+#include <functional>
 #include <utility>
 
 #include <sparta/ConstantAbstractDomain.h>
@@ -71,6 +72,7 @@
 #include "Trace.h"
 #include "TypeInference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 using namespace cse_impl;
@@ -1241,11 +1243,13 @@ void SharedState::init_method_barriers(const Scope& scope) {
   m_stats.method_barriers_iterations = iterations;
   m_stats.method_barriers = m_method_written_locations.size();
 
-  for (const auto& p : m_method_written_locations) {
-    auto method = p.first;
-    auto& written_locations = p.second;
-    TRACE(CSE, 4, "[CSE] inferred barrier for %s: %s", SHOW(method),
-          SHOW(&written_locations));
+  if (traceEnabled(CSE, 4)) {
+    for (const auto& p : m_method_written_locations) {
+      auto method = p.first;
+      auto& written_locations = p.second;
+      TRACE(CSE, 4, "[CSE] inferred barrier for %s: %s", SHOW(method),
+            SHOW(&written_locations));
+    }
   }
 }
 
@@ -1273,15 +1277,6 @@ void SharedState::init_scope(
   always_assert(!m_method_override_graph);
   m_method_override_graph = method_override_graph::build_graph(scope);
 
-  auto iterations = compute_conditionally_pure_methods(
-      scope, m_method_override_graph.get(), clinit_has_no_side_effects,
-      m_pure_methods, &m_conditionally_pure_methods);
-  m_stats.conditionally_pure_methods = m_conditionally_pure_methods.size();
-  m_stats.conditionally_pure_methods_iterations = iterations;
-  for (const auto& p : m_conditionally_pure_methods) {
-    m_pure_methods.insert(const_cast<DexMethod*>(p.first));
-  }
-
   for (auto method_ref : m_safe_methods) {
     auto method = method_ref->as_def();
     if (method) {
@@ -1289,8 +1284,27 @@ void SharedState::init_scope(
     }
   }
 
-  init_method_barriers(scope);
-  init_finalizable_fields(scope);
+  // The conditionally pure methods, the method barriers and the finalizable
+  // fields do not depend on each other. Each computation is parallel within,
+  // but also has serial phases, e.g. the fixpoint iterations, which are
+  // overlapped by running the computations concurrently.
+  std::vector<std::function<void()>> fns{
+      [&] {
+        auto iterations = compute_conditionally_pure_methods(
+            scope, m_method_override_graph.get(), clinit_has_no_side_effects,
+            m_pure_methods, &m_conditionally_pure_methods);
+        m_stats.conditionally_pure_methods =
+            m_conditionally_pure_methods.size();
+        m_stats.conditionally_pure_methods_iterations = iterations;
+      },
+      [&] { init_method_barriers(scope); },
+      [&] { init_finalizable_fields(scope); }};
+  workqueue_run<std::function<void()>>(
+      [](const std::function<void()>& fn) { fn(); }, fns);
+
+  for (const auto& p : m_conditionally_pure_methods) {
+    m_pure_methods.insert(const_cast<DexMethod*>(p.first));
+  }
 }
 
 CseUnorderedLocationSet SharedState::get_relevant_written_locations(
@@ -145,8 +145,8 @@ ConstantUses::ConstantUses(const cfg::ControlFlowGraph& cfg,
   TRACE(CU, 2, "[CU] ConstantUses(%s) need_type_inference:%u",
         method_describer().c_str(), need_type_inference);
   if ((need_type_inference && args) || force_type_inference) {
-    m_type_inference.reset(new type_inference::TypeInference(cfg));
-    m_type_inference->run(is_static, declaring_type, args);
+    m_type_inference = type_inference::get_shared_type_inference(
+        cfg, is_static, declaring_type, args);
   }
 }
 
@@ -61,7 +61,7 @@ class ConstantUses {
   static TypeDemand get_type_demand(DexType* type);
   TypeDemand get_type_demand(IRInstruction* insn, size_t src_index) const;
 
-  mutable std::unique_ptr<type_inference::TypeInference> m_type_inference;
+  std::shared_ptr<const type_inference::TypeInference> m_type_inference;
   std::unordered_map<IRInstruction*,
                      std::vector<std::pair<IRInstruction*, size_t>>>
       m_constant_uses;
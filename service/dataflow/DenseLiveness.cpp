@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DenseLiveness.h"
+
+#include <algorithm>
+
+#include "Debug.h"
+#include "IRInstruction.h"
+
+namespace {
+
+// The registers size of a cfg is not necessarily up to date while it is being
+// transformed, so account for all registers that are actually referenced.
+size_t get_num_regs(const cfg::ControlFlowGraph& cfg) {
+  size_t num_regs = cfg.get_registers_size();
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    auto insn = mie.insn;
+    if (insn->has_dest()) {
+      num_regs = std::max<size_t>(num_regs, insn->dest() + 1);
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      num_regs = std::max<size_t>(num_regs, insn->src(i) + 1);
+    }
+  }
+  return num_regs;
+}
+
+} // namespace
+
+bool DenseLiveness::is_applicable(const cfg::ControlFlowGraph& cfg) {
+  return cfg.exit_block() != nullptr &&
+         static_cast<size_t>(cfg.get_registers_size()) * cfg.num_blocks() <=
+             MAX_TABLE_BITS;
+}
+
+DenseLiveness::DenseLiveness(const cfg::ControlFlowGraph& cfg) {
+  auto exit_block = cfg.exit_block();
+  always_assert(exit_block != nullptr);
+  cfg::BlockId max_id = 0;
+  for (auto* block : cfg.blocks()) {
+    max_id = std::max(max_id, block->id());
+  }
+  m_reachable.resize(max_id + 1);
+  auto num_regs = get_num_regs(cfg);
+  m_empty.resize(num_regs);
+
+  // The blocks that can reach the exit block, in the order they are found
+  // walking backwards from it.
+  std::vector<cfg::Block*> worklist{exit_block};
+  m_reachable[exit_block->id()] = true;
+  for (size_t i = 0; i < worklist.size(); ++i) {
+    for (auto* pred : worklist[i]->preds()) {
+      auto* src = pred->src();
+      if (!m_reachable[src->id()]) {
+        m_reachable[src->id()] = true;
+        worklist.push_back(src);
+      }
+    }
+  }
+
+  m_live_in.resize(max_id + 1);
+  m_live_out.resize(max_id + 1);
+  for (auto* block : worklist) {
+    m_live_in[block->id()].resize(num_regs);
+    m_live_out[block->id()].resize(num_regs);
+  }
+
+  // Iterate to the fixpoint, visiting the blocks closest to the exit first.
+  // Blocks are reconsidered when the live-in state of a successor grew.
+  std::vector<bool> queued(max_id + 1);
+  std::reverse(worklist.begin(), worklist.end());
+  for (auto* block : worklist) {
+    queued[block->id()] = true;
+  }
+  Bits live(num_regs);
+  while (!worklist.empty()) {
+    auto* block = worklist.back();
+    worklist.pop_back();
+    queued[block->id()] = false;
+
+    auto& live_out = m_live_out[block->id()];
+    live_out.reset();
+    for (auto* succ : block->succs()) {
+      auto* target = succ->target();
+      if (m_reachable[target->id()]) {
+        live_out |= m_live_in[target->id()];
+      }
+    }
+    live = live_out;
+    for (auto it = block->rbegin(); it != block->rend(); ++it) {
+      if (it->type == MFLOW_OPCODE) {
+        analyze_instruction(it->insn, &live);
+      }
+    }
+    auto& live_in = m_live_in[block->id()];
+    if (live == live_in) {
+      continue;
+    }
+    live_in.swap(live);
+    for (auto* pred : block->preds()) {
+      auto* src = pred->src();
+      if (!queued[src->id()]) {
+        queued[src->id()] = true;
+        worklist.push_back(src);
+      }
+    }
+  }
+}
+
+LivenessQuery::LivenessQuery(const cfg::ControlFlowGraph& cfg) {
+  if (DenseLiveness::is_applicable(cfg)) {
+    m_dense = std::make_unique<DenseLiveness>(cfg);
+  } else {
+    m_fixpoint_iter = std::make_unique<LivenessFixpointIterator>(cfg);
+    m_fixpoint_iter->run(LivenessDomain());
+  }
+}
+
+bool LivenessQuery::may_be_live_in(const cfg::Block* block, reg_t reg) const {
+  if (m_dense) {
+    if (!m_dense->is_reachable(block)) {
+      return true;
+    }
+    const auto& live_in = m_dense->get_live_in_vars_at(block);
+    return reg >= live_in.size() || live_in.test(reg);
+  }
+  const auto& live_in_vars =
+      m_fixpoint_iter->get_live_in_vars_at(const_cast<cfg::Block*>(block));
+  if (live_in_vars.is_bottom()) {
+    return true;
+  }
+  always_assert(!live_in_vars.is_top());
+  return live_in_vars.elements().contains(reg);
+}
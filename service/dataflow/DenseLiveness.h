@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include "ControlFlow.h"
+#include "Liveness.h"
+
+/*
+ * Register liveness over dense bit vectors, with one bit per register and one
+ * vector per block. Compared to the LivenessFixpointIterator, joins and
+ * transfers are word-parallel, and no tree nodes are allocated per
+ * instruction, which makes it considerably faster for methods with a moderate
+ * number of registers. The tables take registers * blocks bits though, so use
+ * LivenessQuery to fall back to the LivenessFixpointIterator for large
+ * methods.
+ *
+ * Like the LivenessFixpointIterator, this requires the exit block to be
+ * computed. Blocks that cannot reach the exit block, where the
+ * LivenessFixpointIterator would report bottom, are reported as unreachable.
+ */
+class DenseLiveness final {
+ public:
+  using Bits = boost::dynamic_bitset<>;
+
+  // Upper bound for registers * blocks of a method to be analyzed densely.
+  static constexpr size_t MAX_TABLE_BITS = 1 << 24;
+
+  static bool is_applicable(const cfg::ControlFlowGraph& cfg);
+
+  explicit DenseLiveness(const cfg::ControlFlowGraph& cfg);
+
+  static void analyze_instruction(const IRInstruction* insn, Bits* live) {
+    if (insn->has_dest()) {
+      live->reset(insn->dest());
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      live->set(insn->src(i));
+    }
+  }
+
+  // False for blocks that cannot reach the exit block, or that were added
+  // after the analysis ran. Their live-in and live-out states are empty.
+  bool is_reachable(const cfg::Block* block) const {
+    return block->id() < m_reachable.size() && m_reachable[block->id()];
+  }
+
+  const Bits& get_live_in_vars_at(const cfg::Block* block) const {
+    return is_reachable(block) ? m_live_in[block->id()] : m_empty;
+  }
+
+  const Bits& get_live_out_vars_at(const cfg::Block* block) const {
+    return is_reachable(block) ? m_live_out[block->id()] : m_empty;
+  }
+
+ private:
+  std::vector<bool> m_reachable;
+  std::vector<Bits> m_live_in;
+  std::vector<Bits> m_live_out;
+  Bits m_empty;
+};
+
+/*
+ * Answers block-level liveness queries with the DenseLiveness when the method
+ * is small enough, and with the LivenessFixpointIterator otherwise.
+ */
+class LivenessQuery final {
+ public:
+  explicit LivenessQuery(const cfg::ControlFlowGraph& cfg);
+
+  // Whether the register may be live on entry to the block. This is
+  // conservatively true for blocks without liveness information.
+  bool may_be_live_in(const cfg::Block* block, reg_t reg) const;
+
+ private:
+  std::unique_ptr<DenseLiveness> m_dense;
+  std::unique_ptr<LivenessFixpointIterator> m_fixpoint_iter;
+};
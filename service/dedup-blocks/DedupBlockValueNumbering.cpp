@@ -33,9 +33,8 @@ const BlockValue* BlockValues::get_block_value(cfg::Block* block) const {
     return it->second.get();
   }
 
-  std::unique_ptr<BlockValue> block_value = std::make_unique<BlockValue>();
-  auto& regs = block_value->out_regs;
-  auto& ordered_operations = block_value->ordered_operations;
+  std::map<reg_t, value_id_t> regs;
+  std::vector<IROperation> ordered_operations;
   auto block_it = block->begin();
   while (block_it != block->end()) {
     next_opcode_or_srcblk(block_it, block);
@@ -81,11 +80,56 @@ const BlockValue* BlockValues::get_block_value(cfg::Block* block) const {
   for (auto reg : live_out_vars.elements()) {
     prepare_and_get_reg(regs, reg);
   }
+  auto block_value = std::make_unique<BlockValue>(ordered_operations, regs);
   auto ptr = block_value.get();
   m_block_values.emplace(block, std::move(block_value));
   return ptr;
 };
 
+BlockValue::BlockValue(const std::vector<IROperation>& ordered_operations,
+                       const std::map<reg_t, value_id_t>& out_regs) {
+  size_t size = 2 + 2 * out_regs.size();
+  for (const auto& operation : ordered_operations) {
+    size += 2 + operation.srcs.size();
+  }
+  encoding.reserve(size);
+  encoding.push_back(ordered_operations.size());
+  for (const auto& operation : ordered_operations) {
+    // The opcode and the number of sources share a word; the union of
+    // operands is fully covered by the literal.
+    encoding.push_back((uint64_t)operation.opcode << 32 |
+                       operation.srcs.size());
+    encoding.insert(encoding.end(), operation.srcs.begin(),
+                    operation.srcs.end());
+    encoding.push_back(operation.literal);
+  }
+  encoding.push_back(out_regs.size());
+  for (const auto& [reg, value] : out_regs) {
+    encoding.push_back(reg);
+    encoding.push_back(value);
+  }
+  always_assert(encoding.size() == size);
+
+  // Four independent lanes, so that the loop is not bound by the latency of
+  // a single multiply chain, and can be vectorized.
+  constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+  uint64_t lanes[4] = {size, 1, 2, 3};
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    for (size_t j = 0; j < 4; j++) {
+      lanes[j] = (lanes[j] ^ encoding[i + j]) * MULTIPLIER;
+    }
+  }
+  for (; i < size; i++) {
+    lanes[0] = (lanes[0] ^ encoding[i]) * MULTIPLIER;
+  }
+  uint64_t h = lanes[0];
+  for (size_t j = 1; j < 4; j++) {
+    h = (h ^ (lanes[j] >> 29)) * MULTIPLIER ^ lanes[j];
+  }
+  hash = h ^ (h >> 32);
+}
+
 value_id_t BlockValues::prepare_and_get_reg(std::map<reg_t, value_id_t>& regs,
                                             reg_t reg) const {
   auto it = regs.find(reg);
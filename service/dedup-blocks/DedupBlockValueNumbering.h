@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstring>
+
 #include "DexClass.h"
 #include "Liveness.h"
 
@@ -73,25 +75,27 @@ inline bool operator==(const IROperation& a, const IROperation& b) {
          a.src_blk_id == b.src_blk_id;
 }
 
+// The value of a block in a compact, fixed-width encoding: a self-delimiting
+// sequence of words for the ordered operations (opcode, source value ids,
+// operand), followed by the values of the live-out registers. Equal encodings
+// thus mean equal operations and live-out values, so that grouping blocks
+// only needs the precomputed hash and a memcmp of the words.
 struct BlockValue {
-  std::vector<IROperation> ordered_operations;
-  std::map<reg_t, value_id_t> out_regs;
+  std::vector<uint64_t> encoding;
+  size_t hash{0};
+
+  BlockValue(const std::vector<IROperation>& ordered_operations,
+             const std::map<reg_t, value_id_t>& out_regs);
 };
 
 struct BlockValueHasher {
-  size_t operator()(const BlockValue& o) const {
-    size_t hash = o.ordered_operations.size();
-    for (auto& operation : o.ordered_operations) {
-      boost::hash_combine(hash, IROperationHasher()(operation));
-    }
-    boost::hash_combine(hash, o.out_regs);
-    return hash;
-  }
+  size_t operator()(const BlockValue& o) const { return o.hash; }
 };
 
 inline bool operator==(const BlockValue& a, const BlockValue& b) {
-  return a.ordered_operations == b.ordered_operations &&
-         a.out_regs == b.out_regs;
+  return a.hash == b.hash && a.encoding.size() == b.encoding.size() &&
+         std::memcmp(a.encoding.data(), b.encoding.data(),
+                     a.encoding.size() * sizeof(uint64_t)) == 0;
 }
 
 class BlockValues {
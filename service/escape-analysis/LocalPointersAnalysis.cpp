@@ -7,14 +7,16 @@
 
 #include "LocalPointersAnalysis.h"
 
+#include <limits>
 #include <ostream>
 
 #include <sparta/PatriciaTreeSet.h>
 
 #include "DexUtil.h"
+#include "GraphUtil.h"
+#include "PriorityThreadPoolDAGScheduler.h"
 #include "Resolver.h"
 #include "Walkers.h"
-#include "WorkQueue.h"
 
 using namespace local_pointers;
 
@@ -343,17 +345,21 @@ void default_instruction_handler(const IRInstruction* insn,
   }
 }
 
+bool FixpointIterator::is_excluded_init(const IRInstruction* insn) const {
+  auto method = insn->get_method();
+  return method::is_init(method) && m_excluded_classes &&
+         m_excluded_classes->count(type_class(method->get_class()));
+}
+
 void FixpointIterator::analyze_instruction(const IRInstruction* insn,
                                            Environment* env) const {
   escape_heap_referenced_objects(insn, env);
 
   auto op = insn->opcode();
   if (opcode::is_an_invoke(op)) {
-    auto method = insn->get_method();
     // If the method is an init and the class is excluded, we label is as
     // escaping to prevent further optimizations.
-    if (method::is_init(method) && m_excluded_classes &&
-        m_excluded_classes->count(type_class(method->get_class()))) {
+    if (is_excluded_init(insn)) {
       env->set_may_escape(insn->src(0), insn);
     } else if (m_invoke_to_summary_map.count(insn)) {
       const auto& summary = m_invoke_to_summary_map.at(insn);
@@ -373,10 +379,12 @@ void FixpointIterator::analyze_instruction(const IRInstruction* insn,
   }
 }
 
+// get_summary returns the summary of a callee, or nullptr if there is none.
+template <typename GetSummaryFn>
 std::pair<std::unique_ptr<FixpointIterator>, EscapeSummary> analyze_method(
     const DexMethod* method,
     const call_graph::Graph& call_graph,
-    const SummaryMap& summary_map,
+    const GetSummaryFn& get_summary,
     const std::unordered_set<DexClass*>* excluded_classes) {
   std::unordered_map<const IRInstruction*, EscapeSummary> invoke_to_summary_map;
   if (call_graph.has_node(method)) {
@@ -388,9 +396,8 @@ std::pair<std::unique_ptr<FixpointIterator>, EscapeSummary> analyze_method(
       auto invoke_insn = edge->invoke_insn();
       auto& callee_summary = invoke_to_summary_map[invoke_insn];
       auto* callee = edge->callee()->method();
-      auto it = summary_map.find(callee);
-      if (it != summary_map.end()) {
-        callee_summary.join_with(it->second);
+      if (const auto* summary = get_summary(callee)) {
+        callee_summary.join_with(*summary);
       } else if (callee == nullptr &&
                  is_array_clone(invoke_insn->get_method())) {
         // The array clone method doesn't escape or return any parameters; it
@@ -425,39 +432,122 @@ FixpointIteratorMap analyze_scope(
   }
   summary_map_ptr->emplace(method::java_lang_Object_ctor(), EscapeSummary{});
 
-  auto affected_methods = std::make_unique<ConcurrentSet<const DexMethod*>>();
-  walk::parallel::code(scope, [&](const DexMethod* method, IRCode&) {
-    affected_methods->insert(method);
+  // Number the methods we analyze densely, and keep their summaries in a
+  // table indexed by that number. Summaries of other methods come from the
+  // given map, which does not change while we analyze.
+  constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+  std::vector<const DexMethod*> methods;
+  walk::code(scope, [&](const DexMethod* method, IRCode&) {
+    methods.push_back(method);
   });
-
-  while (!affected_methods->empty()) {
-    InsertOnlyConcurrentMap<const DexMethod*, EscapeSummary>
-        changed_effect_summaries;
-    auto next_affected_methods =
-        std::make_unique<ConcurrentSet<const DexMethod*>>();
-    workqueue_run<const DexMethod*>(
-        [&](const DexMethod* method) {
-          auto p = analyze_method(
-              method, call_graph, *summary_map_ptr, excluded_classes);
-          auto& new_fp_iter = p.first;
-          auto& new_summary = p.second;
-          fp_iter_map.update(method, [&](auto*, auto& v, bool exists) {
-            redex_assert(!(exists ^ (v != nullptr)));
-            std::swap(new_fp_iter, v);
-          });
-          auto it = summary_map_ptr->find(method);
-          if (it != summary_map_ptr->end() && it->second == new_summary) {
-            return;
+  std::vector<uint32_t> node_of(DexMethodRef::num_dense_indices(), NONE);
+  for (uint32_t v = 0; v < methods.size(); ++v) {
+    node_of[methods[v]->get_dense_index()] = v;
+  }
+  auto get_node = [&](const DexMethodRef* method) {
+    if (method == nullptr || method->get_dense_index() >= node_of.size()) {
+      return NONE;
+    }
+    return node_of[method->get_dense_index()];
+  };
+
+  // The callees of each method, in compressed form.
+  std::vector<uint32_t> succ_offsets{0};
+  std::vector<uint32_t> succs;
+  for (auto* method : methods) {
+    if (call_graph.has_node(method)) {
+      for (const auto& edge : call_graph.node(method)->callees()) {
+        if (edge->callee() == call_graph.exit()) {
+          continue;
+        }
+        auto w = get_node(edge->callee()->method());
+        if (w != NONE) {
+          succs.push_back(w);
+        }
+      }
+    }
+    succ_offsets.push_back(succs.size());
+  }
+  std::vector<uint32_t> component_of;
+  auto sccs =
+      graph::strongly_connected_components(succ_offsets, succs, &component_of);
+
+  std::vector<boost::optional<EscapeSummary>> summaries(methods.size());
+  for (uint32_t v = 0; v < methods.size(); ++v) {
+    auto it = summary_map_ptr->find(methods[v]);
+    if (it != summary_map_ptr->end()) {
+      summaries[v] = it->second;
+    }
+  }
+  auto get_summary = [&](const DexMethodRef* callee) -> const EscapeSummary* {
+    auto w = get_node(callee);
+    if (w != NONE) {
+      return summaries[w].get_ptr();
+    }
+    auto it = summary_map_ptr->find(callee);
+    return it == summary_map_ptr->end() ? nullptr : &it->second;
+  };
+  auto analyze = [&](uint32_t v) {
+    auto [fp_iter, summary] =
+        analyze_method(methods[v], call_graph, get_summary, excluded_classes);
+    fp_iter_map.update(methods[v], [&](auto*, auto& p, bool exists) {
+      redex_assert(!(exists ^ (p != nullptr)));
+      std::swap(fp_iter, p);
+    });
+    return std::move(summary);
+  };
+
+  // Callees are analyzed before their callers, so outside of recursion
+  // every method is analyzed exactly once, with the final summaries of all
+  // its callees. The methods of a component that is recursive are iterated
+  // to a fixpoint, in rounds that only see the summaries of the previous
+  // round, so that the result does not depend on scheduling.
+  PriorityThreadPoolDAGScheduler<uint32_t> scheduler;
+  std::vector<uint32_t> all_components;
+  all_components.reserve(sccs.size());
+  for (uint32_t c = 0; c < sccs.size(); ++c) {
+    all_components.push_back(c);
+    std::unordered_set<uint32_t> dependencies;
+    for (auto v : sccs[c]) {
+      for (auto i = succ_offsets[v]; i < succ_offsets[v + 1]; ++i) {
+        auto other = component_of[succs[i]];
+        if (other != c && dependencies.insert(other).second) {
+          scheduler.add_dependency(c, other);
+        }
+      }
+    }
+  }
+  scheduler.set_executor([&](uint32_t c) {
+    const auto& scc = sccs[c];
+    std::vector<uint32_t> affected(scc.begin(), scc.end());
+    while (!affected.empty()) {
+      std::vector<std::pair<uint32_t, EscapeSummary>> changed;
+      for (auto v : affected) {
+        auto summary = analyze(v);
+        if (!summaries[v] || !(*summaries[v] == summary)) {
+          changed.emplace_back(v, std::move(summary));
+        }
+      }
+      std::unordered_set<uint32_t> next_affected;
+      for (auto&& [v, summary] : changed) {
+        summaries[v] = std::move(summary);
+        for (auto* caller : call_graph.get_callers(methods[v])) {
+          auto u = get_node(caller);
+          if (u != NONE && component_of[u] == c) {
+            next_affected.insert(u);
           }
-          changed_effect_summaries.emplace(method, std::move(new_summary));
-          const auto& callers = call_graph.get_callers(method);
-          next_affected_methods->insert(callers.begin(), callers.end());
-        },
-        *affected_methods);
-    for (auto&& [method, summary] : changed_effect_summaries) {
-      (*summary_map_ptr)[method] = std::move(summary);
+        }
+      }
+      affected.assign(next_affected.begin(), next_affected.end());
+      std::sort(affected.begin(), affected.end());
+    }
+  });
+  scheduler.run(all_components.begin(), all_components.end());
+
+  for (uint32_t v = 0; v < methods.size(); ++v) {
+    if (summaries[v]) {
+      (*summary_map_ptr)[methods[v]] = std::move(*summaries[v]);
     }
-    std::swap(next_affected_methods, affected_methods);
   }
 
   return fp_iter_map;
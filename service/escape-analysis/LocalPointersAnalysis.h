@@ -271,6 +271,18 @@ class FixpointIterator final : public ir_analyzer::BaseIRAnalyzer<Environment> {
   void analyze_instruction(const IRInstruction* insn,
                            Environment* env) const override;
 
+  // The inputs of the analysis besides the code, e.g. for deriving cache
+  // keys for results that depend on this analysis.
+  const InvokeToSummaryMap& get_invoke_to_summary_map() const {
+    return m_invoke_to_summary_map;
+  }
+
+  bool escape_check_cast() const { return m_escape_check_cast; }
+
+  // Whether `insn` is a constructor invocation of an excluded class, which
+  // makes the constructed object escape.
+  bool is_excluded_init(const IRInstruction* insn) const;
+
  private:
   // A map of the invoke instructions in the analyzed method to their respective
   // summaries. If an invoke instruction is not present in the method, we treat
@@ -7,6 +7,9 @@
 
 #include "FieldOpTracker.h"
 
+#include <atomic>
+#include <memory>
+
 #include <sparta/ConstantAbstractDomain.h>
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 
@@ -15,7 +18,6 @@
 #include "ControlFlow.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
-#include "Lazy.h"
 #include "ReachingDefinitions.h"
 #include "Resolver.h"
 #include "ScopedCFG.h"
@@ -86,11 +88,16 @@ class WritesAnalyzer {
   // element with a (relevant) lifetime type as an "other" escape.
   InstructionEscapes compute_insn_escapes(const DexMethod* method) const {
     auto& cfg = method->get_code()->cfg();
-    Lazy<type_inference::TypeInference> type_inference([&cfg, method] {
-      auto res = std::make_unique<type_inference::TypeInference>(cfg);
-      res->run(method);
-      return res;
-    });
+    // The type inference is only needed for some writes. It is shared with
+    // other users of the unchanged code.
+    std::shared_ptr<const type_inference::TypeInference> type_inference_ptr;
+    auto get_type_environments = [&]() -> const auto& {
+      if (!type_inference_ptr) {
+        type_inference_ptr =
+            type_inference::get_shared_type_inference(cfg, method);
+      }
+      return type_inference_ptr->get_type_environments();
+    };
 
     reaching_defs::MoveAwareFixpointIterator fp_iter(cfg);
     fp_iter.run({});
@@ -139,7 +146,7 @@ class WritesAnalyzer {
         // Helper function to check if the formal type and the inferred type
         // have a (relevant) lifetime.
         auto has_lifetime =
-            [this, &type_inference, insn](
+            [this, &get_type_environments, insn](
                 reg_t reg, const boost::optional<const DexType*>& formal_type) {
               if (formal_type && !this->has_lifetime(*formal_type)) {
                 // If the formal type has no lifetime, then we can stop here.
@@ -147,8 +154,7 @@ class WritesAnalyzer {
                 // in, i.e. a subtype, cannot change this.
                 return false;
               }
-              const auto& type_env =
-                  type_inference->get_type_environments().at(insn);
+              const auto& type_env = get_type_environments().at(insn);
               const auto& inferred_type = type_env.get_dex_type(reg);
               if (inferred_type && !this->has_lifetime(*inferred_type)) {
                 return false;
@@ -182,8 +188,7 @@ class WritesAnalyzer {
           if (non_zero_value_defs.empty()) {
             continue;
           }
-          const auto& type_env =
-              type_inference->get_type_environments().at(insn);
+          const auto& type_env = get_type_environments().at(insn);
           const auto& array_type = type_env.get_dex_type(insn->src(1));
           boost::optional<const DexType*> component_type;
           if (array_type && type::is_array(*array_type)) {
@@ -325,8 +330,8 @@ class WritesAnalyzer {
   bool get_writes(
       const sparta::PatriciaTreeSet<const DexMethod*>& old_active,
       const DexMethod* method,
-      ConcurrentSet<DexField*>* non_zero_written_fields,
-      ConcurrentSet<DexField*>* non_vestigial_objects_written_fields,
+      std::unordered_set<DexField*>* non_zero_written_fields,
+      std::unordered_set<DexField*>* non_vestigial_objects_written_fields,
       bool* any_non_vestigial_objects_written_fields,
       std::unordered_set<DexMethod*>* invoked_base_ctors,
       bool* other_escapes) const {
@@ -381,6 +386,75 @@ class WritesAnalyzer {
   }
 };
 
+// The fields written by the methods analyzed by one thread.
+struct LocalFieldWrites {
+  std::unordered_set<DexField*> non_zero_written_fields;
+  std::unordered_set<DexField*> non_vestigial_objects_written_fields;
+
+  LocalFieldWrites& operator+=(const LocalFieldWrites& other) {
+    non_zero_written_fields.insert(other.non_zero_written_fields.begin(),
+                                   other.non_zero_written_fields.end());
+    non_vestigial_objects_written_fields.insert(
+        other.non_vestigial_objects_written_fields.begin(),
+        other.non_vestigial_objects_written_fields.end());
+    return *this;
+  }
+};
+
+/*
+ * Counts the field operations with one atomic counter per field and kind, for
+ * all fields defined in the scope, which are numbered densely. Fields defined
+ * elsewhere are rare; they are kept in a concurrent map.
+ */
+class FieldStatsCounters {
+ public:
+  explicit FieldStatsCounters(const Scope& scope) {
+    walk::fields(scope, [&](DexField* field) {
+      m_field_indices.emplace(field, m_fields.size());
+      m_fields.push_back(field);
+    });
+    m_counters = std::make_unique<std::atomic<size_t>[]>(m_fields.size() * 3);
+  }
+
+  void add(DexField* field, const field_op_tracker::FieldStats& stats) {
+    auto it = m_field_indices.find(field);
+    if (it == m_field_indices.end()) {
+      m_other_field_stats.update(
+          field, [&](DexField*, field_op_tracker::FieldStats& fs, bool) {
+            fs += stats;
+          });
+      return;
+    }
+    auto* counters = &m_counters[it->second * 3];
+    counters[0].fetch_add(stats.reads, std::memory_order_relaxed);
+    counters[1].fetch_add(stats.writes, std::memory_order_relaxed);
+    counters[2].fetch_add(stats.init_writes, std::memory_order_relaxed);
+  }
+
+  // Returns the stats of all fields that are read or written.
+  field_op_tracker::FieldStatsMap to_map() const {
+    field_op_tracker::FieldStatsMap field_stats(m_other_field_stats.begin(),
+                                                m_other_field_stats.end());
+    for (size_t i = 0; i < m_fields.size(); ++i) {
+      auto* counters = &m_counters[i * 3];
+      field_op_tracker::FieldStats stats;
+      stats.reads = counters[0].load(std::memory_order_relaxed);
+      stats.writes = counters[1].load(std::memory_order_relaxed);
+      stats.init_writes = counters[2].load(std::memory_order_relaxed);
+      if (stats.reads != 0 || stats.writes != 0) {
+        field_stats.emplace(m_fields[i], stats);
+      }
+    }
+    return field_stats;
+  }
+
+ private:
+  std::vector<DexField*> m_fields;
+  std::unordered_map<const DexField*, size_t> m_field_indices;
+  std::unique_ptr<std::atomic<size_t>[]> m_counters;
+  ConcurrentMap<DexField*, field_op_tracker::FieldStats> m_other_field_stats;
+};
+
 } // namespace
 
 namespace field_op_tracker {
@@ -416,19 +490,29 @@ void analyze_writes(const Scope& scope,
                     const TypeLifetimes* type_lifetimes,
                     FieldWrites* res) {
   WritesAnalyzer analyzer(scope, field_stats, type_lifetimes);
-  walk::parallel::code(scope, [&](const DexMethod* method, const IRCode&) {
-    auto success = analyzer.get_writes(
-        /*active*/ {}, method, &res->non_zero_written_fields,
-        &res->non_vestigial_objects_written_fields,
-        /* any_non_vestigial_objects_written_fields */ nullptr,
-        /* invoked_base_ctors */ nullptr,
-        /* other_escapes */ nullptr);
-    always_assert(success);
-  });
+  auto writes = walk::parallel::methods<LocalFieldWrites>(
+      scope, [&](const DexMethod* method, LocalFieldWrites* local) {
+        if (method->get_code() == nullptr) {
+          return;
+        }
+        auto success = analyzer.get_writes(
+            /*active*/ {}, method, &local->non_zero_written_fields,
+            &local->non_vestigial_objects_written_fields,
+            /* any_non_vestigial_objects_written_fields */ nullptr,
+            /* invoked_base_ctors */ nullptr,
+            /* other_escapes */ nullptr);
+        always_assert(success);
+      });
+  for (auto* field : writes.non_zero_written_fields) {
+    res->non_zero_written_fields.insert(field);
+  }
+  for (auto* field : writes.non_vestigial_objects_written_fields) {
+    res->non_vestigial_objects_written_fields.insert(field);
+  }
 };
 
 FieldStatsMap analyze(const Scope& scope) {
-  ConcurrentMap<DexField*, FieldStats> concurrent_field_stats;
+  FieldStatsCounters counters(scope);
   // Gather the read/write counts from instructions.
   walk::parallel::methods(scope, [&](DexMethod* method) {
     if (!method->get_code()) {
@@ -491,13 +575,11 @@ FieldStatsMap analyze(const Scope& scope) {
           return editable_cfg_adapter::LOOP_CONTINUE;
         });
     for (auto& p : field_stats) {
-      concurrent_field_stats.update(
-          p.first, [&](DexField*, FieldStats& fs, bool) { fs += p.second; });
+      counters.add(p.first, p.second);
     }
   });
 
-  FieldStatsMap field_stats(concurrent_field_stats.begin(),
-                            concurrent_field_stats.end());
+  auto field_stats = counters.to_map();
 
   // Gather field reads from annotations.
   walk::annotations(scope, [&](DexAnnotation* anno) {
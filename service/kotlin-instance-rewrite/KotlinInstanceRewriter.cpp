@@ -6,10 +6,14 @@
  */
 
 #include "KotlinInstanceRewriter.h"
+
+#include <atomic>
+
 #include "CFGMutation.h"
 #include "PassManager.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 DexField* has_instance_field(DexClass* cls, const DexString* instance) {
@@ -140,72 +144,89 @@ KotlinInstanceRewriter::Stats KotlinInstanceRewriter::transform(
   std::sort(fields_to_rewrite.begin(), fields_to_rewrite.end(),
             compare_dexfields);
 
+  // Group the edits by method, as a method may read several INSTANCE fields,
+  // or be a <clinit> whose INSTANCE write gets removed as well, and then
+  // rewrite all methods in parallel.
+  struct MethodEdits {
+    std::unordered_set<DexFieldRef*> sputs_to_remove;
+    std::unordered_set<DexFieldRef*> sgets_to_replace;
+  };
+  std::unordered_map<DexMethod*, MethodEdits> edits;
+  std::unordered_map<DexFieldRef*, DexMethodRef*> inits;
   for (auto* field : fields_to_rewrite) {
     stats.kotlin_instances_with_single_use++;
-    // Remove instance from cls
     auto* cls = type_class(field->get_class());
-    auto dmethods = cls->get_dmethods();
-    for (auto* meth : dmethods) {
+    for (auto* meth : cls->get_dmethods()) {
       if (method::is_clinit(meth)) {
+        edits[meth].sputs_to_remove.insert(field);
+        break;
+      }
+    }
+    DexMethodRef* init = DexMethod::get_method(
+        cls->get_type(), DexString::make_string("<init>"),
+        DexProto::make_proto(type::_void(), DexTypeList::make_type_list({})));
+    always_assert(init);
+    // Make this constructor publcic
+    set_public(init->as_def());
+    inits.emplace(field, init);
+    for (auto& method_it : concurrent_instance_map.find(field)->second) {
+      edits[method_it.second].sgets_to_replace.insert(field);
+    }
+  }
+
+  std::vector<std::pair<DexMethod*, const MethodEdits*>> methods_to_edit;
+  methods_to_edit.reserve(edits.size());
+  for (auto& [meth, method_edits] : edits) {
+    methods_to_edit.emplace_back(meth, &method_edits);
+  }
+  std::atomic<size_t> fields_removed{0};
+  std::atomic<size_t> new_inserted{0};
+  workqueue_run<std::pair<DexMethod*, const MethodEdits*>>(
+      [&](const std::pair<DexMethod*, const MethodEdits*>& p) {
+        auto* meth = p.first;
+        const auto& method_edits = *p.second;
         auto& cfg = meth->get_code()->cfg();
         cfg::CFGMutation m(cfg);
-        TRACE(KOTLIN_INSTANCE, 5, "%s <clinit> before\n%s", SHOW(cls),
-              SHOW(cfg));
+        TRACE(KOTLIN_INSTANCE, 5, "%s before\n%s", SHOW(meth), SHOW(cfg));
         auto iterable = cfg::InstructionIterable(cfg);
         for (auto insn_it = iterable.begin(); insn_it != iterable.end();
              insn_it++) {
           auto insn = insn_it->insn;
-          if (!opcode::is_an_sput(insn->opcode()) ||
-              insn->get_field() != field) {
+          if (opcode::is_an_sput(insn->opcode()) &&
+              method_edits.sputs_to_remove.count(insn->get_field())) {
+            m.remove(insn_it);
+            fields_removed++;
             continue;
           }
-
-          m.remove(insn_it);
-          stats.kotlin_instance_fields_removed++;
+          // Convert INSTANCE read to new instance creation
+          if (!opcode::is_an_sget(insn->opcode()) ||
+              !method_edits.sgets_to_replace.count(insn->get_field())) {
+            continue;
+          }
+          auto* field = insn->get_field();
+          auto move_result_it = cfg.move_result_of(insn_it);
+          IRInstruction* new_isn = new IRInstruction(OPCODE_NEW_INSTANCE);
+          new_isn->set_type(field->get_class());
+          IRInstruction* mov_result =
+              new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
+          mov_result->set_dest(move_result_it->insn->dest());
+          IRInstruction* init_isn = new IRInstruction(OPCODE_INVOKE_DIRECT);
+          init_isn->set_method(inits.at(field))
+              ->set_srcs_size(1)
+              ->set_src(0, move_result_it->insn->dest());
+          m.replace(insn_it, {new_isn, mov_result, init_isn});
+          m.remove(move_result_it);
+          new_inserted++;
         }
         m.flush();
-        TRACE(KOTLIN_INSTANCE, 5, "%s <clinit> after\n%s", SHOW(cls),
-              SHOW(cfg));
-        break;
-      }
-    }
+        TRACE(KOTLIN_INSTANCE, 5, "%s after\n%s", SHOW(meth), SHOW(cfg));
+      },
+      methods_to_edit);
+  stats.kotlin_instance_fields_removed += fields_removed;
+  stats.kotlin_new_inserted += new_inserted;
 
-    // Convert INSTANCE read to new instance creation
-    for (auto& method_it : concurrent_instance_map.find(field)->second) {
-      auto* meth = method_it.second;
-      auto& cfg = meth->get_code()->cfg();
-      cfg::CFGMutation m(cfg);
-      TRACE(KOTLIN_INSTANCE, 5, "%s before\n%s", SHOW(meth), SHOW(cfg));
-      DexMethodRef* init = DexMethod::get_method(
-          cls->get_type(), DexString::make_string("<init>"),
-          DexProto::make_proto(type::_void(), DexTypeList::make_type_list({})));
-      always_assert(init);
-      // Make this constructor publcic
-      set_public(init->as_def());
-      auto iterable = cfg::InstructionIterable(cfg);
-      for (auto insn_it = iterable.begin(); insn_it != iterable.end();
-           insn_it++) {
-        auto insn = insn_it->insn;
-        if (!opcode::is_an_sget(insn->opcode()) || insn->get_field() != field) {
-          continue;
-        }
-        auto move_result_it = cfg.move_result_of(insn_it);
-        IRInstruction* new_isn = new IRInstruction(OPCODE_NEW_INSTANCE);
-        new_isn->set_type(cls->get_type());
-        IRInstruction* mov_result =
-            new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
-        mov_result->set_dest(move_result_it->insn->dest());
-        IRInstruction* init_isn = new IRInstruction(OPCODE_INVOKE_DIRECT);
-        init_isn->set_method(init)->set_srcs_size(1)->set_src(
-            0, move_result_it->insn->dest());
-        m.replace(insn_it, {new_isn, mov_result, init_isn});
-        m.remove(move_result_it);
-        stats.kotlin_new_inserted++;
-      }
-      m.flush();
-      TRACE(KOTLIN_INSTANCE, 5, "%s after\n%s", SHOW(meth), SHOW(cfg));
-    }
-    cls->remove_field(resolve_field(field));
+  for (auto* field : fields_to_rewrite) {
+    type_class(field->get_class())->remove_field(resolve_field(field));
   }
   return stats;
 }
@@ -7,6 +7,7 @@
 
 #include "LocalDce.h"
 
+#include <algorithm>
 #include <array>
 #include <unordered_set>
 #include <vector>
@@ -100,9 +101,22 @@ LocalDce::get_dead_instructions(const cfg::ControlFlowGraph& cfg,
                                 const std::vector<cfg::Block*>& blocks,
                                 bool* any_init_class_insns) {
   auto regs = cfg.get_registers_size();
-  std::unordered_map<cfg::BlockId, boost::dynamic_bitset<>> liveness;
+  // LocalDce runs on every method, and the shrinker runs it again after every
+  // inlining, so the liveness bitsets (indexed by block id) are kept per
+  // thread and reused, unless they got too large to retain.
+  thread_local std::vector<boost::dynamic_bitset<>> liveness;
+  thread_local boost::dynamic_bitset<> prev_liveness;
+  cfg::BlockId max_id = 0;
   for (cfg::Block* b : cfg.blocks()) {
-    liveness.emplace(b->id(), boost::dynamic_bitset<>(regs + 1));
+    max_id = std::max(max_id, b->id());
+  }
+  if (liveness.size() <= max_id) {
+    liveness.resize(max_id + 1);
+  }
+  for (cfg::Block* b : cfg.blocks()) {
+    auto& bliveness = liveness[b->id()];
+    bliveness.resize(regs + 1);
+    bliveness.reset();
   }
   bool changed;
   std::vector<std::pair<cfg::Block*, IRList::iterator>> dead_instructions;
@@ -112,8 +126,8 @@ LocalDce::get_dead_instructions(const cfg::ControlFlowGraph& cfg,
     changed = false;
     dead_instructions.clear();
     for (auto& b : blocks) {
-      auto prev_liveness = liveness.at(b->id());
-      auto& bliveness = liveness.at(b->id());
+      auto& bliveness = liveness[b->id()];
+      prev_liveness = bliveness;
       bliveness.reset();
       TRACE(DCE, 5, "B%zu: %s", b->id(), show(bliveness).c_str());
 
@@ -126,8 +140,8 @@ LocalDce::get_dead_instructions(const cfg::ControlFlowGraph& cfg,
               5,
               "  S%zu: %s",
               s->target()->id(),
-              SHOW(liveness.at(s->target()->id())));
-        bliveness |= liveness.at(s->target()->id());
+              SHOW(liveness[s->target()->id()]));
+        bliveness |= liveness[s->target()->id()];
       }
 
       // Compute live-in for this block by walking its instruction list in
@@ -158,6 +172,11 @@ LocalDce::get_dead_instructions(const cfg::ControlFlowGraph& cfg,
       }
     }
   } while (changed);
+  constexpr size_t kMaxRetainedLivenessBits = 1 << 24;
+  if (liveness.size() * (regs + 1) > kMaxRetainedLivenessBits) {
+    liveness = {};
+    prev_liveness = {};
+  }
   return dead_instructions;
 }
 
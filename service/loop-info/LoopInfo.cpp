@@ -222,12 +222,35 @@ Loop* LoopInfo::get_loop_for(cfg::Block* block) {
   return it != m_block_location.end() ? it->second : nullptr;
 }
 
-size_t LoopInfo::num_loops() { return m_loops.size(); }
+const Loop* LoopInfo::get_loop_for(const cfg::Block* block) const {
+  auto it = m_block_location.find(const_cast<cfg::Block*>(block));
+  return it != m_block_location.end() ? it->second : nullptr;
+}
+
+size_t LoopInfo::num_loops() const { return m_loops.size(); }
+
+size_t LoopInfo::max_loop_depth() const {
+  size_t max_depth{0};
+  for (const auto& loop : m_loops) {
+    max_depth = std::max(max_depth, (size_t)loop.get_loop_depth());
+  }
+  return max_depth;
+}
 
 LoopInfo::iterator LoopInfo::begin() { return m_loops.begin(); }
 
 LoopInfo::iterator LoopInfo::end() { return m_loops.end(); }
 
+LoopInfo::const_iterator LoopInfo::begin() const { return m_loops.begin(); }
+
+LoopInfo::const_iterator LoopInfo::end() const { return m_loops.end(); }
+
 LoopInfo::reverse_iterator LoopInfo::rbegin() { return m_loops.rbegin(); }
 
 LoopInfo::reverse_iterator LoopInfo::rend() { return m_loops.rend(); }
+
+std::shared_ptr<const LoopInfo> loop_impl::get_cached_loop_info(
+    const cfg::ControlFlowGraph& cfg) {
+  return cfg.get_structural_data<LoopInfo, LoopInfo>(
+      [&cfg]() { return std::make_shared<const LoopInfo>(cfg); });
+}
@@ -11,6 +11,7 @@
 
 #include "ControlFlow.h"
 
+#include <memory>
 #include <queue>
 
 namespace loop_impl {
@@ -129,13 +130,19 @@ class Loop {
 class LoopInfo {
  public:
   using iterator = std::deque<Loop>::iterator;
+  using const_iterator = std::deque<Loop>::const_iterator;
   using reverse_iterator = std::deque<Loop>::reverse_iterator;
   explicit LoopInfo(const cfg::ControlFlowGraph& cfg);
   explicit LoopInfo(cfg::ControlFlowGraph& cfg);
   Loop* get_loop_for(cfg::Block* block);
-  size_t num_loops();
+  const Loop* get_loop_for(const cfg::Block* block) const;
+  size_t num_loops() const;
+  // The maximal loop depth, or 0 if there are no loops.
+  size_t max_loop_depth() const;
   iterator begin();
   iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
   reverse_iterator rbegin();
   reverse_iterator rend();
 
@@ -148,4 +155,13 @@ class LoopInfo {
   std::unordered_map<cfg::Block*, Loop*> m_block_location;
 };
 
+/*
+ * Returns the loops of a CFG, cached until the CFG changes structurally (see
+ * cfg::ControlFlowGraph::get_structural_data). For the loops of an unchanged
+ * CFG, this is cheap enough for heuristics that query them repeatedly. Unlike
+ * LoopInfo on a non-const CFG, this doesn't create preheaders.
+ */
+std::shared_ptr<const LoopInfo> get_cached_loop_info(
+    const cfg::ControlFlowGraph& cfg);
+
 } // namespace loop_impl
@@ -14,15 +14,20 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
 struct CodeAsKey {
   const cfg::ControlFlowGraph& cfg;
   const bool dedup_fill_in_stack_trace;
+  const size_t hash;
 
-  CodeAsKey(cfg::ControlFlowGraph& c, bool dedup_fill_in_stack_trace)
-      : cfg(c), dedup_fill_in_stack_trace(dedup_fill_in_stack_trace) {}
+  CodeAsKey(cfg::ControlFlowGraph& c,
+            bool dedup_fill_in_stack_trace,
+            size_t hash)
+      : cfg(c), dedup_fill_in_stack_trace(dedup_fill_in_stack_trace),
+        hash(hash) {}
 
   static bool non_throw_instruction_equal(const IRInstruction& left,
                                           const IRInstruction& right) {
@@ -39,26 +44,20 @@ struct CodeAsKey {
 };
 
 struct CodeHasher {
-  size_t operator()(const CodeAsKey& key) const {
-    size_t result = 0;
-    for (auto& mie : cfg::InstructionIterable(
-             const_cast<cfg::ControlFlowGraph&>(key.cfg))) {
-      result ^= mie.insn->hash();
-    }
-    return result;
-  }
+  size_t operator()(const CodeAsKey& key) const { return key.hash; }
 };
 
 using DuplicateMethods =
     std::unordered_map<CodeAsKey, MethodOrderedSet, CodeHasher>;
 
 std::vector<MethodOrderedSet> get_duplicate_methods_simple(
-    const MethodOrderedSet& methods, bool dedup_fill_in_stack_trace) {
+    const MethodOrderedSet& methods,
+    bool dedup_fill_in_stack_trace,
+    const std::unordered_map<const DexMethod*, size_t>& code_hashes) {
   DuplicateMethods duplicates;
   for (DexMethod* method : methods) {
-    always_assert(method->get_code());
-    always_assert(method->get_code()->editable_cfg_built());
-    duplicates[CodeAsKey(method->get_code()->cfg(), dedup_fill_in_stack_trace)]
+    duplicates[CodeAsKey(method->get_code()->cfg(), dedup_fill_in_stack_trace,
+                         code_hashes.at(method))]
         .emplace(method);
   }
 
@@ -70,6 +69,24 @@ std::vector<MethodOrderedSet> get_duplicate_methods_simple(
   return result;
 }
 
+// The structural hashes of all methods, computed in parallel.
+std::unordered_map<const DexMethod*, size_t> get_code_hashes(
+    const std::vector<DexMethod*>& methods) {
+  std::vector<size_t> hashes(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    auto* code = methods[i]->get_code();
+    always_assert(code);
+    always_assert(code->editable_cfg_built());
+    hashes[i] = code->cfg().structural_hash();
+  });
+  std::unordered_map<const DexMethod*, size_t> code_hashes;
+  code_hashes.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); i++) {
+    code_hashes.emplace(methods[i], hashes[i]);
+  }
+  return code_hashes;
+}
+
 } // namespace
 
 namespace method_dedup {
@@ -107,11 +124,12 @@ std::vector<MethodOrderedSet> group_identical_methods(
     const std::vector<DexMethod*>& methods, bool dedup_fill_in_stack_trace) {
   std::vector<MethodOrderedSet> result;
   std::vector<MethodOrderedSet> same_protos = group_similar_methods(methods);
+  auto code_hashes = get_code_hashes(methods);
 
   // Find actual duplicates.
   for (const auto& same_proto : same_protos) {
-    std::vector<MethodOrderedSet> duplicates =
-        get_duplicate_methods_simple(same_proto, dedup_fill_in_stack_trace);
+    std::vector<MethodOrderedSet> duplicates = get_duplicate_methods_simple(
+        same_proto, dedup_fill_in_stack_trace, code_hashes);
 
     result.insert(result.end(), duplicates.begin(), duplicates.end());
   }
@@ -7,7 +7,9 @@
 
 #include "CFGInliner.h"
 
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 #include "DexPosition.h"
 #include "IRList.h"
@@ -63,6 +65,103 @@ void CFGInliner::inline_cfg(ControlFlowGraph* caller,
                             CFGInlinerPlugin& plugin,
                             DexMethod* rewrite_invoke_super_callee,
                             bool needs_constructor_fence) {
+  inline_cfg_impl(caller, inline_site, needs_receiver_cast, needs_init_class,
+                  callee_orig, next_caller_reg, plugin,
+                  rewrite_invoke_super_callee, needs_constructor_fence,
+                  /* check_caller */ true);
+}
+
+std::vector<bool> CFGInliner::inline_cfgs(
+    ControlFlowGraph* caller, const std::vector<InlineSite>& sites) {
+  struct Location {
+    Block* block{nullptr};
+    IRList::iterator it;
+    // Position in the caller when the sites were located, which orders the
+    // sites of a block.
+    size_t ordinal{0};
+  };
+  std::vector<Location> locations(sites.size());
+  std::unordered_map<const IRInstruction*, size_t> site_indices;
+  size_t callee_edges = 0;
+  for (size_t i = 0; i < sites.size(); ++i) {
+    auto emplaced = site_indices.emplace(sites[i].callsite, i).second;
+    always_assert_log(emplaced, "duplicate callsite %s",
+                      SHOW(sites[i].callsite));
+    callee_edges += sites[i].callee->m_edges.size();
+  }
+
+  // The sites in each block that remain to be inlined.
+  std::unordered_map<Block*, std::vector<size_t>> block_sites;
+  size_t ordinal = 0;
+  for (auto* block : caller->blocks()) {
+    for (auto it = block->begin(); it != block->end(); ++it) {
+      if (it->type != MFLOW_OPCODE) {
+        continue;
+      }
+      auto site_it = site_indices.find(it->insn);
+      if (site_it != site_indices.end()) {
+        locations[site_it->second] = Location{block, it, ordinal};
+        block_sites[block].push_back(site_it->second);
+      }
+      ordinal++;
+    }
+  }
+
+  caller->m_edges.reserve(caller->m_edges.size() + callee_edges);
+
+  std::vector<bool> inlined(sites.size(), false);
+  CFGInlinerPlugin base_plugin;
+  for (size_t i = 0; i < sites.size(); ++i) {
+    auto& location = locations[i];
+    if (location.block == nullptr) {
+      continue;
+    }
+    const auto& site = sites[i];
+    auto* block = location.block;
+    auto next_caller_reg = site.next_caller_reg
+                               ? *site.next_caller_reg
+                               : caller->get_registers_size();
+    auto* following = inline_cfg_impl(
+        caller, block->to_cfg_instruction_iterator(*location.it),
+        site.needs_receiver_cast, site.needs_init_class, *site.callee,
+        next_caller_reg, base_plugin, site.rewrite_invoke_super_callee,
+        site.needs_constructor_fence, /* check_caller */ false);
+    inlined[i] = true;
+
+    // The remaining sites after this one in its block have moved.
+    auto& remaining = block_sites.at(block);
+    std::vector<size_t> kept;
+    for (auto j : remaining) {
+      if (j == i) {
+        continue;
+      }
+      if (locations[j].ordinal > location.ordinal) {
+        always_assert(following != block);
+        locations[j].block = following;
+        block_sites[following].push_back(j);
+      } else {
+        kept.push_back(j);
+      }
+    }
+    remaining = std::move(kept);
+  }
+
+  if (ControlFlowGraph::DEBUG) {
+    caller->sanity_check();
+  }
+  return inlined;
+}
+
+Block* CFGInliner::inline_cfg_impl(ControlFlowGraph* caller,
+                                   const InstructionIterator& inline_site,
+                                   DexType* needs_receiver_cast,
+                                   DexType* needs_init_class,
+                                   const ControlFlowGraph& callee_orig,
+                                   size_t next_caller_reg,
+                                   CFGInlinerPlugin& plugin,
+                                   DexMethod* rewrite_invoke_super_callee,
+                                   bool needs_constructor_fence,
+                                   bool check_caller) {
   always_assert(&inline_site.cfg() == caller);
 
   // copy the callee because we're going to move its contents into the caller
@@ -210,10 +309,11 @@ void CFGInliner::inline_cfg(ControlFlowGraph* caller,
     caller->remove_insn(inline_site);
   }
 
-  if (ControlFlowGraph::DEBUG) {
+  if (check_caller && ControlFlowGraph::DEBUG) {
     caller->sanity_check();
   }
   TRACE(CFG, 3, "final %s", SHOW(*caller));
+  return inline_after ? split_on_inline : callsite_blk;
 }
 
 void CFGInliner::cleanup_callee_debug(ControlFlowGraph* cfg) {
@@ -327,8 +427,14 @@ void CFGInliner::steal_contents(ControlFlowGraph* caller,
   }
   callee->m_blocks.clear();
 
-  // transfer ownership of the edges
-  caller->m_edges.reserve(caller->m_edges.size() + callee->m_edges.size());
+  // transfer ownership of the edges, growing the caller's edges geometrically
+  // as reserving the exact size would rehash them on every inlining
+  auto needed_edges = caller->m_edges.size() + callee->m_edges.size();
+  if (needed_edges >
+      caller->m_edges.bucket_count() * caller->m_edges.max_load_factor()) {
+    caller->m_edges.reserve(
+        std::max(needed_edges, 2 * caller->m_edges.size()));
+  }
   caller->m_edges.insert(callee->m_edges.begin(), callee->m_edges.end());
   callee->m_edges.clear();
 }
@@ -44,7 +44,48 @@ class CFGInliner {
                          DexMethod* rewrite_invoke_super_callee = nullptr,
                          bool needs_constructor_fence = false);
 
+  /*
+   * One callsite to inline with inline_cfgs. If no next_caller_reg is given,
+   * the callee's registers are placed after the caller's registers, as they
+   * are at the time this site gets inlined.
+   */
+  struct InlineSite {
+    IRInstruction* callsite;
+    const ControlFlowGraph* callee;
+    DexType* needs_receiver_cast{nullptr};
+    DexType* needs_init_class{nullptr};
+    boost::optional<size_t> next_caller_reg;
+    DexMethod* rewrite_invoke_super_callee{nullptr};
+    bool needs_constructor_fence{false};
+  };
+
+  /*
+   * Copy the blocks of several callees into caller, with the default plugin.
+   * The result is the same as inlining the sites one by one in the given
+   * order, but all callsites are located in a single pass over the caller,
+   * and the caller's edges are only grown once. Returns for each site whether
+   * its callsite was found in the caller, and so was inlined.
+   */
+  static std::vector<bool> inline_cfgs(ControlFlowGraph* caller,
+                                       const std::vector<InlineSite>& sites);
+
  private:
+  /*
+   * Does the work of inline_cfg, and returns the block that runs after the
+   * inlined callee. All caller instructions that followed the inline site in
+   * its block are in that block afterwards.
+   */
+  static Block* inline_cfg_impl(ControlFlowGraph* caller,
+                                const cfg::InstructionIterator& inline_site,
+                                DexType* needs_receiver_cast,
+                                DexType* needs_init_class,
+                                const ControlFlowGraph& callee,
+                                size_t next_caller_reg,
+                                CFGInlinerPlugin& plugin,
+                                DexMethod* rewrite_invoke_super_callee,
+                                bool needs_constructor_fence,
+                                bool check_caller);
+
   /*
    * Prepares the CFG for inlining by removing a subset of MFLOW_DEBUG
    * instructions that would make no sense to be duplicated.
@@ -156,6 +156,41 @@ void CallSiteSummary::append_key_value(std::ostringstream& oss,
 
 namespace inliner {
 
+std::shared_ptr<const CallerInvokeArguments> SharedCallerInvokeArguments::get(
+    const DexMethod* caller,
+    const std::string& incoming_arguments_key,
+    const Compute& compute,
+    bool* reused) const {
+  const auto& cfg = caller->get_code()->cfg();
+  bool computed{false};
+  auto get_code_data = [&]() {
+    return cfg.get_code_data<CallerInvokeArguments, CallerInvokeArguments>(
+        [&]() {
+          computed = true;
+          return compute();
+        });
+  };
+  auto data = get_code_data();
+  if (data->incoming_arguments_key != incoming_arguments_key) {
+    // The code is unchanged, but the caller got called with different
+    // arguments. Let go of the stale data, so that it can be replaced.
+    m_retained.erase(caller);
+    data = nullptr;
+    data = get_code_data();
+    if (data->incoming_arguments_key != incoming_arguments_key) {
+      // Someone else is still holding on to the stale data.
+      computed = true;
+      data = compute();
+    }
+  }
+  *reused = !computed;
+  if (!computed) {
+    return data;
+  }
+  m_retained.insert_or_assign(std::make_pair(caller, data));
+  return data;
+}
+
 CallSiteSummarizer::CallSiteSummarizer(
     shrinker::Shrinker& shrinker,
     const ConcurrentMethodToMethodOccurrences& callee_caller,
@@ -163,7 +198,8 @@ CallSiteSummarizer::CallSiteSummarizer(
     GetCalleeFunction get_callee_fn,
     HasCalleeOtherCallSitesPredicate has_callee_other_call_sites_fn,
     std::function<bool(const ConstantValue&)>* filter_fn,
-    CallSiteSummaryStats* stats)
+    CallSiteSummaryStats* stats,
+    const SharedCallerInvokeArguments* shared_invoke_arguments)
     : m_shrinker(shrinker),
       m_callee_caller(callee_caller),
       m_caller_callee(caller_callee),
@@ -171,7 +207,8 @@ CallSiteSummarizer::CallSiteSummarizer(
       m_has_callee_other_call_sites_fn(
           std::move(has_callee_other_call_sites_fn)),
       m_filter_fn(filter_fn),
-      m_stats(stats) {}
+      m_stats(stats),
+      m_shared_invoke_arguments(shared_invoke_arguments) {}
 
 const CallSiteSummary* CallSiteSummarizer::internalize_call_site_summary(
     const CallSiteSummary& call_site_summary) {
@@ -243,10 +280,7 @@ void CallSiteSummarizer::summarize() {
       return;
     }
     auto& callees = m_caller_callee.at_unsafe(method);
-    ConstantEnvironment initial_env =
-        constant_propagation::interprocedural::env_with_params(
-            is_static(method), method->get_code(), arguments);
-    auto res = get_invoke_call_site_summaries(method, callees, initial_env);
+    auto res = get_invoke_call_site_summaries(method, callees, arguments);
     for (auto& p : res.invoke_call_site_summaries) {
       auto insn = p.first;
       auto callee = m_get_callee_fn(method, insn);
@@ -286,14 +320,16 @@ void CallSiteSummarizer::summarize() {
       summaries_scheduler.run(callers.begin(), callers.end());
 }
 
-InvokeCallSiteSummariesAndDeadBlocks
-CallSiteSummarizer::get_invoke_call_site_summaries(
-    DexMethod* caller,
-    const std::unordered_map<DexMethod*, size_t>& callees,
-    const ConstantEnvironment& initial_env) {
+std::unique_ptr<CallerInvokeArguments>
+CallSiteSummarizer::compute_invoke_arguments(
+    DexMethod* caller, const CallSiteArguments& arguments) {
   IRCode* code = caller->get_code();
+  ConstantEnvironment initial_env =
+      constant_propagation::interprocedural::env_with_params(
+          is_static(caller), code, arguments);
 
-  InvokeCallSiteSummariesAndDeadBlocks res;
+  auto res = std::make_unique<CallerInvokeArguments>();
+  res->incoming_arguments_key = CallSiteSummary{arguments, false}.get_key();
   auto& cfg = code->cfg();
   constant_propagation::intraprocedural::FixpointIterator intra_cp(
       &m_shrinker.get_cp_state(),
@@ -309,7 +345,7 @@ CallSiteSummarizer::get_invoke_call_site_summaries(
   for (const auto& block : cfg.blocks()) {
     auto env = intra_cp.get_entry_state_at(block);
     if (env.is_bottom()) {
-      res.dead_blocks++;
+      res->dead_blocks++;
       // we found an unreachable block; ignore invoke instructions in it
       continue;
     }
@@ -317,27 +353,21 @@ CallSiteSummarizer::get_invoke_call_site_summaries(
     auto iterable = InstructionIterable(block);
     for (auto it = iterable.begin(); it != iterable.end(); it++) {
       auto insn = it->insn;
-      auto callee = m_get_callee_fn(caller, insn);
-      if (callee && callees.count(callee)) {
-        CallSiteSummary call_site_summary;
+      if (opcode::is_an_invoke(insn->opcode())) {
+        CallerInvokeArguments::Invoke invoke;
+        invoke.insn = insn;
         const auto& srcs = insn->srcs();
-        for (size_t i = is_static(callee) ? 0 : 1; i < srcs.size(); ++i) {
+        for (size_t i = 0; i < srcs.size(); ++i) {
           auto val = env.get(srcs[i]);
           always_assert(!val.is_bottom());
-          if (val.is_top()) {
-            continue;
-          }
-          if (m_filter_fn && !(*m_filter_fn)(val)) {
-            continue;
+          if (!val.is_top()) {
+            invoke.srcs.emplace_back(i, std::move(val));
           }
-          call_site_summary.arguments.set(i, val);
         }
-        call_site_summary.result_used =
-            !callee->get_proto()->is_void() &&
+        invoke.has_move_result =
             !cfg.move_result_of(block->to_cfg_instruction_iterator(it))
                  .is_end();
-        res.invoke_call_site_summaries.emplace_back(
-            insn, internalize_call_site_summary(call_site_summary));
+        res->invokes.push_back(std::move(invoke));
       }
       intra_cp.analyze_instruction(insn, &env, insn == last_insn->insn);
       if (env.is_bottom()) {
@@ -346,7 +376,50 @@ CallSiteSummarizer::get_invoke_call_site_summaries(
       }
     }
   }
+  return res;
+}
 
+InvokeCallSiteSummariesAndDeadBlocks
+CallSiteSummarizer::get_invoke_call_site_summaries(
+    DexMethod* caller,
+    const std::unordered_map<DexMethod*, size_t>& callees,
+    const CallSiteArguments& arguments) {
+  std::shared_ptr<const CallerInvokeArguments> invoke_arguments;
+  if (m_shared_invoke_arguments) {
+    bool reused;
+    invoke_arguments = m_shared_invoke_arguments->get(
+        caller, CallSiteSummary{arguments, false}.get_key(),
+        [&]() { return compute_invoke_arguments(caller, arguments); },
+        &reused);
+    if (reused) {
+      m_stats->constant_invoke_callers_reused++;
+    }
+  } else {
+    invoke_arguments = compute_invoke_arguments(caller, arguments);
+  }
+
+  InvokeCallSiteSummariesAndDeadBlocks res;
+  res.dead_blocks = invoke_arguments->dead_blocks;
+  for (const auto& invoke : invoke_arguments->invokes) {
+    auto callee = m_get_callee_fn(caller, invoke.insn);
+    if (!callee || !callees.count(callee)) {
+      continue;
+    }
+    CallSiteSummary call_site_summary;
+    for (const auto& [i, val] : invoke.srcs) {
+      if (i == 0 && !is_static(callee)) {
+        continue;
+      }
+      if (m_filter_fn && !(*m_filter_fn)(val)) {
+        continue;
+      }
+      call_site_summary.arguments.set(i, val);
+    }
+    call_site_summary.result_used =
+        !callee->get_proto()->is_void() && invoke.has_move_result;
+    res.invoke_call_site_summaries.emplace_back(
+        invoke.insn, internalize_call_site_summary(call_site_summary));
+  }
   return res;
 }
 
@@ -7,6 +7,12 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ConcurrentContainers.h"
 #include "Shrinker.h"
 
 using CallSiteArguments = constant_propagation::interprocedural::ArgumentDomain;
@@ -62,11 +68,61 @@ namespace inliner {
 using GetCalleeFunction = std::function<DexMethod*(DexMethod*, IRInstruction*)>;
 using HasCalleeOtherCallSitesPredicate = std::function<bool(DexMethod*)>;
 
+/*
+ * The constant arguments of all invocations in the reachable code of a caller,
+ * as found by the constant propagation of the CallSiteSummarizer, given the
+ * caller's incoming arguments. This does not depend on which invocations are
+ * of interest to a particular CallSiteSummarizer, so that it can be shared.
+ */
+struct CallerInvokeArguments {
+  struct Invoke {
+    IRInstruction* insn;
+    // All non-top source values, by source index.
+    std::vector<std::pair<src_index_t, ConstantValue>> srcs;
+    bool has_move_result;
+  };
+  std::vector<Invoke> invokes;
+  size_t dead_blocks{0};
+  // See CallSiteSummary::get_key().
+  std::string incoming_arguments_key;
+};
+
+/*
+ * Keeps the CallerInvokeArguments of callers alive across CallSiteSummarizer
+ * instances, e.g. of the inliners of different passes, which get this from
+ * PassManager::get_self_validating_analysis(). They are reused while the code
+ * of a caller is unchanged, as tracked by ControlFlowGraph::get_code_data(),
+ * and its incoming arguments are the same.
+ *
+ * The analysis also depends on the immutable attributes known to the shrinker,
+ * so this must only be used with shrinkers that know just the built-in ones,
+ * i.e. not with ShrinkerConfig::analyze_constructors.
+ */
+class SharedCallerInvokeArguments {
+ public:
+  using Compute = std::function<std::unique_ptr<CallerInvokeArguments>()>;
+
+  // Sets `reused` to whether the returned data did not need to be computed.
+  std::shared_ptr<const CallerInvokeArguments> get(
+      const DexMethod* caller,
+      const std::string& incoming_arguments_key,
+      const Compute& compute,
+      bool* reused) const;
+
+  size_t size() const { return m_retained.size(); }
+
+ private:
+  mutable ConcurrentMap<const DexMethod*,
+                        std::shared_ptr<const CallerInvokeArguments>>
+      m_retained;
+};
+
 struct CallSiteSummaryStats {
   std::atomic<size_t> constant_invoke_callers_unreachable{0};
   std::atomic<size_t> constant_invoke_callers_analyzed{0};
   std::atomic<size_t> constant_invoke_callers_unreachable_blocks{0};
   std::atomic<size_t> constant_invoke_callers_critical_path_length{0};
+  std::atomic<size_t> constant_invoke_callers_reused{0};
 };
 
 class CallSiteSummarizer {
@@ -77,6 +133,7 @@ class CallSiteSummarizer {
   HasCalleeOtherCallSitesPredicate m_has_callee_other_call_sites_fn;
   std::function<bool(const ConstantValue&)>* m_filter_fn;
   CallSiteSummaryStats* m_stats;
+  const SharedCallerInvokeArguments* m_shared_invoke_arguments;
 
   struct CalleeInfo {
     std::unordered_map<const CallSiteSummary*, size_t> indices;
@@ -109,7 +166,10 @@ class CallSiteSummarizer {
   InvokeCallSiteSummariesAndDeadBlocks get_invoke_call_site_summaries(
       DexMethod* caller,
       const std::unordered_map<DexMethod*, size_t>& callees,
-      const ConstantEnvironment& initial_env);
+      const CallSiteArguments& arguments);
+
+  std::unique_ptr<CallerInvokeArguments> compute_invoke_arguments(
+      DexMethod* caller, const CallSiteArguments& arguments);
 
  public:
   CallSiteSummarizer(
@@ -119,7 +179,8 @@ class CallSiteSummarizer {
       GetCalleeFunction get_callee_fn,
       HasCalleeOtherCallSitesPredicate has_callee_other_call_sites_fn,
       std::function<bool(const ConstantValue&)>* filter_fn,
-      CallSiteSummaryStats* stats);
+      CallSiteSummaryStats* stats,
+      const SharedCallerInvokeArguments* shared_invoke_arguments = nullptr);
 
   void summarize();
 
@@ -134,7 +134,8 @@ MultiMethodInliner::MultiMethodInliner(
     bool local_only,
     bool consider_hot_cold,
     InlinerCostConfig inliner_cost_config,
-    const std::unordered_set<const DexMethod*>* unfinalized_init_methods)
+    const std::unordered_set<const DexMethod*>* unfinalized_init_methods,
+    const inliner::SharedCallerInvokeArguments* shared_invoke_arguments)
     : m_concurrent_resolver(std::move(concurrent_resolve_fn)),
       m_scheduler(
           [this](DexMethod* method) {
@@ -173,7 +174,8 @@ MultiMethodInliner::MultiMethodInliner(
       m_local_only(local_only),
       m_consider_hot_cold(consider_hot_cold),
       m_inliner_cost_config(inliner_cost_config),
-      m_unfinalized_init_methods(unfinalized_init_methods) {
+      m_unfinalized_init_methods(unfinalized_init_methods),
+      m_shared_invoke_arguments(shared_invoke_arguments) {
   Timer t("MultiMethodInliner construction");
   for (const auto& callee_callers : true_virtual_callers) {
     auto callee = callee_callers.first;
@@ -355,7 +357,8 @@ void MultiMethodInliner::inline_methods() {
                  m_true_virtual_callees_with_other_call_sites.count(callee) ||
                  m_speed_excluded_callees.count(callee);
         },
-        /* filter_fn */ nullptr, &info.call_site_summary_stats);
+        /* filter_fn */ nullptr, &info.call_site_summary_stats,
+        m_shared_invoke_arguments);
     m_call_site_summarizer->summarize();
   }
 
@@ -566,18 +569,14 @@ std::string create_inlining_trace_msg(const DexMethod* caller,
 
     // Expensive...
     if (code->cfg_built()) {
-      loop_impl::LoopInfo info(code->cfg());
-      oss << "!" << info.num_loops();
-      size_t max_depth{0};
-      for (auto& loop : info) {
-        max_depth = std::max(max_depth, (size_t)loop.get_loop_depth());
-      }
-      oss << "!" << max_depth;
+      auto info = loop_impl::get_cached_loop_info(code->cfg());
+      oss << "!" << info->num_loops();
+      oss << "!" << info->max_loop_depth();
       if (insn != nullptr) {
         auto it = code->cfg().find_insn(insn);
-        loop_impl::Loop* loop{nullptr};
+        const loop_impl::Loop* loop{nullptr};
         if (!it.is_end()) {
-          loop = info.get_loop_for(it.block());
+          loop = info->get_loop_for(it.block());
         }
         if (loop != nullptr) {
           oss << "!" << loop->get_loop_depth();
@@ -712,9 +711,71 @@ size_t MultiMethodInliner::inline_inlinables(
   std::unordered_set<DexMethod*> visibility_changes_for;
   size_t init_classes = 0;
   size_t constructor_fences = 0;
+
+  // Callsites that were selected for inlining are collected and inlined at
+  // once, which avoids searching the caller for each of them. The batch is
+  // flushed before anything else needs to look at or change the caller's cfg.
+  std::vector<inliner::CallsiteToInline> pending;
+  std::vector<const Inlinable*> pending_inlinables;
+  auto flush_pending = [&]() {
+    if (pending.empty()) {
+      return;
+    }
+    auto timer2 = m_inline_with_cfg_timer.scope();
+    auto inlined = inliner::inline_with_cfgs(caller_method, pending);
+    for (size_t i = 0; i < pending.size(); ++i) {
+      const auto& inlinable = *pending_inlinables[i];
+      if (!inlined[i]) {
+        calls_not_inlined++;
+        estimated_caller_size -= inlinable.insn_size;
+        continue;
+      }
+      auto callee_method = inlinable.callee;
+      TRACE(INL, 2, "caller: %s\tcallee: %s",
+            caller->cfg_built() ? SHOW(caller->cfg()) : SHOW(caller),
+            SHOW(callee_method->get_code()));
+      const auto* reduced_cfg = pending[i].reduced_cfg;
+      if (reduced_cfg) {
+        visibility_changes.insert(get_visibility_changes(
+            *reduced_cfg, caller_method->get_class(), callee_method));
+      } else {
+        visibility_changes_for.insert(callee_method);
+      }
+      if (pending[i].needs_init_class) {
+        init_classes++;
+      }
+      if (pending[i].needs_constructor_fence) {
+        const DexMethod* m = callee_method;
+        m_inlined_with_fence.insert(m);
+        while (auto* ptr = m_unfinalized_overloads.get(m)) {
+          m = *ptr;
+          m_inlined_with_fence.insert(m);
+        }
+        constructor_fences++;
+      } else if (get_needs_constructor_fence(/* caller */ nullptr,
+                                             callee_method)) {
+        // Inlining callee in any other context would need a constructor
+        // fence; that means that final fields are involved, and we just
+        // didn't need a constructor fence here because we inlined into an
+        // init overload. Record this.
+        always_assert(method::is_init(caller_method));
+        always_assert(method::is_init(callee_method));
+        always_assert(caller_method->get_class() ==
+                      callee_method->get_class());
+        m_unfinalized_overloads.emplace(caller_method, callee_method);
+      }
+
+      inlined_callees.push_back(callee_method);
+      if (type::is_kotlin_lambda(type_class(callee_method->get_class()))) {
+        info.kotlin_lambda_inlined++;
+      }
+    }
+    pending.clear();
+    pending_inlinables.clear();
+  };
+
   for (const auto& inlinable : ordered_inlinables) {
     auto callee_method = inlinable.callee;
-    auto callee = callee_method->get_code();
     auto callsite_insn = inlinable.insn;
 
     if (remaining_callsites && !remaining_callsites->count(callsite_insn)) {
@@ -732,6 +793,7 @@ size_t MultiMethodInliner::inline_inlinables(
       // we are not actually inlining, but just cutting off control-flow
       // afterwards, inserting an (unreachable) "throw null" instruction
       // sequence.
+      flush_pending();
       auto& caller_cfg = caller->cfg();
       auto callsite_it = caller_cfg.find_insn(callsite_insn);
       if (!callsite_it.is_end()) {
@@ -772,6 +834,7 @@ size_t MultiMethodInliner::inline_inlinables(
       // This is expensive, but with shrinking/non-cfg inlining prep there's no
       // better way. Needs an explicit check to see whether the instruction has
       // already been shrunk away.
+      flush_pending();
       auto callsite_it = caller->cfg().find_insn(callsite_insn);
       if (!callsite_it.is_end()) {
         auto* block = callsite_it.block();
@@ -787,6 +850,9 @@ size_t MultiMethodInliner::inline_inlinables(
     auto not_inlinable = !is_inlinable(caller_method, callee_method,
                                        callsite_insn, estimated_caller_size,
                                        inlinable.insn_size, &caller_too_large_);
+    if (not_inlinable && caller_too_large_) {
+      flush_pending();
+    }
     if (not_inlinable && caller_too_large_ &&
         inlined_callees.size() > last_intermediate_inlined_callees) {
       intermediate_remove_unreachable_blocks++;
@@ -837,62 +903,29 @@ size_t MultiMethodInliner::inline_inlinables(
           create_inlining_trace_msg(caller_method, callee_method, callsite_insn)
               .c_str());
 
-    if (m_config.unique_inlined_registers) {
-      cfg_next_caller_reg = caller->cfg().get_registers_size();
-    }
-    auto timer2 = m_inline_with_cfg_timer.scope();
     auto needs_init_class = get_needs_init_class(callee_method);
     const auto& reduced_code = inlinable.reduced_code;
     const auto* reduced_cfg = reduced_code ? &reduced_code->cfg() : nullptr;
     auto needs_constructor_fence =
         get_needs_constructor_fence(caller_method, callee_method);
-    bool success = inliner::inline_with_cfg(
-        caller_method, callee_method, callsite_insn,
-        inlinable.needs_receiver_cast, needs_init_class, *cfg_next_caller_reg,
-        reduced_cfg, m_config.rewrite_invoke_super ? callee_method : nullptr,
-        needs_constructor_fence);
-    if (!success) {
-      calls_not_inlined++;
-      continue;
-    }
-    TRACE(INL, 2, "caller: %s\tcallee: %s",
-          caller->cfg_built() ? SHOW(caller->cfg()) : SHOW(caller),
-          SHOW(callee));
+    inliner::CallsiteToInline callsite_to_inline{
+        callee_method,
+        callsite_insn,
+        inlinable.needs_receiver_cast,
+        needs_init_class,
+        // With unique registers, each callee gets the registers after the
+        // caller's registers at the time it is inlined.
+        m_config.unique_inlined_registers
+            ? boost::none
+            : boost::optional<size_t>(*cfg_next_caller_reg),
+        reduced_cfg,
+        m_config.rewrite_invoke_super ? callee_method : nullptr,
+        needs_constructor_fence};
+    pending.push_back(std::move(callsite_to_inline));
+    pending_inlinables.push_back(&inlinable);
     estimated_caller_size += inlinable.insn_size;
-    if (reduced_cfg) {
-      visibility_changes.insert(get_visibility_changes(
-          *reduced_cfg, caller_method->get_class(), callee_method));
-    } else {
-      visibility_changes_for.insert(callee_method);
-    }
-    if (needs_init_class) {
-      init_classes++;
-    }
-    if (needs_constructor_fence) {
-      const DexMethod* m = callee_method;
-      m_inlined_with_fence.insert(m);
-      while (auto* ptr = m_unfinalized_overloads.get(m)) {
-        m = *ptr;
-        m_inlined_with_fence.insert(m);
-      }
-      constructor_fences++;
-    } else if (get_needs_constructor_fence(/* caller */ nullptr,
-                                           callee_method)) {
-      // Inlining callee in any other context would need a constructor fence;
-      // that means that final fields are involved, and we just didn't need a
-      // constructor fence here because we inlined into an init overload. Record
-      // this.
-      always_assert(method::is_init(caller_method));
-      always_assert(method::is_init(callee_method));
-      always_assert(caller_method->get_class() == callee_method->get_class());
-      m_unfinalized_overloads.emplace(caller_method, callee_method);
-    }
-
-    inlined_callees.push_back(callee_method);
-    if (type::is_kotlin_lambda(type_class(callee_method->get_class()))) {
-      info.kotlin_lambda_inlined++;
-    }
   }
+  flush_pending();
 
   if (!inlined_callees.empty()) {
     for (auto callee_method : visibility_changes_for) {
@@ -1590,7 +1623,17 @@ const InlinedCost* MultiMethodInliner::get_call_site_inlined_cost(
     return nullptr;
   }
 
+  if (!should_simulate_call_site_summary(callee, call_site_summary)) {
+    return nullptr;
+  }
+
   CalleeCallSiteSummary key{callee, call_site_summary};
+  const auto* cached = m_call_site_inlined_costs.get(key);
+  if (cached) {
+    info.call_site_inlined_cost_cache_hits++;
+    return cached;
+  }
+  info.call_site_inlined_cost_cache_misses++;
   return m_call_site_inlined_costs
       .get_or_create_and_assert_equal(
           key,
@@ -1615,6 +1658,44 @@ const InlinedCost* MultiMethodInliner::get_call_site_inlined_cost(
       .first;
 }
 
+bool MultiMethodInliner::should_simulate_call_site_summary(
+    const DexMethod* callee, const CallSiteSummary* call_site_summary) {
+  auto max_summaries = m_config.max_call_site_summaries_per_callee;
+  if (max_summaries == 0 || !m_call_site_summarizer) {
+    return true;
+  }
+  const auto* occurrences =
+      m_call_site_summarizer->get_callee_call_site_summary_occurrences(callee);
+  if (occurrences == nullptr || occurrences->size() <= max_summaries) {
+    return true;
+  }
+  const auto* simulated = m_simulated_call_site_summaries.get(callee);
+  if (simulated == nullptr) {
+    // Pick the most frequent summaries, breaking ties by key so that the
+    // choice is deterministic.
+    std::vector<CallSiteSummaryOccurrences> ordered(
+        occurrences->begin(), occurrences->end());
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+      if (a.second != b.second) {
+        return a.second > b.second;
+      }
+      return a.first->get_key() < b.first->get_key();
+    });
+    std::unordered_set<const CallSiteSummary*> most_frequent;
+    for (size_t i = 0; i < max_summaries; i++) {
+      most_frequent.insert(ordered[i].first);
+    }
+    auto [ptr, emplaced] = m_simulated_call_site_summaries.emplace(
+        callee, std::move(most_frequent));
+    if (emplaced) {
+      info.call_site_summaries_not_simulated +=
+          occurrences->size() - max_summaries;
+    }
+    simulated = ptr;
+  }
+  return simulated->count(call_site_summary);
+}
+
 const InlinedCost* MultiMethodInliner::get_average_inlined_cost(
     const DexMethod* callee) {
   const auto* cached = m_average_inlined_costs.get(callee);
@@ -1657,7 +1738,10 @@ const InlinedCost* MultiMethodInliner::get_average_inlined_cost(
       const auto count = p.second;
       auto call_site_inlined_cost =
           get_call_site_inlined_cost(call_site_summary, callee);
-      always_assert(call_site_inlined_cost);
+      if (!call_site_inlined_cost) {
+        // Not simulated, see should_simulate_call_site_summary.
+        call_site_inlined_cost = fully_inlined_cost;
+      }
       if (callee_has_result && !call_site_summary->result_used) {
         callees_unused_results += count;
       }
@@ -2396,6 +2480,42 @@ void MultiMethodInliner::delayed_invoke_direct_to_static() {
 
 namespace inliner {
 
+namespace {
+
+bool is_trivial_callee(const cfg::ControlFlowGraph& callee_cfg) {
+  for (auto& mie : InstructionIterable(callee_cfg)) {
+    if (mie.insn->opcode() != OPCODE_RETURN_VOID &&
+        !opcode::is_load_param(mie.insn->opcode())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const cfg::ControlFlowGraph& get_callee_cfg(
+    DexMethod* callee_method, const cfg::ControlFlowGraph* reduced_cfg) {
+  auto callee_code = callee_method->get_code();
+  always_assert(callee_code->editable_cfg_built());
+  return reduced_cfg ? *reduced_cfg : callee_code->cfg();
+}
+
+void ensure_debug_item(DexMethod* caller_method) {
+  auto caller_code = caller_method->get_code();
+  if (caller_code->get_debug_item() != nullptr) {
+    return;
+  }
+  auto& caller_cfg = caller_code->cfg();
+  // Create an empty item so that debug info of inlinee does not get lost.
+  caller_code->set_debug_item(std::make_unique<DexDebugItem>());
+  // Create a fake position.
+  caller_cfg.insert_before(
+      caller_cfg.entry_block(),
+      caller_cfg.entry_block()->get_first_non_param_loading_insn(),
+      DexPosition::make_synthetic_entry_position(caller_method));
+}
+
+} // namespace
+
 // return true on successful inlining, false otherwise
 bool inline_with_cfg(DexMethod* caller_method,
                      DexMethod* callee_method,
@@ -2421,34 +2541,15 @@ bool inline_with_cfg(DexMethod* caller_method,
     return false;
   }
 
-  auto callee_code = callee_method->get_code();
-  always_assert(callee_code->editable_cfg_built());
-  auto& callee_cfg = reduced_cfg ? *reduced_cfg : callee_code->cfg();
-
-  bool is_trivial = true;
-  for (auto& mie : InstructionIterable(callee_cfg)) {
-    if (mie.insn->opcode() != OPCODE_RETURN_VOID &&
-        !opcode::is_load_param(mie.insn->opcode())) {
-      is_trivial = false;
-      break;
-    }
-  }
-  if (is_trivial) {
+  auto& callee_cfg = get_callee_cfg(callee_method, reduced_cfg);
+  if (is_trivial_callee(callee_cfg)) {
     // no need to go through expensive general inlining, which would also add
     // unnecessary or even dubious positions
     caller_cfg.remove_insn(callsite_it);
     return true;
   }
 
-  if (caller_code->get_debug_item() == nullptr) {
-    // Create an empty item so that debug info of inlinee does not get lost.
-    caller_code->set_debug_item(std::make_unique<DexDebugItem>());
-    // Create a fake position.
-    caller_cfg.insert_before(
-        caller_cfg.entry_block(),
-        caller_cfg.entry_block()->get_first_non_param_loading_insn(),
-        DexPosition::make_synthetic_entry_position(caller_method));
-  }
+  ensure_debug_item(caller_method);
 
   // Logging before the call to inline_cfg to get the most relevant line
   // number near callsite before callsite gets replaced. Should be ok as
@@ -2463,4 +2564,70 @@ bool inline_with_cfg(DexMethod* caller_method,
   return true;
 }
 
+std::vector<bool> inline_with_cfgs(
+    DexMethod* caller_method, const std::vector<CallsiteToInline>& callsites) {
+  auto caller_code = caller_method->get_code();
+  always_assert(caller_code->editable_cfg_built());
+  auto& caller_cfg = caller_code->cfg();
+
+  std::unordered_map<const IRInstruction*, size_t> callsite_indices;
+  for (size_t i = 0; i < callsites.size(); ++i) {
+    callsite_indices.emplace(callsites[i].callsite, i);
+  }
+  // Callsites may be missing when their pointers are stale, see
+  // inline_with_cfg.
+  std::vector<bool> found(callsites.size(), false);
+  std::vector<cfg::InstructionIterator> trivial_callsites;
+  auto iterable = cfg::InstructionIterable(caller_cfg);
+  for (auto it = iterable.begin(); it != iterable.end(); ++it) {
+    auto index_it = callsite_indices.find(it->insn);
+    if (index_it == callsite_indices.end()) {
+      continue;
+    }
+    auto i = index_it->second;
+    found[i] = true;
+    const auto& c = callsites[i];
+    if (is_trivial_callee(get_callee_cfg(c.callee_method, c.reduced_cfg))) {
+      trivial_callsites.push_back(it);
+    }
+  }
+  // Trivial callees are just removed, as in inline_with_cfg.
+  std::vector<bool> inlined(callsites.size(), false);
+  for (const auto& it : trivial_callsites) {
+    inlined[callsite_indices.at(it->insn)] = true;
+    caller_cfg.remove_insn(it);
+  }
+
+  std::vector<cfg::CFGInliner::InlineSite> sites;
+  std::vector<size_t> site_indices;
+  for (size_t i = 0; i < callsites.size(); ++i) {
+    if (!found[i] || inlined[i]) {
+      continue;
+    }
+    const auto& c = callsites[i];
+    sites.push_back(cfg::CFGInliner::InlineSite{
+        c.callsite, &get_callee_cfg(c.callee_method, c.reduced_cfg),
+        c.needs_receiver_cast, c.needs_init_class, c.next_caller_reg,
+        c.rewrite_invoke_super_callee, c.needs_constructor_fence});
+    site_indices.push_back(i);
+  }
+  if (sites.empty()) {
+    return inlined;
+  }
+
+  ensure_debug_item(caller_method);
+  // Logging before inlining, while the callsites are still in place, to get
+  // the most relevant line numbers.
+  for (const auto& site : sites) {
+    log_opt(INLINED, caller_method, site.callsite);
+  }
+
+  auto sites_inlined = cfg::CFGInliner::inline_cfgs(&caller_cfg, sites);
+  for (size_t i = 0; i < sites.size(); ++i) {
+    always_assert(sites_inlined[i]);
+    inlined[site_indices[i]] = true;
+  }
+  return inlined;
+}
+
 } // namespace inliner
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
 #include <functional>
 #include <vector>
 
@@ -36,6 +37,27 @@ bool inline_with_cfg(DexMethod* caller_method,
                      DexMethod* rewrite_invoke_super_callee = nullptr,
                      bool needs_constructor_fence = false);
 
+struct CallsiteToInline {
+  DexMethod* callee_method;
+  IRInstruction* callsite;
+  DexType* needs_receiver_cast{nullptr};
+  DexType* needs_init_class{nullptr};
+  // If none, the registers following the caller's registers at the time the
+  // callsite gets inlined are used.
+  boost::optional<size_t> next_caller_reg;
+  const cfg::ControlFlowGraph* reduced_cfg{nullptr};
+  DexMethod* rewrite_invoke_super_callee{nullptr};
+  bool needs_constructor_fence{false};
+};
+
+/*
+ * Like inline_with_cfg for each callsite in order, but locates all callsites
+ * in a single pass over the caller. Returns for each callsite whether it was
+ * inlined.
+ */
+std::vector<bool> inline_with_cfgs(
+    DexMethod* caller_method, const std::vector<CallsiteToInline>& callsites);
+
 } // namespace inliner
 
 /**
@@ -255,6 +277,8 @@ class MultiMethodInliner {
       bool consider_hot_cold = false,
       InlinerCostConfig inliner_cost_config = DEFAULT_COST_CONFIG,
       const std::unordered_set<const DexMethod*>* unfinalized_init_methods =
+          nullptr,
+      const inliner::SharedCallerInvokeArguments* shared_invoke_arguments =
           nullptr);
 
   /*
@@ -549,6 +573,15 @@ class MultiMethodInliner {
   const InlinedCost* get_call_site_inlined_cost(
       const CallSiteSummary* call_site_summary, const DexMethod* callee);
 
+  /**
+   * Whether to compute a call-site specific cost for the given call-site
+   * summary, which is the case unless the callee has more distinct call-site
+   * summaries than configured by max_call_site_summaries_per_callee, and the
+   * summary is not among the most frequent ones.
+   */
+  bool should_simulate_call_site_summary(
+      const DexMethod* callee, const CallSiteSummary* call_site_summary);
+
   /**
    * Change visibilities of methods, assuming that`m_visibility_changes` is
    * non-null.
@@ -654,6 +687,13 @@ class MultiMethodInliner {
   mutable InsertOnlyConcurrentMap<const IRInstruction*, const InlinedCost*>
       m_invoke_call_site_inlined_costs;
 
+  // For callees with more distinct call-site summaries than allowed, the
+  // most frequent call-site summaries, for which call-site specific costs are
+  // still computed.
+  mutable InsertOnlyConcurrentMap<const DexMethod*,
+                                  std::unordered_set<const CallSiteSummary*>>
+      m_simulated_call_site_summaries;
+
   // Priority thread pool to handle parallel processing of methods, either
   // shrinking initially / after inlining into them, or even to inline in
   // parallel. By default, parallelism is disabled num_threads = 0).
@@ -739,6 +779,9 @@ class MultiMethodInliner {
     std::atomic<size_t> constant_invoke_callees_analyzed{0};
     std::atomic<size_t> constant_invoke_callees_unused_results{0};
     std::atomic<size_t> constant_invoke_callees_no_return{0};
+    std::atomic<size_t> call_site_inlined_cost_cache_hits{0};
+    std::atomic<size_t> call_site_inlined_cost_cache_misses{0};
+    std::atomic<size_t> call_site_summaries_not_simulated{0};
     inliner::CallSiteSummaryStats call_site_summary_stats;
   };
   InliningInfo info;
@@ -777,6 +820,8 @@ class MultiMethodInliner {
   InlinerCostConfig m_inliner_cost_config;
 
   const std::unordered_set<const DexMethod*>* m_unfinalized_init_methods;
+
+  const inliner::SharedCallerInvokeArguments* m_shared_invoke_arguments;
   InsertOnlyConcurrentMap<const DexMethod*, const DexMethod*>
       m_unfinalized_overloads;
 
@@ -917,6 +917,19 @@ void run_inliner(
   inliner_config.shrinker.analyze_constructors =
       inliner_config.shrinker.run_const_prop;
 
+  // Without constructor analysis, the constant arguments of invocations only
+  // depend on the code of their callers, so we can reuse them across runs.
+  std::shared_ptr<const inliner::SharedCallerInvokeArguments>
+      shared_invoke_arguments;
+  if (inliner_config.use_call_site_summaries &&
+      !inliner_config.shrinker.analyze_constructors) {
+    shared_invoke_arguments =
+        mgr.get_self_validating_analysis<inliner::SharedCallerInvokeArguments>(
+            []() {
+              return std::make_unique<inliner::SharedCallerInvokeArguments>();
+            });
+  }
+
   ConcurrentMethodResolver concurrent_method_resolver;
   // inline candidates
   MultiMethodInliner inliner(
@@ -926,7 +939,8 @@ void run_inliner(
       analyze_and_prune_inits, conf.get_pure_methods(), min_sdk_api,
       cross_dex_penalty,
       /* configured_finalish_field_names */ {}, local_only, consider_hot_cold,
-      inliner_cost_config, &unfinalized_init_methods);
+      inliner_cost_config, &unfinalized_init_methods,
+      shared_invoke_arguments.get());
   inliner.inline_methods();
 
   // refinalize where possible
@@ -1063,12 +1077,22 @@ void run_inliner(
                   inliner.get_info()
                       .call_site_summary_stats
                       .constant_invoke_callers_critical_path_length);
+  mgr.incr_metric(
+      "constant_invoke_callers_reused",
+      inliner.get_info()
+          .call_site_summary_stats.constant_invoke_callers_reused);
   mgr.incr_metric("constant_invoke_callees_analyzed",
                   inliner.get_info().constant_invoke_callees_analyzed);
   mgr.incr_metric("constant_invoke_callees_no_return",
                   inliner.get_info().constant_invoke_callees_no_return);
   mgr.incr_metric("constant_invoke_callees_unused_results",
                   inliner.get_info().constant_invoke_callees_unused_results);
+  mgr.incr_metric("call_site_inlined_cost_cache_hits",
+                  inliner.get_info().call_site_inlined_cost_cache_hits);
+  mgr.incr_metric("call_site_inlined_cost_cache_misses",
+                  inliner.get_info().call_site_inlined_cost_cache_misses);
+  mgr.incr_metric("call_site_summaries_not_simulated",
+                  inliner.get_info().call_site_summaries_not_simulated);
   mgr.incr_metric("critical_path_length",
                   inliner.get_info().critical_path_length);
   mgr.incr_metric("methods_shrunk", shrinker.get_methods_shrunk());
@@ -186,7 +186,8 @@ void ObjectSensitiveDce::dce() {
       m_scope, call_graph, m_escape_summaries, &excluded_classes);
 
   side_effects::analyze_scope(*m_init_classes_with_side_effects, m_scope,
-                              call_graph, ptrs_fp_iter_map, m_effect_summaries);
+                              call_graph, ptrs_fp_iter_map, m_effect_summaries,
+                              m_effect_summary_cache);
 
   std::atomic<size_t> removed{0};
   std::atomic<size_t> init_class_instructions_added{0};
@@ -61,14 +61,16 @@ class ObjectSensitiveDce {
       const method_override_graph::Graph& method_override_graph,
       const uint32_t big_override_threshold,
       local_pointers::SummaryMap* escape_summaries,
-      side_effects::SummaryMap* effect_summaries)
+      side_effects::SummaryMap* effect_summaries,
+      PersistentSummaryCache* effect_summary_cache = nullptr)
       : m_scope(scope),
         m_init_classes_with_side_effects(init_classes_with_side_effects),
         m_pure_methods(pure_methods),
         m_method_override_graph(method_override_graph),
         m_big_override_threshold(big_override_threshold),
         m_escape_summaries(escape_summaries),
-        m_effect_summaries(effect_summaries) {}
+        m_effect_summaries(effect_summaries),
+        m_effect_summary_cache(effect_summary_cache) {}
 
   const Stats& get_stats() const { return m_stats; }
 
@@ -84,5 +86,6 @@ class ObjectSensitiveDce {
   // The following are mutated internally.
   local_pointers::SummaryMap* m_escape_summaries;
   side_effects::SummaryMap* m_effect_summaries;
+  PersistentSummaryCache* m_effect_summary_cache;
   Stats m_stats;
 };
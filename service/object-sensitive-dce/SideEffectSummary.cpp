@@ -7,8 +7,13 @@
 
 #include "SideEffectSummary.h"
 
+#include <optional>
+#include <sstream>
+
 #include "CallGraph.h"
 #include "ConcurrentContainers.h"
+#include "DexHasher.h"
+#include "PersistentSummaryCache.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -251,6 +256,51 @@ InvokeToSummaryMap build_summary_map(const SummaryMap& summary_map,
   return invoke_to_summary_map;
 }
 
+/*
+ * Derive a key from everything the summary of :method depends on: its code,
+ * and for each instruction, the class initialization it may trigger, and for
+ * invokes, the effect and escape summaries of the callees.
+ */
+std::string summary_cache_key(const init_classes::InitClassesWithSideEffects&
+                                  init_classes_with_side_effects,
+                              const DexMethod* method,
+                              const ptrs::FixpointIterator& ptrs_fp_iter,
+                              const InvokeToSummaryMap& invoke_to_summary_map) {
+  std::ostringstream content;
+  // Positions don't affect summaries, so we leave them out to get more hits.
+  auto hash = hashing::DexMethodHasher(method).run();
+  content << hashing::hash_to_string(hash.signature_hash) << " "
+          << hashing::hash_to_string(hash.code_hash) << " "
+          << hashing::hash_to_string(hash.registers_hash) << " "
+          << method->rstate.no_optimizations() << " "
+          << ptrs_fp_iter.escape_check_cast() << "\n";
+  const auto& ptrs_invoke_to_summary_map =
+      ptrs_fp_iter.get_invoke_to_summary_map();
+  for (auto& mie : InstructionIterable(method->get_code()->cfg())) {
+    auto* insn = mie.insn;
+    auto* init_class_type = init_classes_with_side_effects.refine(
+        get_init_class_type_demand(insn));
+    if (init_class_type != nullptr) {
+      content << "init " << show(init_class_type);
+    }
+    if (opcode::is_an_invoke(insn->opcode())) {
+      auto it = invoke_to_summary_map.find(insn);
+      if (it != invoke_to_summary_map.end()) {
+        content << "effects " << to_s_expr(it->second).str();
+      }
+      auto ptrs_it = ptrs_invoke_to_summary_map.find(insn);
+      if (ptrs_it != ptrs_invoke_to_summary_map.end()) {
+        content << "escapes " << to_s_expr(ptrs_it->second).str();
+      }
+      if (ptrs_fp_iter.is_excluded_init(insn)) {
+        content << "excluded";
+      }
+    }
+    content << "\n";
+  }
+  return PersistentSummaryCache::make_key(content.str());
+}
+
 /*
  * Analyze :method.
  */
@@ -259,17 +309,33 @@ Summary analyze_method(const init_classes::InitClassesWithSideEffects&
                        const DexMethod* method,
                        const call_graph::Graph& call_graph,
                        const ptrs::FixpointIteratorMap& ptrs_fp_iter_map,
-                       const SummaryMap& summary_map) {
+                       const SummaryMap& summary_map,
+                       PersistentSummaryCache* cache) {
   auto invoke_to_summary_map =
       build_summary_map(summary_map, call_graph, method);
 
   const auto& ptrs_fp_iter = *ptrs_fp_iter_map.at_unsafe(method);
-  auto summary =
-      SummaryBuilder(init_classes_with_side_effects, invoke_to_summary_map,
-                     ptrs_fp_iter, method->get_code())
-          .build();
-  if (method->rstate.no_optimizations()) {
-    summary.effects |= EFF_NO_OPTIMIZE;
+  std::string cache_key;
+  std::optional<Summary> cached_summary;
+  if (cache != nullptr) {
+    cache_key = summary_cache_key(init_classes_with_side_effects, method,
+                                  ptrs_fp_iter, invoke_to_summary_map);
+    cached_summary = cache->get<Summary>(cache_key);
+  }
+  Summary summary;
+  if (cached_summary) {
+    summary = std::move(*cached_summary);
+  } else {
+    summary =
+        SummaryBuilder(init_classes_with_side_effects, invoke_to_summary_map,
+                       ptrs_fp_iter, method->get_code())
+            .build();
+    if (method->rstate.no_optimizations()) {
+      summary.effects |= EFF_NO_OPTIMIZE;
+    }
+    if (cache != nullptr) {
+      cache->put(cache_key, summary);
+    }
   }
 
   if (traceEnabled(OSDCE, 3)) {
@@ -303,7 +369,8 @@ void analyze_scope(const init_classes::InitClassesWithSideEffects&
                    const Scope& scope,
                    const call_graph::Graph& call_graph,
                    const ptrs::FixpointIteratorMap& ptrs_fp_iter_map,
-                   SummaryMap* effect_summaries) {
+                   SummaryMap* effect_summaries,
+                   PersistentSummaryCache* cache) {
   // This method is special: the bytecode verifier requires that this method
   // be called before a newly-allocated object gets used in any way. We can
   // model this by treating the method as modifying its `this` parameter --
@@ -323,7 +390,7 @@ void analyze_scope(const init_classes::InitClassesWithSideEffects&
         [&](const DexMethod* method) {
           auto new_summary =
               analyze_method(init_classes_with_side_effects, method, call_graph,
-                             ptrs_fp_iter_map, *effect_summaries);
+                             ptrs_fp_iter_map, *effect_summaries, cache);
           new_summary.normalize();
           auto it = effect_summaries->find(method);
           if (it != effect_summaries->end() && it->second == new_summary) {
@@ -344,12 +411,20 @@ void analyze_scope(const init_classes::InitClassesWithSideEffects&
 s_expr to_s_expr(const Summary& summary) {
   std::vector<s_expr> s_exprs;
   s_exprs.emplace_back(std::to_string(summary.effects));
+  std::vector<param_idx_t> modified_params(summary.modified_params.begin(),
+                                           summary.modified_params.end());
+  // Sort in order that the output is deterministic.
+  std::sort(modified_params.begin(), modified_params.end());
   std::vector<s_expr> mod_param_s_exprs;
-  mod_param_s_exprs.reserve(summary.modified_params.size());
-  for (auto idx : summary.modified_params) {
+  mod_param_s_exprs.reserve(modified_params.size());
+  for (auto idx : modified_params) {
     mod_param_s_exprs.emplace_back(idx);
   }
   s_exprs.emplace_back(mod_param_s_exprs);
+  // Only emitted when set, so that existing summary files remain valid.
+  if (summary.may_read_external) {
+    s_exprs.emplace_back("may_read_external");
+  }
   return s_expr(s_exprs);
 }
 
@@ -373,13 +448,18 @@ std::ostream& operator<<(std::ostream& o, const Summary& summary) {
 
 Summary Summary::from_s_expr(const s_expr& expr) {
   Summary summary;
-  always_assert(expr.size() == 2);
+  always_assert(expr.size() == 2 || expr.size() == 3);
   always_assert(expr[0].is_string());
   summary.effects = std::stoi(expr[0].str());
   always_assert(expr[1].is_list());
   for (size_t i = 0; i < expr[1].size(); ++i) {
     summary.modified_params.emplace(expr[1][i].get_int32());
   }
+  if (expr.size() == 3) {
+    always_assert(expr[2].is_string() &&
+                  expr[2].get_string() == "may_read_external");
+    summary.may_read_external = true;
+  }
   return summary;
 }
 
@@ -37,6 +37,8 @@
  *     all non-escaping and unused, and if their return values are unused.
  */
 
+class PersistentSummaryCache;
+
 using param_idx_t = uint16_t;
 
 namespace side_effects {
@@ -150,14 +152,22 @@ Summary analyze_code(const init_classes::InitClassesWithSideEffects&
                      const local_pointers::FixpointIterator& ptrs_fp_iter,
                      const IRCode* code);
 
+// To be bumped whenever a change to the analysis may affect summaries, so
+// that persisted summaries of earlier builds are no longer used.
+constexpr const char* SUMMARY_CACHE_VERSION = "1";
+
 /*
  * Get the effect summary for all methods in scope.
+ *
+ * If a cache is given, the summaries of methods whose code and callee
+ * summaries are unchanged since the cache was written are taken from there.
  */
 void analyze_scope(const init_classes::InitClassesWithSideEffects&
                        init_classes_with_side_effects,
                    const Scope& scope,
                    const call_graph::Graph&,
                    const local_pointers::FixpointIteratorMap&,
-                   SummaryMap* effect_summaries);
+                   SummaryMap* effect_summaries,
+                   PersistentSummaryCache* cache = nullptr);
 
 } // namespace side_effects
@@ -9,10 +9,12 @@
 
 #include "ControlFlow.h"
 #include "CppUtil.h"
+#include "GraphColoring.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "IRList.h"
 #include "LiveInterval.h"
+#include "RegisterType.h"
 #include "Show.h"
 #include "Trace.h"
 #include <algorithm>
@@ -36,16 +38,25 @@ static void TRACE_live_intervals(const LiveIntervals& live_intervals) {
   TRACE(FREG, 9, "\n");
 }
 
-LinearScanAllocator::LinearScanAllocator(DexMethod* method)
-    : LinearScanAllocator(method->get_code(), is_static(method), [method]() {
-        return show(method);
-      }) {}
+LinearScanAllocator::LinearScanAllocator(DexMethod* method,
+                                         bool satisfy_encoding_constraints,
+                                         bool no_overwrite_this)
+    : LinearScanAllocator(
+          method->get_code(),
+          is_static(method),
+          [method]() { return show(method); },
+          satisfy_encoding_constraints,
+          no_overwrite_this) {}
 
 LinearScanAllocator::LinearScanAllocator(
     IRCode* code,
     bool is_static,
-    const std::function<std::string()>& method_describer)
-    : m_cfg(code), m_is_static(is_static) {
+    const std::function<std::string()>& method_describer,
+    bool satisfy_encoding_constraints,
+    bool no_overwrite_this)
+    : m_cfg(code),
+      m_is_static(is_static),
+      m_satisfy_encoding_constraints(satisfy_encoding_constraints) {
   TRACE(FREG,
         9,
         "Running FastRegAlloc for method {%s}",
@@ -54,6 +65,11 @@ LinearScanAllocator::LinearScanAllocator(
 
   m_cfg->simplify(); // in particular, remove empty blocks
   m_cfg->calculate_exit_block();
+  if (no_overwrite_this && !is_static) {
+    // Once split off, `this` is a live range of its own, and the register we
+    // allocate to m_this_vreg is never handed out to anything else.
+    regalloc::graph_coloring::dedicate_this_register(*m_cfg);
+  }
 
   live_range::renumber_registers(code, /* width_aware */ true);
   m_live_intervals = init_live_intervals(*m_cfg, &m_live_interval_points);
@@ -65,23 +81,42 @@ void LinearScanAllocator::allocate() {
   if (m_live_intervals.empty()) {
     return;
   }
+  std::unordered_set<vreg_t> param_vregs(m_param_vregs.begin(),
+                                         m_param_vregs.end());
   for (int32_t idx = m_live_intervals.size() - 1; idx >= 0; --idx) {
     auto& live_interval = m_live_intervals[idx];
     expire_old_intervals(live_interval.end_point);
     // TODO: (in the future) add spill here given dex constraints
     vreg_t cur_vreg = live_interval.vreg;
+    if (param_vregs.count(cur_vreg)) {
+      // Parameters get dedicated registers at the end of the frame below.
+      continue;
+    }
     reg_t alloc_reg = allocate_register(cur_vreg, live_interval.end_point);
     always_assert(!live_interval.reg);
     live_interval.reg = alloc_reg;
     m_active_intervals.push({idx, live_interval.start_point});
   }
+  std::unordered_map<vreg_t, reg_t> vreg_regs;
   for (auto& interval : m_live_intervals) {
-    auto& [defs, uses] = m_vreg_defs_uses.at(interval.vreg);
-    for (auto def : defs) {
-      def->set_dest(interval.reg.value());
+    if (interval.reg) {
+      vreg_regs.emplace(interval.vreg, *interval.reg);
     }
-    for (auto use : uses) {
-      use.insn->set_src(use.src_index, interval.reg.value());
+  }
+  if (m_satisfy_encoding_constraints) {
+    for (auto vreg : m_param_vregs) {
+      vreg_regs[vreg] = m_reg_count;
+      m_reg_count += m_wide_vregs.count(vreg) ? 2 : 1;
+    }
+    legalize_operands(&vreg_regs);
+  }
+  for (auto& mie : InstructionIterable(*m_cfg)) {
+    auto insn = mie.insn;
+    if (insn->has_dest()) {
+      insn->set_dest(vreg_regs.at(insn->dest()));
+    }
+    for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+      insn->set_src(i, vreg_regs.at(insn->src(i)));
     }
   }
   m_cfg->set_registers_size(m_reg_count);
@@ -103,6 +138,10 @@ void LinearScanAllocator::init_vreg_occurences() {
         !m_this_vreg) {
       m_this_vreg = dest_reg;
     }
+    if (m_satisfy_encoding_constraints &&
+        opcode::is_a_load_param(insn->opcode())) {
+      m_param_vregs.push_back(dest_reg);
+    }
   }
   for (auto& mie : InstructionIterable(*m_cfg)) {
     auto insn = mie.insn;
@@ -142,6 +181,121 @@ reg_t LinearScanAllocator::allocate_register(reg_t for_vreg,
   return alloc_reg;
 }
 
+void LinearScanAllocator::legalize_operands(
+    std::unordered_map<vreg_t, reg_t>* vreg_regs) {
+  auto range_set = regalloc::init_range_set(*m_cfg);
+  // Placing the scratch registers at the bottom moves all other registers up,
+  // which may push more operands beyond their width, so iterate to a fixpoint.
+  reg_t num_scratch = 0;
+  while (true) {
+    auto needed =
+        route_through_scratch_registers(num_scratch, range_set, vreg_regs,
+                                        /* mutation */ nullptr);
+    if (needed <= num_scratch) {
+      break;
+    }
+    num_scratch = needed;
+  }
+  if (num_scratch == 0) {
+    return;
+  }
+  TRACE(FREG, 5, "Using %u scratch registers", num_scratch);
+  for (auto& [_, reg] : *vreg_regs) {
+    reg += num_scratch;
+  }
+  m_reg_count += num_scratch;
+  cfg::CFGMutation mutation(*m_cfg);
+  route_through_scratch_registers(0, range_set, vreg_regs, &mutation);
+  mutation.flush();
+}
+
+reg_t LinearScanAllocator::route_through_scratch_registers(
+    reg_t shift,
+    const regalloc::RangeSet& range_set,
+    std::unordered_map<vreg_t, reg_t>* vreg_regs,
+    cfg::CFGMutation* mutation) {
+  std::unordered_map<vreg_t, regalloc::RegisterType> vreg_types;
+  auto get_type = [&](vreg_t vreg) {
+    auto it = vreg_types.find(vreg);
+    if (it != vreg_types.end()) {
+      return it->second;
+    }
+    regalloc::RegisterTypeDomain type(regalloc::RegisterType::UNKNOWN);
+    auto& [defs, uses] = m_vreg_defs_uses.at(vreg);
+    for (auto def : defs) {
+      type.meet_with(
+          regalloc::RegisterTypeDomain(regalloc::dest_reg_type(def)));
+    }
+    for (auto use : uses) {
+      type.meet_with(regalloc::RegisterTypeDomain(
+          regalloc::src_reg_type(use.insn, use.src_index)));
+    }
+    return vreg_types.emplace(vreg, type.element()).first->second;
+  };
+  auto get_reg = [&](vreg_t vreg) { return vreg_regs->at(vreg) + shift; };
+
+  reg_t needed = 0;
+  auto ii = cfg::InstructionIterable(*m_cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto insn = it->insn;
+    if (opcode::is_a_load_param(insn->opcode())) {
+      continue;
+    }
+    reg_t next_scratch = 0;
+    auto route_src = [&](src_index_t i) {
+      auto src = insn->src(i);
+      if (mutation != nullptr) {
+        auto temp = m_cfg->allocate_temp();
+        vreg_regs->emplace(temp, next_scratch);
+        mutation->insert_before(
+            it, {regalloc::gen_move(get_type(src), temp, src)});
+        insn->set_src(i, temp);
+      }
+      next_scratch += insn->src_is_wide(i) ? 2 : 1;
+    };
+    if (range_set.contains(insn)) {
+      bool contiguous = true;
+      for (src_index_t i = 1; i < insn->srcs_size() && contiguous; ++i) {
+        contiguous = get_reg(insn->src(i)) ==
+                     get_reg(insn->src(i - 1)) +
+                         (insn->src_is_wide(i - 1) ? 2 : 1);
+      }
+      if (!contiguous) {
+        for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+          route_src(i);
+        }
+      }
+    } else {
+      for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+        if (get_reg(insn->src(i)) >
+            regalloc::interference::max_value_for_src(insn, i,
+                                                      insn->src_is_wide(i))) {
+          route_src(i);
+        }
+      }
+      // The dest is only written after all srcs have been read, so it can
+      // share the scratch registers with them.
+      if (insn->has_dest() &&
+          get_reg(insn->dest()) >
+              regalloc::max_unsigned_value(
+                  regalloc::interference::dest_bit_width(it))) {
+        auto dest = insn->dest();
+        if (mutation != nullptr) {
+          auto temp = m_cfg->allocate_temp();
+          vreg_regs->emplace(temp, 0);
+          mutation->insert_after(
+              it, {regalloc::gen_move(get_type(dest), dest, temp)});
+          insn->set_dest(temp);
+        }
+        next_scratch =
+            std::max<reg_t>(next_scratch, insn->dest_is_wide() ? 2 : 1);
+      }
+    }
+    needed = std::max(needed, next_scratch);
+  }
+  return needed;
+}
+
 void LinearScanAllocator::expire_old_intervals(uint32_t end_point) {
   while (!m_active_intervals.empty() &&
          m_active_intervals.top().start_point > end_point) {
@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include "CFGMutation.h"
 #include "DexClass.h"
 #include "IRCode.h"
+#include "Interference.h"
 #include "LiveRange.h"
 #include "ScopedCFG.h"
 #include <cstdint>
@@ -200,10 +202,24 @@ struct IRInstructionShapeHasher {
  */
 class LinearScanAllocator final {
  public:
-  explicit LinearScanAllocator(DexMethod* method);
+  /*
+   * By default, the allocation does not care about the encoding constraints of
+   * dex instructions, and is meant to be followed by another allocator. With
+   * satisfy_encoding_constraints, parameters get the last registers of the
+   * frame, and operands that exceed the width of their instruction or break up
+   * a range instruction go through scratch registers at the bottom of the
+   * frame, so that the result can be lowered as is. With no_overwrite_this,
+   * the `this` parameter of an instance method keeps a register of its own
+   * that nothing else writes to.
+   */
+  explicit LinearScanAllocator(DexMethod* method,
+                               bool satisfy_encoding_constraints = false,
+                               bool no_overwrite_this = false);
   LinearScanAllocator(IRCode* code,
                       bool is_static,
-                      const std::function<std::string()>& method_describer);
+                      const std::function<std::string()>& method_describer,
+                      bool satisfy_encoding_constraints = false,
+                      bool no_overwrite_this = false);
 
   /*
    * For each live interval in ascending order of first def:
@@ -217,6 +233,7 @@ class LinearScanAllocator final {
   // Ensure that we have an editable CFG for the duration of the optimization
   cfg::ScopedCFG m_cfg;
   bool m_is_static;
+  bool m_satisfy_encoding_constraints;
 
   /*
    * interval -> vreg, reg
@@ -252,6 +269,12 @@ class LinearScanAllocator final {
    */
   std::optional<reg_t> m_this_vreg;
 
+  /*
+   * The vregs defined by the load-param instructions, in order. Only tracked
+   * when satisfying the encoding constraints.
+   */
+  std::vector<vreg_t> m_param_vregs;
+
   /*
    * { pair(interval_idx, last_use_idx) }
    * Current live intervals that has not reached their end point. i.e., live
@@ -285,6 +308,24 @@ class LinearScanAllocator final {
    * end-point. We might hand out a reused but since expired register.
    */
   reg_t allocate_register(reg_t for_vreg, uint32_t end_point);
+
+  /*
+   * Move the operands that cannot be encoded with their allocated register
+   * through scratch registers, which get placed below all other registers.
+   * Adds the registers of the new temporaries to vreg_regs.
+   */
+  void legalize_operands(std::unordered_map<vreg_t, reg_t>* vreg_regs);
+
+  /*
+   * Returns how many scratch registers are needed when all registers of
+   * vreg_regs get offset by the given shift. Also inserts the moves through
+   * them when a mutation is given.
+   */
+  reg_t route_through_scratch_registers(
+      reg_t shift,
+      const regalloc::RangeSet& range_set,
+      std::unordered_map<vreg_t, reg_t>* vreg_regs,
+      cfg::CFGMutation* mutation);
 };
 
 } // namespace fastregalloc
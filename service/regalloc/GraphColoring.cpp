@@ -985,8 +985,7 @@ void Allocator::spill(const interference::Graph& ig,
  *   :true-label
  *   return-object v0
  */
-static void dedicate_this_register(cfg::ControlFlowGraph& cfg, bool is_static) {
-  always_assert(!is_static);
+void dedicate_this_register(cfg::ControlFlowGraph& cfg) {
   auto param_insns = cfg.get_param_instructions();
   auto this_insn = param_insns.begin()->insn;
 
@@ -1040,7 +1039,7 @@ void Allocator::allocate(cfg::ControlFlowGraph& cfg, bool is_static) {
 
   bool no_overwrite_this = m_config.no_overwrite_this && !is_static;
   if (no_overwrite_this) {
-    dedicate_this_register(cfg, is_static);
+    dedicate_this_register(cfg);
   }
   bool first{true};
   while (true) {
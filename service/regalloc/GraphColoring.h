@@ -155,6 +155,13 @@ class Allocator {
   Stats m_stats;
 };
 
+/*
+ * Split the `this` parameter of a non-static method into its own symreg if
+ * anything else writes to its live range, so that allocating that symreg a
+ * register of its own keeps `this` intact throughout the method.
+ */
+void dedicate_this_register(cfg::ControlFlowGraph& cfg);
+
 } // namespace graph_coloring
 
 } // namespace regalloc
@@ -49,6 +49,21 @@ uint32_t edge_weight_helper(uint8_t u_width, uint8_t v_width) {
   return ((v_width - 1) >> (u_width - 1)) + 1;
 }
 
+void AdjacencyMatrix::make_sparse() {
+  always_assert(m_dense);
+  for (reg_t hi = 1; hi < m_dense_size; ++hi) {
+    for (reg_t lo = 0; lo < hi; ++lo) {
+      auto index = bit_index(hi, lo);
+      if (test_bit(index)) {
+        m_sparse.emplace(build_edge(hi, lo), test_bit(index + 1));
+      }
+    }
+  }
+  m_dense = false;
+  m_bits.clear();
+  m_bits.shrink_to_fit();
+}
+
 } // namespace impl
 
 using namespace impl;
@@ -88,8 +103,7 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   //
   // then the final state of the edge between s0 and s1 must be
   // non-coalesceable.
-  m_adj_matrix[build_edge(u, v)] =
-      m_adj_matrix[build_edge(u, v)] || !can_coalesce;
+  m_adj_matrix.add(u, v, can_coalesce);
 }
 
 uint32_t Node::colorable_limit() const {
@@ -284,7 +298,7 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
                           reg_t initial_regs,
                           const RangeSet& range_set,
                           bool containment_edges) {
-  Graph graph;
+  Graph graph(cfg.get_registers_size());
   auto ii = cfg::InstructionIterable(cfg);
   for (auto it = ii.begin(); it != ii.end(); ++it) {
     GraphBuilder::update_node_constraints(it, range_set, &graph);
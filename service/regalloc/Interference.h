@@ -9,6 +9,7 @@
 
 #include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/filtered.hpp>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -88,6 +89,96 @@ inline reg_pair_t build_edge(reg_t u, reg_t v) {
   return (hi << (sizeof(reg_t) * 8)) | lo;
 }
 
+/*
+ * The set of interference edges, each of which may or may not be
+ * coalesceable.
+ *
+ * Most methods have few registers, and for those, a dense triangular bit
+ * matrix with two bits per pair of registers makes edge lookups and insertions
+ * much cheaper than hashing. It is used when the number of registers is known
+ * upfront to be at most DENSE_THRESHOLD. Otherwise, or once a register beyond
+ * the announced number shows up, edges are kept in a hash map.
+ */
+class AdjacencyMatrix {
+ public:
+  static constexpr reg_t DENSE_THRESHOLD = 256;
+
+  AdjacencyMatrix() = default;
+
+  explicit AdjacencyMatrix(reg_t num_regs) {
+    if (num_regs <= DENSE_THRESHOLD) {
+      m_dense = true;
+      m_dense_size = num_regs;
+      m_bits.resize((bit_index(num_regs, 0) + 63) / 64);
+    }
+  }
+
+  bool contains(reg_t u, reg_t v) const {
+    if (!m_dense) {
+      return m_sparse.count(build_edge(u, v));
+    }
+    if (u == v || std::max(u, v) >= m_dense_size) {
+      return false;
+    }
+    return test_bit(bit_index(u, v));
+  }
+
+  bool is_coalesceable(reg_t u, reg_t v) const {
+    if (!m_dense) {
+      auto it = m_sparse.find(build_edge(u, v));
+      return it == m_sparse.end() || !it->second;
+    }
+    if (u == v || std::max(u, v) >= m_dense_size) {
+      return true;
+    }
+    return !test_bit(bit_index(u, v) + 1);
+  }
+
+  // Adds the edge, unless it is already present. An edge stays
+  // coalesceable only as long as it is only ever added as coalesceable.
+  void add(reg_t u, reg_t v, bool can_coalesce) {
+    if (m_dense && std::max(u, v) >= m_dense_size) {
+      make_sparse();
+    }
+    if (!m_dense) {
+      auto& non_coalesceable = m_sparse[build_edge(u, v)];
+      non_coalesceable = non_coalesceable || !can_coalesce;
+      return;
+    }
+    auto index = bit_index(u, v);
+    set_bit(index);
+    if (!can_coalesce) {
+      set_bit(index + 1);
+    }
+  }
+
+ private:
+  // The first of the two bits of the edge between u and v, where u != v. The
+  // first bit tells whether the edge is present, the second one whether it is
+  // non-coalesceable.
+  static size_t bit_index(reg_t u, reg_t v) {
+    size_t hi = std::max(u, v);
+    size_t lo = std::min(u, v);
+    return (hi * (hi - 1) / 2 + lo) * 2;
+  }
+
+  bool test_bit(size_t index) const {
+    return (m_bits[index / 64] >> (index % 64)) & 1;
+  }
+
+  void set_bit(size_t index) {
+    m_bits[index / 64] |= uint64_t(1) << (index % 64);
+  }
+
+  void make_sparse();
+
+  bool m_dense{false};
+  reg_t m_dense_size{0};
+  std::vector<uint64_t> m_bits;
+  // Maps edges to whether they are non-coalesceable.
+  std::unordered_map<reg_pair_t, bool> m_sparse;
+};
+
 } // namespace impl
 
 class Node {
@@ -191,11 +282,11 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
-    return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
+    return m_adj_matrix.contains(u, v);
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
-    return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
+    return m_adj_matrix.is_coalesceable(u, v);
   }
 
   bool has_containment_edge(reg_t u, reg_t v) const {
@@ -228,8 +319,10 @@ class Graph {
   }
 
  private:
+  explicit Graph(reg_t num_regs) : m_adj_matrix(num_regs) {}
+
   std::unordered_map<reg_t, Node> m_nodes;
-  std::unordered_map<reg_pair_t, bool> m_adj_matrix;
+  impl::AdjacencyMatrix m_adj_matrix;
   std::unordered_set<reg_pair_t> m_containment_graph;
 
   friend class impl::GraphBuilder;
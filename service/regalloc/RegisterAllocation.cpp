@@ -17,6 +17,7 @@
 #include "GraphColoring.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
+#include "Interference.h"
 #include "LiveRange.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -76,4 +77,45 @@ Allocator::Stats allocate(
 }
 
 } // namespace graph_coloring
+
+bool satisfies_encoding_constraints(cfg::ControlFlowGraph& cfg) {
+  auto range_set = init_range_set(cfg);
+  auto ii = cfg::InstructionIterable(cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto insn = it->insn;
+    if (insn->has_dest() &&
+        insn->dest() > max_unsigned_value(interference::dest_bit_width(it))) {
+      return false;
+    }
+    if (range_set.contains(insn)) {
+      for (size_t i = 1; i < insn->srcs_size(); ++i) {
+        auto expected = insn->src(i - 1) + (insn->src_is_wide(i - 1) ? 2 : 1);
+        if (insn->src(i) != expected) {
+          return false;
+        }
+      }
+      continue;
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      if (insn->src(i) >
+          interference::max_value_for_src(insn, i, insn->src_is_wide(i))) {
+        return false;
+      }
+    }
+  }
+  auto params = cfg.get_param_instructions();
+  auto param_ops = InstructionIterable(params);
+  if (param_ops.empty()) {
+    return true;
+  }
+  reg_t next_param = param_ops.begin()->insn->dest();
+  for (const auto& mie : param_ops) {
+    if (mie.insn->dest() != next_param) {
+      return false;
+    }
+    next_param += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+  return next_param == cfg.get_registers_size();
+}
+
 } // namespace regalloc
@@ -22,4 +22,15 @@ Allocator::Stats allocate(const Allocator::Config&,
                           const std::function<std::string()>& method_describer);
 
 } // namespace graph_coloring
+
+/*
+ * Whether the register assignment of the given CFG can be encoded as is, i.e.
+ * whether every register fits the operand width of its instruction, the
+ * operands of range instructions are contiguous, and the parameters occupy
+ * the last registers of the frame. Graph coloring always establishes this;
+ * allocators that do not model these constraints, like
+ * fastregalloc::LinearScanAllocator without satisfy_encoding_constraints, may
+ * not.
+ */
+bool satisfies_encoding_constraints(cfg::ControlFlowGraph&);
 } // namespace regalloc
@@ -7,9 +7,11 @@
 
 #include "SwitchDispatch.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "Creators.h"
+#include "MethodProfiles.h"
 #include "Show.h"
 #include "SourceBlocks.h"
 #include "Trace.h"
@@ -240,6 +242,64 @@ size_t estimate_num_switch_dispatch_needed(
   return 1;
 }
 
+/**
+ * The relative hotness of a dispatch target. Profiled call counts are summed
+ * over all interactions; without profiles, the largest value of the first
+ * source block of the target is used.
+ */
+double get_hotness(const dispatch::Spec& spec, const DexMethod* callee) {
+  if (spec.method_profiles != nullptr && spec.method_profiles->has_stats()) {
+    double call_count = 0;
+    auto num_interactions = spec.method_profiles->all_interactions().size();
+    for (uint32_t i = 0; i < num_interactions; ++i) {
+      auto stats = spec.method_profiles->get_method_stat(i, callee);
+      if (stats) {
+        call_count += stats->call_count;
+      }
+    }
+    return call_count;
+  }
+  double hotness = 0;
+  auto* sb = source_blocks::get_first_source_block_of_method(callee);
+  if (sb != nullptr) {
+    sb->foreach_val([&](const auto& val) {
+      if (val) {
+        hotness = std::max(hotness, static_cast<double>(val->val));
+      }
+    });
+  }
+  return hotness;
+}
+
+/**
+ * Find the case that is worth testing ahead of the switch, which is a single
+ * index target that takes at least half of the total hotness. Peeling only
+ * pays off when the remaining switch still has more than one case.
+ */
+boost::optional<SwitchIndices> get_hot_case_to_peel(
+    const dispatch::Spec& spec,
+    const std::map<SwitchIndices, DexMethod*>& indices_to_callee) {
+  if (!spec.peel_hot_case || spec.type != dispatch::Type::VIRTUAL ||
+      indices_to_callee.size() < 3) {
+    return boost::none;
+  }
+  double total = 0;
+  double hottest = 0;
+  boost::optional<SwitchIndices> hottest_indices;
+  for (auto& [indices, callee] : indices_to_callee) {
+    auto hotness = get_hotness(spec, callee);
+    total += hotness;
+    if (indices.size() == 1 && hotness > hottest) {
+      hottest = hotness;
+      hottest_indices = indices;
+    }
+  }
+  if (!hottest_indices || hottest * 2 < total) {
+    return boost::none;
+  }
+  return hottest_indices;
+}
+
 /**
  * Create a simple single level switch based dispatch method.
  * We here construct a leaf level dispatch assuming all targets are dedupped.
@@ -275,8 +335,25 @@ DexMethod* create_simple_switch_dispatch(
   mb->iget(spec.type_tag_field, self_loc, type_tag_loc);
   auto cases = get_switch_cases(indices_to_callee);
 
+  // Test the hot type tag first, and only switch over the remaining ones.
+  auto switch_block = mb;
+  auto hot_indices = get_hot_case_to_peel(spec, indices_to_callee);
+  if (hot_indices) {
+    TRACE(SDIS, 5, "peeling hot case %d of dispatch %s.%s",
+          *hot_indices->begin(), SHOW(spec.owner_type), spec.name.c_str());
+    auto hot_callee = indices_to_callee.at(*hot_indices);
+    auto hot_tag_loc = mc.make_local(type::_int());
+    mb->load_const(hot_tag_loc, *hot_indices->begin());
+    MethodBlock* hot_block = nullptr;
+    switch_block =
+        mb->if_else_test(OPCODE_IF_EQ, type_tag_loc, hot_tag_loc, &hot_block);
+    emit_check_cast(spec, args, hot_callee, hot_block);
+    invoke_static(spec, args, ret_loc, hot_callee, hot_block);
+    cases.erase(*hot_indices);
+  }
+
   // default case and return
-  auto def_block = mb->switch_op(type_tag_loc, cases);
+  auto def_block = switch_block->switch_op(type_tag_loc, cases);
   handle_default_block(spec, indices_to_callee, args, mc, ret_loc, def_block);
   mb->ret(spec.proto->get_rtype(), ret_loc);
 
@@ -340,6 +417,8 @@ dispatch::DispatchMethod create_two_level_switch_dispatch(
                               spec.type_tag_field,
                               nullptr, // overridden_method,
                               spec.keep_debug_info};
+      sub_spec.peel_hot_case = spec.peel_hot_case;
+      sub_spec.method_profiles = spec.method_profiles;
       auto sub_dispatch =
           create_simple_switch_dispatch(sub_spec, sub_indices_to_callee);
       sub_indices_to_callee.clear();
@@ -14,6 +14,10 @@
 
 struct Location;
 
+namespace method_profiles {
+class MethodProfiles;
+} // namespace method_profiles
+
 namespace dispatch {
 
 enum Type {
@@ -46,6 +50,12 @@ struct Spec {
   boost::optional<size_t> max_num_dispatch_target;
   boost::optional<size_t> type_tag_param_idx;
   bool keep_debug_info;
+  // When set, a virtual leaf dispatch tests the hottest type tag before its
+  // switch if that target takes at least half of the calls. The hotness is
+  // taken from the method profiles when available, and from the source block
+  // values of the targets otherwise.
+  bool peel_hot_case{false};
+  const method_profiles::MethodProfiles* method_profiles{nullptr};
 
   Spec(DexType* owner_type,
        Type type,
@@ -25,7 +25,9 @@ class LocalTypeAnalyzer final
   LocalTypeAnalyzer(const cfg::ControlFlowGraph& cfg,
                     InstructionAnalyzer<DexTypeEnvironment> insn_analyer)
       : ir_analyzer::BaseIRAnalyzer<DexTypeEnvironment>(cfg),
-        m_insn_analyzer(std::move(insn_analyer)) {}
+        m_insn_analyzer(std::move(insn_analyer)) {
+    ir_analyzer::retain_entry_states_only_if_large(cfg, this);
+  }
 
   void analyze_instruction(const IRInstruction* insn,
                            DexTypeEnvironment* env) const override;
@@ -27,11 +27,11 @@ const DexString* get_deobfuscated_name_dex_string(const DexMember* member) {
 
 template <>
 const DexString* get_deobfuscated_name_dex_string(const DexField* member) {
-  const auto& str = member->get_deobfuscated_name();
-  if (str.empty()) {
+  const auto* str = member->get_deobfuscated_name_or_null();
+  if (str == nullptr || str->str().empty()) {
     return nullptr;
   }
-  return DexString::make_string(str);
+  return str;
 }
 } // namespace
 
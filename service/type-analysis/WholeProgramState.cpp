@@ -12,6 +12,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace type_analyzer;
 
@@ -292,10 +293,16 @@ void WholeProgramState::analyze_clinits_and_ctors(
 void WholeProgramState::collect(const Scope& scope,
                                 const global::GlobalTypeAnalyzer& gta,
                                 const EligibleIfields& eligible_ifields) {
-  ConcurrentMap<const DexField*, DexTypeDomain> fields_tmp;
-  ConcurrentMap<const DexMethod*, DexTypeDomain> methods_tmp;
-
-  walk::parallel::methods(scope, [&](DexMethod* method) {
+  // Each worker joins the types it collects into its own partial state, so
+  // that the walk does not contend on shared maps. A method is only visited
+  // by a single worker, so its return type can be completed locally.
+  struct PartialTypes {
+    std::unordered_map<const DexField*, DexTypeDomain> fields;
+    std::vector<std::pair<const DexMethod*, DexTypeDomain>> methods;
+  };
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<CacheAligned<PartialTypes>> partials(num_threads);
+  auto collect_method = [&](DexMethod* method, PartialTypes* partial) {
     IRCode* code = method->get_code();
     if (code == nullptr) {
       return;
@@ -305,25 +312,74 @@ void WholeProgramState::collect(const Scope& scope,
     }
     auto& cfg = code->cfg();
     auto lta = gta.get_internal_local_analysis(method);
+    boost::optional<DexTypeDomain> return_type;
     for (cfg::Block* b : cfg.blocks()) {
       auto env = lta->get_entry_state_at(b);
       for (auto& mie : InstructionIterable(b)) {
         auto* insn = mie.insn;
         lta->analyze_instruction(insn, &env);
-        collect_field_types(insn, env, eligible_ifields, &fields_tmp);
-        collect_return_types(insn, env, method, &methods_tmp);
+        collect_field_types(insn, env, eligible_ifields, &partial->fields);
+        collect_return_types(insn, env, method, &return_type);
       }
     }
-  });
-  for (const auto& pair : fields_tmp) {
-    m_field_partition.update(pair.first, [&pair](auto* current_type) {
-      current_type->join_with(pair.second);
-    });
+    if (return_type) {
+      partial->methods.emplace_back(method, std::move(*return_type));
+    }
+  };
+  workqueue_run<DexClass*>(
+      [&](sparta::WorkerState<DexClass*>* state, DexClass* cls) {
+        PartialTypes& partial = partials[state->worker_id()];
+        for (auto* method : cls->get_dmethods()) {
+          collect_method(method, &partial);
+        }
+        for (auto* method : cls->get_vmethods()) {
+          collect_method(method, &partial);
+        }
+      },
+      scope,
+      num_threads);
+
+  // Join the partial field types pairwise in parallel, halving the number of
+  // partial states in each round.
+  for (size_t stride = 1; stride < num_threads; stride *= 2) {
+    workqueue_run_for<size_t>(
+        0, (num_threads + 2 * stride - 1) / (2 * stride), [&](size_t i) {
+          auto dst_idx = 2 * stride * i;
+          auto src_idx = dst_idx + stride;
+          if (src_idx >= num_threads) {
+            return;
+          }
+          PartialTypes& dst_partial = partials[dst_idx];
+          PartialTypes& src_partial = partials[src_idx];
+          auto& dst = dst_partial.fields;
+          auto& src = src_partial.fields;
+          if (dst.size() < src.size()) {
+            dst.swap(src);
+          }
+          for (auto& [field, type] : src) {
+            auto [it, emplaced] = dst.emplace(field, type);
+            if (!emplaced) {
+              it->second.join_with(type);
+            }
+          }
+          src.clear();
+        });
   }
-  for (const auto& pair : methods_tmp) {
-    m_method_partition.update(pair.first, [&pair](auto* current_type) {
-      current_type->join_with(pair.second);
-    });
+
+  if (!partials.empty()) {
+    PartialTypes& merged = partials.front();
+    for (const auto& pair : merged.fields) {
+      m_field_partition.update(pair.first, [&pair](auto* current_type) {
+        current_type->join_with(pair.second);
+      });
+    }
+  }
+  for (PartialTypes& partial : partials) {
+    for (const auto& pair : partial.methods) {
+      m_method_partition.update(pair.first, [&pair](auto* current_type) {
+        current_type->join_with(pair.second);
+      });
+    }
   }
 }
 
@@ -331,7 +387,7 @@ void WholeProgramState::collect_field_types(
     const IRInstruction* insn,
     const DexTypeEnvironment& env,
     const EligibleIfields& eligible_ifields,
-    ConcurrentMap<const DexField*, DexTypeDomain>* field_tmp) {
+    std::unordered_map<const DexField*, DexTypeDomain>* field_tmp) {
   if (!opcode::is_an_sput(insn->opcode()) &&
       !opcode::is_an_iput(insn->opcode())) {
     return;
@@ -352,22 +408,17 @@ void WholeProgramState::collect_field_types(
     ss << type;
     TRACE(TYPE, 5, "collecting field %s -> %s", SHOW(field), ss.str().c_str());
   }
-  field_tmp->update(
-      field,
-      [&type](const DexField*, DexTypeDomain& current_type, bool exists) {
-        if (exists) {
-          current_type.join_with(type);
-        } else {
-          current_type = std::move(type);
-        }
-      });
+  auto [it, emplaced] = field_tmp->emplace(field, type);
+  if (!emplaced) {
+    it->second.join_with(type);
+  }
 }
 
 void WholeProgramState::collect_return_types(
     const IRInstruction* insn,
     const DexTypeEnvironment& env,
     const DexMethod* method,
-    ConcurrentMap<const DexMethod*, DexTypeDomain>* method_tmp) {
+    boost::optional<DexTypeDomain>* return_tmp) {
   auto op = insn->opcode();
   if (!opcode::is_a_return(op)) {
     return;
@@ -377,11 +428,7 @@ void WholeProgramState::collect_return_types(
     // does indeed return -- even though `void` is not actually a return type,
     // this tells us that the code following any invoke of this method is
     // reachable.
-    method_tmp->update(
-        method,
-        [](const DexMethod*, DexTypeDomain& current_type, bool /* exists */) {
-          current_type = DexTypeDomain::top();
-        });
+    *return_tmp = DexTypeDomain::top();
     return;
   }
   auto type = env.get(insn->src(0));
@@ -391,14 +438,11 @@ void WholeProgramState::collect_return_types(
     TRACE(TYPE, 5, "collecting method %s -> %s", SHOW(method),
           ss.str().c_str());
   }
-  method_tmp->update(method, [&type](const DexMethod*,
-                                     DexTypeDomain& current_type, bool exists) {
-    if (exists) {
-      current_type.join_with(type);
-    } else {
-      current_type = std::move(type);
-    }
-  });
+  if (*return_tmp) {
+    (*return_tmp)->join_with(type);
+  } else {
+    *return_tmp = std::move(type);
+  }
 }
 
 bool WholeProgramState::is_reachable(const global::GlobalTypeAnalyzer& gta,
@@ -203,13 +203,12 @@ class WholeProgramState {
       const IRInstruction* insn,
       const DexTypeEnvironment& env,
       const EligibleIfields& eligible_ifields,
-      ConcurrentMap<const DexField*, DexTypeDomain>* field_tmp);
+      std::unordered_map<const DexField*, DexTypeDomain>* field_tmp);
 
-  void collect_return_types(
-      const IRInstruction* insn,
-      const DexTypeEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, DexTypeDomain>* method_tmp);
+  void collect_return_types(const IRInstruction* insn,
+                            const DexTypeEnvironment& env,
+                            const DexMethod* method,
+                            boost::optional<DexTypeDomain>* return_tmp);
 
   bool is_reachable(const global::GlobalTypeAnalyzer&, const DexMethod*) const;
 
@@ -0,0 +1,469 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Measures the throughput of the lattice operations and the memory footprint
+ * of the abstract domains and environments that analyses typically choose
+ * between.
+ *
+ * Every benchmark runs over pairs of elements (a, b), where b is derived from
+ * a copy of a by changing some of its bindings. This mirrors the states that
+ * meet at a control-flow join during a fixpoint iteration, which mostly agree
+ * and (for persistent structures) share most of their representation. The
+ * sizes of the elements are drawn from a profile: a weighted histogram of
+ * sizes, the key space and the fraction of bindings that a and b share.
+ * Profiles can be loaded from files, so histograms recorded from real analysis
+ * runs can be replayed, see `load_profile`.
+ *
+ * Usage:
+ *   sparta-domain-benchmark [--samples N] [--iterations N] [--seed N]
+ *                           [--filter SUBSTRING] [--profile FILE]...
+ */
+
+#include <sparta/AbstractEnvironment.h>
+#include <sparta/ConstantAbstractDomain.h>
+#include <sparta/FlatMap.h>
+#include <sparta/HashedAbstractEnvironment.h>
+#include <sparta/PatriciaTreeMapAbstractEnvironment.h>
+#include <sparta/SmallSortedSetAbstractDomain.h>
+#include <sparta/SparseSetAbstractDomain.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+ * Live heap bytes, maintained by the replaced global allocation functions
+ * below. Each allocation is prefixed with its size.
+ */
+namespace {
+
+std::atomic<int64_t> s_live_bytes{0};
+
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void* counted_alloc(size_t size) {
+  auto* p = static_cast<char*>(std::malloc(size + kHeaderSize));
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>(p) = size;
+  s_live_bytes.fetch_add(size, std::memory_order_relaxed);
+  return p + kHeaderSize;
+}
+
+void counted_free(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto* p = static_cast<char*>(ptr) - kHeaderSize;
+  s_live_bytes.fetch_sub(*reinterpret_cast<size_t*>(p),
+                         std::memory_order_relaxed);
+  std::free(p);
+}
+
+} // namespace
+
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { counted_free(ptr); }
+
+using namespace sparta;
+
+namespace {
+
+using Key = uint32_t;
+using Value = int64_t;
+
+struct Profile {
+  std::string name;
+  // Pairs of (size, weight).
+  std::vector<std::pair<size_t, size_t>> sizes;
+  // Dense profiles draw keys from [0, 2 * size), like register numbers.
+  // Sparse ones draw from a large key space, like interned fields or types.
+  bool dense{true};
+  // Fraction of the bindings of a that are left unchanged in b.
+  double overlap{0.9};
+};
+
+std::vector<Profile> builtin_profiles() {
+  return {
+      // Register environments of a constant propagation: mostly small, with
+      // a long tail of large methods.
+      {"registers",
+       {{1, 20},
+        {2, 18},
+        {4, 16},
+        {8, 14},
+        {16, 12},
+        {32, 8},
+        {64, 6},
+        {128, 4},
+        {256, 2}},
+       true,
+       0.9},
+      // Field or type keyed environments.
+      {"sparse", {{1, 30}, {4, 25}, {16, 20}, {64, 15}, {256, 10}}, false, 0.5},
+      // The states of whole-method or interprocedural analyses.
+      {"large", {{1024, 2}, {4096, 1}}, true, 0.95},
+  };
+}
+
+/*
+ * A profile file consists of lines of the form
+ *
+ *   <size> <weight>   a bucket of the size histogram
+ *   keys dense|sparse
+ *   overlap <fraction>
+ *
+ * Empty lines and everything after a '#' are ignored.
+ */
+Profile load_profile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Could not open profile " << path << std::endl;
+    std::exit(1);
+  }
+  Profile profile;
+  auto slash = path.find_last_of('/');
+  profile.name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string first;
+    if (!(fields >> first)) {
+      continue;
+    }
+    if (first == "keys") {
+      std::string kind;
+      fields >> kind;
+      profile.dense = kind != "sparse";
+    } else if (first == "overlap") {
+      fields >> profile.overlap;
+    } else {
+      size_t weight = 0;
+      fields >> weight;
+      profile.sizes.emplace_back(std::stoul(first), weight);
+    }
+  }
+  if (profile.sizes.empty()) {
+    std::cerr << "Profile " << path << " has no sizes" << std::endl;
+    std::exit(1);
+  }
+  return profile;
+}
+
+/*
+ * The bindings of a, and the changes that turn a copy of a into b. A change
+ * without a value removes the key.
+ */
+struct Sample {
+  Key universe;
+  std::vector<std::pair<Key, Value>> bindings;
+  std::vector<std::pair<Key, std::optional<Value>>> changes;
+};
+
+std::vector<Sample> generate_samples(const Profile& profile,
+                                     size_t num_samples,
+                                     size_t max_size,
+                                     std::mt19937& rng) {
+  std::vector<size_t> weights;
+  for (const auto& bucket : profile.sizes) {
+    weights.push_back(bucket.second);
+  }
+  std::discrete_distribution<size_t> bucket_dist(weights.begin(),
+                                                 weights.end());
+  // Few distinct constants, so that values often agree.
+  std::uniform_int_distribution<Value> value_dist(0, 7);
+  std::uniform_real_distribution<double> unit(0, 1);
+
+  std::vector<Sample> samples(num_samples);
+  for (auto& sample : samples) {
+    size_t size = std::min(profile.sizes[bucket_dist(rng)].first, max_size);
+    sample.universe =
+        profile.dense ? std::max<Key>(static_cast<Key>(2 * size), 1)
+                      : Key(1) << 24;
+    std::uniform_int_distribution<Key> key_dist(0, sample.universe - 1);
+    std::unordered_set<Key> keys;
+    while (keys.size() < size) {
+      keys.insert(key_dist(rng));
+    }
+    for (auto key : keys) {
+      sample.bindings.emplace_back(key, value_dist(rng));
+    }
+    for (const auto& binding : sample.bindings) {
+      if (unit(rng) < profile.overlap) {
+        continue;
+      }
+      double kind = unit(rng);
+      if (kind < 1.0 / 3) {
+        sample.changes.emplace_back(binding.first, std::nullopt);
+      } else if (kind < 2.0 / 3) {
+        sample.changes.emplace_back(binding.first, value_dist(rng) + 8);
+      } else {
+        Key key = key_dist(rng);
+        if (!keys.count(key)) {
+          sample.changes.emplace_back(key, value_dist(rng));
+        }
+      }
+    }
+  }
+  return samples;
+}
+
+using ConstantDomain = ConstantAbstractDomain<Value>;
+
+/*
+ * How to build the elements of a domain from a sample. Environments bind keys
+ * to constants, set domains only use the keys.
+ */
+template <typename Env>
+struct EnvironmentTraits {
+  static constexpr size_t max_size = std::numeric_limits<size_t>::max();
+
+  static Env make(const Sample& sample) {
+    Env env;
+    for (const auto& [key, value] : sample.bindings) {
+      env.set(key, ConstantDomain(value));
+    }
+    return env;
+  }
+
+  static void apply(const Sample& sample, Env* env) {
+    for (const auto& [key, value] : sample.changes) {
+      env->set(key, value ? ConstantDomain(*value) : ConstantDomain::top());
+    }
+  }
+};
+
+template <typename Set, size_t MaxSize = std::numeric_limits<size_t>::max()>
+struct SetTraits {
+  static constexpr size_t max_size = MaxSize;
+
+  static Set make(const Sample& sample) {
+    Set set;
+    for (const auto& binding : sample.bindings) {
+      set.add(binding.first);
+    }
+    return set;
+  }
+
+  static void apply(const Sample& sample, Set* set) {
+    for (const auto& [key, value] : sample.changes) {
+      if (value) {
+        set->add(key);
+      } else {
+        set->remove(key);
+      }
+    }
+  }
+};
+
+struct SparseSetTraits {
+  using Set = SparseSetAbstractDomain<Key>;
+
+  static constexpr size_t max_size = std::numeric_limits<size_t>::max();
+
+  static Set make(const Sample& sample) {
+    Set set(sample.universe);
+    for (const auto& binding : sample.bindings) {
+      set.add(binding.first);
+    }
+    return set;
+  }
+
+  static void apply(const Sample& sample, Set* set) {
+    SetTraits<Set>::apply(sample, set);
+  }
+};
+
+struct Options {
+  size_t samples{2000};
+  size_t iterations{5};
+  uint32_t seed{0};
+  std::string filter;
+  std::vector<Profile> profiles;
+};
+
+// Keeps the results of the measured operations alive.
+std::atomic<size_t> s_sink{0};
+
+template <typename Fn>
+double time_ns_per_op(size_t num_ops, size_t iterations, const Fn& fn) {
+  double best = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    best = std::min(best, ns / num_ops);
+  }
+  return best;
+}
+
+void print_row(const std::string& domain,
+               const std::string& profile,
+               const std::string& metric,
+               double value,
+               const char* unit) {
+  std::printf("%-36s %-12s %-8s %12.1f %s\n", domain.c_str(), profile.c_str(),
+              metric.c_str(), value, unit);
+}
+
+template <typename Domain, typename Traits>
+void run_benchmark(const std::string& name,
+                   const Options& options,
+                   bool dense_only) {
+  if (name.find(options.filter) == std::string::npos) {
+    return;
+  }
+  for (const auto& profile : options.profiles) {
+    if (dense_only && !profile.dense) {
+      continue;
+    }
+    std::mt19937 rng(options.seed);
+    auto samples =
+        generate_samples(profile, options.samples, Traits::max_size, rng);
+
+    std::vector<std::pair<Domain, Domain>> pairs;
+    pairs.reserve(samples.size());
+    size_t num_bindings = 0;
+    auto live_before = s_live_bytes.load();
+    for (const auto& sample : samples) {
+      auto a = Traits::make(sample);
+      auto b = a;
+      Traits::apply(sample, &b);
+      pairs.emplace_back(std::move(a), std::move(b));
+      num_bindings += 2 * sample.bindings.size();
+    }
+    auto live_bytes = s_live_bytes.load() - live_before;
+    size_t n = pairs.size();
+
+    auto copy = time_ns_per_op(n, options.iterations, [&]() {
+      for (const auto& [a, b] : pairs) {
+        Domain r = a;
+        s_sink += r.is_top();
+      }
+    });
+    auto join = time_ns_per_op(n, options.iterations, [&]() {
+      for (const auto& [a, b] : pairs) {
+        Domain r = a;
+        r.join_with(b);
+        s_sink += r.is_top();
+      }
+    });
+    auto meet = time_ns_per_op(n, options.iterations, [&]() {
+      for (const auto& [a, b] : pairs) {
+        Domain r = a;
+        r.meet_with(b);
+        s_sink += r.is_bottom();
+      }
+    });
+    auto leq = time_ns_per_op(n, options.iterations, [&]() {
+      for (const auto& [a, b] : pairs) {
+        s_sink += a.leq(b);
+      }
+    });
+    auto equals = time_ns_per_op(n, options.iterations, [&]() {
+      for (const auto& [a, b] : pairs) {
+        s_sink += a.equals(b);
+      }
+    });
+
+    print_row(name, profile.name, "copy", copy, "ns/op");
+    print_row(name, profile.name, "join", join, "ns/op");
+    print_row(name, profile.name, "meet", meet, "ns/op");
+    print_row(name, profile.name, "leq", leq, "ns/op");
+    print_row(name, profile.name, "equals", equals, "ns/op");
+    print_row(name, profile.name, "memory",
+              static_cast<double>(live_bytes) / std::max<size_t>(1, 2 * n),
+              "bytes/element");
+    print_row(
+        name, profile.name, "memory",
+        static_cast<double>(live_bytes) / std::max<size_t>(1, num_bindings),
+        "bytes/binding");
+  }
+}
+
+Options parse_options(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << arg << std::endl;
+        std::exit(1);
+      }
+      return argv[++i];
+    };
+    if (arg == "--samples") {
+      options.samples = std::stoul(next());
+    } else if (arg == "--iterations") {
+      options.iterations = std::max<size_t>(1, std::stoul(next()));
+    } else if (arg == "--seed") {
+      options.seed = std::stoul(next());
+    } else if (arg == "--filter") {
+      options.filter = next();
+    } else if (arg == "--profile") {
+      options.profiles.push_back(load_profile(next()));
+    } else {
+      std::cerr << "Unknown argument " << arg << std::endl;
+      std::exit(1);
+    }
+  }
+  if (options.profiles.empty()) {
+    options.profiles = builtin_profiles();
+  }
+  return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  auto options = parse_options(argc, argv);
+
+  using PatriciaEnv = PatriciaTreeMapAbstractEnvironment<Key, ConstantDomain>;
+  using HashedEnv = HashedAbstractEnvironment<Key, ConstantDomain>;
+  using FlatMapEnv = AbstractEnvironment<
+      FlatMap<Key, ConstantDomain, TopValueInterface<ConstantDomain>>>;
+  constexpr size_t kSmallSetMaxCount = 16;
+  using SmallSet = SmallSortedSetAbstractDomain<Key, kSmallSetMaxCount>;
+
+  run_benchmark<PatriciaEnv, EnvironmentTraits<PatriciaEnv>>(
+      "PatriciaTreeMapAbstractEnvironment", options, false);
+  run_benchmark<HashedEnv, EnvironmentTraits<HashedEnv>>(
+      "HashedAbstractEnvironment", options, false);
+  run_benchmark<FlatMapEnv, EnvironmentTraits<FlatMapEnv>>(
+      "FlatMap AbstractEnvironment", options, false);
+  // Larger sets collapse to top, so sizes are capped at the maximum count.
+  run_benchmark<SmallSet, SetTraits<SmallSet, kSmallSetMaxCount>>(
+      "SmallSortedSetAbstractDomain", options, false);
+  // The sparse set allocates its whole universe, so only dense keys apply.
+  run_benchmark<SparseSetAbstractDomain<Key>, SparseSetTraits>(
+      "SparseSetAbstractDomain", options, true);
+
+  return 0;
+}
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <boost/optional.hpp>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <type_traits>
 #include <unordered_map>
@@ -16,6 +19,7 @@
 
 #include <sparta/AbstractDomain.h>
 #include <sparta/TypeTraits.h>
+#include <sparta/WorkQueue.h>
 
 namespace sparta {
 
@@ -96,6 +100,22 @@ class AbstractRegistry {
   virtual ~AbstractRegistry() {}
 };
 
+// Registries that support the SCC-wave scheduling of the
+// InterproceduralAnalyzer (see `run_in_waves`) need to track updates per
+// function. The summaries of distinct functions may be updated and queried
+// concurrently.
+template <typename Function>
+class AbstractFunctionRegistry : public AbstractRegistry {
+ public:
+  using AbstractRegistry::has_update;
+  using AbstractRegistry::materialize_update;
+
+  // Whether the summary of the function changed since the last
+  // materialization of its update.
+  virtual bool has_update(const Function& function) const = 0;
+  virtual void materialize_update(const Function& function) = 0;
+};
+
 // Typical Usage:
 
 // struct IRAdaptor /* defined for the IR */ {
@@ -240,6 +260,180 @@ class InterproceduralAnalyzer {
     return fp;
   }
 
+  // Instead of iterating over the whole program until a global fixpoint is
+  // reached, analyze the strongly connected components of the call graph
+  // bottom-up: a component is scheduled on the thread pool as soon as all the
+  // components it calls into are done, so independent components of a wave
+  // are analyzed in parallel. Within a component, only the functions calling
+  // into a function whose summary changed are re-analyzed, for at most
+  // `max_iteration` rounds.
+  //
+  // Summaries only flow from callees to callers here, so this is only suitable
+  // for analyses that do not depend on the calling context: each function is
+  // analyzed with the initial caller context. The Registry must derive from
+  // AbstractFunctionRegistry.
+  void run_in_waves(
+      unsigned int num_threads = parallel::default_num_threads()) {
+    static_assert(
+        std::is_base_of<AbstractFunctionRegistry<Function>, Registry>::value,
+        "Registry must inherit from sparta::AbstractFunctionRegistry");
+
+    boost::optional<CallGraph> callgraph = boost::none;
+    callgraph = Analysis::call_graph_of(m_program, &this->registry);
+
+    // Number the nodes reachable from the entry.
+    using NodeId = typename CallGraphInterface::NodeId;
+    std::vector<NodeId> nodes;
+    std::vector<std::vector<size_t>> successors;
+    std::unordered_map<NodeId, size_t> indices;
+    auto index_of = [&](const NodeId& node) {
+      auto it = indices.emplace(node, nodes.size()).first;
+      if (it->second == nodes.size()) {
+        nodes.push_back(node);
+        successors.emplace_back();
+      }
+      return it->second;
+    };
+    index_of(CallGraphInterface::entry(*callgraph));
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      NodeId node = nodes[i];
+      const auto& graph = *callgraph;
+      for (const auto& edge : CallGraphInterface::successors(graph, node)) {
+        auto target = index_of(CallGraphInterface::target(graph, edge));
+        successors[i].push_back(target);
+      }
+    }
+
+    // Tarjan's algorithm yields the components in reverse topological order.
+    constexpr size_t kNone = std::numeric_limits<size_t>::max();
+    size_t num_nodes = nodes.size();
+    std::vector<size_t> order(num_nodes, kNone);
+    std::vector<size_t> lowlink(num_nodes);
+    std::vector<size_t> scc_of(num_nodes, kNone);
+    std::vector<std::vector<size_t>> sccs;
+    {
+      std::vector<size_t> stack;
+      std::vector<std::pair<size_t, size_t>> dfs;
+      size_t counter = 0;
+      auto visit = [&](size_t v) {
+        order[v] = lowlink[v] = counter++;
+        stack.push_back(v);
+        dfs.emplace_back(v, 0);
+      };
+      visit(0);
+      while (!dfs.empty()) {
+        auto& [v, pos] = dfs.back();
+        if (pos < successors[v].size()) {
+          size_t w = successors[v][pos++];
+          if (order[w] == kNone) {
+            visit(w);
+          } else if (scc_of[w] == kNone) {
+            lowlink[v] = std::min(lowlink[v], order[w]);
+          }
+          continue;
+        }
+        size_t u = v;
+        dfs.pop_back();
+        if (!dfs.empty()) {
+          auto parent = dfs.back().first;
+          lowlink[parent] = std::min(lowlink[parent], lowlink[u]);
+        }
+        if (lowlink[u] == order[u]) {
+          auto& scc = sccs.emplace_back();
+          size_t w;
+          do {
+            w = stack.back();
+            stack.pop_back();
+            scc_of[w] = sccs.size() - 1;
+            scc.push_back(w);
+          } while (w != u);
+        }
+      }
+    }
+
+    size_t num_sccs = sccs.size();
+    std::vector<std::vector<size_t>> caller_sccs(num_sccs);
+    auto pending = std::make_unique<std::atomic<size_t>[]>(num_sccs);
+    for (size_t s = 0; s < num_sccs; ++s) {
+      std::vector<size_t> callee_sccs;
+      for (auto v : sccs[s]) {
+        for (auto w : successors[v]) {
+          if (scc_of[w] != s) {
+            callee_sccs.push_back(scc_of[w]);
+          }
+        }
+      }
+      std::sort(callee_sccs.begin(), callee_sccs.end());
+      callee_sccs.erase(std::unique(callee_sccs.begin(), callee_sccs.end()),
+                        callee_sccs.end());
+      for (auto callee_scc : callee_sccs) {
+        caller_sccs[callee_scc].push_back(s);
+      }
+      pending[s].store(callee_sccs.size(), std::memory_order_relaxed);
+    }
+
+    // Each component is only touched by a single thread, so these can be
+    // shared.
+    std::vector<char> dirty(num_nodes, 1);
+    std::vector<char> changed(num_nodes, 0);
+    std::atomic<size_t> num_analyses{0};
+    auto analyze_scc = [&](const std::vector<size_t>& scc, size_t s) {
+      for (int iteration = 0; iteration < m_max_iteration; iteration++) {
+        for (auto v : scc) {
+          if (!dirty[v]) {
+            continue;
+          }
+          auto context = CallGraphFixpointIterator::initial_domain();
+          this->run_on_function(Analysis::function_by_node_id(nodes[v]),
+                                &this->registry, &context, &*callgraph)
+              ->summarize();
+          num_analyses.fetch_add(1, std::memory_order_relaxed);
+        }
+        bool any_changed = false;
+        for (auto v : scc) {
+          auto function = Analysis::function_by_node_id(nodes[v]);
+          changed[v] = this->registry.has_update(function);
+          if (changed[v]) {
+            this->registry.materialize_update(function);
+            any_changed = true;
+          }
+        }
+        if (!any_changed) {
+          break;
+        }
+        for (auto v : scc) {
+          dirty[v] = std::any_of(
+              successors[v].begin(), successors[v].end(),
+              [&](size_t w) { return scc_of[w] == s && changed[w]; });
+        }
+      }
+    };
+
+    auto wq = work_queue<size_t>(
+        [&](WorkerState<size_t>* worker_state, size_t s) {
+          analyze_scc(sccs[s], s);
+          for (auto caller_scc : caller_sccs[s]) {
+            if (pending[caller_scc].fetch_sub(1) == 1) {
+              worker_state->push_task(caller_scc);
+            }
+          }
+        },
+        num_threads,
+        /*push_tasks_while_running=*/true);
+    for (size_t s = 0; s < num_sccs; ++s) {
+      if (pending[s].load(std::memory_order_relaxed) == 0) {
+        wq.add_item(s);
+      }
+    }
+    wq.run_all();
+
+    if (m_logger) {
+      (*m_logger)(std::to_string(num_sccs) + " components analyzed with " +
+                  std::to_string(num_analyses.load()) +
+                  " function analyses.");
+    }
+  }
+
   virtual std::shared_ptr<FunctionAnalyzer> run_on_function(
       const Function& function,
       Registry* reg,
@@ -11,11 +11,13 @@
 #include <functional>
 #include <initializer_list>
 #include <ostream>
+#include <vector>
 
 #include <boost/container/flat_map.hpp>
 
 #include <sparta/AbstractMap.h>
 #include <sparta/AbstractMapValue.h>
+#include <sparta/FlatUtil.h>
 #include <sparta/PatriciaTreeCore.h>
 #include <sparta/PerfectForwardCapture.h>
 
@@ -65,6 +67,7 @@ class FlatMap final
   // C++ container concept member types
   using key_type = Key;
   using mapped_type = typename ValueInterface::type;
+  using value_interface = ValueInterface;
   using value_type = typename BoostFlatMap::value_type;
   using iterator = typename BoostFlatMap::const_iterator;
   using const_iterator = iterator;
@@ -116,8 +119,9 @@ class FlatMap final
   iterator end() const { return m_map.cend(); }
 
   const mapped_type& at(const Key& key) const {
-    auto it = m_map.find(key);
-    if (it == m_map.end()) {
+    auto it = flat_util::lower_bound(m_map.begin(), m_map.end(), key,
+                                     ComparePairWithKey());
+    if (it == m_map.end() || !KeyEqual()(it->first, key)) {
       static const Value default_value = ValueInterface::default_value();
       return default_value;
     } else {
@@ -170,7 +174,8 @@ class FlatMap final
       }
       // Performs a binary search (in O(log(n))) which returns an iterator on
       // the first pair where `it->first >= other_it->first`.
-      it = std::lower_bound(it, end, other_it->first, ComparePairWithKey());
+      it = flat_util::lower_bound(it, end, other_it->first,
+                                  ComparePairWithKey());
       if (it == end || !KeyEqual()(it->first, other_it->first)) {
         return false;
       }
@@ -202,7 +207,7 @@ class FlatMap final
       }
       // Performs a binary search (in O(log(n))) which returs an iterator on the
       // first pair where `other_it->first >= it->first`.
-      other_it = std::lower_bound(other_it, other_end, it->first,
+      other_it = flat_util::lower_bound(other_it, other_end, it->first,
                                   ComparePairWithKey());
       if (other_it == other_end || !KeyEqual()(it->first, other_it->first)) {
         return false;
@@ -321,24 +326,30 @@ class FlatMap final
   // std::function<void(mapped_type*, const mapped_type&)>
   template <typename CombiningFunction>
   FlatMap& union_with(CombiningFunction&& combine, const FlatMap& other) {
+    // The bindings missing from `this` are merged in at once, rather than
+    // shifting the tail of the vector for each one of them.
+    std::vector<value_type> missing;
     auto it = m_map.begin(), end = m_map.end();
     auto other_it = other.m_map.begin(), other_end = other.m_map.end();
     while (other_it != other_end) {
-      it = std::lower_bound(it, end, other_it->first, ComparePairWithKey());
+      it = flat_util::lower_bound(it, end, other_it->first,
+                                  ComparePairWithKey());
       if (it == end) {
-        m_map.insert(boost::container::ordered_unique_range, other_it,
-                     other_end);
+        missing.insert(missing.end(), other_it, other_end);
         break;
       }
       if (KeyEqual()(it->first, other_it->first)) {
         combine(&it->second, other_it->second);
+        ++it;
       } else {
-        it = m_map.insert(it, *other_it);
-        end = m_map.end();
+        missing.push_back(*other_it);
       }
-      ++it;
       ++other_it;
     }
+    if (!missing.empty()) {
+      m_map.insert(boost::container::ordered_unique_range, missing.begin(),
+                   missing.end());
+    }
     erase_default_values();
     return *this;
   }
@@ -351,7 +362,7 @@ class FlatMap final
     auto it = m_map.begin(), end = m_map.end();
     auto other_it = other.m_map.begin(), other_end = other.m_map.end();
     while (it != end) {
-      other_it = std::lower_bound(other_it, other_end, it->first,
+      other_it = flat_util::lower_bound(other_it, other_end, it->first,
                                   ComparePairWithKey());
       if (other_it == other_end) {
         m_map.erase(it, end);
@@ -378,7 +389,8 @@ class FlatMap final
     auto it = m_map.begin(), end = m_map.end();
     auto other_it = other.m_map.begin(), other_end = other.m_map.end();
     while (other_it != other_end) {
-      it = std::lower_bound(it, end, other_it->first, ComparePairWithKey());
+      it = flat_util::lower_bound(it, end, other_it->first,
+                                  ComparePairWithKey());
       if (it == end) {
         break;
       }
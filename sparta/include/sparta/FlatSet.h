@@ -11,10 +11,12 @@
 #include <functional>
 #include <initializer_list>
 #include <ostream>
+#include <vector>
 
 #include <boost/container/flat_set.hpp>
 
 #include <sparta/AbstractSet.h>
+#include <sparta/FlatUtil.h>
 #include <sparta/PatriciaTreeUtil.h>
 #include <sparta/PerfectForwardCapture.h>
 
@@ -74,7 +76,11 @@ class FlatSet final
 
   iterator end() const { return m_set.end(); }
 
-  bool contains(const Element& key) const { return m_set.contains(key); }
+  bool contains(const Element& key) const {
+    auto it =
+        flat_util::lower_bound(m_set.begin(), m_set.end(), key, Compare());
+    return it != m_set.end() && Equal()(*it, key);
+  }
 
   bool is_subset_of(const FlatSet& other) const {
     // This is optimized for `this.size() << other.size()`.
@@ -84,7 +90,7 @@ class FlatSet final
       if (std::distance(it, end) > std::distance(other_it, other_end)) {
         return false;
       }
-      other_it = std::lower_bound(other_it, other_end, *it, Compare());
+      other_it = flat_util::lower_bound(other_it, other_end, *it, Compare());
       if (other_it == other_end || !Equal()(*it, *other_it)) {
         return false;
       }
@@ -143,17 +149,20 @@ class FlatSet final
   }
 
   FlatSet& union_with(const FlatSet& other) {
-    // This is optimized for `this.size() >> other.size()`.
+    // This is optimized for `this.size() >> other.size()`. The missing
+    // elements are merged in at once, rather than shifting the tail of the
+    // vector for each one of them.
+    std::vector<Element> missing;
     auto it = m_set.begin(), end = m_set.end();
-    auto other_it = other.m_set.begin(), other_end = other.m_set.end();
-    while (other_it != other_end) {
-      it = std::lower_bound(it, end, *other_it, Compare());
-      if (it == end || !Equal()(*it, *other_it)) {
-        it = m_set.insert(it, *other_it);
-        end = m_set.end();
+    for (const auto& element : other.m_set) {
+      it = flat_util::lower_bound(it, end, element, Compare());
+      if (it == end || !Equal()(*it, element)) {
+        missing.push_back(element);
       }
-      ++it;
-      ++other_it;
+    }
+    if (!missing.empty()) {
+      m_set.insert(boost::container::ordered_unique_range, missing.begin(),
+                   missing.end());
     }
     return *this;
   }
@@ -165,7 +174,7 @@ class FlatSet final
     auto it = container.begin(), end = container.end();
     auto other_it = other.m_set.begin(), other_end = other.m_set.end();
     while (it != end) {
-      other_it = std::lower_bound(other_it, other_end, *it, Compare());
+      other_it = flat_util::lower_bound(other_it, other_end, *it, Compare());
       if (other_it != other_end && Equal()(*it, *other_it)) {
         if (first != it) {
           *first = std::move(*it);
@@ -185,14 +194,42 @@ class FlatSet final
     // This is optimized for `this.size() >> other.size()`.
     auto it = m_set.begin(), end = m_set.end();
     auto other_it = other.m_set.begin(), other_end = other.m_set.end();
-    while (other_it != other_end) {
-      it = std::lower_bound(it, end, *other_it);
-      if (it != end && Equal()(*it, *other_it)) {
-        it = m_set.erase(it);
-        end = m_set.end();
+    // Find the first element to remove before touching the container, so
+    // that removing nothing stays cheap.
+    for (; other_it != other_end; ++other_it) {
+      it = flat_util::lower_bound(it, end, *other_it, Compare());
+      if (it == end) {
+        return *this;
       }
-      ++other_it;
+      if (Equal()(*it, *other_it)) {
+        break;
+      }
+    }
+    if (other_it == other_end) {
+      return *this;
     }
+    auto offset = std::distance(m_set.begin(), it);
+    auto container = m_set.extract_sequence();
+    auto first = container.begin() + offset; // Where to write the next kept.
+    auto cur = first;
+    auto cur_end = container.end();
+    while (cur != cur_end) {
+      if (other_it != other_end && !Compare()(*cur, *other_it)) {
+        if (Equal()(*cur, *other_it)) {
+          ++cur;
+        }
+        ++other_it;
+        continue;
+      }
+      if (first != cur) {
+        *first = std::move(*cur);
+      }
+      ++first;
+      ++cur;
+    }
+    container.erase(first, cur_end);
+    m_set.adopt_sequence(boost::container::ordered_unique_range,
+                         std::move(container));
     return *this;
   }
 
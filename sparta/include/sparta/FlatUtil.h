@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <iterator>
+
+namespace sparta {
+
+namespace flat_util {
+
+/*
+ * Same result as `std::lower_bound`, but the loop has a fixed trip count for
+ * a given size and its body compiles to a conditional move. Sorted-vector
+ * lookups in abstract domains are on hot paths where the comparisons are cheap
+ * and mispredicted branches dominate the cost of a binary search.
+ */
+template <typename RandomIt, typename T, typename Compare>
+RandomIt lower_bound(RandomIt first,
+                     RandomIt last,
+                     const T& value,
+                     Compare comp) {
+  auto len = std::distance(first, last);
+  if (len == 0) {
+    return first;
+  }
+  while (len > 1) {
+    auto half = len / 2;
+    first = comp(first[half], value) ? first + half : first;
+    len -= half;
+  }
+  return comp(*first, value) ? first + 1 : first;
+}
+
+} // namespace flat_util
+
+} // namespace sparta
@@ -11,6 +11,7 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -23,6 +24,27 @@
 
 namespace sparta {
 
+/*
+ * Which states a fixpoint iterator keeps around once it has been run.
+ *
+ * By default, the entry and exit states of all nodes are retained until the
+ * iterator is cleared or destroyed. For very large graphs, this can be a lot
+ * of memory, and most clients only query the entry states, or the exit states
+ * of a few nodes. With `Entry`, the exit state of a node is released as soon
+ * as no further step of the iteration depends on it, and all exit states are
+ * released at the end of the run. Querying an exit state then recomputes it
+ * on demand from the entry state, and caches it; for loop heads, the result
+ * may be more precise than the exit state computed during the iteration. Such
+ * queries are not thread-safe, and require `analyze_node` to remain callable
+ * after the iteration.
+ *
+ * Only the sequential fixpoint iterators honor this policy.
+ */
+enum class RetainedStates {
+  All,
+  Entry,
+};
+
 namespace fp_impl {
 
 /*
@@ -60,8 +82,9 @@ class MonotonicFixpointIteratorContext final {
   explicit MonotonicFixpointIteratorContext(const Domain& init)
       : m_init(init) {}
 
-  explicit MonotonicFixpointIteratorContext(
-      const Domain& init, const std::unordered_set<NodeId>& nodes)
+  template <typename NodeSet>
+  explicit MonotonicFixpointIteratorContext(const Domain& init,
+                                            const NodeSet& nodes)
       : m_init(init) {
     // Pre-populate hash table for all the nodes.
     for (auto& node : nodes) {
@@ -144,39 +167,55 @@ class MonotonicFixpointIteratorBase
     }
   }
 
+  /*
+   * Bounds the number of node analyses performed by a run of the sequential
+   * fixpoint iterators; there is no bound by default. When the budget is
+   * exhausted, the iteration is abandoned, and the state at the entry and at
+   * the exit of every node is top. This trades all precision for a predictable
+   * running time on pathological graphs.
+   */
+  void set_step_budget(uint64_t budget) { m_step_budget = budget; }
+
+  uint64_t get_step_budget() const { return m_step_budget; }
+
+  bool has_exceeded_step_budget() const { return m_step_budget_exceeded; }
+
   /*
    * Returns the invariant computed by the fixpoint iterator at a node entry.
    */
   const Domain& get_entry_state_at(const NodeId& node) const {
+    if (m_step_budget_exceeded) {
+      return m_top_state;
+    }
     auto it = m_entry_states.find(node);
     return (it == m_entry_states.end()) ? m_bottom_state : it->second;
   }
 
+  RetainedStates get_retained_states() const { return m_retained_states; }
+
+  void set_retained_states(RetainedStates retained_states) {
+    m_retained_states = retained_states;
+  }
+
   /*
    * Returns the invariant computed by the fixpoint iterator at a node exit.
    */
   const Domain& get_exit_state_at(const NodeId& node) const {
-    auto it = m_exit_states.find(node);
-    // It's impossible to get rid of this condition by initializing all exit
-    // states to _|_ prior to starting the fixpoint iteration. The reason is
-    // that we only have a partial view of the control-flow graph, i.e., all
-    // nodes that are reachable from the root. We may have control-flow graphs
-    // with unreachable nodes pointing to reachable ones, as follows:
-    //
-    //               root
-    //           U    |
-    //           |    V
-    //           +--> A
-    //
-    // When computing the entry state of A, we perform the join of the exit
-    // states of all its predecessors, which include U. Since U is invisible to
-    // the fixpoint iterator, there is no way to initialize its exit state.
-    return (it == m_exit_states.end()) ? m_bottom_state : it->second;
+    if (m_step_budget_exceeded) {
+      return m_top_state;
+    }
+    if (m_retained_states == RetainedStates::Entry) {
+      return recompute_exit_state_at(node);
+    }
+    return exit_state_or_bottom(node);
   }
 
   void clear() {
     m_entry_states.clear();
     m_exit_states.clear();
+    m_pending_exit_reads.clear();
+    m_steps = 0;
+    m_step_budget_exceeded = false;
   }
 
   void compute_entry_state(Context* context,
@@ -187,11 +226,15 @@ class MonotonicFixpointIteratorBase
     }
     for (EdgeId edge : GraphInterface::predecessors(m_graph, node)) {
       entry_state->join_with(this->analyze_edge(
-          edge, get_exit_state_at(GraphInterface::source(m_graph, edge))));
+          edge, exit_state_or_bottom(GraphInterface::source(m_graph, edge))));
     }
   }
 
   void analyze_vertex(Context* context, const NodeId& node) {
+    if (m_step_budget != 0 && ++m_steps > m_step_budget) {
+      give_up();
+      return;
+    }
     // Retrieve the entry state. If it does not exist, set it to bottom.
     Domain& entry_state =
         m_entry_states.emplace(node, Domain::bottom()).first->second;
@@ -202,17 +245,110 @@ class MonotonicFixpointIteratorBase
     // self-loop. Initializing all exit states prior to starting the fixpoint
     // iteration is not a viable option, since the control-flow graph may
     // contain unreachable nodes pointing to reachable ones (see the
-    // documentation of `get_exit_state_at`).
+    // documentation of `exit_state_or_bottom`).
     compute_entry_state(context, node, &entry_state);
+    if (!m_pending_exit_reads.empty()) {
+      release_consumed_exit_states(node);
+    }
     Domain& exit_state = m_exit_states[node];
     exit_state = entry_state;
     this->analyze_node(node, &exit_state);
   }
 
+  /*
+   * With RetainedStates::Entry, the exit state of each of the given nodes is
+   * released once its successors have all been analyzed. The nodes and their
+   * successors must only be analyzed once during the iteration.
+   */
+  template <typename Nodes>
+  void release_exit_states_once_consumed(const Nodes& nodes) {
+    for (const NodeId& node : nodes) {
+      uint32_t num_reads = 0;
+      for (const auto& edge : GraphInterface::successors(m_graph, node)) {
+        (void)edge;
+        ++num_reads;
+      }
+      if (num_reads > 0) {
+        m_pending_exit_reads.emplace(node, num_reads);
+      }
+    }
+  }
+
+  // Called at the end of a run.
+  void release_exit_states() {
+    if (m_retained_states == RetainedStates::Entry) {
+      m_exit_states.clear();
+      m_pending_exit_reads.clear();
+    }
+  }
+
+ private:
+  const Domain& exit_state_or_bottom(const NodeId& node) const {
+    auto it = m_exit_states.find(node);
+    // It's impossible to get rid of this condition by initializing all exit
+    // states to _|_ prior to starting the fixpoint iteration. The reason is
+    // that we only have a partial view of the control-flow graph, i.e., all
+    // nodes that are reachable from the root. We may have control-flow graphs
+    // with unreachable nodes pointing to reachable ones, as follows:
+    //
+    //               root
+    //           U    |
+    //           |    V
+    //           +--> A
+    //
+    // When computing the entry state of A, we perform the join of the exit
+    // states of all its predecessors, which include U. Since U is invisible to
+    // the fixpoint iterator, there is no way to initialize its exit state.
+    return (it == m_exit_states.end()) ? m_bottom_state : it->second;
+  }
+
+  const Domain& recompute_exit_state_at(const NodeId& node) const {
+    auto it = m_exit_states.find(node);
+    if (it != m_exit_states.end()) {
+      return it->second;
+    }
+    auto entry_it = m_entry_states.find(node);
+    if (entry_it == m_entry_states.end()) {
+      return m_bottom_state;
+    }
+    Domain& exit_state =
+        m_exit_states.emplace(node, entry_it->second).first->second;
+    this->analyze_node(node, &exit_state);
+    return exit_state;
+  }
+
+  void release_consumed_exit_states(const NodeId& node) {
+    for (EdgeId edge : GraphInterface::predecessors(m_graph, node)) {
+      auto source = GraphInterface::source(m_graph, edge);
+      auto it = m_pending_exit_reads.find(source);
+      if (it != m_pending_exit_reads.end() && --it->second == 0) {
+        m_exit_states.erase(it->first);
+        m_pending_exit_reads.erase(it);
+      }
+    }
+  }
+
+  // Drops all the states once the step budget is exhausted, as they are
+  // answered with top from then on.
+  void give_up() {
+    m_step_budget_exceeded = true;
+    m_entry_states.clear();
+    m_exit_states.clear();
+    m_pending_exit_reads.clear();
+  }
+
+  RetainedStates m_retained_states = RetainedStates::All;
+  std::unordered_map<NodeId, uint32_t, NodeHash> m_pending_exit_reads;
+  uint64_t m_step_budget{0};
+  uint64_t m_steps{0};
+  bool m_step_budget_exceeded{false};
+
+ public:
   const Graph& m_graph;
   const Domain m_bottom_state = Domain::bottom();
+  const Domain m_top_state = Domain::top();
   std::unordered_map<NodeId, Domain, NodeHash> m_entry_states;
-  std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
+  mutable std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
 };
 
 template <typename GraphInterface, typename NodeHash>
@@ -306,7 +442,11 @@ class WTOMonotonicFixpointIterator
     Context context(init);
     for (const WtoComponent<NodeId>& component : m_wto) {
       analyze_component(&context, component);
+      if (this->has_exceeded_step_budget()) {
+        return;
+      }
     }
+    this->release_exit_states();
   }
 
  private:
@@ -328,6 +468,9 @@ class WTOMonotonicFixpointIterator
       for (const auto& component : scc) {
         analyze_component(context, component);
       }
+      if (this->has_exceeded_step_budget()) {
+        return;
+      }
       // The current state of the iteration is represented by a pointer to the
       // slot associated with the head node in the hash table of entry states.
       // The state is updated in place within the hash table via side effects,
@@ -456,6 +599,8 @@ class ParallelMonotonicFixpointIterator
    * initial conditions.
    */
   void run(const Domain& init) {
+    // Nodes are analyzed concurrently, so steps are not counted.
+    assert(this->get_step_budget() == 0);
     this->set_all_to_bottom();
     Context context(init, m_all_nodes);
     std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
@@ -574,16 +719,32 @@ class MonotonicFixpointIterator
   using EdgeId = typename GraphInterface::EdgeId;
   using Context =
       fp_impl::MonotonicFixpointIteratorContext<NodeId, Domain, NodeHash>;
+  using WPO =
+      WeakPartialOrdering<NodeId, NodeHash, /*Support_is_from_outside=*/false>;
 
   explicit MonotonicFixpointIterator(const Graph& graph,
                                      size_t cfg_size_hint = 4)
+      : MonotonicFixpointIterator(graph, make_wpo(graph), cfg_size_hint) {}
+
+  /*
+   * The weak partial ordering only depends on the structure of the graph, so
+   * it can be computed once with make_wpo() and shared by all the fixpoint
+   * iterators running over the same, unchanged graph.
+   */
+  MonotonicFixpointIterator(const Graph& graph,
+                            std::shared_ptr<const WPO> wpo,
+                            size_t cfg_size_hint = 4)
       : fp_impl::MonotonicFixpointIteratorBase<GraphInterface,
                                                Domain,
                                                NodeHash>(graph, cfg_size_hint),
-        m_wpo(
-            GraphInterface::entry(graph),
-            fp_impl::SuccessorNodeListBuilder<GraphInterface, NodeHash>(graph),
-            false) {}
+        m_wpo(std::move(wpo)) {}
+
+  static std::shared_ptr<const WPO> make_wpo(const Graph& graph) {
+    return std::make_shared<const WPO>(
+        GraphInterface::entry(graph),
+        fp_impl::SuccessorNodeListBuilder<GraphInterface, NodeHash>(graph),
+        false);
+  }
 
   /*
    * Executes the fixpoint iterator given an abstract value describing the
@@ -593,89 +754,179 @@ class MonotonicFixpointIterator
    */
   void run(const Domain& init) {
     this->clear();
+    if (m_num_threads > 1 && this->get_step_budget() == 0) {
+      run_in_parallel(init);
+      return;
+    }
+    if (this->get_retained_states() == RetainedStates::Entry) {
+      release_acyclic_exit_states_once_consumed();
+    }
     Context context(init);
     std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
-        new std::atomic<uint32_t>[m_wpo.size()]);
-    std::fill_n(wpo_counter.get(), m_wpo.size(), 0);
+        new std::atomic<uint32_t>[m_wpo->size()]);
+    std::fill_n(wpo_counter.get(), m_wpo->size(), 0);
     std::queue<uint32_t> work_queue;
-    auto entry_idx = m_wpo.get_entry();
-    assert(m_wpo.get_num_preds(entry_idx) == 0);
-    // Prepare work queue.
-    auto process_node = [&](uint32_t wpo_idx) {
-      assert(wpo_counter[wpo_idx] == m_wpo.get_num_preds(wpo_idx));
-      wpo_counter[wpo_idx] = 0;
-      // NonExit node
-      if (!m_wpo.is_exit(wpo_idx)) {
-        this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
-        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-          // Increase succ node's counter, push succ nodes in work queue if
-          // their counter number matches their NumSchedPreds.
-          if (++wpo_counter[succ_idx] == m_wpo.get_num_preds(succ_idx)) {
-            work_queue.emplace(succ_idx);
-          }
-        }
-        return nullptr;
-      }
-      // Exit node
-      // Check if component of the exit node has stabilized.
-      uint32_t head_idx = m_wpo.get_head_of_exit(wpo_idx);
-      NodeId head = m_wpo.get_node(head_idx);
-      Domain* current_state = &this->m_entry_states[head];
-      Domain new_state = Domain::bottom();
-      this->compute_entry_state(&context, head, &new_state);
-      if (new_state.leq(*current_state)) {
-        // Component stabilized.
-        context.reset_local_iteration_count_for(head);
-        *current_state = std::move(new_state);
-        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-          // Increase succ node's counter, push succ nodes in work queue if
-          // their counter number matches their NumSchedPreds.
-          if (++wpo_counter[succ_idx] == m_wpo.get_num_preds(succ_idx)) {
-            work_queue.emplace(succ_idx);
-          }
-        }
-      } else {
-        // Component didn't stabilize.
-        this->extrapolate(context, head, current_state, new_state);
-        context.increase_iteration_count_for(head);
-        // Set component nodes v's counter to their
-        // NumOuterSchedPreds(v, wpo_idx)
-        for (auto pred_pair : m_wpo.get_num_outer_preds(wpo_idx)) {
-          auto component_idx = pred_pair.first;
-          assert(component_idx != entry_idx);
-          // Push component nodes in work queue if their counter number
-          // matches their NumSchedPreds.
-          if ((wpo_counter[component_idx] += pred_pair.second) ==
-              m_wpo.get_num_preds(component_idx)) {
-            work_queue.emplace(component_idx);
-          }
-        }
-        if (head_idx == entry_idx) {
-          // Handle special case when there is a loop on entry node.
-          // Because entry node have num_preds = 0, and for
-          // get_num_outer_preds the nodes with num_outer_preds are ignored.
-          // So we need to manually add entry node back to work queue if
-          // the component didn't stabilize.
-          work_queue.emplace(head_idx);
-        }
-      }
-      return nullptr;
+    auto push = [&work_queue](uint32_t wpo_idx) {
+      work_queue.emplace(wpo_idx);
     };
     // Start from wpo entry node.
-    work_queue.emplace(entry_idx);
+    work_queue.emplace(m_wpo->get_entry());
     while (!work_queue.empty()) {
       auto item = work_queue.front();
       work_queue.pop();
-      process_node(item);
+      process_wpo_node(&context, wpo_counter.get(), item, push);
+      if (this->has_exceeded_step_budget()) {
+        return;
+      }
     }
-    for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
+    for (uint32_t idx = 0; idx < m_wpo->size(); ++idx) {
       assert(wpo_counter[idx] == 0);
     }
+    this->release_exit_states();
   }
 
+  /*
+   * With more than one thread, run() schedules the nodes concurrently, like
+   * the ParallelMonotonicFixpointIterator, which computes the same result.
+   * This requires analyze_node and analyze_edge to be safe to call
+   * concurrently. Step budgets are not supported in this mode, and make run()
+   * iterate sequentially. With RetainedStates::Entry, the exit states are only
+   * released at the end of the run.
+   */
+  void set_num_threads(size_t num_threads) { m_num_threads = num_threads; }
+
  private:
-  WeakPartialOrdering<NodeId, NodeHash, /*Support_is_from_outside=*/false>
-      m_wpo;
+  // Analyzes a node of the WPO, or checks whether the component of a WPO exit
+  // has stabilized, and calls push on the WPO nodes that became ready.
+  template <typename Push>
+  void process_wpo_node(Context* context,
+                        std::atomic<uint32_t>* wpo_counter,
+                        uint32_t wpo_idx,
+                        Push&& push) {
+    std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
+    assert(current_counter == m_wpo->get_num_preds(wpo_idx));
+    current_counter = 0;
+    // NonExit node
+    if (!m_wpo->is_exit(wpo_idx)) {
+      this->analyze_vertex(context, m_wpo->get_node(wpo_idx));
+      for (auto succ_idx : m_wpo->get_successors(wpo_idx)) {
+        // Increase succ node's counter, push succ nodes in work queue if
+        // their counter number matches their NumSchedPreds.
+        if (++wpo_counter[succ_idx] == m_wpo->get_num_preds(succ_idx)) {
+          push(succ_idx);
+        }
+      }
+      return;
+    }
+    // Exit node
+    // Check if component of the exit node has stabilized.
+    uint32_t head_idx = m_wpo->get_head_of_exit(wpo_idx);
+    NodeId head = m_wpo->get_node(head_idx);
+    Domain* current_state = &this->m_entry_states[head];
+    Domain new_state = Domain::bottom();
+    this->compute_entry_state(context, head, &new_state);
+    if (new_state.leq(*current_state)) {
+      // Component stabilized.
+      context->reset_local_iteration_count_for(head);
+      *current_state = std::move(new_state);
+      for (auto succ_idx : m_wpo->get_successors(wpo_idx)) {
+        // Increase succ node's counter, push succ nodes in work queue if
+        // their counter number matches their NumSchedPreds.
+        if (++wpo_counter[succ_idx] == m_wpo->get_num_preds(succ_idx)) {
+          push(succ_idx);
+        }
+      }
+    } else {
+      // Component didn't stabilize.
+      this->extrapolate(*context, head, current_state, new_state);
+      context->increase_iteration_count_for(head);
+      // Set component nodes v's counter to their
+      // NumOuterSchedPreds(v, wpo_idx)
+      for (auto pred_pair : m_wpo->get_num_outer_preds(wpo_idx)) {
+        auto component_idx = pred_pair.first;
+        assert(component_idx != m_wpo->get_entry());
+        // Push component nodes in work queue if their counter number
+        // matches their NumSchedPreds. Like in the
+        // ParallelMonotonicFixpointIterator, the counters are updated
+        // point-wise, so the number of outer predecessors is added.
+        if ((wpo_counter[component_idx] += pred_pair.second) ==
+            m_wpo->get_num_preds(component_idx)) {
+          push(component_idx);
+        }
+      }
+      if (head_idx == m_wpo->get_entry()) {
+        // Handle special case when there is a loop on entry node.
+        // Because entry node have num_preds = 0, and for
+        // get_num_outer_preds the nodes with num_outer_preds are ignored.
+        // So we need to manually add entry node back to work queue if
+        // the component didn't stabilize.
+        push(head_idx);
+      }
+    }
+  }
+
+  void run_in_parallel(const Domain& init) {
+    // Workers only look up states and iteration counts, so the tables are
+    // populated for all nodes beforehand.
+    std::unordered_set<NodeId, NodeHash> nodes;
+    for (uint32_t idx = 0; idx < m_wpo->size(); ++idx) {
+      if (!m_wpo->is_exit(idx)) {
+        nodes.insert(m_wpo->get_node(idx));
+      }
+    }
+    this->m_entry_states.reserve(nodes.size());
+    this->m_exit_states.reserve(nodes.size());
+    for (const auto& node : nodes) {
+      this->m_entry_states.emplace(node, Domain::bottom());
+      this->m_exit_states.emplace(node, Domain::bottom());
+    }
+    Context context(init, nodes);
+    std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
+        new std::atomic<uint32_t>[m_wpo->size()]);
+    std::fill_n(wpo_counter.get(), m_wpo->size(), 0);
+    auto wq = sparta::work_queue<uint32_t>(
+        [&](WorkerState<uint32_t>* worker_state, uint32_t wpo_idx) {
+          process_wpo_node(&context, wpo_counter.get(), wpo_idx,
+                           [worker_state](uint32_t succ_idx) {
+                             worker_state->push_task(succ_idx);
+                           });
+          return nullptr;
+        },
+        m_num_threads,
+        /*push_tasks_while_running=*/true);
+    wq.add_item(m_wpo->get_entry());
+    wq.run_all();
+    for (uint32_t idx = 0; idx < m_wpo->size(); ++idx) {
+      assert(wpo_counter[idx] == 0);
+    }
+    this->release_exit_states();
+  }
+
+  // Plain nodes outside of any component are analyzed exactly once, so their
+  // exit states are dead once all their successors have been analyzed, as
+  // long as those are analyzed only once as well.
+  void release_acyclic_exit_states_once_consumed() {
+    std::unordered_set<NodeId, NodeHash> acyclic_nodes;
+    for (auto idx : m_wpo->get_toplevel()) {
+      if (m_wpo->is_plain(idx)) {
+        acyclic_nodes.insert(m_wpo->get_node(idx));
+      }
+    }
+    std::vector<NodeId> nodes;
+    for (const auto& node : acyclic_nodes) {
+      const auto& succ_edges = GraphInterface::successors(this->m_graph, node);
+      if (std::all_of(succ_edges.begin(), succ_edges.end(), [&](auto edge) {
+            return acyclic_nodes.count(
+                       GraphInterface::target(this->m_graph, edge)) != 0;
+          })) {
+        nodes.push_back(node);
+      }
+    }
+    this->release_exit_states_once_consumed(nodes);
+  }
+
+  std::shared_ptr<const WPO> m_wpo;
+  size_t m_num_threads{1};
 };
 
 /*
@@ -7,15 +7,19 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <mutex>
 #include <stack>
 #include <tuple>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/functional/hash.hpp>
 #include <boost/intrusive_ptr.hpp>
@@ -99,6 +103,33 @@ class PatriciaTreeLeaf;
 template <typename IntegerType, typename Value>
 class PatriciaTreeBranch;
 
+template <typename IntegerType, typename Value>
+class PatriciaTreeHashConsTable;
+
+/*
+ * When hash-consing is enabled, structurally equal nodes share a single
+ * allocation: each node is looked up in a global table before being created.
+ * Equal subtrees of different trees are then always physically shared, which
+ * reduces memory usage, and lets all operations short-circuit on pointer
+ * equality. This comes at the cost of a table lookup for each node creation.
+ *
+ * Leaves are identified by their key and their value (as per Value::equals),
+ * and branches by their prefix, branching bit and children. As a result, only
+ * nodes created while hash-consing is enabled are shared; enabling it midway
+ * is safe, but won't retroactively share nodes that have been created before.
+ * A Value may define `static size_t hash(const type&)` to avoid hash
+ * collisions between leaves with the same key.
+ */
+inline std::atomic<bool> s_hash_consing_enabled{false};
+
+inline void set_hash_consing_enabled(bool enabled) {
+  s_hash_consing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+inline bool is_hash_consing_enabled() {
+  return s_hash_consing_enabled.load(std::memory_order_relaxed);
+}
+
 /*
  * Base node common to branches and leafs.
  */
@@ -121,6 +152,12 @@ class PatriciaTreeNode {
 
   bool is_branch() const { return !is_leaf(); }
 
+  // Whether this node is registered in the hash-consing table.
+  bool is_hash_consed() const {
+    return m_reference_count.load(std::memory_order_relaxed) &
+           HASH_CONSED_MASK;
+  }
+
   // Returns nullptr if this node is not a leaf.
   const LeafType* as_leaf() const {
     return is_leaf() ? static_cast<const LeafType*>(this) : nullptr;
@@ -155,6 +192,26 @@ class PatriciaTreeNode {
   explicit PatriciaTreeNode(bool is_leaf)
       : m_reference_count((is_leaf ? LEAF_MASK : 0) + 1) {}
 
+  // Must be called before the node is published.
+  void mark_hash_consed() {
+    m_reference_count.fetch_or(HASH_CONSED_MASK, std::memory_order_relaxed);
+  }
+
+  // Acquires a reference unless the node is already being released. Used by
+  // the hash-consing table, where dying nodes remain visible until they are
+  // unregistered.
+  bool try_add_ref() const {
+    size_t reference_count =
+        m_reference_count.load(std::memory_order_relaxed);
+    do {
+      if ((reference_count & ~FLAGS_MASK) == 0) {
+        return false;
+      }
+    } while (!m_reference_count.compare_exchange_weak(
+        reference_count, reference_count + 1, std::memory_order_relaxed));
+    return true;
+  }
+
  private:
   friend void intrusive_ptr_add_ref(const PatriciaTreeNode* p) {
     p->m_reference_count.fetch_add(1, std::memory_order_relaxed);
@@ -180,6 +237,9 @@ class PatriciaTreeNode {
     const bool is_leaf = reference_count & LEAF_MASK;
 
     std::atomic_thread_fence(std::memory_order_acquire);
+    if (reference_count & HASH_CONSED_MASK) {
+      PatriciaTreeHashConsTable<IntegerType, Value>::unregister(p);
+    }
     if (is_leaf) {
       intrusive_ptr_delete_leaf(p);
     } else {
@@ -190,16 +250,21 @@ class PatriciaTreeNode {
   friend void intrusive_ptr_release(const PatriciaTreeNode* p) {
     size_t prev_reference_count =
         p->m_reference_count.fetch_sub(1, std::memory_order_release);
-    const bool is_unique = (prev_reference_count & ~LEAF_MASK) == 1;
+    const bool is_unique = (prev_reference_count & ~FLAGS_MASK) == 1;
     if (is_unique) {
       intrusive_ptr_delete(p);
     }
   }
 
   // We are stealing the highest bit of our reference counter to indicate
-  // whether this tree is a leaf (or, otherwise, branch).
+  // whether this tree is a leaf (or, otherwise, branch), and the next one to
+  // indicate whether it is hash-consed.
   static constexpr size_t LEAF_MASK = ~(static_cast<size_t>(-1) >> 1);
+  static constexpr size_t HASH_CONSED_MASK = LEAF_MASK >> 1;
+  static constexpr size_t FLAGS_MASK = LEAF_MASK | HASH_CONSED_MASK;
   mutable std::atomic<size_t> m_reference_count;
+
+  friend class PatriciaTreeHashConsTable<IntegerType, Value>;
 };
 
 /*
@@ -267,6 +332,13 @@ class PatriciaTreeLeaf final : public PatriciaTreeNode<IntegerType, Value>,
 
   static inline boost::intrusive_ptr<PatriciaTreeLeaf> make(IntegerType key,
                                                             ValueType value) {
+    if (is_hash_consing_enabled()) {
+      using Table = PatriciaTreeHashConsTable<IntegerType, Value>;
+      const PatriciaTreeLeaf probe(key, value);
+      return Table::get_or_create(probe, [&]() {
+        return new PatriciaTreeLeaf(key, std::move(value));
+      });
+    }
     return boost::intrusive_ptr<PatriciaTreeLeaf>(
         new PatriciaTreeLeaf(key, std::move(value)), /* add_ref */ false);
   }
@@ -350,6 +422,18 @@ class PatriciaTreeBranch final
       IntegerType branching_bit,
       boost::intrusive_ptr<Base> left_tree,
       boost::intrusive_ptr<Base> right_tree) {
+    // A branch can only be shared if its children are.
+    if (is_hash_consing_enabled() && left_tree->is_hash_consed() &&
+        right_tree->is_hash_consed()) {
+      using Table = PatriciaTreeHashConsTable<IntegerType, Value>;
+      const PatriciaTreeBranch probe(prefix, branching_bit, left_tree,
+                                     right_tree);
+      return Table::get_or_create(probe, [&]() {
+        return new PatriciaTreeBranch(prefix, branching_bit,
+                                      std::move(left_tree),
+                                      std::move(right_tree));
+      });
+    }
     return boost::intrusive_ptr<PatriciaTreeBranch>(
         new PatriciaTreeBranch(
             prefix, branching_bit, std::move(left_tree), std::move(right_tree)),
@@ -361,6 +445,134 @@ class PatriciaTreeBranch final
   boost::intrusive_ptr<Base> m_left_tree, m_right_tree;
 };
 
+namespace hash_consing_impl {
+
+template <typename Value, typename = void>
+struct HasValueHash : std::false_type {};
+
+template <typename Value>
+struct HasValueHash<Value,
+                    std::void_t<decltype(Value::hash(
+                        std::declval<const typename Value::type&>()))>>
+    : std::true_type {};
+
+} // namespace hash_consing_impl
+
+/*
+ * The global table of hash-consed nodes, for a given key and value type.
+ *
+ * A node stays registered until its reference count drops to zero. A node
+ * that is being released may thus still be found by a lookup, in which case
+ * it is superseded by a new node; the releasing thread only unregisters the
+ * node if it hasn't been superseded.
+ */
+template <typename IntegerType, typename Value>
+class PatriciaTreeHashConsTable final {
+  using NodeType = PatriciaTreeNode<IntegerType, Value>;
+  using LeafType = PatriciaTreeLeaf<IntegerType, Value>;
+  using BranchType = PatriciaTreeBranch<IntegerType, Value>;
+
+ public:
+  // Returns the registered node that is equal to the given probe, or else
+  // registers the node returned by `create`.
+  template <typename Node, typename CreateFn>
+  static boost::intrusive_ptr<Node> get_or_create(const Node& probe,
+                                                  const CreateFn& create) {
+    auto& shard = instance().get_shard(probe);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(&probe);
+    if (it != shard.nodes.end()) {
+      if ((*it)->try_add_ref()) {
+        return boost::intrusive_ptr<Node>(
+            const_cast<Node*>(static_cast<const Node*>(*it)),
+            /* add_ref */ false);
+      }
+      shard.nodes.erase(it);
+    }
+    Node* node = create();
+    node->mark_hash_consed();
+    shard.nodes.insert(node);
+    return boost::intrusive_ptr<Node>(node, /* add_ref */ false);
+  }
+
+  static void unregister(const NodeType* node) {
+    auto& shard = instance().get_shard(*node);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(node);
+    if (it != shard.nodes.end() && *it == node) {
+      shard.nodes.erase(it);
+    }
+  }
+
+  // The number of registered nodes, including the ones being released.
+  static size_t size() {
+    size_t size = 0;
+    for (auto& shard : instance().m_shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      size += shard.nodes.size();
+    }
+    return size;
+  }
+
+ private:
+  struct NodeHash {
+    size_t operator()(const NodeType* node) const {
+      size_t seed = 0;
+      if (const auto* leaf = node->as_leaf()) {
+        boost::hash_combine(seed, leaf->key());
+        if constexpr (hash_consing_impl::HasValueHash<Value>::value) {
+          boost::hash_combine(seed, Value::hash(leaf->value()));
+        }
+      } else {
+        const auto* branch = node->as_branch();
+        boost::hash_combine(seed, branch->prefix());
+        boost::hash_combine(seed, branch->branching_bit());
+        boost::hash_combine(seed, branch->left_tree().get());
+        boost::hash_combine(seed, branch->right_tree().get());
+      }
+      return seed;
+    }
+  };
+
+  struct NodeEqual {
+    bool operator()(const NodeType* node1, const NodeType* node2) const {
+      const auto* leaf1 = node1->as_leaf();
+      const auto* leaf2 = node2->as_leaf();
+      if (leaf1 && leaf2) {
+        return leaf1->key() == leaf2->key() &&
+               Value::equals(leaf1->value(), leaf2->value());
+      } else if (leaf1 || leaf2) {
+        return false;
+      }
+      const auto* branch1 = node1->as_branch();
+      const auto* branch2 = node2->as_branch();
+      return branch1->prefix() == branch2->prefix() &&
+             branch1->branching_bit() == branch2->branching_bit() &&
+             branch1->left_tree() == branch2->left_tree() &&
+             branch1->right_tree() == branch2->right_tree();
+    }
+  };
+
+  static constexpr size_t kNumShards = 64;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<const NodeType*, NodeHash, NodeEqual> nodes;
+  };
+
+  Shard& get_shard(const NodeType& node) {
+    return m_shards[NodeHash()(&node) % kNumShards];
+  }
+
+  static PatriciaTreeHashConsTable& instance() {
+    // Leaked on purpose, as trees may be released during static destruction.
+    static auto* table = new PatriciaTreeHashConsTable();
+    return *table;
+  }
+
+  Shard m_shards[kNumShards];
+};
+
 // Advances over each leaf in the tree in post-order.
 //
 // This is the central core that iterators use to iterate,
@@ -699,6 +911,9 @@ inline bool is_tree_equal(
     return true;
   } else if (tree1 == nullptr || tree2 == nullptr) {
     return false;
+  } else if (tree1->is_hash_consed() && tree2->is_hash_consed()) {
+    // Distinct hash-consed trees are never equal.
+    return false;
   }
   const auto* leaf1 = tree1->as_leaf();
   const auto* leaf2 = tree2->as_leaf();
@@ -1325,6 +1540,71 @@ inline intrusive_ptr<PatriciaTreeNode<IntegerType, Value>> erase_keys_matching(
   }
 }
 
+// The order in which keys appear in the leafs of a tree, from left to right.
+// Since branching is on the lowest differing bit, this is the numeric order of
+// the bit-reversed keys.
+template <typename IntegerType>
+inline bool is_before_in_tree_order(IntegerType key0, IntegerType key1) {
+  return key0 != key1 && is_zero_bit(key0, get_branching_bit(key0, key1));
+}
+
+// Builds a tree holding the given leafs, which may come in any order. If
+// several leafs have the same key, the last one is kept. Once the leafs are
+// sorted, which is skipped if they already are in tree order, the tree is
+// built bottom-up in linear time, allocating each branch exactly once.
+//
+// The branching bits between consecutive leafs determine the shape of the
+// tree: it is their Cartesian tree, with the lowest bit at the root. It is
+// built in a single pass, by keeping its right spine on a stack.
+template <typename IntegerType, typename Value>
+inline intrusive_ptr<PatriciaTreeNode<IntegerType, Value>> build_tree(
+    std::vector<intrusive_ptr<PatriciaTreeLeaf<IntegerType, Value>>> leafs) {
+  const auto compare = [](const auto& leaf0, const auto& leaf1) {
+    return is_before_in_tree_order(leaf0->key(), leaf1->key());
+  };
+  if (!std::is_sorted(leafs.begin(), leafs.end(), compare)) {
+    std::stable_sort(leafs.begin(), leafs.end(), compare);
+  }
+
+  struct SpineEntry {
+    IntegerType key; // Any key in the tree.
+    intrusive_ptr<PatriciaTreeNode<IntegerType, Value>> tree;
+    // The branching bit from the previous entry, or zero for the first one.
+    IntegerType branching_bit;
+  };
+  std::vector<SpineEntry> spine;
+  const auto join_last_two = [&spine]() {
+    auto right = std::move(spine.back());
+    spine.pop_back();
+    auto& left = spine.back();
+    left.tree = join_trees(left.key, std::move(left.tree), right.key,
+                           std::move(right.tree));
+  };
+  for (size_t i = 0; i < leafs.size(); ++i) {
+    auto key = leafs[i]->key();
+    if (i + 1 < leafs.size() && leafs[i + 1]->key() == key) {
+      continue;
+    }
+    if (spine.empty()) {
+      spine.push_back({key, std::move(leafs[i]), 0});
+      continue;
+    }
+    auto branching_bit = get_branching_bit(spine.back().key, key);
+    // Subtrees that branch on higher bits belong below the new branch.
+    while (spine.back().branching_bit > branching_bit) {
+      join_last_two();
+    }
+    spine.push_back({key, std::move(leafs[i]), branching_bit});
+  }
+  if (spine.empty()) {
+    return nullptr;
+  }
+  while (spine.size() > 1) {
+    join_last_two();
+  }
+  return std::move(spine.back().tree);
+}
+
 template <typename Key, typename Value>
 class PatriciaTreeCore {
  public:
@@ -1332,6 +1612,7 @@ class PatriciaTreeCore {
   using IntegerType = typename Codec::IntegerType;
   using ValueType = typename Value::type;
   using IteratorType = PatriciaTreeIterator<Key, Value>;
+  using LeafType = PatriciaTreeLeaf<IntegerType, Value>;
 
   static_assert(std::is_same_v<decltype(Value::default_value()), ValueType>,
                 "Value::default_value() does not exist");
@@ -1350,6 +1631,16 @@ class PatriciaTreeCore {
 
   inline bool empty() const { return m_tree == nullptr; }
 
+  static inline boost::intrusive_ptr<LeafType> make_leaf(Key key,
+                                                          ValueType value) {
+    return LeafType::make(Codec::encode(key), std::move(value));
+  }
+
+  // Replaces the contents of the tree with the given leafs, see `build_tree`.
+  inline void assign(std::vector<boost::intrusive_ptr<LeafType>> leafs) {
+    m_tree = pt_core::build_tree(std::move(leafs));
+  }
+
   inline size_t size() const {
     size_t s = 0;
     std::for_each(begin(), end(), [&s](const auto&) { ++s; });
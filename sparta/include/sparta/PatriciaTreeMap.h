@@ -13,6 +13,7 @@
 #include <ostream>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -102,6 +103,23 @@ class PatriciaTreeMap final
   constexpr static AbstractMapMutability mutability =
       AbstractMapMutability::Immutable;
 
+  PatriciaTreeMap() = default;
+
+  // The tree is built bottom-up from all the bindings at once, which is much
+  // cheaper than inserting them one by one. Later bindings of a key override
+  // earlier ones.
+  template <typename InputIterator> // over std::pair<Key, mapped_type>
+  PatriciaTreeMap(InputIterator first, InputIterator last) {
+    bool has_default_value = false;
+    m_core.assign(make_leafs(first, last, &has_default_value));
+    if (has_default_value) {
+      // A default value still overrides earlier bindings of its key.
+      m_core.filter([](const Key&, const mapped_type& value) {
+        return !ValueInterface::is_default_value(value);
+      });
+    }
+  }
+
   bool empty() const { return m_core.empty(); }
 
   size_t size() const { return m_core.size(); }
@@ -152,6 +170,33 @@ class PatriciaTreeMap final
     return *this;
   }
 
+  /*
+   * Batched version of `insert_or_assign`, with the same semantics as calling
+   * it on each binding in order. A tree is built from the bindings at once,
+   * which then replaces the existing bindings of their keys in a traversal
+   * shared with this map.
+   */
+  template <typename InputIterator> // over std::pair<Key, mapped_type>
+  PatriciaTreeMap& insert_or_assign_all(InputIterator first,
+                                        InputIterator last) {
+    bool has_default_value = false;
+    auto leafs = make_leafs(first, last, &has_default_value);
+    Core batch;
+    batch.assign(leafs);
+    m_core.diff([](const auto&...) { return nullptr; }, batch);
+    // Only keep the last binding of each key, the ones the batch tree holds.
+    leafs.clear();
+    batch.visit_all_leafs([&](const auto& binding) {
+      if (!ValueInterface::is_default_value(binding.second)) {
+        leafs.push_back(Core::make_leaf(binding.first, binding.second));
+      }
+    });
+    batch.assign(std::move(leafs));
+    m_core.merge(pt_core::use_available_leaf<IntegerType, ValueInterface>,
+                 batch);
+    return *this;
+  }
+
   template <typename Operation> // mapped_type(const mapped_type&)
   PatriciaTreeMap& update(Operation&& operation, Key key) {
     m_core.update(apply_leafs(std::forward<Operation>(operation)), key);
@@ -248,6 +293,17 @@ class PatriciaTreeMap final
     };
   }
 
+  template <typename InputIterator>
+  static std::vector<boost::intrusive_ptr<typename Core::LeafType>> make_leafs(
+      InputIterator first, InputIterator last, bool* has_default_value) {
+    std::vector<boost::intrusive_ptr<typename Core::LeafType>> leafs;
+    for (auto it = first; it != last; ++it) {
+      *has_default_value |= ValueInterface::is_default_value(it->second);
+      leafs.push_back(Core::make_leaf(it->first, it->second));
+    }
+    return leafs;
+  }
+
   inline static boost::optional<mapped_type> keep_if_non_default(
       mapped_type value) {
     if (ValueInterface::is_default_value(value)) {
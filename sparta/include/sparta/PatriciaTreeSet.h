@@ -14,6 +14,7 @@
 #include <ostream>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <sparta/AbstractSet.h>
 #include <sparta/Exceptions.h>
@@ -70,18 +71,14 @@ class PatriciaTreeSet final : public AbstractSet<PatriciaTreeSet<Element>> {
 
   explicit PatriciaTreeSet(Element e) { insert(std::move(e)); }
 
-  explicit PatriciaTreeSet(std::initializer_list<Element> l) {
-    for (Element x : l) {
-      insert(x);
-    }
-  }
+  explicit PatriciaTreeSet(std::initializer_list<Element> l)
+      : m_core(make_core(l.begin(), l.end())) {}
 
+  // The tree is built bottom-up from all the elements at once, which is much
+  // cheaper than inserting them one by one.
   template <typename InputIterator>
-  PatriciaTreeSet(InputIterator first, InputIterator last) {
-    for (auto it = first; it != last; ++it) {
-      insert(*it);
-    }
-  }
+  PatriciaTreeSet(InputIterator first, InputIterator last)
+      : m_core(make_core(first, last)) {}
 
   bool empty() const { return m_core.empty(); }
 
@@ -135,6 +132,23 @@ class PatriciaTreeSet final : public AbstractSet<PatriciaTreeSet<Element>> {
     return *this;
   }
 
+  /*
+   * Batched versions of `insert` and `remove`: a tree is built from the
+   * elements at once, and then combined with this set in a single traversal.
+   */
+  template <typename InputIterator>
+  PatriciaTreeSet& insert_all(InputIterator first, InputIterator last) {
+    m_core.merge(pt_core::use_available_leaf<IntegerType, Empty>,
+                 make_core(first, last));
+    return *this;
+  }
+
+  template <typename InputIterator>
+  PatriciaTreeSet& remove_all(InputIterator first, InputIterator last) {
+    m_core.diff([](const auto&...) { return nullptr; }, make_core(first, last));
+    return *this;
+  }
+
   /*
    * If the set is a singleton, returns a pointer to the element.
    * Otherwise, returns nullptr.
@@ -200,6 +214,17 @@ class PatriciaTreeSet final : public AbstractSet<PatriciaTreeSet<Element>> {
   }
 
  private:
+  template <typename InputIterator>
+  static Core make_core(InputIterator first, InputIterator last) {
+    std::vector<boost::intrusive_ptr<typename Core::LeafType>> leafs;
+    for (auto it = first; it != last; ++it) {
+      leafs.push_back(Core::make_leaf(*it, Empty{}));
+    }
+    Core core;
+    core.assign(std::move(leafs));
+    return core;
+  }
+
   Core m_core;
 };
 
@@ -196,8 +196,11 @@ class WeakPartialOrdering final {
   // Total number of nodes in this wpo.
   uint32_t size() const { return m_nodes.size(); }
 
+  // Nodes that are outside of any component.
+  const std::vector<WpoIdx>& get_toplevel() const { return m_toplevel; }
+
   // Entry node of this wpo.
-  WpoIdx get_entry() { return m_nodes.size() - 1; }
+  WpoIdx get_entry() const { return m_nodes.size() - 1; }
 
   // Successors of the node.
   const std::set<WpoIdx>& get_successors(WpoIdx idx) const {
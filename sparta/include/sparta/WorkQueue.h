@@ -275,6 +275,15 @@ class WorkQueue {
   /* Add an item on the queue of the given worker. */
   void add_item(Input task, size_t worker_id);
 
+  /*
+   * Adds all items, distributed over the workers such that items with a higher
+   * estimated cost get started first. Otherwise, a long-running item is likely
+   * to be picked up late, leaving a single thread busy at the end.
+   * CostFn should accept `const Input&` and return an unsigned integer.
+   */
+  template <typename Items, typename CostFn>
+  void add_items_by_cost(const Items& items, const CostFn& cost);
+
   /**
    * Spawn threads and evaluate function.  This method blocks.
    */
@@ -316,6 +325,29 @@ void WorkQueue<Input, Executor>::add_item(Input task, size_t worker_id) {
   m_states[worker_id]->m_initial_tasks.push_back(std::move(task));
 }
 
+/*
+ * Every worker pops its initial tasks in insertion order, and so do thieves.
+ * Sorting by decreasing cost before dealing out the items round-robin thus
+ * makes all workers start with the most expensive items.
+ */
+template <class Input, typename Executor>
+template <typename Items, typename CostFn>
+void WorkQueue<Input, Executor>::add_items_by_cost(const Items& items,
+                                                   const CostFn& cost) {
+  std::vector<std::pair<uint64_t, Input>> weighted_items;
+  for (const auto& item : items) {
+    Input input(item);
+    auto c = static_cast<uint64_t>(cost(input));
+    weighted_items.emplace_back(c, std::move(input));
+  }
+  std::stable_sort(
+      weighted_items.begin(), weighted_items.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (auto& p : weighted_items) {
+    add_item(std::move(p.second));
+  }
+}
+
 /*
  * Each worker thread pulls from its own queue first, and then once finished
  * looks randomly at other queues to try and steal work.
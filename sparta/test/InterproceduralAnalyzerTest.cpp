@@ -14,9 +14,11 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace language {
 
@@ -595,9 +597,71 @@ struct PurityAnalysisAdaptor : public language::AnalysisAdaptorBase {
 
 using Analysis = sparta::InterproceduralAnalyzer<PurityAnalysisAdaptor>;
 
+class FunctionAnalysisRegistry
+    : public sparta::AbstractFunctionRegistry<language::Function*> {
+ private:
+  mutable std::mutex m_lock;
+  std::unordered_map<language::Function*, Summary> m_summaries;
+  std::unordered_set<language::Function*> m_updated;
+
+  Summary get_unlocked(language::Function* func) const {
+    auto it = m_summaries.find(func);
+    if (it != m_summaries.end()) {
+      return it->second;
+    }
+    Summary top;
+    top.set_to_top();
+    return top;
+  }
+
+ public:
+  bool has_update() const override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return !m_updated.empty();
+  }
+
+  void materialize_update() override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_updated.clear();
+  }
+
+  bool has_update(language::Function* const& func) const override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_updated.count(func) != 0;
+  }
+
+  void materialize_update(language::Function* const& func) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_updated.erase(func);
+  }
+
+  void update(language::Function* func,
+              std::function<Summary(const Summary&)> update) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto old_summary = get_unlocked(func);
+    auto new_summary = update(old_summary);
+    if (!new_summary.equals(old_summary)) {
+      m_summaries[func] = new_summary;
+      m_updated.insert(func);
+    }
+  }
+
+  Summary get(language::Function* func) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return get_unlocked(func);
+  }
+};
+
+struct WavePurityAnalysisAdaptor : public PurityAnalysisAdaptor {
+  using Registry = FunctionAnalysisRegistry;
+};
+
+using WaveAnalysis = sparta::InterproceduralAnalyzer<WavePurityAnalysisAdaptor>;
+
 } // namespace purity_interprocedural
 
-static void test1() {
+template <typename Analysis, typename RunFn>
+static void test1(const RunFn& run) {
   using namespace language;
 
   Function fun1, fun2, fun3, fun4, fun5, fun6, fun7, mainfun;
@@ -651,8 +715,8 @@ static void test1() {
   std::vector<Function*> functions{&fun1, &fun2, &fun3, &fun4,
                                    &fun5, &fun6, &fun7, &mainfun};
   Program prog(std::move(functions), &mainfun);
-  purity_interprocedural::Analysis inter(&prog, 20 /* max iteration */);
-  inter.run();
+  Analysis inter(&prog, 20 /* max iteration */);
+  run(inter);
 
   ASSERT_TRUE(inter.registry.get(&fun1).is_value());
   EXPECT_TRUE(inter.registry.get(&fun1).pure());
@@ -676,4 +740,11 @@ static void test1() {
   EXPECT_TRUE(inter.registry.get(&fun7).is_top());
 }
 
-TEST(AnalyzerTest, test1) { test1(); }
+TEST(AnalyzerTest, test1) {
+  test1<purity_interprocedural::Analysis>([](auto& inter) { inter.run(); });
+}
+
+TEST(AnalyzerTest, test1InWaves) {
+  test1<purity_interprocedural::WaveAnalysis>(
+      [](auto& inter) { inter.run_in_waves(); });
+}
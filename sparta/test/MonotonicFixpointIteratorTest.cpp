@@ -21,6 +21,25 @@
 
 #include <boost/functional/hash.hpp>
 
+namespace {
+
+// The sequential WPO iterator, switched to scheduling nodes concurrently.
+template <typename GraphInterface, typename Domain, typename NodeHash>
+class ThreadedMonotonicFixpointIterator
+    : public sparta::MonotonicFixpointIterator<GraphInterface,
+                                               Domain,
+                                               NodeHash> {
+ public:
+  explicit ThreadedMonotonicFixpointIterator(
+      const typename GraphInterface::Graph& graph)
+      : sparta::MonotonicFixpointIterator<GraphInterface, Domain, NodeHash>(
+            graph) {
+    this->set_num_threads(4);
+  }
+};
+
+} // namespace
+
 namespace liveness {
 
 using namespace sparta;
@@ -299,7 +318,8 @@ class MonotonicFixpointIteratorLivenessTest : public ::testing::Test {
 using LivenessFixpoints = ::testing::Types<
     liveness::FixpointEngine<sparta::WTOMonotonicFixpointIterator>,
     liveness::FixpointEngine<sparta::MonotonicFixpointIterator>,
-    liveness::FixpointEngine<sparta::ParallelMonotonicFixpointIterator>>;
+    liveness::FixpointEngine<sparta::ParallelMonotonicFixpointIterator>,
+    liveness::FixpointEngine<ThreadedMonotonicFixpointIterator>>;
 TYPED_TEST_CASE(MonotonicFixpointIteratorLivenessTest, LivenessFixpoints);
 
 TYPED_TEST(MonotonicFixpointIteratorLivenessTest, program1) {
@@ -759,7 +779,8 @@ class MonotonicFixpointIteratorNumericalTest : public ::testing::Test {};
 using NumericalFixpoints = ::testing::Types<
     numerical::FixpointEngine<sparta::WTOMonotonicFixpointIterator>,
     numerical::FixpointEngine<sparta::MonotonicFixpointIterator>,
-    numerical::FixpointEngine<sparta::ParallelMonotonicFixpointIterator>>;
+    numerical::FixpointEngine<sparta::ParallelMonotonicFixpointIterator>,
+    numerical::FixpointEngine<ThreadedMonotonicFixpointIterator>>;
 TYPED_TEST_CASE(MonotonicFixpointIteratorNumericalTest, NumericalFixpoints);
 
 TYPED_TEST(MonotonicFixpointIteratorNumericalTest, program1) {
@@ -860,3 +881,121 @@ TYPED_TEST(MonotonicFixpointIteratorNumericalTest, program2) {
             IntegerSetAbstractDomain::top());
   EXPECT_EQ(fp.get_exit_state_at(bb3).get(&x), IntegerSetAbstractDomain::top());
 }
+
+TEST(MonotonicFixpointIteratorRetainedStatesTest, entryStatesOnly) {
+  using namespace numerical;
+
+  /*
+   * bb1: x = 1;
+   *      if (...) {
+   * bb2:   y = x + 1;
+   *      } else {
+   * bb3:   y = x + 2;
+   *      }
+   *      while (...) {
+   * bb4:   x = x + 1;
+   *      }
+   * bb5: return
+   */
+  Program program;
+
+  BasicBlock* bb1 = program.create_block();
+  BasicBlock* bb2 = program.create_block();
+  BasicBlock* bb3 = program.create_block();
+  BasicBlock* bb4 = program.create_block();
+  BasicBlock* bb5 = program.create_block();
+
+  std::string x = "x";
+  std::string y = "y";
+
+  bb1->add(std::make_unique<Assignment>(&x, 1));
+  bb1->add_successor(bb2);
+  bb1->add_successor(bb3);
+
+  bb2->add(std::make_unique<Addition>(&y, &x, 1));
+  bb2->add_successor(bb4);
+
+  bb3->add(std::make_unique<Addition>(&y, &x, 2));
+  bb3->add_successor(bb4);
+
+  bb4->add(std::make_unique<Addition>(&x, &x, 1));
+  bb4->add_successor(bb4);
+  bb4->add_successor(bb5);
+
+  program.set_entry(bb1);
+  program.set_exit(bb5);
+
+  using Engine = FixpointEngine<sparta::MonotonicFixpointIterator>;
+  Engine reference_fp(program);
+  reference_fp.run(AbstractEnvironmentT::top());
+
+  Engine fp(program);
+  fp.set_retained_states(sparta::RetainedStates::Entry);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_TRUE(fp.m_exit_states.empty());
+
+  for (auto* bb : {bb1, bb2, bb3, bb4, bb5}) {
+    EXPECT_EQ(fp.get_entry_state_at(bb), reference_fp.get_entry_state_at(bb));
+    EXPECT_EQ(fp.get_exit_state_at(bb), reference_fp.get_exit_state_at(bb));
+  }
+  EXPECT_EQ(fp.get_exit_state_at(bb3).get(&y), IntegerSetAbstractDomain{3});
+}
+
+template <typename FixpointEngine>
+class MonotonicFixpointIteratorStepBudgetTest : public ::testing::Test {};
+
+using SequentialNumericalFixpoints = ::testing::Types<
+    numerical::FixpointEngine<sparta::WTOMonotonicFixpointIterator>,
+    numerical::FixpointEngine<sparta::MonotonicFixpointIterator>>;
+TYPED_TEST_CASE(MonotonicFixpointIteratorStepBudgetTest,
+                SequentialNumericalFixpoints);
+
+TYPED_TEST(MonotonicFixpointIteratorStepBudgetTest, exhaustedBudget) {
+  using namespace numerical;
+
+  /*
+   * bb1: x = 1;
+   *      while (...) {
+   * bb2:   x = x + 1;
+   *      }
+   * bb3: return
+   */
+  Program program;
+
+  BasicBlock* bb1 = program.create_block();
+  BasicBlock* bb2 = program.create_block();
+  BasicBlock* bb3 = program.create_block();
+
+  std::string x = "x";
+
+  bb1->add(std::make_unique<Assignment>(&x, 1));
+  bb1->add_successor(bb2);
+
+  bb2->add(std::make_unique<Addition>(&x, &x, 1));
+  bb2->add_successor(bb2);
+  bb2->add_successor(bb3);
+
+  program.set_entry(bb1);
+  program.set_exit(bb3);
+
+  TypeParam fp(program);
+  // Enough steps to converge: bb1 and bb3 once, and bb2 until widening.
+  fp.set_step_budget(10);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_FALSE(fp.has_exceeded_step_budget());
+  EXPECT_EQ(fp.get_exit_state_at(bb1).get(&x), IntegerSetAbstractDomain{1});
+
+  fp.set_step_budget(2);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_TRUE(fp.has_exceeded_step_budget());
+  for (auto* bb : {bb1, bb2, bb3}) {
+    EXPECT_TRUE(fp.get_entry_state_at(bb).is_top());
+    EXPECT_TRUE(fp.get_exit_state_at(bb).is_top());
+  }
+
+  // The budget applies to every run separately.
+  fp.set_step_budget(10);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_FALSE(fp.has_exceeded_step_budget());
+  EXPECT_EQ(fp.get_exit_state_at(bb1).get(&x), IntegerSetAbstractDomain{1});
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sparta/PatriciaTreeMap.h>
+#include <sparta/PatriciaTreeSet.h>
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace sparta;
+
+using pt_set = PatriciaTreeSet<uint32_t>;
+using pt_map = PatriciaTreeMap<uint32_t, uint32_t>;
+
+namespace {
+
+class PatriciaTreeHashConsingTest : public ::testing::Test {
+ protected:
+  void SetUp() override { pt_core::set_hash_consing_enabled(true); }
+
+  void TearDown() override { pt_core::set_hash_consing_enabled(false); }
+};
+
+size_t num_set_nodes() {
+  return pt_core::PatriciaTreeHashConsTable<uint32_t,
+                                            pt_core::EmptyValue>::size();
+}
+
+} // namespace
+
+TEST_F(PatriciaTreeHashConsingTest, equalSetsAreShared) {
+  pt_set s1;
+  pt_set s2;
+  for (uint32_t i = 0; i < 100; ++i) {
+    s1.insert(i);
+  }
+  for (uint32_t i = 100; i-- > 0;) {
+    s2.insert(i);
+  }
+  EXPECT_TRUE(s1.reference_equals(s2));
+
+  pt_set s3 = s1;
+  s3.remove(42);
+  EXPECT_FALSE(s3.reference_equals(s1));
+  EXPECT_FALSE(s3.equals(s1));
+  s3.insert(42);
+  EXPECT_TRUE(s3.reference_equals(s1));
+
+  pt_set s4;
+  s4.insert(7).insert(92);
+  pt_set s5 = s1;
+  s5.intersection_with(s4);
+  EXPECT_TRUE(s5.reference_equals(s4));
+}
+
+TEST_F(PatriciaTreeHashConsingTest, equalMapsAreShared) {
+  pt_map m1;
+  pt_map m2;
+  for (uint32_t i = 0; i < 100; ++i) {
+    m1.insert_or_assign(i, i % 3 + 1);
+    m2.insert_or_assign(99 - i, (99 - i) % 3 + 1);
+  }
+  EXPECT_TRUE(m1.reference_equals(m2));
+
+  m2.insert_or_assign(5, 10);
+  EXPECT_FALSE(m1.reference_equals(m2));
+  EXPECT_FALSE(m1.equals(m2));
+  m2.insert_or_assign(5, 3);
+  EXPECT_TRUE(m1.reference_equals(m2));
+}
+
+TEST_F(PatriciaTreeHashConsingTest, releasedNodesAreUnregistered) {
+  size_t initial_size = num_set_nodes();
+  {
+    pt_set s;
+    for (uint32_t i = 1000; i < 1010; ++i) {
+      s.insert(i);
+    }
+    // 10 leaves and 9 branches.
+    EXPECT_EQ(initial_size + 19, num_set_nodes());
+  }
+  EXPECT_EQ(initial_size, num_set_nodes());
+}
+
+TEST_F(PatriciaTreeHashConsingTest, unsharedNodesAreStillEqual) {
+  pt_set s1;
+  s1.insert(1).insert(2).insert(3);
+  pt_core::set_hash_consing_enabled(false);
+  pt_set s2;
+  s2.insert(1).insert(2).insert(3);
+  pt_core::set_hash_consing_enabled(true);
+  EXPECT_FALSE(s1.reference_equals(s2));
+  EXPECT_TRUE(s1.equals(s2));
+  EXPECT_TRUE(s2.equals(s1));
+}
+
+TEST_F(PatriciaTreeHashConsingTest, concurrentConstruction) {
+  constexpr size_t kNumThreads = 4;
+  std::vector<pt_set> sets(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&sets, t]() {
+      for (size_t round = 0; round < 100; ++round) {
+        pt_set s;
+        for (uint32_t i = 0; i < 200; ++i) {
+          s.insert((i * 7 + t) % 200);
+        }
+        sets[t] = s;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 1; t < kNumThreads; ++t) {
+    EXPECT_TRUE(sets[0].reference_equals(sets[t]));
+  }
+}
@@ -10,6 +10,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <initializer_list>
+#include <random>
 #include <unordered_map>
 
 #include <boost/concept/assert.hpp>
@@ -259,3 +260,34 @@ TEST(PatriciaTreeMapTest, movableOperators) {
   EXPECT_EQ(p.at(0), 21);
   EXPECT_EQ(p.at(1), 22);
 }
+
+TEST(PatriciaTreeMapTest, bulkOperations) {
+  std::mt19937 generator;
+  std::uniform_int_distribution<uint32_t> key_dist(0, 300);
+  std::uniform_int_distribution<uint32_t> value_dist(0, 3);
+  for (size_t k = 0; k < 20; ++k) {
+    std::vector<std::pair<uint32_t, uint32_t>> bindings;
+    for (size_t i = 0; i < 100 * k; ++i) {
+      bindings.emplace_back(key_dist(generator) << (k % 8),
+                            value_dist(generator));
+    }
+    pt_map expected;
+    for (const auto& [key, value] : bindings) {
+      expected.insert_or_assign(key, value);
+    }
+    pt_map bulk(bindings.begin(), bindings.end());
+    EXPECT_TRUE(bulk.equals(expected));
+    EXPECT_THAT(bulk, ::testing::UnorderedElementsAreArray(expected.begin(),
+                                                           expected.end()));
+
+    std::vector<std::pair<uint32_t, uint32_t>> batch;
+    for (size_t i = 0; i < 50; ++i) {
+      batch.emplace_back(key_dist(generator), value_dist(generator));
+    }
+    for (const auto& [key, value] : batch) {
+      expected.insert_or_assign(key, value);
+    }
+    bulk.insert_or_assign_all(batch.begin(), batch.end());
+    EXPECT_TRUE(bulk.equals(expected));
+  }
+}
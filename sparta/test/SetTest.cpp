@@ -211,6 +211,36 @@ TYPED_TEST(UInt32SetTest, robustness) {
   }
 }
 
+TYPED_TEST(UInt32SetTest, overlappingSets) {
+  // Dense elements, so that unions and differences interleave a lot.
+  std::mt19937 generator;
+  std::uniform_int_distribution<uint32_t> dist(0, 63);
+  for (size_t k = 0; k < 20; ++k) {
+    std::vector<uint32_t> elems1, elems2;
+    for (size_t i = 0; i < 40; ++i) {
+      elems1.push_back(dist(generator));
+      elems2.push_back(dist(generator) / (k % 4 + 1));
+    }
+    TypeParam s1(elems1.begin(), elems1.end());
+    TypeParam s2(elems2.begin(), elems2.end());
+    EXPECT_THAT(s1.get_union_with(s2),
+                ::testing::UnorderedElementsAreArray(get_union(elems1, elems2)))
+        << "s1 = " << s1 << ", s2 = " << s2;
+    EXPECT_THAT(
+        s1.get_difference_with(s2),
+        ::testing::UnorderedElementsAreArray(get_difference(elems1, elems2)))
+        << "s1 = " << s1 << ", s2 = " << s2;
+    EXPECT_THAT(s1.get_intersection_with(s2),
+                ::testing::UnorderedElementsAreArray(
+                    get_intersection(elems1, elems2)))
+        << "s1 = " << s1 << ", s2 = " << s2;
+    std::set<uint32_t> ref1(elems1.begin(), elems1.end());
+    for (uint32_t x = 0; x < 64; ++x) {
+      EXPECT_EQ(s1.contains(x), ref1.count(x) == 1) << x;
+    }
+  }
+}
+
 template <typename Set>
 class StringSetTest : public ::testing::Test {
  protected:
@@ -279,6 +309,45 @@ TYPED_TEST(UInt64SetTest, setOfUnsignedInt64) {
   }
 }
 
+TEST(PatriciaTreeSet, bulkOperations) {
+  using Set = PatriciaTreeSet<uint32_t>;
+  std::mt19937 generator;
+  std::uniform_int_distribution<uint32_t> dist(0, 1000);
+  for (size_t k = 0; k < 20; ++k) {
+    std::vector<uint32_t> elems;
+    for (size_t i = 0; i < 50 * k; ++i) {
+      elems.push_back(dist(generator) << (k % 8));
+    }
+    Set expected;
+    for (auto x : elems) {
+      expected.insert(x);
+    }
+    Set bulk(elems.begin(), elems.end());
+    EXPECT_TRUE(bulk.equals(expected));
+    EXPECT_EQ(bulk.hash(), expected.hash());
+
+    std::sort(elems.begin(), elems.end());
+    EXPECT_TRUE(Set(elems.begin(), elems.end()).equals(expected));
+
+    std::vector<uint32_t> batch;
+    for (size_t i = 0; i < 30; ++i) {
+      batch.push_back(dist(generator));
+    }
+    auto inserted = bulk;
+    inserted.insert_all(batch.begin(), batch.end());
+    auto removed = bulk;
+    removed.remove_all(batch.begin(), batch.end());
+    for (auto x : batch) {
+      expected.insert(x);
+    }
+    EXPECT_TRUE(inserted.equals(expected));
+    for (auto x : batch) {
+      expected.remove(x);
+    }
+    EXPECT_TRUE(removed.equals(expected));
+  }
+}
+
 TEST(PatriciaTreeSet, singleton) {
   using Set = PatriciaTreeSet<uint64_t>;
   EXPECT_EQ(Set{}.singleton(), nullptr);
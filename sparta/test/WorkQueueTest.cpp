@@ -11,7 +11,9 @@
 #include <atomic>
 #include <chrono>
 #include <gtest/gtest.h>
+#include <numeric>
 #include <random>
+#include <vector>
 
 constexpr unsigned int NUM_INTS = 1000;
 
@@ -63,6 +65,35 @@ TEST(WorkQueueTest, singleThreadTest) {
   }
 }
 
+TEST(WorkQueueTest, addItemsByCostTest) {
+  std::vector<int> items(NUM_INTS);
+  std::iota(items.begin(), items.end(), 0);
+  std::shuffle(items.begin(), items.end(), std::mt19937(42));
+
+  std::vector<int> order;
+  auto wq = sparta::work_queue<int>([&](int i) { order.push_back(i); }, 1);
+  wq.add_items_by_cost(items, [](int i) { return i; });
+  wq.run_all();
+
+  ASSERT_EQ(NUM_INTS, order.size());
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    EXPECT_EQ(NUM_INTS - 1 - idx, order[idx]);
+  }
+}
+
+TEST(WorkQueueTest, addItemsByCostParallelTest) {
+  std::array<std::atomic<int>, NUM_INTS> array = {};
+  std::vector<int> items(NUM_INTS);
+  std::iota(items.begin(), items.end(), 0);
+
+  auto wq = sparta::work_queue<int>([&](int i) { array[i]++; });
+  wq.add_items_by_cost(items, [](int i) { return i % 7; });
+  wq.run_all();
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    ASSERT_EQ(1, array[idx]);
+  }
+}
+
 TEST(WorkQueueTest, startFromOneTest) {
   std::array<int, NUM_INTS> array = {0};
 
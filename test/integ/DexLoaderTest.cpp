@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <utility>
+
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "IRAssembler.h"
+#include "RedexContext.h"
+#include "RedexException.h"
+#include "RedexTest.h"
+#include "Show.h"
+#include "WorkQueue.h"
+
+namespace {
+
+constexpr const char* LOADER_TEST_CLASS_NAME =
+    "Lcom/facebook/redextest/DexLoaderTest;";
+
+// Reads the whole dex into word storage, as loading requires the dex data
+// to be aligned.
+std::vector<uint32_t> read_dex(const std::string& path, size_t* size) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  always_assert_log(in, "Could not open %s", path.c_str());
+  *size = in.tellg();
+  std::vector<uint32_t> data((*size + sizeof(uint32_t) - 1) /
+                             sizeof(uint32_t));
+  in.seekg(0);
+  in.read(reinterpret_cast<char*>(data.data()), *size);
+  return data;
+}
+
+const uint8_t* as_bytes(const std::vector<uint32_t>& data) {
+  return reinterpret_cast<const uint8_t*>(data.data());
+}
+
+// Where each loaded class came from.
+std::vector<std::pair<std::string, std::string>> class_locations(
+    const std::vector<DexClasses>& dexes) {
+  std::vector<std::pair<std::string, std::string>> locations;
+  for (const auto& classes : dexes) {
+    for (auto* cls : classes) {
+      locations.emplace_back(show(cls), cls->get_location()->get_file_name());
+    }
+  }
+  return locations;
+}
+
+std::vector<std::string> class_names(const DexClasses& classes) {
+  std::vector<std::string> names;
+  for (auto* cls : classes) {
+    names.push_back(show(cls));
+  }
+  return names;
+}
+
+void expect_same_stats(const dex_stats_t& a, const dex_stats_t& b) {
+  EXPECT_EQ(a.num_classes, b.num_classes);
+  EXPECT_EQ(a.num_methods, b.num_methods);
+  EXPECT_EQ(a.num_fields, b.num_fields);
+  EXPECT_EQ(a.num_strings, b.num_strings);
+  EXPECT_EQ(a.num_annotations, b.num_annotations);
+  EXPECT_EQ(a.num_bytes, b.num_bytes);
+  EXPECT_EQ(a.num_instructions, b.num_instructions);
+  EXPECT_EQ(a.header_item_count, b.header_item_count);
+  EXPECT_EQ(a.string_data_count, b.string_data_count);
+  EXPECT_EQ(a.annotations_directory_bytes, b.annotations_directory_bytes);
+}
+
+// The annotations of a class and its members, in declaration order.
+std::vector<std::string> annotations(const DexClass* cls) {
+  std::vector<std::string> annos{show(cls->get_anno_set())};
+  for (auto* field : cls->get_all_fields()) {
+    annos.push_back(show(field) + " " + show(field->get_anno_set()));
+  }
+  for (auto* method : cls->get_all_methods()) {
+    annos.push_back(show(method) + " " + show(method->get_anno_set()));
+    if (auto* param_anno = method->get_param_anno()) {
+      for (const auto& [i, aset] : *param_anno) {
+        annos.push_back(show(method) + " " + std::to_string(i) + " " +
+                        show(aset.get()));
+      }
+    }
+  }
+  return annos;
+}
+
+// The code of every method with code, in declaration order.
+std::vector<std::string> code(const DexClasses& classes) {
+  std::vector<std::string> code;
+  for (auto* cls : classes) {
+    for (auto* method : cls->get_all_methods()) {
+      if (auto* method_code = std::as_const(*method).get_code()) {
+        code.push_back(show(method) + " " + assembler::to_string(method_code));
+      }
+    }
+  }
+  return code;
+}
+
+} // namespace
+
+class DexLoaderTest : public RedexTest {
+ protected:
+  std::string dex_file{get_env("dexfile")};
+
+  // Starts over with no classes loaded.
+  void reset_context(bool allow_class_duplicates = false) {
+    delete g_redex;
+    g_redex = new RedexContext(allow_class_duplicates);
+  }
+};
+
+TEST_F(DexLoaderTest, loadFromMemoryMatchesFile) {
+  dex_stats_t file_stats{};
+  auto file_classes = class_names(load_classes_from_dex(
+      DexLocation::make_location("dex", dex_file), &file_stats));
+  ASSERT_FALSE(file_classes.empty());
+  EXPECT_GT(file_stats.num_annotations, 0);
+
+  reset_context();
+  size_t size;
+  auto data = read_dex(dex_file, &size);
+  dex_stats_t memory_stats{};
+  auto classes =
+      load_classes_from_dex(DexLocation::make_location("dex", dex_file),
+                            as_bytes(data), size, &memory_stats);
+  EXPECT_EQ(class_names(classes), file_classes);
+  expect_same_stats(memory_stats, file_stats);
+
+  auto* cls = type_class(DexType::get_type(LOADER_TEST_CLASS_NAME));
+  ASSERT_NE(cls, nullptr);
+  EXPECT_NE(cls->get_anno_set(), nullptr);
+  auto* field = cls->find_ifield("counter", type::_int());
+  ASSERT_NE(field, nullptr);
+  EXPECT_NE(field->get_anno_set(), nullptr);
+}
+
+TEST_F(DexLoaderTest, loadFromMemoryInBatch) {
+  dex_stats_t file_stats{};
+  auto file_classes = class_names(load_classes_from_dex(
+      DexLocation::make_location("dex", dex_file), &file_stats));
+
+  reset_context();
+  size_t size;
+  auto data = read_dex(dex_file, &size);
+  std::vector<dex_stats_t> stats;
+  auto dexes = load_classes_from_dexes(
+      {DexSource{DexLocation::make_location("dex", dex_file), as_bytes(data),
+                 size}},
+      &stats);
+  ASSERT_EQ(dexes.size(), 1);
+  EXPECT_EQ(class_names(dexes[0]), file_classes);
+  ASSERT_EQ(stats.size(), 1);
+  expect_same_stats(stats[0], file_stats);
+}
+
+TEST_F(DexLoaderTest, batchKeepsFirstDefinitionOfDuplicates) {
+  size_t size;
+  auto data = read_dex(dex_file, &size);
+
+  // Loading one dex after another keeps the definitions of the first one.
+  reset_context(/* allow_class_duplicates */ true);
+  std::vector<DexClasses> serial;
+  for (const char* name : {"first.dex", "second.dex"}) {
+    dex_stats_t stats{};
+    serial.push_back(load_classes_from_dex(
+        DexLocation::make_location("dex", name), as_bytes(data), size,
+        &stats));
+  }
+  auto serial_locations = class_locations(serial);
+  ASSERT_FALSE(serial[0].empty());
+  EXPECT_TRUE(serial[1].empty());
+
+  reset_context(/* allow_class_duplicates */ true);
+  std::vector<dex_stats_t> stats;
+  auto batch = load_classes_from_dexes(
+      {DexSource{DexLocation::make_location("dex", "first.dex"),
+                 as_bytes(data), size},
+       DexSource{DexLocation::make_location("dex", "second.dex"),
+                 as_bytes(data), size}},
+      &stats);
+  ASSERT_EQ(batch.size(), 2);
+  EXPECT_EQ(batch[0].size(), serial[0].size());
+  EXPECT_TRUE(batch[1].empty());
+  EXPECT_EQ(class_locations(batch), serial_locations);
+  for (const auto& [name, location] : class_locations(batch)) {
+    EXPECT_EQ(location, "first.dex") << name;
+  }
+}
+
+TEST_F(DexLoaderTest, batchReportsDuplicatesLikeSerialLoading) {
+  size_t size;
+  auto data = read_dex(dex_file, &size);
+  auto duplicate_error = [](const auto& load) {
+    try {
+      load();
+    } catch (const RedexException& e) {
+      EXPECT_EQ(e.type, RedexError::DUPLICATE_CLASSES);
+      return e.extra_info;
+    }
+    ADD_FAILURE() << "Duplicate classes were not reported";
+    return std::map<std::string, std::string>();
+  };
+
+  // Loading serially reports the first duplicate class of the second dex.
+  reset_context();
+  dex_stats_t stats{};
+  load_classes_from_dex(DexLocation::make_location("dex", "first.dex"),
+                        as_bytes(data), size, &stats);
+  auto serial_error = duplicate_error([&]() {
+    load_classes_from_dex(DexLocation::make_location("dex", "second.dex"),
+                          as_bytes(data), size, &stats, true, true, 35,
+                          DexLoader::Parallel::kNo);
+  });
+  EXPECT_EQ(serial_error["dex1"], "first.dex");
+  EXPECT_EQ(serial_error["dex2"], "second.dex");
+
+  reset_context();
+  std::vector<dex_stats_t> batch_stats;
+  auto batch_error = duplicate_error([&]() {
+    load_classes_from_dexes(
+        {DexSource{DexLocation::make_location("dex", "first.dex"),
+                   as_bytes(data), size},
+         DexSource{DexLocation::make_location("dex", "second.dex"),
+                   as_bytes(data), size}},
+        &batch_stats);
+  });
+  EXPECT_EQ(batch_error, serial_error);
+}
+
+TEST_F(DexLoaderTest, lazyAnnotationsMatchEagerLoading) {
+  load_classes_from_dex(DexLocation::make_location("dex", dex_file));
+  auto* cls = type_class(DexType::get_type(LOADER_TEST_CLASS_NAME));
+  ASSERT_NE(cls, nullptr);
+  auto eager = annotations(cls);
+
+  reset_context();
+  g_redex->lazy_dex_annotations = true;
+  load_classes_from_dex(DexLocation::make_location("dex", dex_file));
+  cls = type_class(DexType::get_type(LOADER_TEST_CLASS_NAME));
+  ASSERT_NE(cls, nullptr);
+  // Start decoding from a member rather than the class itself.
+  auto* method = cls->find_method_from_simple_deobfuscated_name("add");
+  ASSERT_NE(method, nullptr);
+  EXPECT_NE(method->get_param_anno(), nullptr);
+  EXPECT_EQ(annotations(cls), eager);
+}
+
+TEST_F(DexLoaderTest, lazyAnnotationsSurviveRelocation) {
+  load_classes_from_dex(DexLocation::make_location("dex", dex_file));
+  auto* cls = type_class(DexType::get_type(LOADER_TEST_CLASS_NAME));
+  ASSERT_NE(cls, nullptr);
+  auto* method = cls->find_method_from_simple_deobfuscated_name("add");
+  auto* field = cls->find_ifield("counter", type::_int());
+  ASSERT_NE(method, nullptr);
+  ASSERT_NE(field, nullptr);
+  auto method_anno = show(method->get_anno_set());
+  auto param_anno = show(method->get_param_anno()->at(0).get());
+  auto field_anno = show(field->get_anno_set());
+
+  reset_context();
+  g_redex->lazy_dex_annotations = true;
+  load_classes_from_dex(DexLocation::make_location("dex", dex_file));
+  cls = type_class(DexType::get_type(LOADER_TEST_CLASS_NAME));
+  auto* other =
+      type_class(DexType::get_type("Lcom/facebook/redextest/DexLoaderOther;"));
+  ASSERT_NE(cls, nullptr);
+  ASSERT_NE(other, nullptr);
+  method = cls->find_method_from_simple_deobfuscated_name("add");
+  field = cls->find_ifield("counter", type::_int());
+  ASSERT_NE(method, nullptr);
+  ASSERT_NE(field, nullptr);
+
+  // Retarget both members before their annotations were ever looked at.
+  // Removing them from their class would decode the annotations already.
+  method->change(DexMethodSpec(other->get_type(), nullptr, nullptr),
+                 /* rename_on_collision */ false);
+  field->change(DexFieldSpec(other->get_type(), nullptr, nullptr));
+
+  ASSERT_NE(method->get_anno_set(), nullptr);
+  EXPECT_EQ(show(method->get_anno_set()), method_anno);
+  ASSERT_NE(method->get_param_anno(), nullptr);
+  EXPECT_EQ(show(method->get_param_anno()->at(0).get()), param_anno);
+  ASSERT_NE(field->get_anno_set(), nullptr);
+  EXPECT_EQ(show(field->get_anno_set()), field_anno);
+  EXPECT_NE(cls->get_anno_set(), nullptr);
+}
+
+TEST_F(DexLoaderTest, lazyCodeMatchesEagerLoading) {
+  auto eager = code(
+      load_classes_from_dex(DexLocation::make_location("dex", dex_file)));
+  ASSERT_FALSE(eager.empty());
+
+  reset_context();
+  g_redex->lazy_dex_code = true;
+  auto classes =
+      load_classes_from_dex(DexLocation::make_location("dex", dex_file));
+  std::vector<DexMethod*> methods;
+  for (auto* cls : classes) {
+    for (auto* method : cls->get_all_methods()) {
+      methods.push_back(method);
+    }
+  }
+  ASSERT_FALSE(methods.empty());
+  // Have several threads race to decode each method, through both the const
+  // and the mutable accessor.
+  constexpr size_t kAccessesPerMethod = 16;
+  workqueue_run_for<size_t>(
+      0, methods.size() * kAccessesPerMethod,
+      [&](size_t i) {
+        // Spread the accesses to a method over the whole range.
+        auto* method = methods[i % methods.size()];
+        if ((i / methods.size()) % 2 == 0) {
+          std::as_const(*method).get_code();
+        } else {
+          method->get_code();
+        }
+      },
+      /* num_threads */ 8);
+  EXPECT_EQ(code(classes), eager);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+package com.facebook.redextest;
+
+import java.lang.annotation.ElementType;
+import java.lang.annotation.Retention;
+import java.lang.annotation.RetentionPolicy;
+import java.lang.annotation.Target;
+
+@Retention(RetentionPolicy.RUNTIME)
+@Target({ElementType.TYPE, ElementType.FIELD, ElementType.METHOD,
+         ElementType.PARAMETER})
+@interface Marker {
+  String value() default "";
+}
+
+@Marker("class")
+public class DexLoaderTest {
+  @Marker("field") public int counter;
+
+  @Marker("static field") public static String NAME = "loader";
+
+  @Marker("method")
+  public int add(@Marker("param") int a, int b) {
+    counter += a;
+    return a + b;
+  }
+
+  public static int loop(int n) {
+    int sum = 0;
+    for (int i = 0; i < n; i++) {
+      if (i % 3 == 0) {
+        sum += i;
+      } else {
+        sum -= 1;
+      }
+    }
+    return sum;
+  }
+
+  public String describe(Object o) {
+    try {
+      return NAME + o.toString() + counter;
+    } catch (RuntimeException e) {
+      return "failed";
+    }
+  }
+}
+
+class DexLoaderOther {
+  public static int twice(int x) {
+    return DexLoaderTest.loop(x) * 2;
+  }
+}
@@ -117,3 +117,23 @@ TEST_F(MethodOverrideGraphTest, verify) {
     EXPECT_EQ(node.parents.size(), parents.size());
   }
 }
+
+TEST_F(MethodOverrideGraphTest, cachedGraphIsInvalidatedByChanges) {
+  const char* A_M = "Lcom/facebook/redextest/A;.m:()V";
+  const char* B_M = "Lcom/facebook/redextest/B;.m:()V";
+  const char* C_M = "Lcom/facebook/redextest/C;.m:()V";
+  auto scope = build_class_scope(stores);
+
+  auto graph = mog::build_graph_cached(scope);
+  EXPECT_EQ(graph, mog::build_graph_cached(scope));
+
+  // Removing a virtual method changes the graph.
+  auto* c_m = DexMethod::get_method(C_M)->as_def();
+  type_class(c_m->get_class())->remove_method(c_m);
+  auto new_graph = mog::build_graph_cached(scope);
+  EXPECT_NE(graph, new_graph);
+  EXPECT_THAT(
+      get_overriding_methods(*new_graph, DexMethod::get_method(A_M), false),
+      ::testing::UnorderedElementsAre(B_M));
+  EXPECT_EQ(new_graph, mog::build_graph_cached(scope));
+}
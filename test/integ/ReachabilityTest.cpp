@@ -204,3 +204,63 @@ TEST_F(ReachabilityTest, SharpeningCreatesMoreZombies) {
                             // method as class is instantiable and we need an
                             // implementation
 }
+
+TEST_F(ReachabilityTest, ReachabilityIncrementalTest) {
+  const auto& dexen = stores[0].get_dexen();
+  auto pg_config = process_and_get_proguard_config(dexen, R"(
+    -keepclasseswithmembers public class RemoveUnreachableTest {
+      public void testMethod();
+    }
+    -keepclasseswithmembers class A {
+      int foo;
+      <init>();
+      int bar();
+    }
+  )");
+  EXPECT_TRUE(pg_config->ok);
+
+  auto scope = build_class_scope(stores);
+  walk::parallel::code(scope, [&](auto*, auto& code) { code.build_cfg(); });
+  auto method_override_graph = method_override_graph::build_graph(scope);
+
+  reachability::MethodReferencesCache cache;
+  auto compute = [&]() {
+    int num_ignore_check_strings = 0;
+    reachability::IgnoreSets ig_sets;
+    reachability::ReachableAspects reachable_aspects;
+    return reachability::compute_reachable_objects(
+        scope, *method_override_graph, ig_sets, &num_ignore_check_strings,
+        &reachable_aspects, /* record_reachability */ false,
+        /* relaxed_keep_class_members */ false,
+        /* relaxed_keep_interfaces */ false,
+        /* cfg_gathering_check_instantiable */ false,
+        /* cfg_gathering_check_instance_callable */ false,
+        /* cfg_gathering_check_returning */ false,
+        /* should_mark_all_as_seed */ false,
+        /* remove_no_argument_constructors */ false, &cache);
+  };
+
+  auto first = compute();
+  EXPECT_EQ(cache.hits(), 0);
+  auto misses = cache.misses();
+  EXPECT_GT(misses, 0);
+
+  // Nothing changed, so all references come from the cache.
+  auto second = compute();
+  EXPECT_EQ(cache.hits(), misses);
+  EXPECT_EQ(cache.misses(), misses);
+  EXPECT_EQ(first->num_marked_classes(), second->num_marked_classes());
+  EXPECT_EQ(first->num_marked_fields(), second->num_marked_fields());
+  EXPECT_EQ(first->num_marked_methods(), second->num_marked_methods());
+
+  // Touching the code of a method invalidates its entry.
+  auto* method =
+      DexMethod::get_method("LRemoveUnreachableTest;.testMethod:()V")
+          ->as_def();
+  ASSERT_NE(method, nullptr);
+  (void)method->get_code();
+  auto third = compute();
+  EXPECT_EQ(cache.misses(), misses + 1);
+  EXPECT_EQ(first->num_marked_methods(), third->num_marked_methods());
+  walk::parallel::code(scope, [&](auto*, auto& code) { code.clear_cfg(); });
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+package com.facebook.redextest.lib;
+
+public class ServeTestLib {
+  public static int twice(int x) {
+    return 2 * x;
+  }
+}
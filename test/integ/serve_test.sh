@@ -0,0 +1,76 @@
+#!/bin/sh
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Checks that builds served by `redex-all --serve` match standalone builds,
+# and that served builds which could not match them are refused.
+
+set -e
+
+if [ "$#" -lt 4 ]; then
+    echo "redex-all binary, app dex, library jar and library dex required"
+    exit 1
+fi
+REDEX_ALL=$1
+APP_DEX=$2
+LIB_JAR=$3
+LIB_DEX=$4
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+CONFIG="$TMP_DIR/config.json"
+echo '{"redex": {"passes": []}}' > "$CONFIG"
+
+# Runs a build with the given arguments in the server preloading $LIB_JAR,
+# and prints its exit code.
+serve() {
+    printf '[' > "$TMP_DIR/request"
+    SEP=""
+    for ARG in "$@"; do
+        printf '%s"%s"' "$SEP" "$ARG" >> "$TMP_DIR/request"
+        SEP=", "
+    done
+    printf ']\n' >> "$TMP_DIR/request"
+    "$REDEX_ALL" --serve "$LIB_JAR" < "$TMP_DIR/request" \
+        > "$TMP_DIR/serve.out" 2> "$TMP_DIR/serve.err"
+    sed -n 's/^{"exit_code": \([0-9]*\)}$/\1/p' "$TMP_DIR/serve.out"
+}
+
+echo "Comparing a served build with a standalone one"
+mkdir "$TMP_DIR/standalone" "$TMP_DIR/served"
+"$REDEX_ALL" --config "$CONFIG" --outdir "$TMP_DIR/standalone" \
+    -j "$LIB_JAR" "$APP_DEX"
+CODE=$(serve --config "$CONFIG" --outdir "$TMP_DIR/served" \
+    -j "$LIB_JAR" "$APP_DEX")
+if [ "$CODE" != "0" ]; then
+    cat "$TMP_DIR/serve.err"
+    echo "Served build failed with exit code '$CODE'"
+    exit 1
+fi
+cmp "$TMP_DIR/standalone/classes.dex" "$TMP_DIR/served/classes.dex"
+echo "served build matches"
+
+echo "Refusing a served build without the preloaded jar"
+mkdir "$TMP_DIR/no_jar"
+CODE=$(serve --config "$CONFIG" --outdir "$TMP_DIR/no_jar" "$APP_DEX")
+if [ "$CODE" = "0" ]; then
+    echo "Served build without the preloaded jar was not refused"
+    exit 1
+fi
+grep -q "exactly the preloaded library jars" "$TMP_DIR/serve.err"
+echo "served build was refused"
+
+echo "Refusing a served build whose dex shadows a preloaded class"
+mkdir "$TMP_DIR/shadowing" "$TMP_DIR/shadowing_standalone"
+# Standalone, the dex classes shadow the library classes.
+"$REDEX_ALL" --config "$CONFIG" --outdir "$TMP_DIR/shadowing_standalone" \
+    -j "$LIB_JAR" "$LIB_DEX"
+CODE=$(serve --config "$CONFIG" --outdir "$TMP_DIR/shadowing" \
+    -j "$LIB_JAR" "$LIB_DEX")
+if [ "$CODE" = "0" ]; then
+    echo "Served build shadowing a preloaded class was not refused"
+    exit 1
+fi
+echo "served build was refused"
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConcurrentContainers.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//==========
+// Throughput of the concurrent containers, compared against a plain sharded
+// std::unordered_map, for increasing numbers of threads and for uniform as
+// well as skewed key distributions.
+//==========
+
+namespace {
+
+constexpr uint32_t NUM_KEYS = 1 << 18;
+constexpr size_t NUM_OPS = 1 << 22;
+constexpr size_t MAX_THREADS = 128;
+
+enum class Distribution { UNIFORM, SKEWED };
+
+const char* to_string(Distribution distribution) {
+  return distribution == Distribution::UNIFORM ? "uniform" : "skewed";
+}
+
+// The keys each thread operates on, generated upfront so that the random
+// number generation is not measured. Skewed keys concentrate on the low end
+// of the key space, which makes the threads contend for the same entries.
+std::vector<std::vector<uint32_t>> make_keys(Distribution distribution,
+                                             size_t num_threads) {
+  std::vector<std::vector<uint32_t>> keys(num_threads);
+  for (size_t t = 0; t < num_threads; ++t) {
+    std::mt19937 rng(t);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    auto& thread_keys = keys[t];
+    thread_keys.reserve(NUM_OPS / num_threads);
+    for (size_t i = 0; i < NUM_OPS / num_threads; ++i) {
+      double u = uniform(rng);
+      if (distribution == Distribution::SKEWED) {
+        u = std::pow(u, 8);
+      }
+      thread_keys.push_back(std::min(uint32_t(u * NUM_KEYS), NUM_KEYS - 1));
+    }
+  }
+  return keys;
+}
+
+template <typename Fn>
+double run_threads(size_t num_threads, const Fn& fn) {
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&fn, t]() { fn(t); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+struct ConcurrentMapAdapter {
+  static constexpr const char* NAME = "ConcurrentMap";
+  static constexpr bool SUPPORTS_ERASE = true;
+  ConcurrentMap<uint32_t, uint32_t> map;
+  void insert(uint32_t key) { map.emplace(key, key); }
+  bool find(uint32_t key) const { return map.count(key); }
+  void erase(uint32_t key) { map.erase(key); }
+};
+
+struct InsertOnlyConcurrentMapAdapter {
+  static constexpr const char* NAME = "InsertOnlyConcurrentMap";
+  static constexpr bool SUPPORTS_ERASE = false;
+  InsertOnlyConcurrentMap<uint32_t, uint32_t> map;
+  void insert(uint32_t key) { map.emplace(key, key); }
+  bool find(uint32_t key) const { return map.count(key); }
+  void erase(uint32_t) {}
+};
+
+// What one would write without the concurrent containers: a fixed number of
+// std::unordered_maps, each guarded by a mutex.
+struct ShardedStdMapAdapter {
+  static constexpr const char* NAME = "sharded std::unordered_map";
+  static constexpr bool SUPPORTS_ERASE = true;
+  static constexpr size_t NUM_SHARDS = cc_impl::kDefaultSlots;
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<uint32_t, uint32_t> map;
+  };
+  std::array<Shard, NUM_SHARDS> shards;
+  Shard& shard(uint32_t key) {
+    return shards[std::hash<uint32_t>()(key) % NUM_SHARDS];
+  }
+  const Shard& shard(uint32_t key) const {
+    return shards[std::hash<uint32_t>()(key) % NUM_SHARDS];
+  }
+  void insert(uint32_t key) {
+    auto& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.map.emplace(key, key);
+  }
+  bool find(uint32_t key) const {
+    const auto& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.map.count(key);
+  }
+  void erase(uint32_t key) {
+    auto& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.map.erase(key);
+  }
+};
+
+void report(const char* container,
+            const char* operation,
+            Distribution distribution,
+            size_t num_threads,
+            double seconds) {
+  printf("%-28s %-7s %-8s threads=%-4zu %8.2f Mops/s\n", container, operation,
+         to_string(distribution), num_threads, NUM_OPS / seconds / 1e6);
+}
+
+template <typename Adapter>
+void measure(Distribution distribution) {
+  for (size_t num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+    auto keys = make_keys(distribution, num_threads);
+
+    auto container = std::make_unique<Adapter>();
+    auto seconds = run_threads(num_threads, [&](size_t t) {
+      for (auto key : keys[t]) {
+        container->insert(key);
+      }
+    });
+    report(Adapter::NAME, "insert", distribution, num_threads, seconds);
+
+    std::atomic<size_t> found{0};
+    seconds = run_threads(num_threads, [&](size_t t) {
+      size_t local_found = 0;
+      for (auto key : keys[t]) {
+        // Look up keys that may or may not be present.
+        local_found += container->find(key ^ 1);
+      }
+      found += local_found;
+    });
+    report(Adapter::NAME, "find", distribution, num_threads, seconds);
+    EXPECT_GT(found.load(), 0);
+
+    if (Adapter::SUPPORTS_ERASE) {
+      seconds = run_threads(num_threads, [&](size_t t) {
+        for (auto key : keys[t]) {
+          container->erase(key);
+        }
+      });
+      report(Adapter::NAME, "erase", distribution, num_threads, seconds);
+    }
+  }
+}
+
+} // namespace
+
+TEST(ConcurrentContainersPerfTest, ConcurrentMap) {
+  measure<ConcurrentMapAdapter>(Distribution::UNIFORM);
+  measure<ConcurrentMapAdapter>(Distribution::SKEWED);
+}
+
+TEST(ConcurrentContainersPerfTest, InsertOnlyConcurrentMap) {
+  measure<InsertOnlyConcurrentMapAdapter>(Distribution::UNIFORM);
+  measure<InsertOnlyConcurrentMapAdapter>(Distribution::SKEWED);
+}
+
+TEST(ConcurrentContainersPerfTest, ShardedStdMap) {
+  measure<ShardedStdMapAdapter>(Distribution::UNIFORM);
+  measure<ShardedStdMapAdapter>(Distribution::SKEWED);
+}
@@ -366,3 +366,29 @@ TEST(AliasedRegistersTest, CopyOnWriteDomain) {
     EXPECT_FALSE(a.are_aliases(zero, one));
   });
 }
+
+TEST(AliasedRegistersTest, CopiesAreIndependentSnapshots) {
+  AliasedRegisters a;
+  a.move(zero, one);
+  a.move(two, one);
+
+  AliasedRegisters b = a;
+  b.break_alias(zero);
+  b.move(three, two);
+
+  EXPECT_TRUE(a.are_aliases(zero, one));
+  EXPECT_FALSE(a.are_aliases(three, one));
+  EXPECT_FALSE(b.are_aliases(zero, one));
+  EXPECT_TRUE(b.are_aliases(three, one));
+
+  AliasedRegisters c = a;
+  EXPECT_TRUE(c.leq(a));
+  c.join_with(a);
+  EXPECT_TRUE(c.equals(a));
+  EXPECT_EQ(c.get_representative(two), a.get_representative(two));
+
+  c.join_with(b);
+  EXPECT_TRUE(c.are_aliases(one, two));
+  EXPECT_FALSE(c.are_aliases(zero, one));
+  EXPECT_FALSE(c.are_aliases(three, one));
+}
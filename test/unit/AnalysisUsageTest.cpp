@@ -262,3 +262,76 @@ TEST_F(AnalysisUsageTest, testDependencyChecking) {
     EXPECT_TRUE(exception_caught);
   }
 }
+
+TEST_F(AnalysisUsageTest, testAnalysisCache) {
+  struct MyAnalysis {
+    int value;
+  };
+  struct MyOtherAnalysis {
+    int value;
+  };
+  AnalysisCache cache;
+  size_t builds = 0;
+  auto get = [&]() {
+    return cache.get<MyAnalysis>([&]() {
+      builds++;
+      return std::make_unique<MyAnalysis>(MyAnalysis{42});
+    });
+  };
+  auto get_other = [&]() {
+    return cache.get<MyOtherAnalysis>([]() {
+      return std::make_shared<MyOtherAnalysis>(MyOtherAnalysis{1});
+    });
+  };
+
+  auto analysis = get();
+  EXPECT_EQ(42, analysis->value);
+  EXPECT_EQ(analysis, get());
+  EXPECT_EQ(1, get_other()->value);
+  EXPECT_EQ(1, builds);
+
+  {
+    AnalysisUsage au;
+    au.add_preserve_specific<MyAnalysis>();
+    cache.invalidate(au);
+  }
+  EXPECT_TRUE(cache.contains(get_analysis_id_by_pass<MyAnalysis>()));
+  EXPECT_FALSE(cache.contains(get_analysis_id_by_pass<MyOtherAnalysis>()));
+  EXPECT_EQ(analysis, get());
+  EXPECT_EQ(1, builds);
+
+  {
+    AnalysisUsage au;
+    au.set_preserve_all();
+    cache.invalidate(au);
+  }
+  EXPECT_EQ(analysis, get());
+
+  {
+    AnalysisUsage au;
+    cache.invalidate(au);
+  }
+  EXPECT_FALSE(cache.contains(get_analysis_id_by_pass<MyAnalysis>()));
+  auto rebuilt = get();
+  EXPECT_EQ(2, builds);
+  // The analysis handed out before stays alive for as long as it is used.
+  EXPECT_EQ(42, analysis->value);
+  EXPECT_EQ(42, rebuilt->value);
+}
+
+TEST_F(AnalysisUsageTest, testSelfValidatingAnalysisCache) {
+  struct MyAnalysis {
+    int value;
+  };
+  AnalysisCache cache;
+  auto analysis = cache.get_self_validating<MyAnalysis>(
+      []() { return std::make_unique<MyAnalysis>(MyAnalysis{42}); });
+  {
+    AnalysisUsage au;
+    cache.invalidate(au);
+  }
+  EXPECT_TRUE(cache.contains(get_analysis_id_by_pass<MyAnalysis>()));
+  EXPECT_EQ(analysis, cache.get<MyAnalysis>([]() {
+    return std::make_unique<MyAnalysis>(MyAnalysis{0});
+  }));
+}
@@ -883,3 +883,80 @@ TEST_F(CFGInlinerTest, needs_init_class) {
                needs_receiver_cast,
                needs_init_class);
 }
+
+TEST_F(CFGInlinerTest, batch_same_as_one_by_one) {
+  const auto caller_str = R"(
+    (
+      (const v0 0)
+      (invoke-static (v0) "LCls;.foo:(I)I")
+      (move-result v1)
+      (invoke-static (v1) "LCls;.bar:(I)V")
+      (invoke-static (v1) "LCls;.foo:(I)I")
+      (move-result v0)
+      (return v0)
+    )
+  )";
+  const auto foo_str = R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :zero)
+      (add-int/lit v0 v0 1)
+      (:zero)
+      (return v0)
+    )
+  )";
+  const auto bar_str = R"(
+    (
+      (load-param v0)
+      (const v1 2)
+      (return-void)
+    )
+  )";
+  auto foo_code = assembler::ircode_from_string(foo_str);
+  foo_code->build_cfg();
+  auto bar_code = assembler::ircode_from_string(bar_str);
+  bar_code->build_cfg();
+
+  auto get_invokes = [](cfg::ControlFlowGraph& cfg) {
+    std::vector<IRInstruction*> invokes;
+    for (auto& mie : cfg::InstructionIterable(cfg)) {
+      if (opcode::is_an_invoke(mie.insn->opcode())) {
+        invokes.push_back(mie.insn);
+      }
+    }
+    return invokes;
+  };
+
+  auto expected_code = assembler::ircode_from_string(caller_str);
+  expected_code->build_cfg();
+  auto& expected = expected_code->cfg();
+  auto expected_invokes = get_invokes(expected);
+  ASSERT_EQ(expected_invokes.size(), 3);
+  for (size_t i = 0; i < expected_invokes.size(); ++i) {
+    const auto& callee = i == 1 ? bar_code->cfg() : foo_code->cfg();
+    cfg::CFGInliner::inline_cfg(&expected,
+                                expected.find_insn(expected_invokes[i]),
+                                /* needs_receiver_cast */ nullptr,
+                                /* needs_init_class */ nullptr,
+                                callee,
+                                expected.get_registers_size());
+  }
+
+  auto caller_code = assembler::ircode_from_string(caller_str);
+  caller_code->build_cfg();
+  auto& caller = caller_code->cfg();
+  std::vector<cfg::CFGInliner::InlineSite> sites;
+  auto invokes = get_invokes(caller);
+  for (size_t i = 0; i < invokes.size(); ++i) {
+    const auto& callee = i == 1 ? bar_code->cfg() : foo_code->cfg();
+    sites.push_back(cfg::CFGInliner::InlineSite{invokes[i], &callee});
+  }
+  auto inlined = cfg::CFGInliner::inline_cfgs(&caller, sites);
+  EXPECT_EQ(inlined, std::vector<bool>(3, true));
+  EXPECT_EQ(caller.get_registers_size(), expected.get_registers_size());
+
+  expected_code->clear_cfg();
+  caller_code->clear_cfg();
+  EXPECT_EQ(assembler::to_string(expected_code.get()),
+            assembler::to_string(caller_code.get()));
+}
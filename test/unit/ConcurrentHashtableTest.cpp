@@ -8,6 +8,7 @@
 #include "ConcurrentContainers.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -99,6 +100,113 @@ TEST_F(ConcurrentHashtableTest, concurrentInsertGet) {
   EXPECT_EQ(nullptr, set.get(N));
 }
 
+TEST_F(ConcurrentHashtableTest, concurrentInsertEraseGetStress) {
+  // Writers insert (triggering many resizes) and erase disjoint key ranges,
+  // while readers check that whatever they find is fully constructed.
+  const size_t N_STABLE = 1000;
+  const size_t N_WRITERS = 8;
+  const size_t N_READERS = 8;
+  const size_t N = 20000;
+  ConcurrentHashtable<uint32_t, std::pair<const uint32_t, std::string>,
+                      std::hash<uint32_t>, std::equal_to<uint32_t>>
+      map;
+  for (uint32_t i = 0; i < N_STABLE; ++i) {
+    map.try_emplace(i, std::to_string(i));
+  }
+  std::atomic<size_t> writers_done{0};
+  std::vector<boost::thread> threads;
+  for (size_t t = 0; t < N_WRITERS; ++t) {
+    threads.emplace_back([&, t]() {
+      uint32_t begin = N_STABLE + t * N;
+      for (uint32_t i = begin; i < begin + N; ++i) {
+        auto insertion_result = map.try_emplace(i, std::to_string(i));
+        EXPECT_TRUE(insertion_result.success);
+        auto* ptr = map.get(i);
+        EXPECT_NE(nullptr, ptr);
+        EXPECT_EQ(std::to_string(i), ptr->second);
+        if (i % 2) {
+          EXPECT_NE(nullptr, map.erase(i));
+          EXPECT_EQ(nullptr, map.get(i));
+        }
+      }
+      writers_done++;
+    });
+  }
+  for (size_t t = 0; t < N_READERS; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<uint32_t> dist(0,
+                                                   N_STABLE + N_WRITERS * N);
+      while (writers_done.load() < N_WRITERS) {
+        auto i = dist(rng);
+        auto* ptr = map.get(i);
+        if (i < N_STABLE) {
+          EXPECT_NE(nullptr, ptr);
+        }
+        if (ptr) {
+          EXPECT_EQ(i, ptr->first);
+          EXPECT_EQ(std::to_string(i), ptr->second);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(N_STABLE + N_WRITERS * N / 2, map.size());
+  for (uint32_t i = 0; i < N_STABLE + N_WRITERS * N; ++i) {
+    auto* ptr = map.get(i);
+    if (i < N_STABLE || i % 2 == 0) {
+      ASSERT_NE(nullptr, ptr);
+      EXPECT_EQ(std::to_string(i), ptr->second);
+    } else {
+      EXPECT_EQ(nullptr, ptr);
+    }
+  }
+}
+
+TEST_F(ConcurrentHashtableTest, nodeArenaReusesReleasedSlots) {
+  NodeArena<std::pair<uint64_t, uint64_t>> arena;
+  std::unordered_set<void*> slots;
+  for (size_t i = 0; i < 10000; ++i) {
+    EXPECT_TRUE(slots.insert(arena.allocate()).second);
+  }
+  auto* slot = *slots.begin();
+  arena.release(slot);
+  EXPECT_EQ(slot, arena.allocate());
+  EXPECT_FALSE(slots.count(arena.allocate()));
+}
+
+TEST_F(ConcurrentHashtableTest, nonTrivialValuesAreDestroyed) {
+  ConcurrentHashtable<std::string, std::pair<const std::string, std::string>,
+                      std::hash<std::string>, std::equal_to<std::string>>
+      map;
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = std::to_string(i);
+    EXPECT_TRUE(map.try_emplace(key, key + key).success);
+    // A failed insertion constructs and destroys a node.
+    auto insertion_result = map.try_emplace(key, key);
+    EXPECT_FALSE(insertion_result.success);
+    EXPECT_EQ(key + key, insertion_result.stored_value_ptr->second);
+  }
+  for (size_t i = 0; i < 1000; i += 2) {
+    EXPECT_NE(nullptr, map.erase(std::to_string(i)));
+  }
+  map.compact();
+  EXPECT_EQ(500, map.size());
+
+  auto moved = std::move(map);
+  EXPECT_EQ(500, moved.size());
+  EXPECT_EQ(nullptr, moved.get("0"));
+  ASSERT_NE(nullptr, moved.get("1"));
+  EXPECT_EQ("11", moved.get("1")->second);
+
+  moved.clear();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_TRUE(moved.try_emplace("a", "b").success);
+  EXPECT_EQ("b", moved.get("a")->second);
+}
+
 TEST_F(ConcurrentHashtableTest, primeProgression) {
   size_t i = 5;
   i = cc_impl::get_prime_number_greater_or_equal_to(i * 2);
@@ -73,3 +73,23 @@ TEST_F(ConfigFilesTest, read_class_frequencies) {
           .at(11),
       1);
 }
+
+TEST_F(ConfigFilesTest, prefetch_class_frequencies) {
+  auto class_frequency_path = std::getenv("class_frequencies_path");
+
+  Json::Value json_cfg;
+  std::istringstream temp_json(
+      "{\"redex\":{\"passes\":[]}, \"class_frequencies\": \"\"}");
+
+  temp_json >> json_cfg;
+  json_cfg["class_frequencies"] = class_frequency_path;
+  ConfigFiles conf(json_cfg);
+  conf.prefetch();
+
+  const auto& class_freq_map = conf.get_class_frequencies();
+  EXPECT_EQ(conf.get_interactions().at(0), "ColdStart");
+  validate_frequencies(
+      class_freq_map, "Lcom/facebook/redextest/C1;", {99, 0, 94});
+  EXPECT_TRUE(conf.get_coldstart_classes().empty());
+  EXPECT_TRUE(conf.get_all_class_lists().empty());
+}
@@ -1050,6 +1050,40 @@ TEST_F(ControlFlowTest, deep_copy1) {
   EXPECT_TRUE(orig_list->structural_equals(*copy_list, m_equal));
 }
 
+TEST_F(ControlFlowTest, structural_hash) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (const v1 1)
+      (if-eqz v0 :thr)
+      (return-void)
+      (:thr)
+      (throw v0)
+    )
+)");
+  code->build_cfg();
+  auto& orig = code->cfg();
+
+  cfg::ControlFlowGraph copy;
+  orig.deep_copy(&copy);
+  EXPECT_EQ(orig.structural_hash(), copy.structural_hash());
+
+  // Same instructions, in a different order within the block.
+  auto swapped = assembler::ircode_from_string(R"(
+    (
+      (const v1 1)
+      (const v0 0)
+      (if-eqz v0 :thr)
+      (return-void)
+      (:thr)
+      (throw v0)
+    )
+)");
+  swapped->build_cfg();
+  EXPECT_FALSE(orig.structural_equals(swapped->cfg()));
+  EXPECT_NE(orig.structural_hash(), swapped->cfg().structural_hash());
+}
+
 TEST_F(ControlFlowTest, deep_copy2) {
 
   auto code = assembler::ircode_from_string(R"(
@@ -2889,3 +2923,96 @@ TEST_F(ControlFlowTest, insert_block_switch) {
   EXPECT_TRUE(branch_edges[2]->target() == nb0);
   EXPECT_TRUE(nb0->goes_to() != nullptr && nb0->goes_to() == branch_block);
 }
+
+TEST_F(ControlFlowTest, structural_data_invalidated_by_edge_changes) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :true)
+
+      (const v1 1)
+      (return v1)
+
+      (:true)
+      (const v1 2)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+
+  struct Tag {};
+  size_t num_computations = 0;
+  auto get_num_blocks = [&]() {
+    return cfg.get_structural_data<Tag, size_t>([&]() {
+      ++num_computations;
+      return std::make_shared<const size_t>(cfg.num_blocks());
+    });
+  };
+
+  auto data = get_num_blocks();
+  EXPECT_EQ(3, *data);
+  EXPECT_EQ(data, get_num_blocks());
+  EXPECT_EQ(1, num_computations);
+
+  // Editing instructions does not change the structure.
+  auto version = cfg.structural_version();
+  cfg.entry_block()->push_front(dasm(OPCODE_CONST, {1_v, 3_L}));
+  EXPECT_EQ(version, cfg.structural_version());
+  EXPECT_EQ(data, get_num_blocks());
+  EXPECT_EQ(1, num_computations);
+
+  cfg.insert_block(cfg.entry_block(), cfg.entry_block()->goes_to(),
+                   cfg.create_block());
+  EXPECT_NE(version, cfg.structural_version());
+  EXPECT_EQ(4, *get_num_blocks());
+  EXPECT_EQ(2, num_computations);
+}
+
+TEST_F(ControlFlowTest, code_data_invalidated_by_instruction_changes) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :true)
+
+      (const v1 1)
+      (return v1)
+
+      (:true)
+      (const v1 2)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+
+  struct Tag {};
+  size_t num_computations = 0;
+  auto get_num_insns = [&]() {
+    return cfg.get_code_data<Tag, size_t>([&]() {
+      ++num_computations;
+      return std::make_shared<const size_t>(cfg.num_opcodes());
+    });
+  };
+
+  auto data = get_num_insns();
+  EXPECT_EQ(6, *data);
+  EXPECT_EQ(data, get_num_insns());
+  EXPECT_EQ(1, num_computations);
+
+  // Changing an operand in place is noticed.
+  auto* const_insn = cfg.entry_block()->get_first_insn()->insn;
+  const_insn->set_literal(1);
+  EXPECT_EQ(6, *get_num_insns());
+  EXPECT_EQ(2, num_computations);
+
+  cfg.entry_block()->push_front(dasm(OPCODE_CONST, {1_v, 3_L}));
+  data = get_num_insns();
+  EXPECT_EQ(7, *data);
+  EXPECT_EQ(3, num_computations);
+
+  // Only a weak reference is kept.
+  data.reset();
+  EXPECT_EQ(7, *get_num_insns());
+  EXPECT_EQ(4, num_computations);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DenseLiveness.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class DenseLivenessTest : public RedexTest {};
+
+namespace {
+
+// Checks that the dense analysis agrees with the LivenessFixpointIterator on
+// every block.
+void expect_same_liveness(cfg::ControlFlowGraph& cfg) {
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+  DenseLiveness dense(cfg);
+  for (auto* block : cfg.blocks()) {
+    const auto& live_in = fixpoint_iter.get_live_in_vars_at(block);
+    const auto& live_out = fixpoint_iter.get_live_out_vars_at(block);
+    EXPECT_EQ(dense.is_reachable(block), !live_in.is_bottom());
+    if (live_in.is_bottom()) {
+      continue;
+    }
+    for (reg_t reg = 0; reg < cfg.get_registers_size(); ++reg) {
+      EXPECT_EQ(dense.get_live_in_vars_at(block).test(reg),
+                live_in.contains(reg))
+          << "v" << reg << " in B" << block->id();
+      EXPECT_EQ(dense.get_live_out_vars_at(block).test(reg),
+                live_out.contains(reg))
+          << "v" << reg << " in B" << block->id();
+    }
+  }
+}
+
+} // namespace
+
+TEST_F(DenseLivenessTest, straightLine) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (load-param v1)
+     (const v2 0)
+     (add-int v3 v0 v2)
+     (return v3)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  ASSERT_TRUE(DenseLiveness::is_applicable(cfg));
+  expect_same_liveness(cfg);
+}
+
+TEST_F(DenseLivenessTest, loop) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (const v1 0)
+     (const v2 1)
+     (:loop)
+     (if-eqz v0 :end)
+     (add-int v1 v1 v2)
+     (add-int/lit v0 v0 -1)
+     (goto :loop)
+     (:end)
+     (if-nez v1 :other)
+     (return v1)
+     (:other)
+     (const v3 7)
+     (return v3)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  expect_same_liveness(cfg);
+
+  DenseLiveness dense(cfg);
+  auto* entry = cfg.entry_block();
+  EXPECT_TRUE(dense.get_live_out_vars_at(entry).test(0));
+  EXPECT_FALSE(dense.get_live_out_vars_at(entry).test(3));
+
+  LivenessQuery query(cfg);
+  auto* loop_head = entry->goes_to();
+  EXPECT_TRUE(query.may_be_live_in(loop_head, 1));
+  EXPECT_TRUE(query.may_be_live_in(loop_head, 2));
+  EXPECT_FALSE(query.may_be_live_in(loop_head, 3));
+}
+
+TEST_F(DenseLivenessTest, infiniteLoopIsUnreachable) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (if-eqz v0 :spin)
+     (return v0)
+     (:spin)
+     (add-int/lit v0 v0 1)
+     (goto :spin)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  expect_same_liveness(cfg);
+
+  LivenessQuery query(cfg);
+  for (auto* block : cfg.blocks()) {
+    if (block->succs().size() == 1 && block->goes_to() == block) {
+      EXPECT_TRUE(query.may_be_live_in(block, 0));
+    }
+  }
+}
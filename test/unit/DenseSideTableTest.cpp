@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DenseSideTable.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Object {
+  uint32_t dense_index;
+  uint32_t get_dense_index() const { return dense_index; }
+};
+
+} // namespace
+
+TEST(DenseSideTableTest, valuesAreDefaultConstructedAndStable) {
+  DenseSideTable<Object, std::string> table;
+  std::vector<Object> objects;
+  for (uint32_t i = 0; i < 100000; i += 7) {
+    objects.push_back(Object{i});
+  }
+
+  for (const auto& obj : objects) {
+    EXPECT_EQ(nullptr, table.get(&obj));
+  }
+  auto* first_value = &table[&objects.front()];
+  EXPECT_EQ("", *first_value);
+  for (const auto& obj : objects) {
+    table[&obj] = std::to_string(obj.dense_index);
+  }
+  // Values never move.
+  EXPECT_EQ(first_value, &table[&objects.front()]);
+  const auto& const_table = table;
+  for (const auto& obj : objects) {
+    auto* value = const_table.get(&obj);
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(std::to_string(obj.dense_index), *value);
+  }
+}
+
+TEST(DenseSideTableTest, concurrentAccess) {
+  constexpr uint32_t N_THREADS = 8;
+  constexpr uint32_t N = 1 << 16;
+  DenseSideTable<Object, std::atomic<uint32_t>> table;
+  std::vector<Object> objects;
+  for (uint32_t i = 0; i < N; ++i) {
+    objects.push_back(Object{i});
+  }
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < N_THREADS; ++t) {
+    threads.emplace_back([&]() {
+      for (const auto& obj : objects) {
+        table[&obj].fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& obj : objects) {
+    auto* value = table.get(&obj);
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(N_THREADS, value->load());
+  }
+}
@@ -9,6 +9,8 @@
 
 #include <boost/optional.hpp>
 
+#include "Creators.h"
+#include "DexAnnotation.h"
 #include "IRAssembler.h"
 #include "RedexTest.h"
 #include "SimpleClassHierarchy.h"
@@ -214,3 +216,27 @@ Methods:
 
   EXPECT_EQ(c->show_structure(), expected);
 }
+
+TEST_F(DexClassTest, fieldAccessorsMarkClassHashDirty) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  auto* field = DexField::make_field("LFoo;.bar:I")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                                    DexEncodedValue::zero_for_type(
+                                        type::_int()));
+  cc.add_field(field);
+  auto* cls = cc.create();
+
+  cls->clear_hash_dirty();
+  const DexField* const_field = field;
+  EXPECT_EQ(const_field->get_static_value()->value(), 0);
+  EXPECT_EQ(const_field->get_anno_set(), nullptr);
+  EXPECT_FALSE(cls->is_hash_dirty());
+
+  field->get_static_value()->value(1);
+  EXPECT_TRUE(cls->is_hash_dirty());
+
+  cls->clear_hash_dirty();
+  EXPECT_EQ(field->get_anno_set(), nullptr);
+  EXPECT_TRUE(cls->is_hash_dirty());
+}
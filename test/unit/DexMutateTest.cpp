@@ -11,6 +11,7 @@
 #include "DexClass.h"
 #include "RedexContext.h"
 #include "RedexTest.h"
+#include "WorkQueue.h"
 
 DexFieldRef* make_field_ref(DexType* cls, const char* name, DexType* type) {
   return DexField::make_field(cls, DexString::make_string(name), type);
@@ -66,3 +67,36 @@ TEST_F(RenameMembersTest, rename) {
   std::string name_after = field->get_name()->c_str();
   ASSERT_EQ("numbat", name_after);
 }
+
+TEST_F(RenameMembersTest, renameConcurrentlyOnCollision) {
+  constexpr size_t num_classes = 50;
+  constexpr size_t num_methods = 10;
+  auto proto =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+  std::vector<std::vector<DexMethodRef*>> methods(num_classes);
+  for (size_t i = 0; i < num_classes; ++i) {
+    auto cls = DexType::make_type("LC" + std::to_string(i) + ";");
+    for (size_t j = 0; j < num_methods; ++j) {
+      methods[i].push_back(DexMethod::make_method(
+          cls, DexString::make_string("m" + std::to_string(j)), proto));
+    }
+  }
+  // All methods of a class collide on the new name, and classes are mutated
+  // concurrently.
+  workqueue_run_for<size_t>(0, num_classes, [&](size_t i) {
+    for (auto* m : methods[i]) {
+      DexMethodSpec spec;
+      spec.name = DexString::make_string("same");
+      m->change(spec, /* rename_on_collision= */ true);
+    }
+  });
+  for (size_t i = 0; i < num_classes; ++i) {
+    EXPECT_EQ(methods[i][0]->get_name()->str(), "same");
+    std::unordered_set<const DexString*> names;
+    for (auto* m : methods[i]) {
+      EXPECT_EQ(DexMethod::get_method(m->get_class(), m->get_name(), proto), m);
+      names.insert(m->get_name());
+    }
+    EXPECT_EQ(names.size(), num_methods);
+  }
+}
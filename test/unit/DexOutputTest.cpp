@@ -9,6 +9,26 @@
 #include <gtest/gtest.h>
 #include <json/json.h>
 
+#include "Creators.h"
+#include "RedexTest.h"
+
+class DexOutputIndexTest : public RedexTest {};
+
+namespace {
+
+template <typename Index, typename Cmp>
+void expect_sorted(const Index& index, const Cmp& cmp) {
+  std::vector<typename Index::key_type> elements(index.size());
+  for (const auto& [element, idx] : index) {
+    elements.at(idx) = element;
+  }
+  for (size_t i = 1; i < elements.size(); i++) {
+    EXPECT_TRUE(cmp(elements[i - 1], elements[i])) << i;
+  }
+}
+
+} // namespace
+
 TEST(DexOutput, checkMethodInstructionSizeLimit) {
 
   Json::Value json_cfg;
@@ -24,3 +44,64 @@ TEST(DexOutput, checkMethodInstructionSizeLimit) {
       DexOutput::check_method_instruction_size_limit(conf, 65537, "method"),
       RedexException);
 }
+
+TEST_F(DexOutputIndexTest, indicesFollowDefaultOrder) {
+  // Names with long common prefixes, non-ASCII characters (MUTF-8 encoded)
+  // and encoded NULs.
+  std::vector<std::string> names = {
+      "a",
+      "averyLongCommonPrefix",
+      "averyLongCommonPrefix1",
+      "averyLongCommonPrefix\xc0\x80",
+      "averyLong\xc3\xa9",
+      "averyLong\xe4\xb8\xad",
+      "averyLong\xc0\x80",
+      "averyLong",
+      "b\xc3\xa9",
+      "b",
+  };
+  DexClasses classes;
+  for (const auto& cls_name : {"Lcom/example/Foo;", "Lcom/example/Foo2;",
+                               "Lcom/example/Fo\xc3\xa9;"}) {
+    ClassCreator creator(DexType::make_type(cls_name));
+    creator.set_super(type::java_lang_Object());
+    auto* cls = creator.create();
+    auto* proto = DexProto::make_proto(
+        type::_void(), DexTypeList::make_type_list({cls->get_type()}));
+    for (const auto& name : names) {
+      cls->add_method(DexMethod::make_method(cls->get_type(),
+                                             DexString::make_string(name),
+                                             proto)
+                          ->make_concrete(ACC_PUBLIC | ACC_STATIC, false));
+      cls->add_field(DexField::make_field(cls->get_type(),
+                                          DexString::make_string(name),
+                                          type::_int())
+                         ->make_concrete(ACC_PUBLIC | ACC_STATIC));
+    }
+    classes.push_back(cls);
+  }
+
+  GatheredTypes gtypes(&classes);
+  auto dodx = gtypes.get_dodx(nullptr);
+  EXPECT_LE(3 * names.size(), dodx.method_to_idx().size());
+  expect_sorted(dodx.string_to_idx(), compare_dexstrings);
+  expect_sorted(dodx.type_to_idx(), compare_dextypes);
+  expect_sorted(dodx.proto_to_idx(), compare_dexprotos);
+  expect_sorted(dodx.field_to_idx(), compare_dexfields);
+  expect_sorted(dodx.method_to_idx(), compare_dexmethods);
+}
+
+TEST(DexOutput, pageSetCountsDistinctPages) {
+  constexpr uint32_t kPage = DexPageSet::kPageSize;
+  DexPageSet pages;
+  EXPECT_EQ(pages.size(), 0);
+  pages.add(0, 1);
+  pages.add(kPage - 1, 2);
+  EXPECT_EQ(pages.size(), 2);
+  pages.add(3 * kPage, 0);
+  EXPECT_EQ(pages.size(), 2);
+  pages.add(3 * kPage, kPage);
+  EXPECT_EQ(pages.size(), 3);
+  pages.add(10, 3 * kPage);
+  EXPECT_EQ(pages.size(), 4);
+}
@@ -84,3 +84,51 @@ TEST_F(DexStructureTest, remove_class) {
   EXPECT_EQ(dex1.get_tref_occurrences(ty), 1);
   EXPECT_EQ(dex1.size(), 1);
 }
+
+TEST_F(DexStructureTest, compact) {
+  auto foo_cls = create_a_class("Lfoo;");
+  auto bar_cls = create_a_class("Lbar;");
+  auto baz_cls = create_a_class("Lbaz;");
+
+  DexesStructure dexes;
+  dexes.add_class_no_checks(foo_cls);
+  dexes.compact();
+
+  // Copies share the compacted classes, but not the ones added afterwards.
+  auto copy = dexes;
+  copy.add_class_no_checks(bar_cls);
+  dexes.add_class_no_checks(baz_cls);
+  dexes.compact();
+  copy.compact();
+
+  EXPECT_EQ(dexes.get_num_classes(), 2);
+  EXPECT_TRUE(dexes.has_class(foo_cls));
+  EXPECT_FALSE(dexes.has_class(bar_cls));
+  EXPECT_TRUE(dexes.has_class(baz_cls));
+
+  EXPECT_EQ(copy.get_num_classes(), 2);
+  EXPECT_TRUE(copy.has_class(foo_cls));
+  EXPECT_TRUE(copy.has_class(bar_cls));
+  EXPECT_FALSE(copy.has_class(baz_cls));
+}
+
+TEST_F(DexStructureTest, dense_ref_set) {
+  auto a = DexType::make_type("LA;");
+  auto b = DexType::make_type("LB;");
+  DenseRefSet<DexType> set;
+  EXPECT_FALSE(set.count(a));
+  set.insert(a);
+  EXPECT_TRUE(set.count(a));
+  EXPECT_FALSE(set.count(b));
+
+  // Types created after the set was resized are still handled.
+  auto c = DexType::make_type("LC;");
+  set.insert(c);
+  EXPECT_TRUE(set.count(c));
+  EXPECT_EQ(set.count_missing(std::unordered_set<DexType*>{a, b, c}), 1);
+
+  set.erase(a);
+  EXPECT_FALSE(set.count(a));
+  EXPECT_TRUE(set.count(c));
+  EXPECT_EQ(set.count_missing(std::vector<DexType*>{a, b, c}), 2);
+}
@@ -8,6 +8,7 @@
 #include "Dominators.h"
 
 #include <gtest/gtest.h>
+#include <random>
 
 #include <sparta/MonotonicFixpointIterator.h>
 
@@ -40,6 +41,76 @@ TEST(DominatorsTest, loop) {
   EXPECT_EQ(doms.get_idom(3), 0);
 }
 
+TEST(DominatorsTest, semiNCAMatchesIterative) {
+  // A large irreducible graph: a chain with random forward and backward jumps,
+  // and some nodes that cannot be reached from the entry.
+  std::mt19937 gen(42);
+  const uint32_t num_nodes = 3000;
+  std::uniform_int_distribution<uint32_t> node_dist(1, num_nodes - 1);
+  GraphInterface::Graph graph;
+  for (uint32_t i = 0; i + 1 < num_nodes; ++i) {
+    if (i % 97 != 96) {
+      graph.add_edge(i, i + 1);
+    }
+  }
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    graph.add_edge(node_dist(gen), node_dist(gen));
+  }
+  dominators::SimpleFastDominators<GraphInterface> iterative(
+      graph, dominators::Algorithm::Iterative);
+  dominators::SimpleFastDominators<GraphInterface> semi_nca(
+      graph, dominators::Algorithm::SemiNCA);
+  auto reachable = graph::postorder_sort<GraphInterface>(graph);
+  EXPECT_LT(reachable.size(), num_nodes);
+  for (auto node : reachable) {
+    EXPECT_EQ(iterative.get_idom(node), semi_nca.get_idom(node))
+        << "node " << node;
+  }
+
+  auto post_reachable = graph::postorder_sort<
+      sparta::BackwardsFixpointIterationAdaptor<GraphInterfaceWithExit>>(graph);
+  dominators::SimpleFastDominators<
+      sparta::BackwardsFixpointIterationAdaptor<GraphInterfaceWithExit>>
+      iterative_post(graph, dominators::Algorithm::Iterative);
+  dominators::SimpleFastDominators<
+      sparta::BackwardsFixpointIterationAdaptor<GraphInterfaceWithExit>>
+      semi_nca_post(graph, dominators::Algorithm::SemiNCA);
+  for (auto node : post_reachable) {
+    EXPECT_EQ(iterative_post.get_idom(node), semi_nca_post.get_idom(node))
+        << "node " << node;
+  }
+}
+
+TEST(DominatorsTest, dominanceFrontiers) {
+  //     +---+     +---+     +---+
+  //     | 0 | --> | 1 | --> | 3 | <-+
+  //     +---+     +---+     +---+   |
+  //       |                   |     |
+  //       |       +---+       v     |
+  //       +-----> | 2 | --> +---+   |
+  //               +---+     | 4 | --+
+  //                         +---+
+  GraphInterface::Graph graph;
+  graph.add_edge(0, 1);
+  graph.add_edge(0, 2);
+  graph.add_edge(1, 3);
+  graph.add_edge(2, 4);
+  graph.add_edge(3, 4);
+  graph.add_edge(4, 3);
+  for (auto algorithm :
+       {dominators::Algorithm::Iterative, dominators::Algorithm::SemiNCA}) {
+    dominators::SimpleFastDominators<GraphInterface> doms(graph, algorithm);
+    EXPECT_EQ(doms.get_idom(3), 0);
+    EXPECT_EQ(doms.get_idom(4), 0);
+    auto frontiers = doms.get_dominance_frontiers(graph);
+    EXPECT_EQ(frontiers.count(0), 0);
+    EXPECT_EQ(frontiers.at(1), std::vector<uint32_t>{3});
+    EXPECT_EQ(frontiers.at(2), std::vector<uint32_t>{4});
+    EXPECT_EQ(frontiers.at(3), std::vector<uint32_t>{4});
+    EXPECT_EQ(frontiers.at(4), std::vector<uint32_t>{3});
+  }
+}
+
 TEST(GraphUtilTest, doubleLoop) {
   {
     //                 +---------+
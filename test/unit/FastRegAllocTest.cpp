@@ -8,6 +8,8 @@
 #include "IRAssembler.h"
 #include "LinearScan.h"
 #include "RedexTest.h"
+#include "RegisterAllocation.h"
+#include "Show.h"
 
 struct FastRegAllocTest : public RedexTest {
   FastRegAllocTest() { g_redex->instrument_mode = false; }
@@ -479,3 +481,104 @@ TEST_F(FastRegAllocTest, CheckCast2) {
 )");
   EXPECT_CODE_EQ(method->get_code(), expected_code.get());
 }
+
+namespace {
+
+bool allocate_encodable(DexMethod* method) {
+  {
+    fastregalloc::LinearScanAllocator allocator(
+        method, /* satisfy_encoding_constraints */ true);
+    allocator.allocate();
+  }
+  auto* code = method->get_code();
+  code->build_cfg();
+  bool result = regalloc::satisfies_encoding_constraints(code->cfg());
+  code->clear_cfg();
+  return result;
+}
+
+} // namespace
+
+TEST_F(FastRegAllocTest, ParamsAtEndOfFrame) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(IJ)J"
+      (
+        (load-param v0)
+        (load-param-wide v1)
+        (int-to-long v2 v0)
+        (add-long v4 v2 v1)
+        (return-wide v4)
+      )
+    )
+)");
+  EXPECT_TRUE(allocate_encodable(method));
+}
+
+TEST_F(FastRegAllocTest, NonContiguousRangeInvoke) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(IIIIII)V"
+      (
+        (load-param v0)
+        (load-param v1)
+        (load-param v2)
+        (load-param v3)
+        (load-param v4)
+        (load-param v5)
+        (invoke-static (v5 v4 v3 v2 v1 v0) "LFoo;.baz:(IIIIII)V")
+        (return-void)
+      )
+    )
+)");
+  EXPECT_TRUE(allocate_encodable(method));
+}
+
+TEST_F(FastRegAllocTest, OperandsBeyondInstructionWidth) {
+  // Keep more than 16 values alive across an iget, whose operands only have
+  // 4 bits.
+  const size_t num_values = 20;
+  std::string body = "(load-param-object v100)\n";
+  for (size_t i = 0; i < num_values; ++i) {
+    body += "(const v" + std::to_string(i) + " " + std::to_string(i) + ")\n";
+  }
+  body += "(iget v100 \"LFoo;.f:I\")\n(move-result-pseudo v50)\n";
+  for (size_t i = 0; i < num_values; ++i) {
+    body += "(add-int v50 v50 v" + std::to_string(i) + ")\n";
+  }
+  body += "(return v50)\n";
+  auto method = assembler::method_from_string(
+      "(method (public static) \"LFoo;.bar:(LFoo;)I\" (" + body + "))");
+  EXPECT_TRUE(allocate_encodable(method));
+}
+
+TEST_F(FastRegAllocTest, NoOverwriteThis) {
+  auto method = assembler::method_from_string(R"(
+    (method (public) "LFoo;.bar:(I)LFoo;"
+      (
+        (load-param-object v0)
+        (load-param v1)
+        (if-eqz v1 :true-label)
+        (sget-object "LFoo;.foo:LFoo;")
+        (move-result-pseudo-object v0)
+        (:true-label)
+        (return-object v0)
+      )
+    )
+)");
+  {
+    fastregalloc::LinearScanAllocator allocator(
+        method, /* satisfy_encoding_constraints */ true,
+        /* no_overwrite_this */ true);
+    allocator.allocate();
+  }
+  auto* code = method->get_code();
+  code->build_cfg();
+  EXPECT_TRUE(regalloc::satisfies_encoding_constraints(code->cfg()));
+  auto param_insns = code->cfg().get_param_instructions();
+  auto* this_insn = param_insns.begin()->insn;
+  for (const auto& mie : InstructionIterable(code->cfg())) {
+    if (mie.insn != this_insn && mie.insn->has_dest()) {
+      EXPECT_NE(mie.insn->dest(), this_insn->dest()) << show(mie.insn);
+    }
+  }
+  code->clear_cfg();
+}
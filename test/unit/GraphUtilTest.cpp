@@ -85,3 +85,27 @@ TEST(GraphUtilTest, postorder_tree_crossedge) {
   const auto& sorted = postorder_sort<GraphInterface>(graph);
   EXPECT_EQ(sorted, std::vector<uint32_t>({2, 4, 3, 1, 0}));
 }
+
+/*
+ *  0 -> 1 <-> 2 -> 3
+ *  |              ^
+ *  +-> 4 (self) --+
+ */
+TEST(GraphUtilTest, strongly_connected_components) {
+  // Successors of 0: 1, 4; of 1: 2; of 2: 1, 3; of 3: none; of 4: 4, 3.
+  std::vector<uint32_t> succ_offsets{0, 2, 3, 5, 5, 7};
+  std::vector<uint32_t> succs{1, 4, 2, 1, 3, 4, 3};
+  std::vector<uint32_t> component_of;
+  auto sccs = strongly_connected_components(succ_offsets, succs, &component_of);
+  ASSERT_EQ(sccs.size(), 4);
+  EXPECT_EQ(component_of[1], component_of[2]);
+  EXPECT_EQ(sccs[component_of[1]].size(), 2);
+  for (uint32_t v : {0, 3, 4}) {
+    EXPECT_EQ(sccs[component_of[v]], std::vector<uint32_t>{v});
+  }
+  // Components come after the ones they reach.
+  EXPECT_LT(component_of[3], component_of[1]);
+  EXPECT_LT(component_of[3], component_of[4]);
+  EXPECT_LT(component_of[1], component_of[0]);
+  EXPECT_LT(component_of[4], component_of[0]);
+}
@@ -252,3 +252,30 @@ TEST_F(IRCodeTest, encode_large_packed_switch) {
   EXPECT_EQ(dod->data_size(), 1 + 2 + 2 * kTargetCount);
   EXPECT_EQ(dod->data()[0], kTargetCount);
 }
+
+TEST_F(IRCodeTest, build_cfg_keeps_editable_cfg) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :true)
+      (const v0 1)
+      (:true)
+      (return v0)
+    )
+  )");
+  auto before = IRCode::get_cfg_cycle_counts();
+  code->build_cfg();
+  auto* cfg = &code->cfg();
+  code->build_cfg();
+  EXPECT_EQ(cfg, &code->cfg());
+  auto after = IRCode::get_cfg_cycle_counts();
+  EXPECT_EQ(1, after.builds - before.builds);
+  EXPECT_EQ(0, after.linearizations - before.linearizations);
+
+  code->build_cfg(/* editable */ true,
+                  /* rebuild_editable_even_if_already_built */ true);
+  code->clear_cfg();
+  after = IRCode::get_cfg_cycle_counts();
+  EXPECT_EQ(2, after.builds - before.builds);
+  EXPECT_EQ(2, after.linearizations - before.linearizations);
+}
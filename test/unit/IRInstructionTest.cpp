@@ -412,6 +412,26 @@ TEST_F(IRInstructionTest, InvokeSourceIsWideComplex2) {
   delete insn;
 }
 
+TEST_F(IRInstructionTest, ResizeSrcsAcrossInlineLimit) {
+  IRInstruction insn(OPCODE_INVOKE_STATIC);
+  for (size_t size = 0; size <= 8; ++size) {
+    insn.set_srcs_size(size);
+    for (size_t i = 0; i < size; ++i) {
+      insn.set_src(i, i + 1);
+    }
+    IRInstruction copy(insn);
+    EXPECT_EQ(insn, copy);
+    ASSERT_EQ(size, copy.srcs_size());
+    for (size_t i = 0; i < size; ++i) {
+      EXPECT_EQ(i + 1, copy.src(i));
+    }
+  }
+  // Shrinking back into the inline storage retains the leading registers.
+  insn.set_srcs_size(3);
+  EXPECT_EQ(3, insn.srcs_size());
+  EXPECT_EQ(std::vector<reg_t>({1, 2, 3}), insn.srcs_vec());
+}
+
 TEST_F(IRInstructionTest, CopyInstructionWithData) {
   IRInstruction* insn = new IRInstruction(OPCODE_FILL_ARRAY_DATA);
   insn->set_src(0, 0);
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRPoolAllocator.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using Pool = ir_pool::FixedSizePool<24>;
+
+} // namespace
+
+TEST(IRPoolAllocatorTest, reusesFreedSlots) {
+  void* a = Pool::allocate();
+  void* b = Pool::allocate();
+  EXPECT_NE(a, b);
+  Pool::deallocate(a);
+  EXPECT_EQ(a, Pool::allocate());
+  Pool::deallocate(a);
+  Pool::deallocate(b);
+}
+
+TEST(IRPoolAllocatorTest, distinctAndAlignedSlots) {
+  std::vector<void*> ptrs;
+  std::unordered_set<void*> unique;
+  // Span several chunks.
+  for (size_t i = 0; i < 10000; ++i) {
+    ptrs.push_back(Pool::allocate());
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptrs.back()) %
+                     alignof(std::max_align_t));
+    unique.insert(ptrs.back());
+  }
+  EXPECT_EQ(ptrs.size(), unique.size());
+  for (auto* p : ptrs) {
+    Pool::deallocate(p);
+  }
+}
+
+TEST(IRPoolAllocatorTest, freeListOfExitedThreadIsAdopted) {
+  std::vector<void*> ptrs;
+  std::thread t([&]() {
+    using OtherPool = ir_pool::FixedSizePool<40>;
+    void* p = OtherPool::allocate();
+    OtherPool::deallocate(p);
+    ptrs.push_back(p);
+  });
+  t.join();
+  using OtherPool = ir_pool::FixedSizePool<40>;
+  void* p = OtherPool::allocate();
+  EXPECT_EQ(ptrs.front(), p);
+  OtherPool::deallocate(p);
+}
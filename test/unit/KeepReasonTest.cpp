@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "KeepReason.h"
+#include "RedexTest.h"
+#include "ReferencedState.h"
+
+using namespace keep_reason;
+
+class KeepReasonTest : public RedexTest {
+ public:
+  KeepReasonTest() { Reason::set_record_keep_reasons(true); }
+  ~KeepReasonTest() { Reason::set_record_keep_reasons(false); }
+};
+
+TEST_F(KeepReasonTest, reasonsAreInterned) {
+  auto* m1 =
+      DexMethod::make_method("LFoo;.bar:()V")->make_concrete(ACC_PUBLIC, false);
+  auto* m2 =
+      DexMethod::make_method("LFoo;.baz:()V")->make_concrete(ACC_PUBLIC, false);
+
+  auto* manifest = Reason::make_keep_reason(MANIFEST);
+  EXPECT_EQ(manifest, Reason::make_keep_reason(MANIFEST));
+  auto* refl1 = Reason::make_keep_reason(REFLECTION, m1);
+  auto* refl2 = Reason::make_keep_reason(REFLECTION, m2);
+  EXPECT_NE(refl1, refl2);
+  EXPECT_EQ(refl1, Reason::make_keep_reason(REFLECTION, m1));
+
+  EXPECT_NE(manifest->id, refl1->id);
+  EXPECT_NE(refl1->id, refl2->id);
+  for (const auto* reason : {manifest, refl1, refl2}) {
+    EXPECT_EQ(reason, Reason::get(reason->id));
+  }
+}
+
+TEST_F(KeepReasonTest, membersStoreEachReasonOnce) {
+  auto* m =
+      DexMethod::make_method("LFoo;.bar:()V")->make_concrete(ACC_PUBLIC, false);
+
+  ReferencedState state(RefStateType::MethodState);
+  EXPECT_TRUE(state.keep_reasons().empty());
+  state.set_root(REFLECTION, m);
+  state.set_root(MANIFEST);
+  state.set_root(REFLECTION, m);
+  state.set_root(MANIFEST);
+  EXPECT_THAT(state.keep_reasons(),
+              ::testing::UnorderedElementsAre(
+                  Reason::make_keep_reason(MANIFEST),
+                  Reason::make_keep_reason(REFLECTION, m)));
+
+  ReferencedState copy(RefStateType::MethodState);
+  copy = state;
+  EXPECT_EQ(copy.keep_reasons(), state.keep_reasons());
+}
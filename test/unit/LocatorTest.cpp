@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <locator.h>
+
+using facebook::Locator;
+
+TEST(LocatorTest, GlobalClassIndexRoundtrip) {
+  for (uint32_t index : {0u, 1u, 61u, 62u, 12345u}) {
+    char buf[Locator::encoded_global_class_index_max];
+    Locator::encodeGlobalClassIndex(index, 4, buf);
+    EXPECT_EQ(Locator::decodeGlobalClassIndex(buf), index) << buf;
+  }
+  EXPECT_EQ(Locator::decodeGlobalClassIndex("LFoo;"),
+            Locator::invalid_global_class_index);
+}
+
+TEST(LocatorTest, ClassIndexTableLookup) {
+  std::vector<std::pair<std::string, uint32_t>> classes;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    classes.emplace_back("Lcom/foo/Cls" + std::to_string(i) + ";", 3 * i + 7);
+  }
+  auto table = Locator::makeClassIndexTable(classes);
+  // Use word storage, as lookups require an aligned table.
+  std::vector<uint32_t> aligned((table.size() + 3) / 4);
+  memcpy(aligned.data(), table.data(), table.size());
+
+  for (const auto& [name, index] : classes) {
+    EXPECT_EQ(Locator::lookupGlobalClassIndex(aligned.data(), table.size(),
+                                              name.c_str()),
+              index)
+        << name;
+  }
+  for (const char* absent :
+       {"Lcom/foo/Cls1000;", "Lcom/foo/Cls1", "", "Lcom/foo/Cls12;x"}) {
+    EXPECT_EQ(Locator::lookupGlobalClassIndex(aligned.data(), table.size(),
+                                              absent),
+              Locator::invalid_global_class_index)
+        << absent;
+  }
+  // A truncated table is rejected rather than read out of bounds.
+  EXPECT_EQ(Locator::lookupGlobalClassIndex(aligned.data(), 16,
+                                            classes[0].first.c_str()),
+            Locator::invalid_global_class_index);
+}
+
+TEST(LocatorTest, EmptyClassIndexTable) {
+  auto table = Locator::makeClassIndexTable({});
+  std::vector<uint32_t> aligned((table.size() + 3) / 4);
+  memcpy(aligned.data(), table.data(), table.size());
+  EXPECT_EQ(
+      Locator::lookupGlobalClassIndex(aligned.data(), table.size(), "LFoo;"),
+      Locator::invalid_global_class_index);
+}
+
+TEST(LocatorTest, ClassIndexTableRejectsDuplicates) {
+  EXPECT_THROW(Locator::makeClassIndexTable({{"LFoo;", 0}, {"LFoo;", 1}}),
+               std::runtime_error);
+}
@@ -97,3 +97,37 @@ TEST_F(LoopInfoTest, construct_level_order_traversal) {
   EXPECT_EQ(level_order.at(1).get().head_node(), "9");
   EXPECT_EQ(level_order.at(2).get().head_node(), "5");
 }
+
+TEST_F(LoopInfoTest, cached_loop_info) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (:loop)
+      (if-eqz v0 :end)
+      (add-int/lit v0 v0 -1)
+      (goto :loop)
+      (:end)
+      (return v0)
+    )
+  )");
+  code->build_cfg();
+  const auto& cfg = code->cfg();
+
+  auto info = loop_impl::get_cached_loop_info(cfg);
+  EXPECT_EQ(info->num_loops(), 1);
+  EXPECT_EQ(info->max_loop_depth(), 1);
+  EXPECT_EQ(info->get_loop_for(cfg.entry_block()), nullptr);
+  const auto* loop_head = cfg.entry_block()->goes_to();
+  ASSERT_NE(info->get_loop_for(loop_head), nullptr);
+  EXPECT_EQ(info->get_loop_for(loop_head)->get_loop_depth(), 1);
+  EXPECT_EQ(info, loop_impl::get_cached_loop_info(cfg));
+
+  // Changing the structure invalidates the cached loops.
+  auto& mutable_cfg = code->cfg();
+  mutable_cfg.insert_block(mutable_cfg.entry_block(),
+                           mutable_cfg.entry_block()->goes_to(),
+                           mutable_cfg.create_block());
+  auto new_info = loop_impl::get_cached_loop_info(cfg);
+  EXPECT_NE(info, new_info);
+  EXPECT_EQ(new_info->num_loops(), 1);
+}
@@ -126,6 +126,34 @@ TEST_F(MatchFlowTest, NoResults) {
   EXPECT_INSNS(res.matching(lit));
 }
 
+TEST_F(MatchFlowTest, AnchorOpcodes) {
+  flow_t f;
+  auto lit = f.insn(m::const_());
+  auto add = f.insn(m::add_int_()).src(0, lit, exists | dest);
+
+  auto code = assembler::ircode_from_string(R"((
+    (const v0 0)
+    (add-int v0 v0 v0)
+    (return-void)
+  ))");
+
+  cfg::ScopedCFG cfg{code.get()};
+  auto ii = InstructionIterable(*cfg);
+  auto mies = IndexedWrapper{ii};
+
+  ASSERT_INSN(const_0, mies[0], OPCODE_CONST);
+  ASSERT_INSN(add_int, mies[1], OPCODE_ADD_INT);
+
+  auto missing = f.find(*cfg, {add}, {OPCODE_SUB_INT, OPCODE_MUL_INT});
+  EXPECT_INSNS(missing.matching(add));
+  EXPECT_INSNS(missing.matching(add, add_int, 0));
+  EXPECT_INSNS(missing.matching(lit));
+
+  auto present = f.find(*cfg, {add}, {OPCODE_SUB_INT, OPCODE_ADD_INT});
+  EXPECT_INSNS(present.matching(add), add_int);
+  EXPECT_INSNS(present.matching(add, add_int, 0), const_0);
+}
+
 TEST_F(MatchFlowTest, MultipleResults) {
   flow_t f;
 
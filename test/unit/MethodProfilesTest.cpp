@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodProfiles.h"
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+using namespace method_profiles;
+
+class MethodProfilesTest : public RedexTest {};
+
+TEST_F(MethodProfilesTest, binaryRoundTrip) {
+  auto tmp_dir = redex::make_tmp_dir("MethodProfilesTest%%%%%%%%");
+  auto csv_path = tmp_dir.path + "/profile.csv";
+  auto binary_path = tmp_dir.path + "/profile.bin";
+  {
+    std::ofstream ofs(csv_path);
+    ofs << "interaction,appear#\n"
+        << "ColdStart,10\n"
+        << "index,name,appear100,appear#,avg_call,avg_order,avg_rank100,"
+           "min_api_level\n"
+        << "0,LFoo;.bar:()V,90.0,9,2.5,1,10.0,21\n"
+        << "1,LFoo;.baz:(I)V,40.0,4,1.5,3,30.0,21\n"
+        << "2,LFoo;.missing:()V,50.0,5,1.0,2,20.0,23\n";
+  }
+  auto* bar = DexMethod::make_method("LFoo;.bar:()V");
+  ASSERT_TRUE(MethodProfiles::convert_to_binary(csv_path, binary_path));
+  // Only known after the conversion.
+  auto* baz = DexMethod::make_method("LFoo;.baz:(I)V");
+
+  MethodProfiles from_csv;
+  from_csv.initialize({csv_path});
+  MethodProfiles from_binary;
+  from_binary.initialize({binary_path});
+  for (auto* profiles : {&from_csv, &from_binary}) {
+    EXPECT_EQ(2, profiles->size());
+    EXPECT_EQ(1, profiles->unresolved_size());
+    EXPECT_EQ(10, *profiles->get_interaction_count(COLD_START));
+
+    auto bar_stats = profiles->get_method_stat(COLD_START, bar);
+    ASSERT_TRUE(bar_stats);
+    EXPECT_EQ(90.0, bar_stats->appear_percent);
+    EXPECT_EQ(2.5, bar_stats->call_count);
+    EXPECT_EQ(10.0, bar_stats->order_percent);
+    EXPECT_EQ(21, bar_stats->min_api_level);
+
+    auto baz_stats = profiles->get_method_stat(COLD_START, baz);
+    ASSERT_TRUE(baz_stats);
+    EXPECT_EQ(40.0, baz_stats->appear_percent);
+  }
+
+  auto* missing = DexMethod::make_method("LFoo;.missing:()V");
+  for (auto* profiles : {&from_csv, &from_binary}) {
+    profiles->process_unresolved_lines();
+    EXPECT_EQ(0, profiles->unresolved_size());
+    auto missing_stats = profiles->get_method_stat(COLD_START, missing);
+    ASSERT_TRUE(missing_stats);
+    EXPECT_EQ(50.0, missing_stats->appear_percent);
+    EXPECT_EQ(23, missing_stats->min_api_level);
+  }
+}
+
+TEST_F(MethodProfilesTest, frozenLookups) {
+  auto* foo = DexMethod::make_method("LFoo;.foo:()V")->make_concrete(
+      ACC_PUBLIC, false);
+  auto* bar = DexMethod::make_method("LFoo;.bar:()V")->make_concrete(
+      ACC_PUBLIC, false);
+  auto profiles = MethodProfiles::initialize(
+      COLD_START, {{foo, Stats{90.0, 2.5, 10.0, 21}}});
+  auto index = profiles.get_interaction_index(COLD_START);
+  ASSERT_TRUE(index);
+  EXPECT_FALSE(profiles.get_interaction_index("Other"));
+
+  profiles.freeze();
+  EXPECT_TRUE(profiles.is_frozen());
+  auto foo_stats = profiles.get_method_stat(*index, foo);
+  ASSERT_TRUE(foo_stats);
+  EXPECT_EQ(90.0, foo_stats->appear_percent);
+  EXPECT_FALSE(profiles.get_method_stat(*index, bar));
+  // Created after freezing.
+  auto* baz = DexMethod::make_method("LFoo;.baz:()V");
+  EXPECT_FALSE(profiles.get_method_stat(COLD_START, baz));
+
+  // Changing the stats drops the frozen form.
+  EXPECT_EQ(1, profiles.derive_stats(bar, {foo}));
+  EXPECT_FALSE(profiles.is_frozen());
+  EXPECT_TRUE(profiles.get_method_stat(*index, bar));
+  profiles.freeze();
+  auto bar_stats = profiles.get_method_stat(*index, bar);
+  ASSERT_TRUE(bar_stats);
+  EXPECT_EQ(*foo_stats, *bar_stats);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexStore.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+namespace {
+
+// The passes that ran in this process, in order.
+std::vector<std::string> s_ran;
+
+class RecordingPass : public Pass {
+ public:
+  explicit RecordingPass(const std::string& name) : Pass(name) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    s_ran.push_back(name());
+  }
+};
+
+Json::Value make_config(const std::vector<Pass*>& passes) {
+  Json::Value config(Json::objectValue);
+  config["redex"] = Json::objectValue;
+  config["redex"]["passes"] = Json::arrayValue;
+  for (auto* pass : passes) {
+    config["redex"]["passes"].append(pass->name());
+  }
+  return config;
+}
+
+void run_passes(const std::vector<Pass*>& passes, Json::Value config) {
+  ConfigFiles conf(config);
+  conf.parse_global_config();
+
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  DexStore root_store("classes");
+  root_store.add_classes({creator.create()});
+  DexStoresVector stores{root_store};
+  PassManager manager(passes, conf);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+
+  if (const auto& checkpoint = manager.get_checkpoint()) {
+    // Forked checkpoint child: leave what a resume needs for the parent, like
+    // redex-all does, and get out of the way.
+    std::ofstream out(checkpoint->dir + "/checkpoint.txt");
+    for (const auto& name : s_ran) {
+      out << "ran " << name << "\n";
+    }
+    for (const auto& name : checkpoint->passes_run_for_output) {
+      out << "for_output " << name << "\n";
+    }
+    for (const auto& name : checkpoint->next_passes) {
+      out << "next " << name << "\n";
+    }
+    out.close();
+    _exit(out ? 0 : 1);
+  }
+}
+
+} // namespace
+
+class PassManagerCheckpointTest : public RedexTest {};
+
+TEST_F(PassManagerCheckpointTest, resumeRunsEveryPassOnce) {
+  RecordingPass first("FirstPass");
+  RecordingPass make_public("MakePublicPass");
+  RecordingPass last("LastPass");
+  std::vector<Pass*> passes{&first, &make_public, &last};
+
+  auto dir = redex::make_tmp_dir("redex_checkpoint_test_%%%%%%%%");
+  auto config = make_config(passes);
+  config["checkpoint_after_pass"] = "FirstPass";
+  config["checkpoint_dir"] = dir.path;
+  run_passes(passes, config);
+  // The parent runs the whole pipeline as usual.
+  EXPECT_EQ(s_ran, std::vector<std::string>(
+                       {"FirstPass", "MakePublicPass", "LastPass"}));
+
+  std::vector<std::string> child_ran;
+  std::vector<std::string> for_output;
+  std::vector<std::string> next;
+  std::ifstream in(dir.path + "/checkpoint.txt");
+  ASSERT_TRUE(in);
+  std::string kind;
+  std::string name;
+  while (in >> kind >> name) {
+    (kind == "ran" ? child_ran : kind == "for_output" ? for_output : next)
+        .push_back(name);
+  }
+  // MakePublicPass is run for the snapshot and is not repeated on resume.
+  EXPECT_EQ(child_ran,
+            std::vector<std::string>({"FirstPass", "MakePublicPass"}));
+  EXPECT_EQ(for_output, std::vector<std::string>({"MakePublicPass"}));
+  EXPECT_EQ(next, std::vector<std::string>({"LastPass"}));
+
+  // Resume with the remaining passes, like redex-opt --resume.
+  s_ran.clear();
+  std::vector<Pass*> resumed;
+  for (auto* pass : passes) {
+    if (std::find(next.begin(), next.end(), pass->name()) != next.end()) {
+      resumed.push_back(pass);
+    }
+  }
+  run_passes(resumed, make_config(resumed));
+  child_ran.insert(child_ran.end(), s_ran.begin(), s_ran.end());
+  EXPECT_EQ(child_ran, std::vector<std::string>(
+                           {"FirstPass", "MakePublicPass", "LastPass"}));
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexStore.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+namespace {
+
+constexpr int64_t N = 10000;
+
+class ParallelMetricsPass : public Pass {
+ public:
+  explicit ParallelMetricsPass(const std::string& name) : Pass(name) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager& mgr) override {
+    workqueue_run_for<int64_t>(
+        0, N, [&](int64_t i) { mgr.incr_metric("sum", i); }, 4);
+    // Setting and reading a metric sees all preceding increments.
+    mgr.incr_metric("count", 1);
+    mgr.set_metric("sum_seen", mgr.get_metric("sum"));
+    workqueue_run_for<int64_t>(
+        0, N, [&](int64_t) { mgr.incr_metric("count", 1); }, 4);
+  }
+};
+
+} // namespace
+
+class PassManagerMetricsTest : public RedexTest {};
+
+TEST_F(PassManagerMetricsTest, parallelIncrementsAreMergedPerPass) {
+  ParallelMetricsPass first("FirstMetricsPass");
+  ParallelMetricsPass second("SecondMetricsPass");
+
+  Json::Value config(Json::objectValue);
+  config["redex"] = Json::objectValue;
+  config["redex"]["passes"] = Json::arrayValue;
+  config["redex"]["passes"].append("FirstMetricsPass");
+  config["redex"]["passes"].append("SecondMetricsPass");
+  ConfigFiles conf(config);
+  conf.parse_global_config();
+
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  DexStore root_store("classes");
+  root_store.add_classes({creator.create()});
+  DexStoresVector stores{root_store};
+  std::vector<Pass*> passes{&first, &second};
+  PassManager manager(passes, conf);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+
+  size_t checked = 0;
+  for (const auto& pass_info : manager.get_pass_info()) {
+    if (pass_info.pass != &first && pass_info.pass != &second) {
+      continue;
+    }
+    ++checked;
+    EXPECT_EQ(N * (N - 1) / 2, pass_info.metrics.at("sum")) << pass_info.name;
+    EXPECT_EQ(N * (N - 1) / 2, pass_info.metrics.at("sum_seen"))
+        << pass_info.name;
+    EXPECT_EQ(N + 1, pass_info.metrics.at("count")) << pass_info.name;
+  }
+  EXPECT_EQ(2, checked);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexStore.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+
+namespace {
+
+std::mutex s_mutex;
+std::condition_variable s_cv;
+size_t s_started{0};
+size_t s_finished{0};
+
+class CheckerPass : public Pass {
+ public:
+  explicit CheckerPass(const std::string& name) : Pass(name) {}
+
+  bool is_read_only() const override { return true; }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager& mgr) override {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    ++s_started;
+    s_cv.notify_all();
+    // Only returns early if the other checker runs at the same time.
+    s_cv.wait_for(lock, std::chrono::seconds(60),
+                  [] { return s_started == 2; });
+    mgr.set_metric("started_checkers", s_started);
+    mgr.incr_metric(name(), 1);
+    ++s_finished;
+  }
+};
+
+class WriterPass : public Pass {
+ public:
+  WriterPass() : Pass("WriterPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager& mgr) override {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    mgr.set_metric("finished_checkers", s_finished);
+  }
+};
+
+} // namespace
+
+class PassManagerReadOnlyTest : public RedexTest {};
+
+TEST_F(PassManagerReadOnlyTest, readOnlyPassesRunConcurrently) {
+  CheckerPass first("FirstCheckerPass");
+  CheckerPass second("SecondCheckerPass");
+  WriterPass writer;
+  std::vector<Pass*> passes{&first, &second, &writer};
+
+  Json::Value config(Json::objectValue);
+  config["redex"] = Json::objectValue;
+  config["redex"]["passes"] = Json::arrayValue;
+  for (auto* pass : passes) {
+    config["redex"]["passes"].append(pass->name());
+  }
+  ConfigFiles conf(config);
+  conf.parse_global_config();
+
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  DexStore root_store("classes");
+  root_store.add_classes({creator.create()});
+  DexStoresVector stores{root_store};
+  PassManager manager(passes, conf);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+
+  size_t checked = 0;
+  for (const auto& pass_info : manager.get_pass_info()) {
+    if (pass_info.pass == &first || pass_info.pass == &second) {
+      ++checked;
+      EXPECT_EQ(2, pass_info.metrics.at("started_checkers")) << pass_info.name;
+      // Metrics go to the pass that reports them.
+      EXPECT_EQ(1, pass_info.metrics.count(pass_info.name)) << pass_info.name;
+      EXPECT_EQ(0, pass_info.metrics.count(
+                       pass_info.pass == &first ? second.name() : first.name()))
+          << pass_info.name;
+    } else if (pass_info.pass == &writer) {
+      ++checked;
+      // The next pass that may write waits for all checkers.
+      EXPECT_EQ(2, pass_info.metrics.at("finished_checkers"));
+    }
+  }
+  EXPECT_EQ(3, checked);
+}
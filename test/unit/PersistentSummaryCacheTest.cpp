@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PersistentSummaryCache.h"
+
+#include <gtest/gtest.h>
+
+#include "RedexTestUtils.h"
+
+namespace {
+
+struct TestSummary {
+  int32_t value;
+
+  static TestSummary from_s_expr(const sparta::s_expr& expr) {
+    return TestSummary{expr.get_int32()};
+  }
+};
+
+sparta::s_expr to_s_expr(const TestSummary& summary) {
+  return sparta::s_expr(summary.value);
+}
+
+} // namespace
+
+TEST(PersistentSummaryCacheTest, roundTrip) {
+  auto tmp_dir = redex::make_tmp_dir("PersistentSummaryCacheTest%%%%%%%%");
+  auto key1 = PersistentSummaryCache::make_key("method1");
+  auto key2 = PersistentSummaryCache::make_key("method2");
+  EXPECT_NE(key1, key2);
+  {
+    PersistentSummaryCache cache(tmp_dir.path, "test", "1");
+    EXPECT_FALSE(cache.get<TestSummary>(key1));
+    cache.put(key1, TestSummary{42});
+    cache.put(key2, TestSummary{-1});
+    cache.save();
+    EXPECT_EQ(0, cache.hits());
+    EXPECT_EQ(1, cache.misses());
+  }
+  {
+    PersistentSummaryCache cache(tmp_dir.path, "test", "1");
+    auto summary = cache.get<TestSummary>(key1);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ(42, summary->value);
+    EXPECT_EQ(1, cache.hits());
+    // Only the entry that was used survives.
+    cache.save();
+  }
+  {
+    PersistentSummaryCache cache(tmp_dir.path, "test", "1");
+    EXPECT_TRUE(cache.get<TestSummary>(key1));
+    EXPECT_FALSE(cache.get<TestSummary>(key2));
+  }
+}
+
+TEST(PersistentSummaryCacheTest, versionMismatch) {
+  auto tmp_dir = redex::make_tmp_dir("PersistentSummaryCacheTest%%%%%%%%");
+  auto key = PersistentSummaryCache::make_key("method");
+  {
+    PersistentSummaryCache cache(tmp_dir.path, "test", "1");
+    cache.put(key, TestSummary{1});
+    cache.save();
+  }
+  PersistentSummaryCache cache(tmp_dir.path, "test", "2");
+  EXPECT_FALSE(cache.get<TestSummary>(key));
+}
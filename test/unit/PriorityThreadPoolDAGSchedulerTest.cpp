@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PriorityThreadPoolDAGScheduler.h"
+
+#include <functional>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <vector>
+
+TEST(PriorityThreadPoolTest, highestPriorityFirst) {
+  PriorityThreadPool pool(1);
+  std::mutex mutex;
+  std::vector<int> order;
+  // Block the only worker until all work items have been posted.
+  std::mutex blocker;
+  blocker.lock();
+  pool.post(100, [&]() { std::lock_guard<std::mutex> lock(blocker); });
+  for (int i = 0; i < 10; ++i) {
+    pool.post(i, [&, i]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(i);
+    });
+  }
+  blocker.unlock();
+  pool.join();
+  ASSERT_EQ(10, order.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(9 - i, order[i]);
+  }
+}
+
+TEST(PriorityThreadPoolTest, manyShards) {
+  const int num_threads = 4 * PriorityThreadPool::THREADS_PER_SHARD;
+  PriorityThreadPool pool(num_threads);
+  std::atomic<size_t> count{0};
+  for (int i = 0; i < 1000; ++i) {
+    pool.post(i % 7, [&pool, &count, i]() {
+      count++;
+      if (i % 10 == 0) {
+        // Work items posted from workers go to the worker's own shard.
+        pool.post(i, [&count]() { count++; });
+      }
+    });
+  }
+  pool.join();
+  EXPECT_EQ(1100, count);
+}
+
+TEST(PriorityThreadPoolTest, waitCoversWorkPostedFromWorkItems) {
+  PriorityThreadPool pool(8);
+  // Each work item posts its children before it finishes, so wait() must not
+  // return as long as any part of a tree is still pending or running.
+  std::atomic<size_t> finished{0};
+  std::function<void(int)> tree = [&](int depth) {
+    if (depth > 0) {
+      for (int i = 0; i < 2; ++i) {
+        pool.post(depth, [&tree, depth]() { tree(depth - 1); });
+      }
+    }
+    finished++;
+  };
+  // A tree of depth 4 has 2^5 - 1 work items. Posting a single root right
+  // before waiting makes the root likely to be taken while wait() checks
+  // whether the pool is done.
+  const size_t tree_size = 31;
+  for (size_t round = 1; round <= 5000; ++round) {
+    pool.post(0, [&tree]() { tree(4); });
+    pool.wait();
+    ASSERT_EQ(round * tree_size, finished.load()) << "round " << round;
+  }
+  pool.join();
+}
+
+TEST(PriorityThreadPoolDAGSchedulerTest, dependenciesRunFirst) {
+  for (int num_threads : {1, 3 * (int)PriorityThreadPool::THREADS_PER_SHARD}) {
+    // A chain of diamonds: 0 <- {1, 2} <- 3 <- {4, 5} <- 6 ...
+    constexpr int kNumTasks = 301;
+    std::vector<std::atomic<bool>> done(kNumTasks);
+    std::atomic<size_t> violations{0};
+    std::atomic<size_t> augmented{0};
+    PriorityThreadPoolDAGScheduler<int> scheduler([](int) {}, num_threads);
+    auto dependencies = [](int task) -> std::vector<int> {
+      if (task == 0) {
+        return {};
+      }
+      if (task % 3 == 0) {
+        return {task - 1, task - 2};
+      }
+      return {(task - 1) / 3 * 3};
+    };
+    scheduler.set_executor([&](int task) {
+      for (auto dependency : dependencies(task)) {
+        if (!done[dependency]) {
+          violations++;
+        }
+      }
+      scheduler.augment(task, [&augmented]() { augmented++; });
+      scheduler.augment(
+          task, [&done, task]() { done[task] = true; },
+          /* continuation */ true);
+    });
+    std::vector<int> tasks;
+    for (int task = 0; task < kNumTasks; ++task) {
+      tasks.push_back(task);
+      for (auto dependency : dependencies(task)) {
+        scheduler.add_dependency(task, dependency);
+      }
+    }
+    auto max_priority = scheduler.run(tasks.begin(), tasks.end());
+    EXPECT_EQ(200, max_priority);
+    EXPECT_EQ(0, violations);
+    EXPECT_EQ(kNumTasks, augmented);
+    for (int task = 0; task < kNumTasks; ++task) {
+      EXPECT_TRUE(done[task]);
+    }
+  }
+}
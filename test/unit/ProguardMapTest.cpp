@@ -7,12 +7,14 @@
 
 #include "ProguardMap.h"
 
+#include <fstream>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <sstream>
 
 #include "IRAssembler.h"
 #include "RedexTest.h"
+#include "RedexTestUtils.h"
 
 using ::testing::AllOf;
 using ::testing::Pointee;
@@ -89,6 +91,41 @@ TEST_F(ProguardMapTest, HandlesGeneratedComments) {
   EXPECT_EQ("LA;.a:I", pm.translate_field("Lcom/foo/bar;.do1:I"));
 }
 
+TEST_F(ProguardMapTest, DeobfuscateMembersFromFile) {
+  auto tmp_dir = redex::make_tmp_dir("ProguardMapTest%%%%%%%%");
+  auto path = tmp_dir.path + "/mapping.txt";
+  {
+    std::ofstream ofs(path);
+    ofs << "# compiler: R8\n"
+        << "com.foo.bar -> A:\n"
+        << "    int do1 -> a\n"
+        << "    3:3:void <init>() -> <init>\n"
+        << "com.foo.Baz -> B:\n"
+        << "    com.foo.bar field -> a\n"
+        << "    1:1:com.foo.bar get(int) -> b\n"
+        // The same class again, e.g. after concatenating maps.
+        << "com.foo.bar -> A:\n"
+        << "    java.lang.String name -> b";
+  }
+  ProguardMap pm(path);
+  EXPECT_FALSE(pm.empty());
+  EXPECT_EQ("Lcom/foo/Baz;", pm.deobfuscate_class("LB;"));
+  EXPECT_EQ("Lcom/foo/Baz;.field:Lcom/foo/bar;",
+            pm.deobfuscate_field("LB;.a:LA;"));
+  EXPECT_EQ("Lcom/foo/Baz;.field:Lcom/foo/bar;", pm.deobfuscate_field("LB;.a"));
+  EXPECT_EQ("Lcom/foo/Baz;.get:(I)Lcom/foo/bar;",
+            pm.deobfuscate_method("LB;.b:(I)LA;"));
+  EXPECT_EQ("Lcom/foo/bar;.do1:I", pm.deobfuscate_field("LA;.a:I"));
+  EXPECT_EQ("Lcom/foo/bar;.name:Ljava/lang/String;",
+            pm.deobfuscate_field("LA;.b:Ljava/lang/String;"));
+  EXPECT_EQ("LC;.a:I", pm.deobfuscate_field("LC;.a:I"));
+  EXPECT_EQ("LB;.a:LA;",
+            pm.translate_field("Lcom/foo/Baz;.field:Lcom/foo/bar;"));
+  EXPECT_EQ("LA;.b:Ljava/lang/String;",
+            pm.translate_field("Lcom/foo/bar;.name:Ljava/lang/String;"));
+  EXPECT_THAT(pm.method_lines("LA;.<init>:()V"), SizeIs(1));
+}
+
 TEST_F(ProguardMapTest, LineNumbers) {
   std::stringstream ss(
       "com.foo.bar -> A:\n"
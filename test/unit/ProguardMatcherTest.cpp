@@ -196,3 +196,29 @@ TEST_F(ProguardMatcherTest, negate_class_longer_list) {
   EXPECT_FALSE(matches(*ks, "LJoo;"));
   EXPECT_FALSE(matches(*ks, "LJoo1;"));
 }
+
+TEST_F(ProguardMatcherTest, candidate_classes) {
+  Scope scope{create_class("LFoo;"), create_class("LFoo1;"),
+              create_class("LFooBar;"), create_class("LBar;"),
+              create_class("Lcom/x/Y;"), create_class("Lcom/x/y/Z;")};
+  auto candidates = [&](std::vector<NameSpec> class_names) {
+    auto ks = create_spec(create_class_spec(std::move(class_names)));
+    std::vector<std::string> names;
+    for (const auto* cls : keep_rules::testing::candidate_classes(*ks, scope)) {
+      names.push_back(cls->get_name()->str_copy());
+    }
+    return names;
+  };
+
+  using Names = std::vector<std::string>;
+  EXPECT_EQ(candidates({NameSpec("Foo", false)}), Names({"LFoo;"}));
+  // Negated names only exclude classes later on.
+  EXPECT_EQ(candidates({NameSpec("FooBar", true), NameSpec("Foo*", false)}),
+            Names({"LFoo1;", "LFoo;", "LFooBar;"}));
+  // Overlapping ranges are only visited once.
+  EXPECT_EQ(candidates({NameSpec("com.x.*", false), NameSpec("com.**", false)}),
+            Names({"Lcom/x/Y;", "Lcom/x/y/Z;"}));
+  EXPECT_EQ(candidates({NameSpec("*", false)}).size(), scope.size());
+  EXPECT_EQ(candidates({NameSpec("**", false)}).size(), scope.size());
+  EXPECT_EQ(candidates({NameSpec("Baz*", false)}), Names());
+}
@@ -8,11 +8,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <istream>
 #include <vector>
 
 #include "ProguardConfiguration.h"
 #include "ProguardParser.h"
+#include "RedexTestUtils.h"
 
 using namespace keep_rules;
 
@@ -60,6 +62,36 @@ TEST(ProguardParserTest, include) {
   ASSERT_EQ(config.includes[2], "gamma.txt");
 }
 
+// Parse files with nested includes, in include order
+TEST(ProguardParserTest, parse_files) {
+  auto tmp_dir = redex::make_tmp_dir("ProguardParserTest%%%%%%%%");
+  auto write = [&](const std::string& name, const std::string& contents) {
+    auto path = tmp_dir.path + "/" + name;
+    std::ofstream(path) << contents;
+    return path;
+  };
+  auto gamma = write("gamma.pro", "-keep class Gamma\n");
+  auto beta = write("beta.pro", "-include " + gamma + "\n-keep class Beta\n");
+  auto alpha = write("alpha.pro",
+                     "-keep class Alpha\n-include " + beta + "\n-include " +
+                         gamma + "\n");
+  auto delta = write("delta.pro", "-keep class Delta\n");
+
+  ProguardConfiguration config;
+  proguard_parser::parse_files({alpha, delta}, &config);
+  ASSERT_TRUE(config.ok);
+  std::vector<std::string> names;
+  for (const auto* k : config.keep_rules) {
+    ASSERT_EQ(k->class_spec.classNames.size(), 1);
+    names.push_back(k->class_spec.classNames[0].name);
+  }
+  EXPECT_THAT(names, ::testing::ElementsAre("Alpha", "Gamma", "Beta", "Delta"));
+
+  ProguardConfiguration missing;
+  auto broken = write("broken.pro", "-include " + tmp_dir.path + "/none.pro\n");
+  EXPECT_ANY_THROW(proguard_parser::parse_files({broken}, &missing));
+}
+
 // Parse basedirectory
 TEST(ProguardParserTest, basedirectory) {
   ProguardConfiguration config;
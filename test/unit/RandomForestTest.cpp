@@ -132,4 +132,43 @@ TEST_F(RandomForestTest, accept_feat_caller) {
   }
 }
 
+TEST_F(RandomForestTest, score_batch) {
+  RandomForestTestHelper mfth{};
+  [[maybe_unused]] auto& context = mfth.context;
+  auto& caller = mfth.caller;
+  auto& callee = mfth.callee;
+
+  auto forest = deserialize(
+      "(forest (feat \"caller_insns\" 5 (accf 0.25) (feat \"callee_regs\" 3 "
+      "(accf 1) (accf 0.5))) (feat \"callee_regs\" 4 (accf 0) (accf 1)))");
+  EXPECT_EQ(forest.size(), 2);
+  EXPECT_EQ(forest.num_features(), 2);
+  EXPECT_EQ(forest.dump(),
+            "(feat \"caller_insns\" 5.000000 (accf 0.250000) (feat "
+            "\"callee_regs\" 3.000000 (accf 1.000000) (accf 0.500000)))\n"
+            "(feat \"callee_regs\" 4.000000 (accf 0.000000) (accf 1.000000))");
+
+  std::vector<std::pair<uint32_t, uint32_t>> insns_and_regs = {
+      {4, 2}, {4, 5}, {6, 3}, {6, 4}, {6, 5}};
+  std::vector<float> rows;
+  std::vector<float> expected;
+  for (const auto& [insns, regs] : insns_and_regs) {
+    caller.m_insns = insns;
+    callee.m_regs = regs;
+    rows.resize(rows.size() + forest.num_features());
+    forest.compute_features(caller, callee,
+                            rows.data() + rows.size() - forest.num_features());
+    float acc;
+    forest.accept(caller, callee, &acc);
+    expected.push_back(acc);
+  }
+  EXPECT_EQ(expected, std::vector<float>({0.25, 1.25, 1, 0.5, 1.5}));
+
+  std::vector<float> sums(insns_and_regs.size());
+  forest.score(rows.data(), insns_and_regs.size(), sums.data());
+  EXPECT_EQ(sums, expected);
+  EXPECT_FALSE(forest.accept_score(sums[0]));
+  EXPECT_TRUE(forest.accept_score(sums[2]));
+}
+
 } // namespace random_forest
@@ -249,3 +249,35 @@ TEST_F(ReflectionAnalysisTest, instanceOf) {
       "MOVE_RESULT_OBJECT v4 {2, CLASS{Ljava/lang/Object;(LFoo;)}(REFLECTION);4, FIELD{Ljava/lang/Object;(LFoo;):bar};4294967294, FIELD{Ljava/lang/Object;(LFoo;):bar}}\n");
   // clang-format on
 }
+
+TEST_F(ReflectionAnalysisTest, sharedAnalysisInvalidatedByCodeChange) {
+  auto insns = assembler::ircode_from_string(R"(
+    (
+      (const-class "LFoo;")
+      (move-result-pseudo-object v1)
+    )
+  )");
+  add_code(std::move(insns));
+  SharedReflectionAnalyses shared;
+  auto analysis = shared.get(m_method);
+  EXPECT_TRUE(analysis->has_found_reflection());
+  EXPECT_EQ(shared.size(), 1);
+  // Retained, so it is shared even without any other holder.
+  auto* first = analysis.get();
+  analysis.reset();
+  EXPECT_EQ(shared.get(m_method).get(), first);
+
+  auto& cfg = m_method->get_code()->cfg();
+  for (auto& mie : cfg::InstructionIterable(cfg)) {
+    if (mie.insn->opcode() == OPCODE_CONST_CLASS) {
+      mie.insn->set_type(DexType::make_type("LBar;"));
+    }
+  }
+  analysis = shared.get(m_method);
+  EXPECT_NE(analysis.get(), first);
+  EXPECT_EQ(to_string(analysis->get_reflection_sites()),
+            "CONST_CLASS LBar; {4294967294, CLASS{LBar;}(REFLECTION)}\n"
+            "IOPCODE_MOVE_RESULT_PSEUDO_OBJECT v1 "
+            "{1, CLASS{LBar;}(REFLECTION);4294967294, "
+            "CLASS{LBar;}(REFLECTION)}\n");
+}
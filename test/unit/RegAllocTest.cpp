@@ -204,6 +204,41 @@ TEST_F(RegAllocTest, BuildInterferenceGraph) {
   }
 }
 
+TEST_F(RegAllocTest, AdjacencyMatrix) {
+  using namespace interference::impl;
+  // A dense matrix that migrates to the sparse representation once a register
+  // beyond its size shows up must agree with a sparse matrix all along.
+  AdjacencyMatrix dense(/* num_regs */ 10);
+  AdjacencyMatrix sparse;
+  auto expect_same = [&]() {
+    for (reg_t u = 0; u < 20; ++u) {
+      for (reg_t v = 0; v < 20; ++v) {
+        EXPECT_EQ(dense.contains(u, v), sparse.contains(u, v)) << u << v;
+        EXPECT_EQ(dense.is_coalesceable(u, v), sparse.is_coalesceable(u, v))
+            << u << v;
+      }
+    }
+  };
+  for (auto* matrix : {&dense, &sparse}) {
+    matrix->add(0, 9, /* can_coalesce */ false);
+    matrix->add(3, 2, /* can_coalesce */ true);
+    matrix->add(4, 5, /* can_coalesce */ true);
+    matrix->add(5, 4, /* can_coalesce */ false);
+  }
+  EXPECT_TRUE(dense.contains(9, 0));
+  EXPECT_TRUE(dense.contains(2, 3));
+  EXPECT_FALSE(dense.contains(2, 4));
+  EXPECT_TRUE(dense.is_coalesceable(2, 3));
+  EXPECT_FALSE(dense.is_coalesceable(4, 5));
+  expect_same();
+  for (auto* matrix : {&dense, &sparse}) {
+    matrix->add(15, 3, /* can_coalesce */ true);
+  }
+  EXPECT_TRUE(dense.contains(3, 15));
+  EXPECT_TRUE(dense.contains(0, 9));
+  expect_same();
+}
+
 TEST_F(RegAllocTest, CombineNonAdjacentNodes) {
   using namespace interference::impl;
   auto ig = GraphBuilder::create_empty();
@@ -913,3 +948,61 @@ TEST_F(RegAllocTest, NoOverwriteThis) {
   method->get_code()->clear_cfg();
   EXPECT_CODE_EQ(expected_code.get(), method->get_code());
 }
+
+TEST_F(RegAllocTest, SatisfiesEncodingConstraints) {
+  auto check = [](const char* code_str, reg_t registers_size) {
+    auto code = assembler::ircode_from_string(code_str);
+    code->set_registers_size(registers_size);
+    code->build_cfg();
+    return satisfies_encoding_constraints(code->cfg());
+  };
+  EXPECT_TRUE(check(R"(
+    (
+     (load-param v1)
+     (add-int v0 v1 v1)
+     (return v0)
+    )
+)",
+                    2));
+  // The parameter does not occupy the last register.
+  EXPECT_FALSE(check(R"(
+    (
+     (load-param v0)
+     (add-int v1 v0 v0)
+     (return v1)
+    )
+)",
+                     2));
+  // The dest of sget-object only has 8 bits.
+  EXPECT_FALSE(check(R"(
+    (
+     (sget-object "LFoo;.foo:LFoo;")
+     (move-result-pseudo-object v256)
+     (return-object v256)
+    )
+)",
+                     257));
+  // The operands of a range invoke must be contiguous.
+  EXPECT_FALSE(check(R"(
+    (
+     (const v0 0)
+     (const v2 0)
+     (invoke-static (v0 v0 v0 v0 v0 v2) "LFoo;.bar:(IIIIII)V")
+     (return-void)
+    )
+)",
+                     3));
+  EXPECT_TRUE(check(R"(
+    (
+     (const v0 0)
+     (move v1 v0)
+     (move v2 v0)
+     (move v3 v0)
+     (move v4 v0)
+     (move v5 v0)
+     (invoke-static (v0 v1 v2 v3 v4 v5) "LFoo;.bar:(IIIIII)V")
+     (return-void)
+    )
+)",
+                    6));
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RepeatedSequences.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace outliner_impl;
+
+namespace {
+
+std::vector<uint32_t> naive_repeat_lengths(const std::vector<Symbol>& text) {
+  std::vector<uint32_t> res(text.size(), 0);
+  for (size_t i = 0; i < text.size(); i++) {
+    for (size_t j = 0; j < text.size(); j++) {
+      if (i == j) {
+        continue;
+      }
+      uint32_t h = 0;
+      while (i + h < text.size() && j + h < text.size() &&
+             text[i + h] == text[j + h]) {
+        h++;
+      }
+      res[i] = std::max(res[i], h);
+    }
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(RepeatedSequencesTest, banana) {
+  // b a n a n a
+  std::vector<Symbol> text{1, 0, 2, 0, 2, 0};
+  EXPECT_EQ(build_suffix_array(text),
+            (std::vector<uint32_t>{5, 3, 1, 0, 4, 2}));
+  EXPECT_EQ(build_lcp_array(text, build_suffix_array(text)),
+            (std::vector<uint32_t>{0, 1, 3, 0, 0, 2}));
+  EXPECT_EQ(get_repeat_lengths(text),
+            (std::vector<uint32_t>{0, 3, 2, 3, 2, 1}));
+}
+
+TEST(RepeatedSequencesTest, separators) {
+  // Two occurrences of 1 2 3, delimited by distinct separators.
+  std::vector<Symbol> text{1, 2, 3, 100, 1, 2, 3, 4, 101};
+  EXPECT_EQ(get_repeat_lengths(text),
+            (std::vector<uint32_t>{3, 2, 1, 0, 3, 2, 1, 0, 0}));
+}
+
+TEST(RepeatedSequencesTest, random) {
+  std::mt19937 gen(42);
+  for (size_t round = 0; round < 100; round++) {
+    std::uniform_int_distribution<Symbol> symbols(0, round % 4 + 1);
+    std::vector<Symbol> text(round * 3);
+    for (auto& s : text) {
+      s = symbols(gen);
+    }
+    auto sa = build_suffix_array(text);
+    for (size_t i = 1; i < sa.size(); i++) {
+      EXPECT_TRUE(std::lexicographical_compare(
+          text.begin() + sa[i - 1], text.end(), text.begin() + sa[i],
+          text.end()));
+    }
+    EXPECT_EQ(get_repeat_lengths(text), naive_repeat_lengths(text));
+  }
+}
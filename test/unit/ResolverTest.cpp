@@ -422,3 +422,35 @@ TEST_F(ResolverTest, ResolveMethod) {
   EXPECT_TRUE(resolve_method(g_method, MethodSearch::InterfaceVirtual) ==
               e_method);
 }
+
+TEST_F(ResolverTest, ResolveThroughExternalClass) {
+  auto obj_t = DexType::make_type("Ljava/lang/Object;");
+  auto int_t = DexType::make_type("I");
+  auto x = DexType::make_type("X");
+  auto y = DexType::make_type("Y");
+  std::vector<DexField*> x_fields{
+      make_field_def(x, "f", int_t, ACC_PUBLIC, true)};
+  auto cls_X = create_class(x, obj_t, x_fields, ACC_PUBLIC, true);
+  std::vector<DexField*> y_fields{};
+  auto cls_Y = create_class(y, x, y_fields);
+
+  auto x_method = create_method(cls_X, "method");
+  auto y_method_ref = create_method(cls_Y, "method", ACC_PUBLIC, false);
+  // Resolution results within external classes are shared.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(resolve_method(y_method_ref, MethodSearch::Virtual), x_method);
+    EXPECT_EQ(resolve_field(y, DexString::get_string("f"), int_t),
+              resolve_field(x, DexString::get_string("f"), int_t));
+    EXPECT_EQ(resolve_field(y, DexString::get_string("g"), int_t), nullptr);
+  }
+
+  // Those within internal classes reflect later changes.
+  auto y_method = y_method_ref->make_concrete(ACC_PUBLIC, true);
+  cls_Y->add_method(y_method);
+  EXPECT_EQ(resolve_method(type_class(y), y_method->get_name(),
+                           y_method->get_proto(), MethodSearch::Virtual),
+            y_method);
+  auto y_field = make_field_def(y, "g", int_t);
+  cls_Y->add_field(y_field);
+  EXPECT_EQ(resolve_field(y, DexString::get_string("g"), int_t), y_field);
+}
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 
 #include "ControlFlow.h"
+#include "Creators.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "RedexTest.h"
@@ -191,3 +192,46 @@ TEST_F(ResultPropagationTest, return_receiver_of_framework_bridge_method) {
   )";
   test_get_return_param_index(code_str, 0);
 }
+
+TEST_F(ResultPropagationTest, return_param_of_callee_once_known) {
+  ClassCreator cc(DexType::make_type("LCallee;"));
+  cc.set_super(type::java_lang_Object());
+  auto* callee = assembler::method_from_string(R"(
+    (method (public static) "LCallee;.id:(I)I"
+      (
+        (load-param v0)
+        (return v0)
+      )
+    )
+  )");
+  cc.add_method(callee);
+  cc.create();
+
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (invoke-static (v0) "LCallee;.id:(I)I")
+      (move-result v1)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+
+  method_override_graph::Graph graph;
+  ReturnParamResolver resolver(graph);
+  std::unordered_map<const DexMethod*, ParamIndex>
+      methods_which_return_parameter;
+  std::unordered_set<const DexMethod*> missing_methods;
+  EXPECT_EQ(boost::none,
+            resolver.get_return_param_index(
+                cfg, methods_which_return_parameter, &missing_methods));
+  EXPECT_EQ(missing_methods, std::unordered_set<const DexMethod*>{callee});
+
+  methods_which_return_parameter.emplace(callee, 0);
+  missing_methods.clear();
+  EXPECT_EQ(boost::optional<ParamIndex>(0),
+            resolver.get_return_param_index(
+                cfg, methods_which_return_parameter, &missing_methods));
+  EXPECT_TRUE(missing_methods.empty());
+}
@@ -1196,3 +1196,82 @@ TEST_F(SourceBlocksTest, create_synth_sb_from_val_list) {
   EXPECT_EQ(get_blocks_as_txt(bar_method->get_code()->cfg().blocks()),
             R"(B0: LFoo;.bar:()V@4294967295(1:1|0:1|1:0.4))");
 }
+
+TEST_F(SourceBlocksTest, interned_vals_are_shared) {
+  auto* src = DexString::make_string("LFoo;.interned:()V");
+  std::vector<SourceBlock::Val> hot{SourceBlock::Val(1, 1),
+                                    SourceBlock::Val(1, 1)};
+  std::vector<SourceBlock::Val> cold{SourceBlock::Val(0, 0),
+                                     SourceBlock::Val::none()};
+  auto pool_before = SourceBlock::InternedVals::get_pool_stats().arrays;
+  {
+    SourceBlock a(src, 0, hot);
+    SourceBlock b(src, 1, hot);
+    SourceBlock c(src, 2, cold);
+    EXPECT_EQ(a.vals.data(), b.vals.data());
+    EXPECT_NE(a.vals.data(), c.vals.data());
+    EXPECT_EQ(pool_before + 2,
+              SourceBlock::InternedVals::get_pool_stats().arrays);
+
+    // Copies share the values, while updates only change the updated block.
+    SourceBlock copy(a);
+    EXPECT_EQ(a.vals.data(), copy.vals.data());
+    copy.set_val(1, SourceBlock::Val(0.5, 1));
+    EXPECT_NE(a.vals.data(), copy.vals.data());
+    EXPECT_EQ(1, *a.get_val(1));
+    EXPECT_EQ(0.5, *copy.get_val(1));
+    EXPECT_EQ("LFoo;.interned:()V@0(1:1|0.5:1|)", copy.show());
+
+    // Going back to the same values finds the shared array again.
+    copy.set_val(1, SourceBlock::Val(1, 1));
+    EXPECT_EQ(a.vals.data(), copy.vals.data());
+    EXPECT_TRUE(a == copy);
+
+    // All "none" values are equal.
+    c.fill_vals(SourceBlock::Val(NAN, 3));
+    SourceBlock none(src, 3,
+                     {SourceBlock::Val::none(), SourceBlock::Val::none()});
+    EXPECT_EQ(none.vals.data(), c.vals.data());
+  }
+  // Arrays that are no longer referenced are freed.
+  EXPECT_EQ(pool_before, SourceBlock::InternedVals::get_pool_stats().arrays);
+}
+
+TEST_F(SourceBlocksTest, normalization_keeps_vals_shared) {
+  auto method = create_method("LFoo");
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :true)
+      (goto :end)
+
+      (:true)
+      (const v0 1)
+
+      (:end)
+      (return-void)
+    )
+  )"));
+  method->get_code()->build_cfg();
+  auto& cfg = method->get_code()->cfg();
+  auto res = insert_source_blocks(method, &cfg, false,
+                                  single_profile("(1:1 g(1:1) b(1:1 g))"),
+                                  /*serialize=*/true);
+  EXPECT_TRUE(res.profile_success);
+
+  auto* src = DexString::make_string("LBar;.caller:()V");
+  SourceBlock caller_sb(src, 0, {SourceBlock::Val(0.5, 1)});
+  normalize::normalize(cfg, &caller_sb, 1);
+
+  const SourceBlock::Val* shared = nullptr;
+  for (auto* b : cfg.blocks()) {
+    foreach_source_block(b, [&](auto* sb) {
+      EXPECT_EQ(0.5, *sb->get_val(0));
+      if (shared == nullptr) {
+        shared = sb->vals.data();
+      }
+      EXPECT_EQ(shared, sb->vals.data());
+    });
+  }
+  EXPECT_NE(nullptr, shared);
+}
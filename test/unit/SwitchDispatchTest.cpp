@@ -9,6 +9,8 @@
 
 #include "ControlFlow.h"
 #include "Creators.h"
+#include "IRAssembler.h"
+#include "MethodProfiles.h"
 #include "RedexTest.h"
 #include "SwitchDispatch.h"
 
@@ -71,3 +73,153 @@ TEST_F(SwitchDispatchTest, create_simple_dispatch) {
     ASSERT_EQ(method, nullptr);
   }
 }
+
+namespace {
+
+// A static target of a virtual dispatch on LBar;, whose entry source block
+// has the given hotness.
+DexMethod* make_target(const std::string& name, float hotness) {
+  auto descriptor = "LBar;." + name + ":(LBar;)I";
+  return assembler::method_from_string(
+      "(method (public static) \"" + descriptor + "\" (" +
+      "(load-param-object v0) " + "(.src_block \"" + descriptor + "\" 0 (" +
+      std::to_string(hotness) + " 1.0)) " + "(const v1 0) (return v1)))");
+}
+
+struct DispatchShape {
+  // The type tag tested ahead of the switch, if any.
+  boost::optional<int64_t> peeled_case;
+  std::set<int32_t> switch_cases;
+};
+
+DispatchShape get_shape(DexMethod* dispatch) {
+  DispatchShape shape;
+  auto* code = dispatch->get_code();
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  std::unordered_map<reg_t, int64_t> consts;
+  for (const auto& mie : cfg::InstructionIterable(cfg)) {
+    if (mie.insn->opcode() == OPCODE_CONST) {
+      consts[mie.insn->dest()] = mie.insn->get_literal();
+    } else if (mie.insn->opcode() == OPCODE_IF_EQ) {
+      EXPECT_FALSE(shape.peeled_case);
+      shape.peeled_case = consts.at(mie.insn->src(1));
+    }
+  }
+  for (auto* block : cfg.blocks()) {
+    for (auto* edge : cfg.get_succ_edges_of_type(block, cfg::EDGE_BRANCH)) {
+      if (edge->case_key()) {
+        shape.switch_cases.insert(*edge->case_key());
+      }
+    }
+  }
+  code->clear_cfg();
+  return shape;
+}
+
+} // namespace
+
+class SwitchDispatchPeelingTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator cc(DexType::make_type("LBar;"));
+    cc.set_super(type::java_lang_Object());
+    cc.create();
+    m_type_tag_field =
+        DexField::make_field("LBar;.tag:I")->make_concrete(ACC_PUBLIC);
+  }
+
+  // Creates a virtual dispatch over the targets with consecutive type tags.
+  DispatchShape dispatch(
+      const std::vector<DexMethod*>& targets,
+      const method_profiles::MethodProfiles* method_profiles = nullptr) {
+    std::map<SwitchIndices, DexMethod*> indices_to_callee;
+    for (size_t i = 0; i < targets.size(); ++i) {
+      indices_to_callee[{static_cast<int>(i)}] = targets[i];
+    }
+    auto* owner = DexType::get_type("LBar;");
+    dispatch::Spec spec{
+        owner,
+        dispatch::Type::VIRTUAL,
+        "dispatch" + std::to_string(++m_num_dispatches),
+        DexProto::make_proto(type::_int(), DexTypeList::make_type_list({})),
+        ACC_PUBLIC,
+        m_type_tag_field,
+        /* overridden_meth */ nullptr,
+        /* keep_debug_info */ false};
+    spec.peel_hot_case = true;
+    spec.method_profiles = method_profiles;
+    auto dispatch = dispatch::create_virtual_dispatch(spec, indices_to_callee);
+    EXPECT_TRUE(dispatch.sub_dispatches.empty());
+    return get_shape(dispatch.main_dispatch);
+  }
+
+ private:
+  DexField* m_type_tag_field{nullptr};
+  size_t m_num_dispatches{0};
+};
+
+TEST_F(SwitchDispatchPeelingTest, peelsCaseWithHalfOfTheHotness) {
+  auto shape = dispatch({make_target("a", 1), make_target("b", 8),
+                         make_target("c", 1)});
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 1);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 2}));
+
+  // Exactly half of the hotness is enough.
+  shape = dispatch({make_target("d", 1), make_target("e", 2),
+                    make_target("f", 1)});
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 1);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 2}));
+}
+
+TEST_F(SwitchDispatchPeelingTest, peelsLastCase) {
+  auto shape = dispatch({make_target("a", 1), make_target("b", 2),
+                         make_target("c", 3), make_target("d", 9)});
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 3);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 1, 2}));
+}
+
+TEST_F(SwitchDispatchPeelingTest, keepsSwitchWithoutDominantCase) {
+  auto shape = dispatch({make_target("a", 4), make_target("b", 3),
+                         make_target("c", 3)});
+  EXPECT_FALSE(shape.peeled_case);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 1, 2}));
+
+  // With two targets, the switch would be left with a single case.
+  shape = dispatch({make_target("d", 1), make_target("e", 9)});
+  EXPECT_FALSE(shape.peeled_case);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 1}));
+}
+
+TEST_F(SwitchDispatchPeelingTest, profilesTakePrecedenceOverSourceBlocks) {
+  // The source blocks say that the last target is the hot one.
+  std::vector<DexMethod*> targets{make_target("a", 0), make_target("b", 0),
+                                  make_target("c", 9)};
+  auto shape = dispatch(targets);
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 2);
+
+  // The call counts of all interactions are summed up.
+  auto profiles = method_profiles::MethodProfiles::initialize(
+      method_profiles::COLD_START,
+      {{targets[0], {1.0, 30.0, 0.0, 0}}, {targets[2], {1.0, 10.0, 0.0, 0}}});
+  profiles.set_method_stats("OtherInteraction", targets[0],
+                            {1.0, 30.0, 0.0, 0});
+  profiles.set_method_stats("OtherInteraction", targets[1],
+                            {1.0, 20.0, 0.0, 0});
+  shape = dispatch(targets, &profiles);
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 0);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({1, 2}));
+
+  // Once profiled, targets that were not called are cold.
+  auto cold_profiles = method_profiles::MethodProfiles::initialize(
+      method_profiles::COLD_START, {{targets[1], {1.0, 5.0, 0.0, 0}}});
+  shape = dispatch(targets, &cold_profiles);
+  ASSERT_TRUE(shape.peeled_case);
+  EXPECT_EQ(*shape.peeled_case, 1);
+  EXPECT_EQ(shape.switch_cases, std::set<int32_t>({0, 2}));
+}
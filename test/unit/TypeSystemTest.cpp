@@ -374,3 +374,55 @@ TEST_F(TypeSystemTest, empty) {
               ::testing::UnorderedElementsAre(iout1_t));
   EXPECT_THAT(type_system.get_implemented_interfaces(odd_t).size(), 0);
 }
+
+TEST_F(TypeSystemTest, classHierarchyIndex) {
+  auto o_t = DexType::make_type("LO;");
+  auto a_t = DexType::make_type("LA;");
+  auto b_t = DexType::make_type("LB;");
+  auto c_t = DexType::make_type("LC;");
+  auto d_t = DexType::make_type("LD;");
+  auto x_t = DexType::make_type("LX;");
+  auto y_t = DexType::make_type("LY;");
+  auto i_t = DexType::make_type("LI;");
+  auto j_t = DexType::make_type("LJ;");
+  // Two trees: O <- {A <- C <- D, B} and X <- Y.
+  ClassHierarchy hierarchy;
+  hierarchy[o_t] = {a_t, b_t};
+  hierarchy[a_t] = {c_t};
+  hierarchy[c_t] = {d_t};
+  hierarchy[x_t] = {y_t};
+  InterfaceMap interfaces;
+  interfaces[i_t] = {c_t, d_t, b_t, y_t};
+  interfaces[j_t] = {};
+  ClassHierarchyIndex index(hierarchy, &interfaces);
+
+  for (auto* type : {o_t, a_t, b_t, c_t, d_t, x_t, y_t}) {
+    EXPECT_TRUE(index.contains(type));
+    EXPECT_TRUE(index.is_subclass(type, type));
+  }
+  EXPECT_FALSE(index.contains(i_t));
+  EXPECT_TRUE(index.is_subclass(o_t, d_t));
+  EXPECT_TRUE(index.is_subclass(a_t, c_t));
+  EXPECT_TRUE(index.is_subclass(x_t, y_t));
+  EXPECT_FALSE(index.is_subclass(d_t, o_t));
+  EXPECT_FALSE(index.is_subclass(a_t, b_t));
+  EXPECT_FALSE(index.is_subclass(o_t, y_t));
+  EXPECT_FALSE(index.is_subclass(o_t, i_t));
+
+  auto children = index.get_all_children(o_t);
+  EXPECT_THAT(std::vector<const DexType*>(children.begin(), children.end()),
+              ::testing::UnorderedElementsAre(a_t, b_t, c_t, d_t));
+  children = index.get_all_children(c_t);
+  EXPECT_THAT(std::vector<const DexType*>(children.begin(), children.end()),
+              ::testing::ElementsAre(d_t));
+  EXPECT_TRUE(index.get_all_children(d_t).empty());
+  EXPECT_TRUE(index.get_all_children(i_t).empty());
+
+  for (auto* type : {b_t, c_t, d_t, y_t}) {
+    EXPECT_TRUE(index.implements(type, i_t));
+    EXPECT_FALSE(index.implements(type, j_t));
+  }
+  for (auto* type : {o_t, a_t, x_t, i_t}) {
+    EXPECT_FALSE(index.implements(type, i_t));
+  }
+}
@@ -7,10 +7,12 @@
 
 #include "Walkers.h"
 
+#include <atomic>
 #include <gmock/gmock.h>
 
 #include "Creators.h"
 #include "DexUtil.h"
+#include "IRAssembler.h"
 #include "RedexTest.h"
 #include "Show.h"
 
@@ -38,3 +40,68 @@ TEST_F(WalkersTest, accumlate) {
       ::testing::UnorderedElementsAre(
           "LFoo;.bar:()V", "LFoo;.baz:()V", "LFoo;.qux:()V", "LFoo;.quux:()V"));
 }
+
+TEST_F(WalkersTest, chunkedWalksVisitEverythingOnce) {
+  Scope scope;
+  for (size_t i = 0; i < 100; ++i) {
+    auto name = "LFoo" + std::to_string(i) + ";";
+    ClassCreator cc(DexType::make_type(name));
+    cc.set_super(type::java_lang_Object());
+    for (size_t j = 0; j < 3; ++j) {
+      auto* m = DexMethod::make_method(name + ".m" + std::to_string(j) + ":()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+      // Make a few classes much bigger than the others.
+      std::string body = "((const v0 0)";
+      for (size_t k = 0; k < (i % 10 == 0 ? 1000 : 1); ++k) {
+        body += "(add-int/lit v0 v0 1)";
+      }
+      body += "(return-void))";
+      m->set_code(assembler::ircode_from_string(body));
+      cc.add_method(m);
+    }
+    scope.push_back(cc.create());
+  }
+
+  constexpr size_t num_threads = 4;
+  auto num_classes = walk::parallel::classes<size_t>(
+      scope, [](DexClass*) -> size_t { return 1; }, num_threads);
+  EXPECT_EQ(num_classes, 100);
+
+  using MethodSet = std::unordered_set<DexMethod*>;
+  auto methods = walk::parallel::methods<MethodSet, MergeContainers<MethodSet>>(
+      scope, [](DexMethod* m) { return MethodSet{m}; }, num_threads);
+  EXPECT_EQ(methods.size(), 300);
+
+  std::atomic<size_t> num_code{0};
+  walk::parallel::code(
+      scope, [&](DexMethod*, IRCode&) { num_code.fetch_add(1); }, num_threads);
+  EXPECT_EQ(num_code.load(), 300);
+}
+
+TEST_F(WalkersTest, readOnlyCodeWalksKeepMethodsClean) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  auto* m = DexMethod::make_method("LFoo;.bar:()V")
+                ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  m->set_code(assembler::ircode_from_string("((return-void))"));
+  cc.add_method(m);
+  Scope scope{cc.create()};
+
+  m->clear_hash_dirty();
+  size_t num_code{0};
+  walk::code(scope, [&](DexMethod*, const IRCode&) { ++num_code; });
+  walk::parallel::code(scope, [&](DexMethod*, const IRCode&) {});
+  walk::parallel::methods_by_cost<size_t>(
+      scope, [](DexMethod*) -> size_t { return 1; });
+  EXPECT_EQ(num_code, 1);
+  EXPECT_FALSE(m->is_hash_dirty());
+
+  // Walkers that may change the code mark the methods as dirty...
+  walk::code(scope, [](DexMethod*, IRCode&) {});
+  EXPECT_TRUE(m->is_hash_dirty());
+
+  // ... and so do generic ones.
+  m->clear_hash_dirty();
+  walk::parallel::code(scope, [](auto*, auto&) {});
+  EXPECT_TRUE(m->is_hash_dirty());
+}
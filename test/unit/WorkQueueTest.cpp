@@ -119,3 +119,29 @@ TEST(WorkQueueTest, checkDynamicallyAddingTasks) {
   // 10 + 9 + ... + 1 + 0 = 55
   EXPECT_EQ(55, result);
 }
+
+TEST(WorkQueueTest, scopedDefaultNumThreads) {
+  auto num_threads = redex_parallel::default_num_threads();
+  {
+    redex_parallel::ScopedDefaultNumThreads outer(3);
+    EXPECT_EQ(3, redex_parallel::default_num_threads());
+    {
+      redex_parallel::ScopedDefaultNumThreads inner(1);
+      EXPECT_EQ(1, redex_parallel::default_num_threads());
+    }
+    EXPECT_EQ(3, redex_parallel::default_num_threads());
+  }
+  EXPECT_EQ(num_threads, redex_parallel::default_num_threads());
+}
+
+TEST(WorkQueueTest, pinnedThreadPool) {
+  redex_thread_pool::ThreadPool::create(/* pin_threads= */ true);
+  std::atomic<size_t> sum{0};
+  std::vector<size_t> items(NUM_INTS);
+  for (size_t i = 0; i < NUM_INTS; ++i) {
+    items[i] = i;
+  }
+  workqueue_run<size_t>([&](size_t i) { sum += i; }, items, 4);
+  redex_thread_pool::ThreadPool::destroy();
+  EXPECT_EQ(NUM_INTS * (NUM_INTS - 1) / 2, sum.load());
+}
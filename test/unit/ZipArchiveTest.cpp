@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ZipArchive.h"
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <zlib.h>
+
+namespace {
+
+// Writes a minimal archive, with one entry per (name, contents, deflate).
+class ZipWriter {
+ public:
+  void add(const std::string& name, const std::string& contents, bool deflate) {
+    std::string data = deflate ? raw_deflate(contents) : contents;
+    uint32_t offset = m_out.size();
+    put32(0x04034b50);
+    put16(20); // version needed
+    put16(0); // flags
+    put16(deflate ? 8 : 0);
+    put32(0); // time, date
+    put32(0); // crc32, not checked
+    put32(data.size());
+    put32(contents.size());
+    put16(name.size());
+    put16(0); // extra
+    m_out += name;
+    m_out += data;
+
+    auto& cd = m_central_directory;
+    put32(cd, 0x02014b50);
+    put16(cd, 20); // version made by
+    put16(cd, 20); // version needed
+    put16(cd, 0); // flags
+    put16(cd, deflate ? 8 : 0);
+    put32(cd, 0); // time, date
+    put32(cd, 0); // crc32
+    put32(cd, data.size());
+    put32(cd, contents.size());
+    put16(cd, name.size());
+    put16(cd, 0); // extra
+    put16(cd, 0); // comment
+    put16(cd, 0); // disk number
+    put16(cd, 0); // internal attributes
+    put32(cd, 0); // external attributes
+    put32(cd, offset);
+    cd += name;
+    m_num_entries++;
+  }
+
+  std::string finish() {
+    uint32_t cd_offset = m_out.size();
+    m_out += m_central_directory;
+    put32(0x06054b50);
+    put16(0); // disk number
+    put16(0); // disk with central directory
+    put16(m_num_entries);
+    put16(m_num_entries);
+    put32(m_central_directory.size());
+    put32(cd_offset);
+    put16(0); // comment
+    return m_out;
+  }
+
+ private:
+  static std::string raw_deflate(const std::string& contents) {
+    z_stream stream{};
+    EXPECT_EQ(Z_OK, deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+                                 -MAX_WBITS, 8, Z_DEFAULT_STRATEGY));
+    std::string out(deflateBound(&stream, contents.size()), '\0');
+    stream.next_in = (Bytef*)contents.data();
+    stream.avail_in = contents.size();
+    stream.next_out = (Bytef*)out.data();
+    stream.avail_out = out.size();
+    EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+  }
+
+  static void put16(std::string& s, uint16_t v) {
+    s.append(reinterpret_cast<const char*>(&v), sizeof(v));
+  }
+  static void put32(std::string& s, uint32_t v) {
+    s.append(reinterpret_cast<const char*>(&v), sizeof(v));
+  }
+  void put16(uint16_t v) { put16(m_out, v); }
+  void put32(uint32_t v) { put32(m_out, v); }
+
+  std::string m_out;
+  std::string m_central_directory;
+  uint16_t m_num_entries{0};
+};
+
+} // namespace
+
+TEST(ZipArchiveTest, storedAndDeflated) {
+  std::string stored = "stored contents";
+  std::string deflated(1000, 'x');
+  ZipWriter writer;
+  writer.add("stored.txt", stored, /* deflate */ false);
+  writer.add("dir/deflated.txt", deflated, /* deflate */ true);
+  auto bytes = writer.finish();
+
+  ZipArchive archive(reinterpret_cast<const uint8_t*>(bytes.data()),
+                     bytes.size());
+  ASSERT_TRUE(archive.is_valid());
+  ASSERT_EQ(2, archive.entries().size());
+  EXPECT_EQ(nullptr, archive.find("missing.txt"));
+
+  const auto* stored_entry = archive.find("stored.txt");
+  ASSERT_NE(nullptr, stored_entry);
+  const auto* stored_data = archive.get_stored_data(*stored_entry);
+  ASSERT_NE(nullptr, stored_data);
+  // Stored entries are not copied.
+  EXPECT_GE(stored_data, reinterpret_cast<const uint8_t*>(bytes.data()));
+  EXPECT_LT(stored_data,
+            reinterpret_cast<const uint8_t*>(bytes.data()) + bytes.size());
+  EXPECT_EQ(stored, std::string(reinterpret_cast<const char*>(stored_data),
+                                stored_entry->ucomp_size));
+
+  const auto* deflated_entry = archive.find("dir/deflated.txt");
+  ASSERT_NE(nullptr, deflated_entry);
+  EXPECT_LT(deflated_entry->comp_size, deflated_entry->ucomp_size);
+  EXPECT_EQ(nullptr, archive.get_stored_data(*deflated_entry));
+  std::string out(deflated_entry->ucomp_size, '\0');
+  ASSERT_TRUE(archive.extract(*deflated_entry,
+                              reinterpret_cast<uint8_t*>(out.data()),
+                              out.size()));
+  EXPECT_EQ(deflated, out);
+}
+
+TEST(ZipArchiveTest, notAnArchive) {
+  std::string bytes(100, 'x');
+  ZipArchive archive(reinterpret_cast<const uint8_t*>(bytes.data()),
+                     bytes.size());
+  EXPECT_FALSE(archive.is_valid());
+  EXPECT_TRUE(archive.entries().empty());
+}
+
+TEST(ZipArchiveTest, writeAligned) {
+  std::string lib(5000, 'l');
+  std::string deflated(1000, 'x');
+  ZipArchiveWriter::Options options;
+  options.page_align_libs = true;
+  ZipArchiveWriter writer(options);
+  writer.add("a.txt", "odd", /* store */ true);
+  writer.add("lib/x86/libfoo.so", lib, /* store */ true);
+  writer.add("classes.dex", deflated, /* store */ false);
+  std::ostringstream out;
+  ASSERT_TRUE(writer.write(out));
+  auto bytes = out.str();
+  const auto* base = reinterpret_cast<const uint8_t*>(bytes.data());
+
+  ZipArchive archive(base, bytes.size());
+  ASSERT_TRUE(archive.is_valid());
+  ASSERT_EQ(3, archive.entries().size());
+  // Entries keep their order.
+  EXPECT_EQ("a.txt", archive.entries()[0].name);
+  EXPECT_EQ("classes.dex", archive.entries()[2].name);
+
+  const auto* stored_entry = archive.find("a.txt");
+  ASSERT_NE(nullptr, stored_entry);
+  const auto* stored_data = archive.get_stored_data(*stored_entry);
+  ASSERT_NE(nullptr, stored_data);
+  EXPECT_EQ(0, (stored_data - base) % 4);
+  EXPECT_EQ(crc32(0, stored_data, stored_entry->ucomp_size),
+            stored_entry->crc32);
+
+  const auto* lib_entry = archive.find("lib/x86/libfoo.so");
+  ASSERT_NE(nullptr, lib_entry);
+  const auto* lib_data = archive.get_stored_data(*lib_entry);
+  ASSERT_NE(nullptr, lib_data);
+  EXPECT_EQ(0, (lib_data - base) % 4096);
+  EXPECT_EQ(lib, std::string(reinterpret_cast<const char*>(lib_data),
+                             lib_entry->ucomp_size));
+
+  const auto* deflated_entry = archive.find("classes.dex");
+  ASSERT_NE(nullptr, deflated_entry);
+  EXPECT_LT(deflated_entry->comp_size, deflated_entry->ucomp_size);
+  std::string extracted(deflated_entry->ucomp_size, '\0');
+  ASSERT_TRUE(archive.extract(*deflated_entry,
+                              reinterpret_cast<uint8_t*>(extracted.data()),
+                              extracted.size()));
+  EXPECT_EQ(deflated, extracted);
+
+  // Entries copied from another archive are not recompressed.
+  ZipArchiveWriter copier;
+  for (const auto& entry : archive.entries()) {
+    ASSERT_TRUE(copier.add(archive, entry));
+  }
+  std::ostringstream copy_out;
+  ASSERT_TRUE(copier.write(copy_out));
+  auto copy_bytes = copy_out.str();
+  ZipArchive copy(reinterpret_cast<const uint8_t*>(copy_bytes.data()),
+                  copy_bytes.size());
+  ASSERT_TRUE(copy.is_valid());
+  ASSERT_EQ(3, copy.entries().size());
+  const auto* copied_entry = copy.find("classes.dex");
+  ASSERT_NE(nullptr, copied_entry);
+  EXPECT_EQ(deflated_entry->comp_size, copied_entry->comp_size);
+  EXPECT_EQ(deflated_entry->crc32, copied_entry->crc32);
+  EXPECT_EQ(0, memcmp(archive.get_data(*deflated_entry),
+                      copy.get_data(*copied_entry), copied_entry->comp_size));
+}
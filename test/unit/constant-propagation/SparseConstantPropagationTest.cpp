@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SparseConstantPropagation.h"
+
+#include <gtest/gtest.h>
+
+#include "ConstantPropagationAnalysis.h"
+#include "ConstantPropagationState.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+namespace cp = constant_propagation;
+
+namespace {
+
+struct SparseConstantPropagationTest : public RedexTest {};
+
+/*
+ * Check that the sparse analysis is sound with respect to the dense one:
+ * every block the dense analysis reaches is executable, and every constant
+ * found by the sparse analysis is also found by the dense analysis.
+ */
+void expect_consistent_with_dense(const cfg::ControlFlowGraph& cfg,
+                                  const cp::SparseConstantAnalysis& sparse) {
+  cp::State state;
+  cp::intraprocedural::FixpointIterator dense(
+      &state, cfg, cp::ConstantPrimitiveAnalyzer());
+  dense.run(ConstantEnvironment());
+  for (auto* block : cfg.blocks()) {
+    auto env = dense.get_entry_state_at(block);
+    if (env.is_bottom()) {
+      continue;
+    }
+    EXPECT_TRUE(sparse.is_executable(block)) << "B" << block->id();
+    auto last_insn = block->get_last_insn();
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+        auto cst = sparse.get_value(insn, i).get_constant();
+        if (cst) {
+          auto dense_cst =
+              env.get<SignedConstantDomain>(insn->src(i)).get_constant();
+          ASSERT_TRUE(dense_cst) << show(insn);
+          EXPECT_EQ(*cst, *dense_cst) << show(insn);
+        }
+      }
+      dense.analyze_instruction(insn, &env, insn == last_insn->insn);
+    }
+  }
+}
+
+IRInstruction* find_insn(const cfg::ControlFlowGraph& cfg, IROpcode op) {
+  for (auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    if (mie.insn->opcode() == op) {
+      return mie.insn;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST_F(SparseConstantPropagationTest, constantsFlowThroughMovesAndArithmetic) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 1)
+      (move v1 v0)
+      (add-int/lit v2 v1 2)
+      (if-eqz v2 :dead)
+      (return v2)
+      (:dead)
+      (const v3 0)
+      (return v3)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  auto* ret = find_insn(cfg, OPCODE_RETURN);
+  EXPECT_EQ(SignedConstantDomain(3), sparse.get_value(ret, 0));
+
+  // Only the block of `const v3 0` is unreachable.
+  for (auto* block : cfg.blocks()) {
+    bool is_dead = block->contains_opcode(OPCODE_CONST) &&
+                   !block->contains_opcode(OPCODE_ADD_INT_LIT);
+    EXPECT_EQ(!is_dead, sparse.is_executable(block)) << "B" << block->id();
+    if (is_dead) {
+      auto* dead_const = block->get_first_insn()->insn;
+      EXPECT_TRUE(sparse.get_def_value(dead_const).is_bottom());
+    }
+  }
+  expect_consistent_with_dense(cfg, sparse);
+}
+
+TEST_F(SparseConstantPropagationTest, joinOfDifferentConstants) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :other)
+      (const v1 1)
+      (goto :join)
+      (:other)
+      (const v1 2)
+      (:join)
+      (const v2 5)
+      (add-int v3 v1 v2)
+      (return v3)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  auto* add = find_insn(cfg, OPCODE_ADD_INT);
+  EXPECT_EQ(SignedConstantDomain::nez(), sparse.get_value(add, 0));
+  EXPECT_EQ(SignedConstantDomain(5), sparse.get_value(add, 1));
+  EXPECT_TRUE(sparse.get_def_value(add).is_top());
+  for (auto* block : cfg.blocks()) {
+    EXPECT_TRUE(sparse.is_executable(block)) << "B" << block->id();
+  }
+  expect_consistent_with_dense(cfg, sparse);
+}
+
+TEST_F(SparseConstantPropagationTest, loopCounterIsNotConstant) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v1)
+      (const v0 0)
+      (:loop)
+      (if-eqz v1 :end)
+      (add-int/lit v0 v0 1)
+      (goto :loop)
+      (:end)
+      (return v0)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  auto* ret = find_insn(cfg, OPCODE_RETURN);
+  EXPECT_TRUE(sparse.get_value(ret, 0).is_top());
+  expect_consistent_with_dense(cfg, sparse);
+}
+
+TEST_F(SparseConstantPropagationTest, loopWithConstantExitCondition) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (const v1 7)
+      (:loop)
+      (if-nez v0 :end)
+      (const v1 8)
+      (add-int/lit v0 v0 1)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  // The counter is not constant at the loop header, so both successors of the
+  // branch are feasible, and v1 is either 7 or 8 at the return.
+  auto* ret = find_insn(cfg, OPCODE_RETURN);
+  EXPECT_EQ(SignedConstantDomain::nez(), sparse.get_value(ret, 0));
+  expect_consistent_with_dense(cfg, sparse);
+}
+
+TEST_F(SparseConstantPropagationTest, nonZeroValuesPruneNullChecks) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const-string "hello")
+      (move-result-pseudo-object v0)
+      (if-nez v0 :non_null)
+      (const v1 0)
+      (return v1)
+      (:non_null)
+      (const v1 1)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  size_t executable_returns = 0;
+  for (auto* block : cfg.blocks()) {
+    if (!block->contains_opcode(OPCODE_RETURN) ||
+        !sparse.is_executable(block)) {
+      continue;
+    }
+    ++executable_returns;
+    auto* ret = block->get_last_insn()->insn;
+    EXPECT_EQ(SignedConstantDomain(1), sparse.get_value(ret, 0));
+  }
+  EXPECT_EQ(1, executable_returns);
+  expect_consistent_with_dense(cfg, sparse);
+}
+
+TEST_F(SparseConstantPropagationTest, switchOnConstant) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 1)
+      (switch v0 (:a :b))
+      (const v1 10)
+      (return v1)
+      (:a 0)
+      (const v1 20)
+      (return v1)
+      (:b 1)
+      (const v1 30)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cp::SparseConstantAnalysis sparse(cfg);
+
+  std::vector<int64_t> returned;
+  for (auto* block : cfg.blocks()) {
+    if (!block->contains_opcode(OPCODE_RETURN) ||
+        !sparse.is_executable(block)) {
+      continue;
+    }
+    auto* ret = block->get_last_insn()->insn;
+    auto cst = sparse.get_value(ret, 0).get_constant();
+    ASSERT_TRUE(cst);
+    returned.push_back(*cst);
+  }
+  EXPECT_EQ(std::vector<int64_t>{30}, returned);
+  expect_consistent_with_dense(cfg, sparse);
+}
@@ -41,7 +41,9 @@ dex_map_item* get_dex_map_item(ddump_data* rd, uint16_t type) {
 }
 
 void open_dex_file(const char* filename, ddump_data* rd) {
-  int fd = open(filename, O_RDWR);
+  // The mapping is private, so that the dex files, e.g. of build artifacts,
+  // can be read-only and are never modified.
+  int fd = open(filename, O_RDONLY);
   struct stat stat;
   rd->dex_filename = filename;
   if (fd < 0) {
@@ -56,11 +58,11 @@ void open_dex_file(const char* filename, ddump_data* rd) {
   rd->dexmmap = (char*)mmap(nullptr,
                             rd->dex_size,
                             PROT_READ | PROT_WRITE,
-                            MAP_FILE | MAP_SHARED,
+                            MAP_FILE | MAP_PRIVATE,
                             fd,
                             0);
   close(fd);
-  if (rd->dexmmap == nullptr) {
+  if (rd->dexmmap == MAP_FAILED) {
     fprintf(stderr, "Address space allocation failed for mmap, bailing\n");
     exit(1);
   }
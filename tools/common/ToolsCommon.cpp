@@ -7,6 +7,7 @@
 
 #include "ToolsCommon.h"
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -29,10 +30,12 @@
 #include "InstructionLowering.h"
 #include "JarLoader.h"
 #include "Macros.h"
+#include "RedexMappedFile.h"
 #include "RedexOptions.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Walkers.h"
+#include "ZipArchive.h"
 
 #if IS_WINDOWS
 #include <io.h>
@@ -84,8 +87,13 @@ void init_ir_meta(DexStoresVector& stores) {
  */
 void write_ir_meta(const std::string& output_ir_dir, DexStoresVector& stores) {
   Timer t("Dumping IR meta");
-  Scope classes = build_class_scope(stores);
-  ir_meta_io::dump(classes, output_ir_dir);
+  std::vector<Scope> shards;
+  for (auto& store : stores) {
+    for (auto& dex : store.get_dexen()) {
+      shards.push_back(dex);
+    }
+  }
+  ir_meta_io::dump(shards, output_ir_dir);
 }
 
 /**
@@ -185,6 +193,96 @@ bool is_zip(const std::string& filename) {
   // the first two bytes of a ZIP file are usually "PK"
   return buffer[0] == 'P' && buffer[1] == 'K';
 }
+
+// The index of a top-level classes.dex (1), classes2.dex (2), ... entry, or 0.
+size_t get_dex_entry_index(const std::string& name) {
+  constexpr std::string_view kPrefix = "classes";
+  constexpr std::string_view kSuffix = ".dex";
+  if (name.size() < kPrefix.size() + kSuffix.size() ||
+      name.compare(0, kPrefix.size(), kPrefix) != 0 ||
+      name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) !=
+          0) {
+    return 0;
+  }
+  auto digits = name.substr(kPrefix.size(),
+                            name.size() - kPrefix.size() - kSuffix.size());
+  if (digits.empty()) {
+    return 1;
+  }
+  if (digits[0] == '0' ||
+      !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return 0;
+  }
+  auto index = std::stoul(digits);
+  return index >= 2 ? index : 0;
+}
+
+// The dex entries of an archive, in the order in which Android loads them.
+std::vector<const ZipArchive::Entry*> get_dex_entries(
+    const ZipArchive& archive) {
+  std::vector<std::pair<size_t, const ZipArchive::Entry*>> indexed;
+  for (const auto& entry : archive.entries()) {
+    auto index = get_dex_entry_index(entry.name);
+    if (index != 0) {
+      indexed.emplace_back(index, &entry);
+    }
+  }
+  std::sort(indexed.begin(), indexed.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  std::vector<const ZipArchive::Entry*> res;
+  for (size_t i = 0; i < indexed.size(); i++) {
+    always_assert_log(indexed[i].first == i + 1,
+                      "Dex entries are not contiguous: missing classes%zu.dex",
+                      i + 1);
+    res.push_back(indexed[i].second);
+  }
+  return res;
+}
+
+// Calls `fn` with the contents of the entry. STOREd (and suitably aligned)
+// entries, which is how dex files usually end up in an APK, are passed on
+// straight from the mapped archive; everything else is inflated first.
+// Returns the contents of the entry, which are extracted into the buffer
+// unless they can be used in place.
+const uint8_t* get_entry_contents(const ZipArchive& archive,
+                                  const ZipArchive::Entry& entry,
+                                  std::unique_ptr<uint32_t[]>* buffer) {
+  auto stored = archive.get_stored_data(entry);
+  if (stored != nullptr && (uintptr_t)stored % alignof(uint32_t) == 0) {
+    return stored;
+  }
+  *buffer = std::make_unique<uint32_t[]>(
+      (entry.ucomp_size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+  auto data = reinterpret_cast<uint8_t*>(buffer->get());
+  always_assert_log(archive.extract(entry, data, entry.ucomp_size),
+                    "Cannot read %s from archive", entry.name.c_str());
+  return data;
+}
+
+void with_entry_contents(
+    const ZipArchive& archive,
+    const ZipArchive::Entry& entry,
+    const std::function<void(const uint8_t*, size_t)>& fn) {
+  std::unique_ptr<uint32_t[]> buffer;
+  fn(get_entry_contents(archive, entry, &buffer), entry.ucomp_size);
+}
+
+struct DexArchive {
+  RedexMappedFile file;
+  ZipArchive archive;
+  std::vector<const ZipArchive::Entry*> dex_entries;
+
+  explicit DexArchive(const std::string& filename)
+      : file(RedexMappedFile::open(filename)),
+        archive(reinterpret_cast<const uint8_t*>(file.const_data()),
+                file.size()),
+        dex_entries(get_dex_entries(archive)) {
+    always_assert_log(archive.is_valid(), "Cannot read archive %s",
+                      filename.c_str());
+    always_assert_log(!dex_entries.empty(), "Archive %s contains no dex file",
+                      filename.c_str());
+  }
+};
 } // namespace
 
 namespace redex {
@@ -274,43 +372,77 @@ void load_classes_from_dexes_and_metadata(
     std::vector<dex_stats_t>& input_dexes_stats) {
   always_assert_log(!stores.empty(),
                     "Cannot load classes into empty DexStoresVector");
+  // All dex files are loaded in one batch. Archives and the extracted
+  // contents of their entries are kept alive until then.
+  std::vector<DexSource> sources;
+  std::vector<size_t> source_stores;
+  std::vector<std::unique_ptr<DexArchive>> archives;
+  std::vector<std::unique_ptr<uint32_t[]>> buffers;
   for (const auto& filename : dex_files) {
     if (filename.size() >= 5 &&
         filename.compare(filename.size() - 4, 4, ".dex") == 0) {
       auto location = DexLocation::make_location("dex", filename);
       assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                    load_dex_magic_from_dex(location));
-      dex_stats_t dex_stats;
-      DexClasses classes = load_classes_from_dex(location, &dex_stats);
-      input_totals += dex_stats;
-      input_dexes_stats.push_back(dex_stats);
-      stores[0].add_classes(std::move(classes));
+      sources.push_back(DexSource{location});
+      source_stores.push_back(0);
     } else if (is_zip(filename)) {
-      std::cerr << "error: Input files are expected to be DEX (with filename "
-                   "ending in "
-                   ".dex), or a JSON metadata file. However, \""
-                << filename
-                << "\" is a ZIP. If this is an APK, please extract "
-                   "the DEX files from it and pass those as the inputs.";
-      exit(EXIT_FAILURE);
+      archives.push_back(std::make_unique<DexArchive>(filename));
+      const auto& dex_archive = *archives.back();
+      for (const auto* entry : dex_archive.dex_entries) {
+        auto location = DexLocation::make_location(
+            "dex", filename + "!/" + entry->name);
+        std::unique_ptr<uint32_t[]> buffer;
+        auto data = get_entry_contents(dex_archive.archive, *entry, &buffer);
+        assert_dex_magic_consistency(
+            stores[0].get_dex_magic(),
+            reinterpret_cast<const dex_header*>(data)->magic);
+        sources.push_back(DexSource{location, data, entry->ucomp_size});
+        source_stores.push_back(0);
+        if (buffer) {
+          buffers.push_back(std::move(buffer));
+        }
+      }
     } else {
       DexMetadata store_metadata;
       store_metadata.parse(filename);
-      DexStore store(store_metadata);
+      auto store_idx = stores.size();
+      stores.emplace_back(store_metadata);
       for (const auto& file_path : store_metadata.get_files()) {
-        auto location = DexLocation::make_location(store.get_name(), file_path);
+        auto location = DexLocation::make_location(stores[store_idx].get_name(),
+                                                   file_path);
         assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                      load_dex_magic_from_dex(location));
-        dex_stats_t dex_stats;
-        DexClasses classes = load_classes_from_dex(location, &dex_stats);
-
-        input_totals += dex_stats;
-        input_dexes_stats.push_back(dex_stats);
-        store.add_classes(std::move(classes));
+        sources.push_back(DexSource{location});
+        source_stores.push_back(store_idx);
       }
-      stores.emplace_back(std::move(store));
     }
   }
+
+  std::vector<dex_stats_t> dexes_stats;
+  auto dexes = load_classes_from_dexes(sources, &dexes_stats);
+  for (size_t i = 0; i < dexes.size(); ++i) {
+    input_totals += dexes_stats[i];
+    input_dexes_stats.push_back(dexes_stats[i]);
+    stores[source_stores[i]].add_classes(std::move(dexes[i]));
+  }
+}
+
+std::string load_dex_magic(const std::string& input_file) {
+  if (!is_zip(input_file)) {
+    return load_dex_magic_from_dex(
+        DexLocation::make_location("dex", input_file));
+  }
+  DexArchive dex_archive(input_file);
+  std::string magic;
+  with_entry_contents(dex_archive.archive, *dex_archive.dex_entries.front(),
+                      [&magic](const uint8_t* data, size_t size) {
+                        always_assert(size >= sizeof(dex_header));
+                        const auto* dh =
+                            reinterpret_cast<const dex_header*>(data);
+                        magic = dh->magic;
+                      });
+  return magic;
 }
 
 /**
@@ -26,12 +26,19 @@ void load_all_intermediate(const std::string& input_ir_dir,
                            DexStoresVector& stores,
                            Json::Value* entry_data);
 
+// Each input is a .dex file, an APK (or other ZIP archive) whose
+// classes*.dex entries are read without extracting the archive, or a JSON
+// metadata file describing a secondary store.
 void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
     dex_stats_t& input_totals,
     std::vector<dex_stats_t>& input_dexes_stats);
 
+// The dex magic of the given input, in any form accepted by
+// load_classes_from_dexes_and_metadata.
+std::string load_dex_magic(const std::string& input_file);
+
 std::string get_dex_output_name(const std::string& output_dir,
                                 const DexStore& store,
                                 int index);
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+
+#include "MethodProfiles.h"
+#include "RedexContext.h"
+
+int main(int argc, char* argv[]) {
+  if (argc != 3 || std::string("--help") == argv[1] ||
+      std::string("-h") == argv[1]) {
+    std::cerr << "Usage: convert-method-profiles CSV-PROF-FILE BINARY-PROF-FILE"
+              << std::endl;
+    return argc == 1 || argc > 3 ? 1 : 0;
+  }
+
+  RedexContext rc;
+  g_redex = &rc;
+  bool success =
+      method_profiles::MethodProfiles::convert_to_binary(argv[1], argv[2]);
+  g_redex = nullptr;
+  return success ? 0 : 1;
+}
@@ -5,18 +5,56 @@
  * LICENSE file in the root directory of this source tree.
  */
 
-#include <boost/scope_exit.hpp>
+#include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "PositionMap.h"
 
-std::unique_ptr<PositionMap> read_map(const char* filename) {
-  int fd = open(filename, O_RDONLY);
+namespace {
+
+// Reads from the mapping, failing instead of reading past its end.
+class Cursor {
+ public:
+  Cursor(const uint8_t* begin, size_t size)
+      : m_ptr(begin), m_end(begin + size) {}
+
+  bool read_u32(uint32_t* value) {
+    if (remaining() < sizeof(uint32_t)) {
+      return false;
+    }
+    memcpy(value, m_ptr, sizeof(uint32_t));
+    m_ptr += sizeof(uint32_t);
+    return true;
+  }
+
+  const uint8_t* skip(size_t size) {
+    if (remaining() < size) {
+      return nullptr;
+    }
+    auto* ptr = m_ptr;
+    m_ptr += size;
+    return ptr;
+  }
+
+ private:
+  size_t remaining() const { return m_end - m_ptr; }
+
+  const uint8_t* m_ptr;
+  const uint8_t* m_end;
+};
+
+} // namespace
+
+std::unique_ptr<MappedPositionMap> MappedPositionMap::open(
+    const char* filename) {
+  int fd = ::open(filename, O_RDONLY);
   if (fd == -1) {
     std::cerr << "open failed for file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
@@ -26,44 +64,91 @@ std::unique_ptr<PositionMap> read_map(const char* filename) {
   if (fstat(fd, &buf)) {
     std::cerr << "Cannot fstat file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
+    close(fd);
     return nullptr;
   }
-  uint8_t* mapping = (uint8_t*)mmap(
-      nullptr, buf.st_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
-  uint32_t magic = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  void* mapping =
+      mmap(nullptr, buf.st_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
+  close(fd);
   if (mapping == MAP_FAILED) {
     std::cerr << "mmap failed for file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
-  BOOST_SCOPE_EXIT_ALL(=, &buf) { munmap(mapping, buf.st_size); };
-  if (magic != 0xfaceb000) {
+
+  std::unique_ptr<MappedPositionMap> map(new MappedPositionMap());
+  map->m_mapping = mapping;
+  map->m_mapping_size = buf.st_size;
+
+  Cursor cursor((const uint8_t*)mapping, buf.st_size);
+  uint32_t magic;
+  if (!cursor.read_u32(&magic) || magic != 0xfaceb000) {
     std::cerr << "Magic number mismatch\n";
     return nullptr;
   }
-  uint32_t version = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  if (version != 2) {
+  uint32_t version;
+  if (!cursor.read_u32(&version) || version != 2) {
     std::cerr << "Version mismatch\n";
     return nullptr;
   }
 
-  std::unique_ptr<PositionMap> map(new PositionMap());
-  std::vector<std::string> string_pool;
-  uint32_t spool_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  uint32_t spool_count;
+  if (!cursor.read_u32(&spool_count)) {
+    std::cerr << "Truncated string pool\n";
+    return nullptr;
+  }
+  map->m_string_pool.reserve(spool_count);
   for (uint32_t i = 0; i < spool_count; ++i) {
-    uint32_t ssize = *(uint32_t*)mapping;
-    mapping += sizeof(uint32_t);
-    map->string_pool.emplace_back((const char*)mapping, ssize);
-    mapping += ssize;
+    uint32_t ssize;
+    const uint8_t* data;
+    if (!cursor.read_u32(&ssize) || !(data = cursor.skip(ssize))) {
+      std::cerr << "Truncated string pool\n";
+      return nullptr;
+    }
+    map->m_string_pool.emplace_back((const char*)data, ssize);
+  }
+
+  uint32_t pos_count;
+  const uint8_t* positions;
+  if (!cursor.read_u32(&pos_count) ||
+      !(positions = cursor.skip((size_t)pos_count * sizeof(PositionItem)))) {
+    std::cerr << "Truncated positions\n";
+    return nullptr;
+  }
+  map->m_positions = (const PositionItem*)positions;
+  map->m_positions_size = pos_count;
+  // Checking the string ids up front keeps lookups free of bounds checks.
+  for (uint32_t i = 0; i < pos_count; ++i) {
+    const auto& pi = map->m_positions[i];
+    if (pi.class_id >= spool_count || pi.method_id >= spool_count ||
+        pi.file_id >= spool_count) {
+      std::cerr << "Invalid string id in position " << i << "\n";
+      return nullptr;
+    }
+  }
+  return map;
+}
+
+MappedPositionMap::~MappedPositionMap() {
+  if (m_mapping != nullptr) {
+    munmap(m_mapping, m_mapping_size);
+  }
+}
+
+std::unique_ptr<PositionMap> read_map(const char* filename) {
+  auto mapped = MappedPositionMap::open(filename);
+  if (!mapped) {
+    return nullptr;
+  }
+  std::unique_ptr<PositionMap> map(new PositionMap());
+  for (auto str : mapped->string_pool()) {
+    map->string_pool.emplace_back(str);
   }
-  uint32_t pos_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  auto pos_count = mapped->size();
   map->positions.reset(new PositionItem[pos_count]);
   map->positions_size = pos_count;
-  memcpy(map->positions.get(), mapping, pos_count * sizeof(PositionItem));
+  memcpy(map->positions.get(), mapped->positions(),
+         pos_count * sizeof(PositionItem));
   return map;
 }
 
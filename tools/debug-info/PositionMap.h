@@ -5,8 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#pragma once
+
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct __attribute__((packed)) PositionItem {
@@ -35,5 +38,67 @@ struct PositionMap {
   size_t positions_size;
 };
 
+/*
+ * A line map that is read in place from a read-only mapping of the file, for
+ * long-lived users that resolve many frames against the same map. The file is
+ * validated once when it is opened, after which frames are resolved without
+ * copying or allocating, with string views into the mapping.
+ */
+class MappedPositionMap {
+ public:
+  struct Frame {
+    std::string_view cls;
+    std::string_view method;
+    std::string_view filename;
+    uint32_t line;
+  };
+
+  // Returns nullptr and reports to std::cerr if the file is not a valid map.
+  static std::unique_ptr<MappedPositionMap> open(const char* filename);
+
+  ~MappedPositionMap();
+  MappedPositionMap(const MappedPositionMap&) = delete;
+  MappedPositionMap& operator=(const MappedPositionMap&) = delete;
+
+  size_t size() const { return m_positions_size; }
+
+  Frame get_frame(size_t idx) const {
+    const auto& pi = m_positions[idx];
+    return Frame{m_string_pool[pi.class_id], m_string_pool[pi.method_id],
+                 m_string_pool[pi.file_id], pi.line};
+  }
+
+  // The index of the caller frame, or -1 if idx is not inlined.
+  int64_t get_parent(size_t idx) const {
+    return (int64_t)m_positions[idx].parent - 1;
+  }
+
+  // Calls fn with each frame of the inlined stack at idx, innermost first.
+  // Like get_stack, this expects 0-based indices, and out-of-range indices
+  // yield no frames.
+  template <typename Fn>
+  void for_each_frame(int64_t idx, Fn&& fn) const {
+    while (idx >= 0 && (size_t)idx < m_positions_size) {
+      fn(get_frame(idx));
+      idx = get_parent(idx);
+    }
+  }
+
+  const std::vector<std::string_view>& string_pool() const {
+    return m_string_pool;
+  }
+
+  const PositionItem* positions() const { return m_positions; }
+
+ private:
+  MappedPositionMap() = default;
+
+  void* m_mapping{nullptr};
+  size_t m_mapping_size{0};
+  std::vector<std::string_view> m_string_pool;
+  const PositionItem* m_positions{nullptr};
+  size_t m_positions_size{0};
+};
+
 std::unique_ptr<PositionMap> read_map(const char* filename);
 std::vector<Position> get_stack(const PositionMap& map, int64_t idx);
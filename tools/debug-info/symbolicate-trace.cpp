@@ -18,18 +18,20 @@ int main(int argc, char** argv) {
     std::cerr << "Usage: cat trace | remap mapping_file\n";
     abort();
   }
-  auto map = read_map(argv[1]);
+  auto map = MappedPositionMap::open(argv[1]);
+  if (!map) {
+    return 1;
+  }
+  boost::smatch matches;
   for (std::string line; std::getline(std::cin, line);) {
-    boost::smatch matches;
     if (boost::regex_match(line, matches, trace_regex)) {
-      auto idx = std::stoi(matches[3]) - 1;
-      auto stack = get_stack(*map, idx);
-      for (const auto& pos : stack) {
-        std::cout << matches[2] << pos.cls << "." << pos.method << "("
-                  << pos.filename << ":" << pos.line << ")" << std::endl;
-      }
+      auto idx = std::stoll(matches[3]) - 1;
+      map->for_each_frame(idx, [&](const MappedPositionMap::Frame& frame) {
+        std::cout << matches[2] << frame.cls << "." << frame.method << "("
+                  << frame.filename << ":" << frame.line << ")\n";
+      });
     } else {
-      std::cout << line << std::endl;
+      std::cout << line << '\n';
     }
   }
 }
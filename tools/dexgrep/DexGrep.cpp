@@ -5,28 +5,150 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <getopt.h>
 #include <regex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include "DexCommon.h"
 
+namespace {
+
 void print_usage() {
-  fprintf(stderr, "Usage: dexgrep <classname> <dexfile 1> <dexfile 2> ...\n");
+  fprintf(stderr,
+          "Usage: dexgrep [-l] [-j <jobs>] [--index-dir <dir>] <classname> "
+          "<dexfile 1> <dexfile 2> ...\n");
+}
+
+/*
+ * An index holds the class names defined by one dex file, as a sequence of
+ * NUL-terminated strings after a small header. It is keyed by the SHA-1
+ * signature of the dex file, so it stays valid when the dex file is copied or
+ * renamed, and is simply not found anymore when its contents change.
+ */
+constexpr char INDEX_MAGIC[8] = {'D', 'G', 'I', 'D', 'X', '1', '\0', '\0'};
+
+std::string index_path(const std::string& index_dir, const dex_header* dexh) {
+  std::string path = index_dir + "/";
+  for (auto byte : dexh->signature) {
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02x", byte);
+    path += hex;
+  }
+  return path + ".dgidx";
+}
+
+// Returns false when there is no usable index at the path.
+bool read_index(const std::string& path, std::vector<std::string>* names) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(INDEX_MAGIC)) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  auto* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  bool ok = memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+            data[size - 1] == '\0';
+  if (ok) {
+    for (const char* p = data + sizeof(INDEX_MAGIC); p < data + size;
+         p += strlen(p) + 1) {
+      names->emplace_back(p);
+    }
+  }
+  munmap((void*)data, size);
+  return ok;
 }
 
+// Indices are written to a temporary file first, so that concurrent dexgrep
+// invocations never observe partially written ones.
+void write_index(const std::string& path,
+                 const std::vector<std::string>& names) {
+  auto tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == nullptr) {
+    return;
+  }
+  bool ok = fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, fp) == 1;
+  for (const auto& name : names) {
+    ok = ok && fwrite(name.c_str(), name.size() + 1, 1, fp) == 1;
+  }
+  ok = fclose(fp) == 0 && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+  }
+}
+
+std::vector<std::string> get_class_names(const char* dexfile,
+                                         const std::string& index_dir) {
+  ddump_data rd;
+  open_dex_file(dexfile, &rd);
+  std::vector<std::string> names;
+  std::string path;
+  if (!index_dir.empty()) {
+    path = index_path(index_dir, rd.dexh);
+    if (read_index(path, &names)) {
+      munmap(rd.dexmmap, rd.dex_size);
+      return names;
+    }
+    names.clear();
+  }
+
+  auto size = rd.dexh->class_defs_size;
+  names.reserve(size);
+  for (uint32_t j = 0; j < size; j++) {
+    dex_class_def* cls_def = rd.dex_class_defs + j;
+    names.emplace_back(dex_string_by_type_idx(&rd, cls_def->typeidx));
+  }
+  munmap(rd.dexmmap, rd.dex_size);
+  if (!path.empty()) {
+    write_index(path, names);
+  }
+  return names;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
   bool files_only = false;
-  char c;
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string index_dir;
+  int c;
   static const struct option options[] = {
       {"files-without-match", no_argument, nullptr, 'l'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"index-dir", required_argument, nullptr, 'i'},
+      {nullptr, 0, nullptr, 0},
   };
-  while ((c = getopt_long(argc, argv, "hl", &options[0], nullptr)) != -1) {
+  while ((c = getopt_long(argc, argv, "hlj:", &options[0], nullptr)) != -1) {
     switch (c) {
     case 'l':
       files_only = true;
       break;
+    case 'j':
+      jobs = std::max(1l, strtol(optarg, nullptr, 10));
+      break;
+    case 'i':
+      index_dir = optarg;
+      break;
     case 'h':
       print_usage();
       return 0;
@@ -45,22 +167,37 @@ int main(int argc, char* argv[]) {
   const char* search_str = argv[optind];
   std::regex re(search_str);
 
-  for (int i = optind + 1; i < argc; ++i) {
-    const char* dexfile = argv[i];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
-
-    auto size = rd.dexh->class_defs_size;
-    for (uint32_t j = 0; j < size; j++) {
-      dex_class_def* cls_def = rd.dex_class_defs + j;
-      char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
-      if (std::regex_search(name, re)) {
-        if (files_only) {
-          printf("%s\n", dexfile);
-        } else {
-          printf("%s: %s\n", dexfile, name);
+  // Dex files are scanned in parallel, but matches are printed in the order
+  // the files were given, once all of them have been scanned.
+  std::vector<const char*> dexfiles(argv + optind + 1, argv + argc);
+  std::vector<std::vector<std::string>> matches(dexfiles.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i; (i = next.fetch_add(1)) < dexfiles.size();) {
+      for (auto& name : get_class_names(dexfiles[i], index_dir)) {
+        if (std::regex_search(name, re)) {
+          matches[i].push_back(std::move(name));
         }
       }
     }
+  };
+  std::vector<std::thread> threads;
+  jobs = std::min(jobs, dexfiles.size());
+  for (size_t t = 1; t < jobs; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < dexfiles.size(); ++i) {
+    for (const auto& name : matches[i]) {
+      if (files_only) {
+        printf("%s\n", dexfiles[i]);
+      } else {
+        printf("%s: %s\n", dexfiles[i], name.c_str());
+      }
+    }
   }
 }
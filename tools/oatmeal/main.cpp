@@ -11,18 +11,24 @@
 #include "vdex.h"
 
 #include <getopt.h>
+#include <sys/mman.h>
 
 #ifndef ANDROID
 #include <wordexp.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <memory>
-
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -231,49 +237,89 @@ Arguments parse_args(int argc, char* argv[]) {
   return ret;
 }
 
-int dump(const Arguments& args) {
-  if (args.oat_files.size() != 1) {
-    fprintf(stderr, "-o/--oat required (exactly once)\n");
-    return 1;
+// The contents of a file, mmapped if possible, and read into memory
+// otherwise.
+class FileContents {
+ public:
+  UNCOPYABLE(FileContents);
+
+  FileContents() = default;
+
+  ~FileContents() {
+    if (m_mapped != nullptr) {
+      munmap(m_mapped, m_size);
+    }
   }
 
-  auto const& oat_file_name = args.oat_files[0];
-  auto oat_file = FileHandle(fopen(oat_file_name.c_str(), "r"));
-  if (oat_file.get() == nullptr) {
-    fprintf(stderr,
-            "failed to open file %s %s\n",
-            oat_file_name.c_str(),
-            std::strerror(errno));
-    return 1;
+  bool load(const std::string& file_name) {
+    auto file = FileHandle(fopen(file_name.c_str(), "r"));
+    if (file.get() == nullptr) {
+      fprintf(stderr,
+              "failed to open file %s %s\n",
+              file_name.c_str(),
+              std::strerror(errno));
+      return false;
+    }
+    m_size = get_filesize(file);
+    if (m_size > 0) {
+      auto* mapped =
+          mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileno(file.get()), 0);
+      if (mapped != MAP_FAILED) {
+        m_mapped = mapped;
+        return true;
+      }
+    }
+    // We don't run dumping during install on device, so it is allowed to
+    // consume lots of memory.
+    m_read = std::make_unique<char[]>(m_size);
+    auto bytes_read = fread(m_read.get(), 1, m_size, file.get());
+    if (bytes_read != m_size) {
+      fprintf(stderr,
+              "Failed to read file %s (%zd)\n",
+              std::strerror(errno),
+              bytes_read);
+      return false;
+    }
+    return true;
   }
 
-  auto oat_file_size = get_filesize(oat_file);
+  ConstBuffer buffer() const {
+    return ConstBuffer{m_mapped != nullptr ? static_cast<const char*>(m_mapped)
+                                           : m_read.get(),
+                       m_size};
+  }
 
-  // We don't run dumping during install on device, so it is allowed to consume
-  // lots of memory.
-  auto oat_file_contents = std::make_unique<char[]>(oat_file_size);
-  auto oatFileBytesRead =
-      fread(oat_file_contents.get(), 1, oat_file_size, oat_file.get());
-  if (oatFileBytesRead != oat_file_size) {
-    fprintf(stderr,
-            "Failed to read file %s (%zd)\n",
-            std::strerror(errno),
-            oatFileBytesRead);
+ private:
+  void* m_mapped{nullptr};
+  std::unique_ptr<char[]> m_read;
+  size_t m_size{0};
+};
+
+// Dumps a single oat or vdex file. `before_output` is called once the file is
+// parsed, before anything is printed.
+int dump_file(const Arguments& args,
+              const std::string& oat_file_name,
+              const std::function<void()>& before_output) {
+  FileContents contents;
+  if (!contents.load(oat_file_name)) {
+    before_output();
     return 1;
   }
 
-  ConstBuffer oatfile_buffer{oat_file_contents.get(), oat_file_size};
+  ConstBuffer oatfile_buffer = contents.buffer();
   auto ma_scope = MemoryAccounter::NewScope(oatfile_buffer);
 
   CHECK(oatfile_buffer.len > 4);
   if (*(reinterpret_cast<const uint32_t*>(oatfile_buffer.ptr)) ==
       kVdexMagicNum) {
     auto vdexfile = VdexFile::parse(oatfile_buffer);
+    before_output();
     vdexfile->print();
     return 0;
   }
   auto oatfile =
       OatFile::parse(oatfile_buffer, args.dex_files, args.test_is_oatmeal);
+  before_output();
 
   if (!oatfile) {
     fprintf(stderr, "Cannot open .oat file %s\n", oat_file_name.c_str());
@@ -294,6 +340,56 @@ int dump(const Arguments& args) {
   return oatfile->status() == OatFile::Status::PARSE_SUCCESS ? 0 : 1;
 }
 
+int dump(const Arguments& args) {
+  if (args.oat_files.empty()) {
+    fprintf(stderr, "-o/--oat required (at least once)\n");
+    return 1;
+  }
+
+  if (args.oat_files.size() == 1) {
+    return dump_file(args, args.oat_files[0], [] {});
+  }
+
+  // Batch mode: parse the files in parallel, but print them one after the
+  // other, in the order they were given. Files are picked up in order, so the
+  // file whose turn it is to print has always been picked up already.
+  std::atomic<size_t> next_file{0};
+  std::mutex turn_mutex;
+  std::condition_variable turn_cv;
+  size_t turn = 0;
+  std::atomic<int> result{0};
+  auto worker = [&] {
+    for (size_t i = next_file++; i < args.oat_files.size(); i = next_file++) {
+      const auto& oat_file_name = args.oat_files[i];
+      auto res = dump_file(args, oat_file_name, [&] {
+        std::unique_lock<std::mutex> lock(turn_mutex);
+        turn_cv.wait(lock, [&] { return turn == i; });
+        printf("==> %s <==\n", oat_file_name.c_str());
+      });
+      fflush(stdout);
+      {
+        std::lock_guard<std::mutex> lock(turn_mutex);
+        turn++;
+      }
+      turn_cv.notify_all();
+      if (res != 0) {
+        result = res;
+      }
+    }
+  };
+  size_t num_threads = std::min<size_t>(
+      args.oat_files.size(),
+      std::max<size_t>(1, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
 int build(const Arguments& args) {
 
   if (args.dex_files.empty()) {
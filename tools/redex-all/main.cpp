@@ -13,6 +13,7 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <regex>
 #include <set>
@@ -29,6 +30,7 @@
 #ifdef _MSC_VER
 #include <io.h>
 #else
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -36,6 +38,8 @@
 #include <boost/program_options.hpp>
 #include <json/json.h>
 
+#include <sparta/PatriciaTreeCore.h>
+
 #include "AggregateException.h"
 #include "CommandProfiling.h"
 #include "CommentFilter.h"
@@ -50,6 +54,7 @@
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "GlobalConfig.h"
+#include "HugePages.h"
 #include "IODIMetadata.h"
 #include "InstructionLowering.h"
 #include "JarLoader.h"
@@ -76,6 +81,7 @@
 #include "ScopedMemStats.h"
 #include "Show.h"
 #include "ThreadPool.h"
+#include "TimelineTrace.h"
 #include "Timer.h"
 #include "ToolsCommon.h"
 #include "Walkers.h"
@@ -95,6 +101,7 @@ const std::string k_usage_header = "usage: redex-all [options...] dex-files...";
 
 void print_usage() {
   std::cout << k_usage_header << std::endl;
+  std::cout << "   or: redex-all --serve [library-jars...]" << std::endl;
   std::cout << "Try 'redex-all -h' for more information." << std::endl;
 }
 
@@ -733,6 +740,9 @@ Json::Value get_stats(const dex_stats_t& stats) {
   val["encoded_array_bytes"] = stats.encoded_array_bytes;
   val["annotations_directory_count"] = stats.annotations_directory_count;
   val["annotations_directory_bytes"] = stats.annotations_directory_bytes;
+  val["cold_start_code_pages"] = stats.cold_start_code_pages;
+  val["cold_start_string_data_pages"] = stats.cold_start_string_data_pages;
+  val["cold_start_class_data_pages"] = stats.cold_start_class_data_pages;
 
   return val;
 }
@@ -951,23 +961,6 @@ void write_debug_line_mapping(
    *   a list (n elements) of:
    *     [ memory offset (4 byte), line number (4 byte) ]
    */
-  size_t bit_32_size = sizeof(uint32_t);
-  size_t bit_64_size = sizeof(uint64_t);
-  uint32_t num_method = code_debug_lines.size();
-  int offset = num_method + 2;
-  // Start of debug line info information would be after all of
-  // method-id => offset info, so set the start of offset to be after that.
-  int binary_offset =
-      3 * bit_32_size + (bit_64_size + 2 * bit_32_size) * num_method;
-  std::ofstream ofs(debug_line_map_filename.c_str(),
-                    std::ofstream::out | std::ofstream::trunc);
-  uint32_t magic = 0xfaceb000; // serves as endianess check
-  ofs.write((const char*)&magic, bit_32_size);
-  uint32_t version = 1;
-  ofs.write((const char*)&version, bit_32_size);
-  ofs.write((const char*)&num_method, bit_32_size);
-  std::ostringstream line_out;
-
   auto scope = build_class_scope(stores);
   std::vector<DexMethod*> all_methods(std::begin(needs_debug_line_mapping),
                                       std::end(needs_debug_line_mapping));
@@ -975,41 +968,63 @@ void write_debug_line_mapping(
                 [&](DexMethod* method) { all_methods.push_back(method); });
   std::stable_sort(all_methods.begin(), all_methods.end(), compare_dexmethods);
 
+  std::vector<std::pair<uint64_t, const std::vector<DebugLineItem>*>> entries;
+  entries.reserve(code_debug_lines.size());
   for (auto* method : all_methods) {
     auto dex_code = method->get_dex_code();
-    if (dex_code == nullptr ||
-        code_debug_lines.find(dex_code) == code_debug_lines.end()) {
+    if (dex_code == nullptr) {
       continue;
     }
+    auto it = code_debug_lines.find(dex_code);
+    if (it == code_debug_lines.end()) {
+      continue;
+    }
+    entries.emplace_back(method_to_id.at(method), &it->second);
+  }
 
-    uint64_t method_id = method_to_id.at(method);
-    // write method id => offset info for binary file
-    ofs.write((const char*)&method_id, bit_64_size);
-    ofs.write((const char*)&binary_offset, bit_32_size);
-
-    auto debug_lines = code_debug_lines.at(dex_code);
-    uint32_t num_line_info = debug_lines.size();
-    offset = offset + 1 + num_line_info;
-    uint32_t info_section_size = bit_64_size + num_line_info * 2 * bit_32_size;
-    ofs.write((const char*)&info_section_size, bit_32_size);
-    binary_offset = binary_offset + info_section_size;
+  // The index and the line info are both written straight from `entries`,
+  // as the size of every method's line info is known upfront.
+  std::ofstream ofs(debug_line_map_filename.c_str(),
+                    std::ofstream::out | std::ofstream::trunc);
+  auto write_u32 = [&ofs](uint32_t v) {
+    ofs.write((const char*)&v, sizeof(v));
+  };
+  auto write_u64 = [&ofs](uint64_t v) {
+    ofs.write((const char*)&v, sizeof(v));
+  };
+  uint32_t num_method = code_debug_lines.size();
+  write_u32(0xfaceb000); // serves as endianess check
+  write_u32(/* version */ 1);
+  write_u32(num_method);
 
-    // Generate debug line info for binary file.
-    line_out.write((const char*)&method_id, bit_64_size);
-    for (auto it = debug_lines.begin(); it != debug_lines.end(); ++it) {
-      line_out.write((const char*)&it->offset, bit_32_size);
-      line_out.write((const char*)&it->line, bit_32_size);
-    }
+  // Start of debug line info information would be after all of
+  // method-id => offset info, so set the start of offset to be after that.
+  uint32_t binary_offset = 3 * sizeof(uint32_t) +
+                           (sizeof(uint64_t) + 2 * sizeof(uint32_t)) *
+                               num_method;
+  for (const auto& [method_id, debug_lines] : entries) {
+    uint32_t info_section_size =
+        sizeof(uint64_t) + debug_lines->size() * 2 * sizeof(uint32_t);
+    write_u64(method_id);
+    write_u32(binary_offset);
+    write_u32(info_section_size);
+    binary_offset += info_section_size;
+  }
+  static_assert(sizeof(DebugLineItem) == 2 * sizeof(uint32_t) &&
+                    offsetof(DebugLineItem, offset) == 0,
+                "DebugLineItems must be laid out like the file's line info");
+  for (const auto& [method_id, debug_lines] : entries) {
+    write_u64(method_id);
+    ofs.write((const char*)debug_lines->data(),
+              debug_lines->size() * sizeof(DebugLineItem));
   }
-  ofs << line_out.str();
 }
 
 std::string get_dex_magic(std::vector<std::string>& dex_files) {
   always_assert_log(!dex_files.empty(), "APK contains no dex file\n");
   // Get dex magic from the first dex file since all dex magic
   // should be consistent within one APK.
-  return load_dex_magic_from_dex(
-      DexLocation::make_location("dex", dex_files[0]));
+  return redex::load_dex_magic(dex_files[0]);
 }
 
 void dump_keep_reasons(const ConfigFiles& conf,
@@ -1110,30 +1125,43 @@ void process_proguard_rules(ConfigFiles& conf,
   }
 }
 
+// The library jars that a `--serve` server loaded before forking for a build,
+// by absolute path and in load order, with their classes. See serve().
+std::vector<std::pair<std::string, Scope>> s_preloaded_jars;
+
 void load_library_jars(Arguments& args,
                        Scope& external_classes,
                        const std::set<std::string>& library_jars,
                        const std::string& base_dir) {
   args.entry_data["jars"] = Json::arrayValue;
-  if (library_jars.empty()) {
+  if (library_jars.empty() && s_preloaded_jars.empty()) {
     return;
   }
 
-  auto load = [&](const auto& allowed_fn) {
+  auto load = [&](const jar_loader::duplicate_allowed_hook_t& allowed_fn) {
+    std::vector<std::pair<const DexLocation*, Scope*>> jars;
+    // The absolute paths of the library jars, and where their classes go, for
+    // builds served by serve().
+    std::vector<std::pair<std::string, Scope*>> served_jars;
     for (const auto& library_jar : library_jars) {
       TRACE(MAIN, 1, "LIBRARY JAR: %s", library_jar.c_str());
-      if (load_jar_file(DexLocation::make_location("", library_jar),
-                        &external_classes, /*attr_hook=*/nullptr, allowed_fn)) {
+      if (boost::filesystem::is_regular_file(library_jar)) {
         auto abs_path = boost::filesystem::absolute(library_jar);
         args.entry_data["jars"].append(abs_path.string());
+        served_jars.emplace_back(abs_path.string(), &external_classes);
+        jars.emplace_back(DexLocation::make_location("", library_jar),
+                          &external_classes);
         continue;
       }
 
       // Try again with the basedir
       std::string basedir_path = base_dir + "/" + library_jar;
-      if (load_jar_file(DexLocation::make_location("", basedir_path),
-                        /*classes=*/nullptr, /*attr_hook=*/nullptr,
-                        allowed_fn)) {
+      if (boost::filesystem::is_regular_file(basedir_path)) {
+        served_jars.emplace_back(
+            boost::filesystem::absolute(basedir_path).string(),
+            /*classes=*/nullptr);
+        jars.emplace_back(DexLocation::make_location("", basedir_path),
+                          /*classes=*/nullptr);
         args.entry_data["jars"].append(basedir_path);
         continue;
       }
@@ -1142,6 +1170,33 @@ void load_library_jars(Arguments& args,
                 << std::endl;
       _exit(EXIT_FAILURE);
     }
+    if (!s_preloaded_jars.empty()) {
+      // The classes of any other preloaded jar would be visible to the build,
+      // and jars loaded in a different order would resolve duplicate classes
+      // differently, so only the exact preloaded jars can be reused.
+      bool same_jars = served_jars.size() == s_preloaded_jars.size();
+      for (size_t i = 0; same_jars && i < served_jars.size(); ++i) {
+        same_jars = served_jars[i].first == s_preloaded_jars[i].first;
+      }
+      if (!same_jars) {
+        std::cerr << "error: served builds must use exactly the preloaded "
+                     "library jars, in the same order"
+                  << std::endl;
+        _exit(EXIT_FAILURE);
+      }
+      TRACE(MAIN, 1, "Using preloaded library jars");
+      for (size_t i = 0; i < served_jars.size(); ++i) {
+        if (auto* classes = served_jars[i].second) {
+          const auto& preloaded = s_preloaded_jars[i].second;
+          classes->insert(classes->end(), preloaded.begin(), preloaded.end());
+        }
+      }
+      return;
+    }
+    if (!load_jar_files(jars, allowed_fn)) {
+      std::cerr << "error: library jars could not be loaded" << std::endl;
+      _exit(EXIT_FAILURE);
+    }
   };
 
   // We cannot use GlobalConfig here, it is too early.
@@ -1178,13 +1233,20 @@ void redex_frontend(ConfigFiles& conf, /* input */
                     Json::Value& stats) {
   Timer redex_frontend_timer("Redex_frontend");
 
+  // Read the profiles and class lists while parsing and loading the inputs.
+  bool prefetch_config_files =
+      args.config.get("prefetch_config_files", false).asBool();
+  if (prefetch_config_files) {
+    conf.prefetch();
+  }
+
   g_redex->load_pointers_cache();
 
   keep_rules::proguard_parser::Stats parser_stats{};
-  for (const auto& pg_config_path : args.proguard_config_paths) {
-    Timer time_pg_parsing("Parsed ProGuard config file");
-    parser_stats +=
-        keep_rules::proguard_parser::parse_file(pg_config_path, &pg_config);
+  {
+    Timer time_pg_parsing("Parsed ProGuard config files");
+    parser_stats += keep_rules::proguard_parser::parse_files(
+        args.proguard_config_paths, &pg_config);
   }
 
   size_t blocklisted_rules{0};
@@ -1290,6 +1352,13 @@ void redex_frontend(ConfigFiles& conf, /* input */
       apply_deobfuscated_names(store.get_dexen(), conf.get_proguard_map());
     }
   }
+  if (prefetch_config_files) {
+    Timer t("Resolving prefetched method profiles");
+    conf.wait_for_prefetch();
+    // The method profiles were parsed before the classes were loaded, so
+    // resolve them now, like they would have been when loaded lazily.
+    conf.process_unresolved_method_profile_lines();
+  }
   DexStoreClassesIterator it(stores);
   Scope scope = build_class_scope(it);
   {
@@ -1481,6 +1550,11 @@ void redex_backend(ConfigFiles& conf,
 
   auto string_sort_mode = get_string_sort_mode(conf);
 
+  // The outputs written after the dexes do not depend on each other, so they
+  // are written concurrently at the end.
+  std::vector<std::function<void()>> output_writers;
+
+  Json::Value full_json_root{Json::ValueType::objectValue};
   bool should_preserve_input_dexes =
       conf.get_json_config().get("preserve_input_dexes", false);
   if (should_preserve_input_dexes) {
@@ -1490,46 +1564,84 @@ void redex_backend(ConfigFiles& conf,
     const auto& dex_magic = stores[0].get_dex_magic();
     auto min_sdk = manager.get_redex_options().min_sdk;
     ScopedMemStats wod_mem_stats{mem_stats_enabled, reset_hwm};
-    Json::Value full_json_root{Json::ValueType::objectValue};
     constexpr const char* kJsonTimerName =
         "Collecting full-rename-map-json data";
     AccumulatingTimer json_timer{kJsonTimerName};
+    auto add_dex_stats = [&](const std::string& store_name,
+                             enhanced_dex_stats_t&& this_dex_stats) {
+      output_totals += this_dex_stats;
+      // Remove class sizes here to free up memory.
+      this_dex_stats.class_size.clear();
+      signatures.insert(*reinterpret_cast<uint32_t*>(this_dex_stats.signature));
+      output_dexes_stats.push_back(
+          std::make_pair(store_name, std::move(this_dex_stats)));
+    };
+    if (dex_output_config.parallel) {
+      // The dexes of all stores are written as one batch, as apps with many
+      // small stores would otherwise leave most threads idle.
+      Timer t("Writing optimized dexes");
+      std::vector<std::vector<SortMode>> code_sort_modes;
+      code_sort_modes.reserve(stores.size());
+      std::vector<DexOutputJob> jobs;
+      for (size_t store_number = 0; store_number < stores.size();
+           ++store_number) {
+        auto& store = stores[store_number];
+        code_sort_modes.push_back(get_code_sort_mode(conf, store.get_name()));
+        for (size_t i = 0; i < store.get_dexen().size(); i++) {
+          jobs.push_back(DexOutputJob{
+              redex::get_dex_output_name(output_dir, store, i),
+              &store.get_dexen()[i], store_number, &store.get_name(), i,
+              &code_sort_modes.back()});
+        }
+      }
+      auto dexes_stats = write_classes_to_dexes(
+          jobs,
+          conf,
+          pos_mapper.get(),
+          redex_options.debug_info_kind,
+          needs_addresses ? &method_to_id : nullptr,
+          needs_addresses ? &code_debug_lines : nullptr,
+          is_iodi(dik) ? &iodi_metadata : nullptr,
+          dex_magic,
+          dex_output_config,
+          min_sdk,
+          string_sort_mode);
+      for (size_t i = 0; i < jobs.size(); i++) {
+        add_dex_stats(*jobs[i].store_name, std::move(dexes_stats[i]));
+      }
+    }
     for (size_t store_number = 0; store_number < stores.size();
          ++store_number) {
       auto& store = stores[store_number];
       const auto& store_name = store.get_name();
-      auto code_sort_mode = get_code_sort_mode(conf, store_name);
-      Timer t("Writing optimized dexes");
-      for (size_t i = 0; i < store.get_dexen().size(); i++) {
-        DexClasses* classes = &store.get_dexen()[i];
-        auto gtypes = std::make_shared<GatheredTypes>(classes);
-
-        auto this_dex_stats = write_classes_to_dex(
-            redex::get_dex_output_name(output_dir, store, i),
-            classes,
-            gtypes,
-            store_number,
-            &store_name,
-            i,
-            conf,
-            pos_mapper.get(),
-            redex_options.debug_info_kind,
-            needs_addresses ? &method_to_id : nullptr,
-            needs_addresses ? &code_debug_lines : nullptr,
-            is_iodi(dik) ? &iodi_metadata : nullptr,
-            dex_magic,
-            dex_output_config,
-            min_sdk,
-            code_sort_mode,
-            string_sort_mode);
-
-        output_totals += this_dex_stats;
-        // Remove class sizes here to free up memory.
-        this_dex_stats.class_size.clear();
-        signatures.insert(
-            *reinterpret_cast<uint32_t*>(this_dex_stats.signature));
-        output_dexes_stats.push_back(
-            std::make_pair(store.get_name(), std::move(this_dex_stats)));
+      if (!dex_output_config.parallel) {
+        auto code_sort_mode = get_code_sort_mode(conf, store_name);
+        Timer t("Writing optimized dexes");
+        for (size_t i = 0; i < store.get_dexen().size(); i++) {
+          DexClasses* classes = &store.get_dexen()[i];
+          auto gtypes = std::make_shared<GatheredTypes>(classes);
+
+          add_dex_stats(
+              store_name,
+              write_classes_to_dex(
+                  redex::get_dex_output_name(output_dir, store, i),
+                  classes,
+                  gtypes,
+                  store_number,
+                  &store_name,
+                  i,
+                  conf,
+                  pos_mapper.get(),
+                  redex_options.debug_info_kind,
+                  needs_addresses ? &method_to_id : nullptr,
+                  needs_addresses ? &code_debug_lines : nullptr,
+                  is_iodi(dik) ? &iodi_metadata : nullptr,
+                  dex_magic,
+                  dex_output_config,
+                  min_sdk,
+                  code_sort_mode,
+                  string_sort_mode));
+        }
       }
       {
         auto timer_scope = json_timer.scope();
@@ -1539,59 +1651,56 @@ void redex_backend(ConfigFiles& conf,
     Timer::add_timer(kJsonTimerName, json_timer.get_seconds());
     wod_mem_stats.trace_log("Writing optimized dexes");
 
-    {
-      Timer t("Writing full rename map JSON");
+    output_writers.emplace_back([&]() {
+      Timer t("Writing full rename map JSON", /* indent */ false);
       std::ofstream ofs(conf.metafile("redex-full-rename-map.json"));
       ofs << full_json_root;
-    }
+    });
   }
 
   sanitizers::lsan_do_recoverable_leak_check();
 
   std::vector<DexMethod*> needs_debug_line_mapping;
 
-  {
-    Timer t("Writing opt decisions data");
-    const Json::Value& opt_decisions_args = json_config["opt_decisions"];
-    if (opt_decisions_args.get("enable_logs", false).asBool()) {
+  const Json::Value& opt_decisions_args = json_config["opt_decisions"];
+  if (opt_decisions_args.get("enable_logs", false).asBool()) {
+    output_writers.emplace_back([&]() {
+      Timer t("Writing opt decisions data", /* indent */ false);
       auto opt_decisions_output_path = conf.metafile(OPT_DECISIONS);
-      auto opt_data =
-          opt_metadata::OptDataMapper::get_instance().serialize_sql();
-      {
-        std::ofstream opt_data_out(opt_decisions_output_path);
-        opt_data_out << opt_data;
-      }
-    }
+      std::ofstream opt_data_out(opt_decisions_output_path);
+      opt_metadata::OptDataMapper::get_instance().serialize_sql(opt_data_out);
+    });
   }
 
-  {
-    Timer t("Writing stats");
-    auto method_move_map =
-        conf.metafile(json_config.get("method_move_map", std::string()));
-    if (needs_addresses) {
-      Timer t2{"Writing debug line mapping"};
+  if (needs_addresses) {
+    output_writers.emplace_back([&]() {
+      Timer t("Writing debug line mapping", /* indent */ false);
       write_debug_line_mapping(debug_line_map_filename, method_to_id,
                                code_debug_lines, stores,
                                needs_debug_line_mapping);
-    }
-    if (is_iodi(dik)) {
-      Timer t2{"Writing IODI metadata"};
+    });
+  }
+  if (is_iodi(dik)) {
+    output_writers.emplace_back([&]() {
+      Timer t("Writing IODI metadata", /* indent */ false);
       iodi_metadata.write(iodi_metadata_filename, method_to_id);
-    }
+    });
+  }
+  // The position map may still grow while being written, so the output stats,
+  // which include its size, are only collected afterwards.
+  output_writers.emplace_back([&]() {
     {
-      Timer t2{"Writing position map"};
+      Timer t("Writing position map", /* indent */ false);
       pos_mapper->write_map();
     }
-    {
-      Timer t2{"Collecting output stats"};
-      stats["output_stats"] =
-          get_output_stats(output_totals, output_dexes_stats, manager,
-                           instruction_lowering_stats, pos_mapper.get());
-    }
-    print_warning_summary();
-
-    if (dex_output_config.write_class_sizes) {
-      Timer t2("Writing class sizes");
+    Timer t("Collecting output stats", /* indent */ false);
+    stats["output_stats"] =
+        get_output_stats(output_totals, output_dexes_stats, manager,
+                         instruction_lowering_stats, pos_mapper.get());
+  });
+  if (dex_output_config.write_class_sizes) {
+    output_writers.emplace_back([&]() {
+      Timer t("Writing class sizes", /* indent */ false);
       // Sort for stability.
       std::vector<const DexClass*> keys;
       std::transform(output_totals.class_size.begin(),
@@ -1603,8 +1712,17 @@ void redex_backend(ConfigFiles& conf,
         ofs << c->get_deobfuscated_name_or_empty() << ","
             << output_totals.class_size.at(c) << "\n";
       }
-    }
+    });
+  }
+
+  {
+    Timer t("Writing stats");
+    workqueue_run<std::function<void()>>(
+        [](const std::function<void()>& fn) { fn(); }, output_writers,
+        std::min<unsigned int>(output_writers.size(),
+                               redex_parallel::default_num_threads()));
   }
+  print_warning_summary();
 }
 
 void dump_class_method_info_map(const std::string& file_path,
@@ -1762,32 +1880,7 @@ int check_pass_properties(const Arguments& args) {
   return 0;
 }
 
-} // namespace
-
-// NOLINTNEXTLINE(bugprone-exception-escape)
-int main(int argc, char* argv[]) {
-  signal(SIGABRT, debug_backtrace_handler);
-  signal(SIGINT, debug_backtrace_handler);
-  signal(SIGSEGV, crash_backtrace_handler);
-#if !IS_WINDOWS
-  signal(SIGBUS, crash_backtrace_handler);
-#endif
-
-  // Only log one assert.
-  block_multi_asserts(/*block=*/true);
-  // For better stacks in abort dumps.
-  set_abort_if_not_this_thread();
-
-  // For Breadcrumbs issues, do not throw, do not print stack trace. Improves
-  // error readability.
-  redex_debug::set_exc_type_as_abort(RedexError::REJECTED_CODING_PATTERN);
-  redex_debug::disable_stack_trace_for_exc_type(
-      RedexError::REJECTED_CODING_PATTERN);
-
-  // Input type check issues are a straight issue, not a Redex crash.
-  redex_debug::set_exc_type_as_abort(RedexError::TYPE_CHECK_ERROR);
-  redex_debug::disable_stack_trace_for_exc_type(RedexError::TYPE_CHECK_ERROR);
-
+int redex_all(int argc, char* argv[]) {
   auto maybe_global_profile =
       ScopedCommandProfiling::maybe_from_env("GLOBAL_", "global");
 
@@ -1795,12 +1888,16 @@ int main(int argc, char* argv[]) {
       concurrent_container_destruction_scope;
 
   std::string stats_output_path;
+  std::string timeline_trace_path;
   Json::Value stats;
   double cpu_time_s;
   {
     Timer redex_all_main_timer("redex-all main()");
 
-    g_redex = new RedexContext();
+    // Builds served by serve() inherit the context of the server.
+    if (g_redex == nullptr) {
+      g_redex = new RedexContext();
+    }
 
     // Currently there are two sources that specify the library jars:
     // 1. The jar_path argument, which may specify one library jar.
@@ -1818,8 +1915,31 @@ int main(int argc, char* argv[]) {
       return check_pass_properties(args);
     }
 
+    if (!args.config.get("timeline_trace_output", "").asString().empty()) {
+      timeline_trace::enable(
+          args.config.get("timeline_trace_work_queues", false).asBool());
+    }
+
+    if (args.config.get("pin_threads", false).asBool()) {
+      // Work queues then run on a pool of threads that are each pinned to a
+      // CPU, instead of spawning new threads every time.
+      redex_thread_pool::ThreadPool::create(/* pin_threads= */ true);
+    }
+
     keep_reason::Reason::set_record_keep_reasons(
         args.config.get("record_keep_reasons", false).asBool());
+    // Before any dex gets mapped, so that the inputs are covered as well.
+    huge_pages::set_enabled(args.config.get("huge_pages", false).asBool());
+    g_redex->zero_copy_dex_strings =
+        args.config.get("zero_copy_dex_strings", false).asBool();
+    g_redex->lazy_dex_code =
+        args.config.get("lazy_dex_code", false).asBool();
+    g_redex->lazy_dex_annotations =
+        args.config.get("lazy_dex_annotations", false).asBool();
+    g_redex->build_cfg_at_balloon =
+        args.config.get("build_cfg_at_balloon", false).asBool();
+    sparta::pt_core::set_hash_consing_enabled(
+        args.config.get("patricia_tree_hash_consing", false).asBool());
 
     // For convenience.
     g_redex->instrument_mode = args.redex_options.instrument_pass_enabled;
@@ -1894,7 +2014,21 @@ int main(int argc, char* argv[]) {
       maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_AFTER_ALL_PASSES");
     }
 
-    if (args.stop_pass_idx == boost::none) {
+    if (const auto& checkpoint = manager.get_checkpoint()) {
+      // Forked checkpoint child: dump the snapshot for `redex-opt --resume`.
+      auto& checkpoint_data = args.entry_data["checkpoint"];
+      checkpoint_data["after_pass"] = checkpoint->after_pass;
+      checkpoint_data["passes_run_for_output"] = Json::arrayValue;
+      for (const auto& pass_name : checkpoint->passes_run_for_output) {
+        checkpoint_data["passes_run_for_output"].append(pass_name);
+      }
+      checkpoint_data["next_passes"] = Json::arrayValue;
+      for (const auto& pass_name : checkpoint->next_passes) {
+        checkpoint_data["next_passes"].append(pass_name);
+      }
+      redex::write_all_intermediate(conf, checkpoint->dir, args.redex_options,
+                                    stores, args.entry_data);
+    } else if (args.stop_pass_idx == boost::none) {
       // Call redex_backend by default
       auto profile_backend =
           ScopedCommandProfiling::maybe_from_env("BACKEND_", "backend");
@@ -1911,6 +2045,10 @@ int main(int argc, char* argv[]) {
 
     stats_output_path = conf.metafile(
         args.config.get("stats_output", "redex-stats.txt").asString());
+    if (timeline_trace::is_enabled()) {
+      timeline_trace_path =
+          conf.metafile(args.config["timeline_trace_output"].asString());
+    }
 
     {
       Timer t("Freeing global memory");
@@ -1925,6 +2063,15 @@ int main(int argc, char* argv[]) {
   stats["output_stats"]["mem_stats"]["vm_peak"] =
       (Json::UInt64)vm_stats.vm_peak;
   stats["output_stats"]["mem_stats"]["vm_hwm"] = (Json::UInt64)vm_stats.vm_hwm;
+  if (huge_pages::is_enabled()) {
+    auto huge_page_stats = huge_pages::get_stats();
+    auto& huge_pages_json = stats["output_stats"]["mem_stats"]["huge_pages"];
+    huge_pages_json["advised"] = (Json::UInt64)huge_page_stats.advised;
+    huge_pages_json["anon_huge_pages"] =
+        (Json::UInt64)huge_page_stats.anon_huge_pages;
+    huge_pages_json["file_pmd_mapped"] =
+        (Json::UInt64)huge_page_stats.file_pmd_mapped;
+  }
 
   stats["output_stats"]["threads"] = get_threads_stats();
 
@@ -1937,6 +2084,10 @@ int main(int argc, char* argv[]) {
     out << stats;
   }
 
+  if (!timeline_trace_path.empty()) {
+    timeline_trace::write(timeline_trace_path);
+  }
+
   TRACE(MAIN, 1, "Done.");
   if (traceEnabled(MAIN, 1) || traceEnabled(STATS, 1)) {
     TRACE(STATS, 0, "Memory stats: VmPeak=%s VmHWM=%s",
@@ -1950,3 +2101,121 @@ int main(int argc, char* argv[]) {
 
   return 0;
 }
+
+#if !IS_WINDOWS
+/*
+ * Serves builds from a process that already loaded the given library jars,
+ * e.g. the Android SDK, to save loading them again for every build. Every line
+ * on stdin is a JSON array with the arguments of one redex-all invocation.
+ * Each build runs in a forked child that starts from the state of the server,
+ * and the server answers every request with a line `{"exit_code": N}` on
+ * stdout.
+ *
+ * A build must use exactly the preloaded jars, in the order in which a
+ * standalone run would load them. As the preloaded jars get loaded before any
+ * dex, the dexes of a build must not define any of their classes either;
+ * such builds fail rather than resolve the duplicates differently.
+ */
+int serve(const std::vector<std::string>& preload_jars) {
+  g_redex = new RedexContext();
+  {
+    Timer t("Preload library jars");
+    std::vector<std::pair<const DexLocation*, Scope*>> jars;
+    s_preloaded_jars.reserve(preload_jars.size());
+    for (const auto& jar : preload_jars) {
+      auto abs_path = boost::filesystem::absolute(jar).string();
+      TRACE(MAIN, 1, "PRELOADED LIBRARY JAR: %s", abs_path.c_str());
+      s_preloaded_jars.emplace_back(abs_path, Scope());
+      jars.emplace_back(DexLocation::make_location("", abs_path),
+                        &s_preloaded_jars.back().second);
+    }
+    if (!load_jar_files(jars)) {
+      std::cerr << "error: library jars could not be preloaded" << std::endl;
+      return EXIT_FAILURE;
+    }
+    g_redex->library_classes_preloaded = true;
+  }
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::vector<std::string> args{"redex-all"};
+    try {
+      auto request = parse_json_value(line);
+      always_assert_log(request.isArray(), "Expected an array of arguments");
+      for (const auto& arg : request) {
+        args.push_back(arg.asString());
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "error: malformed request: " << e.what() << std::endl;
+      std::cout << "{\"exit_code\": " << EXIT_FAILURE << "}" << std::endl;
+      continue;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "error: fork failed: " << strerror(errno) << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+      std::vector<char*> argv;
+      for (auto& arg : args) {
+        argv.push_back(arg.data());
+      }
+      argv.push_back(nullptr);
+      int exit_code = redex_all(argv.size() - 1, argv.data());
+      std::cout.flush();
+      std::cerr.flush();
+      fflush(nullptr);
+      _exit(exit_code);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    int exit_code = WIFEXITED(status) ? WEXITSTATUS(status)
+                                      : 128 + WTERMSIG(status);
+    std::cout << "{\"exit_code\": " << exit_code << "}" << std::endl;
+  }
+  return 0;
+}
+#endif
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, char* argv[]) {
+  signal(SIGABRT, debug_backtrace_handler);
+  signal(SIGINT, debug_backtrace_handler);
+  signal(SIGSEGV, crash_backtrace_handler);
+#if !IS_WINDOWS
+  signal(SIGBUS, crash_backtrace_handler);
+#endif
+
+  // Only log one assert.
+  block_multi_asserts(/*block=*/true);
+  // For better stacks in abort dumps.
+  set_abort_if_not_this_thread();
+
+  // For Breadcrumbs issues, do not throw, do not print stack trace. Improves
+  // error readability.
+  redex_debug::set_exc_type_as_abort(RedexError::REJECTED_CODING_PATTERN);
+  redex_debug::disable_stack_trace_for_exc_type(
+      RedexError::REJECTED_CODING_PATTERN);
+
+  // Input type check issues are a straight issue, not a Redex crash.
+  redex_debug::set_exc_type_as_abort(RedexError::TYPE_CHECK_ERROR);
+  redex_debug::disable_stack_trace_for_exc_type(RedexError::TYPE_CHECK_ERROR);
+
+#if !IS_WINDOWS
+  // `redex-all --serve [library jars...]`, see serve().
+  if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+    return serve(std::vector<std::string>(argv + 2, argv + argc));
+  }
+#endif
+
+  return redex_all(argc, argv);
+}
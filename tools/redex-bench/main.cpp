@@ -0,0 +1,605 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Benchmarks passes on a fixed input.
+ *
+ * The input is a dex and IR meta directory, as written at a checkpoint (see
+ * `checkpoint_after_pass`) or by redex-opt. Each repetition loads a fresh copy
+ * of that snapshot into a new RedexContext and runs the selected passes on
+ * it, so that all repetitions see the same input. Loading is not part of the
+ * measurements. For every pass, the wall time, CPU time and resident set size
+ * recorded by the PassManager are summarized over the measured repetitions,
+ * and written out as JSON.
+ *
+ * With --round-trip, no passes are run. Instead, the given dex files are taken
+ * through the fixed steps of every redex build: loading, ballooning, building
+ * and linearizing the CFGs, instruction lowering and writing the dexes. Each
+ * step is measured like a pass, and the throughput of the whole round trip is
+ * reported in MB of input dex per second.
+ *
+ * With --regalloc N, the snapshot is loaded once, and the graph coloring and
+ * linear scan register allocators are run repeatedly on copies of the N
+ * largest methods and the N methods with the highest register pressure. For
+ * each method and allocator, the allocation time, the resulting register
+ * count, the moves inserted and the change in code units are reported.
+ */
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <json/json.h>
+#include <map>
+#include <unordered_set>
+
+#include "DebugUtils.h"
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "DexOutput.h"
+#include "DexPosition.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "InstructionLowering.h"
+#include "LinearScan.h"
+#include "Liveness.h"
+#include "PassManager.h"
+#include "PassRegistry.h"
+#include "RedexContext.h"
+#include "RegisterAllocation.h"
+#include "Show.h"
+#include "ToolsCommon.h"
+#include "Walkers.h"
+
+namespace {
+
+struct Arguments {
+  std::string input_ir_dir;
+  std::vector<std::string> pass_names;
+  std::vector<std::string> round_trip_dexes;
+  std::string config_file;
+  std::string output_file;
+  size_t repeat{5};
+  size_t warmup{1};
+  size_t regalloc_methods{0};
+};
+
+Arguments parse_args(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  po::options_description desc(
+      "Run passes repeatedly on a dex and IR meta snapshot, and report their "
+      "timing and memory usage");
+  desc.add_options()("help,h", "produce help message");
+  desc.add_options()("input-ir,i", po::value<std::string>(),
+                     "input dex and IR meta directory");
+  desc.add_options()("pass-name,p", po::value<std::vector<std::string>>(),
+                     "pass name; may be given multiple times, and defaults to "
+                     "the passes following the checkpoint of the input");
+  desc.add_options()("round-trip,r", po::value<std::vector<std::string>>(),
+                     "dex file to load and write back without running any "
+                     "passes, instead of an input-ir; may be given multiple "
+                     "times");
+  desc.add_options()("regalloc", po::value<size_t>(),
+                     "instead of running passes, benchmark the register "
+                     "allocators on this many of the largest and of the most "
+                     "register-hungry methods of the input-ir");
+  desc.add_options()("config,c", po::value<std::string>(),
+                     "A JSON-formatted config file to replace the one from "
+                     "{input-ir}/entry.json");
+  desc.add_options()("repeat,n", po::value<size_t>(),
+                     "number of measured repetitions (default 5)");
+  desc.add_options()("warmup,w", po::value<size_t>(),
+                     "number of repetitions run before measuring (default 1)");
+  desc.add_options()("output,o", po::value<std::string>(),
+                     "JSON output file (default: stdout)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    desc.print(std::cout);
+    exit(EXIT_SUCCESS);
+  }
+
+  Arguments args;
+  if (vm.count("round-trip")) {
+    args.round_trip_dexes = vm["round-trip"].as<std::vector<std::string>>();
+  } else if (!vm.count("input-ir")) {
+    std::cerr << "input-ir or round-trip is required\n";
+    exit(EXIT_FAILURE);
+  } else {
+    args.input_ir_dir = vm["input-ir"].as<std::string>();
+  }
+  if (vm.count("pass-name")) {
+    args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
+  }
+  if (vm.count("config")) {
+    args.config_file = vm["config"].as<std::string>();
+  }
+  if (vm.count("repeat")) {
+    args.repeat = vm["repeat"].as<size_t>();
+  }
+  if (args.repeat == 0) {
+    std::cerr << "repeat must be positive\n";
+    exit(EXIT_FAILURE);
+  }
+  if (vm.count("warmup")) {
+    args.warmup = vm["warmup"].as<size_t>();
+  }
+  if (vm.count("regalloc")) {
+    args.regalloc_methods = vm["regalloc"].as<size_t>();
+    if (args.input_ir_dir.empty()) {
+      std::cerr << "regalloc requires an input-ir\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (vm.count("output")) {
+    args.output_file = vm["output"].as<std::string>();
+  }
+  return args;
+}
+
+// The measurements of one run of a pass, from the PassManager metrics.
+struct Sample {
+  double wall_time_s;
+  double cpu_time_s;
+  int64_t rss_after;
+  int64_t hwm_delta;
+};
+
+Json::Value summarize(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for (auto v : values) {
+    sum += v;
+  }
+  double mean = sum / values.size();
+  double squares = 0;
+  for (auto v : values) {
+    squares += (v - mean) * (v - mean);
+  }
+  auto n = values.size();
+  Json::Value summary;
+  summary["min"] = values.front();
+  summary["max"] = values.back();
+  summary["median"] =
+      n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+  summary["mean"] = mean;
+  summary["stddev"] = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+  return summary;
+}
+
+// Loads the snapshot into the current RedexContext, and returns its entry
+// data.
+Json::Value load_snapshot(const std::string& input_ir_dir,
+                          DexStoresVector* stores) {
+  Json::Value entry_data;
+  redex::load_all_intermediate(input_ir_dir, *stores, &entry_data);
+  if (!stores->empty()) {
+    auto first_dex_path = boost::filesystem::path(input_ir_dir) /
+                          entry_data["dex_list"][0]["list"][0].asString();
+    auto location = DexLocation::make_location("dex", first_dex_path.string());
+    (*stores)[0].set_dex_magic(load_dex_magic_from_dex(location));
+  }
+  return entry_data;
+}
+
+// Loads the snapshot into a fresh RedexContext, runs the passes, and returns
+// the measurements of each pass, in pass order.
+std::vector<std::pair<std::string, Sample>> run_once(
+    const Arguments& args, const std::string& output_dir) {
+  g_redex = new RedexContext();
+
+  DexStoresVector stores;
+  Json::Value entry_data = load_snapshot(args.input_ir_dir, &stores);
+  if (!args.config_file.empty()) {
+    entry_data["config"] = args.config_file;
+  }
+
+  RedexOptions redex_options;
+  redex_options.deserialize(entry_data);
+
+  Json::Value config_data =
+      redex::parse_config(entry_data["config"].asString());
+  Json::Value& passes_list = config_data["redex"]["passes"];
+  passes_list = Json::arrayValue;
+  if (args.pass_names.empty()) {
+    if (!entry_data.isMember("checkpoint")) {
+      std::cerr << "error: no passes given, and the input was not written at "
+                   "a checkpoint\n";
+      exit(EXIT_FAILURE);
+    }
+    for (const auto& pass_name : entry_data["checkpoint"]["next_passes"]) {
+      passes_list.append(pass_name.asString());
+    }
+  }
+  for (const auto& pass_name : args.pass_names) {
+    passes_list.append(pass_name);
+  }
+  if (entry_data.isMember("apk_dir")) {
+    config_data["apk_dir"] = entry_data["apk_dir"].asString();
+  }
+  // Memory stats are needed for the RSS measurements.
+  config_data["mem_stats"] = true;
+
+  std::vector<std::pair<std::string, Sample>> samples;
+  {
+    ConfigFiles conf(config_data, output_dir);
+    const auto& passes = PassRegistry::get().get_passes();
+    PassManager manager(passes, conf, redex_options);
+    manager.set_testing_mode();
+    manager.run_passes(stores, conf);
+
+    for (const auto& info : manager.get_pass_info()) {
+      auto metric = [&](const char* name) -> int64_t {
+        auto it = info.metrics.find(name);
+        return it == info.metrics.end() ? 0 : it->second;
+      };
+      samples.emplace_back(
+          info.name,
+          Sample{metric("timing.wall_time.100") / 100.0,
+                 metric("timing.cpu_time.100") / 100.0,
+                 metric("vm_rss_after"), metric("vm_hwm_delta")});
+    }
+  }
+
+  stores.clear();
+  delete g_redex;
+  g_redex = nullptr;
+  return samples;
+}
+
+// Runs one step of the round trip, and measures it the way the PassManager
+// measures a pass.
+template <typename Fn>
+Sample measure(const Fn& fn) {
+  try_reset_hwm_mem_stat();
+  auto before = get_mem_stats();
+  auto wall_start = std::chrono::steady_clock::now();
+  auto cpu_start = std::clock();
+  fn();
+  auto cpu_end = std::clock();
+  auto wall_end = std::chrono::steady_clock::now();
+  auto after = get_mem_stats();
+  return Sample{
+      std::chrono::duration<double>(wall_end - wall_start).count(),
+      static_cast<double>(cpu_end - cpu_start) / CLOCKS_PER_SEC,
+      static_cast<int64_t>(after.vm_rss),
+      static_cast<int64_t>(after.vm_hwm) - static_cast<int64_t>(before.vm_hwm)};
+}
+
+// Loads the dexes into a fresh RedexContext and writes them back out, and
+// returns the measurements of each step, in order. Adds the size of the
+// written dexes to `output_bytes`.
+std::vector<std::pair<std::string, Sample>> run_round_trip_once(
+    const Arguments& args, const std::string& output_dir,
+    uint64_t* output_bytes) {
+  g_redex = new RedexContext();
+
+  std::vector<DexSource> sources;
+  for (const auto& dex : args.round_trip_dexes) {
+    sources.push_back(DexSource{DexLocation::make_location("dex", dex)});
+  }
+  Json::Value config_data = args.config_file.empty()
+                                ? Json::Value(Json::nullValue)
+                                : redex::parse_config(args.config_file);
+  ConfigFiles conf(config_data, output_dir);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(""));
+
+  std::vector<std::pair<std::string, Sample>> samples;
+  DexStoresVector stores;
+  samples.emplace_back("load", measure([&]() {
+                         std::vector<dex_stats_t> stats;
+                         auto dexen = load_classes_from_dexes(
+                             sources, &stats, /* balloon */ false);
+                         DexStore store("classes");
+                         for (auto& classes : dexen) {
+                           store.add_classes(std::move(classes));
+                         }
+                         store.set_dex_magic(
+                             load_dex_magic_from_dex(sources[0].location));
+                         stores.emplace_back(std::move(store));
+                       }));
+  auto scope = build_class_scope(stores);
+  samples.emplace_back("balloon", measure([&]() { balloon_for_test(scope); }));
+  samples.emplace_back("build_cfg", measure([&]() {
+                         walk::parallel::code(scope,
+                                              [](DexMethod*, IRCode& code) {
+                                                code.build_cfg();
+                                              });
+                       }));
+  samples.emplace_back("linearize", measure([&]() {
+                         walk::parallel::code(scope,
+                                              [](DexMethod*, IRCode& code) {
+                                                code.clear_cfg();
+                                              });
+                       }));
+  samples.emplace_back("instruction_lowering", measure([&]() {
+                         instruction_lowering::run(stores);
+                       }));
+  std::vector<std::string> filenames;
+  samples.emplace_back(
+      "write", measure([&]() {
+        auto& store = stores[0];
+        for (size_t i = 0; i < store.get_dexen().size(); i++) {
+          auto& classes = store.get_dexen()[i];
+          if (classes.empty()) {
+            continue;
+          }
+          auto filename = redex::get_dex_output_name(output_dir, store, i);
+          write_classes_to_dex(filename,
+                               &classes,
+                               std::make_shared<GatheredTypes>(&classes),
+                               /* store_number */ 0,
+                               &store.get_name(),
+                               i,
+                               conf,
+                               pos_mapper.get(),
+                               DebugInfoKind::NoCustomSymbolication,
+                               /* method_to_id= */ nullptr,
+                               /* code_debug_lines= */ nullptr,
+                               /* iodi_metadata= */ nullptr,
+                               store.get_dex_magic());
+          filenames.push_back(filename);
+        }
+      }));
+  for (const auto& filename : filenames) {
+    *output_bytes += boost::filesystem::file_size(filename);
+  }
+
+  stores.clear();
+  delete g_redex;
+  g_redex = nullptr;
+  return samples;
+}
+
+struct RegallocCandidate {
+  DexMethod* method;
+  size_t instructions;
+  // The most registers live into any block.
+  size_t max_live;
+};
+
+RegallocCandidate measure_candidate(DexMethod* method) {
+  IRCode copy(*method->get_code());
+  if (!copy.editable_cfg_built()) {
+    copy.build_cfg();
+  }
+  auto& cfg = copy.cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator liveness(cfg);
+  liveness.run(LivenessDomain());
+  size_t max_live = 0;
+  for (auto* block : cfg.blocks()) {
+    const auto& live_in = liveness.get_live_in_vars_at(block);
+    if (!live_in.is_bottom() && !live_in.is_top()) {
+      max_live = std::max(max_live, live_in.elements().size());
+    }
+  }
+  return RegallocCandidate{method, cfg.num_opcodes(), max_live};
+}
+
+// The n largest methods, followed by those of the n methods with the highest
+// register pressure that are not among them.
+std::vector<RegallocCandidate> select_regalloc_candidates(const Scope& scope,
+                                                          size_t n) {
+  std::vector<DexMethod*> methods;
+  walk::code(scope, [&](DexMethod* m, IRCode&) { methods.push_back(m); });
+  std::vector<RegallocCandidate> candidates(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    candidates[i] = measure_candidate(methods[i]);
+  });
+
+  std::vector<RegallocCandidate> selected;
+  std::unordered_set<DexMethod*> seen;
+  auto take = [&](auto&& greater) {
+    auto sorted = candidates;
+    std::stable_sort(sorted.begin(), sorted.end(), greater);
+    sorted.resize(std::min(n, sorted.size()));
+    for (const auto& candidate : sorted) {
+      if (seen.insert(candidate.method).second) {
+        selected.push_back(candidate);
+      }
+    }
+  };
+  take([](const auto& a, const auto& b) {
+    return a.instructions > b.instructions;
+  });
+  take([](const auto& a, const auto& b) { return a.max_live > b.max_live; });
+  return selected;
+}
+
+// Runs the allocator on fresh copies of the code of the method, and reports
+// the timing of all measured runs, and the result of the last one.
+template <typename AllocateFn>
+Json::Value benchmark_allocator(const Arguments& args,
+                                DexMethod* method,
+                                const AllocateFn& allocate) {
+  std::vector<double> times_us;
+  Json::Value result;
+  for (size_t i = 0; i < args.warmup + args.repeat; i++) {
+    IRCode copy(*method->get_code());
+    if (!copy.editable_cfg_built()) {
+      copy.build_cfg();
+    }
+    auto code_units_before = copy.cfg().estimate_code_units();
+    auto start = std::chrono::steady_clock::now();
+    result = allocate(&copy);
+    auto end = std::chrono::steady_clock::now();
+    if (i >= args.warmup) {
+      times_us.push_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    auto& cfg = copy.cfg();
+    result["registers"] = Json::UInt64(cfg.get_registers_size());
+    result["code_units_delta"] =
+        Json::Int64(static_cast<int64_t>(cfg.estimate_code_units()) -
+                    static_cast<int64_t>(code_units_before));
+  }
+  result["time_us"] = summarize(times_us);
+  return result;
+}
+
+Json::Value run_regalloc(const Arguments& args) {
+  g_redex = new RedexContext();
+  DexStoresVector stores;
+  load_snapshot(args.input_ir_dir, &stores);
+  auto scope = build_class_scope(stores);
+  auto candidates = select_regalloc_candidates(scope, args.regalloc_methods);
+
+  regalloc::graph_coloring::Allocator::Config config;
+  Json::Value methods = Json::arrayValue;
+  for (const auto& candidate : candidates) {
+    auto* method = candidate.method;
+    bool method_is_static = is_static(method);
+    auto describe = [method]() { return show(method); };
+
+    Json::Value entry;
+    entry["name"] = show(method);
+    entry["instructions"] = Json::UInt64(candidate.instructions);
+    entry["max_live"] = Json::UInt64(candidate.max_live);
+    entry["graph_coloring"] =
+        benchmark_allocator(args, method, [&](IRCode* code) {
+          auto stats = regalloc::graph_coloring::allocate(
+              config, code, method_is_static, describe);
+          Json::Value result;
+          result["moves_inserted"] = Json::UInt64(stats.moves_inserted());
+          result["moves_coalesced"] = Json::UInt64(stats.moves_coalesced);
+          result["reiterations"] = Json::UInt64(stats.reiteration_count);
+          return result;
+        });
+    entry["linear_scan"] = benchmark_allocator(args, method, [&](IRCode* code) {
+      fastregalloc::LinearScanAllocator allocator(
+          code, method_is_static, describe,
+          /* satisfy_encoding_constraints */ true);
+      allocator.allocate();
+      Json::Value result;
+      // Otherwise RegAllocPass falls back to graph coloring.
+      result["encodable"] =
+          regalloc::satisfies_encoding_constraints(code->cfg());
+      return result;
+    });
+    methods.append(entry);
+  }
+
+  stores.clear();
+  delete g_redex;
+  g_redex = nullptr;
+
+  Json::Value report;
+  report["input"] = args.input_ir_dir;
+  report["repeat"] = Json::UInt64(args.repeat);
+  report["warmup"] = Json::UInt64(args.warmup);
+  report["methods"] = methods;
+  return report;
+}
+
+void write_report(const Arguments& args, const Json::Value& report) {
+  if (args.output_file.empty()) {
+    std::cout << report;
+  } else {
+    std::ofstream out(args.output_file);
+    out << report;
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  Arguments args = parse_args(argc, argv);
+  if (args.regalloc_methods > 0) {
+    write_report(args, run_regalloc(args));
+    return 0;
+  }
+
+  auto output_dir = boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("redex-bench-%%%%%%%%");
+  boost::filesystem::create_directories(output_dir / "meta");
+
+  // Pass name to its samples of all measured repetitions. The order of the
+  // passes is kept separately, as it is the order of the report.
+  std::vector<std::string> pass_order;
+  std::map<std::string, std::vector<Sample>> samples_by_pass;
+  bool round_trip = !args.round_trip_dexes.empty();
+  uint64_t input_bytes = 0;
+  for (const auto& dex : args.round_trip_dexes) {
+    input_bytes += boost::filesystem::file_size(dex);
+  }
+  std::vector<double> throughputs;
+  uint64_t output_bytes = 0;
+  for (size_t i = 0; i < args.warmup + args.repeat; i++) {
+    output_bytes = 0;
+    auto samples =
+        round_trip
+            ? run_round_trip_once(args, output_dir.string(), &output_bytes)
+            : run_once(args, output_dir.string());
+    if (i < args.warmup) {
+      continue;
+    }
+    if (round_trip) {
+      double wall_time_s = 0;
+      for (const auto& [_, sample] : samples) {
+        wall_time_s += sample.wall_time_s;
+      }
+      throughputs.push_back(input_bytes / 1e6 / wall_time_s);
+    }
+    for (auto& [name, sample] : samples) {
+      auto& pass_samples = samples_by_pass[name];
+      if (pass_samples.empty()) {
+        pass_order.push_back(name);
+      }
+      pass_samples.push_back(sample);
+    }
+  }
+  boost::filesystem::remove_all(output_dir);
+
+  Json::Value report;
+  if (round_trip) {
+    Json::Value& inputs = report["input"];
+    inputs = Json::arrayValue;
+    for (const auto& dex : args.round_trip_dexes) {
+      inputs.append(dex);
+    }
+    report["input_bytes"] = Json::UInt64(input_bytes);
+    report["output_bytes"] = Json::UInt64(output_bytes);
+    report["mb_per_s"] = summarize(throughputs);
+  } else {
+    report["input"] = args.input_ir_dir;
+  }
+  report["repeat"] = Json::UInt64(args.repeat);
+  report["warmup"] = Json::UInt64(args.warmup);
+  Json::Value& passes = report["passes"];
+  passes = Json::arrayValue;
+  for (const auto& name : pass_order) {
+    const auto& pass_samples = samples_by_pass.at(name);
+    std::vector<double> wall_times;
+    std::vector<double> cpu_times;
+    std::vector<double> rss_after;
+    std::vector<double> hwm_delta;
+    for (const auto& sample : pass_samples) {
+      wall_times.push_back(sample.wall_time_s);
+      cpu_times.push_back(sample.cpu_time_s);
+      rss_after.push_back(sample.rss_after);
+      hwm_delta.push_back(sample.hwm_delta);
+    }
+    Json::Value pass;
+    pass["name"] = name;
+    pass["wall_time_s"] = summarize(wall_times);
+    pass["cpu_time_s"] = summarize(cpu_times);
+    pass["vm_rss_after"] = summarize(rss_after);
+    pass["vm_hwm_delta"] = summarize(hwm_delta);
+    passes.append(pass);
+  }
+
+  write_report(args, report);
+  return 0;
+}
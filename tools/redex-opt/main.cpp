@@ -27,6 +27,7 @@ struct Arguments {
   std::string config_file;
   std::vector<std::string> s_args;
   std::vector<std::string> j_args;
+  bool resume{false};
 };
 
 Arguments parse_args(int argc, char* argv[]) {
@@ -41,6 +42,10 @@ Arguments parse_args(int argc, char* argv[]) {
                      "output dex and IR meta directory");
   desc.add_options()("pass-name,p", po::value<std::vector<std::string>>(),
                      "pass name");
+  desc.add_options()("resume,r",
+                     "Continue with the passes following the checkpoint the "
+                     "input was written at (see `checkpoint_after_pass`), "
+                     "unless passes are given explicitly");
   desc.add_options()("config,c",
                      po::value<std::string>(),
                      "A JSON-formatted config file to replace the one from "
@@ -102,6 +107,8 @@ Arguments parse_args(int argc, char* argv[]) {
     args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
   }
 
+  args.resume = vm.count("resume") != 0;
+
   if (vm.count("config")) {
     args.config_file = vm["config"].as<std::string>();
   }
@@ -171,6 +178,15 @@ Json::Value process_entry_data(const Json::Value& entry_data,
   // Change passes list in config data.
   config_data["redex"]["passes"] = Json::arrayValue;
   Json::Value& passes_list = config_data["redex"]["passes"];
+  if (args.resume && args.pass_names.empty()) {
+    if (!entry_data.isMember("checkpoint")) {
+      std::cerr << "error: --resume requires input written at a checkpoint\n";
+      exit(EXIT_FAILURE);
+    }
+    for (const auto& pass_name : entry_data["checkpoint"]["next_passes"]) {
+      passes_list.append(pass_name.asString());
+    }
+  }
   for (const std::string& pass_name : args.pass_names) {
     passes_list.append(pass_name);
   }
@@ -234,6 +250,9 @@ int main(int argc, char* argv[]) {
   manager.set_testing_mode();
   manager.run_passes(stores, conf);
 
+  // The output no longer corresponds to the checkpoint it was resumed from.
+  entry_data.removeMember("checkpoint");
+
   redex::write_all_intermediate(conf, args.output_ir_dir, args.redex_options,
                                 stores, entry_data);
 
@@ -22,7 +22,9 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 */
 
 #include <boost/algorithm/string/replace.hpp>
+#include <cstdarg>
 #include <queue>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -42,27 +44,95 @@ static std::unordered_map<DexMethod*, int> method_ids;
 static std::unordered_map<DexField*, int> field_ids;
 static std::unordered_map<const DexString*, int> string_ids;
 
-void dump_field_refs(FILE* fdout,
-                     const char* prefix,
-                     DexField* field,
-                     int field_id) {
+/*
+ * Emits the rows of a table as multi-row INSERT statements, which sqlite
+ * parses and executes considerably faster than one statement per row.
+ */
+class SqlInsertBatch {
+ public:
+  SqlInsertBatch(FILE* fdout, const char* prefix, const char* table)
+      : m_fdout(fdout), m_table(std::string(prefix) + table) {}
+
+  SqlInsertBatch(const SqlInsertBatch&) = delete;
+  SqlInsertBatch& operator=(const SqlInsertBatch&) = delete;
+
+  ~SqlInsertBatch() { flush(); }
+
+  // Appends a row, formatted as the parenthesized list of its values.
+  __attribute__((format(printf, 2, 3))) void add_row(const char* fmt, ...) {
+    m_buffer += m_rows == 0 ? "INSERT INTO " + m_table + " VALUES\n" : ",\n";
+    va_list args;
+    va_start(args, fmt);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(nullptr, 0, fmt, args_copy);
+    va_end(args_copy);
+    auto old_size = m_buffer.size();
+    m_buffer.resize(old_size + len + 1);
+    vsnprintf(&m_buffer[old_size], len + 1, fmt, args);
+    va_end(args);
+    m_buffer.resize(old_size + len);
+    if (++m_rows == kMaxRows) {
+      flush();
+    }
+  }
+
+  // Writes out the pending rows. The rows of the different tables are
+  // buffered separately, as their statements cannot be interleaved.
+  void flush() {
+    if (m_rows != 0) {
+      m_buffer += ";\n";
+      fwrite(m_buffer.data(), 1, m_buffer.size(), m_fdout);
+      m_buffer.clear();
+      m_rows = 0;
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxRows = 500;
+
+  FILE* m_fdout;
+  std::string m_table;
+  std::string m_buffer;
+  size_t m_rows{0};
+};
+
+struct RefBatches {
+  SqlInsertBatch field_string_refs;
+  SqlInsertBatch method_string_refs;
+  SqlInsertBatch method_class_refs;
+  SqlInsertBatch method_field_refs;
+  SqlInsertBatch method_method_refs;
+
+  RefBatches(FILE* fdout, const char* prefix)
+      : field_string_refs(fdout, prefix, "field_string_refs"),
+        method_string_refs(fdout, prefix, "method_string_refs"),
+        method_class_refs(fdout, prefix, "method_class_refs"),
+        method_field_refs(fdout, prefix, "method_field_refs"),
+        method_method_refs(fdout, prefix, "method_method_refs") {}
+
+  void flush() {
+    field_string_refs.flush();
+    method_string_refs.flush();
+    method_class_refs.flush();
+    method_field_refs.flush();
+    method_method_refs.flush();
+  }
+};
+
+void dump_field_refs(RefBatches& batches, DexField* field, int field_id) {
   static int next_string_ref = 0;
   auto* static_value = field->get_static_value();
   if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
   auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
   auto string_id = string_ids[static_string_value->string()];
-  fprintf(fdout,
-          "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          field_id,
-          string_id);
+  batches.field_string_refs.add_row("(%d, %d, %d)",
+                                    next_string_ref++,
+                                    field_id,
+                                    string_id);
 }
 
-void dump_method_refs(FILE* fdout,
-                      const char* prefix,
-                      DexMethod* method,
-                      int method_id) {
+void dump_method_refs(RefBatches& batches, DexMethod* method, int method_id) {
   auto code = method->get_code();
   if (!code) return;
 
@@ -76,39 +146,33 @@ void dump_method_refs(FILE* fdout,
     if (insn->has_string()) {
       if (string_ids.count(insn->get_string())) {
         auto string_id = string_ids[insn->get_string()];
-        fprintf(fdout,
-                "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_string_ref++,
-                method_id,
-                string_id,
-                insn->opcode());
+        batches.method_string_refs.add_row("(%d, %d, %d, %d)",
+                                           next_string_ref++,
+                                           method_id,
+                                           string_id,
+                                           insn->opcode());
       }
     }
     if (insn->has_type()) {
       auto cls = type_class(insn->get_type());
       if (cls && class_ids.count(cls)) {
         auto class_id = class_ids[cls];
-        fprintf(fdout,
-                "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_class_ref++,
-                method_id,
-                class_id,
-                insn->opcode());
+        batches.method_class_refs.add_row("(%d, %d, %d, %d)",
+                                          next_class_ref++,
+                                          method_id,
+                                          class_id,
+                                          insn->opcode());
       }
     }
     if (insn->has_field()) {
       auto field = resolve_field(insn->get_field());
       if (field != nullptr && field_ids.count(field)) {
         auto field_id = field_ids[field];
-        fprintf(fdout,
-                "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_field_ref++,
-                method_id,
-                field_id,
-                insn->opcode());
+        batches.method_field_refs.add_row("(%d, %d, %d, %d)",
+                                          next_field_ref++,
+                                          method_id,
+                                          field_id,
+                                          insn->opcode());
       }
     }
     if (insn->has_method()) {
@@ -116,20 +180,17 @@ void dump_method_refs(FILE* fdout,
           resolve_method(insn->get_method(), opcode_to_search(insn), method);
       if (meth != nullptr && method_ids.count(meth)) {
         auto method_ref_id = method_ids[meth];
-        fprintf(fdout,
-                "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_method_ref++,
-                method_id,
-                method_ref_id,
-                insn->opcode());
+        batches.method_method_refs.add_row("(%d, %d, %d, %d)",
+                                           next_method_ref++,
+                                           method_id,
+                                           method_ref_id,
+                                           insn->opcode());
       }
     }
   }
 }
 
-void dump_class(FILE* fdout,
-                const char* prefix,
+void dump_class(SqlInsertBatch& classes,
                 const char* dex_id,
                 DexClass* cls,
                 int class_id) {
@@ -138,18 +199,15 @@ void dump_class(FILE* fdout,
   // TODO: string usage
   // TODO: size estimate
   const auto& deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(fdout,
-          "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-          prefix,
-          class_id,
-          dex_id,
-          deobfuscated_name.c_str(),
-          cls->get_name()->c_str(),
-          cls->get_access());
+  classes.add_row("(%d,'%s','%s','%s',%u)",
+                  class_id,
+                  dex_id,
+                  deobfuscated_name.c_str(),
+                  cls->get_name()->c_str(),
+                  cls->get_access());
 }
 
-void dump_field(FILE* fdout,
-                const char* prefix,
+void dump_field(SqlInsertBatch& fields,
                 int class_id,
                 DexField* field,
                 int field_id) {
@@ -157,20 +215,17 @@ void dump_field(FILE* fdout,
   // TODO: break down signature
   // TODO: annotations?
   // TODO: string usage (encoded_value for static fields)
-  const auto& deobfuscated_name = field->get_deobfuscated_name();
+  const auto deobfuscated_name = field->get_deobfuscated_name_or_empty_copy();
   auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-          prefix,
-          field_id,
-          class_id,
-          field_name,
-          field->get_name()->c_str(),
-          field->get_access());
+  fields.add_row("(%d, %d, '%s', '%s', %u)",
+                 field_id,
+                 class_id,
+                 field_name,
+                 field->get_name()->c_str(),
+                 field->get_access());
 }
 
-void dump_method(FILE* fdout,
-                 const char* prefix,
+void dump_method(SqlInsertBatch& methods,
                  int class_id,
                  DexMethod* method,
                  int method_id) {
@@ -182,15 +237,14 @@ void dump_method(FILE* fdout,
   // TODO: size estimate
   const auto& deobfuscated_name = method->get_deobfuscated_name();
   auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%zu);\n",
-          prefix,
-          method_id,
-          class_id,
-          method_name,
-          method->get_name()->c_str(),
-          method->get_access(),
-          method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
+  methods.add_row("(%d,%d,'%s','%s',%d,%zu)",
+                  method_id,
+                  class_id,
+                  method_name,
+                  method->get_name()->c_str(),
+                  method->get_access(),
+                  method->get_code() ? method->get_code()->sum_opcode_sizes()
+                                     : 0);
 }
 
 void dump_sql(FILE* fdout,
@@ -278,6 +332,10 @@ CREATE TABLE %1$smethod_string_refs (
 
   // Dump all dex items
   fprintf(fdout, "BEGIN TRANSACTION;\n");
+  SqlInsertBatch strings_batch(fdout, prefix, "strings");
+  SqlInsertBatch classes_batch(fdout, prefix, "classes");
+  SqlInsertBatch fields_batch(fdout, prefix, "fields");
+  SqlInsertBatch methods_batch(fdout, prefix, "methods");
   for (auto& store : stores) {
     auto store_name = store.get_name();
     auto& dexen = store.get_dexen();
@@ -292,45 +350,46 @@ CREATE TABLE %1$smethod_string_refs (
         // Escape string before inserting. ' -> ''
         std::string esc(dexstr->c_str());
         boost::replace_all(esc, "'", "''");
-        fprintf(fdout,
-                "INSERT INTO %sstrings VALUES(%d, '%s');\n",
-                prefix,
-                id,
-                esc.c_str());
+        strings_batch.add_row("(%d, '%s')", id, esc.c_str());
       }
       std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
       const char* dex_id = dex_id_str.c_str();
       for (const auto& cls : dex) {
         int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
+        dump_class(classes_batch, dex_id, cls, class_id);
         class_ids[cls] = class_id;
         for (auto field : cls->get_ifields()) {
           int field_id = next_field_id++;
           field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
+          dump_field(fields_batch, class_id, field, field_id);
         }
         for (auto field : cls->get_sfields()) {
           int field_id = next_field_id++;
           field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
+          dump_field(fields_batch, class_id, field, field_id);
         }
         for (const auto& meth : cls->get_dmethods()) {
           int meth_id = next_method_id++;
           method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
+          dump_method(methods_batch, class_id, meth, meth_id);
         }
         for (auto& meth : cls->get_vmethods()) {
           int meth_id = next_method_id++;
           method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
+          dump_method(methods_batch, class_id, meth, meth_id);
         }
       }
     }
   }
+  strings_batch.flush();
+  classes_batch.flush();
+  fields_batch.flush();
+  methods_batch.flush();
   fprintf(fdout, "END TRANSACTION;\n");
 
   // Dump references
   fprintf(fdout, "BEGIN TRANSACTION;\n");
+  RefBatches batches(fdout, prefix);
   for (auto& store : stores) {
     auto& dexen = store.get_dexen();
     for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
@@ -338,23 +397,24 @@ CREATE TABLE %1$smethod_string_refs (
       for (const auto& cls : dex) {
         for (const auto& meth : cls->get_dmethods()) {
           int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
+          dump_method_refs(batches, meth, meth_id);
         }
         for (auto& meth : cls->get_vmethods()) {
           int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
+          dump_method_refs(batches, meth, meth_id);
         }
         for (const auto& field : cls->get_sfields()) {
           int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
+          dump_field_refs(batches, field, field_id);
         }
         for (const auto& field : cls->get_ifields()) {
           int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
+          dump_field_refs(batches, field, field_id);
         }
       }
     }
   }
+  batches.flush();
   fprintf(fdout, "END TRANSACTION;\n");
 
   // Dump hierarchy
@@ -362,21 +422,21 @@ CREATE TABLE %1$smethod_string_refs (
   ClassHierarchy ch = build_type_hierarchy(scope);
   int next_is_a_id = 0;
   fprintf(fdout, "BEGIN TRANSACTION;\n");
+  SqlInsertBatch is_a_batch(fdout, prefix, "is_a");
   for (auto& cls : scope) {
     TypeSet results;
     get_all_children_or_implementors(ch, scope, cls, results);
     for (auto type : results) {
       auto type_cls = type_class(type);
       if (type_cls) {
-        fprintf(fdout,
-                "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-                prefix,
-                next_is_a_id++,
-                class_ids[type_cls],
-                class_ids[cls]);
+        is_a_batch.add_row("(%d, %d, %d)",
+                           next_is_a_id++,
+                           class_ids[type_cls],
+                           class_ids[cls]);
       }
     }
   }
+  is_a_batch.flush();
   fprintf(fdout, "END TRANSACTION;\n");
 }
 
@@ -15,6 +15,8 @@
 #include <sstream>
 
 #include "Debug.h"
+#elif defined(__GLIBC__)
+#include <malloc.h>
 #endif
 
 namespace jemalloc_util {
@@ -72,6 +74,38 @@ void some_malloc_stats(const std::function<void(const char*, uint64_t)>& fn) {
   // Consider stats.arenas here.
 }
 
+namespace {
+
+uint64_t get_resident() {
+  // Stats are cached, and only get updated when the epoch is advanced.
+  uint64_t epoch = 1;
+  size_t epoch_len = sizeof(epoch);
+  mallctl("epoch", &epoch, &epoch_len, &epoch, epoch_len);
+  size_t value = 0;
+  size_t len = sizeof(value);
+  if (mallctl("stats.resident", &value, &len, nullptr, 0) != 0) {
+    return 0;
+  }
+  return value;
+}
+
+} // namespace
+
+uint64_t purge_unused_memory() {
+  auto before = get_resident();
+  int err = mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+  if (err != 0) {
+    std::cerr << "Failed flushing the thread cache: " << err << std::endl;
+  }
+  auto purge = "arena." + std::to_string(MALLCTL_ARENAS_ALL) + ".purge";
+  err = mallctl(purge.c_str(), nullptr, nullptr, nullptr, 0);
+  if (err != 0) {
+    std::cerr << "Failed purging arenas: " << err << std::endl;
+  }
+  auto after = get_resident();
+  return before > after ? before - after : 0;
+}
+
 #else // !USE_JEMALLOC
 
 void enable_profiling() {}
@@ -85,6 +119,14 @@ void dump(const std::string&) {
 std::string get_malloc_stats() { return ""; }
 void some_malloc_stats(const std::function<void(const char*, uint64_t)>&) {}
 
+uint64_t purge_unused_memory() {
+#ifdef __GLIBC__
+  // glibc cannot tell how much was released.
+  malloc_trim(0);
+#endif
+  return 0;
+}
+
 #endif
 
 } // namespace jemalloc_util
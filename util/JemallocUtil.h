@@ -33,4 +33,11 @@ class ScopedProfiling final {
 std::string get_malloc_stats();
 void some_malloc_stats(const std::function<void(const char*, uint64_t)>& fn);
 
+/**
+ * Returns dirty pages of all arenas, and the calling thread's cached objects,
+ * to the OS. Returns how much the resident size shrank, when the allocator
+ * can tell.
+ */
+uint64_t purge_unused_memory();
+
 } // namespace jemalloc_util
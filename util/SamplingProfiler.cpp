@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SamplingProfiler.h"
+
+#ifdef __linux__
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "Debug.h"
+
+namespace sampling_profiler {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr size_t MAX_DEPTH = 64;
+// The frames of the signal handler, and of the signal trampoline.
+constexpr int SKIPPED_FRAMES = 2;
+constexpr size_t NUM_SLOTS = 1 << 14;
+constexpr size_t MAX_PROBES = 32;
+
+enum SlotState : uint32_t { EMPTY, WRITING, READY };
+
+// The samples are aggregated by stack in a fixed-size hashtable, as nothing
+// can be allocated from the signal handler.
+struct Slot {
+  std::atomic<uint32_t> state;
+  uint32_t depth;
+  std::atomic<uint64_t> count;
+  void* pcs[MAX_DEPTH];
+};
+
+std::atomic<Slot*> s_slots{nullptr};
+std::atomic<uint32_t> s_in_handler{0};
+std::atomic<uint64_t> s_dropped{0};
+std::atomic<bool> s_session_active{false};
+struct sigaction s_old_action;
+
+size_t hash_stack(void* const* pcs, size_t depth) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < depth; ++i) {
+    hash ^= reinterpret_cast<uintptr_t>(pcs[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+void record(Slot* slots, void* const* pcs, size_t depth) {
+  auto hash = hash_stack(pcs, depth);
+  for (size_t probe = 0; probe < MAX_PROBES; ++probe) {
+    auto& slot = slots[(hash + probe) % NUM_SLOTS];
+    uint32_t state = slot.state.load();
+    if (state == EMPTY && slot.state.compare_exchange_strong(state, WRITING)) {
+      slot.depth = depth;
+      std::copy(pcs, pcs + depth, slot.pcs);
+      slot.count.store(1);
+      slot.state.store(READY);
+      return;
+    }
+    if (state == READY && slot.depth == depth &&
+        std::equal(pcs, pcs + depth, slot.pcs)) {
+      slot.count.fetch_add(1);
+      return;
+    }
+  }
+  s_dropped.fetch_add(1);
+}
+
+__attribute__((noinline)) void handle_sigprof(int) {
+  int saved_errno = errno;
+  s_in_handler.fetch_add(1);
+  auto* slots = s_slots.load();
+  if (slots != nullptr) {
+    void* frames[MAX_DEPTH + SKIPPED_FRAMES];
+    int depth = backtrace(frames, MAX_DEPTH + SKIPPED_FRAMES);
+    if (depth > SKIPPED_FRAMES) {
+      record(slots, frames + SKIPPED_FRAMES, depth - SKIPPED_FRAMES);
+    }
+  }
+  s_in_handler.fetch_sub(1);
+  errno = saved_errno;
+}
+
+void set_timer(unsigned int period_us) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = period_us / 1000000;
+  timer.it_interval.tv_usec = period_us % 1000000;
+  timer.it_value = timer.it_interval;
+  int err = setitimer(ITIMER_PROF, &timer, nullptr);
+  always_assert_log(err == 0, "setitimer failed: %s", strerror(errno));
+}
+
+void write_words(FILE* fd, const std::vector<uintptr_t>& words) {
+  fwrite(words.data(), sizeof(uintptr_t), words.size(), fd);
+}
+
+// See https://gperftools.github.io/gperftools/cpuprofile-fileformat.html
+void write_profile(const std::string& file_name,
+                   const Slot* slots,
+                   unsigned int period_us) {
+  FILE* fd = fopen(file_name.c_str(), "wb");
+  if (fd == nullptr) {
+    std::cerr << "Failed to open " << file_name << ": " << strerror(errno)
+              << std::endl;
+    return;
+  }
+  write_words(fd, {0, 3, 0, period_us, 0});
+  uint64_t samples = 0;
+  std::vector<uintptr_t> record;
+  for (size_t i = 0; i < NUM_SLOTS; ++i) {
+    const auto& slot = slots[i];
+    if (slot.state.load() != READY) {
+      continue;
+    }
+    record.clear();
+    record.push_back(slot.count.load());
+    record.push_back(slot.depth);
+    for (size_t j = 0; j < slot.depth; ++j) {
+      record.push_back(reinterpret_cast<uintptr_t>(slot.pcs[j]));
+    }
+    write_words(fd, record);
+    samples += slot.count.load();
+  }
+  write_words(fd, {0, 1, 0});
+
+  // pprof symbolizes the samples via the memory mappings.
+  FILE* maps = fopen("/proc/self/maps", "r");
+  if (maps != nullptr) {
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), maps)) > 0) {
+      fwrite(buf, 1, n, fd);
+    }
+    fclose(maps);
+  }
+  fclose(fd);
+  std::cerr << "Wrote CPU profile " << file_name << " (" << samples
+            << " samples, " << s_dropped.load() << " dropped)" << std::endl;
+}
+
+unsigned int period_us(unsigned int frequency_hz) {
+  return std::max(1u, 1000000 / frequency_hz);
+}
+
+} // namespace
+
+ScopedProfiling::ScopedProfiling(const Options& options,
+                                 const std::string& name)
+    : m_file_name(options.output_dir + "/" + name + ".prof") {
+  always_assert(options.frequency_hz > 0);
+  bool expected = false;
+  if (!s_session_active.compare_exchange_strong(expected, true)) {
+    std::cerr << "Sampling profiler already running, not profiling " << name
+              << std::endl;
+    return;
+  }
+  m_active = true;
+  m_frequency_hz = options.frequency_hz;
+
+  // The first call of backtrace() may allocate, so make sure it happened
+  // before any signal arrives.
+  void* frame;
+  backtrace(&frame, 1);
+
+  s_dropped = 0;
+  s_slots = new Slot[NUM_SLOTS]();
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_sigprof;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  int err = sigaction(SIGPROF, &action, &s_old_action);
+  always_assert_log(err == 0, "sigaction failed: %s", strerror(errno));
+  std::cerr << "Running sampling profiler for " << name << "..." << std::endl;
+  set_timer(period_us(m_frequency_hz));
+}
+
+ScopedProfiling::~ScopedProfiling() {
+  if (!m_active) {
+    return;
+  }
+  set_timer(0);
+  sigaction(SIGPROF, &s_old_action, nullptr);
+  auto* slots = s_slots.exchange(nullptr);
+  // Wait for signal handlers that started before the exchange.
+  while (s_in_handler.load() != 0) {
+    std::this_thread::yield();
+  }
+  write_profile(m_file_name, slots, period_us(m_frequency_hz));
+  delete[] slots;
+  s_session_active = false;
+}
+
+#else // !__linux__
+
+ScopedProfiling::ScopedProfiling(const Options&, const std::string&) {
+  std::cerr << "The sampling profiler is a no-op on non-Linux systems"
+            << std::endl;
+}
+
+ScopedProfiling::~ScopedProfiling() {}
+
+#endif
+
+boost::optional<ScopedProfiling::Options>
+ScopedProfiling::maybe_options_from_env() {
+  if (getenv("SAMPLING_PROFILE_PASS") == nullptr &&
+      getenv("SAMPLING_PROFILE_ALL_PASSES") == nullptr) {
+    return boost::none;
+  }
+  Options options{".", 100};
+  if (auto* dir = getenv("SAMPLING_PROFILE_DIR")) {
+    options.output_dir = dir;
+  }
+  if (auto* frequency = getenv("SAMPLING_PROFILE_FREQUENCY")) {
+    options.frequency_hz = strtoul(frequency, nullptr, 10);
+    always_assert_log(options.frequency_hz > 0,
+                      "Invalid SAMPLING_PROFILE_FREQUENCY: %s", frequency);
+  }
+  return options;
+}
+
+} // namespace sampling_profiler
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <string>
+
+/*
+ * A built-in CPU sampling profiler. While a ScopedProfiling is alive, the
+ * process is interrupted by SIGPROF at the given frequency of consumed CPU
+ * time (summed over all threads), and the stack of the interrupted thread is
+ * recorded. On destruction, the samples are written in the legacy gperftools
+ * CPU profile format, followed by the memory mappings of the process, which
+ * `pprof` reads directly, e.g. `pprof -top redex-all Pass.1.prof`.
+ *
+ * Only one profiling session can be active at a time. This is only supported
+ * on Linux; elsewhere it does nothing.
+ */
+namespace sampling_profiler {
+
+class ScopedProfiling final {
+ public:
+  struct Options {
+    std::string output_dir;
+    unsigned int frequency_hz;
+  };
+
+  ScopedProfiling(const Options& options, const std::string& name);
+  ~ScopedProfiling();
+
+  ScopedProfiling(const ScopedProfiling&) = delete;
+  ScopedProfiling& operator=(const ScopedProfiling&) = delete;
+
+  // Reads the options from SAMPLING_PROFILE_DIR (default: the current
+  // directory) and SAMPLING_PROFILE_FREQUENCY (default: 100 samples per
+  // second), if profiling was requested by setting SAMPLING_PROFILE_PASS or
+  // SAMPLING_PROFILE_ALL_PASSES.
+  static boost::optional<Options> maybe_options_from_env();
+
+ private:
+  std::string m_file_name;
+  unsigned int m_frequency_hz{0};
+  bool m_active{false};
+};
+
+} // namespace sampling_profiler